@@ -17,10 +17,22 @@
 #ifndef IGNITION_SENSORS_ALTIMETERSENSOR_HH_
 #define IGNITION_SENSORS_ALTIMETERSENSOR_HH_
 
+#include <functional>
 #include <memory>
 
 #include <sdf/sdf.hh>
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/altimeter.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/Event.hh>
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
 
@@ -77,6 +89,30 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief Publish a recorded message, and call the data callbacks
+      /// with the messages of the main topic.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      /// \sa Manager::SetReplay()
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg) override;
+
+      /// \brief Connect a callback that is called with every new altimeter
+      /// message, from the thread that updates the sensor. In-process
+      /// consumers can use this instead of subscribing to the topic, which
+      /// avoids serialization. Messages are only published when the topic
+      /// has subscribers.
+      /// \param[in] _callback Function to call with the message.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      public: ignition::common::ConnectionPtr ConnectDataCallback(
+                  std::function<
+                  void(const ignition::msgs::Altimeter &)> _callback);
+
       /// \brief Set the vertical reference position of the altimeter
       /// \param[in] _ref Verical reference position in meters
       public: void SetVerticalReference(double _reference);
@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_BUILTINSENSORS_HH_
+#define IGNITION_SENSORS_BUILTINSENSORS_HH_
+
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/builtin_sensors/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Register all sensor types of the builtin_sensors library with
+    /// SensorFactory::RegisterStaticSensorTypes(). The library, built with
+    /// the IGN_SENSORS_STATIC_REGISTRY CMake option, holds every sensor
+    /// type shipped with ignition-sensors, so that sensors are created
+    /// without loading plugins. Linking the shared library registers the
+    /// types on load. Applications linking a static archive of it call
+    /// this once before creating sensors, so that the linker keeps the
+    /// registry. Calling it again does nothing.
+    IGNITION_SENSORS_BUILTIN_SENSORS_VISIBLE void RegisterBuiltinSensors();
+    }
+  }
+}
+
+#endif
@@ -17,6 +17,7 @@
 #ifndef IGNITION_SENSORS_CAMERASENSOR_HH_
 #define IGNITION_SENSORS_CAMERASENSOR_HH_
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <string>
@@ -26,6 +27,7 @@
 #include <ignition/common/PluginMacros.hh>
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
+#include <ignition/math/Vector2.hh>
 
 #ifdef _WIN32
 #pragma warning(push)
@@ -51,6 +53,7 @@
 #include "ignition/sensors/camera/Export.hh"
 #include "ignition/sensors/config.hh"
 #include "ignition/sensors/Export.hh"
+#include "ignition/sensors/ImageView.hh"
 #include "ignition/sensors/RenderingSensor.hh"
 
 namespace ignition
@@ -70,6 +73,23 @@ namespace ignition
     ///   It offers both an ignition-transport interface and a direct C++ API
     ///   to access the image data. The API works by setting a callback to be
     ///   called with image data.
+    ///
+    ///   Every camera renders into its own render target. For rigs of many
+    ///   cameras, enable Manager::SetBatchedRendering() so that all the
+    ///   cameras are rendered before any frame is read back. Only the first
+    ///   readback then waits for the GPU. Add SetReadbackDepth() so that no
+    ///   readback waits for the frames that were just submitted.
+    ///
+    ///   The <distortion> coefficients of the camera SDF, which are also
+    ///   published in the camera info, distort the images on the GPU with
+    ///   the Brown-Conrady model, before the image noise is added. Render
+    ///   engines without distortion passes publish undistorted images, with
+    ///   a warning.
+    ///
+    ///   Cameras that only need a frame on request, such as snapshots for
+    ///   a task, can be triggered instead, see Sensor::SetTriggered(). They
+    ///   don't render until triggered through Sensor::Trigger() or their
+    ///   trigger topic.
     class IGNITION_SENSORS_CAMERA_VISIBLE CameraSensor : public RenderingSensor
     {
       /// \brief constructor
@@ -88,6 +108,17 @@ namespace ignition
       /// \return true if loading was successful
       public: virtual bool Load(sdf::ElementPtr _sdf) override;
 
+      /// \brief Change the configuration of the camera in place. The image
+      /// size, field of view, clip planes, visibility mask, pixel format
+      /// and frame saving change on the existing rendering cameras, whose
+      /// render targets and images are only recreated if the size changed.
+      /// Frames in flight are dropped. Changing the noise requires creating
+      /// the sensor again.
+      /// \param[in] _sdf New SDF of the sensor
+      /// \return False if the sensor must be created again to apply _sdf.
+      /// \sa Sensor::Reconfigure()
+      public: virtual bool Reconfigure(const sdf::Sensor &_sdf) override;
+
       /// \brief Initialize values in the sensor
       /// \return True on success
       public: virtual bool Init() override;
@@ -104,6 +135,43 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief Publish a recorded message, and call the image callbacks
+      /// with the messages of the main topic.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      /// \sa Manager::SetReplay()
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg) override;
+
+      /// \brief Get whether consumers are still busy with earlier images.
+      /// Besides the publish queue, this is true while image callbacks
+      /// are running, for example when frames are processed on other
+      /// threads with staged updates.
+      /// \return True if earlier images haven't been consumed yet.
+      /// \sa Sensor::SetBackpressure()
+      public: virtual bool ConsumersBusy() const override;
+
+      // Documentation inherited
+      public: virtual bool SupportsStagedUpdates() const override;
+
+      // Documentation inherited
+      public: virtual void ReadbackFrame() override;
+
+      // Documentation inherited
+      public: virtual void ProcessFrame() override;
+
+      // Documentation inherited
+      public: virtual SensorMemory MemoryUsage() const override;
+
+      /// \brief Render the camera once, and the cameras of the readback
+      /// ring if pipelined readback is enabled.
+      /// \return False if the camera doesn't exist yet.
+      public: virtual bool WarmUp() override;
+
       /// \brief Set a callback to be called when image frame data is
       /// generated.
       /// \param[in] _callback This callback will be called every time the
@@ -116,6 +184,19 @@ namespace ignition
                   std::function<
                   void(const ignition::msgs::Image &)> _callback);
 
+      /// \brief Set a callback to be called with a view of the pixels of
+      /// each image, instead of an ignition::msgs::Image. When only such
+      /// callbacks consume the images, no message is built for them.
+      /// \param[in] _callback This callback will be called every time the
+      /// camera produces image data. The view is only valid during the
+      /// callback. The Update function will be blocked while the callbacks
+      /// are executed.
+      /// \remark Do not block inside of the callback.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      public: ignition::common::ConnectionPtr ConnectImageViewCallback(
+                  std::function<void(const ImageView &)> _callback);
+
       /// \brief Set the rendering scene.
       /// \param[in] _scene Pointer to the scene
       public: virtual void SetScene(
@@ -137,6 +218,29 @@ namespace ignition
       /// \return Camera info topic.
       public: std::string InfoTopic() const;
 
+      /// \brief Service that replies with the current camera info, for
+      /// subscribers that can't wait for its next publication. The request
+      /// is an ignition::msgs::Empty message.
+      /// \return Camera info service, or an empty string if the camera info
+      /// topic isn't advertised.
+      public: std::string InfoService() const;
+
+      /// \brief Set how often unchanged camera info is published. Camera
+      /// info is published with the first frame and the first frame after
+      /// every change. Otherwise it is only published once per period, so
+      /// that late subscribers receive it without every frame carrying a
+      /// copy.
+      /// \param[in] _period Period in sensor time, 1 second by default.
+      /// Zero publishes camera info with every frame.
+      /// \sa InfoService()
+      public: void SetInfoPublishPeriod(
+                  const std::chrono::steady_clock::duration &_period);
+
+      /// \brief Get how often unchanged camera info is published.
+      /// \return Period in sensor time.
+      /// \sa SetInfoPublishPeriod()
+      public: std::chrono::steady_clock::duration InfoPublishPeriod() const;
+
       /// \brief Set baseline for stereo cameras. This is used to populate the
       /// projection matrix in the camera info message.
       /// \param[in] _baseline The distance from the 1st camera, in meters.
@@ -146,6 +250,191 @@ namespace ignition
       /// \return The distance from the 1st camera, in meters.
       public: double Baseline() const;
 
+      /// \brief Set the number of frames that can be in flight between
+      /// rendering and readback. With the default depth of 1, every update
+      /// renders a frame and waits for it to be copied back. With a depth of
+      /// N > 1, the sensor renders into a ring of N render targets and each
+      /// update reads back the oldest frame instead, so the copy doesn't wait
+      /// for the frame that was just submitted. Images are then delivered
+      /// N - 1 updates after they were rendered, stamped with the time they
+      /// were rendered at. Frames still in flight when the sensor stops
+      /// generating data, or when the depth changes, are dropped.
+      /// \param[in] _depth Number of frames in flight, between 1 and 4.
+      /// \sa ReadbackDepth
+      public: void SetReadbackDepth(unsigned int _depth);
+
+      /// \brief Get the number of frames that can be in flight between
+      /// rendering and readback.
+      /// \return Readback depth, 1 by default.
+      /// \sa SetReadbackDepth
+      public: unsigned int ReadbackDepth() const;
+
+      /// \brief Adapt the rendered resolution to the measured render time.
+      /// While the render and readback of frames take longer than _budget,
+      /// the camera renders at reduced resolution scales down to
+      /// _minScale, and goes back up once frames fit again. Images are
+      /// scaled back to the requested size, unless _publishScaled is true,
+      /// in which case they are published at the rendered size and
+      /// consumers must scale the camera info intrinsics by
+      /// ResolutionScale(). Frames in flight when the scale changes are
+      /// dropped.
+      /// \param[in] _budget Render time budget of a frame. Zero disables
+      /// adaptive resolution, which is the default.
+      /// \param[in] _minScale Smallest scale, between 0.1 and 1.
+      /// \param[in] _publishScaled True to publish images at the rendered
+      /// size.
+      /// \sa ResolutionScale()
+      public: void SetAdaptiveResolution(
+                  const std::chrono::steady_clock::duration &_budget,
+                  const double _minScale = 0.25,
+                  const bool _publishScaled = false);
+
+      /// \brief Get the render time budget of adaptive resolution.
+      /// \return Budget of a frame, zero if adaptive resolution is
+      /// disabled.
+      /// \sa SetAdaptiveResolution()
+      public: std::chrono::steady_clock::duration
+                  AdaptiveResolutionBudget() const;
+
+      /// \brief Get the scale of the rendered resolution relative to
+      /// ImageWidth() and ImageHeight(). It combines the render quality
+      /// profile and adaptive resolution.
+      /// \return Resolution scale, 1 when rendering at the requested size.
+      /// \sa SetAdaptiveResolution()
+      /// \sa Sensor::SetRenderQuality()
+      public: double ResolutionScale() const;
+
+      /// \brief Publish a compressed copy of every image on CompressedTopic(),
+      /// in addition to or instead of the raw image. The compressed messages
+      /// are ignition::msgs::Image messages whose data is the encoded image,
+      /// and whose header has a "format" entry set to "png" or "jpeg". Their
+      /// step is 0, and their pixel_format_type is the one of the decoded
+      /// image. Encoding runs on background threads, so Update() only copies
+      /// the image. While too many images are being encoded, new ones are not
+      /// compressed.
+      /// \param[in] _compression Encoding, or ImageCompression::NONE to
+      /// disable the compressed output.
+      /// \param[in] _quality JPEG quality between 1 and 100, or PNG
+      /// compression level between 0 and 9. Negative values use the default
+      /// of the encoding, which favors speed.
+      /// \param[in] _publishRaw False to stop publishing raw images on
+      /// Topic(). Image callbacks are still called with raw images.
+      /// \return False if the encoding isn't available in this build, isn't
+      /// supported by this sensor, or the topic couldn't be advertised.
+      public: bool SetCompressedOutput(const ImageCompression _compression,
+                  const int _quality = -1, const bool _publishRaw = true);
+
+      /// \brief Get the encoding of the compressed output.
+      /// \return Encoding, or ImageCompression::NONE if disabled.
+      /// \sa SetCompressedOutput()
+      public: ImageCompression CompressedOutput() const;
+
+      /// \brief Get the topic of the compressed output.
+      /// \return Topic, or an empty string if the output is disabled.
+      /// \sa SetCompressedOutput()
+      public: std::string CompressedTopic() const;
+
+      /// \brief Set the file format of frames saved when the SDF enables
+      /// <save>. Frames are copied in Update() and written to disk by
+      /// background threads. When the disk can't keep up, new frames are
+      /// dropped and counted in SensorStats::droppedSaveCount.
+      /// \param[in] _format File format. FrameFileFormat::PNM is much
+      /// cheaper to write than PNG, at the cost of larger files. Images that
+      /// PNM can't represent are still saved as PNG.
+      public: void SetSaveFileFormat(const FrameFileFormat _format);
+
+      /// \brief Get the file format of saved frames.
+      /// \return File format, FrameFileFormat::PNG by default.
+      /// \sa SetSaveFileFormat()
+      public: FrameFileFormat SaveFileFormat() const;
+
+      /// \brief Add a secondary image stream, published on
+      /// ImageStreamTopic(_name), made from each rendered frame. The stream
+      /// is a region of the frame scaled to another size, for consumers
+      /// that only need a preview or a crop. It is only computed while it
+      /// has subscribers, and doesn't require subscribers on Topic().
+      /// \param[in] _name Name of the stream, used as a subtopic of
+      /// Topic().
+      /// \param[in] _width Width of the stream images.
+      /// \param[in] _height Height of the stream images.
+      /// \param[in] _roiOffset Top left pixel of the region of the frame.
+      /// \param[in] _roiSize Size of the region. Zero uses the frame from
+      /// _roiOffset to its bottom right corner.
+      /// \return False if the name is in use or invalid, the region doesn't
+      /// fit in the frame, this sensor doesn't support image streams, or
+      /// the topic couldn't be advertised.
+      public: bool AddImageStream(const std::string &_name,
+                  const unsigned int _width, const unsigned int _height,
+                  const math::Vector2i &_roiOffset = math::Vector2i::Zero,
+                  const math::Vector2i &_roiSize = math::Vector2i::Zero);
+
+      /// \brief Remove a stream added by AddImageStream().
+      /// \param[in] _name Name of the stream.
+      /// \return False if there is no such stream.
+      public: bool RemoveImageStream(const std::string &_name);
+
+      /// \brief Get the topic of a stream added by AddImageStream().
+      /// \param[in] _name Name of the stream.
+      /// \return Topic, or an empty string if there is no such stream.
+      public: std::string ImageStreamTopic(const std::string &_name) const;
+
+      /// \brief Get whether this sensor can publish compressed images.
+      /// \return True, unless overridden by sensors whose images can't be
+      /// compressed.
+      /// \sa SetCompressedOutput()
+      protected: virtual bool SupportsCompressedOutput() const;
+
+      /// \brief Get whether raw images are published.
+      /// \return False if SetCompressedOutput() disabled raw images.
+      protected: bool PublishRawImages() const;
+
+      /// \brief Queue an image for compressed publishing. Does nothing if
+      /// the compressed output is disabled or has no subscribers.
+      /// \param[in] _msg Raw image.
+      protected: void PublishCompressed(const ignition::msgs::Image &_msg);
+
+      /// \brief Get whether the compressed output has subscribers.
+      /// \return True if there are subscribers.
+      protected: bool HasCompressedConnections() const;
+
+      /// \brief Get whether image view callbacks are connected.
+      /// \return True if ConnectImageViewCallback() has live connections.
+      protected: bool HasImageViewCallbacks() const;
+
+      /// \brief Call the image view callbacks. Does nothing if none are
+      /// connected.
+      /// \param[in] _view View of the image.
+      protected: void DeliverImageView(const ImageView &_view);
+
+      /// \brief Get whether this sensor can publish image streams.
+      /// \return True, unless overridden by sensors whose images aren't
+      /// published by CameraSensor.
+      /// \sa AddImageStream()
+      protected: virtual bool SupportsImageStreams() const;
+
+      /// \brief Start saving frames passed to SaveFrame().
+      /// \param[in] _path Directory to save frames in.
+      /// \param[in] _prefix Prefix of the file names.
+      protected: void EnableSaveFrames(const std::string &_path,
+                     const std::string &_prefix);
+
+      /// \brief Queue a frame to be saved in the background. Does nothing
+      /// unless EnableSaveFrames() was called.
+      /// \param[in] _data Pixel data, which can be reused once this returns.
+      /// \param[in] _width Width in pixels.
+      /// \param[in] _height Height in pixels.
+      /// \param[in] _step Size of a row in bytes, or 0 if rows are packed.
+      /// \param[in] _format Pixel format.
+      /// \return False if saving is disabled or the frame was dropped.
+      protected: bool SaveFrame(const unsigned char *_data,
+                     const unsigned int _width, const unsigned int _height,
+                     const unsigned int _step,
+                     const ignition::msgs::PixelFormatType _format);
+
+      /// \brief Get whether frames are saved.
+      /// \return True if EnableSaveFrames() was called.
+      protected: bool SavesFrames() const;
+
       /// \brief Advertise camera info topic.
       /// \return True if successful.
       protected: bool AdvertiseInfo();
@@ -167,7 +456,8 @@ namespace ignition
       protected: void IGN_DEPRECATED(4) PublishInfo(
         const ignition::common::Time &_now);
 
-      /// \brief Publish camera info message.
+      /// \brief Publish camera info message, if it changed since it was last
+      /// published or InfoPublishPeriod() has elapsed.
       /// \param[in] _now The current time
       protected: void PublishInfo(
         const std::chrono::steady_clock::duration &_now);
@@ -176,6 +466,29 @@ namespace ignition
       /// \return True on success.
       private: bool CreateCamera();
 
+      /// \brief Apply the settings of the camera SDF to the rendering
+      /// camera, setting only what changed.
+      /// \param[in] _cameraSdf Camera SDF
+      /// \return False if the settings are invalid.
+      private: bool ConfigureCamera(const sdf::Camera *_cameraSdf);
+
+      /// \brief Copy the oldest rendered frame to memory, if any. The mutex
+      /// of the sensor must be locked.
+      private: void CopyFrame();
+
+      /// \brief Publish the frame copied by CopyFrame(), if any, and call the
+      /// image callbacks. The mutex of the sensor must be locked.
+      private: void PublishFrame();
+
+      /// \brief Publish the image streams with subscribers.
+      /// \param[in] _data Frame data.
+      /// \param[in] _width Width of the frame.
+      /// \param[in] _height Height of the frame.
+      /// \param[in] _stamp Time at which the frame was rendered.
+      private: void PublishImageStreams(const unsigned char *_data,
+                   const unsigned int _width, const unsigned int _height,
+                   const std::chrono::steady_clock::duration &_stamp);
+
       /// \brief Callback that is triggered when the scene changes on
       /// the Manager.
       /// \param[in] _scene Pointer to the new scene.
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_CPULIDARSENSOR_HH_
+#define IGNITION_SENSORS_CPULIDARSENSOR_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sdf/sdf.hh>
+
+#include <ignition/common/Mesh.hh>
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+
+#include "ignition/sensors/lidar/Export.hh"
+#include "ignition/sensors/Lidar.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class CpuLidarSensorPrivate;
+
+    /// \brief CpuLidar Sensor Class
+    ///
+    ///   This class creates laser scans by casting rays on the CPU, for
+    ///   nodes without a GPU. It measures the range from the origin of the
+    ///   sensor to the meshes given to it by the simulation, since it
+    ///   doesn't use a rendering scene. Sensors of type "lidar" are created
+    ///   with this class.
+    ///
+    ///   A ray is cast for every range of the scans, in parallel, and the
+    ///   scans are filled like those of GpuLidarSensor, so the noise and the
+    ///   published messages are the same.
+    class IGNITION_SENSORS_LIDAR_VISIBLE CpuLidarSensor : public Lidar
+    {
+      /// \brief constructor
+      public: CpuLidarSensor();
+
+      /// \brief destructor
+      public: virtual ~CpuLidarSensor();
+
+      /// \brief Force the sensor to generate data
+      /// \param[in] _now The current time
+      /// \return true if the update was successfull
+      public: virtual bool IGN_DEPRECATED(4) Update(
+        const ignition::common::Time &_now) override;
+
+      /// \brief Force the sensor to generate data
+      /// \param[in] _now The current time
+      /// \return true if the update was successfull
+      public: virtual bool Update(
+        const std::chrono::steady_clock::duration &_now) override;
+
+      /// \brief This sensor doesn't render, so the Manager updates it with
+      /// the other sensors that don't need a rendering context.
+      /// \return False
+      public: bool IsRenderingSensor() const override;
+
+      // Documentation inherited
+      public: SensorMemory MemoryUsage() const override;
+
+      /// \brief Add a triangle mesh to cast rays against, or replace the
+      /// triangles of a mesh already added, keeping its pose.
+      /// \param[in] _name Unique name of the mesh, such as the scoped name
+      /// of its collision
+      /// \param[in] _vertices Vertices, in the frame of the mesh
+      /// \param[in] _indices Three vertex indices per triangle
+      /// \param[in] _retro Retro reflectivity, reported as the intensity
+      /// of the rays that hit the mesh
+      /// \return False if the indices are invalid
+      public: bool SetMesh(const std::string &_name,
+                  const std::vector<ignition::math::Vector3d> &_vertices,
+                  const std::vector<unsigned int> &_indices,
+                  const double _retro = 0.0);
+
+      /// \brief Add the triangles of all the submeshes of a mesh, or
+      /// replace the triangles of a mesh already added, keeping its pose.
+      /// \param[in] _name Unique name of the mesh
+      /// \param[in] _mesh Mesh, such as one of the common::MeshManager
+      /// \param[in] _scale Scale of the mesh
+      /// \param[in] _retro Retro reflectivity of the mesh
+      /// \return False if the mesh has invalid indices
+      public: bool SetMesh(const std::string &_name,
+                  const ignition::common::Mesh &_mesh,
+                  const ignition::math::Vector3d &_scale =
+                      ignition::math::Vector3d::One,
+                  const double _retro = 0.0);
+
+      /// \brief Set the world pose of a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _pose World pose of the mesh
+      /// \return False if there is no mesh with that name
+      public: bool SetMeshPose(const std::string &_name,
+                  const ignition::math::Pose3d &_pose);
+
+      /// \brief Remove a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \return False if there is no mesh with that name
+      public: bool RemoveMesh(const std::string &_name);
+
+      /// \brief Get the number of meshes rays are cast against.
+      /// \return Number of meshes
+      public: std::size_t MeshCount() const;
+
+      /// \brief Set the number of threads casting the rays, including the
+      /// thread updating the sensor. When the Manager updates sensors in
+      /// parallel, the rays of each sensor are cast by a single thread.
+      /// \param[in] _threads Number of threads, 0 for one per core.
+      public: void SetThreadCount(const unsigned int _threads);
+
+      /// \brief Get the number of threads casting the rays.
+      /// \return Number of threads
+      /// \sa SetThreadCount()
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Connect to the scans, before noise is applied. The scans
+      /// have 3 channels per ray: range, intensity and 0.
+      /// \return ignition::common::Connection pointer
+      public: virtual ignition::common::ConnectionPtr ConnectNewLidarFrame(
+          std::function<void(const float *_scan, unsigned int _width,
+                  unsigned int _height, unsigned int _channels,
+                  const std::string &/*_format*/)> _subscriber) override;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Data pointer for private data
+      /// \internal
+      private: std::unique_ptr<CpuLidarSensorPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
@@ -105,6 +105,27 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief This sensor renders and reads back its data in a single
+      /// Update(), so it doesn't support staged updates.
+      /// \return False.
+      public: virtual bool SupportsStagedUpdates() const override;
+
+      // Documentation inherited
+      public: virtual SensorMemory MemoryUsage() const override;
+
+      /// \brief Depth images are floating point, so they can't be compressed
+      /// as PNG or JPEG images.
+      /// \return False.
+      protected: virtual bool SupportsCompressedOutput() const override;
+
+      /// \brief Depth images are floating point, while image streams are
+      /// made from 8 bit color images.
+      /// \return False.
+      protected: virtual bool SupportsImageStreams() const override;
+
       /// \brief Force the sensor to generate data
       /// \param[in] _now The current time
       /// \return true if the update was successfull
@@ -165,6 +186,89 @@ namespace ignition
       /// \return height of the image
       public: virtual double NearClip() const;
 
+      /// \brief Set the unit of the published depth images. By default
+      /// depths are published as 32 bit floats in meters. With a positive
+      /// unit they are published as 16 bit unsigned integers
+      /// (msgs::PixelFormatType::L_INT16) in multiples of the unit, e.g.
+      /// 0.001 for millimeters as published by many depth cameras, which
+      /// halves the size of the images. Depths that can't be represented,
+      /// including clipped depths, are 0. The unit can also be set with
+      /// the <ignition:depth_unit> element of the sensor.
+      /// \param[in] _unit Meters per unit, or 0 for floating point depths.
+      public: void SetDepthUnit(const double _unit);
+
+      /// \brief Get the unit of the published depth images.
+      /// \return Meters per unit, or 0 for floating point depths.
+      /// \sa SetDepthUnit()
+      public: double DepthUnit() const;
+
+      /// \brief Set whether the published point clouds are dense. Dense
+      /// point clouds only hold the points whose position is finite, so
+      /// the points of pixels beyond the clipping distances aren't
+      /// published. They are unorganized, with a height of 1. Dense point
+      /// clouds can also be enabled with the <ignition:dense_point_cloud>
+      /// element of the sensor.
+      /// \param[in] _dense True to publish dense point clouds.
+      public: void SetDensePointCloud(const bool _dense);
+
+      /// \brief Get whether the published point clouds are dense.
+      /// \return True if only finite points are published.
+      /// \sa SetDensePointCloud()
+      public: bool DensePointCloud() const;
+
+      /// \brief Set the stride of the point cloud decimation. Only every
+      /// n-th point of every n-th row of the published point clouds is
+      /// kept, which keeps them organized. The stride can also be set with
+      /// the <ignition:point_cloud_stride> element of the sensor.
+      /// \param[in] _stride Stride, 0 or 1 to publish every point.
+      public: void SetPointCloudStride(const unsigned int _stride);
+
+      /// \brief Get the stride of the point cloud decimation.
+      /// \return Stride, 1 if every point is published.
+      /// \sa SetPointCloudStride()
+      public: unsigned int PointCloudStride() const;
+
+      /// \brief Set the edge length of the voxel grid applied to the
+      /// published point clouds, after the decimation. Each voxel is
+      /// replaced by the centroid of its finite points, so the published
+      /// clouds are unorganized. The size can also be set with the
+      /// <ignition:voxel_leaf_size> element of the sensor.
+      /// \param[in] _leafSize Edge length in meters, 0 to disable it.
+      public: void SetVoxelLeafSize(const double _leafSize);
+
+      /// \brief Get the edge length of the voxel grid.
+      /// \return Edge length in meters, 0 if it is disabled.
+      /// \sa SetVoxelLeafSize()
+      public: double VoxelLeafSize() const;
+
+      /// \brief Set the resolution of the coordinates of the published
+      /// point clouds. With a positive resolution x, y and z are published
+      /// as 16 bit integers (INT16 fields) in multiples of it, e.g. 0.001
+      /// for millimeters within 32.767 meters, and the header of the
+      /// point clouds has an "xyz_resolution" entry. Points are packed
+      /// without padding. The resolution can also be set with the
+      /// <ignition:point_cloud_resolution> element of the sensor.
+      /// \param[in] _resolution Meters per unit, or 0 for floats.
+      public: void SetPointCloudResolution(const double _resolution);
+
+      /// \brief Get the resolution of the published coordinates.
+      /// \return Meters per unit, or 0 for floats.
+      /// \sa SetPointCloudResolution()
+      public: double PointCloudResolution() const;
+
+      /// \brief Set whether the data of the published point clouds is
+      /// deflated with zlib. Compressed point clouds have a "compression"
+      /// header entry set to "zlib". Compression can also be enabled with
+      /// the <ignition:point_cloud_compression> element of the sensor.
+      /// \param[in] _compress True to compress point clouds.
+      /// \return False if zlib isn't available in this build.
+      public: bool SetPointCloudCompression(const bool _compress);
+
+      /// \brief Get whether the published point clouds are compressed.
+      /// \return True if their data is deflated.
+      /// \sa SetPointCloudCompression()
+      public: bool PointCloudCompression() const;
+
       /// \brief Create a camera in a scene
       /// \return True on success.
       private: bool CreateCamera();
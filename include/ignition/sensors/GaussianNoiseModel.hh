@@ -52,6 +52,42 @@ namespace ignition
       // Documentation inherited.
       public: double ApplyImpl(double _in, double _dt) override;
 
+      // Documentation inherited.
+      public: void ApplyBatchImpl(double *_values, std::size_t _count,
+          double _dt, std::size_t _stride) override;
+
+      // Documentation inherited.
+      public: void ApplyBatchImpl(float *_values, std::size_t _count,
+          double _dt, std::size_t _stride) override;
+
+      /// \brief Restart the random stream of this model from a seed. The
+      /// bias is sampled again from the new stream.
+      /// \param[in] _seed Seed of the stream.
+      public: void SetSeed(std::uint64_t _seed) override;
+
+      // Documentation inherited.
+      public: NoisePtr Fork(std::uint64_t _seed) const override;
+
+      /// \brief Enable or disable table mode. In table mode, noise is not
+      /// drawn from the random stream but looked up in a table of
+      /// precomputed normally distributed samples, which costs one load and
+      /// one add per value. The table is walked through with a randomly
+      /// chosen offset and step that change every time the whole table has
+      /// been used, so sequences repeat only in pieces. This is meant for
+      /// data that only needs to be statistically plausible. Table mode can
+      /// also be enabled from SDF with an <ignition:noise_table_size>
+      /// element inside <noise>.
+      /// \param[in] _size Number of samples in the table, rounded up to a
+      /// power of two. Use 0 to draw every value from the random stream,
+      /// which is the default.
+      /// \sa TableSize()
+      public: void SetTableSize(std::size_t _size);
+
+      /// \brief Get the number of samples in the table of table mode.
+      /// \return Table size, or 0 if table mode is disabled.
+      /// \sa SetTableSize()
+      public: std::size_t TableSize() const;
+
       /// \brief Accessor for mean.
       /// \return Mean of Gaussian noise.
       public: double Mean() const;
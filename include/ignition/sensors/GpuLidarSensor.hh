@@ -17,6 +17,8 @@
 #ifndef IGNITION_SENSORS_GPULIDARSENSOR_HH_
 #define IGNITION_SENSORS_GPULIDARSENSOR_HH_
 
+#include <chrono>
+#include <cstddef>
 #include <memory>
 #include <string>
 
@@ -35,6 +37,16 @@
 #pragma warning(pop)
 #endif
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/pointcloud_packed.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
 #include "ignition/sensors/gpu_lidar/Export.hh"
 #include "ignition/sensors/RenderingEvents.hh"
 #include "ignition/sensors/Lidar.hh"
@@ -78,6 +90,12 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      // Documentation inherited
+      public: virtual SensorMemory MemoryUsage() const override;
+
       /// \brief Initialize values in the sensor
       /// \return True on success
       public: virtual bool Init() override;
@@ -95,6 +113,10 @@ namespace ignition
       /// \brief Create Lidar sensor
       public: virtual bool CreateLidar() override;
 
+      // Documentation inherited
+      public: virtual void SetSweepSectors(const unsigned int _sectors)
+                  override;
+
       /// \brief Gets if sensor is horizontal
       /// \return True if horizontal, false if not
       public: bool IsHorizontal() const;
@@ -127,6 +149,114 @@ namespace ignition
       /// \return Vertical field of view.
       public: ignition::math::Angle VFOV() const;
 
+      /// \brief Set the stride of the point cloud decimation. Only every
+      /// n-th point of every n-th row of the published point clouds is
+      /// kept, which keeps them organized. The stride can also be set with
+      /// the <ignition:point_cloud_stride> element of the sensor.
+      /// \param[in] _stride Stride, 0 or 1 to publish every point.
+      public: void SetPointCloudStride(const unsigned int _stride);
+
+      /// \brief Get the stride of the point cloud decimation.
+      /// \return Stride, 1 if every point is published.
+      /// \sa SetPointCloudStride()
+      public: unsigned int PointCloudStride() const;
+
+      /// \brief Set the edge length of the voxel grid applied to the
+      /// published point clouds, after the decimation. Each voxel is
+      /// replaced by the centroid of its finite points, so the published
+      /// clouds are unorganized. The size can also be set with the
+      /// <ignition:voxel_leaf_size> element of the sensor.
+      /// \param[in] _leafSize Edge length in meters, 0 to disable it.
+      public: void SetVoxelLeafSize(const double _leafSize);
+
+      /// \brief Get the edge length of the voxel grid.
+      /// \return Edge length in meters, 0 if it is disabled.
+      /// \sa SetVoxelLeafSize()
+      public: double VoxelLeafSize() const;
+
+      /// \brief Set the resolution of the coordinates of the published
+      /// point clouds. With a positive resolution x, y and z are published
+      /// as 16 bit integers (INT16 fields) in multiples of it, e.g. 0.001
+      /// for millimeters within 32.767 meters, and the header of the
+      /// point clouds has an "xyz_resolution" entry. Points are packed
+      /// without padding. The resolution can also be set with the
+      /// <ignition:point_cloud_resolution> element of the sensor.
+      /// \param[in] _resolution Meters per unit, or 0 for floats.
+      public: void SetPointCloudResolution(const double _resolution);
+
+      /// \brief Get the resolution of the published coordinates.
+      /// \return Meters per unit, or 0 for floats.
+      /// \sa SetPointCloudResolution()
+      public: double PointCloudResolution() const;
+
+      /// \brief Set whether the data of the published point clouds is
+      /// deflated with zlib. Compressed point clouds have a "compression"
+      /// header entry set to "zlib". Compression can also be enabled with
+      /// the <ignition:point_cloud_compression> element of the sensor.
+      /// \param[in] _compress True to compress point clouds.
+      /// \return False if zlib isn't available in this build.
+      public: bool SetPointCloudCompression(const bool _compress);
+
+      /// \brief Get whether the published point clouds are compressed.
+      /// \return True if their data is deflated.
+      /// \sa SetPointCloudCompression()
+      public: bool PointCloudCompression() const;
+
+      /// \brief Set the number of rows of the chunks the point clouds are
+      /// published in. Each chunk is an organized point cloud of
+      /// consecutive rows, published as soon as it's packed, so consumers
+      /// can start on the first rows before the whole cloud is serialized,
+      /// and only a chunk is held in memory. The chunks of a point cloud
+      /// share its stamp and have "scan_id", "chunk", "chunk_count" and
+      /// "first_row" header entries. Decimation, voxel filtering and
+      /// encoding are applied to each chunk, so the rows per chunk should
+      /// be a multiple of the decimation stride. The rows can also be set
+      /// with the <ignition:point_cloud_chunk_rows> element of the sensor.
+      /// \param[in] _rows Rows per chunk, 0 to publish whole point clouds.
+      public: void SetPointCloudChunkRows(const unsigned int _rows);
+
+      /// \brief Get the number of rows of the point cloud chunks.
+      /// \return Rows per chunk, 0 if point clouds are published whole.
+      /// \sa SetPointCloudChunkRows()
+      public: unsigned int PointCloudChunkRows() const;
+
+      /// \brief Set when the point clouds are produced. Skipped point
+      /// clouds aren't packed, filtered nor published. Together with
+      /// SetScanOutput(), a sensor can produce only the output its
+      /// consumers use. The mode can also be set with the
+      /// <ignition:point_cloud_output> element of the sensor, to "auto",
+      /// "enabled" or "disabled". Defaults to AUTO.
+      /// \param[in] _mode When the point clouds are produced
+      public: void SetPointCloudOutput(const LidarOutputMode _mode);
+
+      /// \brief Get when the point clouds are produced.
+      /// \return When the point clouds are produced
+      /// \sa SetPointCloudOutput()
+      public: LidarOutputMode PointCloudOutput() const;
+
+      /// \brief Set the group of lidars this lidar shares its render with.
+      /// The first lidar of a group in a scene renders for the whole
+      /// group, and the others sample their own rays from its scan,
+      /// measuring ranges from their own origin. A lidar joins a group if
+      /// it has the same parent, is mounted within 10 cm of the first
+      /// lidar, and its rays and range limits are covered by the render of
+      /// the first lidar. Otherwise it renders alone. The group can also
+      /// be set with the <ignition:shared_rays> element of the sensor.
+      /// It takes effect when the lidar is created.
+      /// \param[in] _group Name of the group, empty to render alone.
+      public: void SetSharedRaysGroup(const std::string &_group);
+
+      /// \brief Get the group of lidars this lidar shares its render with.
+      /// \return Name of the group, empty if it renders alone.
+      /// \sa SetSharedRaysGroup()
+      public: std::string SharedRaysGroup() const;
+
+      /// \brief Get whether this lidar samples its scan from the render of
+      /// another lidar. GpuRays() and ConnectNewLidarFrame() then refer to
+      /// that render.
+      /// \return True if the lidar joined the render of another lidar.
+      public: bool SharesRays() const;
+
       /// \brief Connect function pointer to internal GpuRays callback
       /// \return ignition::common::Connection pointer
       public: virtual ignition::common::ConnectionPtr ConnectNewLidarFrame(
@@ -134,6 +264,50 @@ namespace ignition
                   unsigned int _heighti, unsigned int _channels,
                   const std::string &/*_format*/)> _subscriber) override;
 
+      /// \brief Publish the point cloud of the laser buffer in chunks of
+      /// rows.
+      /// \param[in] _now Current time
+      private: void PublishPointCloudChunks(
+                   const std::chrono::steady_clock::duration &_now);
+
+      /// \brief Filter, encode and publish a point cloud or a chunk of it.
+      /// \param[in] _cloud Point cloud
+      /// \param[in] _messageStart Time the message started being built
+      private: void PublishPointCloud(msgs::PointCloudPacked &_cloud,
+                   const std::chrono::steady_clock::time_point &_messageStart);
+
+      /// \brief Create the rendering sensors of the sectors of the sweep.
+      /// On failure, whole sweeps are rendered.
+      /// \param[in] _sectors Number of sectors
+      private: void CreateSweepSectors(const unsigned int _sectors);
+
+      /// \brief Destroy the rendering sensors of the sectors and create
+      /// them again for SweepSectors(). Lidars that share their rays fall
+      /// back to whole sweeps.
+      private: void ResetSweepSectors();
+
+      /// \brief Render a sector of the sweep and copy it in its columns of
+      /// the laser buffer.
+      /// \param[in] _sector Index of the sector
+      /// \param[in] _firstColumn First column of the sector
+      /// \param[in] _columns Number of columns of the sector
+      private: void UpdateSweepSector(const unsigned int _sector,
+                   const unsigned int _firstColumn,
+                   const unsigned int _columns);
+
+      /// \brief Join the render of the group of this lidar, if another
+      /// lidar created it and it covers the rays of this lidar.
+      /// \return True if the lidar joined the render.
+      private: bool JoinSharedRays();
+
+      /// \brief Get the scan of this lidar from the render of its group,
+      /// rendering it if no other lidar did at this time.
+      /// \param[in] _now Current time
+      /// \param[in] _renderSize Number of floats of the render
+      private: void UpdateSharedRays(
+                   const std::chrono::steady_clock::duration &_now,
+                   const std::size_t _renderSize);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Data pointer for private data
       /// \internal
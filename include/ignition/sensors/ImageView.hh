@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_IMAGEVIEW_HH_
+#define IGNITION_SENSORS_IMAGEVIEW_HH_
+
+#include <chrono>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/image.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include "ignition/sensors/config.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Read-only view of an image produced by a sensor, passed to
+    /// in-process callbacks instead of an ignition::msgs::Image so the
+    /// pixels aren't copied into a message. The pixels belong to the
+    /// sensor and are only valid during the callback; copy them to keep
+    /// them.
+    /// \sa CameraSensor::ConnectImageViewCallback()
+    class ImageView
+    {
+      /// \brief The first row of pixels, laid out as in an
+      /// ignition::msgs::Image of the same format.
+      public: const unsigned char *data = nullptr;
+
+      /// \brief Width of the image in pixels.
+      public: unsigned int width = 0u;
+
+      /// \brief Height of the image in pixels.
+      public: unsigned int height = 0u;
+
+      /// \brief Size of a row in bytes.
+      public: unsigned int step = 0u;
+
+      /// \brief Format of the pixels.
+      public: msgs::PixelFormatType format =
+                  msgs::PixelFormatType::UNKNOWN_PIXEL_FORMAT;
+
+      /// \brief Simulation time the image was rendered at.
+      public: std::chrono::steady_clock::duration stamp{
+                  std::chrono::steady_clock::duration::zero()};
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_IMUBATCH_HH_
+#define IGNITION_SENSORS_IMUBATCH_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Quaternion.hh>
+#include <ignition/math/Vector3.hh>
+
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/imu/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class ImuBatchPrivate;
+    class ImuSensor;
+
+    /// \brief Updates many IMU sensors together.
+    ///
+    /// The states of the IMUs are kept in contiguous arrays, one per
+    /// component, and the gravity in the frame of every IMU and its
+    /// orientation relative to its reference are computed with a single
+    /// loop over the arrays that the compiler can vectorize. The sensors
+    /// only apply their noise and generate their messages afterwards, and
+    /// only the sensors that are due are visited. Sensors nobody consumes
+    /// don't build messages.
+    ///
+    /// The batch doesn't own the sensors, which must outlive it or be
+    /// removed from it. Their poses, velocities and accelerations are set
+    /// on the batch instead of the sensors, and their orientation
+    /// references and gravity are copied when they are added. Call Update()
+    /// before Manager::RunOnce() with the same time, the sensors it updated
+    /// are then no longer due when the Manager reaches them.
+    class IGNITION_SENSORS_IMU_VISIBLE ImuBatch
+    {
+      /// \brief Constructor
+      public: ImuBatch();
+
+      /// \brief Destructor
+      public: ~ImuBatch();
+
+      /// \brief Add a sensor, with its current state.
+      /// \param[in] _sensor Sensor to add
+      /// \return Index of the sensor in the batch, or SensorCount() if the
+      /// sensor is null or already in the batch.
+      public: std::size_t AddSensor(ImuSensor *_sensor);
+
+      /// \brief Remove a sensor. The last sensor of the batch takes its
+      /// index.
+      /// \param[in] _sensor Sensor to remove
+      /// \return False if the sensor isn't in the batch.
+      public: bool RemoveSensor(const ImuSensor *_sensor);
+
+      /// \brief Get the number of sensors.
+      /// \return Number of sensors in the batch
+      public: std::size_t SensorCount() const;
+
+      /// \brief Get a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \return The sensor, or null if the index is out of bounds.
+      public: ImuSensor *SensorByIndex(const std::size_t _index) const;
+
+      /// \brief Set the world pose of a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \param[in] _pose Pose in world frame
+      public: void SetWorldPose(const std::size_t _index,
+                  const math::Pose3d &_pose);
+
+      /// \brief Set the angular velocity of a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \param[in] _angularVel Angular velocity in body frame, in radians
+      /// per second
+      public: void SetAngularVelocity(const std::size_t _index,
+                  const math::Vector3d &_angularVel);
+
+      /// \brief Set the linear acceleration of a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \param[in] _linearAcc Linear acceleration in body frame, in meters
+      /// per second squared
+      public: void SetLinearAcceleration(const std::size_t _index,
+                  const math::Vector3d &_linearAcc);
+
+      /// \brief Set the states of all the sensors at once, from arrays in
+      /// the order of the sensors, such as the buffers of a physics engine.
+      /// \param[in] _poses 7 values per sensor: the position (x, y, z) and
+      /// the orientation (w, x, y, z) in world frame.
+      /// \param[in] _angularVel 3 values per sensor, in body frame
+      /// \param[in] _linearAcc 3 values per sensor, in body frame
+      public: void SetStates(const double *_poses, const double *_angularVel,
+                  const double *_linearAcc);
+
+      /// \brief Set the orientation reference of a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \param[in] _orient Reference orientation
+      /// \sa ImuSensor::SetOrientationReference()
+      public: void SetOrientationReference(const std::size_t _index,
+                  const math::Quaterniond &_orient);
+
+      /// \brief Set the gravity of all the sensors.
+      /// \param[in] _gravity Gravity vector in meters per second squared
+      public: void SetGravity(const math::Vector3d &_gravity);
+
+      /// \brief Update the sensors that are due.
+      /// \param[in] _now The current time
+      /// \return Number of sensors that were updated
+      public: std::size_t Update(
+                  const std::chrono::steady_clock::duration &_now);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Data pointer for private data
+      /// \internal
+      private: std::unique_ptr<ImuBatchPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
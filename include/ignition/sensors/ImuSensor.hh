@@ -17,10 +17,23 @@
 #ifndef IGNITION_SENSORS_IMUSENSOR_HH_
 #define IGNITION_SENSORS_IMUSENSOR_HH_
 
+#include <functional>
 #include <memory>
+#include <vector>
 
 #include <sdf/sdf.hh>
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/imu.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/Event.hh>
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
 #include <ignition/math/Pose3.hh>
@@ -78,6 +91,62 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief Publish a recorded message, and call the data callbacks
+      /// with the messages of the main topic.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      /// \sa Manager::SetReplay()
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg) override;
+
+      /// \brief Connect a callback that is called with every new IMU
+      /// message, from the thread that updates the sensor. In-process
+      /// consumers can use this instead of subscribing to the topic, which
+      /// avoids serialization. Messages are only published when the topic
+      /// has subscribers.
+      /// \param[in] _callback Function to call with the message.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      public: ignition::common::ConnectionPtr ConnectDataCallback(
+                  std::function<
+                  void(const ignition::msgs::IMU &)> _callback);
+
+      /// \brief Set the number of samples that are published together.
+      /// With a batch size larger than one, the sensor stops publishing on
+      /// its topic and instead publishes every batch as a single
+      /// ignition::msgs::Double_V message on "<topic>/batch", and passes it
+      /// to the callbacks connected with ConnectBatchCallback(). Each sample
+      /// in the Double_V message consists of 11 values: the time stamp in
+      /// seconds, the orientation (w, x, y, z), the angular velocity
+      /// (x, y, z) and the linear acceleration (x, y, z). Callbacks
+      /// connected with ConnectDataCallback() still receive every sample.
+      /// Changing the batch size discards a partial batch.
+      /// \param[in] _size Number of samples per batch. Zero is treated as
+      /// one, which disables batching.
+      /// \return False if the sensor hasn't been loaded or the batch topic
+      /// couldn't be advertised.
+      public: bool SetBatchSize(const unsigned int _size);
+
+      /// \brief Get the number of samples that are published together.
+      /// \return Batch size, one if batching is disabled.
+      /// \sa SetBatchSize()
+      public: unsigned int BatchSize() const;
+
+      /// \brief Connect a callback that is called with every full batch of
+      /// samples, from the thread that updates the sensor.
+      /// \param[in] _callback Function to call with the samples of the
+      /// batch, oldest first.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      /// \sa SetBatchSize()
+      public: ignition::common::ConnectionPtr ConnectBatchCallback(
+                  std::function<
+                  void(const std::vector<ignition::msgs::IMU> &)> _callback);
+
       /// \brief Set the angular velocity of the imu
       /// \param[in] _angularVel Angular velocity of the imu in body frame
       /// expressed in radians per second
@@ -129,6 +198,28 @@ namespace ignition
       /// \return Gravity vectory in meters per second squared.
       public: math::Vector3d Gravity() const;
 
+      /// \brief Publish the current batch and trigger batch callbacks.
+      /// \param[in] _now Time of the last sample of the batch.
+      private: void PublishBatch(
+                   const std::chrono::steady_clock::duration &_now);
+
+      /// \brief Set the state of the next update, computed by an ImuBatch.
+      /// \param[in] _now Time of the update
+      /// \param[in] _pose World pose
+      /// \param[in] _angularVel Angular velocity in body frame
+      /// \param[in] _linearAcc Linear acceleration in body frame, without
+      /// gravity
+      /// \param[in] _orientation Orientation relative to the reference
+      private: void SetBatchState(
+                   const std::chrono::steady_clock::duration &_now,
+                   const math::Pose3d &_pose,
+                   const math::Vector3d &_angularVel,
+                   const math::Vector3d &_linearAcc,
+                   const math::Quaterniond &_orientation);
+
+      /// \brief The batch sets the states of its sensors
+      friend class ImuBatch;
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Data pointer for private data
       /// \internal
@@ -21,6 +21,16 @@
 #include <string>
 #include <vector>
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/laserscan.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Event.hh>
 
@@ -37,6 +47,23 @@ namespace ignition
     /// \brief forward declarations
     class LidarPrivate;
 
+    /// \brief When a lidar produces one of its outputs, such as the laser
+    /// scan or the point cloud.
+    /// \sa Lidar::SetScanOutput()
+    enum class LidarOutputMode : int
+    {
+      /// \brief Only when the topic of the output has subscribers, or the
+      /// sensor is recorded.
+      AUTO = 0,
+
+      /// \brief On every update, even without subscribers.
+      ENABLED = 1,
+
+      /// \brief Never. Subscribers to the output don't make a lazy sensor
+      /// update.
+      DISABLED = 2
+    };
+
     /// \brief Lidar Sensor Class
     ///
     ///   This class creates laser scans using. It's measures the range
@@ -66,6 +93,12 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      // Documentation inherited
+      public: virtual SensorMemory MemoryUsage() const override;
+
       /// \brief Publish LaserScan message
       /// \param[in] _now The current time
       /// \return true if the update was successfull
@@ -74,15 +107,138 @@ namespace ignition
 
       /// \brief Apply noise to the laser buffer, if noise has been
       /// configured. This should be called before PublishLidarScan if you
-      /// want the scan data to contain noise.
+      /// want the scan data to contain noise. Large scans are split into
+      /// fixed groups of rows, each drawing from its own random stream, so
+      /// the result doesn't depend on the number of threads, see
+      /// SetNoiseThreadCount().
       public: void ApplyNoise();
 
+      /// \brief Set the number of threads applying noise to the groups of
+      /// rows of large scans, including the thread updating the sensor.
+      /// When the Manager updates sensors in parallel, keep 1 so that
+      /// sensors don't oversubscribe the cores. It can also be set with the
+      /// <ignition:noise_threads> element of the sensor. Defaults to 1.
+      /// \param[in] _threads Number of threads, 0 for one per core.
+      public: void SetNoiseThreadCount(const unsigned int _threads);
+
+      /// \brief Get the number of threads applying noise.
+      /// \return Number of threads
+      /// \sa SetNoiseThreadCount()
+      public: unsigned int NoiseThreadCount() const;
+
       /// \brief Publish LaserScan message
       /// \param[in] _now The current time
       /// \return true if the update was successfull
       public: virtual bool PublishLidarScan(
         const std::chrono::steady_clock::duration &_now);
 
+      /// \brief Set when the laser scans are produced. Skipped scans cost
+      /// nothing: the ranges aren't converted, nothing is published, and
+      /// Range(), Ranges() and LaserScanSnapshot() keep the latest scan
+      /// produced. For example, a sensor only used for its point cloud
+      /// can disable the scans. The mode can also be set with the
+      /// <ignition:scan_output> element of the sensor, to "auto",
+      /// "enabled" or "disabled". Defaults to ENABLED, so that Range()
+      /// follows every update.
+      /// \param[in] _mode When the laser scans are produced
+      public: void SetScanOutput(const LidarOutputMode _mode);
+
+      /// \brief Get when the laser scans are produced.
+      /// \return When the laser scans are produced
+      /// \sa SetScanOutput()
+      public: LidarOutputMode ScanOutput() const;
+
+      /// \brief Set when compact scans are published on the
+      /// "<scan topic>/packed" topic, as an ignition::msgs::PointCloudPacked
+      /// with one row per vertical ray and one point per range. Each point
+      /// has an unsigned "range" field in multiples of
+      /// PackedRangeResolution(), UINT16 if RangeMax() fits and UINT32
+      /// otherwise, and an unsigned "intensity" field unless
+      /// SetPackedIntensityBits() is 0. That is 2 to 6 bytes per range
+      /// instead of 16 for the doubles of a laser scan. The header has
+      /// "range_resolution", "range_min", "range_max", "angle_min",
+      /// "angle_max", "vertical_angle_min" and "vertical_angle_max"
+      /// entries. The ranges are the same as the laser scan's, noise
+      /// included. NaN ranges are RangeMax(), positive infinity is the
+      /// largest value of the field, and other ranges are rounded and
+      /// clamped below it. Sweeps with sectors are packed once complete.
+      /// The mode can also be set with the <ignition:packed_output>
+      /// element of the sensor. Defaults to DISABLED.
+      /// \param[in] _mode When the compact scans are published
+      public: void SetPackedOutput(const LidarOutputMode _mode);
+
+      /// \brief Get when the compact scans are published.
+      /// \return When the compact scans are published
+      /// \sa SetPackedOutput()
+      public: LidarOutputMode PackedOutput() const;
+
+      /// \brief Set the size of the intensities of compact scans. They are
+      /// rounded to integers, like the laser retro values of the models
+      /// usually are, and clamped to the range of the field. It can also be
+      /// set with the <ignition:packed_intensity_bits> element of the
+      /// sensor. Defaults to 8.
+      /// \param[in] _bits 8 or 16, or 0 to leave the intensities out.
+      /// \return False if _bits isn't supported.
+      /// \sa SetPackedOutput()
+      public: bool SetPackedIntensityBits(const unsigned int _bits);
+
+      /// \brief Get the size of the intensities of compact scans.
+      /// \return Bits per intensity, 0 without intensities.
+      public: unsigned int PackedIntensityBits() const;
+
+      /// \brief Get the meters per unit of the ranges of compact scans.
+      /// \return RangeResolution() if set, otherwise a millimeter.
+      /// \sa SetPackedOutput()
+      public: double PackedRangeResolution() const;
+
+      /// \brief Set the number of azimuth sectors of a rotating sweep. With
+      /// more than one sector, each update only scans the next sector, as
+      /// the real sensor would in that time, and publishes it on the scan
+      /// topic with the angle limits of the sector. The update rate is
+      /// multiplied by the number of sectors so that whole sweeps keep
+      /// their rate, and every completed sweep is published on the
+      /// "<scan topic>/full" topic. This spreads the rendering over the
+      /// revolution and distorts scans taken while moving like a real
+      /// spinning lidar. The sectors can also be set with the
+      /// <ignition:sweep_sectors> element of the sensor. Sensors that can't
+      /// scan sectors fall back to whole sweeps, with SweepSectors() back
+      /// to 1 and the update rate they had without sectors.
+      /// \param[in] _sectors Number of sectors, 0 or 1 to scan the whole
+      /// sweep at once.
+      public: virtual void SetSweepSectors(const unsigned int _sectors);
+
+      /// \brief Get the number of azimuth sectors of the sweep.
+      /// \return Number of sectors, with at least two range columns each.
+      /// 1 if the whole sweep is scanned at once.
+      /// \sa SetSweepSectors()
+      public: unsigned int SweepSectors() const;
+
+      /// \brief Get the range columns of a sector of the sweep.
+      /// \param[in] _sector Index of the sector, from the minimum angle.
+      /// \param[out] _first First column of the sector.
+      /// \param[out] _columns Number of columns of the sector, 0 if
+      /// _sector is out of range.
+      public: void SweepSectorColumns(const unsigned int _sector,
+                  unsigned int &_first, unsigned int &_columns) const;
+
+      /// \brief Apply noise to some columns of the laser buffer, such as
+      /// a freshly scanned sector of the sweep.
+      /// \param[in] _firstColumn First column.
+      /// \param[in] _columns Number of columns.
+      public: void ApplyNoise(const unsigned int _firstColumn,
+                  const unsigned int _columns);
+
+      /// \brief Publish a sector of the sweep from the laser buffer. The
+      /// whole sweep is also published on the full scan topic, and becomes
+      /// the latest scan, with its last sector.
+      /// \param[in] _now The current time
+      /// \param[in] _sector Index of the sector
+      /// \return False if the buffer isn't allocated or _sector is out of
+      /// range.
+      public: bool PublishLidarSector(
+                  const std::chrono::steady_clock::duration &_now,
+                  const unsigned int _sector);
+
       /// \brief Load the sensor based on data from an sdf::Sensor object.
       /// \param[in] _sdf SDF Sensor parameters.
       /// \return true if loading was successful
@@ -195,6 +351,15 @@ namespace ignition
       /// \param[out] _range A vector that will contain all the range data
       public: void Ranges(std::vector<double> &_ranges) const;
 
+      /// \brief Get the latest scan without copying it. This doesn't wait
+      /// for an update in progress, so it's cheap to call from other threads
+      /// at a high rate. Unlike Range() called in a loop, all values of the
+      /// snapshot come from the same scan. The snapshot never changes, and
+      /// stays valid for as long as it's held.
+      /// \return The latest scan, or nullptr before the first update.
+      public: std::shared_ptr<const ignition::msgs::LaserScan>
+                  LaserScanSnapshot() const;
+
       /// \brief Get detected retro (intensity) value for a ray.
       ///         Warning: If you are accessing all the ray data in a loop
       ///         it's possible that the Ray will update in the middle of
@@ -271,6 +436,30 @@ namespace ignition
                   unsigned int _heighti, unsigned int _channels,
                   const std::string &/*_format*/)> _subscriber);
 
+      /// \brief Read the output mode of an element of the sensor.
+      /// \param[in] _sdf SDF of the sensor, may be null
+      /// \param[in] _element Name of the element, such as
+      /// "ignition:scan_output"
+      /// \param[in,out] _mode Mode read, unchanged if the element is
+      /// missing or unknown
+      protected: void LoadOutputMode(const sdf::ElementPtr &_sdf,
+                     const std::string &_element,
+                     LidarOutputMode &_mode) const;
+
+      /// \brief Check whether an output in some mode is produced now.
+      /// \param[in] _mode Mode of the output
+      /// \param[in] _pub Publisher of the output
+      /// \return True if the output is produced.
+      protected: bool OutputActive(const LidarOutputMode _mode,
+                     const transport::Node::Publisher &_pub) const;
+
+      /// \brief Publish the whole laser buffer as a compact scan. Call with
+      /// lidarMutex locked.
+      /// \param[in] _now The current time
+      /// \sa SetPackedOutput()
+      private: void PublishPackedScan(
+                   const std::chrono::steady_clock::duration &_now);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Data pointer for private data
       /// \internal
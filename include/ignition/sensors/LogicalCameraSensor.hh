@@ -17,12 +17,14 @@
 #ifndef IGNITION_SENSORS_LOGICALCAMERASENSOR_HH_
 #define IGNITION_SENSORS_LOGICALCAMERASENSOR_HH_
 
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
 
 #include <sdf/sdf.hh>
 
+#include <ignition/common/Event.hh>
 #include <ignition/common/PluginMacros.hh>
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
@@ -42,6 +44,7 @@
 #include "ignition/sensors/config.hh"
 #include "ignition/sensors/Export.hh"
 #include "ignition/sensors/logical_camera/Export.hh"
+#include "ignition/sensors/ModelPoseSnapshot.hh"
 #include "ignition/sensors/Sensor.hh"
 
 namespace ignition
@@ -89,6 +92,30 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief Publish a recorded message, and call the data callbacks
+      /// with the messages of the main topic.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      /// \sa Manager::SetReplay()
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg) override;
+
+      /// \brief Connect a callback that is called with every new logical camera
+      /// message, from the thread that updates the sensor. In-process
+      /// consumers can use this instead of subscribing to the topic, which
+      /// avoids serialization. Messages are only published when the topic
+      /// has subscribers.
+      /// \param[in] _callback Function to call with the message.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      public: ignition::common::ConnectionPtr ConnectDataCallback(
+                  std::function<
+                  void(const ignition::msgs::LogicalCameraImage &)> _callback);
+
       /// \brief Get the near distance. This is the distance from the
       /// frustum's vertex to the closest plane.
       /// \return Near distance.
@@ -99,10 +126,20 @@ namespace ignition
       /// \return Far distance.
       public: double Far() const;
 
-      /// \brief Set the models currently in the world
+      /// \brief Set the models currently in the world. This replaces any
+      /// snapshot set with SetModelPoseSnapshot().
       /// \param[in] _models A map of model names to their world pose.
       public: void SetModelPoses(std::map<std::string, math::Pose3d> &&_models);
 
+      /// \brief Set the models currently in the world from a snapshot
+      /// shared with other sensors. This replaces any models set with
+      /// SetModelPoses(), and is cheaper when many logical cameras see the
+      /// same world, since it doesn't copy any pose.
+      /// \param[in] _snapshot Poses of the models, or null to clear them.
+      /// \sa Manager::SetModelPoses()
+      public: virtual void SetModelPoseSnapshot(
+                  std::shared_ptr<const ModelPoseSnapshot> _snapshot) override;
+
       /// \brief Get the horizontal field of view. The field of view is the
       /// angle between the frustum's vertex and the edges of the near or far
       /// plane. This value represents the horizontal angle.
@@ -119,6 +156,53 @@ namespace ignition
       /// \return List of detected models.
       public: msgs::LogicalCameraImage Image() const;
 
+      /// \brief Get the latest image without copying it. This doesn't wait
+      /// for an update in progress, so it's cheap to call from other threads
+      /// at a high rate. The snapshot never changes, and stays valid for as
+      /// long as it's held.
+      /// \return The latest image, or nullptr before the first update.
+      /// \sa Image()
+      public: std::shared_ptr<const msgs::LogicalCameraImage>
+                  ImageSnapshot() const;
+
+      /// \brief Set whether only the changes of the image are published.
+      /// Each delta message lists the models that entered the frustum or
+      /// moved more than a tolerance since they were last published, and
+      /// has a header entry with the key "delta". The names of the models
+      /// that left the frustum are the values of a header entry with the
+      /// key "removed". Every few messages, a keyframe with all the models
+      /// and without these entries is published, so that new subscribers
+      /// catch up. Subscribers rebuild the images with ApplyDelta(). The
+      /// data callbacks and Image() still get full images. Disabled by
+      /// default.
+      /// \param[in] _delta True to publish the changes only.
+      /// \param[in] _positionTolerance Distance in meters a model must move
+      /// to be published again.
+      /// \param[in] _angleTolerance Angle in radians a model must turn to be
+      /// published again.
+      /// \param[in] _keyframeInterval Number of messages from one keyframe
+      /// to the next, at least one, in which case every message is a
+      /// keyframe.
+      public: void SetDeltaPublishing(const bool _delta,
+                  const double _positionTolerance = 0.01,
+                  const double _angleTolerance = 0.01,
+                  const unsigned int _keyframeInterval = 30u);
+
+      /// \brief Get whether only the changes of the image are published.
+      /// \return True if delta messages are published.
+      /// \sa SetDeltaPublishing()
+      public: bool DeltaPublishing() const;
+
+      /// \brief Apply a published message to an image rebuilt from the
+      /// previous messages. A keyframe replaces the image. A delta message
+      /// removes, adds and moves the models it lists, and keeps the others.
+      /// \param[in] _msg Message published by a logical camera
+      /// \param[in,out] _image Image to update, with its models sorted by
+      /// name
+      /// \sa SetDeltaPublishing()
+      public: static void ApplyDelta(const msgs::LogicalCameraImage &_msg,
+                  msgs::LogicalCameraImage &_image);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Data pointer for private data
       /// \internal
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_MAGNETOMETERBATCH_HH_
+#define IGNITION_SENSORS_MAGNETOMETERBATCH_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/magnetometer/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class MagnetometerBatchPrivate;
+    class MagnetometerSensor;
+
+    /// \brief Updates many magnetometers together.
+    ///
+    /// The poses of the magnetometers and their world fields are kept in
+    /// contiguous arrays, one per component, and the fields in the frames
+    /// of all the sensors are computed with a single loop over the arrays
+    /// that the compiler can vectorize. That loop is skipped when none of
+    /// the rotations nor fields changed since the last update. The sensors
+    /// only apply their noise and generate their messages afterwards, and
+    /// only the sensors that are due are visited.
+    ///
+    /// Like ImuBatch, the batch doesn't own the sensors, their poses are
+    /// set on the batch instead of the sensors, and Update() is called
+    /// before Manager::RunOnce() with the same time.
+    class IGNITION_SENSORS_MAGNETOMETER_VISIBLE MagnetometerBatch
+    {
+      /// \brief Constructor
+      public: MagnetometerBatch();
+
+      /// \brief Destructor
+      public: ~MagnetometerBatch();
+
+      /// \brief Add a sensor, with its current pose and world field.
+      /// \param[in] _sensor Sensor to add
+      /// \return Index of the sensor in the batch, or SensorCount() if the
+      /// sensor is null or already in the batch.
+      public: std::size_t AddSensor(MagnetometerSensor *_sensor);
+
+      /// \brief Remove a sensor. The last sensor of the batch takes its
+      /// index.
+      /// \param[in] _sensor Sensor to remove
+      /// \return False if the sensor isn't in the batch.
+      public: bool RemoveSensor(const MagnetometerSensor *_sensor);
+
+      /// \brief Get the number of sensors.
+      /// \return Number of sensors in the batch
+      public: std::size_t SensorCount() const;
+
+      /// \brief Get a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \return The sensor, or null if the index is out of bounds.
+      public: MagnetometerSensor *SensorByIndex(
+                  const std::size_t _index) const;
+
+      /// \brief Set the world pose of a sensor.
+      /// \param[in] _index Index of the sensor
+      /// \param[in] _pose Pose in world frame
+      public: void SetWorldPose(const std::size_t _index,
+                  const math::Pose3d &_pose);
+
+      /// \brief Set the world poses of all the sensors at once.
+      /// \param[in] _poses 7 values per sensor, in the order of the sensors:
+      /// the position (x, y, z) and the orientation (w, x, y, z).
+      public: void SetWorldPoses(const double *_poses);
+
+      /// \brief Set the magnetic field of all the sensors.
+      /// \param[in] _field Magnetic field in world frame, in Tesla
+      public: void SetWorldMagneticField(const math::Vector3d &_field);
+
+      /// \brief Update the sensors that are due.
+      /// \param[in] _now The current time
+      /// \return Number of sensors that were updated
+      public: std::size_t Update(
+                  const std::chrono::steady_clock::duration &_now);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Data pointer for private data
+      /// \internal
+      private: std::unique_ptr<MagnetometerBatchPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
@@ -17,10 +17,22 @@
 #ifndef IGNITION_SENSORS_MAGNETOMETERSENSOR_HH_
 #define IGNITION_SENSORS_MAGNETOMETERSENSOR_HH_
 
+#include <functional>
 #include <memory>
 
 #include <sdf/sdf.hh>
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/magnetometer.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/Event.hh>
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
 #include <ignition/math/Pose3.hh>
@@ -78,6 +90,30 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief Publish a recorded message, and call the data callbacks
+      /// with the messages of the main topic.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      /// \sa Manager::SetReplay()
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg) override;
+
+      /// \brief Connect a callback that is called with every new magnetometer
+      /// message, from the thread that updates the sensor. In-process
+      /// consumers can use this instead of subscribing to the topic, which
+      /// avoids serialization. Messages are only published when the topic
+      /// has subscribers.
+      /// \param[in] _callback Function to call with the message.
+      /// \return A connection pointer that must remain in scope. When the
+      /// connection pointer falls out of scope, the connection is broken.
+      public: ignition::common::ConnectionPtr ConnectDataCallback(
+                  std::function<
+                  void(const ignition::msgs::Magnetometer &)> _callback);
+
       /// \brief Set the world pose of the sensor
       /// \param[in] _pose Pose in world frame
       public: void SetWorldPose(const math::Pose3d _pose);
@@ -98,6 +134,21 @@ namespace ignition
       /// \return Magnetic field vector in body frame
       public: math::Vector3d MagneticField() const;
 
+      /// \brief Set the state of the next update, computed by a
+      /// MagnetometerBatch.
+      /// \param[in] _now Time of the update
+      /// \param[in] _pose World pose
+      /// \param[in] _worldField Magnetic field in world frame
+      /// \param[in] _field Magnetic field in body frame, without noise
+      private: void SetBatchState(
+                   const std::chrono::steady_clock::duration &_now,
+                   const math::Pose3d &_pose,
+                   const math::Vector3d &_worldField,
+                   const math::Vector3d &_field);
+
+      /// \brief The batch sets the states of its sensors
+      friend class MagnetometerBatch;
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Data pointer for private data
       /// \internal
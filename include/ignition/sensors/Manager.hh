@@ -17,6 +17,8 @@
 #ifndef IGNITION_SENSORS_MANAGER_HH_
 #define IGNITION_SENSORS_MANAGER_HH_
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <type_traits>
@@ -25,9 +27,12 @@
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
 #include <ignition/common/Console.hh>
+#include <ignition/math/Pose3.hh>
 #include <ignition/sensors/config.hh>
 #include <ignition/sensors/Export.hh>
+#include <ignition/sensors/ModelPoseSnapshot.hh>
 #include <ignition/sensors/Sensor.hh>
+#include <ignition/sensors/SensorStats.hh>
 
 namespace ignition
 {
@@ -48,6 +53,9 @@ namespace ignition
     ///   everything the sensor will need. Custom sensors configuration must
     ///   be in the <plugin> tag of the sdf::Element. The manager will
     ///   dynamically load the sensor library and update it.
+    ///
+    ///   The sensors the manager creates advertise their outputs on one
+    ///   transport node of the manager, see Sensor::SetTransportNode().
     /// \remarks This class is not thread safe.
     class IGNITION_SENSORS_VISIBLE Manager
     {
@@ -178,6 +186,40 @@ namespace ignition
       /// is returned on erro.
       public: ignition::sensors::SensorId CreateSensor(const sdf::Sensor &_sdf);
 
+      /// \brief Create many sensors from SDF at once.
+      ///
+      ///   This behaves like calling CreateSensor() for each element of
+      ///   _sdfs, but is much faster for large worlds. Sensors that don't
+      ///   depend on rendering are loaded in parallel on the worker threads,
+      ///   see SetWorkerThreadCount(). Rendering sensors are loaded
+      ///   afterwards in one pass on the calling thread, so their rendering
+      ///   resources are created together. This function must therefore be
+      ///   called from the rendering thread if rendering sensors are
+      ///   included.
+      /// \sa CreateSensor()
+      /// \param[in] _sdfs SDF sensor DOM objects
+      /// \return One sensor id per element of _sdfs, in the same order.
+      /// NO_SENSOR is used for sensors that failed to be created.
+      public: std::vector<ignition::sensors::SensorId> CreateSensors(
+                  const std::vector<sdf::Sensor> &_sdfs);
+
+
+      /// \brief Create a copy of a sensor with a new name, topic and parent.
+      ///
+      ///   This is much cheaper than creating the sensor from SDF again,
+      ///   which makes it useful to spawn many robots with the same sensors.
+      /// \sa SensorFactory::CloneSensor()
+      /// \param[in] _id Identifier of the sensor to copy.
+      /// \param[in] _name Name of the new sensor.
+      /// \param[in] _topic Topic of the new sensor. If empty, the default
+      /// topic of the sensor type is used.
+      /// \param[in] _parent Parent of the new sensor.
+      /// \return A sensor id that refers to the new sensor. NO_SENSOR
+      /// is returned on error.
+      public: ignition::sensors::SensorId CloneSensor(
+                  const ignition::sensors::SensorId _id,
+                  const std::string &_name, const std::string &_topic,
+                  const std::string &_parent);
 
       /// \brief Get an instance of a loaded sensor by sensor id
       /// \param[in] _id Idenitifier of the sensor.
@@ -204,9 +246,530 @@ namespace ignition
       public: void RunOnce(const std::chrono::steady_clock::duration &_time,
                   bool _force = false);
 
+      /// \brief Run the sensor generation one step within a wall time
+      /// budget. The manager keeps an estimate of the recent update cost of
+      /// each sensor, and updates the due sensors with the highest
+      /// priority that fit in the budget, at least one. The other due
+      /// sensors are deferred to the next call. Each deferral raises the
+      /// effective priority of a sensor by one until it's updated, so
+      /// deferred sensors are decimated rather than starved.
+      /// \param[in] _time The current simulated time
+      /// \param[in] _budget Wall time available for updating sensors.
+      /// \param[out] _deferred If not null, filled with the ids of the due
+      /// sensors that were deferred.
+      /// \sa Sensor::SetPriority()
+      public: void RunOnce(const std::chrono::steady_clock::duration &_time,
+                  const std::chrono::steady_clock::duration &_budget,
+                  std::vector<ignition::sensors::SensorId> *_deferred =
+                      nullptr);
+
+      /// \brief Run the sensor generation up to a time, for batch runs that
+      /// step physics many times between calls. The sensors due between
+      /// the previous RunOnce() and _time are updated at the time they
+      /// were due, in order, so each keeps its update rate and stamps, and
+      /// then the sensors due at _time are. Triggered sensors and sensors
+      /// due before the previous run update at _time, so no step goes back
+      /// in time. Each step is a RunOnce() call, so the sensors without an
+      /// update rate update on every step, and the sensors see the poses
+      /// and the scene as they are at the call. Calls with nothing due
+      /// return right away, see NextDueTime().
+      /// \param[in] _time The current simulated time
+      /// \return Number of steps run, 0 if nothing was due.
+      public: std::size_t RunUntil(
+                  const std::chrono::steady_clock::duration &_time);
+
+      /// \brief Get the earliest time a sensor is due, so integrators can
+      /// skip calling RunOnce() or RunUntil() until then. Forced and
+      /// triggered updates can make sensors due earlier, check again after
+      /// changing a sensor. Waits for rendering in flight, since rendered
+      /// sensors are scheduled again once done.
+      /// \return The earliest update time, zero if sensors without an
+      /// update rate or a replay need every call, or if a triggered sensor
+      /// is waiting for its update, or max() if no sensor is scheduled.
+      public: std::chrono::steady_clock::duration NextDueTime();
+
+      /// \brief Set the poses of many sensors in one call, for example after
+      /// every physics step. This is equivalent to calling Sensor::SetPose()
+      /// on each sensor, without looking up each sensor separately. With
+      /// async rendering, it first waits for the renders handed to the
+      /// render thread, like RunOnce() does.
+      /// \param[in] _ids Ids of the sensors.
+      /// \param[in] _poses New pose of each sensor in _ids, relative to its
+      /// parent.
+      /// \return False if the arrays have different sizes, in which case no
+      /// pose is set, or if any id is unknown. Poses of the known sensors
+      /// are set either way.
+      public: bool SetPoses(
+                  const std::vector<ignition::sensors::SensorId> &_ids,
+                  const std::vector<ignition::math::Pose3d> &_poses);
+
+      /// \brief Set the poses of many sensors and run the sensor generation
+      /// one step. This is the same as calling SetPoses() followed by
+      /// RunOnce(), for integrations that move sensors right before
+      /// updating them.
+      /// \param[in] _time The current simulated time
+      /// \param[in] _ids Ids of the sensors whose pose changed.
+      /// \param[in] _poses New pose of each sensor in _ids.
+      /// \param[in] _force If true, all sensors are forced to update.
+      /// \return The result of SetPoses(). Sensors are updated either way.
+      /// \sa SetPoses()
+      public: bool RunOnce(const std::chrono::steady_clock::duration &_time,
+                  const std::vector<ignition::sensors::SensorId> &_ids,
+                  const std::vector<ignition::math::Pose3d> &_poses,
+                  bool _force = false);
+
+      /// \brief Force an update of some sensors right away, as RunOnce()
+      /// with _force set would for all sensors. The schedule of the sensors
+      /// doesn't change. RenderServer uses this to render the sensors of
+      /// each request. With async rendering, the rendering sensors are
+      /// handed to the render thread, see WaitForRendering().
+      /// \param[in] _ids Ids of the sensors to update.
+      /// \param[in] _time The current simulated time
+      /// \return False if any id is unknown. The known sensors are updated
+      /// either way.
+      public: bool UpdateSensors(
+                  const std::vector<ignition::sensors::SensorId> &_ids,
+                  const std::chrono::steady_clock::duration &_time);
+
+      /// \brief Change the configuration of a sensor in place, without
+      /// destroying and creating it again, see Sensor::Reconfigure().
+      /// Rendering sensors are reconfigured on the render thread with async
+      /// rendering. With remote rendering, reconfigure the sensor of the
+      /// RenderServer too.
+      /// \param[in] _id Id of the sensor
+      /// \param[in] _sdf New SDF of the sensor
+      /// \return False if the id is unknown or the sensor must be created
+      /// again to apply _sdf, in which case it is unchanged.
+      public: bool ReconfigureSensor(const ignition::sensors::SensorId _id,
+                  const sdf::Sensor &_sdf);
+
+      /// \brief Set the poses of the models in the world for all current
+      /// and future sensors that use them, such as logical cameras. One
+      /// snapshot is shared by all sensors instead of giving each sensor
+      /// its own copy, and the sensors find the models around them through
+      /// the grid of the snapshot. Call it after every physics step,
+      /// before RunOnce(), which evaluates the sensors against the snapshot
+      /// in their update, in parallel with SetWorkerThreadCount().
+      /// \param[in] _snapshot Poses of the models, or null to clear them.
+      /// \sa Sensor::SetModelPoseSnapshot()
+      public: void SetModelPoses(
+                  std::shared_ptr<const ModelPoseSnapshot> _snapshot);
+
+      /// \brief Get the poses of the models set with SetModelPoses().
+      /// \return Poses of the models, or null if none were set.
+      public: std::shared_ptr<const ModelPoseSnapshot> ModelPoses() const;
+
+      /// \brief Record every message published by all current and future
+      /// sensors of this manager into a sink, without going through
+      /// transport. Sensors with a sink build their messages even without
+      /// subscribers. Don't call it while RunOnce() runs.
+      /// \param[in] _sink An open sink, or null to stop recording.
+      /// \sa Sensor::SetRecordingSink()
+      public: void SetRecordingSink(
+                  std::shared_ptr<ignition::sensors::RecordingSink> _sink);
+
+      /// \brief Serve the outputs of the sensors from a recording of
+      /// RecordingSink instead of updating them. RunOnce() then publishes
+      /// the recorded messages up to the given simulated time, in the
+      /// order of their simulated times, without rendering or computing
+      /// any sensor data. Messages of a sensor of this manager with the
+      /// recorded name go through Sensor::ReplayMessage(), so that its
+      /// callbacks get them too. The others are published by the manager
+      /// on their recorded topics. Going back in time continues from the
+      /// first message at the new time. Don't call it while RunOnce() runs.
+      /// \param[in] _directory Directory of the recording, or empty to stop
+      /// replaying and update the sensors again.
+      /// \return False if the recording couldn't be read, in which case
+      /// replay stops.
+      /// \sa SetRecordingSink()
+      public: bool SetReplay(const std::string &_directory);
+
+      /// \brief Get whether the sensor outputs are served from a recording.
+      /// \return True while replaying.
+      /// \sa SetReplay()
+      public: bool Replaying() const;
+
+      /// \brief Set the number of threads used to update sensors in
+      /// RunOnce(). When more than one thread is requested, sensors that
+      /// don't require rendering are updated concurrently by a pool of
+      /// worker threads, and rendering sensors are updated afterwards on the
+      /// thread that called RunOnce(), which is expected to own the
+      /// rendering context. By default, all sensors are updated serially.
+      /// \param[in] _count Total number of threads, including the thread
+      /// calling RunOnce(). 0 uses one thread per core, and 1 disables
+      /// parallel updates.
+      /// \sa Sensor::IsRenderingSensor()
+      public: void SetWorkerThreadCount(const unsigned int _count);
+
+      /// \brief Get the number of threads used to update sensors.
+      /// \return Total number of threads, including the thread calling
+      /// RunOnce(). One means sensors are updated serially.
+      /// \sa SetWorkerThreadCount()
+      public: unsigned int WorkerThreadCount() const;
+
+      /// \brief Pin the background worker threads to CPU cores, such as
+      /// the cores of one socket of a multi-socket host. Only supported on
+      /// Linux. The thread calling RunOnce() is the first worker and keeps
+      /// its affinity. Combined with SetStickyWorkers(), the buffers a
+      /// sensor fills during its updates are first touched, and so
+      /// allocated by the operating system, on the memory node of its
+      /// worker, and stay there since they are reused across updates.
+      /// \param[in] _cores Core of each background worker thread, the
+      /// first one for the second worker. Workers without a core, or with a
+      /// negative one, can run on any core. Empty to unpin all workers.
+      /// \return False if a worker couldn't be pinned.
+      /// \sa SetWorkerThreadCount()
+      public: bool SetWorkerAffinity(const std::vector<int> &_cores);
+
+      /// \brief Get the cores set with SetWorkerAffinity().
+      /// \return Core of each background worker thread.
+      public: std::vector<int> WorkerAffinity() const;
+
+      /// \brief Set whether each sensor is updated on the same worker
+      /// thread on every RunOnce() call, for cache and memory locality.
+      /// Sensors are spread evenly over the workers in the order they're
+      /// created, and spread again when the number of workers changes.
+      /// Otherwise, free workers take the next due sensor, which balances
+      /// uneven updates better. Disabled by default.
+      /// \param[in] _sticky True to keep sensors on their worker.
+      /// \sa SetWorkerThreadCount()
+      public: void SetStickyWorkers(const bool _sticky);
+
+      /// \brief Get whether each sensor is updated on the same worker.
+      /// \return True with sticky workers.
+      /// \sa SetStickyWorkers()
+      public: bool StickyWorkers() const;
+
+      /// \brief Set whether parallel updates produce the same outputs as
+      /// serial updates, whatever the number of worker threads. Sensors
+      /// then hold their messages back during their update, see
+      /// Sensor::SetDeferredPublish(), and RunOnce() publishes them sensor
+      /// by sensor in the update order once the concurrent updates are
+      /// done, and records them in that order too. Each worker thread
+      /// updates a fixed share of the sensors. Noise doesn't depend on the
+      /// update order either way, because the random streams of each
+      /// sensor are seeded from its name and topic, see Sensor::NoiseSeed().
+      /// Budgeted updates, async rendering and async publishing still
+      /// depend on timing, and data callbacks are still called during the
+      /// updates. Disabled by default.
+      /// \param[in] _deterministic True to publish in a fixed order.
+      public: void SetDeterministic(const bool _deterministic);
+
+      /// \brief Get whether parallel updates produce the same outputs as
+      /// serial updates.
+      /// \return True if outputs are published in a fixed order.
+      /// \sa SetDeterministic()
+      public: bool Deterministic() const;
+
+      /// \brief Set whether RunOnce() updates the due sensors grouped by
+      /// concrete sensor type instead of in id order. Running all sensors
+      /// of a type back to back keeps their code and data hot in the
+      /// caches, which helps worlds with many small sensors of mixed types.
+      /// Disabled by default.
+      /// \param[in] _group True to group updates by sensor type.
+      public: void SetGroupUpdatesByType(const bool _group);
+
+      /// \brief Get whether updates are grouped by sensor type.
+      /// \return True if updates are grouped by sensor type.
+      /// \sa SetGroupUpdatesByType()
+      public: bool GroupUpdatesByType() const;
+
+      /// \brief Set whether the first updates of sensors with equal update
+      /// rates are spread over their update period, instead of all sensors
+      /// updating on the same call. This flattens the cost per RunOnce()
+      /// call when many sensors share a rate. It applies to sensors created
+      /// after enabling it, except those that opted out with
+      /// Sensor::SetStaggerable(). Disabled by default.
+      /// \param[in] _stagger True to stagger new sensors.
+      /// \sa Sensor::SetUpdatePhase()
+      public: void SetStaggerUpdates(const bool _stagger);
+
+      /// \brief Get whether new sensors are staggered.
+      /// \return True if new sensors are staggered.
+      /// \sa SetStaggerUpdates()
+      public: bool StaggerUpdates() const;
+
+      /// \brief Set whether new sensors keep as little state as they can,
+      /// for worlds with very many sensors, see Sensor::SetCompact().
+      /// Sensors cloned from compact sensors with CloneSensor() share the
+      /// SDF of their source instead of keeping a copy. It applies to
+      /// sensors created after enabling it. Disabled by default.
+      /// \param[in] _compact True for new sensors to be compact.
+      public: void SetCompactSensors(const bool _compact);
+
+      /// \brief Get whether new sensors are compact.
+      /// \return True if new sensors are compact.
+      /// \sa SetCompactSensors()
+      public: bool CompactSensors() const;
+
+      /// \brief Set whether sensors skip updates while they have no
+      /// consumers. This applies to all current and future sensors of this
+      /// manager. Disabled by default.
+      /// \param[in] _lazy True to skip updates without consumers.
+      /// \sa Sensor::SetLazyUpdates()
+      public: void SetLazyUpdates(const bool _lazy);
+
+      /// \brief Get whether sensors skip updates while they have no
+      /// consumers.
+      /// \return True if updates without consumers are skipped.
+      /// \sa SetLazyUpdates()
+      public: bool LazyUpdates() const;
+
+      /// \brief Set whether rendering sensors are updated in batched stages.
+      /// When enabled, RunOnce() first renders all due rendering sensors
+      /// that support staged updates, then reads their frames back one by
+      /// one, and builds and publishes their messages on the worker
+      /// threads (see SetWorkerThreadCount()). The GPU then renders the
+      /// frames of later sensors while earlier frames are copied, and each
+      /// frame is processed by a free worker as soon as it is read back,
+      /// while the next frames are read back. With deterministic updates
+      /// or sticky workers, all frames are read back before any is
+      /// processed. Data callbacks of these sensors may be called from
+      /// worker threads. This applies to all current and future sensors of
+      /// this manager. Disabled by default.
+      /// \param[in] _batched True to update rendering sensors in stages.
+      /// \sa Sensor::SetStagedUpdates()
+      public: void SetBatchedRendering(const bool _batched);
+
+      /// \brief Get whether rendering sensors are updated in batched stages.
+      /// \return True if batched rendering is enabled.
+      /// \sa SetBatchedRendering()
+      public: bool BatchedRendering() const;
+
+      /// \brief Set whether rendering sensors are updated on a dedicated
+      /// render thread. When enabled, RunOnce() updates the sensors that
+      /// don't render, hands the due rendering sensors to the render thread
+      /// and returns without waiting for them, so the next simulation step
+      /// overlaps with rendering. The next call to RunOnce() first waits
+      /// for the previous renders. Until then, or until WaitForRendering()
+      /// returns, the scene and the rendering sensors must only be changed
+      /// from tasks given to RunOnRenderThread(). Rendering engines bind
+      /// their context to the thread that creates it, so the engine and
+      /// the scenes should be created with RunOnRenderThread() as well.
+      /// Data callbacks of rendering sensors are then called from the
+      /// render thread. Disabled by default.
+      /// \param[in] _async True to render on a dedicated thread.
+      /// \sa SetRenderCallback()
+      public: void SetAsyncRendering(const bool _async);
+
+      /// \brief Get whether rendering sensors are updated on a dedicated
+      /// render thread.
+      /// \return True if async rendering is enabled.
+      /// \sa SetAsyncRendering()
+      public: bool AsyncRendering() const;
+
+      /// \brief Wait until the render thread has updated the rendering
+      /// sensors handed to it by the last call to RunOnce(). Returns at
+      /// once without async rendering.
+      /// \sa SetAsyncRendering()
+      public: void WaitForRendering();
+
+      /// \brief Get whether the render thread is idle, without waiting.
+      /// \return True if WaitForRendering() would return at once.
+      public: bool RenderingDone() const;
+
+      /// \brief Render each rendering sensor once without publishing, so
+      /// that shaders, render targets and render passes, which are created
+      /// on first use, are built before simulation starts rather than
+      /// slowing down its first updates. Call it once the sensors have
+      /// their scene. The scenes are updated once, and the sensors are
+      /// rendered in one pass on the render thread, since rendering
+      /// contexts can't be shared across threads. Sensors rendered by a
+      /// remote render service are skipped.
+      /// \return Number of sensors that were warmed up.
+      /// \sa Sensor::WarmUp()
+      public: std::size_t WarmUp();
+
+      /// \brief Set a function called on the render thread each time it
+      /// finished updating the rendering sensors of a RunOnce() call, with
+      /// the time given to that call. Don't call the manager from it.
+      /// \param[in] _callback Function to call, or null for none.
+      /// \sa SetAsyncRendering()
+      public: void SetRenderCallback(
+                  std::function<void(const std::chrono::steady_clock::duration
+                  &)> _callback);
+
+      /// \brief Run a task on the render thread, after the pending renders,
+      /// and wait for it. Without async rendering, the task runs on the
+      /// calling thread.
+      /// \param[in] _task Task to run, such as updating the scene.
+      /// \sa SetAsyncRendering()
+      public: void RunOnRenderThread(const std::function<void()> &_task);
+
+      /// \brief Render the rendering sensors of this manager on a remote
+      /// render service, see RenderServer, such as a node with GPUs shared
+      /// by many simulation nodes. RunOnce() then streams the poses of the
+      /// due rendering sensors and of the models that moved, see
+      /// SetModelPoses(), to the service and returns without waiting. The
+      /// images, depths and ranges the service renders come back on
+      /// transport threads and are published on the usual topics of the
+      /// sensors, and given to their callbacks, through
+      /// Sensor::ReplayMessage(). Up to _depth requests are in flight, so
+      /// rendering and the network overlap with the next simulation steps.
+      /// Requests made while the service is behind are skipped, so sensors
+      /// render less often rather than slow down simulation. The sensors
+      /// need no scene of their own, and their C++ accessors, such as
+      /// CameraSensor::ImageWidth(), keep working. This applies to all
+      /// current and future rendering sensors of this manager.
+      /// \param[in] _service Name of the render service, or empty to render
+      /// in this process again.
+      /// \param[in] _depth Maximum number of requests in flight, at least 1.
+      /// \return False if the topics of the service couldn't be set up, in
+      /// which case sensors render in this process.
+      /// \sa Sensor::SetRemoteRendered()
+      public: bool SetRemoteRendering(const std::string &_service,
+                  const unsigned int _depth = 2u);
+
+      /// \brief Get the render service rendering sensors are rendered by.
+      /// \return Name of the render service, empty if sensors render in
+      /// this process.
+      /// \sa SetRemoteRendering()
+      public: std::string RemoteRendering() const;
+
+      /// \brief Set the render quality profile of all current and future
+      /// rendering sensors of this manager, overriding the profiles set in
+      /// their SDF. For example, tests can switch every camera to
+      /// RenderQualityProfile::FAST with this. Sensors apply the profile
+      /// when their scene is set, so this should be called before that.
+      /// \param[in] _profile Render quality profile.
+      /// \sa Sensor::SetRenderQuality()
+      public: void SetRenderQuality(const RenderQualityProfile _profile);
+
+      /// \brief Get the render quality profile set with SetRenderQuality().
+      /// \param[out] _profile Render quality profile.
+      /// \return False if SetRenderQuality() wasn't called, in which case
+      /// every sensor uses its own profile.
+      public: bool RenderQuality(RenderQualityProfile &_profile) const;
+
+      /// \brief Set the name of the world of all current and future sensors
+      /// of this manager. Each manager of a process running several worlds
+      /// on separate threads gets its own name, and its rendering sensors
+      /// then only take the scenes set with RenderingEvents::SetWorldScene()
+      /// for that name. Empty by default, which is the world of
+      /// RenderingEvents::sceneEvent.
+      /// \param[in] _world Name of the world.
+      /// \sa Sensor::SetWorldName()
+      public: void SetWorldName(const std::string &_world);
+
+      /// \brief Get the name of the world of the sensors of this manager.
+      /// \return Name of the world, empty for the default world.
+      /// \sa SetWorldName()
+      public: std::string WorldName() const;
+
+      /// \brief Set the number of render devices, such as GPUs, the
+      /// rendering sensors of this manager are spread over. Each device
+      /// renders its own copy of the world, and the scenes are given to the
+      /// sensors with RenderingEvents::SetDeviceScenes(). Keeping the
+      /// copies in sync is up to the caller, which owns the scenes. New
+      /// rendering sensors go to the device with the fewest sensors, and
+      /// changing the count balances the current ones again.
+      /// \param[in] _count Number of render devices, 1 by default. 0 is
+      /// treated as 1.
+      /// \sa BalanceRenderDevices()
+      public: void SetRenderDeviceCount(const unsigned int _count);
+
+      /// \brief Get the number of render devices.
+      /// \return Number of render devices
+      /// \sa SetRenderDeviceCount()
+      public: unsigned int RenderDeviceCount() const;
+
+      /// \brief Spread the rendering sensors over the render devices so
+      /// that the devices spend about the same time rendering per second
+      /// of simulation. The cost of a sensor is its measured render time,
+      /// times its update rate. Costlier sensors are placed first, each on
+      /// the device with the lowest cost so far. Call this once the sensors
+      /// have been updated for a while, then set the scenes again with
+      /// RenderingEvents::SetDeviceScenes() if sensors were moved.
+      /// \return True if the render device of any sensor changed.
+      /// \sa Sensor::RenderDevice()
+      public: bool BalanceRenderDevices();
+
+      /// \brief Get the runtime statistics of a sensor.
+      /// \param[in] _id Identifier of the sensor.
+      /// \param[out] _stats Statistics of the sensor.
+      /// \return True if the sensor exists.
+      /// \sa Sensor::Stats()
+      public: bool Stats(const ignition::sensors::SensorId _id,
+                  SensorStats &_stats) const;
+
+      /// \brief Get the memory held by a sensor. With async rendering, call
+      /// this after WaitForRendering().
+      /// \param[in] _id Identifier of the sensor.
+      /// \param[out] _memory Memory of the sensor.
+      /// \return True if the sensor exists.
+      /// \sa Sensor::MemoryUsage()
+      public: bool MemoryUsage(const ignition::sensors::SensorId _id,
+                  SensorMemory &_memory) const;
+
+      /// \brief Get the memory held by all the sensors of this manager.
+      /// \return Sum of the memory of the sensors.
+      /// \sa MemoryUsage()
+      public: SensorMemory TotalMemoryUsage() const;
+
+      /// \brief Periodically publish the runtime statistics of all sensors
+      /// as an ignition::msgs::Param_V message. Each sensor has a
+      /// msgs::Param with its name, id, counters, memory in bytes (see
+      /// SensorMemory), its update rate and the rate it achieved since the
+      /// previous message, whether it has subscribers, and the mean,
+      /// maximum, median and 99th percentile wall time in milliseconds of
+      /// its updates, of each update phase and of the delay between
+      /// sampling and publishing its data (see SensorStats::publishDelay),
+      /// with the heap allocations made during them.
+      /// The achieved rates of the first message are zero.
+      /// Statistics are only published while the topic has subscribers.
+      /// With async rendering, statistics that are due while rendering
+      /// sensors are on the render thread are published, with the time
+      /// they were due, once the render thread is done with them, which is
+      /// at the latest at the start of the next RunOnce().
+      /// \param[in] _topic Topic to publish on. An empty topic disables
+      /// publishing, which is the default.
+      /// \param[in] _period Simulated time between messages.
+      /// \return True if the topic was valid and could be advertised.
+      public: bool SetDiagnosticsTopic(const std::string &_topic,
+                  const std::chrono::steady_clock::duration &_period =
+                  std::chrono::seconds(1));
+
+      /// \brief Get the topic the runtime statistics are published on.
+      /// \return The topic, empty if statistics are not published.
+      /// \sa SetDiagnosticsTopic()
+      public: std::string DiagnosticsTopic() const;
+
+      /// \brief Also publish the readings of all the sensors of a type
+      /// together, as one ignition::msgs::Double_V message per RunOnce()
+      /// or UpdateSensors() call that updated any of them. This is meant
+      /// for many low-rate scalar sensors, such as altimeters, air pressure
+      /// sensors and magnetometers, whose messages are small compared to
+      /// the cost of a topic each. The "sensors" header entry names the
+      /// sensor of each row of data, ordered by sensor id, and the "fields"
+      /// header entry names the values of a row, which are the numeric
+      /// fields of the sensor messages. Each sensor still publishes on its
+      /// own topic. Aggregated messages are only built while the topic has
+      /// subscribers.
+      /// \param[in] _type SDF type of the sensors, such as "altimeter"
+      /// \param[in] _topic Topic to publish on. An empty topic stops
+      /// aggregating the type, which is the default.
+      /// \return True if the topic was valid and could be advertised.
+      public: bool SetAggregatedTopic(const std::string &_type,
+                  const std::string &_topic);
+
+      /// \brief Get the topic the readings of a sensor type are aggregated
+      /// on.
+      /// \param[in] _type SDF type of the sensors
+      /// \return The topic, empty if the type isn't aggregated.
+      /// \sa SetAggregatedTopic()
+      public: std::string AggregatedTopic(const std::string &_type) const;
+
       /// \brief Adds colon delimited paths sensor plugins may be
       public: void AddPluginPaths(const std::string &_path);
 
+      /// \brief Load the plugins of the given sensor types now, so that
+      /// creating the first sensor of each type doesn't access the file
+      /// system.
+      /// \sa SensorFactory::PreloadSensorPlugins()
+      /// \param[in] _types Sensor type strings, such as "camera".
+      /// \return True if the plugins of all types were loaded.
+      public: bool PreloadSensorPlugins(const std::vector<std::string> &_types);
+
       /// \brief load a plugin and return a shared_ptr
       /// \param[in] _filename Sensor plugin file to load.
       /// \return Pointer to the new sensor, nullptr on error.
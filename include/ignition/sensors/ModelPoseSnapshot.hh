@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_MODELPOSESNAPSHOT_HH_
+#define IGNITION_SENSORS_MODELPOSESNAPSHOT_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    // Forward declarations
+    class ModelPoseSnapshotPrivate;
+
+    /// \brief Immutable poses of the models in the world at one instant,
+    /// meant to be created once per simulation step and shared by all the
+    /// sensors that need them, such as logical cameras.
+    ///
+    /// Models are identified by their index in a name table. The table is
+    /// held through a shared pointer, so successive snapshots can reuse
+    /// the same table, and only fill a new array of poses, as long as the
+    /// set of models doesn't change. The positions are bucketed in a
+    /// uniform grid when the snapshot is created, so that every sensor
+    /// can find the models around it without visiting all of them.
+    /// \sa Manager::SetModelPoses()
+    class IGNITION_SENSORS_VISIBLE ModelPoseSnapshot
+    {
+      /// \brief Constructor
+      /// \param[in] _names Name of each model. Must not be null.
+      /// \param[in] _poses Pose of each model in _names, in the world
+      /// frame. Extra poses, or names without a pose, are dropped with an
+      /// error.
+      /// \param[in] _cellSize Edge length of the cells of the grid, in
+      /// meters. Cells about as large as the region seen by each sensor
+      /// work best.
+      public: ModelPoseSnapshot(
+                  std::shared_ptr<const std::vector<std::string>> _names,
+                  std::vector<math::Pose3d> _poses,
+                  const double _cellSize = 10.0);
+
+      /// \brief Destructor
+      public: ~ModelPoseSnapshot();
+
+      /// \brief Get the number of models.
+      /// \return Number of models
+      public: std::size_t Count() const;
+
+      /// \brief Get the name table of the snapshot, to create a later
+      /// snapshot with the same models.
+      /// \return Name of each model
+      public: const std::shared_ptr<const std::vector<std::string>> &
+              NameTable() const;
+
+      /// \brief Get the name of a model.
+      /// \param[in] _index Index of the model, less than Count()
+      /// \return Name of the model
+      public: const std::string &Name(const std::size_t _index) const;
+
+      /// \brief Get the pose of a model.
+      /// \param[in] _index Index of the model, less than Count()
+      /// \return Pose of the model in the world frame
+      public: const math::Pose3d &Pose(const std::size_t _index) const;
+
+      /// \brief Get the indices of the models that may lie in a box: all
+      /// models in the box are returned, along with some models close to
+      /// it. The indices are appended in no particular order.
+      /// \param[in] _min Minimum corner of the box, in the world frame
+      /// \param[in] _max Maximum corner of the box, in the world frame
+      /// \param[out] _indices Vector the indices are appended to
+      public: void Candidates(const math::Vector3d &_min,
+                  const math::Vector3d &_max,
+                  std::vector<std::size_t> &_indices) const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<ModelPoseSnapshotPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
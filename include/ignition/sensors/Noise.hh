@@ -18,6 +18,8 @@
 #ifndef IGNITION_SENSORS_NOISE_HH_
 #define IGNITION_SENSORS_NOISE_HH_
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <string>
 #include <vector>
@@ -101,6 +103,67 @@ namespace ignition
       /// \return Data with noise applied.
       public: virtual double ApplyImpl(double _in, double _dt);
 
+      /// \brief Apply noise in place to a batch of input data values. This
+      /// is equivalent to calling Apply on each value in turn, but avoids
+      /// a virtual call per value and lets noise models process the whole
+      /// batch in a single pass.
+      /// \param[in,out] _values Pointer to the first value.
+      /// \param[in] _count Number of values to apply noise to.
+      /// \param[in] _dt Input data time step.
+      /// \param[in] _stride Distance, in elements, between consecutive
+      /// values. Use a stride greater than 1 for interleaved buffers.
+      public: void ApplyBatch(double *_values, std::size_t _count,
+          double _dt = 0.0, std::size_t _stride = 1u);
+
+      /// \brief Apply noise in place to a batch of input data values.
+      /// \param[in,out] _values Pointer to the first value.
+      /// \param[in] _count Number of values to apply noise to.
+      /// \param[in] _dt Input data time step.
+      /// \param[in] _stride Distance, in elements, between consecutive
+      /// values.
+      /// \sa ApplyBatch(double *, std::size_t, double, std::size_t)
+      public: void ApplyBatch(float *_values, std::size_t _count,
+          double _dt = 0.0, std::size_t _stride = 1u);
+
+      /// \brief Apply noise in place to a batch of input data values. This
+      /// gets overriden by derived classes, and called by ApplyBatch. The
+      /// default implementation calls ApplyImpl on each value.
+      /// \param[in,out] _values Pointer to the first value.
+      /// \param[in] _count Number of values to apply noise to.
+      /// \param[in] _dt Input data time step.
+      /// \param[in] _stride Distance, in elements, between consecutive
+      /// values.
+      public: virtual void ApplyBatchImpl(double *_values, std::size_t _count,
+          double _dt, std::size_t _stride);
+
+      /// \brief Apply noise in place to a batch of input data values. This
+      /// gets overriden by derived classes, and called by ApplyBatch. The
+      /// default implementation calls ApplyImpl on each value.
+      /// \param[in,out] _values Pointer to the first value.
+      /// \param[in] _count Number of values to apply noise to.
+      /// \param[in] _dt Input data time step.
+      /// \param[in] _stride Distance, in elements, between consecutive
+      /// values.
+      public: virtual void ApplyBatchImpl(float *_values, std::size_t _count,
+          double _dt, std::size_t _stride);
+
+      /// \brief Seed the random numbers drawn by this noise model. Models
+      /// seeded with the same value produce the same noise. Sensors seed
+      /// their noise models from Sensor::NoiseSeed(). The default
+      /// implementation does nothing, since the model draws no random
+      /// numbers.
+      /// \param[in] _seed Seed of the random stream.
+      public: virtual void SetSeed(std::uint64_t _seed);
+
+      /// \brief Create a copy of this noise model that has the same
+      /// parameters and state, including any sampled bias, but draws from a
+      /// separate random stream. This lets parts of a large batch be
+      /// processed in parallel, one fork per thread. Derived classes that
+      /// add state should override this.
+      /// \param[in] _seed Seed of the random stream of the fork.
+      /// \return The new noise model.
+      public: virtual NoisePtr Fork(std::uint64_t _seed) const;
+
       /// \brief Accessor for NoiseType.
       /// \return Type of noise currently in use.
       public: NoiseType Type() const;
@@ -112,6 +175,37 @@ namespace ignition
       public: virtual void SetCustomNoiseCallback(
           std::function<double(double, double)> _cb);
 
+      /// \brief Register a custom noise callback that processes a whole
+      /// batch of double values at once. It is called by ApplyBatch instead
+      /// of calling the per value callback for each value, so that custom
+      /// models can be as fast as the built-in ones. If no per value
+      /// callback is registered, Apply calls this with a batch of one. If
+      /// no float batch callback is registered, ApplyBatch also calls this
+      /// for float values, with a copy of them converted to double.
+      /// \param[in] _cb Callback function that gets a pointer to the first
+      /// value, the number of values, the data time step and the distance,
+      /// in elements, between consecutive values. It must modify the values
+      /// in place.
+      /// \sa SetCustomNoiseCallback()
+      /// \sa ApplyBatch()
+      public: void SetCustomBatchNoiseCallback(
+          std::function<void(double *, std::size_t, double, std::size_t)>
+          _cb);
+
+      /// \brief Register a custom noise callback that processes a whole
+      /// batch of float values at once, such as lidar ranges. If no double
+      /// batch callback is registered, ApplyBatch also calls this for double
+      /// values, with a copy of them converted to float.
+      /// \param[in] _cb Callback function that gets a pointer to the first
+      /// value, the number of values, the data time step and the distance,
+      /// in elements, between consecutive values. It must modify the values
+      /// in place.
+      /// \sa SetCustomBatchNoiseCallback(std::function<void(double *,
+      /// std::size_t, double, std::size_t)>)
+      public: void SetCustomBatchNoiseCallback(
+          std::function<void(float *, std::size_t, double, std::size_t)>
+          _cb);
+
       /// \brief Output information about the noise model.
       /// \param[in] _out Output stream
       public: virtual void Print(std::ostream &_out) const;
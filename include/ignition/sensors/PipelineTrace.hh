@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_PIPELINETRACE_HH_
+#define IGNITION_SENSORS_PIPELINETRACE_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+#include <ignition/sensors/Sensor.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Stages of the sensor pipeline recorded by PipelineTrace.
+    enum class TraceStage : int
+    {
+      /// \brief A scheduled update of a sensor, which holds the stages
+      /// below that run inside it
+      SCHEDULE = 0,
+
+      /// \brief Rendering the scene
+      RENDER = 1,
+
+      /// \brief Copying data out of the rendering engine
+      READBACK = 2,
+
+      /// \brief Filling output messages
+      FILL = 3,
+
+      /// \brief Publishing output messages
+      PUBLISH = 4,
+
+      /// \brief Applying noise to sensor data on the CPU
+      NOISE = 5,
+
+      /// \brief Number of stages, not a valid stage
+      STAGE_COUNT = 6
+    };
+
+    /// \brief One recorded stage of the sensor pipeline.
+    class IGNITION_SENSORS_VISIBLE TraceEvent
+    {
+      /// \brief Stage that ran
+      public: TraceStage stage = TraceStage::SCHEDULE;
+
+      /// \brief Id of the sensor that ran the stage
+      public: SensorId sensor = NO_SENSOR;
+
+      /// \brief Simulated time of the update the stage belongs to
+      public: std::chrono::steady_clock::duration simTime{
+                  std::chrono::steady_clock::duration::zero()};
+
+      /// \brief Wall time at which the stage started
+      public: std::chrono::steady_clock::time_point start;
+
+      /// \brief Wall time the stage took
+      public: std::chrono::steady_clock::duration duration{
+                  std::chrono::steady_clock::duration::zero()};
+
+      /// \brief Small number of the thread that ran the stage, counting
+      /// from 1 in the order threads first record an event
+      public: uint32_t thread = 0u;
+    };
+
+    /// \brief Process wide recorder of sensor pipeline stages, to look at
+    /// the overlap and stalls of sensors offline without the profiler.
+    /// Events go to a fixed size ring buffer that never locks, and the
+    /// oldest events are overwritten once it's full. Recording is off by
+    /// default and costs a single atomic load per stage while off.
+    ///
+    /// A Manager enables the trace when the IGN_SENSORS_TRACE environment
+    /// variable names a file, and writes the events to that file when
+    /// it's destroyed.
+    class IGNITION_SENSORS_VISIBLE PipelineTrace
+    {
+      /// \brief Start recording, dropping the events recorded so far.
+      /// \param[in] _capacity Number of events kept, the most recent ones
+      /// win.
+      public: static void Enable(const std::size_t _capacity = 65536u);
+
+      /// \brief Stop recording. The recorded events are kept until the
+      /// next Enable().
+      public: static void Disable();
+
+      /// \brief Get whether events are being recorded.
+      /// \return True if enabled
+      public: static bool Enabled();
+
+      /// \brief Record a stage. Does nothing unless enabled. Safe to call
+      /// from any thread.
+      /// \param[in] _stage Stage that ran
+      /// \param[in] _sensor Id of the sensor that ran the stage
+      /// \param[in] _simTime Simulated time of the update
+      /// \param[in] _start Wall time at which the stage started
+      /// \param[in] _end Wall time at which the stage ended
+      public: static void Record(const TraceStage _stage,
+                  const SensorId _sensor,
+                  const std::chrono::steady_clock::duration &_simTime,
+                  const std::chrono::steady_clock::time_point &_start,
+                  const std::chrono::steady_clock::time_point &_end);
+
+      /// \brief Get the recorded events that are still in the ring, oldest
+      /// first. Events being written during the call are left out.
+      /// \return The events
+      public: static std::vector<TraceEvent> Events();
+
+      /// \brief Write the recorded events in the Chrome trace event JSON
+      /// format, which chrome://tracing and the Perfetto UI open.
+      /// \param[in] _out Stream to write to
+      /// \param[in] _names Names of the sensors by id, sensors without a
+      /// name are shown by id
+      public: static void WriteChromeTrace(std::ostream &_out,
+                  const std::map<SensorId, std::string> &_names = {});
+
+      /// \brief Write the recorded events to a Chrome trace JSON file.
+      /// \param[in] _path Path of the file
+      /// \param[in] _names Names of the sensors by id
+      /// \return True if the file was written
+      public: static bool WriteChromeTrace(const std::string &_path,
+                  const std::map<SensorId, std::string> &_names = {});
+
+      /// \brief Get the name of a stage, as shown in traces.
+      /// \param[in] _stage The stage
+      /// \return Name such as "render", or an empty string if invalid
+      public: static std::string StageName(const TraceStage _stage);
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RECORDINGSINK_HH_
+#define IGNITION_SENSORS_RECORDINGSINK_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message.h>
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+#include <ignition/sensors/Sensor.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class RecordingSinkPrivate;
+    class RecordingReaderPrivate;
+
+    /// \brief One output of a recorded sensor. Each publisher of a sensor
+    /// is its own channel, so sensors with several outputs of the same
+    /// message type, such as RGBD cameras, get one channel per output.
+    /// Channels are numbered in the order of their first message.
+    class IGNITION_SENSORS_VISIBLE RecordingChannel
+    {
+      /// \brief Id of the channel, its index in the channel list
+      public: uint32_t id = 0u;
+
+      /// \brief Id of the sensor
+      public: SensorId sensor = NO_SENSOR;
+
+      /// \brief Name of the sensor
+      public: std::string sensorName;
+
+      /// \brief Topic of the output, or of the sensor if the output has
+      /// no topic of its own, see Sensor::Topic()
+      public: std::string topic;
+
+      /// \brief Full protobuf name of the recorded messages, such as
+      /// "ignition.msgs.Image"
+      public: std::string type;
+    };
+
+    /// \brief Index entry of one recorded message.
+    class IGNITION_SENSORS_VISIBLE RecordingEntry
+    {
+      /// \brief Channel of the message
+      public: uint32_t channel = 0u;
+
+      /// \brief Simulated time of the update that published the message
+      public: std::chrono::steady_clock::duration simTime{
+                  std::chrono::steady_clock::duration::zero()};
+
+      /// \brief Index of the segment file holding the message
+      public: uint32_t segment = 0u;
+
+      /// \brief Offset of the serialized message in the segment file
+      public: uint64_t offset = 0u;
+
+      /// \brief Size of the serialized message
+      public: uint64_t size = 0u;
+    };
+
+    /// \brief In-process sink that records every message published by the
+    /// sensors it's attached to, without going through transport. Sensors
+    /// serialize their messages into reused buffers and hand them to a
+    /// writer thread, which appends them to memory mapped segment files
+    /// of a directory:
+    ///
+    /// * segment_NNNNN.bin: records of a 24 byte header (magic, channel,
+    ///   sim time in nanoseconds and size) followed by the serialized
+    ///   message, padded to 8 bytes. Segments are preallocated with the
+    ///   segment size and truncated to their content when full.
+    /// * index.bin: one fixed size entry per record, see RecordingEntry.
+    /// * channels.txt: one line per channel, see RecordingChannel.
+    ///
+    /// Messages keep their bulk data, such as raw images and point clouds,
+    /// also when the sensor publishes it through shared memory. The queue
+    /// between the sensors and the writer thread is bounded, and sensors
+    /// wait for room rather than lose data when the disk can't keep up.
+    /// Recording isn't supported on Windows.
+    /// \sa Manager::SetRecordingSink(), RecordingReader
+    class IGNITION_SENSORS_VISIBLE RecordingSink
+    {
+      /// \brief Constructor
+      public: RecordingSink();
+
+      /// \brief Destructor. Calls Close().
+      public: ~RecordingSink();
+
+      /// \brief Start recording to a directory, which is created if needed.
+      /// Existing recordings in the directory are overwritten.
+      /// \param[in] _directory Directory of the recording
+      /// \param[in] _segmentBytes Size of each segment file. Messages
+      /// larger than this get a segment of their own.
+      /// \param[in] _queueBytes Maximum number of serialized bytes waiting
+      /// for the writer thread.
+      /// \return False if the directory or the first segment couldn't be
+      /// created.
+      public: bool Open(const std::string &_directory,
+                  const uint64_t _segmentBytes = 256u << 20u,
+                  const uint64_t _queueBytes = 256u << 20u);
+
+      /// \brief Write all queued messages, the index and the channels, and
+      /// stop the writer thread. Sensors must not record during the call.
+      public: void Close();
+
+      /// \brief Get whether the sink is recording.
+      /// \return True between a successful Open() and Close().
+      public: bool IsOpen() const;
+
+      /// \brief Record a message. Called by sensors when they publish, so
+      /// that it's safe to call from the threads that update sensors.
+      /// \param[in] _sensor Sensor that published the message
+      /// \param[in] _output Identifies the output of the sensor, such as
+      /// the address of its publisher
+      /// \param[in] _simTime Simulated time of the update
+      /// \param[in] _msg The message
+      /// \param[in] _topic Topic of the output, or empty to use the topic
+      /// of the sensor. Only the first message of a channel sets it.
+      /// \return False if the sink isn't open or failed to write earlier
+      /// messages.
+      public: bool Record(const Sensor &_sensor, const void *_output,
+                  const std::chrono::steady_clock::duration &_simTime,
+                  const google::protobuf::Message &_msg,
+                  const std::string &_topic = "");
+
+      /// \brief Get the number of messages recorded since Open().
+      /// \return Number of messages handed to the writer thread
+      public: uint64_t RecordCount() const;
+
+      /// \brief Get the number of bytes written since Open().
+      /// \return Number of serialized bytes in the segment files, without
+      /// the record headers.
+      public: uint64_t WrittenBytes() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \internal
+      /// \brief Data pointer for private data
+      private: std::unique_ptr<RecordingSinkPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+
+    /// \brief Reader of the recordings written by RecordingSink. The
+    /// segment file of the last read is kept open, so a reader must not be
+    /// used by several threads at once.
+    class IGNITION_SENSORS_VISIBLE RecordingReader
+    {
+      /// \brief Constructor
+      public: RecordingReader();
+
+      /// \brief Destructor
+      public: ~RecordingReader();
+
+      /// \brief Load the index and the channels of a recording.
+      /// \param[in] _directory Directory of the recording
+      /// \return False if the index or the channels couldn't be read.
+      public: bool Open(const std::string &_directory);
+
+      /// \brief Get the channels of the recording.
+      /// \return Channels, indexed by RecordingChannel::id
+      public: const std::vector<RecordingChannel> &Channels() const;
+
+      /// \brief Get the index of the recording.
+      /// \return One entry per message, in the order they were recorded
+      public: const std::vector<RecordingEntry> &Entries() const;
+
+      /// \brief Read a recorded message.
+      /// \param[in] _entry Index entry of the message
+      /// \param[out] _data Serialized message
+      /// \return False if the message couldn't be read.
+      public: bool Read(const RecordingEntry &_entry, std::string &_data) const;
+
+      /// \brief Read and parse a recorded message.
+      /// \param[in] _entry Index entry of the message
+      /// \param[out] _msg Message to parse into, of the channel's type
+      /// \return False if the message couldn't be read or parsed.
+      public: bool Read(const RecordingEntry &_entry,
+                  google::protobuf::Message &_msg) const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \internal
+      /// \brief Data pointer for private data
+      private: std::unique_ptr<RecordingReaderPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
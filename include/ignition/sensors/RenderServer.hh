@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RENDERSERVER_HH_
+#define IGNITION_SENSORS_RENDERSERVER_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <sdf/Sensor.hh>
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/math/Pose3.hh>
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+#include <ignition/sensors/Manager.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class RenderServerPrivate;
+
+    /// \brief Render side of remote rendering, see
+    /// Manager::SetRemoteRendering(). A render server runs on a node with
+    /// GPUs, next to a copy of the world scene. It holds the same rendering
+    /// sensors as the simulation node, created from the same SDF, in its
+    /// own manager. For each request of the simulation node, it moves the
+    /// models of the scene and the sensors, renders the sensors of the
+    /// request and publishes their outputs in the topic namespace of the
+    /// service, where the simulation node picks them up. Sensors are
+    /// matched by name, so the names of the rendering sensors of a service
+    /// must be unique. A GPU node serves several simulation nodes with one
+    /// server, scene and manager per service.
+    ///
+    /// Usage, on the thread that owns the rendering context:
+    ///
+    ///     ignition::sensors::Manager manager;
+    ///     ignition::sensors::RenderServer server(manager);
+    ///     server.Start("/render/world1");
+    ///     server.CreateSensor(cameraSdf);
+    ///     server.SetSceneCallback(moveVisual);
+    ///     while (running)
+    ///       server.ProcessRequests(std::chrono::milliseconds(100));
+    class IGNITION_SENSORS_VISIBLE RenderServer
+    {
+      /// \brief Constructor
+      /// \param[in] _manager Manager of the sensors of the server, which
+      /// must outlive it
+      public: explicit RenderServer(Manager &_manager);
+
+      /// \brief Destructor. Calls Stop().
+      public: ~RenderServer();
+
+      /// \brief Start serving the requests of a render service.
+      /// \param[in] _service Name of the render service, the same as given
+      /// to Manager::SetRemoteRendering() on the simulation node.
+      /// \return False if the topics of the service couldn't be set up.
+      public: bool Start(const std::string &_service);
+
+      /// \brief Stop serving requests. Pending requests are dropped.
+      public: void Stop();
+
+      /// \brief Create a rendering sensor of the server. The sensor
+      /// publishes in the topic namespace of the service, see
+      /// RemoteRenderOutputTopic(). Call it after Start(), and give the
+      /// sensor a scene as usual.
+      /// \param[in] _sdf SDF of the sensor, as on the simulation node
+      /// \return Id of the sensor in the manager, or NO_SENSOR on error.
+      public: SensorId CreateSensor(const sdf::Sensor &_sdf);
+
+      /// \brief Set the function that moves a model of the scene. It's
+      /// called by ProcessRequests() before rendering, for each model that
+      /// moved since the previous request.
+      /// \param[in] _callback Function taking the name and the new world
+      /// pose of a model, or null to ignore the models.
+      public: void SetSceneCallback(std::function<void(const std::string &,
+                  const math::Pose3d &)> _callback);
+
+      /// \brief Render the requests received since the previous call. Call
+      /// it in a loop on the thread that owns the rendering context.
+      /// \param[in] _timeout Time to wait for a request if none is pending
+      /// \return Number of requests rendered
+      public: std::size_t ProcessRequests(
+                  const std::chrono::steady_clock::duration &_timeout);
+
+      /// \brief Get the number of requests rendered since Start().
+      /// \return Number of rendered requests
+      public: uint64_t RenderedRequestCount() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \internal
+      /// \brief Data pointer for private data
+      private: std::unique_ptr<RenderServerPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
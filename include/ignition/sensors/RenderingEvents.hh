@@ -18,6 +18,11 @@
 #ifndef IGNITION_SENSORS_RENDERINGEVENTS_HH_
 #define IGNITION_SENSORS_RENDERINGEVENTS_HH_
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include <ignition/common/Event.hh>
 #include <ignition/common/SuppressWarning.hh>
 
@@ -42,6 +47,9 @@ namespace ignition
     // Inline bracket to help doxygen filtering.
     inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
     //
+    /// \brief forward declarations
+    class RenderingSensor;
+
     class IGNITION_SENSORS_RENDERING_VISIBLE RenderingEvents
     {
       /// \brief Set a callback to be called when the scene is changed.
@@ -55,6 +63,91 @@ namespace ignition
                   std::function<void(const ignition::rendering::ScenePtr &)>
                   _callback);
 
+      /// \brief Set the scene of the rendering sensors of a world. Unlike
+      /// sceneEvent, which reaches the sensors of the default world only,
+      /// this lets each world of a process change its own scene without
+      /// touching the sensors of the other worlds. Sensors created
+      /// afterwards still need RenderingSensor::SetScene().
+      /// Don't destroy sensors of the world during the call.
+      /// \param[in] _scene The new scene
+      /// \param[in] _world Name of the world, see Sensor::SetWorldName().
+      /// An empty name fires sceneEvent.
+      public: static void SetWorldScene(
+                  const ignition::rendering::ScenePtr &_scene,
+                  const std::string &_world);
+
+      /// \brief Set the scenes of the rendering sensors of a world that
+      /// renders with several devices, one scene per device. Each sensor
+      /// takes the scene of its Sensor::RenderDevice(), and sensors that
+      /// already have that scene are left alone. The scenes must hold the
+      /// same world, each created by a render engine on its own device.
+      /// Don't destroy sensors of the world during the call.
+      /// \param[in] _scenes Scene of each render device
+      /// \param[in] _world Name of the world, empty for the default world.
+      /// \sa Manager::SetRenderDeviceCount()
+      public: static void SetDeviceScenes(
+                  const std::vector<ignition::rendering::ScenePtr> &_scenes,
+                  const std::string &_world);
+
+      /// \brief Set whether scene changes are queued instead of applied
+      /// right away. Applying a scene makes each rendering sensor create
+      /// its cameras in the new scene, which takes long with many sensors
+      /// and must happen on the thread that owns the rendering context.
+      /// When deferred, sceneEvent, SetWorldScene() and SetDeviceScenes()
+      /// only queue the new scenes, and the sensors report that they
+      /// aren't ready until their scene is applied, see Sensor::Ready().
+      /// Sensors updated through the Manager apply their scene when they are
+      /// next due, up to a number of sensors per RunOnce() call, so that
+      /// the work is spread over several frames. Other callers apply the
+      /// queued scenes with ProcessSceneChanges(). Disabled by default.
+      /// \param[in] _deferred True to queue scene changes.
+      /// \param[in] _perFrame Maximum number of sensors applying their scene
+      /// in a RunOnce() call, at least one.
+      public: static void SetDeferredSceneChanges(const bool _deferred,
+                  const unsigned int _perFrame = 4u);
+
+      /// \brief Get whether scene changes are queued.
+      /// \return True if scene changes are queued.
+      /// \sa SetDeferredSceneChanges()
+      public: static bool DeferredSceneChanges();
+
+      /// \brief Apply queued scene changes, oldest first. Call it from the
+      /// thread that owns the rendering context.
+      /// \param[in] _max Maximum number of sensors to apply a scene to
+      /// \return Number of sensors whose scene was applied
+      /// \sa SetDeferredSceneChanges()
+      public: static std::size_t ProcessSceneChanges(const std::size_t _max);
+
+      /// \brief Get the number of sensors waiting for their scene.
+      /// \return Number of queued scene changes
+      /// \sa SetDeferredSceneChanges()
+      public: static std::size_t PendingSceneChangeCount();
+
+      /// \brief Queue a scene change of a sensor, replacing the one it
+      /// already has queued.
+      /// \param[in] _sensor The sensor
+      /// \param[in] _scene Its new scene
+      private: static void QueueSceneChange(RenderingSensor *_sensor,
+                  const ignition::rendering::ScenePtr &_scene);
+
+      /// \brief Apply the queued scene change of a sensor, unless enough
+      /// sensors already applied theirs for the same frame.
+      /// \param[in] _sensor The sensor
+      /// \param[in] _frameId Id of the frame, see Sensor::PrepareFrame()
+      private: static void ApplySceneChange(RenderingSensor *_sensor,
+                  const uint64_t _frameId);
+
+      /// \brief Register a rendering sensor, for SetWorldScene().
+      /// \param[in] _sensor Sensor being constructed
+      private: static void AddSensor(RenderingSensor *_sensor);
+
+      /// \brief Unregister a rendering sensor.
+      /// \param[in] _sensor Sensor being destroyed
+      private: static void RemoveSensor(RenderingSensor *_sensor);
+
+      /// \brief Registers itself on construction
+      friend class RenderingSensor;
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief Event that is used to trigger callbacks when the scene
       /// is changed
@@ -17,6 +17,7 @@
 #ifndef IGNITION_SENSORS_RENDERINGSENSOR_HH_
 #define IGNITION_SENSORS_RENDERINGSENSOR_HH_
 
+#include <cstdint>
 #include <memory>
 
 #include <ignition/common/SuppressWarning.hh>
@@ -58,7 +59,25 @@ namespace ignition
       /// \brief destructor
       public: virtual ~RenderingSensor();
 
-      /// \brief Set the rendering scene.
+      // Documentation inherited
+      public: bool IsRenderingSensor() const override;
+
+      /// \brief Update the scene graph for the given frame, unless another
+      /// rendering sensor sharing the same scene already did so for that
+      /// frame, or ManualSceneUpdate() is enabled. The next call to Render()
+      /// then skips the scene update. A queued scene change is applied
+      /// first, see RenderingEvents::SetDeferredSceneChanges().
+      /// \param[in] _frameId Id of the frame.
+      public: void PrepareFrame(const uint64_t _frameId) override;
+
+      /// \brief Get whether the sensor has its scene. This is false while
+      /// a scene change is queued, see
+      /// RenderingEvents::SetDeferredSceneChanges().
+      /// \return True unless a scene change is queued.
+      public: bool Ready() const override;
+
+      /// \brief Set the rendering scene. Changing the scene removes the
+      /// sensors added with AddSensor(), which belong to the previous scene.
       ///
       /// \param[in] _scene Pointer to the scene
       public: virtual void SetScene(rendering::ScenePtr _scene);
@@ -69,9 +88,29 @@ namespace ignition
       /// \brief Render update. This performs the actual render operation.
       public: void Render();
 
+      /// \brief Render the cameras added through AddSensor() once, which
+      /// compiles their shaders and creates their render passes, without
+      /// recording the render time.
+      /// \return False if the sensor has no scene or camera yet.
+      public: bool WarmUp() override;
+
+      /// \brief Render a single camera. The scene is updated the same way as
+      /// in Render(), but only _camera is rendered, whether it was added
+      /// through AddSensor() or not.
+      /// \param[in] _camera Camera to render.
+      protected: void RenderCamera(const rendering::CameraPtr &_camera);
+
+      /// \brief Callback of RenderingEvents::sceneEvent, which sets the
+      /// scene of sensors of the default world only. Sensors of a named
+      /// world get theirs from RenderingEvents::SetWorldScene().
+      /// \param[in] _scene The new scene
+      /// \sa Sensor::SetWorldName()
+      protected: void OnSceneChange(const rendering::ScenePtr &_scene);
+
       /// \brief Set whether to update the scene graph manually. If set to true,
       /// it is expected that rendering::Scene::PreRender is called manually
-      /// before calling Render()
+      /// before calling Render(). Sensors updated through Manager::RunOnce
+      /// don't need this, since the scene is updated only once per call.
       /// \param[in] _manual True to enable manual scene graph update
       public: void SetManualSceneUpdate(bool _manual);
 
@@ -82,10 +121,41 @@ namespace ignition
       public: bool ManualSceneUpdate() const;
 
       /// \brief Add a rendering::Sensor. Its render updates will be handled
-      /// by this base class.
+      /// by this base class. Only cameras are rendered, and a sensor added
+      /// more than once is rendered once.
       /// \param[in] _sensor Sensor to add.
       protected: void AddSensor(rendering::SensorPtr _sensor);
 
+      /// \brief Get the anti-aliasing level of rendering cameras for the
+      /// render quality profile of this sensor.
+      /// \return 2 for RenderQualityProfile::FULL, 0 for
+      /// RenderQualityProfile::FAST.
+      /// \sa Sensor::RenderQuality()
+      protected: unsigned int QualityAntiAliasing() const;
+
+      /// \brief Get the scale of the internal resolution of color images for
+      /// the render quality profile of this sensor. Sensors that support it
+      /// render at the scaled resolution, then resample to the requested
+      /// size.
+      /// \return 1 for RenderQualityProfile::FULL, 0.5 for
+      /// RenderQualityProfile::FAST.
+      /// \sa Sensor::RenderQuality()
+      protected: double QualityResolutionScale() const;
+
+      /// \brief Estimate the GPU memory of the render target of a camera,
+      /// for MemoryUsage(), from its image size and pixel format.
+      /// \param[in] _camera Camera, may be null.
+      /// \return Bytes of the color target, 0 for a null camera.
+      protected: static uint64_t RenderTargetBytes(
+                     const rendering::CameraPtr &_camera);
+
+      /// \brief Set whether a scene change is queued for this sensor.
+      /// \param[in] _pending True while a scene change is queued.
+      private: void SetScenePending(const bool _pending);
+
+      /// \brief Queues and applies scene changes
+      friend class RenderingEvents;
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \internal
       /// \brief Data pointer for private data
@@ -27,14 +27,20 @@
 #pragma warning(pop)
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include <ignition/common/SuppressWarning.hh>
 #include <ignition/common/Time.hh>
 #include <ignition/math/Pose3.hh>
+#include <ignition/transport/Node.hh>
 #include <ignition/sensors/config.hh>
 #include <ignition/sensors/Export.hh>
+#include <ignition/sensors/SensorStats.hh>
 #include <sdf/sdf.hh>
 
 namespace ignition
@@ -44,10 +50,84 @@ namespace ignition
     // Inline bracket to help doxygen filtering.
     inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
     //
+    // Forward declarations
+    class ModelPoseSnapshot;
+    class RecordingSink;
+
     /// \brief A string used to identify a sensor
     using SensorId = std::size_t;
     const SensorId NO_SENSOR = 0;
 
+    /// \brief How a sensor recovers after falling behind its update rate,
+    /// for example after the simulation stalled or the caller skipped time.
+    enum class CatchUpPolicy : int
+    {
+      /// \brief Update on every call until all missed updates have been
+      /// generated. This is the default.
+      BURST = 0,
+
+      /// \brief Generate a single update and skip all missed ones.
+      SKIP = 1,
+
+      /// \brief Like BURST, but generate at most a maximum number of missed
+      /// updates and skip the rest.
+      CAP = 2
+    };
+
+    /// \brief What an asynchronously publishing sensor does with a new
+    /// message when its publish queue is full.
+    /// \sa Sensor::SetAsyncPublish()
+    enum class PublishDropPolicy : int
+    {
+      /// \brief Drop the oldest queued message. This is the default.
+      DROP_OLDEST = 0,
+
+      /// \brief Drop the new message.
+      DROP_NEWEST = 1,
+
+      /// \brief Wait until the queue has room.
+      BLOCK = 2
+    };
+
+    /// \brief Encoding of the compressed image output of camera sensors.
+    /// \sa CameraSensor::SetCompressedOutput()
+    enum class ImageCompression : int
+    {
+      /// \brief No compressed output. This is the default.
+      NONE = 0,
+
+      /// \brief Lossless PNG, for 8 and 16 bit images. Requires zlib.
+      PNG = 1,
+
+      /// \brief Lossy JPEG, for 8 bit images. Requires libjpeg.
+      JPEG = 2
+    };
+
+    /// \brief File format of the frames saved by camera sensors.
+    /// \sa CameraSensor::SetSaveFileFormat()
+    enum class FrameFileFormat : int
+    {
+      /// \brief PNG files. This is the default.
+      PNG = 0,
+
+      /// \brief Uncompressed binary PGM and PPM files, which are much faster
+      /// to write. Images that don't fit these formats are saved as PNG.
+      PNM = 1
+    };
+
+    /// \brief Trade-off between fidelity and throughput of rendering sensors.
+    /// \sa Sensor::SetRenderQuality()
+    enum class RenderQualityProfile : int
+    {
+      /// \brief Anti-aliased images at full resolution. This is the
+      /// default.
+      FULL = 0,
+
+      /// \brief No anti-aliasing, and color images rendered at half
+      /// resolution then scaled to the requested size.
+      FAST = 1
+    };
+
     /// \brief forward declarations
     class SensorPrivate;
 
@@ -74,6 +154,19 @@ namespace ignition
       /// \return true if loading was successful
       public: virtual bool Load(sdf::ElementPtr _sdf);
 
+      /// \brief Change the configuration of a loaded sensor in place,
+      /// without destroying and creating it again. The name, type and
+      /// topic must stay the same. The default implementation changes the
+      /// settings common to all sensors, such as the update rate, pose and
+      /// priority, and refuses any other change. Sensors override this to
+      /// also change their own settings, reusing their resources where
+      /// they can. Don't call it while the sensor updates.
+      /// \param[in] _sdf New SDF of the sensor
+      /// \return False if the sensor must be created again to apply _sdf,
+      /// in which case it is unchanged.
+      /// \sa Manager::ReconfigureSensor()
+      public: virtual bool Reconfigure(const sdf::Sensor &_sdf);
+
       /// \brief Initialize values in the sensor
       public: virtual bool Init();
 
@@ -145,7 +238,10 @@ namespace ignition
       /// function returned true.
       /// False otherwise.
       /// \remarks If forced the NextUpdateTime() will be unchanged.
+      /// \remarks Update times are computed with nanosecond precision from
+      /// the time the update rate was set, so they don't drift.
       /// \sa virtual bool Update(const common::Time &_name) = 0
+      /// \sa SetCatchUpPolicy()
       public: bool Update(
         const std::chrono::steady_clock::duration &_now, const bool _force);
 
@@ -162,6 +258,105 @@ namespace ignition
       /// \param[in] _hz Update rate of sensor in Hertz.
       public: void SetUpdateRate(const double _hz);
 
+      /// \brief Set how the sensor recovers after falling behind its update
+      /// rate. Update times are always multiples of the update period, so
+      /// skipped updates don't shift the phase of later ones.
+      /// \param[in] _policy The catch-up policy.
+      /// \param[in] _maxMissed Maximum number of missed updates generated
+      /// after falling behind. Only used by CatchUpPolicy::CAP.
+      public: void SetCatchUpPolicy(const CatchUpPolicy _policy,
+                  const unsigned int _maxMissed = 1u);
+
+      /// \brief Get the catch-up policy.
+      /// \return How the sensor recovers after falling behind.
+      /// \sa SetCatchUpPolicy()
+      public: CatchUpPolicy CatchUp() const;
+
+      /// \brief Get the maximum number of missed updates generated after
+      /// falling behind, when using CatchUpPolicy::CAP.
+      /// \return Maximum number of missed updates.
+      public: unsigned int MaxMissedUpdates() const;
+
+      /// \brief Set the priority of the sensor. When the Manager runs with
+      /// a time budget, due sensors with a higher priority are updated
+      /// first. The priority can also be set in SDF with an
+      /// <ignition:priority> element inside <sensor>. It's zero by default.
+      /// \param[in] _priority The priority.
+      /// \sa Manager::RunOnce()
+      public: void SetPriority(const int _priority);
+
+      /// \brief Get the priority of the sensor.
+      /// \return The priority.
+      /// \sa SetPriority()
+      public: int Priority() const;
+
+      /// \brief Set the render quality profile of the sensor. It can also
+      /// be set in SDF with an <ignition:render_quality> element inside
+      /// <sensor>, containing "full" or "fast". Non-rendering sensors
+      /// ignore it. Rendering sensors apply it when they create their
+      /// rendering objects, which happens when their scene is set.
+      /// \param[in] _profile Render quality profile.
+      /// \sa Manager::SetRenderQuality()
+      public: void SetRenderQuality(const RenderQualityProfile _profile);
+
+      /// \brief Get the render quality profile of the sensor.
+      /// \return Render quality profile, RenderQualityProfile::FULL by
+      /// default.
+      /// \sa SetRenderQuality()
+      public: RenderQualityProfile RenderQuality() const;
+
+      /// \brief Delay the update schedule of the sensor by a fraction of its
+      /// update period. Update times become the current next update time
+      /// plus _offset plus multiples of the period.
+      /// \param[in] _offset Delay of the schedule. Values outside of
+      /// [0, period) are wrapped into it.
+      /// \sa Manager::SetStaggerUpdates()
+      public: void SetUpdatePhase(
+                  const std::chrono::steady_clock::duration &_offset);
+
+      /// \brief Set whether the Manager may delay the first update of this
+      /// sensor to spread sensors with equal update rates over the update
+      /// period. True by default.
+      /// \param[in] _staggerable False to opt out of staggering.
+      /// \sa Manager::SetStaggerUpdates()
+      public: void SetStaggerable(const bool _staggerable);
+
+      /// \brief Get whether the Manager may stagger this sensor.
+      /// \return True if the sensor may be staggered.
+      /// \sa SetStaggerable()
+      public: bool Staggerable() const;
+
+      /// \brief Set a function to call whenever the update schedule of this
+      /// sensor changes outside of Update(), for example when
+      /// SetUpdateRate() is called. The Manager uses this to keep its
+      /// update queue in sync. Only one callback can be set; passing an
+      /// empty function removes it.
+      /// \param[in] _callback Function called with the id of this sensor.
+      /// It may be called from the thread updating the sensor.
+      public: void SetScheduleChangedCallback(
+                  std::function<void(SensorId)> _callback);
+
+      /// \brief Set a function to call with each message published on the
+      /// topic of this sensor, see Topic(). Messages of the other outputs
+      /// aren't passed. The Manager uses this to aggregate the readings of
+      /// many sensors, see Manager::SetAggregatedTopic(). Only one callback
+      /// can be set; passing an empty function removes it.
+      /// \param[in] _callback Function called with the id of this sensor
+      /// and the message. It's called from the thread updating the sensor.
+      public: void SetPublishCallback(std::function<void(SensorId,
+                  const google::protobuf::Message &)> _callback);
+
+      /// \brief Set the node this sensor advertises its topics and
+      /// services on. Nodes take part in discovery and keep state of their
+      /// own, so the Manager gives all the sensors it creates one node
+      /// instead of one each. It has to be set before Load(); sensors
+      /// without one create their own node when they first advertise.
+      /// \param[in] _node The node, which may be shared by other sensors.
+      /// \return False if this sensor already advertised on another node,
+      /// in which case it keeps that one.
+      public: bool SetTransportNode(
+                  std::shared_ptr<ignition::transport::Node> _node);
+
       /// \brief Get the current pose.
       /// \return Current pose of the sensor.
       public: ignition::math::Pose3d Pose() const;
@@ -189,15 +384,285 @@ namespace ignition
       /// \return Parent link of sensor.
       public: std::string Parent() const;
 
+      /// \brief Set the name of the world the sensor belongs to. Rendering
+      /// sensors of a named world ignore RenderingEvents::sceneEvent and
+      /// only take the scenes set for their world with
+      /// RenderingEvents::SetWorldScene(), so that several worlds, each
+      /// with its own scene, can run in one process.
+      /// \param[in] _world Name of the world, empty for the default world.
+      /// \sa Manager::SetWorldName()
+      public: void SetWorldName(const std::string &_world);
+
+      /// \brief Get the name of the world the sensor belongs to.
+      /// \return Name of the world, empty for the default world.
+      /// \sa SetWorldName()
+      public: std::string WorldName() const;
+
+      /// \brief Set the render device of the sensor, the index of the GPU,
+      /// and so of the scene, it renders with when its world has one scene
+      /// per GPU. Only used by rendering sensors.
+      /// \param[in] _device Index of the render device
+      /// \sa Manager::SetRenderDeviceCount()
+      /// \sa RenderingEvents::SetDeviceScenes()
+      public: void SetRenderDevice(const unsigned int _device);
+
+      /// \brief Get the render device of the sensor.
+      /// \return Index of the render device, 0 by default.
+      /// \sa SetRenderDevice()
+      public: unsigned int RenderDevice() const;
+
       /// \brief Get the sensor's ID.
       /// \return The sensor's ID.
       public: SensorId Id() const;
 
-      /// \brief Get the SDF used to load this sensor.
+      /// \brief Get whether this sensor generates data using a rendering
+      /// scene. Rendering sensors must be updated from the thread that owns
+      /// the rendering context, so the Manager never updates them
+      /// concurrently.
+      /// \return True if this is a rendering sensor. Defaults to false.
+      public: virtual bool IsRenderingSensor() const;
+
+      /// \brief Prepare for an update driven by the Manager. Before updating
+      /// any of the due rendering sensors in a RunOnce call, the Manager
+      /// calls this on each of them with the same frame id. Rendering
+      /// sensors use it to update each rendering scene only once per call.
+      /// The default implementation does nothing.
+      /// \param[in] _frameId Id unique to the current RunOnce call. It is
+      /// never zero.
+      /// \sa IsRenderingSensor()
+      public: virtual void PrepareFrame(const uint64_t _frameId);
+
+      /// \brief Build what the first update would otherwise create lazily,
+      /// such as the shaders and render passes of rendering sensors, so
+      /// that the first updates aren't slow. Nothing is published. The
+      /// default implementation does nothing.
+      /// \return True if something was built.
+      /// \sa Manager::WarmUp()
+      public: virtual bool WarmUp();
+
+      /// \brief Get whether this sensor can split its updates into stages.
+      /// \return True if SetStagedUpdates() is supported. Defaults to false.
+      /// \sa SetStagedUpdates()
+      public: virtual bool SupportsStagedUpdates() const;
+
+      /// \brief Set whether updates are split into stages, so that a caller
+      /// updating many rendering sensors can render all of them before
+      /// reading any of them back. When enabled, Update() only renders a
+      /// frame, ReadbackFrame() copies that frame to memory, and
+      /// ProcessFrame() builds and publishes its messages and calls the data
+      /// callbacks. Ignored by sensors that don't support it. Disabled by
+      /// default.
+      /// \param[in] _staged True to split updates into stages.
+      /// \sa Manager::SetBatchedRendering()
+      public: void SetStagedUpdates(const bool _staged);
+
+      /// \brief Get whether updates are split into stages.
+      /// \return True if staged updates are enabled and supported.
+      /// \sa SetStagedUpdates()
+      public: bool StagedUpdates() const;
+
+      /// \brief Copy the frame rendered by the last staged update to memory.
+      /// Call it from the thread that owns the rendering context. Does
+      /// nothing if no frame is pending. The default implementation does
+      /// nothing.
+      /// \sa SetStagedUpdates()
+      public: virtual void ReadbackFrame();
+
+      /// \brief Generate the output of the frame copied by the last
+      /// ReadbackFrame(). This doesn't use the rendering context, so it can
+      /// run on any thread, concurrently with ProcessFrame() of other
+      /// sensors. Does nothing if no frame is pending. The default
+      /// implementation does nothing.
+      /// \sa SetStagedUpdates()
+      public: virtual void ProcessFrame();
+
+      /// \brief Get whether anything consumes the data of this sensor, such
+      /// as transport subscribers or connected callbacks. Sensors override
+      /// this to report the consumers of their outputs. The default
+      /// implementation returns true.
+      /// \return True if the sensor has consumers.
+      /// \sa SetLazyUpdates()
+      public: virtual bool HasConnections() const;
+
+      /// \brief Get whether the sensor has the resources it needs to
+      /// update, such as the cameras of a rendering sensor after a scene
+      /// change. Updates of a sensor that isn't ready are skipped, even
+      /// forced ones, and counted in SensorStats::skippedUpdateCount, and
+      /// the schedule keeps going. The default implementation returns true.
+      /// \return True if the sensor can update.
+      /// \sa RenderingEvents::SetDeferredSceneChanges()
+      public: virtual bool Ready() const;
+
+      /// \brief Set whether updates are skipped while the sensor has no
+      /// consumers. Skipped updates don't generate any data, and are counted
+      /// in SensorStats::skippedUpdateCount. Forced updates are never
+      /// skipped. This is disabled by default, because some applications
+      /// read sensor data directly through the C++ API, without any
+      /// subscriber.
+      /// \param[in] _lazy True to skip updates without consumers.
+      /// \sa HasConnections()
+      public: void SetLazyUpdates(const bool _lazy);
+
+      /// \brief Get whether updates are skipped while the sensor has no
+      /// consumers.
+      /// \return True if updates without consumers are skipped.
+      /// \sa SetLazyUpdates()
+      public: bool LazyUpdates() const;
+
+      /// \brief Set whether this sensor only updates when triggered, such
+      /// as cameras that capture a frame on request. A triggered sensor
+      /// ignores its update rate and stays idle, with the Manager not
+      /// visiting it, until Trigger() is called or a true
+      /// ignition::msgs::Boolean arrives on its trigger topic. It then
+      /// updates once, on the next update, stamped with the time of that
+      /// update. Triggers that arrive before that update coalesce into one
+      /// frame. Forced updates still happen. It can also be set with the
+      /// <ignition:triggered> SDF element of the sensor.
+      /// \param[in] _triggered True to only update when triggered.
+      /// \sa SetTriggerTopic()
+      public: void SetTriggered(const bool _triggered);
+
+      /// \brief Get whether this sensor only updates when triggered.
+      /// \return True if the sensor only updates when triggered.
+      /// \sa SetTriggered()
+      public: bool Triggered() const;
+
+      /// \brief Request one update of a triggered sensor. Safe to call from
+      /// any thread. Does nothing for sensors that aren't triggered.
+      /// \sa SetTriggered()
+      public: void Trigger();
+
+      /// \brief Get whether a trigger is waiting for the next update.
+      /// \return True if the sensor was triggered since its last update.
+      public: bool TriggerPending() const;
+
+      /// \brief Subscribe to a topic of ignition::msgs::Boolean messages,
+      /// each true message triggering the sensor. Init() subscribes
+      /// triggered sensors to the topic in the <ignition:trigger_topic> SDF
+      /// element, or to the topic of the sensor followed by "/trigger".
+      /// \param[in] _topic The topic.
+      /// \return False if _topic is invalid or couldn't be subscribed to,
+      /// in which case the previous topic is kept.
+      public: bool SetTriggerTopic(const std::string &_topic);
+
+      /// \brief Get the topic the triggers of this sensor are received on.
+      /// \return The topic, empty if not subscribed.
+      public: std::string TriggerTopic() const;
+
+      /// \brief Set whether the outputs of this sensor are rendered by a
+      /// remote render service instead of this process. Updates then only
+      /// keep the schedule going, and the outputs arrive through
+      /// ReplayMessage(). Forced updates are remote too.
+      /// \param[in] _remote True if the sensor is rendered remotely.
+      /// \sa Manager::SetRemoteRendering()
+      public: void SetRemoteRendered(const bool _remote);
+
+      /// \brief Get whether the outputs of this sensor are rendered by a
+      /// remote render service.
+      /// \return True if the sensor is rendered remotely.
+      /// \sa SetRemoteRendered()
+      public: bool RemoteRendered() const;
+
+      /// \brief Set whether messages are held back until CommitPublishes()
+      /// instead of being published during the update. Recording is held
+      /// back too. This lets a caller that updates many sensors
+      /// concurrently publish their messages in a fixed order. Disabling
+      /// publishes the messages held back. Messages given to
+      /// ReplayMessage() are never held back. This must not be called while
+      /// the sensor updates.
+      /// \param[in] _deferred True to hold messages back.
+      /// \sa Manager::SetDeterministic()
+      public: void SetDeferredPublish(const bool _deferred);
+
+      /// \brief Get whether messages are held back until CommitPublishes().
+      /// \return True if messages are held back.
+      /// \sa SetDeferredPublish()
+      public: bool DeferredPublish() const;
+
+      /// \brief Record and publish the messages held back since the
+      /// previous call, in the order they were published. Call it between
+      /// updates.
+      /// \return False if a message couldn't be published or was dropped.
+      /// \sa SetDeferredPublish()
+      public: bool CommitPublishes();
+
+      /// \brief Get whether the consumers of this sensor are still busy
+      /// with earlier data. The default implementation returns true while
+      /// the asynchronous publish queue of the sensor holds or sends
+      /// messages. Sensors override this to also report their own
+      /// consumers, such as callbacks that are still running.
+      /// \return True if earlier data hasn't been consumed yet.
+      /// \sa SetBackpressure()
+      public: virtual bool ConsumersBusy() const;
+
+      /// \brief Set the poses of the models in the world, shared by all the
+      /// sensors that need them. Sensors that don't use model poses ignore
+      /// them, which is what the default implementation does.
+      /// \param[in] _snapshot Poses of the models, or null to clear them.
+      /// \sa Manager::SetModelPoses()
+      public: virtual void SetModelPoseSnapshot(
+                  std::shared_ptr<const ModelPoseSnapshot> _snapshot);
+
+      /// \brief Set whether updates are skipped while the consumers of this
+      /// sensor are still busy with earlier data, so that slow consumers
+      /// don't make the sensor generate data that would only pile up.
+      /// Skipped updates don't generate any data, and are counted in
+      /// SensorStats::skippedUpdateCount and
+      /// SensorStats::backpressureSkipCount. Forced updates are never
+      /// skipped. Synchronous publishing returns once messages are sent, so
+      /// slow subscribers are only detected together with SetAsyncPublish().
+      /// This is disabled by default.
+      /// \param[in] _enable True to skip updates while consumers are busy.
+      /// \sa ConsumersBusy()
+      public: void SetBackpressure(const bool _enable);
+
+      /// \brief Get whether updates are skipped while the consumers of this
+      /// sensor are busy.
+      /// \return True if updates are skipped while consumers are busy.
+      /// \sa SetBackpressure()
+      public: bool Backpressure() const;
+
+      /// \brief Get the SDF used to load this sensor. The element is copied
+      /// on the first call after loading, so sensors that never call this
+      /// don't pay for the copy. Compact sensors copy it on every call and
+      /// don't keep it. Prefer SdfSensor() where possible.
       /// \return Pointer to an SDF element that contains initialization
-      /// information for this sensor.
+      /// information for this sensor, or nullptr if the sensor wasn't
+      /// loaded from SDF.
+      /// \sa SetCompact()
       public: sdf::ElementPtr SDF() const;
 
+      /// \brief Get the SDF DOM object used to load this sensor. If the
+      /// sensor shares the SDF of another sensor, see ShareSdf(), the name,
+      /// topic, update rate and pose are those of the other sensor; use
+      /// Name(), Topic(), UpdateRate() and Pose() instead.
+      /// \return SDF sensor DOM object. It is empty if the sensor hasn't
+      /// been loaded.
+      public: const sdf::Sensor &SdfSensor() const;
+
+      /// \brief Set whether this sensor keeps as little state as it can,
+      /// for worlds with very many sensors. Compact sensors don't keep the
+      /// copy of their SDF element SDF() makes. The Manager also shares the
+      /// SDF of compact sensors with the sensors cloned from them.
+      /// \param[in] _compact True to keep as little state as possible.
+      /// \sa Manager::SetCompactSensors()
+      public: void SetCompact(const bool _compact);
+
+      /// \brief Get whether this sensor keeps as little state as it can.
+      /// \return True if compact.
+      /// \sa SetCompact()
+      public: bool Compact() const;
+
+      /// \brief Share the SDF DOM object of another sensor instead of
+      /// keeping a copy, see SdfSensor(). It's only shared if both SDFs are
+      /// the same apart from the name, topic, update rate and pose, as for
+      /// sensors cloned from one another. Loading or reconfiguring the
+      /// sensor gives it its own copy again.
+      /// \param[in] _source Sensor whose SDF to share. Both sensors must be
+      /// loaded.
+      /// \return True if the SDF is shared.
+      public: bool ShareSdf(const Sensor &_source);
+
       /// \brief Add a sequence number to an ignition::msgs::Header. This
       /// function can be called by a sensor that wants to add a sequence
       /// number to a sensor message in order to have improved
@@ -219,6 +684,209 @@ namespace ignition
       public: void AddSequence(ignition::msgs::Header *_msg,
                   const std::string &_seqKey = "default");
 
+      /// \brief Set the stamp, the "frame_id" entry and the "seq" entry of
+      /// a message header. The frame id is the name of the sensor, and the
+      /// sequence number is the same as the one from AddSequence(). The
+      /// entries are added the first time a header is stamped. When a
+      /// message is kept between updates, later calls only overwrite the
+      /// values in place, so stamping doesn't allocate memory.
+      /// \param[in,out] _msg The header to stamp.
+      /// \param[in] _now Time stamp of the message.
+      /// \param[in] _seqKey Name of the sequence to use.
+      public: void StampHeader(ignition::msgs::Header *_msg,
+                  const std::chrono::steady_clock::duration &_now,
+                  const std::string &_seqKey = "default");
+
+      /// \brief Set whether messages are published from background threads.
+      /// When enabled, each message is copied into a bounded queue of this
+      /// sensor during Update(), and serialized and sent later, so that
+      /// slow transport doesn't stall the caller. Messages of a sensor are
+      /// always published in order. Disabling waits for all queued
+      /// messages to be published. This must not be called while the
+      /// sensor updates.
+      /// \param[in] _async True to publish asynchronously.
+      /// \param[in] _queueDepth Maximum number of queued messages.
+      /// \param[in] _policy What to do with new messages when the queue is
+      /// full.
+      public: void SetAsyncPublish(const bool _async,
+                  const std::size_t _queueDepth = 2u,
+                  const PublishDropPolicy _policy =
+                      PublishDropPolicy::DROP_OLDEST);
+
+      /// \brief Get whether messages are published asynchronously.
+      /// \return True if messages are published from background threads.
+      /// \sa SetAsyncPublish()
+      public: bool AsyncPublish() const;
+
+      /// \brief Set whether large data such as images and point clouds is
+      /// passed through shared memory. When enabled, sensors that support it
+      /// copy their data into a ring of shared memory slots owned by the
+      /// sensor and publish messages with an empty data field and a header
+      /// entry with the key "shm", whose values are the ring name, the
+      /// sequence number of the write and the data size. Consumers on the
+      /// same host read the data with SharedMemoryRing, without
+      /// deserializing it. Callbacks registered on the sensor still receive
+      /// the full data. This must not be called while the sensor updates.
+      /// \param[in] _enable True to publish through shared memory.
+      /// \param[in] _slotCount Number of slots of each ring. More slots give
+      /// slow consumers more time to read the data before it is overwritten.
+      /// \return False if shared memory is not supported on this platform.
+      /// \sa SharedMemoryRing
+      public: bool SetSharedMemoryPublishing(const bool _enable,
+                  const std::size_t _slotCount = 4u);
+
+      /// \brief Set a sink that records every message this sensor
+      /// publishes, with its bulk data also when it's published through
+      /// shared memory. This must not be called while the sensor updates.
+      /// \param[in] _sink The sink, or null to stop recording.
+      /// \sa Manager::SetRecordingSink()
+      public: void SetRecordingSink(std::shared_ptr<RecordingSink> _sink);
+
+      /// \brief Publish a recorded message on the output of this sensor
+      /// with the given topic, in place of an update, see
+      /// Manager::SetReplay(). The message isn't recorded again. The default
+      /// implementation publishes it through the publisher registered with
+      /// SetOutputTopic(). Sensors override this to also hand the message
+      /// to their callbacks.
+      /// \param[in] _topic Topic of the output the message was recorded on
+      /// \param[in] _msg The recorded message
+      /// \return False if the sensor has no output on _topic.
+      public: virtual bool ReplayMessage(const std::string &_topic,
+                  const google::protobuf::Message &_msg);
+
+      /// \brief Get the topics of the outputs of this sensor.
+      /// \return Topics registered with SetOutputTopic(), in the order
+      /// they were registered.
+      public: std::vector<std::string> OutputTopics() const;
+
+      /// \brief Get whether data is published through shared memory.
+      /// \return True if data is published through shared memory.
+      /// \sa SetSharedMemoryPublishing()
+      public: bool SharedMemoryPublishing() const;
+
+      /// \brief Get the runtime statistics of this sensor. Statistics are
+      /// collected on every update and are cheap to keep.
+      /// \return A copy of the current statistics.
+      /// \sa ResetStats()
+      public: SensorStats Stats() const;
+
+      /// \brief Reset all runtime statistics to zero.
+      public: void ResetStats();
+
+      /// \brief Get the memory currently held by this sensor for its render
+      /// targets, readback buffers and messages. Sensors override this to
+      /// report their buffers, the default implementation reports nothing.
+      /// Call it between updates.
+      /// \return Memory of the sensor
+      /// \sa Manager::MemoryUsage()
+      public: virtual SensorMemory MemoryUsage() const;
+
+      /// \brief Record the wall time spent in a phase of the current update,
+      /// and the heap allocations made since the previous phase, see
+      /// SensorStats::RecordAllocation(). Sensors call this from their
+      /// Update() function.
+      /// \param[in] _phase The update phase.
+      /// \param[in] _start Wall time when the phase started. The phase is
+      /// assumed to end now.
+      protected: void RecordPhase(const UpdatePhase _phase,
+                     const std::chrono::steady_clock::time_point &_start);
+
+      /// \brief Record the number of serialized bytes of a message that was
+      /// just published, and its delay since its data was sampled, see
+      /// SensorStats::publishDelay. The data is assumed to be sampled by the
+      /// update matching the stamp given to the last StampHeader() call.
+      /// \param[in] _bytes Size of the message.
+      protected: void RecordPublishedBytes(const uint64_t _bytes);
+
+      /// \brief Record the number of bytes just copied out of the rendering
+      /// engine, see SensorStats::bytesReadBack.
+      /// \param[in] _bytes Size of the copied data.
+      protected: void RecordReadbackBytes(const uint64_t _bytes);
+
+      /// \brief Record that the current update was skipped, for example
+      /// because there were no consumers for the data.
+      protected: void RecordSkippedUpdate();
+
+      /// \brief Record that a frame wasn't saved to disk because the frame
+      /// writer was still busy with earlier frames.
+      protected: void RecordDroppedSave();
+
+      /// \brief Get the seed for one of the noise models of this sensor.
+      /// It is derived from the global ignition::math::Rand seed, the name
+      /// and topic of this sensor, and _stream, so repeated runs with the
+      /// same global seed get the same noise no matter in which order or
+      /// on which threads sensors are updated.
+      /// \param[in] _stream Identifies the noise model within this sensor,
+      /// typically its SensorNoiseType.
+      /// \return Seed to pass to Noise::SetSeed().
+      protected: std::uint64_t NoiseSeed(unsigned int _stream) const;
+
+      /// \brief Get the node to advertise the topics and services of this
+      /// sensor on. The node may be shared with other sensors, so sensors
+      /// unadvertise their services before they're destroyed. Publishers
+      /// are unadvertised when they are destroyed.
+      /// \return The node set with SetTransportNode(), or a node of this
+      /// sensor if none was set.
+      protected: ignition::transport::Node &TransportNode();
+
+      /// \brief Get whether the messages of a publisher of this sensor are
+      /// consumed, either by transport subscribers or by the recording
+      /// sink. Sensors check this before building messages.
+      /// \param[in] _pub Publisher of the messages.
+      /// \return True if _pub is valid and has subscribers, or this sensor
+      /// is recording.
+      /// \sa SetRecordingSink()
+      protected: bool HasConsumers(
+                     const ignition::transport::Node::Publisher &_pub) const;
+
+      /// \brief Set the topic of an output of this sensor, so that
+      /// recordings tell its messages apart by topic and replays publish
+      /// them on it again. Sensors call this after advertising each
+      /// publisher. The publisher must stay at the same address while it's
+      /// registered, so register them again after moving them.
+      /// \param[in] _topic Topic the publisher was advertised on
+      /// \param[in] _pub The publisher, or null to remove the output.
+      /// \sa ReplayMessage()
+      protected: void SetOutputTopic(const std::string &_topic,
+                     ignition::transport::Node::Publisher *_pub);
+
+      /// \brief Apply the settings of a new SDF that are common to all
+      /// sensors, see Reconfigure(). Sensors call this from Reconfigure()
+      /// once they know they can apply their own settings.
+      /// \param[in] _sdf New SDF of the sensor
+      /// \return False if the name, type or topic changed, in which case
+      /// nothing is applied.
+      protected: bool ReconfigureCommon(const sdf::Sensor &_sdf);
+
+      /// \brief Publish a message, either right away or through the
+      /// publish queue of this sensor. Sensors should publish their data
+      /// with this instead of calling _pub.Publish() directly.
+      /// \param[in] _pub Publisher to send the message with.
+      /// \param[in] _msg The message.
+      /// \return False if the message couldn't be published or was dropped.
+      /// \sa SetAsyncPublish()
+      protected: bool Publish(ignition::transport::Node::Publisher &_pub,
+                     const google::protobuf::Message &_msg);
+
+      /// \brief Publish a message whose bulk data may be passed through
+      /// shared memory. If shared memory publishing is disabled, this is the
+      /// same as Publish(). Otherwise _data is written to a ring of this
+      /// sensor and left out of the published message. The message is
+      /// unchanged when this returns.
+      /// \param[in] _pub Publisher to send the message with.
+      /// \param[in] _msg The message.
+      /// \param[in] _data The bulk data field of _msg.
+      /// \param[in] _header The header of _msg.
+      /// \param[in] _ringKey Identifies the ring, for sensors that publish
+      /// more than one kind of data.
+      /// \return False if the message couldn't be published or was dropped.
+      /// \sa SetSharedMemoryPublishing()
+      protected: bool PublishShared(
+                     ignition::transport::Node::Publisher &_pub,
+                     google::protobuf::Message &_msg, std::string *_data,
+                     ignition::msgs::Header *_header,
+                     const std::string &_ringKey = "default");
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \internal
       /// \brief Data pointer for private data
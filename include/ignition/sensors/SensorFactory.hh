@@ -17,9 +17,11 @@
 #ifndef IGNITION_SENSORS_SENSORFACTORY_HH_
 #define IGNITION_SENSORS_SENSORFACTORY_HH_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <type_traits>
+#include <vector>
 #include <sdf/sdf.hh>
 
 #include <ignition/common/Console.hh>
@@ -63,6 +65,18 @@ namespace ignition
               };
     };
 
+    /// \brief Entry of a table of sensor types linked into the application
+    /// instead of loaded as plugins, see
+    /// SensorFactory::RegisterStaticSensorTypes().
+    class IGNITION_SENSORS_VISIBLE StaticSensorType
+    {
+      /// \brief Sensor type string, such as "camera"
+      public: const char *type;
+
+      /// \brief Instantiate a new sensor of the type
+      public: Sensor *(*create)();
+    };
+
     /// \brief A factory class for creating sensors
     /// This class wll load a sensor plugin based on the given sensor type and
     ///  instantiates a sensor object
@@ -167,27 +181,116 @@ namespace ignition
       /// is returned on error.
       public: std::unique_ptr<Sensor> CreateSensor(const sdf::Sensor &_sdf);
 
+      /// \brief Create a copy of a loaded sensor with a new name, topic and
+      /// parent.
+      ///
+      ///   The copy is loaded from the SDF DOM object of _sensor, so no SDF
+      ///   is parsed. The update rate and pose of _sensor are copied as
+      ///   well. Runtime state, such as sequence numbers, statistics and the
+      ///   state of noise models, isn't copied.
+      ///
+      /// \param[in] _sensor Loaded sensor to copy.
+      /// \param[in] _name Name of the new sensor.
+      /// \param[in] _topic Topic of the new sensor. If empty, the default
+      /// topic of the sensor type is used.
+      /// \param[in] _parent Parent of the new sensor.
+      /// \return The new sensor, nullptr on error.
+      public: std::unique_ptr<Sensor> CloneSensor(const Sensor &_sensor,
+                  const std::string &_name, const std::string &_topic,
+                  const std::string &_parent);
+
+      /// \brief Instantiate a sensor of the given type without loading it.
+      ///
+      ///   The sensor plugin of the type is loaded if needed. The caller is
+      ///   responsible for calling Sensor::Load() and Sensor::Init() on the
+      ///   returned sensor.
+      ///
+      /// \param[in] _type Sensor type string, such as "camera".
+      /// \return The new sensor, nullptr on error.
+      public: std::unique_ptr<Sensor> NewSensor(const std::string &_type);
+
+      /// \brief Set the node the sensors created from now on advertise
+      /// on, see Sensor::SetTransportNode(). The Manager sets one node
+      /// for all its sensors.
+      /// \param[in] _node The node, or null for sensors to create their
+      /// own node.
+      public: void SetTransportNode(
+                  std::shared_ptr<ignition::transport::Node> _node);
+
       /// \brief Add additional path to search for sensor plugins
       /// \param[in] _path Search path
       public: void AddPluginPaths(const std::string &_path);
 
+      /// \brief Load the plugins of the given sensor types now, instead of
+      /// when the first sensor of each type is created. Sensors of loaded
+      /// types are created without any file system access.
+      /// \param[in] _types Sensor type strings, such as "camera".
+      /// \return True if the plugins of all types were loaded.
+      public: bool PreloadSensorPlugins(const std::vector<std::string> &_types);
+
+      /// \brief Load the plugins of all sensor types shipped with this
+      /// library that can be found on the plugin paths. Types whose
+      /// component isn't installed are skipped without an error.
+      /// \return Types whose plugins are loaded.
+      public: std::vector<std::string> PreloadAllSensorPlugins();
+
+      /// \brief Get whether the plugin of a sensor type has been loaded.
+      /// \param[in] _type Sensor type string, such as "camera".
+      /// \return True if the plugin is loaded.
+      public: bool SensorPluginLoaded(const std::string &_type) const;
+
+      /// \brief Register sensor types linked into the application, such as
+      /// the types of the builtin_sensors library built with the
+      /// IGN_SENSORS_STATIC_REGISTRY option. All factories create sensors of
+      /// these types through the table, without looking for plugins, and
+      /// report them as loaded. A type registered again replaces the
+      /// previous entry. This is safe to call from static initializers.
+      /// \param[in] _types Table of sensor types, which must outlive all
+      /// factories.
+      /// \param[in] _count Number of entries of _types
+      public: static void RegisterStaticSensorTypes(
+                  const StaticSensorType *_types, const std::size_t _count);
+
+      /// \brief Find a sensor type registered with
+      /// RegisterStaticSensorTypes().
+      /// \param[in] _type Sensor type string.
+      /// \param[out] _entry Copy of the entry of the type, if registered.
+      /// \return False if the type isn't registered.
+      private: static bool FindStaticSensorType(const std::string &_type,
+                   StaticSensorType &_entry);
+
       /// \brief load a plugin and return a pointer
       /// \param[in] _filename Sensor plugin file to load.
       /// \return Pointer to the new sensor, nullptr on error.
       private: std::shared_ptr<SensorPlugin> LoadSensorPlugin(
           const std::string &_filename);
 
+      /// \brief Get the plugin of a sensor type, loading it if needed.
+      /// Types that failed to load aren't looked up again until the plugin
+      /// paths change.
+      /// \param[in] _type Sensor type string.
+      /// \param[in] _verbose True to print an error if no plugin is found.
+      /// \return The sensor plugin, nullptr on error.
+      private: std::shared_ptr<SensorPlugin> SensorPluginForType(
+          const std::string &_type, const bool _verbose);
+
       IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
       /// \brief private data pointer
       private: std::unique_ptr<SensorFactoryPrivate> dataPtr;
       IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
     };
 
-    /// \brief Sensor registration macro
+    /// \brief Sensor registration macro. Libraries holding several sensor
+    /// types, which are registered with a static table instead, are built
+    /// with IGN_SENSORS_STATIC_REGISTRY defined.
+    #ifdef IGN_SENSORS_STATIC_REGISTRY
+    #define IGN_SENSORS_REGISTER_SENSOR(classname)
+    #else
     #define IGN_SENSORS_REGISTER_SENSOR(classname) \
     IGN_COMMON_REGISTER_SINGLE_PLUGIN(\
        ignition::sensors::SensorTypePlugin<classname>, \
        ignition::sensors::SensorPlugin)
+    #endif
     }
   }
 }
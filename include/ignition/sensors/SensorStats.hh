@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_SENSORSTATS_HH_
+#define IGNITION_SENSORS_SENSORSTATS_HH_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Phases of a sensor update that are timed separately. These
+    /// match the profiler scopes used inside sensor updates.
+    enum class UpdatePhase : int
+    {
+      /// \brief Rendering the scene
+      RENDER = 0,
+
+      /// \brief Copying data out of the rendering engine
+      COPY = 1,
+
+      /// \brief Building output messages
+      MESSAGE = 2,
+
+      /// \brief Publishing output messages
+      PUBLISH = 3,
+
+      /// \brief Applying noise to sensor data on the CPU
+      NOISE = 4,
+
+      /// \brief Number of phases, not a valid phase
+      PHASE_COUNT = 5
+    };
+
+    /// \brief Wall time statistics of a timed section of a sensor update.
+    class IGNITION_SENSORS_VISIBLE TimeStats
+    {
+      /// \brief Number of histogram bins.
+      public: static constexpr std::size_t kHistogramBins = 24u;
+
+      /// \brief Add a sample.
+      /// \param[in] _time Wall time of the sample.
+      public: void Add(const std::chrono::steady_clock::duration &_time);
+
+      /// \brief Estimate a percentile of the samples from the histogram.
+      /// The estimate is the upper bound of the bin holding the percentile,
+      /// capped by the longest sample, so it's at most twice the exact
+      /// value.
+      /// \param[in] _fraction Fraction of the samples, such as 0.99 for the
+      /// 99th percentile.
+      /// \return Time that _fraction of the samples don't exceed, or zero
+      /// if there are no samples.
+      public: std::chrono::steady_clock::duration Percentile(
+                  const double _fraction) const;
+
+      /// \brief Number of samples.
+      public: uint64_t count = 0u;
+
+      /// \brief Sum of all samples.
+      public: std::chrono::steady_clock::duration total{
+                  std::chrono::steady_clock::duration::zero()};
+
+      /// \brief Longest sample.
+      public: std::chrono::steady_clock::duration max{
+                  std::chrono::steady_clock::duration::zero()};
+
+      /// \brief Histogram of the samples. Bin 0 counts samples shorter than
+      /// 1 microsecond, and bin i counts samples from 2^(i-1) up to 2^i
+      /// microseconds. The last bin also counts all longer samples.
+      public: std::array<uint64_t, kHistogramBins> histogram{};
+
+      /// \brief Number of heap allocations made during the samples, see
+      /// SensorStats::RecordAllocation().
+      public: uint64_t allocations = 0u;
+    };
+
+    /// \brief Runtime statistics of a sensor, collected on every update.
+    /// \sa Sensor::Stats()
+    class IGNITION_SENSORS_VISIBLE SensorStats
+    {
+      /// \brief Count a heap allocation made by the calling thread. The
+      /// library can't see the allocations of the process by itself, so
+      /// processes that want the allocations of each update phase call this
+      /// from their replacement of the global operator new. The count is
+      /// thread local and costs no locking.
+      public: static void RecordAllocation();
+
+      /// \brief Get the number of allocations recorded by the calling
+      /// thread.
+      /// \return Number of RecordAllocation() calls made by the thread.
+      public: static uint64_t ThreadAllocationCount();
+
+      /// \brief Number of updates that returned true.
+      public: uint64_t updateCount = 0u;
+
+      /// \brief Number of updates that returned false.
+      public: uint64_t failedUpdateCount = 0u;
+
+      /// \brief Number of updates skipped, either because the sensor had
+      /// no consumers or because they were dropped by the catch-up policy.
+      public: uint64_t skippedUpdateCount = 0u;
+
+      /// \brief Number of updates skipped because the consumers of the
+      /// sensor were still busy with earlier data. These are also counted
+      /// in skippedUpdateCount.
+      /// \sa Sensor::SetBackpressure()
+      public: uint64_t backpressureSkipCount = 0u;
+
+      /// \brief Number of serialized bytes published.
+      public: uint64_t bytesPublished = 0u;
+
+      /// \brief Number of bytes copied out of the rendering engine, such as
+      /// images, depth, thermal and laser buffers.
+      public: uint64_t bytesReadBack = 0u;
+
+      /// \brief Number of messages dropped because the publish queue was
+      /// full. Only used when publishing asynchronously.
+      public: uint64_t droppedMessageCount = 0u;
+
+      /// \brief Number of frames that were not saved to disk because the
+      /// frame writer was still busy with earlier frames.
+      public: uint64_t droppedSaveCount = 0u;
+
+      /// \brief Wall time of whole updates.
+      public: TimeStats update;
+
+      /// \brief Wall time from the start of the update that sampled the
+      /// data of a message to the publication of the message. This is
+      /// longer than the update for data published in a later update, such
+      /// as frames with pipelined readback.
+      public: TimeStats publishDelay;
+
+      /// \brief Wall time of each update phase, indexed by UpdatePhase.
+      public: std::array<TimeStats,
+                  static_cast<std::size_t>(UpdatePhase::PHASE_COUNT)> phases;
+    };
+
+    /// \brief Memory held by a sensor, in bytes. Unlike SensorStats, these
+    /// are the current amounts, not totals since the sensor was created.
+    /// \sa Sensor::MemoryUsage()
+    class IGNITION_SENSORS_VISIBLE SensorMemory
+    {
+      /// \brief Add the memory of another sensor, to get totals.
+      /// \param[in] _other Memory of the other sensor
+      /// \return Reference to this
+      public: SensorMemory &operator+=(const SensorMemory &_other);
+
+      /// \brief GPU memory of the render targets of the sensor, estimated
+      /// from their size and pixel format.
+      public: uint64_t renderTargetBytes = 0u;
+
+      /// \brief Host memory of the buffers frames are read back into and
+      /// processed in, such as images and depth, point cloud, thermal and
+      /// laser buffers.
+      public: uint64_t readbackBytes = 0u;
+
+      /// \brief Host memory of the messages kept between updates.
+      public: uint64_t messageBytes = 0u;
+    };
+    }
+  }
+}
+
+#endif
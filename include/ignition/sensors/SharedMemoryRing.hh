@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_SHAREDMEMORYRING_HH_
+#define IGNITION_SENSORS_SHAREDMEMORYRING_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/sensors/config.hh>
+#include <ignition/sensors/Export.hh>
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief forward declarations
+    class SharedMemoryRingPrivate;
+
+    /// \brief A ring of fixed size slots in named shared memory, used to
+    /// pass large sensor data such as images and point clouds to consumers
+    /// on the same host without serializing it.
+    ///
+    /// One process creates the ring and writes to it, any number of
+    /// processes open it by name and read from it. Every write returns a
+    /// sequence number that identifies the slot it went to. Slots are
+    /// reused after SlotCount() writes, so readers must check that the
+    /// data they read is still current.
+    ///
+    /// Sensors that publish through shared memory add a header entry with
+    /// the key "shm" to their messages, holding the ring name, the
+    /// sequence number and the data size, and leave the data field empty.
+    /// \sa Sensor::SetSharedMemoryPublishing()
+    class IGNITION_SENSORS_VISIBLE SharedMemoryRing
+    {
+      /// \brief Constructor
+      public: SharedMemoryRing();
+
+      /// \brief Destructor. Calls Close().
+      public: ~SharedMemoryRing();
+
+      /// \brief Create a new ring and open it for writing. It fails if a
+      /// ring with the same name exists, unless the process that created
+      /// that ring is not running anymore, in which case it is replaced.
+      /// \param[in] _name Name of the shared memory object. It should start
+      /// with a '/' and contain no other slashes.
+      /// \param[in] _slotCount Number of slots.
+      /// \param[in] _slotSize Maximum number of bytes per slot.
+      /// \return True on success.
+      public: bool Create(const std::string &_name,
+                  const std::size_t _slotCount, const std::size_t _slotSize);
+
+      /// \brief Open an existing ring for reading.
+      /// \param[in] _name Name the ring was created with.
+      /// \return True on success.
+      public: bool Open(const std::string &_name);
+
+      /// \brief Unmap the ring. The ring is removed from the system if this
+      /// object created it. Readers that still have it mapped keep working.
+      public: void Close();
+
+      /// \brief Get whether a ring is mapped.
+      /// \return True after a successful Create() or Open().
+      public: bool IsOpen() const;
+
+      /// \brief Get the name of the mapped ring.
+      /// \return Name of the shared memory object, or an empty string.
+      public: std::string Name() const;
+
+      /// \brief Get the number of slots.
+      /// \return Number of slots, or 0 if no ring is mapped.
+      public: std::size_t SlotCount() const;
+
+      /// \brief Get the maximum number of bytes per slot.
+      /// \return Slot size, or 0 if no ring is mapped.
+      public: std::size_t SlotSize() const;
+
+      /// \brief Copy data into the next slot. Only the creator of a ring
+      /// may write to it, from one thread at a time.
+      /// \param[in] _data Data to copy.
+      /// \param[in] _size Number of bytes. Must not exceed SlotSize().
+      /// \return Sequence number of the write, or 0 on failure.
+      public: uint64_t Write(const void *_data, const std::size_t _size);
+
+      /// \brief Get direct access to the data of a write. The data may be
+      /// overwritten at any time, so check IsCurrent() after using it.
+      /// \param[in] _sequence Sequence number returned by Write().
+      /// \param[out] _size Number of bytes written.
+      /// \return Pointer to the data, or nullptr if the slot no longer
+      /// holds that write.
+      public: const unsigned char *Data(const uint64_t _sequence,
+                  std::size_t &_size) const;
+
+      /// \brief Check whether a slot still holds a write.
+      /// \param[in] _sequence Sequence number returned by Write().
+      /// \return True if the data of the write hasn't been overwritten.
+      public: bool IsCurrent(const uint64_t _sequence) const;
+
+      /// \brief Copy the data of a write.
+      /// \param[in] _sequence Sequence number returned by Write().
+      /// \param[out] _data Receives the data. Its capacity is reused.
+      /// \return False if the slot no longer holds that write.
+      public: bool Read(const uint64_t _sequence, std::string &_data) const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \internal
+      /// \brief Data pointer for private data
+      private: std::unique_ptr<SharedMemoryRingPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
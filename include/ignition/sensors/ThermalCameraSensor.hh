@@ -63,6 +63,21 @@ namespace ignition
     // forward declarations
     class ThermalCameraSensorPrivate;
 
+    /// \brief Palettes of the false color images published by
+    /// ThermalCameraSensor.
+    enum class ThermalPalette
+    {
+      /// \brief Black for the coldest pixels to white for the hottest.
+      GRAYSCALE = 0,
+
+      /// \brief Black, blue, magenta, orange, yellow and white, as the
+      /// "iron" palette of thermal cameras.
+      IRON = 1,
+
+      /// \brief Blue, cyan, green, yellow and red.
+      RAINBOW = 2
+    };
+
     /// \brief Thermal camera sensor class.
     ///
     /// This class creates thermal image from an ignition rendering scene.
@@ -105,6 +120,22 @@ namespace ignition
       public: virtual bool Update(
         const std::chrono::steady_clock::duration &_now) override;
 
+      // Documentation inherited
+      public: virtual bool HasConnections() const override;
+
+      /// \brief This sensor renders and reads back its data in a single
+      /// Update(), so it doesn't support staged updates.
+      /// \return False.
+      public: virtual bool SupportsStagedUpdates() const override;
+
+      // Documentation inherited
+      public: virtual SensorMemory MemoryUsage() const override;
+
+      /// \brief This sensor publishes 16 bit temperature images itself, so
+      /// it has no image streams.
+      /// \return False.
+      protected: virtual bool SupportsImageStreams() const override;
+
       /// \brief Force the sensor to generate data
       /// \param[in] _now The current time
       /// \return true if the update was successfull
@@ -169,6 +200,21 @@ namespace ignition
       /// \param[in] resolution Temperature linear resolution
       public: virtual void SetLinearResolution(float _resolution);
 
+      /// \brief Set the palette of the false color images. Besides the
+      /// raw temperatures on its topic, the sensor publishes 8 bit RGB false
+      /// color images on the "<topic>/colorized" topic while it has
+      /// subscribers. The coldest pixel of each image gets the first color
+      /// of the palette and the hottest the last. The palette can also be
+      /// set with the <ignition:palette> element of the sensor, to
+      /// "grayscale", "iron" or "rainbow". Defaults to IRON.
+      /// \param[in] _palette Palette of the false color images
+      public: void SetPalette(const ThermalPalette _palette);
+
+      /// \brief Get the palette of the false color images.
+      /// \return Palette of the false color images
+      /// \sa SetPalette()
+      public: ThermalPalette Palette() const;
+
      /// \brief Create a camera in a scene
       /// \return True on success.
       private: bool CreateCamera();
@@ -15,6 +15,8 @@
  *
 */
 
+#include <array>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
@@ -25,6 +27,8 @@
 #pragma warning(pop)
 #endif
 
+#include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/transport/Node.hh>
 
@@ -53,12 +57,14 @@ static constexpr double kAirConstantDimensionless = kGravityMagnitude *
 /// \brief Private data for AirPressureSensor
 class ignition::sensors::AirPressureSensorPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
-
   /// \brief publisher to publish air pressure messages.
   public: transport::Node::Publisher pub;
 
+  /// \brief Event that is used to trigger callbacks when a new message
+  /// is generated
+  public: ignition::common::EventT<
+          void(const ignition::msgs::FluidPressure &)> dataEvent;
+
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
 
@@ -68,10 +74,49 @@ class ignition::sensors::AirPressureSensorPrivate
   /// \brief Altitude reference, i.e. initial sensor position
   public: double referenceAltitude = 0.0;
 
-  /// \brief Noise added to sensor data
-  public: std::map<SensorNoiseType, NoisePtr> noises;
+  /// \brief Noise added to sensor data, indexed by SensorNoiseType. Slots
+  /// without noise are null.
+  public: std::array<NoisePtr, SENSOR_NOISE_TYPE_END> noises;
+
+  /// \brief Variance reported with Gaussian pressure noise, computed once
+  /// on load.
+  public: double variance = 0.0;
+
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: msgs::FluidPressure msg;
+
+  /// \brief Pressure at pressureHeight, before noise
+  public: double noiseFreePressure = 0.0;
+
+  /// \brief Height noiseFreePressure was computed for
+  public: double pressureHeight = 0.0;
+
+  /// \brief True once noiseFreePressure has been computed
+  public: bool pressureValid = false;
 };
 
+/// \brief Compute the pressure of the standard atmosphere.
+/// \param[in] _height Height above sea level in meters
+/// \return Pressure in pascals
+static double StandardPressure(const double _height)
+{
+  // This block of code comes from RotorS:
+  // https://github.com/ethz-asl/rotors_simulator/blob/master/rotors_gazebo_plugins/src/gazebo_pressure_plugin.cpp
+
+  // Compute the geopotential height.
+  double geoHeight = kEarthRadiusMeters * _height /
+    (kEarthRadiusMeters + _height);
+
+  // Compute the temperature at the current altitude in Kelvin.
+  double tempAtHeight =
+    kSeaLevelTempKelvin - kTempLapseKelvinPerMeter * geoHeight;
+
+  // Compute the current air pressure.
+  return kPressureOneAtmospherePascals * exp(kAirConstantDimensionless *
+      log(kSeaLevelTempKelvin / tempAtHeight));
+}
+
 //////////////////////////////////////////////////
 AirPressureSensor::AirPressureSensor()
   : dataPtr(new AirPressureSensorPrivate())
@@ -113,7 +158,7 @@ bool AirPressureSensor::Load(const sdf::Sensor &_sdf)
     this->SetTopic("/air_pressure");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::FluidPressure>(
+      this->TransportNode().Advertise<ignition::msgs::FluidPressure>(
       this->Topic());
 
   if (!this->dataPtr->pub)
@@ -121,12 +166,29 @@ bool AirPressureSensor::Load(const sdf::Sensor &_sdf)
     ignerr << "Unable to create publisher on topic[" << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   // Load the noise parameters
   if (_sdf.AirPressureSensor()->PressureNoise().Type() != sdf::NoiseType::NONE)
   {
     this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS] =
       NoiseFactory::NewNoiseModel(_sdf.AirPressureSensor()->PressureNoise());
+
+    GaussianNoiseModelPtr gaussian =
+      std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(
+          this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS]);
+    if (gaussian)
+      this->dataPtr->variance = sqrt(gaussian->StdDev());
+  }
+
+  // Give every noise model its own reproducible random stream
+  for (std::size_t i = 0; i < this->dataPtr->noises.size(); ++i)
+  {
+    if (this->dataPtr->noises[i])
+    {
+      this->dataPtr->noises[i]->SetSeed(
+          this->NoiseSeed(static_cast<unsigned int>(i)));
+    }
   }
 
   this->dataPtr->initialized = true;
@@ -159,55 +221,58 @@ bool AirPressureSensor::Update(
     return false;
   }
 
-  msgs::FluidPressure msg;
-  *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-  auto frame = msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
-
-  // This block of code comes from RotorS:
-  // https://github.com/ethz-asl/rotors_simulator/blob/master/rotors_gazebo_plugins/src/gazebo_pressure_plugin.cpp
+  // Get the current height. The pressure only changes with it, so it's
+  // only recomputed when the sensor or its reference moves.
+  const double height =
+      this->dataPtr->referenceAltitude + this->Pose().Pos().Z();
+  if (!this->dataPtr->pressureValid || height != this->dataPtr->pressureHeight)
   {
-    // Get the current height.
-    double height = this->dataPtr->referenceAltitude + this->Pose().Pos().Z();
-
-    // Compute the geopotential height.
-    double geoHeight = kEarthRadiusMeters * height /
-      (kEarthRadiusMeters + height);
-
-    // Compute the temperature at the current altitude in Kelvin.
-    double tempAtHeight =
-      kSeaLevelTempKelvin - kTempLapseKelvinPerMeter * geoHeight;
-
-    // Compute the current air pressure.
-    this->dataPtr->pressure =
-      kPressureOneAtmospherePascals * exp(kAirConstantDimensionless *
-          log(kSeaLevelTempKelvin / tempAtHeight));
+    this->dataPtr->noiseFreePressure = StandardPressure(height);
+    this->dataPtr->pressureHeight = height;
+    this->dataPtr->pressureValid = true;
   }
+  this->dataPtr->pressure = this->dataPtr->noiseFreePressure;
 
   // Apply pressure noise
-  if (this->dataPtr->noises.find(AIR_PRESSURE_NOISE_PASCALS) !=
-      this->dataPtr->noises.end())
-  {
-    this->dataPtr->pressure =
-      this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS]->Apply(
-          this->dataPtr->pressure);
+  const NoisePtr &noise = this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS];
+  if (noise)
+    this->dataPtr->pressure = noise->Apply(this->dataPtr->pressure);
 
-    if (this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS]->Type() ==
-        NoiseType::GAUSSIAN)
-    {
-     GaussianNoiseModelPtr gaussian =
-       std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(
-           this->dataPtr->noises[AIR_PRESSURE_NOISE_PASCALS]);
-      msg.set_variance(sqrt(gaussian->StdDev()));
-    }
+  const bool publish = this->HasConsumers(this->dataPtr->pub);
+  const bool callbacks = this->dataPtr->dataEvent.ConnectionCount() > 0;
+  if (!publish && !callbacks)
+  {
+    // Nobody consumes the message, don't build it
+    return true;
   }
 
+  msgs::FluidPressure &msg = this->dataPtr->msg;
+  this->StampHeader(msg.mutable_header(), _now);
+  if (noise && noise->Type() == NoiseType::GAUSSIAN)
+    msg.set_variance(this->dataPtr->variance);
   msg.set_pressure(this->dataPtr->pressure);
 
   // publish
-  this->AddSequence(msg.mutable_header());
-  this->dataPtr->pub.Publish(msg);
+  if (publish)
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (callbacks)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an air pressure callback.\n";
+    }
+  }
 
   return true;
 }
@@ -224,4 +289,41 @@ double AirPressureSensor::ReferenceAltitude() const
   return this->dataPtr->referenceAltitude;
 }
 
+//////////////////////////////////////////////////
+bool AirPressureSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->dataPtr->dataEvent.ConnectionCount() > 0;
+}
+
+//////////////////////////////////////////////////
+bool AirPressureSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::FluidPressure *>(&_msg);
+  if (msg && _topic == this->Topic() &&
+      this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(*msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an air pressure callback.\n";
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr AirPressureSensor::ConnectDataCallback(
+    std::function<void(const ignition::msgs::FluidPressure &)> _callback)
+{
+  return this->dataPtr->dataEvent.Connect(_callback);
+}
+
 IGN_SENSORS_REGISTER_SENSOR(AirPressureSensor)
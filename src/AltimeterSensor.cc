@@ -15,6 +15,10 @@
  *
 */
 
+#include <array>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/transport/Node.hh>
 
@@ -29,12 +33,14 @@ using namespace sensors;
 /// \brief Private data for AltimeterSensor
 class ignition::sensors::AltimeterSensorPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
-
   /// \brief publisher to publish altimeter messages.
   public: transport::Node::Publisher pub;
 
+  /// \brief Event that is used to trigger callbacks when a new message
+  /// is generated
+  public: ignition::common::EventT<
+          void(const ignition::msgs::Altimeter &)> dataEvent;
+
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
 
@@ -47,8 +53,13 @@ class ignition::sensors::AltimeterSensorPrivate
   /// \brief Vertical reference, i.e. initial sensor position
   public: double verticalReference = 0.0;
 
-  /// \brief Noise added to sensor data
-  public: std::map<SensorNoiseType, NoisePtr> noises;
+  /// \brief Noise added to sensor data, indexed by SensorNoiseType. Slots
+  /// without noise are null.
+  public: std::array<NoisePtr, SENSOR_NOISE_TYPE_END> noises;
+
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: msgs::Altimeter msg;
 };
 
 //////////////////////////////////////////////////
@@ -92,13 +103,14 @@ bool AltimeterSensor::Load(const sdf::Sensor &_sdf)
     this->SetTopic("/altimeter");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::Altimeter>(this->Topic());
+      this->TransportNode().Advertise<ignition::msgs::Altimeter>(this->Topic());
 
   if (!this->dataPtr->pub)
   {
     ignerr << "Unable to create publisher on topic[" << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   // Load the noise parameters
   if (_sdf.AltimeterSensor()->VerticalPositionNoise().Type()
@@ -117,6 +129,16 @@ bool AltimeterSensor::Load(const sdf::Sensor &_sdf)
           _sdf.AltimeterSensor()->VerticalVelocityNoise());
   }
 
+  // Give every noise model its own reproducible random stream
+  for (std::size_t i = 0; i < this->dataPtr->noises.size(); ++i)
+  {
+    if (this->dataPtr->noises[i])
+    {
+      this->dataPtr->noises[i]->SetSeed(
+          this->NoiseSeed(static_cast<unsigned int>(i)));
+    }
+  }
+
   this->dataPtr->initialized = true;
   return true;
 }
@@ -146,39 +168,59 @@ bool AltimeterSensor::Update(const std::chrono::steady_clock::duration &_now)
     return false;
   }
 
-  msgs::Altimeter msg;
-  *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-  auto frame = msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
-
   // Apply altimeter vertical position noise
-  if (this->dataPtr->noises.find(ALTIMETER_VERTICAL_POSITION_NOISE_METERS) !=
-      this->dataPtr->noises.end())
+  const NoisePtr &positionNoise =
+      this->dataPtr->noises[ALTIMETER_VERTICAL_POSITION_NOISE_METERS];
+  if (positionNoise)
   {
     this->dataPtr->verticalPosition =
-      this->dataPtr->noises[ALTIMETER_VERTICAL_POSITION_NOISE_METERS]->Apply(
-          this->dataPtr->verticalPosition);
+      positionNoise->Apply(this->dataPtr->verticalPosition);
   }
 
   // Apply altimeter vertical velocity noise
-  if (this->dataPtr->noises.find(
-        ALTIMETER_VERTICAL_VELOCITY_NOISE_METERS_PER_S) !=
-      this->dataPtr->noises.end())
+  const NoisePtr &velocityNoise =
+      this->dataPtr->noises[ALTIMETER_VERTICAL_VELOCITY_NOISE_METERS_PER_S];
+  if (velocityNoise)
   {
     this->dataPtr->verticalVelocity =
-      this->dataPtr->noises[
-      ALTIMETER_VERTICAL_VELOCITY_NOISE_METERS_PER_S]->Apply(
-          this->dataPtr->verticalVelocity);
+      velocityNoise->Apply(this->dataPtr->verticalVelocity);
   }
 
+  const bool publish = this->HasConsumers(this->dataPtr->pub);
+  const bool callbacks = this->dataPtr->dataEvent.ConnectionCount() > 0;
+  if (!publish && !callbacks)
+  {
+    // Nobody consumes the message, don't build it
+    return true;
+  }
+
+  msgs::Altimeter &msg = this->dataPtr->msg;
+  this->StampHeader(msg.mutable_header(), _now);
   msg.set_vertical_position(this->dataPtr->verticalPosition);
   msg.set_vertical_velocity(this->dataPtr->verticalVelocity);
   msg.set_vertical_reference(this->dataPtr->verticalReference);
 
   // publish
-  this->AddSequence(msg.mutable_header());
-  this->dataPtr->pub.Publish(msg);
+  if (publish)
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (callbacks)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an altimeter callback.\n";
+    }
+  }
 
   return true;
 }
@@ -219,4 +261,41 @@ double AltimeterSensor::VerticalVelocity() const
   return this->dataPtr->verticalVelocity;
 }
 
+//////////////////////////////////////////////////
+bool AltimeterSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->dataPtr->dataEvent.ConnectionCount() > 0;
+}
+
+//////////////////////////////////////////////////
+bool AltimeterSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::Altimeter *>(&_msg);
+  if (msg && _topic == this->Topic() &&
+      this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(*msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an altimeter callback.\n";
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr AltimeterSensor::ConnectDataCallback(
+    std::function<void(const ignition::msgs::Altimeter &)> _callback)
+{
+  return this->dataPtr->dataEvent.Connect(_callback);
+}
+
 IGN_SENSORS_REGISTER_SENSOR(AltimeterSensor)
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "AsyncPublisher.hh"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Spare copies kept by a queue beyond its depth, enough for the
+  /// few message types published by one sensor
+  const std::size_t kExtraSpareCount = 4u;
+
+  /// \brief Threads shared by all asynchronous publish queues.
+  class PublishThreadPool
+  {
+    /// \brief Get the process wide pool.
+    /// \return The pool.
+    public: static PublishThreadPool &Instance()
+    {
+      static PublishThreadPool pool;
+      return pool;
+    }
+
+    /// \brief Constructor. Starts the threads.
+    public: PublishThreadPool()
+    {
+      unsigned int count = std::max(1u,
+          std::min(4u, std::thread::hardware_concurrency() / 4u));
+      for (unsigned int i = 0u; i < count; ++i)
+        this->threads.emplace_back(&PublishThreadPool::Run, this);
+    }
+
+    /// \brief Destructor. Publishes the remaining messages and joins the
+    /// threads.
+    public: ~PublishThreadPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+      }
+      this->cv.notify_all();
+      for (auto &thread : this->threads)
+        thread.join();
+    }
+
+    /// \brief Schedule a queue to be drained.
+    /// \param[in] _queue The queue.
+    public: void Post(std::shared_ptr<AsyncPublishQueue> _queue)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queues.push_back(std::move(_queue));
+      }
+      this->cv.notify_one();
+    }
+
+    /// \brief Thread function
+    private: void Run()
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      while (true)
+      {
+        this->cv.wait(lock, [this]
+            {
+              return this->stop || !this->queues.empty();
+            });
+        if (this->queues.empty())
+          return;
+
+        auto queue = std::move(this->queues.front());
+        this->queues.pop_front();
+        lock.unlock();
+        queue->Drain();
+        queue.reset();
+        lock.lock();
+      }
+    }
+
+    /// \brief Background threads
+    private: std::vector<std::thread> threads;
+
+    /// \brief Queues waiting to be drained
+    private: std::deque<std::shared_ptr<AsyncPublishQueue>> queues;
+
+    /// \brief True when the threads should exit
+    private: bool stop = false;
+
+    /// \brief Protects queues and stop
+    private: std::mutex mutex;
+
+    /// \brief Signaled when a queue is posted or the pool stops
+    private: std::condition_variable cv;
+  };
+}
+
+//////////////////////////////////////////////////
+AsyncPublishQueue::AsyncPublishQueue(const std::size_t _depth,
+    const PublishDropPolicy _policy)
+  : depth(std::max<std::size_t>(1u, _depth)), policy(_policy)
+{
+}
+
+//////////////////////////////////////////////////
+unsigned int AsyncPublishQueue::Push(const transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg)
+{
+  IGN_PROFILE("AsyncPublishQueue::Push");
+  Item item;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (this->policy == PublishDropPolicy::DROP_NEWEST &&
+        this->items.size() >= this->depth)
+    {
+      return 1u;
+    }
+    item.msg = this->TakeSpare(_msg.GetDescriptor());
+  }
+
+  // Copying is much cheaper than serializing and sending, and is done
+  // without holding the lock. Copying into a spare message of the same
+  // type reuses its buffers.
+  item.pub = _pub;
+  if (!item.msg)
+    item.msg.reset(_msg.New());
+  item.msg->CopyFrom(_msg);
+
+  unsigned int dropped = 0u;
+  Item oldest;
+  bool post = false;
+  {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    if (this->items.size() >= this->depth)
+    {
+      switch (this->policy)
+      {
+        case PublishDropPolicy::DROP_OLDEST:
+          oldest = std::move(this->items.front());
+          this->items.pop_front();
+          this->Recycle(std::move(oldest.msg));
+          dropped = 1u;
+          break;
+        case PublishDropPolicy::DROP_NEWEST:
+          this->Recycle(std::move(item.msg));
+          return 1u;
+        case PublishDropPolicy::BLOCK:
+        default:
+          this->cv.wait(lock, [this]
+              {
+                return this->items.size() < this->depth;
+              });
+          break;
+      }
+    }
+
+    this->items.push_back(std::move(item));
+    if (!this->scheduled)
+    {
+      this->scheduled = true;
+      post = true;
+    }
+  }
+
+  if (post)
+    PublishThreadPool::Instance().Post(this->shared_from_this());
+  return dropped;
+}
+
+//////////////////////////////////////////////////
+void AsyncPublishQueue::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->cv.wait(lock, [this]
+      {
+        return this->items.empty() && !this->scheduled;
+      });
+}
+
+//////////////////////////////////////////////////
+bool AsyncPublishQueue::Busy() const
+{
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return !this->items.empty() || this->scheduled;
+}
+
+//////////////////////////////////////////////////
+std::size_t AsyncPublishQueue::Depth() const
+{
+  return this->depth;
+}
+
+//////////////////////////////////////////////////
+PublishDropPolicy AsyncPublishQueue::Policy() const
+{
+  return this->policy;
+}
+
+//////////////////////////////////////////////////
+void AsyncPublishQueue::Drain()
+{
+  IGN_PROFILE("AsyncPublishQueue::Drain");
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (!this->items.empty())
+  {
+    Item item = std::move(this->items.front());
+    this->items.pop_front();
+    lock.unlock();
+    this->cv.notify_all();
+
+    item.pub.Publish(*item.msg);
+    item.pub = transport::Node::Publisher();
+
+    lock.lock();
+    this->Recycle(std::move(item.msg));
+  }
+  this->scheduled = false;
+  lock.unlock();
+  this->cv.notify_all();
+}
+
+//////////////////////////////////////////////////
+std::unique_ptr<google::protobuf::Message> AsyncPublishQueue::TakeSpare(
+    const google::protobuf::Descriptor *_descriptor)
+{
+  for (auto it = this->spare.begin(); it != this->spare.end(); ++it)
+  {
+    if ((*it)->GetDescriptor() != _descriptor)
+      continue;
+    std::unique_ptr<google::protobuf::Message> msg = std::move(*it);
+    *it = std::move(this->spare.back());
+    this->spare.pop_back();
+    return msg;
+  }
+  return nullptr;
+}
+
+//////////////////////////////////////////////////
+void AsyncPublishQueue::Recycle(
+    std::unique_ptr<google::protobuf::Message> _msg)
+{
+  if (_msg && this->spare.size() < this->depth + kExtraSpareCount)
+    this->spare.push_back(std::move(_msg));
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_ASYNCPUBLISHER_HH_
+#define IGNITION_SENSORS_ASYNCPUBLISHER_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <google/protobuf/message.h>
+#include <ignition/transport/Node.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Sensor.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief A bounded queue of messages of one sensor that are published
+    /// by a shared pool of background threads. Messages of a queue are
+    /// published in the order they were pushed. Published and dropped
+    /// copies are kept for later pushes of messages of the same type, so
+    /// that copying a message reuses the buffers of an earlier one instead
+    /// of allocating new ones.
+    class AsyncPublishQueue :
+      public std::enable_shared_from_this<AsyncPublishQueue>
+    {
+      /// \brief Constructor
+      /// \param[in] _depth Maximum number of queued messages. Zero is
+      /// treated as one.
+      /// \param[in] _policy What to do when the queue is full.
+      public: AsyncPublishQueue(const std::size_t _depth,
+                  const PublishDropPolicy _policy);
+
+      /// \brief Queue a copy of a message for publishing.
+      /// \param[in] _pub Publisher to send the message with. The queue keeps
+      /// a copy, so the topic stays advertised until the message is sent.
+      /// \param[in] _msg Message to publish.
+      /// \return Number of messages dropped to make room, or 1 if _msg was
+      /// dropped itself.
+      public: unsigned int Push(const transport::Node::Publisher &_pub,
+                  const google::protobuf::Message &_msg);
+
+      /// \brief Block until all queued messages have been published.
+      public: void Flush();
+
+      /// \brief Get whether messages are queued or being published.
+      /// \return False once all pushed messages have been published.
+      public: bool Busy() const;
+
+      /// \brief Get the maximum number of queued messages.
+      /// \return Queue depth.
+      public: std::size_t Depth() const;
+
+      /// \brief Get the policy used when the queue is full.
+      /// \return Drop policy.
+      public: PublishDropPolicy Policy() const;
+
+      /// \brief Publish all queued messages. Called by the background
+      /// threads.
+      public: void Drain();
+
+      /// \brief Take a spare copy of a message type. The mutex must be
+      /// locked.
+      /// \param[in] _descriptor Type of the message.
+      /// \return A spare message, or null if there is none.
+      private: std::unique_ptr<google::protobuf::Message> TakeSpare(
+                   const google::protobuf::Descriptor *_descriptor);
+
+      /// \brief Keep a copy that is no longer queued for later pushes. The
+      /// mutex must be locked.
+      /// \param[in] _msg Message, may be null.
+      private: void Recycle(std::unique_ptr<google::protobuf::Message> _msg);
+
+      /// \brief A queued message
+      private: struct Item
+      {
+        /// \brief Publisher of the message
+        transport::Node::Publisher pub;
+
+        /// \brief The message
+        std::unique_ptr<google::protobuf::Message> msg;
+      };
+
+      /// \brief Maximum number of queued messages
+      private: const std::size_t depth;
+
+      /// \brief What to do when the queue is full
+      private: const PublishDropPolicy policy;
+
+      /// \brief Queued messages
+      private: std::deque<Item> items;
+
+      /// \brief Copies that are no longer queued, whose buffers are reused
+      private: std::vector<std::unique_ptr<google::protobuf::Message>> spare;
+
+      /// \brief True while the queue is waiting for or being drained by a
+      /// background thread.
+      private: bool scheduled = false;
+
+      /// \brief Protects the members above
+      private: mutable std::mutex mutex;
+
+      /// \brief Signaled when messages have been taken off the queue
+      private: std::condition_variable cv;
+    };
+    }
+  }
+}
+
+#endif
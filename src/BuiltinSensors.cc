@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/sensors/AirPressureSensor.hh"
+#include "ignition/sensors/AltimeterSensor.hh"
+#include "ignition/sensors/BuiltinSensors.hh"
+#include "ignition/sensors/CameraSensor.hh"
+#include "ignition/sensors/CpuLidarSensor.hh"
+#include "ignition/sensors/DepthCameraSensor.hh"
+#include "ignition/sensors/GpuLidarSensor.hh"
+#include "ignition/sensors/ImuSensor.hh"
+#include "ignition/sensors/LogicalCameraSensor.hh"
+#include "ignition/sensors/MagnetometerSensor.hh"
+#include "ignition/sensors/RgbdCameraSensor.hh"
+#include "ignition/sensors/SensorFactory.hh"
+#include "ignition/sensors/ThermalCameraSensor.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Instantiate a sensor of a builtin type
+/// \tparam SensorType Type of the sensor
+/// \return New sensor
+template<class SensorType>
+static Sensor *NewBuiltinSensor()
+{
+  return new SensorType();
+}
+
+/// \brief Sensor types of this library, by the names of their plugins,
+/// see IGN_SENSORS_PLUGIN_NAME
+static const StaticSensorType kBuiltinSensorTypes[] =
+{
+  {"air_pressure", &NewBuiltinSensor<AirPressureSensor>},
+  {"altimeter", &NewBuiltinSensor<AltimeterSensor>},
+  {"camera", &NewBuiltinSensor<CameraSensor>},
+  {"depth_camera", &NewBuiltinSensor<DepthCameraSensor>},
+  {"gpu_lidar", &NewBuiltinSensor<GpuLidarSensor>},
+  {"imu", &NewBuiltinSensor<ImuSensor>},
+  {"lidar", &NewBuiltinSensor<CpuLidarSensor>},
+  {"logical_camera", &NewBuiltinSensor<LogicalCameraSensor>},
+  {"magnetometer", &NewBuiltinSensor<MagnetometerSensor>},
+  {"rgbd_camera", &NewBuiltinSensor<RgbdCameraSensor>},
+  {"thermal_camera", &NewBuiltinSensor<ThermalCameraSensor>},
+};
+
+//////////////////////////////////////////////////
+void ignition::sensors::RegisterBuiltinSensors()
+{
+  static const bool registered = []
+  {
+    SensorFactory::RegisterStaticSensorTypes(kBuiltinSensorTypes,
+        sizeof(kBuiltinSensorTypes) / sizeof(kBuiltinSensorTypes[0]));
+    return true;
+  }();
+  static_cast<void>(registered);
+}
+
+/// \brief Registers the sensor types when the library is loaded
+static const bool kBuiltinSensorsRegistered =
+    (RegisterBuiltinSensors(), true);
@@ -24,16 +24,25 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <ignition/common/Console.hh>
 #include <ignition/common/Event.hh>
-#include <ignition/common/Image.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/common/StringUtils.hh>
 #include <ignition/math/Angle.hh>
 #include <ignition/math/Helpers.hh>
+#include <ignition/rendering/DistortionPass.hh>
+#include <ignition/rendering/RenderEngine.hh>
+#include <ignition/rendering/RenderPassSystem.hh>
 #include <ignition/transport/Node.hh>
+#include <ignition/transport/TopicUtils.hh>
 
 #include "ignition/sensors/CameraSensor.hh"
 #include "ignition/sensors/ImageGaussianNoiseModel.hh"
@@ -43,26 +52,220 @@
 #include "ignition/sensors/SensorFactory.hh"
 #include "ignition/sensors/SensorTypes.hh"
 
+#include "ImageEncoder.hh"
+#include "ImageResample.hh"
+#include "ResolutionController.hh"
+
 using namespace ignition;
 using namespace sensors;
 
+/// \brief Maximum number of frames in flight between rendering and readback
+static const unsigned int kMaxReadbackDepth = 4u;
+
+namespace
+{
+/// \brief A secondary image stream made from each frame
+struct ImageStream
+{
+  /// \brief Name of the stream
+  std::string name;
+
+  /// \brief Topic of the stream
+  std::string topic;
+
+  /// \brief Publisher of the stream
+  transport::Node::Publisher pub;
+
+  /// \brief Width of the stream images
+  unsigned int width = 0u;
+
+  /// \brief Height of the stream images
+  unsigned int height = 0u;
+
+  /// \brief Top left pixel of the region of the frame
+  math::Vector2i roiOffset;
+
+  /// \brief Size of the region, zero to extend to the frame corner
+  math::Vector2i roiSize;
+
+  /// \brief Makes the stream images. Configured for the size of the
+  /// last frame.
+  std::shared_ptr<ImageResampler> resampler;
+
+  /// \brief Message reused across frames
+  std::shared_ptr<msgs::Image> msg;
+
+  /// \brief True once an invalid region has been reported
+  bool errorReported = false;
+};
+
+/// \brief Configure the resampler of a stream for a frame size.
+/// \param[in,out] _stream Stream to configure.
+/// \param[in] _width Width of the frames.
+/// \param[in] _height Height of the frames.
+/// \return False if the region of the stream doesn't fit in the frames.
+bool ConfigureStream(ImageStream &_stream, const unsigned int _width,
+    const unsigned int _height)
+{
+  const unsigned int x = static_cast<unsigned int>(_stream.roiOffset.X());
+  const unsigned int y = static_cast<unsigned int>(_stream.roiOffset.Y());
+  const unsigned int roiWidth = _stream.roiSize.X() > 0 ?
+      static_cast<unsigned int>(_stream.roiSize.X()) :
+      (x < _width ? _width - x : 0u);
+  const unsigned int roiHeight = _stream.roiSize.Y() > 0 ?
+      static_cast<unsigned int>(_stream.roiSize.Y()) :
+      (y < _height ? _height - y : 0u);
+  return _stream.resampler->Configure(_width, _height, 3u, x, y, roiWidth,
+      roiHeight, _stream.width, _stream.height);
+}
+
+/// \brief A render target of the readback ring
+struct ReadbackSlot
+{
+  /// \brief Camera rendering into this slot
+  rendering::CameraPtr camera;
+
+  /// \brief Image this slot is read back into
+  rendering::Image image;
+
+  /// \brief Noise models applied to the camera of this slot. Empty for the
+  /// primary camera, whose noise models are in CameraSensorPrivate::noises.
+  std::vector<NoisePtr> noises;
+
+  /// \brief Lens distortion of the camera of this slot, null without
+  /// distortion
+  rendering::DistortionPassPtr distortion;
+
+  /// \brief Time at which the pending frame was rendered
+  std::chrono::steady_clock::duration stamp{0};
+
+  /// \brief True if a frame was rendered and not read back yet
+  bool pending = false;
+};
+}
+
+//////////////////////////////////////////////////
+/// \brief Copy the settings of a camera to another one. Settings that
+/// rebuild the render target are only set if they differ.
+/// \param[in] _from Camera to copy the settings of
+/// \param[in] _to Camera to change
+static void CopyCameraSettings(const rendering::Camera &_from,
+    rendering::Camera &_to)
+{
+  if (_to.ImageWidth() != _from.ImageWidth())
+    _to.SetImageWidth(_from.ImageWidth());
+  if (_to.ImageHeight() != _from.ImageHeight())
+    _to.SetImageHeight(_from.ImageHeight());
+  _to.SetNearClipPlane(_from.NearClipPlane());
+  _to.SetFarClipPlane(_from.FarClipPlane());
+  _to.SetVisibilityMask(_from.VisibilityMask());
+  if (_to.AntiAliasing() != _from.AntiAliasing())
+    _to.SetAntiAliasing(_from.AntiAliasing());
+  _to.SetAspectRatio(_from.AspectRatio());
+  _to.SetHFOV(_from.HFOV());
+  if (_to.ImageFormat() != _from.ImageFormat())
+    _to.SetImageFormat(_from.ImageFormat());
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether a camera has lens distortion.
+/// \param[in] _cameraSdf Camera SDF
+/// \return True if a distortion coefficient isn't zero.
+static bool HasDistortion(const sdf::Camera &_cameraSdf)
+{
+  return !math::equal(_cameraSdf.DistortionK1(), 0.0) ||
+      !math::equal(_cameraSdf.DistortionK2(), 0.0) ||
+      !math::equal(_cameraSdf.DistortionK3(), 0.0) ||
+      !math::equal(_cameraSdf.DistortionP1(), 0.0) ||
+      !math::equal(_cameraSdf.DistortionP2(), 0.0);
+}
+
+//////////////////////////////////////////////////
+/// \brief Set the Brown-Conrady coefficients of a distortion pass.
+/// \param[in] _cameraSdf Camera SDF with the coefficients
+/// \param[in,out] _pass Pass to set
+static void SetDistortion(const sdf::Camera &_cameraSdf,
+    rendering::DistortionPass &_pass)
+{
+  _pass.SetK1(_cameraSdf.DistortionK1());
+  _pass.SetK2(_cameraSdf.DistortionK2());
+  _pass.SetK3(_cameraSdf.DistortionK3());
+  _pass.SetP1(_cameraSdf.DistortionP1());
+  _pass.SetP2(_cameraSdf.DistortionP2());
+  _pass.SetCenter(_cameraSdf.DistortionCenter());
+}
+
+//////////////////////////////////////////////////
+/// \brief Distort the images of a camera on the GPU. Call it before the
+/// noise passes are added, since the lens distorts the light before the
+/// imager adds noise.
+/// \param[in] _cameraSdf Camera SDF with the distortion coefficients
+/// \param[in] _camera Camera to distort
+/// \return The distortion pass, or null if the camera has no distortion
+/// or the render engine doesn't support it.
+static rendering::DistortionPassPtr AddDistortion(
+    const sdf::Camera &_cameraSdf, const rendering::CameraPtr &_camera)
+{
+  if (!HasDistortion(_cameraSdf) || !_camera)
+    return nullptr;
+
+  rendering::RenderEngine *engine = _camera->Scene()->Engine();
+  rendering::RenderPassSystemPtr rpSystem = engine->RenderPassSystem();
+  rendering::DistortionPassPtr pass;
+  if (rpSystem)
+  {
+    pass = std::dynamic_pointer_cast<rendering::DistortionPass>(
+        rpSystem->Create<rendering::DistortionPass>());
+  }
+  if (!pass)
+  {
+    ignwarn << "Render engine [" << engine->Name() << "] doesn't support "
+            << "lens distortion. Images of camera [" << _camera->Name()
+            << "] aren't distorted.\n";
+    return nullptr;
+  }
+
+  SetDistortion(_cameraSdf, *pass);
+  pass->SetEnabled(true);
+  _camera->AddRenderPass(pass);
+  return pass;
+}
+
 /// \brief Private data for CameraSensor
 class ignition::sensors::CameraSensorPrivate
 {
-  /// \brief Save an image
-  /// \param[in] _data the image data to be saved
-  /// \param[in] _width width of image in pixels
-  /// \param[in] _height height of image in pixels
-  /// \param[in] _format The format the data is in
-  /// \return True if the image was saved successfully. False can mean
-  /// that the path provided to the constructor does exist and creation
-  /// of the path was not possible.
-  /// \sa ImageSaver
-  public: bool SaveImage(const unsigned char *_data, unsigned int _width,
-    unsigned int _height, ignition::common::Image::PixelFormatType _format);
-
-  /// \brief node to create publisher
-  public: transport::Node node;
+  /// \brief Create the readback ring when the readback depth is greater
+  /// than 1. The primary camera is the first slot, the other slots get
+  /// copies of it.
+  /// \param[in] _scene Scene to create the cameras in.
+  /// \param[in] _name Name of the sensor.
+  /// \param[in] _cameraSdf Camera SDF, used for the noise of each slot.
+  public: void CreateReadbackSlots(const rendering::ScenePtr &_scene,
+              const std::string &_name, const sdf::Camera *_cameraSdf);
+
+  /// \brief Apply the settings of the primary camera to the other
+  /// cameras of the readback ring, dropping all frames in flight.
+  /// Resources are only recreated if the size changed.
+  public: void ConfigureReadbackSlots();
+
+  /// \brief Destroy the readback ring, dropping all frames in flight.
+  /// \param[in] _scene Scene the cameras were created in, or null if it
+  /// no longer exists.
+  public: void DestroyReadbackSlots(const rendering::ScenePtr &_scene);
+
+  /// \brief Get whether any image stream has subscribers.
+  /// \return True if an image stream has subscribers.
+  public: bool HasStreamConnections() const;
+
+  /// \brief Advertise the camera info service.
+  /// \param[in] _node Node of the sensor
+  public: void AdvertiseInfoService(transport::Node &_node);
+
+  /// \brief Reply to a request for camera info.
+  /// \param[in] _req Unused.
+  /// \param[out] _rep Camera info.
+  /// \return True.
+  public: bool OnInfoRequest(const msgs::Empty &_req, msgs::CameraInfo &_rep);
 
   /// \brief publisher to publish images
   public: transport::Node::Publisher pub;
@@ -82,68 +285,193 @@ class ignition::sensors::CameraSensorPrivate
   /// \brief Noise added to sensor data
   public: std::map<SensorNoiseType, NoisePtr> noises;
 
+  /// \brief Lens distortion of the primary camera, null without distortion
+  public: rendering::DistortionPassPtr distortion;
+
   /// \brief Event that is used to trigger callbacks when a new image
   /// is generated
   public: ignition::common::EventT<
           void(const ignition::msgs::Image &)> imageEvent;
 
+  /// \brief Event that is used to trigger callbacks with a view of a new
+  /// image
+  public: ignition::common::EventT<void(const ImageView &)> imageViewEvent;
+
+  /// \brief Number of image callbacks that are running
+  public: std::atomic<unsigned int> callbacksRunning{0u};
+
   /// \brief Connection to the Manager's scene change event.
   public: ignition::common::ConnectionPtr sceneChangeConnection;
 
   /// \brief Just a mutex for thread safety
-  public: std::mutex mutex;
+  public: mutable std::mutex mutex;
 
-  /// \brief True to save images
-  public: bool saveImage = false;
+  /// \brief Camera information message.
+  public: msgs::CameraInfo infoMsg;
 
-  /// \brief path directory to where images are saved
-  public: std::string saveImagePath = "";
+  /// \brief Topic for info message.
+  public: std::string infoTopic{""};
 
-  /// \prefix of an image name
-  public: std::string saveImagePrefix = "";
+  /// \brief Service replying with infoMsg
+  public: std::string infoService;
 
-  /// \brief counter used to set the image filename
-  public: std::uint64_t saveImageCounter = 0;
+  /// \brief Minimum time between publications of unchanged camera info
+  public: std::chrono::steady_clock::duration infoPeriod{
+      std::chrono::seconds(1)};
 
-  /// \brief SDF Sensor DOM object.
-  public: sdf::Sensor sdfSensor;
+  /// \brief Time at which camera info was last published
+  public: std::chrono::steady_clock::duration infoStamp{0};
 
-  /// \brief Camera information message.
-  public: msgs::CameraInfo infoMsg;
+  /// \brief True if infoMsg changed since it was last published, or was
+  /// never published
+  public: bool infoDirty = true;
 
-  /// \brief Topic for info message.
-  public: std::string infoTopic{""};
+  /// \brief Protects infoMsg, infoService, infoPeriod, infoStamp and
+  /// infoDirty, which are also used by the service callback.
+  public: mutable std::mutex infoMutex;
 
   /// \brief Baseline for stereo cameras.
   public: double baseline{0.0};
 
   /// \brief Flag to indicate if sensor is generating data
   public: bool generatingData = false;
+
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: ignition::msgs::Image msg;
+
+  /// \brief Number of frames in flight between rendering and readback
+  public: unsigned int readbackDepth = 1u;
+
+  /// \brief Ring of render targets, empty unless readbackDepth > 1
+  public: std::vector<ReadbackSlot> readbackSlots;
+
+  /// \brief Index of the slot to render the next frame into
+  public: std::size_t nextSlot = 0u;
+
+  /// \brief True if a frame was rendered without readback ring and not
+  /// copied yet
+  public: bool renderPending = false;
+
+  /// \brief Time at which the frame waiting for readback was rendered,
+  /// when there is no readback ring
+  public: std::chrono::steady_clock::duration renderStamp{0};
+
+  /// \brief Data of the frame that was copied but not published yet, or
+  /// null if there is none
+  public: unsigned char *frameData = nullptr;
+
+  /// \brief Time at which the frame in frameData was rendered
+  public: std::chrono::steady_clock::duration frameStamp{0};
+
+  /// \brief Encodes and publishes compressed images. Null if the
+  /// compressed output is disabled.
+  public: std::unique_ptr<CompressedImagePublisher> compressedPub;
+
+  /// \brief Topic of the compressed output
+  public: std::string compressedTopic;
+
+  /// \brief False to publish only compressed images
+  public: bool publishRaw = true;
+
+  /// \brief Protects compressedPub, compressedTopic and publishRaw, which
+  /// are also used by the updates of derived sensors.
+  public: mutable std::mutex compressedMutex;
+
+  /// \brief Writes saved frames in the background. Null unless frames are
+  /// saved.
+  public: std::unique_ptr<FrameWriter> frameWriter;
+
+  /// \brief File format of saved frames
+  public: FrameFileFormat saveFileFormat = FrameFileFormat::PNG;
+
+  /// \brief True once a dropped frame has been reported
+  public: bool saveDropReported = false;
+
+  /// \brief Protects frameWriter, saveFileFormat and saveDropReported
+  public: mutable std::mutex saveMutex;
+
+  /// \brief Pixel format of the published images. Other formats than
+  /// RGB_INT8 are converted from the rendered RGB images.
+  public: msgs::PixelFormatType outputFormat =
+      msgs::PixelFormatType::RGB_INT8;
+
+  /// \brief Converted image, reused across frames
+  public: std::vector<unsigned char> convertBuffer;
+
+  /// \brief Width of the published images. The camera renders at a lower
+  /// resolution with RenderQualityProfile::FAST.
+  public: unsigned int imageWidth = 0u;
+
+  /// \brief Height of the published images
+  public: unsigned int imageHeight = 0u;
+
+  /// \brief Scales rendered images to the published size, if they differ
+  public: ImageResampler upscaler;
+
+  /// \brief Scaled image, reused across frames
+  public: std::vector<unsigned char> upscaleBuffer;
+
+  /// \brief Picks the render resolution from the measured render times
+  public: ResolutionController resolution;
+
+  /// \brief True to publish images at the rendered size with adaptive
+  /// resolution
+  public: bool publishScaled = false;
+
+  /// \brief Scale of the rendered resolution
+  public: double renderScale = 1.0;
+
+  /// \brief True when the cameras must be resized to renderScale
+  public: bool resizePending = false;
+
+  /// \brief Wall time spent rendering the last frame
+  public: std::chrono::steady_clock::duration renderTime{0};
+
+  /// \brief Compute the rendered size for a scale of the image size.
+  /// \param[in] _scale Resolution scale.
+  /// \param[out] _width Rendered width.
+  /// \param[out] _height Rendered height.
+  public: void RenderSize(const double _scale, unsigned int &_width,
+              unsigned int &_height) const;
+
+  /// \brief Resize the camera and readback cameras to renderScale. Frames
+  /// in flight are dropped.
+  public: void ResizeCameras();
+
+  /// \brief Feed the render time of the last frame to the resolution
+  /// controller, and schedule a resize if the scale changed.
+  /// \param[in] _copyTime Wall time spent reading the frame back.
+  /// \param[in] _qualityScale Resolution scale of the render quality
+  /// profile.
+  public: void AdaptResolution(
+              const std::chrono::steady_clock::duration &_copyTime,
+              const double _qualityScale);
+
+  /// \brief Secondary image streams
+  public: std::vector<ImageStream> streams;
+
+  /// \brief Protects streams
+  public: mutable std::mutex streamsMutex;
 };
 
 //////////////////////////////////////////////////
 bool CameraSensor::CreateCamera()
 {
-  const sdf::Camera *cameraSdf = this->dataPtr->sdfSensor.CameraSensor();
+  const sdf::Camera *cameraSdf = this->SdfSensor().CameraSensor();
   if (!cameraSdf)
   {
     ignerr << "Unable to access camera SDF element.\n";
     return false;
   }
 
-  this->PopulateInfo(cameraSdf);
-
-  unsigned int width = cameraSdf->ImageWidth();
-  unsigned int height = cameraSdf->ImageHeight();
-
   this->dataPtr->camera = this->Scene()->CreateCamera(this->Name());
-  this->dataPtr->camera->SetImageWidth(width);
-  this->dataPtr->camera->SetImageHeight(height);
-  this->dataPtr->camera->SetNearClipPlane(cameraSdf->NearClip());
-  this->dataPtr->camera->SetFarClipPlane(cameraSdf->FarClip());
-  this->dataPtr->camera->SetVisibilityMask(cameraSdf->VisibilityMask());
   this->AddSensor(this->dataPtr->camera);
 
+  // Distort the images on the GPU, so consumers don't have to remap them
+  this->dataPtr->distortion = AddDistortion(*cameraSdf,
+      this->dataPtr->camera);
+
   const std::map<SensorNoiseType, sdf::Noise> noises = {
     {CAMERA_NOISE, cameraSdf->ImageNoise()},
   };
@@ -168,28 +496,90 @@ bool CameraSensor::CreateCamera()
     }
   }
 
-  // \todo(nkoeng) these parameters via sdf
-  this->dataPtr->camera->SetAntiAliasing(2);
+  if (!this->ConfigureCamera(cameraSdf))
+    return false;
 
-  math::Angle angle = cameraSdf->HorizontalFov();
+  this->Scene()->RootVisual()->AddChild(this->dataPtr->camera);
+
+  this->dataPtr->CreateReadbackSlots(this->Scene(), this->Name(), cameraSdf);
+
+  // Create the directory to store frames
+  if (cameraSdf->SaveFrames())
+    this->EnableSaveFrames(cameraSdf->SaveFramesPath(), this->Name() + "_");
+
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::ConfigureCamera(const sdf::Camera *_cameraSdf)
+{
+  math::Angle angle = _cameraSdf->HorizontalFov();
   if (angle < 0.01 || angle > IGN_PI*2)
   {
     ignerr << "Invalid horizontal field of view [" << angle << "]\n";
 
     return false;
   }
-  this->dataPtr->camera->SetAspectRatio(static_cast<double>(width)/height);
-  this->dataPtr->camera->SetHFOV(angle);
 
-  // \todo(nkoenig) Port Distortion class
-  // This->dataPtr->distortion.reset(new Distortion());
-  // This->dataPtr->distortion->Load(this->sdf->GetElement("distortion"));
+  this->PopulateInfo(_cameraSdf);
+
+  unsigned int width = _cameraSdf->ImageWidth();
+  unsigned int height = _cameraSdf->ImageHeight();
+  this->dataPtr->imageWidth = width;
+  this->dataPtr->imageHeight = height;
+
+  // Render at a lower resolution for faster profiles, and scale the
+  // images to the requested size when publishing
+  this->dataPtr->renderScale = this->QualityResolutionScale() *
+      this->dataPtr->resolution.Scale();
+  this->dataPtr->resizePending = false;
+  unsigned int renderWidth = 0u;
+  unsigned int renderHeight = 0u;
+  this->dataPtr->RenderSize(this->dataPtr->renderScale, renderWidth,
+      renderHeight);
+
+  // Changing the size, anti-aliasing or format of a camera rebuilds its
+  // render target, so only set what changed
+  auto &camera = this->dataPtr->camera;
+  if (camera->ImageWidth() != renderWidth)
+    camera->SetImageWidth(renderWidth);
+  if (camera->ImageHeight() != renderHeight)
+    camera->SetImageHeight(renderHeight);
+  camera->SetNearClipPlane(_cameraSdf->NearClip());
+  camera->SetFarClipPlane(_cameraSdf->FarClip());
+  camera->SetVisibilityMask(_cameraSdf->VisibilityMask());
+
+  // \todo(nkoeng) these parameters via sdf
+  if (camera->AntiAliasing() != this->QualityAntiAliasing())
+    camera->SetAntiAliasing(this->QualityAntiAliasing());
+
+  camera->SetAspectRatio(static_cast<double>(width)/height);
+  camera->SetHFOV(angle);
 
-  sdf::PixelFormatType pixelFormat = cameraSdf->PixelFormat();
+  sdf::PixelFormatType pixelFormat = _cameraSdf->PixelFormat();
   switch (pixelFormat)
   {
     case sdf::PixelFormatType::RGB_INT8:
-      this->dataPtr->camera->SetImageFormat(ignition::rendering::PF_R8G8B8);
+      this->dataPtr->outputFormat = msgs::PixelFormatType::RGB_INT8;
+      break;
+    case sdf::PixelFormatType::L_INT8:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::L_INT8;
+      break;
+    case sdf::PixelFormatType::L_INT16:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::L_INT16;
+      break;
+    case sdf::PixelFormatType::BAYER_RGGB8:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::BAYER_RGGB8;
+      break;
+    // sdf names the BGGR pattern BAYER_RGGR8
+    case sdf::PixelFormatType::BAYER_RGGR8:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::BAYER_BGGR8;
+      break;
+    case sdf::PixelFormatType::BAYER_GBRG8:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::BAYER_GBRG8;
+      break;
+    case sdf::PixelFormatType::BAYER_GRBG8:
+      this->dataPtr->outputFormat = msgs::PixelFormatType::BAYER_GRBG8;
       break;
     default:
       ignerr << "Unsupported pixel format ["
@@ -197,18 +587,92 @@ bool CameraSensor::CreateCamera()
       break;
   }
 
-  this->dataPtr->image = this->dataPtr->camera->CreateImage();
+  // Gray and Bayer images are converted from rendered RGB images
+  if (camera->ImageFormat() != ignition::rendering::PF_R8G8B8)
+    camera->SetImageFormat(ignition::rendering::PF_R8G8B8);
 
-  this->Scene()->RootVisual()->AddChild(this->dataPtr->camera);
+  if (this->dataPtr->image.Width() != renderWidth ||
+      this->dataPtr->image.Height() != renderHeight)
+  {
+    this->dataPtr->image = camera->CreateImage();
+  }
 
-  // Create the directory to store frames
-  if (cameraSdf->SaveFrames())
+  // Frames in flight were rendered with the previous settings
+  this->dataPtr->renderPending = false;
+  this->dataPtr->frameData = nullptr;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::Reconfigure(const sdf::Sensor &_sdf)
+{
+  if (_sdf.Type() != sdf::SensorType::CAMERA)
+    return this->Sensor::Reconfigure(_sdf);
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  const sdf::Camera *cameraSdf = _sdf.CameraSensor();
+  const sdf::Camera *current = this->SdfSensor().CameraSensor();
+  if (!cameraSdf || !current)
+    return false;
+
+  // Noise passes are attached to the cameras when they are created
+  if (!(cameraSdf->ImageNoise() == current->ImageNoise()))
+  {
+    igndbg << "Camera [" << this->Name() << "] must be created again to "
+           << "change its noise.\n";
+    return false;
+  }
+
+  // Distortion passes are added before the noise passes, so they can only
+  // be updated in place
+  if (HasDistortion(*cameraSdf) != HasDistortion(*current))
+  {
+    igndbg << "Camera [" << this->Name() << "] must be created again to "
+           << "add or remove its lens distortion.\n";
+    return false;
+  }
+
+  math::Angle angle = cameraSdf->HorizontalFov();
+  if (angle < 0.01 || angle > IGN_PI*2)
+  {
+    ignerr << "Invalid horizontal field of view [" << angle << "]\n";
+    return false;
+  }
+
+  const bool savedFrames = current->SaveFrames();
+  const std::string savedPath = current->SaveFramesPath();
+  if (!this->ReconfigureCommon(_sdf))
+    return false;
+
+  // Without a scene, the camera is created with the new settings later
+  cameraSdf = this->SdfSensor().CameraSensor();
+  if (!this->dataPtr->camera)
+    return true;
+
+  this->ConfigureCamera(cameraSdf);
+  this->dataPtr->ConfigureReadbackSlots();
+  if (this->dataPtr->distortion)
+    SetDistortion(*cameraSdf, *this->dataPtr->distortion);
+  for (ReadbackSlot &slot : this->dataPtr->readbackSlots)
   {
-    this->dataPtr->saveImagePath = cameraSdf->SaveFramesPath();
-    this->dataPtr->saveImagePrefix = this->Name() + "_";
-    this->dataPtr->saveImage = true;
+    if (slot.distortion)
+      SetDistortion(*cameraSdf, *slot.distortion);
   }
 
+  if (cameraSdf->SaveFrames() != savedFrames ||
+      cameraSdf->SaveFramesPath() != savedPath)
+  {
+    if (cameraSdf->SaveFrames())
+    {
+      this->EnableSaveFrames(cameraSdf->SaveFramesPath(),
+          this->Name() + "_");
+    }
+    else
+    {
+      std::lock_guard<std::mutex> saveLock(this->dataPtr->saveMutex);
+      this->dataPtr->frameWriter.reset();
+    }
+  }
   return true;
 }
 
@@ -221,6 +685,14 @@ CameraSensor::CameraSensor()
 //////////////////////////////////////////////////
 CameraSensor::~CameraSensor()
 {
+  // The node may be shared with other sensors and outlive this one
+  std::string service;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+    service.swap(this->dataPtr->infoService);
+  }
+  if (!service.empty())
+    this->TransportNode().UnadvertiseSrv(service);
 }
 
 //////////////////////////////////////////////////
@@ -253,13 +725,11 @@ bool CameraSensor::Load(const sdf::Sensor &_sdf)
     return false;
   }
 
-  this->dataPtr->sdfSensor = _sdf;
-
   if (this->Topic().empty())
     this->SetTopic("/camera");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::Image>(
+      this->TransportNode().Advertise<ignition::msgs::Image>(
           this->Topic());
   if (!this->dataPtr->pub)
   {
@@ -267,6 +737,7 @@ bool CameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   if (!this->AdvertiseInfo())
     return false;
@@ -276,7 +747,8 @@ bool CameraSensor::Load(const sdf::Sensor &_sdf)
 
   this->dataPtr->sceneChangeConnection =
       RenderingEvents::ConnectSceneChangeCallback(
-      std::bind(&CameraSensor::SetScene, this, std::placeholders::_1));
+      std::bind(&CameraSensor::OnSceneChange, this,
+      std::placeholders::_1));
 
   this->dataPtr->initialized = true;
   return true;
@@ -290,6 +762,31 @@ bool CameraSensor::Load(sdf::ElementPtr _sdf)
   return this->Load(sdfSensor);
 }
 
+//////////////////////////////////////////////////
+bool CameraSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::Image *>(&_msg);
+  if (msg && _topic == this->Topic() &&
+      this->dataPtr->imageEvent.ConnectionCount() > 0)
+  {
+    ++this->dataPtr->callbacksRunning;
+    try
+    {
+      this->dataPtr->imageEvent(*msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an image callback.\n";
+    }
+    --this->dataPtr->callbacksRunning;
+  }
+  return true;
+}
+
 /////////////////////////////////////////////////
 ignition::common::ConnectionPtr CameraSensor::ConnectImageCallback(
     std::function<void(const ignition::msgs::Image &)> _callback)
@@ -297,6 +794,37 @@ ignition::common::ConnectionPtr CameraSensor::ConnectImageCallback(
   return this->dataPtr->imageEvent.Connect(_callback);
 }
 
+/////////////////////////////////////////////////
+ignition::common::ConnectionPtr CameraSensor::ConnectImageViewCallback(
+    std::function<void(const ImageView &)> _callback)
+{
+  return this->dataPtr->imageViewEvent.Connect(_callback);
+}
+
+/////////////////////////////////////////////////
+bool CameraSensor::HasImageViewCallbacks() const
+{
+  return this->dataPtr->imageViewEvent.ConnectionCount() > 0u;
+}
+
+/////////////////////////////////////////////////
+void CameraSensor::DeliverImageView(const ImageView &_view)
+{
+  if (this->dataPtr->imageViewEvent.ConnectionCount() == 0u)
+    return;
+
+  ++this->dataPtr->callbacksRunning;
+  try
+  {
+    this->dataPtr->imageViewEvent(_view);
+  }
+  catch(...)
+  {
+    ignerr << "Exception thrown in an image view callback.\n";
+  }
+  --this->dataPtr->callbacksRunning;
+}
+
 /////////////////////////////////////////////////
 void CameraSensor::SetScene(ignition::rendering::ScenePtr _scene)
 {
@@ -306,6 +834,7 @@ void CameraSensor::SetScene(ignition::rendering::ScenePtr _scene)
   {
     // TODO(anyone) Remove camera from scene
     this->dataPtr->camera = nullptr;
+    this->dataPtr->DestroyReadbackSlots(nullptr);
     RenderingSensor::SetScene(_scene);
     if (this->dataPtr->initialized)
       this->CreateCamera();
@@ -337,21 +866,34 @@ bool CameraSensor::Update(const std::chrono::steady_clock::duration &_now)
 
   std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
 
+  // Apply the resolution picked from the last render times
+  if (this->dataPtr->resizePending)
+    this->dataPtr->ResizeCameras();
+
+  std::vector<ReadbackSlot> &slots = this->dataPtr->readbackSlots;
+
   // move the camera to the current pose
-  this->dataPtr->camera->SetLocalPose(this->Pose());
+  rendering::CameraPtr renderCamera = slots.empty() ?
+      this->dataPtr->camera : slots[this->dataPtr->nextSlot].camera;
+  renderCamera->SetLocalPose(this->Pose());
 
   // render only if necessary
-  if (!this->dataPtr->pub.HasConnections() &&
-      this->dataPtr->imageEvent.ConnectionCount() <= 0 &&
-      !this->dataPtr->saveImage)
+  if (!this->HasConnections())
   {
     if (this->dataPtr->generatingData)
     {
       igndbg << "Disabling camera sensor: '" << this->Name() << "' data "
              << "generation. " << std::endl;;
       this->dataPtr->generatingData = false;
+
+      // Frames in flight would be stale once data generation resumes
+      for (ReadbackSlot &slot : slots)
+        slot.pending = false;
+      this->dataPtr->renderPending = false;
+      this->dataPtr->frameData = nullptr;
     }
 
+    this->RecordSkippedUpdate();
     return true;
   }
   else
@@ -365,110 +907,514 @@ bool CameraSensor::Update(const std::chrono::steady_clock::duration &_now)
   }
 
   // generate sensor data
-  this->Render();
-  {
-    IGN_PROFILE("CameraSensor::Update Copy image");
-    this->dataPtr->camera->Copy(this->dataPtr->image);
-  }
-
-  unsigned int width = this->dataPtr->camera->ImageWidth();
-  unsigned int height = this->dataPtr->camera->ImageHeight();
-  unsigned char *data = this->dataPtr->image.Data<unsigned char>();
-
-  ignition::common::Image::PixelFormatType
-      format{common::Image::UNKNOWN_PIXEL_FORMAT};
-  msgs::PixelFormatType msgsPixelFormat =
-    msgs::PixelFormatType::UNKNOWN_PIXEL_FORMAT;
-
-  switch (this->dataPtr->camera->ImageFormat())
-  {
-    case ignition::rendering::PF_R8G8B8:
-      format = ignition::common::Image::RGB_INT8;
-      msgsPixelFormat = msgs::PixelFormatType::RGB_INT8;
-      break;
-    default:
-      ignerr << "Unsupported pixel format ["
-        << this->dataPtr->camera->ImageFormat() << "]\n";
-      break;
-  }
-
-  // create message
-  ignition::msgs::Image msg;
-  {
-    IGN_PROFILE("CameraSensor::Update Message");
-    msg.set_width(width);
-    msg.set_height(height);
-    msg.set_step(width * rendering::PixelUtil::BytesPerPixel(
-                 this->dataPtr->camera->ImageFormat()));
-    msg.set_pixel_format_type(msgsPixelFormat);
-    *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-    auto frame = msg.mutable_header()->add_data();
-    frame->set_key("frame_id");
-    frame->add_value(this->Name());
-    msg.set_data(data, this->dataPtr->camera->ImageMemorySize());
-  }
-
-  // publish the image message
+  auto renderStart = std::chrono::steady_clock::now();
+  if (slots.empty())
   {
-    this->AddSequence(msg.mutable_header());
-    IGN_PROFILE("CameraSensor::Update Publish");
-    this->dataPtr->pub.Publish(msg);
-
-    // publish the camera info message
-    this->PublishInfo(_now);
+    this->Render();
+    this->dataPtr->renderPending = true;
+    this->dataPtr->renderStamp = _now;
   }
-
-  // Trigger callbacks.
-  if (this->dataPtr->imageEvent.ConnectionCount() > 0)
+  else
   {
-    try
-    {
-      this->dataPtr->imageEvent(msg);
-    }
-    catch(...)
-    {
-      ignerr << "Exception thrown in an image callback.\n";
-    }
+    // Render the new frame into the next slot. The oldest frame is read
+    // back afterwards, so it had a whole update to finish on the GPU.
+    ReadbackSlot &renderSlot = slots[this->dataPtr->nextSlot];
+    this->RenderCamera(renderSlot.camera);
+    renderSlot.stamp = _now;
+    renderSlot.pending = true;
+    this->dataPtr->nextSlot = (this->dataPtr->nextSlot + 1u) % slots.size();
   }
+  this->dataPtr->renderTime = std::chrono::steady_clock::now() - renderStart;
 
-  // Save image
-  if (this->dataPtr->saveImage)
-  {
-    this->dataPtr->SaveImage(data, width, height, format);
-  }
+  // The caller reads back and processes the frame in separate stages
+  if (this->StagedUpdates())
+    return true;
 
+  this->CopyFrame();
+  this->PublishFrame();
   return true;
 }
 
 //////////////////////////////////////////////////
-bool CameraSensorPrivate::SaveImage(const unsigned char *_data,
-    unsigned int _width, unsigned int _height,
-    ignition::common::Image::PixelFormatType _format)
+bool CameraSensor::SupportsStagedUpdates() const
 {
-  // Attempt to create the directory if it doesn't exist
-  if (!ignition::common::isDirectory(this->saveImagePath))
-  {
-    if (!ignition::common::createDirectories(this->saveImagePath))
-      return false;
-  }
-
-  std::string filename = this->saveImagePrefix +
-                         std::to_string(this->saveImageCounter) + ".png";
-  ++this->saveImageCounter;
-
-  ignition::common::Image localImage;
-  localImage.SetFromData(_data, _width, _height, _format);
-
-  localImage.SavePNG(
-      ignition::common::joinPaths(this->saveImagePath, filename));
   return true;
 }
 
+//////////////////////////////////////////////////
+void CameraSensor::ReadbackFrame()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->CopyFrame();
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::ProcessFrame()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->PublishFrame();
+}
+
+//////////////////////////////////////////////////
+SensorMemory CameraSensor::MemoryUsage() const
+{
+  SensorMemory memory;
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  memory.renderTargetBytes += RenderTargetBytes(this->dataPtr->camera);
+  memory.readbackBytes += this->dataPtr->image.MemorySize();
+  for (const ReadbackSlot &slot : this->dataPtr->readbackSlots)
+  {
+    // The first slot of the ring is the primary camera and its image
+    if (slot.camera == this->dataPtr->camera)
+      continue;
+    memory.renderTargetBytes += RenderTargetBytes(slot.camera);
+    memory.readbackBytes += slot.image.MemorySize();
+  }
+  memory.readbackBytes += this->dataPtr->convertBuffer.capacity() +
+      this->dataPtr->upscaleBuffer.capacity();
+  memory.messageBytes += this->dataPtr->msg.SpaceUsedLong();
+  {
+    std::lock_guard<std::mutex> infoLock(this->dataPtr->infoMutex);
+    memory.messageBytes += this->dataPtr->infoMsg.SpaceUsedLong();
+  }
+
+  std::lock_guard<std::mutex> streamsLock(this->dataPtr->streamsMutex);
+  for (const ImageStream &stream : this->dataPtr->streams)
+  {
+    if (stream.msg)
+      memory.messageBytes += stream.msg->SpaceUsedLong();
+  }
+  return memory;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::WarmUp()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  if (!this->RenderingSensor::WarmUp())
+    return false;
+
+  // The first slot is the primary camera. Sensors deriving from this one
+  // with their own cameras have no slots.
+  std::vector<ReadbackSlot> &slots = this->dataPtr->readbackSlots;
+  for (std::size_t i = 1u; i < slots.size(); ++i)
+  {
+    if (!slots[i].camera)
+      continue;
+    slots[i].camera->Render();
+    slots[i].camera->PostRender();
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::CopyFrame()
+{
+  std::vector<ReadbackSlot> &slots = this->dataPtr->readbackSlots;
+  if (slots.empty())
+  {
+    if (!this->dataPtr->renderPending || !this->dataPtr->camera)
+      return;
+
+    IGN_PROFILE("CameraSensor::Update Copy image");
+    auto copyStart = std::chrono::steady_clock::now();
+    this->dataPtr->camera->Copy(this->dataPtr->image);
+    this->RecordPhase(UpdatePhase::COPY, copyStart);
+    this->RecordReadbackBytes(this->dataPtr->image.MemorySize());
+    this->dataPtr->AdaptResolution(
+        std::chrono::steady_clock::now() - copyStart,
+        this->QualityResolutionScale());
+    this->dataPtr->renderPending = false;
+    this->dataPtr->frameStamp = this->dataPtr->renderStamp;
+    this->dataPtr->frameData = this->dataPtr->image.Data<unsigned char>();
+    return;
+  }
+
+  // The slot after the last rendered one holds the oldest frame
+  ReadbackSlot &readSlot = slots[this->dataPtr->nextSlot];
+  if (!readSlot.pending)
+  {
+    // The ring is still filling up
+    return;
+  }
+
+  IGN_PROFILE("CameraSensor::Update Copy image");
+  auto copyStart = std::chrono::steady_clock::now();
+  readSlot.camera->Copy(readSlot.image);
+  this->RecordPhase(UpdatePhase::COPY, copyStart);
+  this->RecordReadbackBytes(readSlot.image.MemorySize());
+  this->dataPtr->AdaptResolution(std::chrono::steady_clock::now() - copyStart,
+      this->QualityResolutionScale());
+  readSlot.pending = false;
+  this->dataPtr->frameStamp = readSlot.stamp;
+  this->dataPtr->frameData = readSlot.image.Data<unsigned char>();
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::PublishFrame()
+{
+  unsigned char *data = this->dataPtr->frameData;
+  if (!data || !this->dataPtr->camera)
+    return;
+  this->dataPtr->frameData = nullptr;
+
+  // Time the delivered frame was rendered at
+  const std::chrono::steady_clock::duration stamp = this->dataPtr->frameStamp;
+
+  unsigned int width = this->dataPtr->camera->ImageWidth();
+  unsigned int height = this->dataPtr->camera->ImageHeight();
+
+  // Scale images rendered at a lower resolution to the published size
+  const bool scaled = this->dataPtr->publishScaled &&
+      this->dataPtr->resolution.Budget() >
+      std::chrono::steady_clock::duration::zero();
+  if (!scaled && (width != this->dataPtr->imageWidth ||
+       height != this->dataPtr->imageHeight) &&
+      this->dataPtr->camera->ImageFormat() == rendering::PF_R8G8B8)
+  {
+    IGN_PROFILE("CameraSensor::Update Upscale");
+    ImageResampler &upscaler = this->dataPtr->upscaler;
+    const unsigned int dstWidth = this->dataPtr->imageWidth;
+    const unsigned int dstHeight = this->dataPtr->imageHeight;
+    if (!upscaler.Matches(width, height, 3u) &&
+        !upscaler.Configure(width, height, 3u, 0u, 0u, width, height,
+          dstWidth, dstHeight))
+    {
+      ignerr << "Unable to scale the images of camera [" << this->Name()
+             << "] from [" << width << "x" << height << "] to ["
+             << dstWidth << "x" << dstHeight << "]\n";
+      return;
+    }
+    this->dataPtr->upscaleBuffer.resize(upscaler.OutputSize());
+    upscaler.Resample(data, width * 3u, this->dataPtr->upscaleBuffer.data());
+    data = this->dataPtr->upscaleBuffer.data();
+    width = dstWidth;
+    height = dstHeight;
+  }
+
+  msgs::PixelFormatType msgsPixelFormat =
+    msgs::PixelFormatType::UNKNOWN_PIXEL_FORMAT;
+
+  switch (this->dataPtr->camera->ImageFormat())
+  {
+    case ignition::rendering::PF_R8G8B8:
+      msgsPixelFormat = this->dataPtr->outputFormat;
+      break;
+    default:
+      ignerr << "Unsupported pixel format ["
+        << this->dataPtr->camera->ImageFormat() << "]\n";
+      break;
+  }
+
+  // Convert to the published format
+  const unsigned char *msgData = data;
+  unsigned int step = width * rendering::PixelUtil::BytesPerPixel(
+      this->dataPtr->camera->ImageFormat());
+  const unsigned int pixelSize =
+      ImageResampler::ConvertedPixelSize(msgsPixelFormat);
+  if (msgsPixelFormat != msgs::PixelFormatType::RGB_INT8 && pixelSize > 0u)
+  {
+    IGN_PROFILE("CameraSensor::Update Convert");
+    std::vector<unsigned char> &buffer = this->dataPtr->convertBuffer;
+    buffer.resize(static_cast<std::size_t>(width) * height * pixelSize);
+    ImageResampler::ConvertRgb(data, width, height, step, msgsPixelFormat,
+        buffer.data());
+    msgData = buffer.data();
+    step = width * pixelSize;
+  }
+
+  // Image view callbacks alone don't need a message
+  ignition::msgs::Image &msg = this->dataPtr->msg;
+  const bool rawConsumers = this->PublishRawImages() &&
+      this->HasConsumers(this->dataPtr->pub);
+  const bool buildMsg = rawConsumers || this->HasCompressedConnections() ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0;
+
+  // create message
+  if (buildMsg)
+  {
+    IGN_PROFILE("CameraSensor::Update Message");
+    auto messageStart = std::chrono::steady_clock::now();
+    msg.set_width(width);
+    msg.set_height(height);
+    msg.set_step(step);
+    msg.set_pixel_format_type(msgsPixelFormat);
+    this->StampHeader(msg.mutable_header(), stamp);
+    msg.set_data(msgData, static_cast<std::size_t>(step) * height);
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+  }
+
+  // publish the image message
+  {
+    IGN_PROFILE("CameraSensor::Update Publish");
+    auto publishStart = std::chrono::steady_clock::now();
+    if (buildMsg)
+    {
+      if (rawConsumers)
+      {
+        this->PublishShared(this->dataPtr->pub, msg, msg.mutable_data(),
+            msg.mutable_header());
+      }
+      this->PublishCompressed(msg);
+    }
+    // Streams are made from the rendered RGB images
+    if (this->dataPtr->camera->ImageFormat() == rendering::PF_R8G8B8)
+      this->PublishImageStreams(data, width, height, stamp);
+
+    // publish the camera info message
+    this->PublishInfo(stamp);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    if (buildMsg)
+      this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (this->dataPtr->imageEvent.ConnectionCount() > 0)
+  {
+    ++this->dataPtr->callbacksRunning;
+    try
+    {
+      this->dataPtr->imageEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an image callback.\n";
+    }
+    --this->dataPtr->callbacksRunning;
+  }
+
+  if (this->HasImageViewCallbacks())
+  {
+    ImageView view;
+    view.data = msgData;
+    view.width = width;
+    view.height = height;
+    view.step = step;
+    view.format = msgsPixelFormat;
+    view.stamp = stamp;
+    this->DeliverImageView(view);
+  }
+
+  // Save image
+  this->SaveFrame(msgData, width, height, step, msgsPixelFormat);
+}
+//////////////////////////////////////////////////
+void CameraSensorPrivate::CreateReadbackSlots(
+    const rendering::ScenePtr &_scene, const std::string &_name,
+    const sdf::Camera *_cameraSdf)
+{
+  this->DestroyReadbackSlots(_scene);
+  if (this->readbackDepth <= 1u || !this->camera || !_scene)
+    return;
+
+  this->readbackSlots.resize(this->readbackDepth);
+  this->readbackSlots[0].camera = this->camera;
+  this->readbackSlots[0].image = this->image;
+
+  for (std::size_t i = 1u; i < this->readbackSlots.size(); ++i)
+  {
+    ReadbackSlot &slot = this->readbackSlots[i];
+    slot.camera = _scene->CreateCamera(
+        _name + "_readback_" + std::to_string(i));
+    if (!slot.camera)
+    {
+      ignerr << "Unable to create readback camera for sensor [" << _name
+             << "], reading back synchronously." << std::endl;
+      this->DestroyReadbackSlots(_scene);
+      return;
+    }
+
+    CopyCameraSettings(*this->camera, *slot.camera);
+
+    if (_cameraSdf && this->distortion)
+      slot.distortion = AddDistortion(*_cameraSdf, slot.camera);
+
+    if (_cameraSdf &&
+        _cameraSdf->ImageNoise().Type() == sdf::NoiseType::GAUSSIAN)
+    {
+      NoisePtr noise =
+          ImageNoiseFactory::NewNoiseModel(_cameraSdf->ImageNoise(), "camera");
+      auto gaussian =
+          std::dynamic_pointer_cast<ImageGaussianNoiseModel>(noise);
+      if (gaussian)
+      {
+        gaussian->SetCamera(slot.camera);
+        slot.noises.push_back(noise);
+      }
+    }
+
+    slot.image = slot.camera->CreateImage();
+    _scene->RootVisual()->AddChild(slot.camera);
+  }
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::ConfigureReadbackSlots()
+{
+  for (std::size_t i = 0u; i < this->readbackSlots.size(); ++i)
+  {
+    ReadbackSlot &slot = this->readbackSlots[i];
+    if (i > 0u)
+    {
+      CopyCameraSettings(*this->camera, *slot.camera);
+      if (slot.image.Width() != slot.camera->ImageWidth() ||
+          slot.image.Height() != slot.camera->ImageHeight())
+      {
+        slot.image = slot.camera->CreateImage();
+      }
+    }
+    else
+    {
+      slot.image = this->image;
+    }
+    slot.pending = false;
+  }
+  this->nextSlot = 0u;
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::RenderSize(const double _scale,
+    unsigned int &_width, unsigned int &_height) const
+{
+  _width = std::max(1u, static_cast<unsigned int>(
+      std::lround(this->imageWidth * _scale)));
+  _height = std::max(1u, static_cast<unsigned int>(
+      std::lround(this->imageHeight * _scale)));
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::ResizeCameras()
+{
+  this->resizePending = false;
+  if (!this->camera)
+    return;
+
+  unsigned int width = 0u;
+  unsigned int height = 0u;
+  this->RenderSize(this->renderScale, width, height);
+  if (width == this->camera->ImageWidth() &&
+      height == this->camera->ImageHeight())
+  {
+    return;
+  }
+
+  this->camera->SetImageWidth(width);
+  this->camera->SetImageHeight(height);
+  this->image = this->camera->CreateImage();
+  for (std::size_t i = 0u; i < this->readbackSlots.size(); ++i)
+  {
+    ReadbackSlot &slot = this->readbackSlots[i];
+    if (i > 0u)
+    {
+      slot.camera->SetImageWidth(width);
+      slot.camera->SetImageHeight(height);
+      slot.image = slot.camera->CreateImage();
+    }
+    else
+    {
+      slot.image = this->image;
+    }
+    slot.pending = false;
+  }
+  this->renderPending = false;
+  this->frameData = nullptr;
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::AdaptResolution(
+    const std::chrono::steady_clock::duration &_copyTime,
+    const double _qualityScale)
+{
+  if (!this->resolution.AddFrameTime(this->renderTime + _copyTime))
+    return;
+
+  this->renderScale = _qualityScale * this->resolution.Scale();
+  this->resizePending = true;
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::DestroyReadbackSlots(
+    const rendering::ScenePtr &_scene)
+{
+  // The first slot is the primary camera, which is kept
+  for (std::size_t i = 1u; i < this->readbackSlots.size(); ++i)
+  {
+    ReadbackSlot &slot = this->readbackSlots[i];
+    slot.noises.clear();
+    slot.distortion.reset();
+    if (_scene && slot.camera)
+      _scene->DestroySensor(slot.camera);
+  }
+  this->readbackSlots.clear();
+  this->nextSlot = 0u;
+  this->renderPending = false;
+  this->frameData = nullptr;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::SetReadbackDepth(unsigned int _depth)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  unsigned int depth = std::max(1u, std::min(_depth, kMaxReadbackDepth));
+  if (depth != _depth)
+  {
+    ignwarn << "Readback depth [" << _depth << "] of sensor ["
+            << this->Name() << "] is out of range, using [" << depth
+            << "]." << std::endl;
+  }
+
+  if (depth == this->dataPtr->readbackDepth)
+    return;
+
+  this->dataPtr->readbackDepth = depth;
+  if (this->dataPtr->camera)
+  {
+    this->dataPtr->CreateReadbackSlots(this->Scene(), this->Name(),
+        this->SdfSensor().CameraSensor());
+  }
+}
+
+//////////////////////////////////////////////////
+unsigned int CameraSensor::ReadbackDepth() const
+{
+  return this->dataPtr->readbackDepth;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::SetAdaptiveResolution(
+    const std::chrono::steady_clock::duration &_budget,
+    const double _minScale, const bool _publishScaled)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->resolution.SetMinScale(_minScale);
+  this->dataPtr->resolution.SetBudget(_budget);
+  this->dataPtr->publishScaled = _publishScaled;
+
+  // Start over from the resolution of the render quality profile
+  this->dataPtr->renderScale = this->QualityResolutionScale();
+  this->dataPtr->resizePending = true;
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration
+    CameraSensor::AdaptiveResolutionBudget() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->resolution.Budget();
+}
+
+//////////////////////////////////////////////////
+double CameraSensor::ResolutionScale() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->renderScale;
+}
+
 //////////////////////////////////////////////////
 unsigned int CameraSensor::ImageWidth() const
 {
   if (this->dataPtr->camera)
-    return this->dataPtr->camera->ImageWidth();
+    return this->dataPtr->imageWidth;
   return 0;
 }
 
@@ -476,7 +1422,7 @@ unsigned int CameraSensor::ImageWidth() const
 unsigned int CameraSensor::ImageHeight() const
 {
   if (this->dataPtr->camera)
-    return this->dataPtr->camera->ImageHeight();
+    return this->dataPtr->imageHeight;
   return 0;
 }
 
@@ -508,15 +1454,18 @@ bool CameraSensor::AdvertiseInfo()
   this->dataPtr->infoTopic += "/camera_info";
 
   this->dataPtr->infoPub =
-      this->dataPtr->node.Advertise<ignition::msgs::CameraInfo>(
+      this->TransportNode().Advertise<ignition::msgs::CameraInfo>(
       this->dataPtr->infoTopic);
   if (!this->dataPtr->infoPub)
   {
     ignerr << "Unable to create publisher on topic["
       << this->dataPtr->infoTopic << "].\n";
+    return false;
   }
+  this->SetOutputTopic(this->dataPtr->infoTopic, &this->dataPtr->infoPub);
 
-  return this->dataPtr->infoPub;
+  this->dataPtr->AdvertiseInfoService(this->TransportNode());
+  return true;
 }
 
 //////////////////////////////////////////////////
@@ -525,24 +1474,93 @@ bool CameraSensor::AdvertiseInfo(const std::string &_topic)
   this->dataPtr->infoTopic = _topic;
 
   this->dataPtr->infoPub =
-      this->dataPtr->node.Advertise<ignition::msgs::CameraInfo>(
+      this->TransportNode().Advertise<ignition::msgs::CameraInfo>(
       this->dataPtr->infoTopic);
   if (!this->dataPtr->infoPub)
   {
     ignerr << "Unable to create publisher on topic["
       << this->dataPtr->infoTopic << "].\n";
+    return false;
   }
+  this->SetOutputTopic(this->dataPtr->infoTopic, &this->dataPtr->infoPub);
 
-  return this->dataPtr->infoPub;
+  this->dataPtr->AdvertiseInfoService(this->TransportNode());
+  return true;
 }
 
 //////////////////////////////////////////////////
 void CameraSensor::PublishInfo(
   const std::chrono::steady_clock::duration &_now)
 {
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+
+  // Unchanged camera info is only published once per period. Time going
+  // back means the simulation was reset.
+  const bool due = this->dataPtr->infoPeriod <=
+      std::chrono::steady_clock::duration::zero() ||
+      _now < this->dataPtr->infoStamp ||
+      _now - this->dataPtr->infoStamp >= this->dataPtr->infoPeriod;
+  if (!this->dataPtr->infoDirty && !due)
+    return;
+
   *this->dataPtr->infoMsg.mutable_header()->mutable_stamp() =
     msgs::Convert(_now);
-  this->dataPtr->infoPub.Publish(this->dataPtr->infoMsg);
+  if (this->Publish(this->dataPtr->infoPub, this->dataPtr->infoMsg))
+  {
+    this->dataPtr->infoDirty = false;
+    this->dataPtr->infoStamp = _now;
+  }
+}
+
+//////////////////////////////////////////////////
+std::string CameraSensor::InfoService() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+  return this->dataPtr->infoService;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::SetInfoPublishPeriod(
+    const std::chrono::steady_clock::duration &_period)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+  this->dataPtr->infoPeriod = _period;
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration CameraSensor::InfoPublishPeriod() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+  return this->dataPtr->infoPeriod;
+}
+
+//////////////////////////////////////////////////
+void CameraSensorPrivate::AdvertiseInfoService(transport::Node &_node)
+{
+  std::lock_guard<std::mutex> lock(this->infoMutex);
+  std::string service = this->infoTopic + "/request";
+  if (service == this->infoService)
+    return;
+
+  if (!this->infoService.empty())
+    _node.UnadvertiseSrv(this->infoService);
+  this->infoService.clear();
+
+  if (!_node.Advertise(service, &CameraSensorPrivate::OnInfoRequest, this))
+  {
+    ignerr << "Unable to advertise service [" << service << "].\n";
+    return;
+  }
+  this->infoService = service;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensorPrivate::OnInfoRequest(const msgs::Empty &/*_req*/,
+    msgs::CameraInfo &_rep)
+{
+  std::lock_guard<std::mutex> lock(this->infoMutex);
+  _rep.CopyFrom(this->infoMsg);
+  return true;
 }
 
 //////////////////////////////////////////////////
@@ -555,6 +1573,12 @@ void CameraSensor::PublishInfo(
 //////////////////////////////////////////////////
 void CameraSensor::PopulateInfo(const sdf::Camera *_cameraSdf)
 {
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+  this->dataPtr->infoDirty = true;
+
+  // Reconfigured cameras populate the info again
+  this->dataPtr->infoMsg.Clear();
+
   unsigned int width = _cameraSdf->ImageWidth();
   unsigned int height = _cameraSdf->ImageHeight();
 
@@ -633,6 +1657,8 @@ void CameraSensor::SetBaseline(double _baseline)
   this->dataPtr->baseline = _baseline;
 
   // Also update message
+  std::lock_guard<std::mutex> lock(this->dataPtr->infoMutex);
+  this->dataPtr->infoDirty = true;
   if (this->dataPtr->infoMsg.has_projection() &&
       this->dataPtr->infoMsg.projection().p_size() == 12)
   {
@@ -647,4 +1673,333 @@ double CameraSensor::Baseline() const
   return this->dataPtr->baseline;
 }
 
+//////////////////////////////////////////////////
+bool CameraSensor::HasConnections() const
+{
+  return (this->PublishRawImages() &&
+      this->HasConsumers(this->dataPtr->pub)) ||
+      this->HasCompressedConnections() ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0u ||
+      this->HasImageViewCallbacks() ||
+      this->SavesFrames() || this->dataPtr->HasStreamConnections();
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::ConsumersBusy() const
+{
+  return this->dataPtr->callbacksRunning > 0u || Sensor::ConsumersBusy();
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::SetCompressedOutput(const ImageCompression _compression,
+    const int _quality, const bool _publishRaw)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  this->dataPtr->compressedPub.reset();
+  this->dataPtr->compressedTopic.clear();
+  this->dataPtr->publishRaw = true;
+
+  if (_compression == ImageCompression::NONE)
+    return true;
+
+  if (!this->SupportsCompressedOutput())
+  {
+    ignerr << "Sensor [" << this->Name() << "] doesn't support compressed "
+           << "images.\n";
+    return false;
+  }
+
+  if (!CompressedImagePublisher::Supported(_compression))
+  {
+    ignerr << "Image compression [" << static_cast<int>(_compression)
+           << "] is not available in this build.\n";
+    return false;
+  }
+
+  std::string topic = this->Topic() + "/compressed";
+  auto pub = this->TransportNode().Advertise<ignition::msgs::Image>(topic);
+  if (!pub)
+  {
+    ignerr << "Unable to create publisher on topic[" << topic << "].\n";
+    return false;
+  }
+
+  // Two images in flight let one be encoded while the next is copied
+  this->dataPtr->compressedPub.reset(
+      new CompressedImagePublisher(pub, _compression, _quality, 2u));
+  this->dataPtr->compressedTopic = topic;
+  this->dataPtr->publishRaw = _publishRaw;
+  return true;
+}
+
+//////////////////////////////////////////////////
+ImageCompression CameraSensor::CompressedOutput() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  return this->dataPtr->compressedPub ?
+      this->dataPtr->compressedPub->Compression() : ImageCompression::NONE;
+}
+
+//////////////////////////////////////////////////
+std::string CameraSensor::CompressedTopic() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  return this->dataPtr->compressedTopic;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::SupportsCompressedOutput() const
+{
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::PublishRawImages() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  return this->dataPtr->publishRaw;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::PublishCompressed(const ignition::msgs::Image &_msg)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  if (this->dataPtr->compressedPub &&
+      this->dataPtr->compressedPub->HasConnections())
+  {
+    this->dataPtr->compressedPub->Push(_msg);
+  }
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::HasCompressedConnections() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->compressedMutex);
+  return this->dataPtr->compressedPub &&
+      this->dataPtr->compressedPub->HasConnections();
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::SetSaveFileFormat(const FrameFileFormat _format)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->saveMutex);
+  this->dataPtr->saveFileFormat = _format;
+  if (this->dataPtr->frameWriter)
+    this->dataPtr->frameWriter->SetFormat(_format);
+}
+
+//////////////////////////////////////////////////
+FrameFileFormat CameraSensor::SaveFileFormat() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->saveMutex);
+  return this->dataPtr->saveFileFormat;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::EnableSaveFrames(const std::string &_path,
+    const std::string &_prefix)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->saveMutex);
+  // A few queued frames absorb short stalls of the disk
+  this->dataPtr->frameWriter.reset(new FrameWriter(_path, _prefix, 4u));
+  this->dataPtr->frameWriter->SetFormat(this->dataPtr->saveFileFormat);
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::SaveFrame(const unsigned char *_data,
+    const unsigned int _width, const unsigned int _height,
+    const unsigned int _step, const ignition::msgs::PixelFormatType _format)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->saveMutex);
+  if (!this->dataPtr->frameWriter)
+    return false;
+
+  if (this->dataPtr->frameWriter->Push(_data, _width, _height, _step,
+        _format))
+  {
+    return true;
+  }
+
+  this->RecordDroppedSave();
+  if (!this->dataPtr->saveDropReported)
+  {
+    ignwarn << "Sensor [" << this->Name() << "] is producing frames faster "
+            << "than they can be saved. Frames will be dropped.\n";
+    this->dataPtr->saveDropReported = true;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::SavesFrames() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->saveMutex);
+  return this->dataPtr->frameWriter != nullptr;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensorPrivate::HasStreamConnections() const
+{
+  std::lock_guard<std::mutex> lock(this->streamsMutex);
+  for (const ImageStream &stream : this->streams)
+  {
+    if (this->HasConsumers(stream.pub))
+      return true;
+  }
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::AddImageStream(const std::string &_name,
+    const unsigned int _width, const unsigned int _height,
+    const math::Vector2i &_roiOffset, const math::Vector2i &_roiSize)
+{
+  if (!this->SupportsImageStreams())
+  {
+    ignerr << "Sensor [" << this->Name() << "] doesn't support image "
+           << "streams.\n";
+    return false;
+  }
+
+  if (_width == 0u || _height == 0u || _roiOffset.X() < 0 ||
+      _roiOffset.Y() < 0 || _roiSize.X() < 0 || _roiSize.Y() < 0)
+  {
+    ignerr << "Invalid size or region for image stream [" << _name
+           << "].\n";
+    return false;
+  }
+
+  // Check the region now if the frame size is known
+  ImageStream stream;
+  stream.width = _width;
+  stream.height = _height;
+  stream.roiOffset = _roiOffset;
+  stream.roiSize = _roiSize;
+  stream.resampler = std::make_shared<ImageResampler>();
+  const unsigned int frameWidth = this->ImageWidth();
+  const unsigned int frameHeight = this->ImageHeight();
+  if (frameWidth > 0u && frameHeight > 0u &&
+      !ConfigureStream(stream, frameWidth, frameHeight))
+  {
+    ignerr << "Region of image stream [" << _name << "] doesn't fit in the "
+           << frameWidth << "x" << frameHeight << " images of sensor ["
+           << this->Name() << "].\n";
+    return false;
+  }
+
+  std::string topic = transport::TopicUtils::AsValidTopic(
+      this->Topic() + "/" + _name);
+  if (_name.empty() || topic.empty())
+  {
+    ignerr << "Invalid image stream name [" << _name << "].\n";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->streamsMutex);
+  for (const ImageStream &existing : this->dataPtr->streams)
+  {
+    if (existing.name == _name)
+    {
+      ignerr << "Image stream [" << _name << "] already exists.\n";
+      return false;
+    }
+  }
+
+  stream.pub = this->TransportNode().Advertise<ignition::msgs::Image>(topic);
+  if (!stream.pub)
+  {
+    ignerr << "Unable to create publisher on topic[" << topic << "].\n";
+    return false;
+  }
+
+  stream.name = _name;
+  stream.topic = topic;
+  stream.msg = std::make_shared<msgs::Image>();
+  this->dataPtr->streams.push_back(std::move(stream));
+
+  // Growing the list may have moved the publishers of the other streams
+  for (ImageStream &existing : this->dataPtr->streams)
+    this->SetOutputTopic(existing.topic, &existing.pub);
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::RemoveImageStream(const std::string &_name)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->streamsMutex);
+  auto &streams = this->dataPtr->streams;
+  auto it = std::find_if(streams.begin(), streams.end(),
+      [&_name](const ImageStream &_stream)
+      {
+        return _stream.name == _name;
+      });
+  if (it == streams.end())
+    return false;
+
+  this->SetOutputTopic(it->topic, nullptr);
+  streams.erase(it);
+  for (ImageStream &existing : streams)
+    this->SetOutputTopic(existing.topic, &existing.pub);
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string CameraSensor::ImageStreamTopic(const std::string &_name) const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->streamsMutex);
+  for (const ImageStream &stream : this->dataPtr->streams)
+  {
+    if (stream.name == _name)
+      return stream.topic;
+  }
+  return "";
+}
+
+//////////////////////////////////////////////////
+bool CameraSensor::SupportsImageStreams() const
+{
+  return true;
+}
+
+//////////////////////////////////////////////////
+void CameraSensor::PublishImageStreams(const unsigned char *_data,
+    const unsigned int _width, const unsigned int _height,
+    const std::chrono::steady_clock::duration &_stamp)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->streamsMutex);
+  for (ImageStream &stream : this->dataPtr->streams)
+  {
+    if (!this->HasConsumers(stream.pub))
+      continue;
+
+    IGN_PROFILE("CameraSensor::Update Image stream");
+    ImageResampler &resampler = *stream.resampler;
+    if (!resampler.Matches(_width, _height, 3u) &&
+        !ConfigureStream(stream, _width, _height))
+    {
+      if (!stream.errorReported)
+      {
+        ignerr << "Region of image stream [" << stream.name << "] doesn't "
+               << "fit in the " << _width << "x" << _height << " images of "
+               << "sensor [" << this->Name() << "].\n";
+        stream.errorReported = true;
+      }
+      continue;
+    }
+
+    msgs::Image &msg = *stream.msg;
+    msg.set_width(stream.width);
+    msg.set_height(stream.height);
+    msg.set_step(stream.width * 3u);
+    msg.set_pixel_format_type(msgs::PixelFormatType::RGB_INT8);
+    this->StampHeader(msg.mutable_header(), _stamp);
+    std::string &data = *msg.mutable_data();
+    data.resize(resampler.OutputSize());
+    resampler.Resample(_data, _width * 3u,
+        reinterpret_cast<unsigned char *>(&data[0]));
+    this->Publish(stream.pub, msg);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+}
+
 IGN_SENSORS_REGISTER_SENSOR(CameraSensor)
@@ -0,0 +1,358 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
+#include <ignition/common/Profiler.hh>
+#include <ignition/common/SubMesh.hh>
+
+#include "ignition/sensors/CpuLidarSensor.hh"
+#include "ignition/sensors/SensorFactory.hh"
+
+#include "RayCaster.hh"
+#include "WorkerPool.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Number of rays cast by a job. A multiple of the ray packets.
+static const unsigned int kRaysPerJob = 256u;
+
+/// \brief Private data for CpuLidarSensor
+class ignition::sensors::CpuLidarSensorPrivate
+{
+  /// \brief Update the directions of the rays if the angles or the number
+  /// of ranges changed.
+  /// \param[in] _angles Minimum and maximum azimuth and inclination
+  /// \param[in] _width Number of rays in a row
+  /// \param[in] _height Number of rows
+  public: void UpdateRayDirections(const std::array<double, 4> &_angles,
+              const unsigned int _width, const unsigned int _height);
+
+  /// \brief Meshes rays are cast against
+  public: RayCaster caster;
+
+  /// \brief Protects the caster
+  public: mutable std::mutex casterMutex;
+
+  /// \brief Unit direction of each ray in the sensor frame, 3 values per
+  /// ray, in the layout of the laser buffer
+  public: std::vector<float> rayDirections;
+
+  /// \brief Angles rayDirections was computed for
+  public: std::array<double, 4> rayAngles = {{0.0, 0.0, 0.0, 0.0}};
+
+  /// \brief Number of rays in a row of rayDirections
+  public: unsigned int rayWidth = 0u;
+
+  /// \brief Number of rows of rayDirections
+  public: unsigned int rayHeight = 0u;
+
+  /// \brief Number of floats of the laser buffer
+  public: std::size_t laserBufferSize = 0u;
+
+  /// \brief Requested number of threads, 0 for one per core
+  public: unsigned int threadCount = 0u;
+
+  /// \brief Threads casting the rays, null if they're cast serially
+  public: std::unique_ptr<WorkerPool> pool;
+
+  /// \brief Index of the sector of the sweep scanned by the next update
+  public: unsigned int sweepSector = 0u;
+
+  /// \brief Event fired with every scan, before noise is applied
+  public: ignition::common::EventT<void(const float *, unsigned int,
+      unsigned int, unsigned int, const std::string &)> frameEvent;
+};
+
+//////////////////////////////////////////////////
+void CpuLidarSensorPrivate::UpdateRayDirections(
+    const std::array<double, 4> &_angles, const unsigned int _width,
+    const unsigned int _height)
+{
+  if (_angles == this->rayAngles && _width == this->rayWidth &&
+      _height == this->rayHeight && !this->rayDirections.empty())
+  {
+    return;
+  }
+
+  IGN_PROFILE("CpuLidarSensorPrivate::UpdateRayDirections");
+  const double step = _width > 1u ?
+      (_angles[1] - _angles[0]) / (_width - 1u) : 0.0;
+  const double verticalStep = _height > 1u ?
+      (_angles[3] - _angles[2]) / (_height - 1u) : 0.0;
+
+  this->rayDirections.resize(
+      static_cast<std::size_t>(_width) * _height * 3u);
+  float *direction = this->rayDirections.data();
+  for (unsigned int j = 0u; j < _height; ++j)
+  {
+    const double inclination = _angles[2] + j * verticalStep;
+    const double cosInclination = std::cos(inclination);
+    const float z = static_cast<float>(std::sin(inclination));
+    for (unsigned int i = 0u; i < _width; ++i, direction += 3)
+    {
+      const double azimuth = _angles[0] + i * step;
+      direction[0] = static_cast<float>(cosInclination * std::cos(azimuth));
+      direction[1] = static_cast<float>(cosInclination * std::sin(azimuth));
+      direction[2] = z;
+    }
+  }
+
+  this->rayAngles = _angles;
+  this->rayWidth = _width;
+  this->rayHeight = _height;
+}
+
+//////////////////////////////////////////////////
+CpuLidarSensor::CpuLidarSensor()
+  : dataPtr(new CpuLidarSensorPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+CpuLidarSensor::~CpuLidarSensor()
+{
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::Update(const ignition::common::Time &_now)
+{
+  return this->Update(math::secNsecToDuration(_now.sec, _now.nsec));
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::Update(const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("CpuLidarSensor::Update");
+  if (!this->initialized)
+  {
+    ignerr << "Not initialized, update ignored.\n";
+    return false;
+  }
+
+  // A ray is cast for every range of the scan
+  const unsigned int width = this->RangeCount();
+  const unsigned int height = this->VerticalRangeCount();
+  if (width == 0u || height == 0u)
+  {
+    ignerr << "Lidar has no rays, update ignored.\n";
+    return false;
+  }
+
+  this->dataPtr->UpdateRayDirections({{this->AngleMin().Radian(),
+      this->AngleMax().Radian(), this->VerticalAngleMin().Radian(),
+      this->VerticalAngleMax().Radian()}}, width, height);
+
+  // Noise is applied to the ray counts, which only match the range counts
+  // with a resolution of 1
+  const std::size_t len = std::max(
+      static_cast<std::size_t>(width) * height,
+      static_cast<std::size_t>(this->RayCount()) *
+      this->VerticalRayCount()) * 3u;
+  if (this->laserBuffer == nullptr || this->dataPtr->laserBufferSize != len)
+  {
+    delete [] this->laserBuffer;
+    this->laserBuffer = new float[len];
+    std::fill(this->laserBuffer, this->laserBuffer + len, 0.0f);
+    this->dataPtr->laserBufferSize = len;
+  }
+
+  // Columns scanned by this update
+  const unsigned int sectors = this->SweepSectors();
+  const unsigned int sector = this->dataPtr->sweepSector % sectors;
+  unsigned int firstColumn = 0u;
+  unsigned int columns = width;
+  if (sectors > 1u)
+    this->SweepSectorColumns(sector, firstColumn, columns);
+
+  {
+    auto castStart = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(this->dataPtr->casterMutex);
+    this->dataPtr->caster.Build();
+
+    // Each job casts a run of rays of a row
+    const unsigned int jobsPerRow =
+        (columns + kRaysPerJob - 1u) / kRaysPerJob;
+    const math::Pose3d pose = this->Pose();
+    const double rangeMin = this->RangeMin();
+    const double rangeMax = this->RangeMax();
+    auto cast = [&](const std::size_t _job)
+    {
+      const std::size_t row = _job / jobsPerRow;
+      const std::size_t first =
+          firstColumn + (_job % jobsPerRow) * kRaysPerJob;
+      const std::size_t count = std::min<std::size_t>(kRaysPerJob,
+          firstColumn + columns - first);
+      const std::size_t ray = row * width + first;
+      this->dataPtr->caster.Cast(pose,
+          this->dataPtr->rayDirections.data() + ray * 3u, count, rangeMin,
+          rangeMax, this->laserBuffer + ray * 3u);
+    };
+
+    const std::size_t jobs = static_cast<std::size_t>(jobsPerRow) * height;
+    const unsigned int threads = static_cast<unsigned int>(
+        std::min<std::size_t>(jobs, this->ThreadCount()));
+    if (threads > 1u)
+    {
+      if (!this->dataPtr->pool ||
+          this->dataPtr->pool->ThreadCount() != threads)
+      {
+        this->dataPtr->pool.reset(new WorkerPool(threads));
+      }
+      this->dataPtr->pool->ParallelFor(jobs, cast);
+    }
+    else
+    {
+      for (std::size_t job = 0u; job < jobs; ++job)
+        cast(job);
+    }
+    this->RecordPhase(UpdatePhase::RENDER, castStart);
+  }
+
+  this->dataPtr->frameEvent(this->laserBuffer, width, height, 3u,
+      "PF_FLOAT32_RGB");
+
+  auto noiseStart = std::chrono::steady_clock::now();
+  if (sectors > 1u)
+    this->ApplyNoise(firstColumn, columns);
+  else
+    this->ApplyNoise();
+  this->RecordPhase(UpdatePhase::NOISE, noiseStart);
+
+  if (sectors > 1u)
+  {
+    this->PublishLidarSector(_now, sector);
+    this->dataPtr->sweepSector = (sector + 1u) % sectors;
+  }
+  else
+  {
+    this->PublishLidarScan(_now);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::IsRenderingSensor() const
+{
+  return false;
+}
+
+//////////////////////////////////////////////////
+SensorMemory CpuLidarSensor::MemoryUsage() const
+{
+  SensorMemory memory = Lidar::MemoryUsage();
+  memory.readbackBytes += this->dataPtr->laserBufferSize * sizeof(float) +
+      this->dataPtr->rayDirections.capacity() * sizeof(float);
+  return memory;
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::SetMesh(const std::string &_name,
+    const std::vector<math::Vector3d> &_vertices,
+    const std::vector<unsigned int> &_indices, const double _retro)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->casterMutex);
+  if (!this->dataPtr->caster.SetMesh(_name, _vertices, _indices, _retro))
+  {
+    ignerr << "Invalid triangle indices for mesh [" << _name
+           << "] of lidar [" << this->Name() << "]" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::SetMesh(const std::string &_name,
+    const common::Mesh &_mesh, const math::Vector3d &_scale,
+    const double _retro)
+{
+  std::vector<math::Vector3d> vertices;
+  std::vector<unsigned int> indices;
+  for (unsigned int s = 0u; s < _mesh.SubMeshCount(); ++s)
+  {
+    auto subMesh = _mesh.SubMeshByIndex(s).lock();
+    if (!subMesh ||
+        subMesh->SubMeshPrimitiveType() != common::SubMesh::TRIANGLES)
+    {
+      continue;
+    }
+
+    const unsigned int offset = static_cast<unsigned int>(vertices.size());
+    for (unsigned int v = 0u; v < subMesh->VertexCount(); ++v)
+      vertices.push_back(subMesh->Vertex(v) * _scale);
+    for (unsigned int i = 0u; i < subMesh->IndexCount(); ++i)
+    {
+      indices.push_back(
+          offset + static_cast<unsigned int>(subMesh->Index(i)));
+    }
+  }
+  return this->SetMesh(_name, vertices, indices, _retro);
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::SetMeshPose(const std::string &_name,
+    const math::Pose3d &_pose)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->casterMutex);
+  return this->dataPtr->caster.SetMeshPose(_name, _pose);
+}
+
+//////////////////////////////////////////////////
+bool CpuLidarSensor::RemoveMesh(const std::string &_name)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->casterMutex);
+  return this->dataPtr->caster.RemoveMesh(_name);
+}
+
+//////////////////////////////////////////////////
+std::size_t CpuLidarSensor::MeshCount() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->casterMutex);
+  return this->dataPtr->caster.MeshCount();
+}
+
+//////////////////////////////////////////////////
+void CpuLidarSensor::SetThreadCount(const unsigned int _threads)
+{
+  this->dataPtr->threadCount = _threads;
+}
+
+//////////////////////////////////////////////////
+unsigned int CpuLidarSensor::ThreadCount() const
+{
+  return this->dataPtr->threadCount > 0u ? this->dataPtr->threadCount :
+      std::max(1u, std::thread::hardware_concurrency());
+}
+
+/////////////////////////////////////////////////
+ignition::common::ConnectionPtr CpuLidarSensor::ConnectNewLidarFrame(
+          std::function<void(const float *_scan, unsigned int _width,
+                  unsigned int _height, unsigned int _channels,
+                  const std::string &/*_format*/)> _subscriber)
+{
+  return this->dataPtr->frameEvent.Connect(_subscriber);
+}
+
+IGN_SENSORS_REGISTER_SENSOR(CpuLidarSensor)
@@ -24,10 +24,13 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <cmath>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <ignition/common/Console.hh>
-#include <ignition/common/Image.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/common/SystemPaths.hh>
 
@@ -43,6 +46,9 @@
 #include "ignition/sensors/ImageNoise.hh"
 #include "ignition/sensors/RenderingEvents.hh"
 
+#include "FrameBuffer.hh"
+#include "ImageNormalize.hh"
+#include "PointCloudFilter.hh"
 #include "PointCloudUtil.hh"
 
 // undefine near and far macros from windows.h
@@ -54,28 +60,8 @@
 /// \brief Private data for DepthCameraSensor
 class ignition::sensors::DepthCameraSensorPrivate
 {
-  /// \brief Save an image
-  /// \param[in] _data the image data to be saved
-  /// \param[in] _width width of image in pixels
-  /// \param[in] _height height of image in pixels
-  /// \param[in] _format The format the data is in
-  /// \return True if the image was saved successfully. False can mean
-  /// that the path provided to the constructor does exist and creation
-  /// of the path was not possible.
-  /// \sa ImageSaver
-  public: bool SaveImage(const float *_data, unsigned int _width,
-    unsigned int _height, ignition::common::Image::PixelFormatType _format);
-
-  /// \brief Helper function to convert depth data to depth image
-  /// \param[in] _data depth data
-  /// \param[out] _imageBuffer resulting depth image data
-  /// \param[in] _width width of image
-  /// \param[in] _height height of image
-  public: bool ConvertDepthToImage(const float *_data,
-    unsigned char *_imageBuffer, unsigned int _width, unsigned int _height);
-
-  /// \brief node to create publisher
-  public: transport::Node node;
+  /// \brief Converts depth data to grayscale depth images
+  public: ImageNormalizer normalizer;
 
   /// \brief publisher to publish images
   public: transport::Node::Publisher pub;
@@ -86,14 +72,15 @@ class ignition::sensors::DepthCameraSensorPrivate
     /// \brief Rendering camera
   public: ignition::rendering::DepthCameraPtr depthCamera;
 
-  /// \brief Depth data buffer.
-  public: float *depthBuffer = nullptr;
+  /// \brief Depth frames handed over by the depth camera.
+  public: FrameBuffer<float> depthFrames;
 
-  /// \brief point cloud data buffer.
-  public: float *pointCloudBuffer = nullptr;
+  /// \brief Point cloud frames handed over by the depth camera.
+  public: FrameBuffer<float> pointCloudFrames;
 
-  /// \brief xyz data buffer.
-  public: float *xyzBuffer = nullptr;
+  /// \brief Meters per unit of the published integer depths, or 0 to
+  /// publish floating point depths.
+  public: double depthUnit = 0.0;
 
   /// \brief Near clip distance.
   public: float near = 0.0;
@@ -109,6 +96,9 @@ class ignition::sensors::DepthCameraSensorPrivate
   public: ignition::common::EventT<
           void(const ignition::msgs::Image &)> imageEvent;
 
+  /// \brief Integer depths for image views while no message is built
+  public: std::vector<uint16_t> viewDepths;
+
   /// \brief Connection from depth camera with new depth data
   public: ignition::common::ConnectionPtr depthConnection;
 
@@ -121,20 +111,8 @@ class ignition::sensors::DepthCameraSensorPrivate
   /// \brief Just a mutex for thread safety
   public: std::mutex mutex;
 
-  /// \brief True to save images
-  public: bool saveImage = false;
-
-  /// \brief path directory to where images are saved
-  public: std::string saveImagePath = "./";
-
-  /// \prefix of an image name
-  public: std::string saveImagePrefix = "./";
-
-  /// \brief counter used to set the image filename
-  public: std::uint64_t saveImageCounter = 0;
-
-  /// \brief SDF Sensor DOM object.
-  public: sdf::Sensor sdfSensor;
+  /// \brief Depth image converted for saving, reused across frames
+  public: std::vector<unsigned char> saveBuffer;
 
   /// \brief The point cloud message.
   public: msgs::PointCloudPacked pointMsg;
@@ -143,74 +121,31 @@ class ignition::sensors::DepthCameraSensorPrivate
   /// image and depth data.
   public: PointCloudUtil pointsUtil;
 
-  /// \brief publisher to publish point cloud
-  public: transport::Node::Publisher pointPub;
-};
-
-using namespace ignition;
-using namespace sensors;
-
-//////////////////////////////////////////////////
-bool DepthCameraSensorPrivate::ConvertDepthToImage(
-    const float *_data,
-    unsigned char *_imageBuffer,
-    unsigned int _width, unsigned int _height)
-{
-  float maxDepth = 0;
-  for (unsigned int i = 0; i < _height * _width; ++i)
-  {
-    if (_data[i] > maxDepth && !std::isinf(_data[i]))
-    {
-      maxDepth = _data[i];
-    }
-  }
-  double factor = 255 / maxDepth;
-  for (unsigned int j = 0; j < _height * _width; ++j)
-  {
-    unsigned char d = static_cast<unsigned char>(255 - (_data[j] * factor));
-    _imageBuffer[j * 3] = d;
-    _imageBuffer[j * 3 + 1] = d;
-    _imageBuffer[j * 3 + 2] = d;
-  }
-  return true;
-}
-
-//////////////////////////////////////////////////
-bool DepthCameraSensorPrivate::SaveImage(const float *_data,
-    unsigned int _width, unsigned int _height,
-    ignition::common::Image::PixelFormatType /*_format*/)
-{
-  // Attempt to create the directory if it doesn't exist
-  if (!ignition::common::isDirectory(this->saveImagePath))
-  {
-    if (!ignition::common::createDirectories(this->saveImagePath))
-      return false;
-  }
-
-  if (_width == 0 || _height == 0)
-    return false;
+  /// \brief True to only publish the finite points of point clouds
+  public: bool densePoints = false;
 
-  ignition::common::Image localImage;
+  /// \brief Downsamples the point clouds before they are published
+  public: PointCloudFilter pointFilter;
 
-  unsigned int depthSamples = _width * _height;
-  unsigned int depthBufferSize = depthSamples * 3;
+  /// \brief Dense point cloud message, reused across frames
+  public: msgs::PointCloudPacked densePointMsg;
 
-  unsigned char * imgDepthBuffer = new unsigned char[depthBufferSize];
+  /// \brief Downsampled point cloud message, reused across frames
+  public: msgs::PointCloudPacked filteredPointMsg;
 
-  this->ConvertDepthToImage(_data, imgDepthBuffer, _width, _height);
+  /// \brief Encoded point cloud message, reused across frames
+  public: msgs::PointCloudPacked encodedPointMsg;
 
-  std::string filename = this->saveImagePrefix +
-                         std::to_string(this->saveImageCounter) + ".png";
-  ++this->saveImageCounter;
+  /// \brief publisher to publish point cloud
+  public: transport::Node::Publisher pointPub;
 
-  localImage.SetFromData(imgDepthBuffer, _width, _height,
-      common::Image::RGB_INT8);
-  localImage.SavePNG(
-      ignition::common::joinPaths(this->saveImagePath, filename));
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: ignition::msgs::Image msg;
+};
 
-  delete[] imgDepthBuffer;
-  return true;
-}
+using namespace ignition;
+using namespace sensors;
 
 //////////////////////////////////////////////////
 DepthCameraSensor::DepthCameraSensor()
@@ -223,12 +158,6 @@ DepthCameraSensor::~DepthCameraSensor()
 {
   this->dataPtr->depthConnection.reset();
   this->dataPtr->pointCloudConnection.reset();
-  if (this->dataPtr->depthBuffer)
-    delete [] this->dataPtr->depthBuffer;
-  if (this->dataPtr->pointCloudBuffer)
-    delete [] this->dataPtr->pointCloudBuffer;
-  if (this->dataPtr->xyzBuffer)
-    delete [] this->dataPtr->xyzBuffer;
 }
 
 //////////////////////////////////////////////////
@@ -269,13 +198,22 @@ bool DepthCameraSensor::Load(const sdf::Sensor &_sdf)
     return false;
   }
 
-  this->dataPtr->sdfSensor = _sdf;
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:depth_unit"))
+    this->SetDepthUnit(elem->Get<double>("ignition:depth_unit"));
+  if (elem && elem->HasElement("ignition:dense_point_cloud"))
+  {
+    this->SetDensePointCloud(
+        elem->Get<bool>("ignition:dense_point_cloud"));
+  }
+  this->dataPtr->pointFilter.Load(elem);
+  this->dataPtr->pointsUtil.Load(elem);
 
   if (this->Topic().empty())
     this->SetTopic("/camera/depth");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::Image>(
+      this->TransportNode().Advertise<ignition::msgs::Image>(
           this->Topic());
   if (!this->dataPtr->pub)
   {
@@ -283,13 +221,14 @@ bool DepthCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   if (!this->AdvertiseInfo())
     return false;
 
   // Create the point cloud publisher
   this->dataPtr->pointPub =
-      this->dataPtr->node.Advertise<ignition::msgs::PointCloudPacked>(
+      this->TransportNode().Advertise<ignition::msgs::PointCloudPacked>(
           this->Topic() + "/points");
   if (!this->dataPtr->pointPub)
   {
@@ -297,6 +236,7 @@ bool DepthCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() + "/points" << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic() + "/points", &this->dataPtr->pointPub);
 
   // Initialize the point message.
   // \todo(anyone) The true value in the following function call forces
@@ -314,7 +254,8 @@ bool DepthCameraSensor::Load(const sdf::Sensor &_sdf)
 
   this->dataPtr->sceneChangeConnection =
       RenderingEvents::ConnectSceneChangeCallback(
-      std::bind(&DepthCameraSensor::SetScene, this, std::placeholders::_1));
+      std::bind(&DepthCameraSensor::OnSceneChange, this,
+      std::placeholders::_1));
 
   this->dataPtr->initialized = true;
 
@@ -324,7 +265,7 @@ bool DepthCameraSensor::Load(const sdf::Sensor &_sdf)
 //////////////////////////////////////////////////
 bool DepthCameraSensor::CreateCamera()
 {
-  const sdf::Camera *cameraSdf = this->dataPtr->sdfSensor.CameraSensor();
+  const sdf::Camera *cameraSdf = this->SdfSensor().CameraSensor();
 
   if (!cameraSdf)
   {
@@ -380,7 +321,7 @@ bool DepthCameraSensor::CreateCamera()
   this->dataPtr->near = near;
 
   // \todo(nkoeng) these parameters via sdf
-  this->dataPtr->depthCamera->SetAntiAliasing(2);
+  this->dataPtr->depthCamera->SetAntiAliasing(this->QualityAntiAliasing());
 
   math::Angle angle = cameraSdf->HorizontalFov();
   if (angle < 0.01 || angle > IGN_PI*2)
@@ -403,11 +344,7 @@ bool DepthCameraSensor::CreateCamera()
 
   // Create the directory to store frames
   if (cameraSdf->SaveFrames())
-  {
-    this->dataPtr->saveImagePath = cameraSdf->SaveFramesPath();
-    this->dataPtr->saveImagePrefix = this->Name() + "_";
-    this->dataPtr->saveImage = true;
-  }
+    this->EnableSaveFrames(cameraSdf->SaveFramesPath(), this->Name() + "_");
 
   this->dataPtr->depthConnection =
       this->dataPtr->depthCamera->ConnectNewDepthFrame(
@@ -415,11 +352,9 @@ bool DepthCameraSensor::CreateCamera()
         std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
         std::placeholders::_4, std::placeholders::_5));
 
-  this->dataPtr->pointCloudConnection =
-      this->dataPtr->depthCamera->ConnectNewRgbPointCloud(
-      std::bind(&DepthCameraSensor::OnNewRgbPointCloud, this,
-        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
-        std::placeholders::_4, std::placeholders::_5));
+  // The point cloud connection is made by Update() while point clouds
+  // are subscribed to.
+  this->dataPtr->pointCloudConnection.reset();
 
   // Set the values of the point message based on the camera information.
   this->dataPtr->pointMsg.set_width(this->ImageWidth());
@@ -434,26 +369,19 @@ bool DepthCameraSensor::CreateCamera()
 void DepthCameraSensor::OnNewDepthFrame(const float *_scan,
                     unsigned int _width, unsigned int _height,
                     unsigned int /*_channels*/,
-                    const std::string &_format)
+                    const std::string &/*_format*/)
 {
-  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-
   unsigned int depthSamples = _width * _height;
-  unsigned int depthBufferSize = depthSamples * sizeof(float);
-
-  ignition::common::Image::PixelFormatType format =
-    ignition::common::Image::ConvertPixelFormat(_format);
-
-  if (!this->dataPtr->depthBuffer)
-    this->dataPtr->depthBuffer = new float[depthSamples];
-
-  memcpy(this->dataPtr->depthBuffer, _scan, depthBufferSize);
+  this->dataPtr->depthFrames.Write(_scan, _width, _height);
 
   // Save image
-  if (this->dataPtr->saveImage)
+  if (this->SavesFrames() && _width > 0u && _height > 0u)
   {
-    this->dataPtr->SaveImage(_scan, _width, _height,
-        format);
+    this->dataPtr->saveBuffer.resize(depthSamples * 3u);
+    this->dataPtr->normalizer.ConvertDepth(_scan, _width, _height,
+        this->dataPtr->saveBuffer.data());
+    this->SaveFrame(this->dataPtr->saveBuffer.data(), _width, _height,
+        _width * 3u, msgs::PixelFormatType::RGB_INT8);
   }
 }
 
@@ -463,16 +391,7 @@ void DepthCameraSensor::OnNewRgbPointCloud(const float *_scan,
                     unsigned int _channels,
                     const std::string &/*_format*/)
 {
-  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-
-  unsigned int pointCloudSamples = _width * _height;
-  unsigned int pointCloudBufferSize = pointCloudSamples * _channels *
-      sizeof(float);
-
-  if (!this->dataPtr->pointCloudBuffer)
-    this->dataPtr->pointCloudBuffer = new float[pointCloudSamples * _channels];
-
-  memcpy(this->dataPtr->pointCloudBuffer, _scan, pointCloudBufferSize);
+  this->dataPtr->pointCloudFrames.Write(_scan, _width, _height, _channels);
 }
 
 /////////////////////////////////////////////////
@@ -527,59 +446,144 @@ bool DepthCameraSensor::Update(
     return false;
   }
 
+  // The depth camera only extracts and delivers point clouds while they
+  // have a listener, so only listen while someone subscribes to them.
+  const bool publishPoints = this->HasConsumers(this->dataPtr->pointPub);
+  if (publishPoints && !this->dataPtr->pointCloudConnection)
+  {
+    this->dataPtr->pointCloudConnection =
+        this->dataPtr->depthCamera->ConnectNewRgbPointCloud(
+        std::bind(&DepthCameraSensor::OnNewRgbPointCloud, this,
+          std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+          std::placeholders::_4, std::placeholders::_5));
+  }
+  else if (!publishPoints && this->dataPtr->pointCloudConnection)
+  {
+    this->dataPtr->pointCloudConnection.reset();
+  }
+
   // generate sensor data
   this->Render();
+  this->RecordReadbackBytes(this->dataPtr->depthFrames.TakeWrittenBytes() +
+      this->dataPtr->pointCloudFrames.TakeWrittenBytes());
 
-  unsigned int width = this->dataPtr->depthCamera->ImageWidth();
-  unsigned int height = this->dataPtr->depthCamera->ImageHeight();
+  const float *depthData = this->dataPtr->depthFrames.Acquire();
+  const float *pointCloudData =
+      publishPoints ? this->dataPtr->pointCloudFrames.Acquire() : nullptr;
+  if (!depthData)
+    return false;
 
-  auto msgsFormat = msgs::PixelFormatType::R_FLOAT32;
+  unsigned int width = this->dataPtr->depthFrames.Width();
+  unsigned int height = this->dataPtr->depthFrames.Height();
+
+  const bool integerDepth = this->dataPtr->depthUnit > 0.0;
+  auto msgsFormat = integerDepth ? msgs::PixelFormatType::L_INT16 :
+      msgs::PixelFormatType::R_FLOAT32;
+  auto pixelFormat = integerDepth ? rendering::PF_L16 :
+      rendering::PF_FLOAT32_R;
+
+  const unsigned int step =
+      width * rendering::PixelUtil::BytesPerPixel(pixelFormat);
+
+  // Image view callbacks alone don't need a message
+  ignition::msgs::Image &msg = this->dataPtr->msg;
+  const bool buildMsg = this->HasConsumers(this->dataPtr->pub) ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0u;
+  const bool views = this->HasImageViewCallbacks();
+  const unsigned char *viewData =
+      reinterpret_cast<const unsigned char *>(depthData);
 
   // create message
-  ignition::msgs::Image msg;
-  msg.set_width(width);
-  msg.set_height(height);
-  msg.set_step(width * rendering::PixelUtil::BytesPerPixel(
-               rendering::PF_FLOAT32_R));
-  msg.set_pixel_format_type(msgsFormat);
-  *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-  auto frame = msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
+  if (buildMsg)
+  {
+    msg.set_width(width);
+    msg.set_height(height);
+    msg.set_step(step);
+    msg.set_pixel_format_type(msgsFormat);
+    this->StampHeader(msg.mutable_header(), _now);
 
-  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-  msg.set_data(this->dataPtr->depthBuffer,
-      rendering::PixelUtil::MemorySize(rendering::PF_FLOAT32_R,
-      width, height));
+    if (integerDepth)
+    {
+      auto messageStart = std::chrono::steady_clock::now();
+      std::string *data = msg.mutable_data();
+      data->resize(rendering::PixelUtil::MemorySize(pixelFormat, width,
+          height));
+      this->dataPtr->normalizer.QuantizeDepth(depthData, width, height,
+          static_cast<float>(this->dataPtr->depthUnit),
+          reinterpret_cast<uint16_t *>(&(*data)[0]));
+      this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+    }
+    else
+    {
+      msg.set_data(depthData,
+          rendering::PixelUtil::MemorySize(pixelFormat, width, height));
+    }
+  }
+  else if (views && integerDepth)
+  {
+    auto messageStart = std::chrono::steady_clock::now();
+    this->dataPtr->viewDepths.resize(static_cast<std::size_t>(width) *
+        height);
+    this->dataPtr->normalizer.QuantizeDepth(depthData, width, height,
+        static_cast<float>(this->dataPtr->depthUnit),
+        this->dataPtr->viewDepths.data());
+    viewData = reinterpret_cast<const unsigned char *>(
+        this->dataPtr->viewDepths.data());
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+  }
 
   // publish
-  this->AddSequence(msg.mutable_header(), "default");
-  this->dataPtr->pub.Publish(msg);
+  auto publishStart = std::chrono::steady_clock::now();
+  if (buildMsg)
+  {
+    this->PublishShared(this->dataPtr->pub, msg, msg.mutable_data(),
+        msg.mutable_header());
+  }
 
   // publish the camera info message
   this->PublishInfo(_now);
+  this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+  if (buildMsg)
+    this->RecordPublishedBytes(msg.ByteSizeLong());
 
   // Trigger callbacks.
-  try
+  if (this->dataPtr->imageEvent.ConnectionCount() > 0u)
   {
-    this->dataPtr->imageEvent(msg);
+    try
+    {
+      this->dataPtr->imageEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an image callback.\n";
+    }
   }
-  catch(...)
+
+  if (views)
   {
-    ignerr << "Exception thrown in an image callback.\n";
+    // Integer depths are quantized into the message when there is one
+    if (buildMsg && integerDepth)
+      viewData = reinterpret_cast<const unsigned char *>(msg.data().data());
+
+    ImageView view;
+    view.data = viewData;
+    view.width = width;
+    view.height = height;
+    view.step = step;
+    view.format = msgsFormat;
+    view.stamp = _now;
+    this->DeliverImageView(view);
   }
 
-  if (this->dataPtr->pointPub.HasConnections() &&
-      this->dataPtr->pointCloudBuffer)
+  if (publishPoints && pointCloudData &&
+      this->dataPtr->pointCloudFrames.Width() == width &&
+      this->dataPtr->pointCloudFrames.Height() == height)
   {
     // Set the time stamp
-    *this->dataPtr->pointMsg.mutable_header()->mutable_stamp() =
-      msgs::Convert(_now);
+    this->StampHeader(this->dataPtr->pointMsg.mutable_header(), _now,
+        "pointMsg");
     this->dataPtr->pointMsg.set_is_dense(true);
 
-    if (!this->dataPtr->xyzBuffer)
-      this->dataPtr->xyzBuffer = new float[width*height*3];
-
     if (this->dataPtr->image.Width() != width
         || this->dataPtr->image.Height() != height)
     {
@@ -587,23 +591,49 @@ bool DepthCameraSensor::Update(
           rendering::Image(width, height, rendering::PF_R8G8B8);
     }
 
-    // extract image data from point cloud data
-    this->dataPtr->pointsUtil.XYZFromPointCloud(
-        this->dataPtr->xyzBuffer,
-        this->dataPtr->pointCloudBuffer,
-        width, height);
-
     // convert depth to grayscale rgb image
-    this->dataPtr->ConvertDepthToImage(this->dataPtr->depthBuffer,
-        this->dataPtr->image.Data<unsigned char>(), width, height);
+    auto messageStart = std::chrono::steady_clock::now();
+    this->dataPtr->normalizer.ConvertDepth(depthData,
+        width, height, this->dataPtr->image.Data<unsigned char>());
+
+    // fill the point cloud msg with the positions of the point cloud and
+    // the colors of the depth image, in a single pass
+    this->dataPtr->pointsUtil.FillMsgFromPointCloud(this->dataPtr->pointMsg,
+        pointCloudData, this->dataPtr->image.Data<unsigned char>());
+
+    // each later stage writes into its own message, so the buffer of every
+    // stage keeps its size across frames
+    msgs::PointCloudPacked *cloud = &this->dataPtr->pointMsg;
+    if (this->dataPtr->densePoints)
+    {
+      this->dataPtr->pointsUtil.CompactMsg(*cloud,
+          this->dataPtr->densePointMsg);
+      cloud = &this->dataPtr->densePointMsg;
+    }
+
+    // downsample before serializing
+    if (this->dataPtr->pointFilter.Enabled())
+    {
+      this->dataPtr->pointFilter.Apply(*cloud,
+          this->dataPtr->filteredPointMsg);
+      cloud = &this->dataPtr->filteredPointMsg;
+    }
+
+    // encode with a reduced precision or compression, if requested
+    if (this->dataPtr->pointsUtil.Encoded() &&
+        this->dataPtr->pointsUtil.EncodeMsg(*cloud,
+        this->dataPtr->encodedPointMsg))
+    {
+      cloud = &this->dataPtr->encodedPointMsg;
+    }
 
-    // fill the point cloud msg with data from xyz and rgb buffer
-    this->dataPtr->pointsUtil.FillMsg(this->dataPtr->pointMsg,
-        this->dataPtr->xyzBuffer,
-        this->dataPtr->image.Data<unsigned char>());
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
 
-    this->AddSequence(this->dataPtr->pointMsg.mutable_header(), "pointMsg");
-    this->dataPtr->pointPub.Publish(this->dataPtr->pointMsg);
+    publishStart = std::chrono::steady_clock::now();
+    this->PublishShared(this->dataPtr->pointPub, *cloud,
+        cloud->mutable_data(), cloud->mutable_header(), "pointMsg");
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(cloud->ByteSizeLong());
   }
   return true;
 }
@@ -632,4 +662,121 @@ double DepthCameraSensor::NearClip() const
   return this->dataPtr->near;
 }
 
+//////////////////////////////////////////////////
+bool DepthCameraSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->HasConsumers(this->dataPtr->pointPub) ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0u ||
+      this->HasImageViewCallbacks();
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::SupportsStagedUpdates() const
+{
+  return false;
+}
+
+//////////////////////////////////////////////////
+SensorMemory DepthCameraSensor::MemoryUsage() const
+{
+  SensorMemory memory = CameraSensor::MemoryUsage();
+  memory.renderTargetBytes += RenderTargetBytes(this->dataPtr->depthCamera);
+  memory.readbackBytes += this->dataPtr->image.MemorySize() +
+      this->dataPtr->depthFrames.MemoryBytes() +
+      this->dataPtr->pointCloudFrames.MemoryBytes() +
+      this->dataPtr->saveBuffer.capacity();
+  memory.messageBytes += this->dataPtr->msg.SpaceUsedLong() +
+      this->dataPtr->pointMsg.SpaceUsedLong() +
+      this->dataPtr->densePointMsg.SpaceUsedLong() +
+      this->dataPtr->filteredPointMsg.SpaceUsedLong() +
+      this->dataPtr->encodedPointMsg.SpaceUsedLong();
+  return memory;
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::SupportsCompressedOutput() const
+{
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::SupportsImageStreams() const
+{
+  return false;
+}
+
 IGN_SENSORS_REGISTER_SENSOR(DepthCameraSensor)
+
+//////////////////////////////////////////////////
+void DepthCameraSensor::SetDepthUnit(const double _unit)
+{
+  this->dataPtr->depthUnit =
+      std::isfinite(_unit) ? std::max(0.0, _unit) : 0.0;
+}
+
+//////////////////////////////////////////////////
+double DepthCameraSensor::DepthUnit() const
+{
+  return this->dataPtr->depthUnit;
+}
+
+//////////////////////////////////////////////////
+void DepthCameraSensor::SetDensePointCloud(const bool _dense)
+{
+  this->dataPtr->densePoints = _dense;
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::DensePointCloud() const
+{
+  return this->dataPtr->densePoints;
+}
+
+//////////////////////////////////////////////////
+void DepthCameraSensor::SetPointCloudStride(const unsigned int _stride)
+{
+  this->dataPtr->pointFilter.SetStride(_stride);
+}
+
+//////////////////////////////////////////////////
+unsigned int DepthCameraSensor::PointCloudStride() const
+{
+  return this->dataPtr->pointFilter.Stride();
+}
+
+//////////////////////////////////////////////////
+void DepthCameraSensor::SetVoxelLeafSize(const double _leafSize)
+{
+  this->dataPtr->pointFilter.SetLeafSize(_leafSize);
+}
+
+//////////////////////////////////////////////////
+double DepthCameraSensor::VoxelLeafSize() const
+{
+  return this->dataPtr->pointFilter.LeafSize();
+}
+
+//////////////////////////////////////////////////
+void DepthCameraSensor::SetPointCloudResolution(const double _resolution)
+{
+  this->dataPtr->pointsUtil.SetResolution(_resolution);
+}
+
+//////////////////////////////////////////////////
+double DepthCameraSensor::PointCloudResolution() const
+{
+  return this->dataPtr->pointsUtil.Resolution();
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::SetPointCloudCompression(const bool _compress)
+{
+  return this->dataPtr->pointsUtil.SetCompression(_compress);
+}
+
+//////////////////////////////////////////////////
+bool DepthCameraSensor::PointCloudCompression() const
+{
+  return this->dataPtr->pointsUtil.Compression();
+}
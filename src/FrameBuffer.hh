@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_FRAMEBUFFER_HH_
+#define IGNITION_SENSORS_FRAMEBUFFER_HH_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "ignition/sensors/config.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Frames handed over from a rendering callback to the update of
+    /// a sensor. The callback copies each frame into a back buffer that
+    /// only it can see, and swaps it with the ready buffer. The update
+    /// swaps the ready buffer with the front buffer when a new frame is
+    /// ready, and reads the front buffer without holding any lock, since
+    /// the callback never writes to it. Only the swaps take a lock.
+    ///
+    /// The buffers keep their memory between frames, so steady-state
+    /// frames don't allocate, and a change of resolution only allocates
+    /// when the frames get larger than all previous ones. One thread may
+    /// write and one thread may read at a time.
+    template<typename T>
+    class FrameBuffer
+    {
+      /// \brief Copy a new frame in the back buffer and make it ready.
+      /// \param[in] _data Frame data, _width * _height * _channels values.
+      /// \param[in] _width Width of the frame
+      /// \param[in] _height Height of the frame
+      /// \param[in] _channels Number of values per pixel
+      public: void Write(const T *_data, const unsigned int _width,
+                  const unsigned int _height,
+                  const unsigned int _channels = 1u)
+      {
+        Slot &slot = this->slots[this->back];
+        const std::size_t count =
+            static_cast<std::size_t>(_width) * _height * _channels;
+        slot.data.resize(count);
+        std::copy(_data, _data + count, slot.data.begin());
+        this->written += count * sizeof(T);
+        if (slot.data.capacity() > slot.capacity)
+        {
+          // Only this thread resizes the buffers
+          slot.capacity = slot.data.capacity();
+          std::size_t total = 0u;
+          for (const Slot &s : this->slots)
+            total += s.capacity;
+          this->bytes = total * sizeof(T);
+        }
+        slot.width = _width;
+        slot.height = _height;
+        slot.channels = _channels;
+
+        std::lock_guard<std::mutex> lock(this->swapMutex);
+        std::swap(this->back, this->ready);
+        this->fresh = true;
+      }
+
+      /// \brief Make the latest frame the front frame, if there is a new
+      /// one, and get its data. The data stays valid until the next call.
+      /// \return Data of the front frame, or nullptr if no frame was
+      /// written yet.
+      public: const T *Acquire()
+      {
+        {
+          std::lock_guard<std::mutex> lock(this->swapMutex);
+          if (this->fresh)
+          {
+            std::swap(this->front, this->ready);
+            this->fresh = false;
+          }
+        }
+
+        const Slot &slot = this->slots[this->front];
+        return slot.data.empty() ? nullptr : slot.data.data();
+      }
+
+      /// \brief Get the width of the front frame.
+      /// \return Width, 0 if no frame was acquired yet.
+      public: unsigned int Width() const
+      {
+        return this->slots[this->front].width;
+      }
+
+      /// \brief Get the height of the front frame.
+      /// \return Height, 0 if no frame was acquired yet.
+      public: unsigned int Height() const
+      {
+        return this->slots[this->front].height;
+      }
+
+      /// \brief Get the number of values per pixel of the front frame.
+      /// \return Number of channels, 0 if no frame was acquired yet.
+      public: unsigned int Channels() const
+      {
+        return this->slots[this->front].channels;
+      }
+
+      /// \brief Get the memory held by the buffers. Can be called from any
+      /// thread.
+      /// \return Number of bytes allocated for the three buffers
+      public: std::size_t MemoryBytes() const
+      {
+        return this->bytes;
+      }
+
+      /// \brief Get the number of bytes copied by Write() since the last
+      /// call, and reset it. Can be called from any thread.
+      /// \return Number of bytes written
+      public: std::size_t TakeWrittenBytes()
+      {
+        return this->written.exchange(0u);
+      }
+
+      /// \brief A frame and its size
+      private: struct Slot
+      {
+        /// \brief Frame data
+        std::vector<T> data;
+
+        /// \brief Width of the frame
+        unsigned int width = 0u;
+
+        /// \brief Height of the frame
+        unsigned int height = 0u;
+
+        /// \brief Number of values per pixel
+        unsigned int channels = 0u;
+
+        /// \brief Capacity of data, kept by the writer
+        std::size_t capacity = 0u;
+      };
+
+      /// \brief Back, ready and front buffers
+      private: std::array<Slot, 3> slots;
+
+      /// \brief Index of the buffer written by Write()
+      private: std::size_t back = 0u;
+
+      /// \brief Index of the latest written buffer
+      private: std::size_t ready = 1u;
+
+      /// \brief Index of the buffer returned by Acquire()
+      private: std::size_t front = 2u;
+
+      /// \brief True if the ready buffer holds a frame that wasn't acquired
+      private: bool fresh = false;
+
+      /// \brief Protects the buffer indices
+      private: std::mutex swapMutex;
+
+      /// \brief Bytes allocated for the buffers
+      private: std::atomic<std::size_t> bytes{0u};
+
+      /// \brief Bytes copied by Write() since the last TakeWrittenBytes()
+      private: std::atomic<std::size_t> written{0u};
+    };
+    }
+  }
+}
+
+#endif
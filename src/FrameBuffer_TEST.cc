@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "FrameBuffer.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+TEST(FrameBuffer, Empty)
+{
+  FrameBuffer<float> buffer;
+  EXPECT_EQ(nullptr, buffer.Acquire());
+  EXPECT_EQ(0u, buffer.Width());
+  EXPECT_EQ(0u, buffer.Height());
+  EXPECT_EQ(0u, buffer.Channels());
+}
+
+//////////////////////////////////////////////////
+TEST(FrameBuffer, Latest)
+{
+  FrameBuffer<float> buffer;
+  std::vector<float> first(6, 1.0f);
+  std::vector<float> second(6, 2.0f);
+
+  buffer.Write(first.data(), 3u, 2u);
+  const float *data = buffer.Acquire();
+  ASSERT_NE(nullptr, data);
+  EXPECT_FLOAT_EQ(1.0f, data[5]);
+  EXPECT_EQ(3u, buffer.Width());
+  EXPECT_EQ(2u, buffer.Height());
+  EXPECT_EQ(1u, buffer.Channels());
+
+  // Writes don't touch the front frame until it is acquired again
+  buffer.Write(second.data(), 3u, 2u);
+  buffer.Write(first.data(), 3u, 2u);
+  buffer.Write(second.data(), 3u, 2u);
+  EXPECT_FLOAT_EQ(1.0f, data[0]);
+
+  data = buffer.Acquire();
+  ASSERT_NE(nullptr, data);
+  EXPECT_FLOAT_EQ(2.0f, data[0]);
+
+  // Without a new frame the front frame is kept
+  EXPECT_EQ(data, buffer.Acquire());
+  EXPECT_FLOAT_EQ(2.0f, data[0]);
+
+  // Four frames were copied
+  EXPECT_EQ(4u * 6u * sizeof(float), buffer.TakeWrittenBytes());
+  EXPECT_EQ(0u, buffer.TakeWrittenBytes());
+}
+
+//////////////////////////////////////////////////
+TEST(FrameBuffer, Resize)
+{
+  FrameBuffer<unsigned short> buffer;
+  std::vector<unsigned short> large(4 * 4 * 2, 7u);
+  std::vector<unsigned short> small(2 * 2 * 2, 9u);
+  EXPECT_EQ(0u, buffer.MemoryBytes());
+
+  buffer.Write(large.data(), 4u, 4u, 2u);
+  EXPECT_GE(buffer.MemoryBytes(), large.size() * sizeof(unsigned short));
+  const unsigned short *data = buffer.Acquire();
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(4u, buffer.Width());
+  EXPECT_EQ(2u, buffer.Channels());
+  EXPECT_EQ(7u, data[31]);
+
+  buffer.Write(small.data(), 2u, 2u, 2u);
+  data = buffer.Acquire();
+  ASSERT_NE(nullptr, data);
+  EXPECT_EQ(2u, buffer.Width());
+  EXPECT_EQ(2u, buffer.Height());
+  EXPECT_EQ(9u, data[7]);
+
+  // Each buffer keeps its largest allocation
+  EXPECT_GE(buffer.MemoryBytes(),
+      (large.size() + small.size()) * sizeof(unsigned short));
+}
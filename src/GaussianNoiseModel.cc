@@ -21,14 +21,68 @@
 #endif
 
 #include "ignition/sensors/GaussianNoiseModel.hh"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
 #include <ignition/math/Helpers.hh>
 #include <ignition/math/Rand.hh>
 
 #include "ignition/common/Console.hh"
 
+#include "RandomStream.hh"
+
 using namespace ignition;
 using namespace sensors;
 
+/// \brief Counts noise models, so that models that are never seeded
+/// explicitly still get distinct streams.
+static std::atomic<std::uint64_t> streamCounter{0u};
+
+/// \brief Number of values processed per block by the batch noise path.
+/// The scratch buffers for one block live on the stack.
+static const std::size_t kNoiseBlockSize = 256u;
+
+/// \brief Largest supported size of a table of precomputed samples.
+static const std::size_t kMaxTableSize = 1u << 24;
+
+//////////////////////////////////////////////////
+/// \brief Fill a buffer with normally distributed samples using the
+/// Box-Muller transform. The uniform samples are drawn first, so that the
+/// transform itself runs in a loop without branches that the compiler can
+/// vectorize.
+/// \param[in,out] _rng Random stream to draw from.
+/// \param[out] _out Output buffer, at least _count (rounded up to an even
+/// number) elements long.
+/// \param[in] _count Number of samples to generate.
+/// \param[in] _mean Mean of the distribution.
+/// \param[in] _stdDev Standard deviation of the distribution.
+static void FillNormal(RandomStream &_rng, double *_out, std::size_t _count,
+    double _mean, double _stdDev)
+{
+  const std::size_t pairs = (_count + 1u) / 2u;
+  double u1[kNoiseBlockSize / 2u];
+  double u2[kNoiseBlockSize / 2u];
+  for (std::size_t i = 0; i < pairs; ++i)
+  {
+    // Keep the first sample out of zero so that the logarithm below stays
+    // finite.
+    u1[i] = _rng.UniformOpenZero();
+    u2[i] = _rng.Uniform();
+  }
+
+  const double twoPi = 2.0 * IGN_PI;
+  for (std::size_t i = 0; i < pairs; ++i)
+  {
+    const double r = _stdDev * std::sqrt(-2.0 * std::log(u1[i]));
+    const double theta = twoPi * u2[i];
+    _out[2u * i] = _mean + r * std::cos(theta);
+    _out[2u * i + 1u] = _mean + r * std::sin(theta);
+  }
+}
+
 class ignition::sensors::GaussianNoiseModelPrivate
 {
   /// \brief If type starts with GAUSSIAN, the mean of the distribution
@@ -56,12 +110,225 @@ class ignition::sensors::GaussianNoiseModelPrivate
 
   /// \brief True if the type is GAUSSIAN_QUANTIZED
   public: bool quantized = false;
+
+  /// \brief Mean of the distribution the bias is sampled from.
+  public: double biasMean = 0.0;
+
+  /// \brief Standard deviation of the distribution the bias is sampled
+  /// from.
+  public: double biasStdDev = 0.0;
+
+  /// \brief Random stream all noise of this model is drawn from. It is
+  /// owned by the model, so that models can be updated in parallel and
+  /// reproduce the same sequence regardless of scheduling.
+  public: RandomStream rng;
+
+  /// \brief Precomputed samples of the standard normal distribution, used
+  /// instead of the random stream in table mode. Null if disabled. The
+  /// table is shared with forks of this model.
+  public: std::shared_ptr<const std::vector<double>> table;
+
+  /// \brief Number of samples taken from the table since the walk through
+  /// it last changed.
+  public: std::size_t tableCount = 0u;
+
+  /// \brief Index of the first sample of the current walk through the
+  /// table.
+  public: std::size_t tableOffset = 0u;
+
+  /// \brief Distance between consecutive samples of the current walk
+  /// through the table. Always odd, so that a walk visits every sample.
+  public: std::size_t tableStep = 1u;
+
+  /// \brief Sample the constant bias from the random stream.
+  public: void SampleBias();
+
+  /// \brief Fill the table with samples from the random stream.
+  /// \param[in] _size Number of samples, a power of two.
+  public: void BuildTable(std::size_t _size);
+
+  /// \brief Start a new walk through the table at a random offset and
+  /// with a random step, so that the noise doesn't simply repeat with the
+  /// table size.
+  public: void ResetTableWalk();
+
+  /// \brief Get the next sample of the current walk through the table.
+  /// \return Sample of the standard normal distribution.
+  public: double TableSample();
+
+  /// \brief Get a normally distributed sample, from the table in table
+  /// mode and from the random stream otherwise.
+  /// \param[in] _mean Mean of the distribution.
+  /// \param[in] _stdDev Standard deviation of the distribution.
+  /// \return Random value.
+  public: double Normal(double _mean, double _stdDev);
+
+  /// \brief Fill a buffer of at most kNoiseBlockSize values with normally
+  /// distributed samples, from the table in table mode and from the random
+  /// stream otherwise.
+  /// \param[out] _out Output buffer.
+  /// \param[in] _count Number of samples.
+  /// \param[in] _mean Mean of the distribution.
+  /// \param[in] _stdDev Standard deviation of the distribution.
+  public: void Normals(double *_out, std::size_t _count, double _mean,
+              double _stdDev);
+
+  /// \brief Apply noise in place to a batch of values.
+  /// \param[in,out] _values Pointer to the first value.
+  /// \param[in] _count Number of values.
+  /// \param[in] _dt Input data time step.
+  /// \param[in] _stride Distance, in elements, between consecutive values.
+  public: template<typename T>
+          void ApplyBatch(T *_values, std::size_t _count, double _dt,
+              std::size_t _stride);
 };
 
+//////////////////////////////////////////////////
+void GaussianNoiseModelPrivate::BuildTable(std::size_t _size)
+{
+  std::shared_ptr<std::vector<double>> samples =
+      std::make_shared<std::vector<double>>(_size);
+  for (std::size_t i = 0; i < _size; i += kNoiseBlockSize)
+  {
+    FillNormal(this->rng, samples->data() + i,
+        std::min(kNoiseBlockSize, _size - i), 0.0, 1.0);
+  }
+  this->table = samples;
+  this->ResetTableWalk();
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModelPrivate::ResetTableWalk()
+{
+  const std::size_t mask = this->table->size() - 1u;
+  this->tableOffset = static_cast<std::size_t>(this->rng.Next()) & mask;
+  this->tableStep = (static_cast<std::size_t>(this->rng.Next()) & mask) | 1u;
+  this->tableCount = 0u;
+}
+
+//////////////////////////////////////////////////
+double GaussianNoiseModelPrivate::TableSample()
+{
+  const std::vector<double> &samples = *this->table;
+  if (this->tableCount == samples.size())
+    this->ResetTableWalk();
+
+  const std::size_t mask = samples.size() - 1u;
+  const std::size_t index =
+      (this->tableOffset + this->tableCount * this->tableStep) & mask;
+  ++this->tableCount;
+  return samples[index];
+}
+
+//////////////////////////////////////////////////
+double GaussianNoiseModelPrivate::Normal(double _mean, double _stdDev)
+{
+  if (this->table)
+    return _mean + _stdDev * this->TableSample();
+  return this->rng.Normal(_mean, _stdDev);
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModelPrivate::Normals(double *_out, std::size_t _count,
+    double _mean, double _stdDev)
+{
+  if (!this->table)
+  {
+    FillNormal(this->rng, _out, _count, _mean, _stdDev);
+    return;
+  }
+
+  for (std::size_t i = 0; i < _count; ++i)
+    _out[i] = _mean + _stdDev * this->TableSample();
+}
+
+//////////////////////////////////////////////////
+template<typename T>
+void GaussianNoiseModelPrivate::ApplyBatch(T *_values, std::size_t _count,
+    double _dt, std::size_t _stride)
+{
+  // See ApplyImpl for the derivation of the dynamic bias parameters.
+  const bool dynamicBias = this->dynamicBiasStdDev > 0 &&
+      this->dynamicBiasCorrTime > 0 && _dt > 0;
+  double sigma_b_d = 0.0;
+  double phi_d = 1.0;
+  if (dynamicBias)
+  {
+    double sigma_b = this->dynamicBiasStdDev;
+    double tau = this->dynamicBiasCorrTime;
+    sigma_b_d = sqrt(-sigma_b * sigma_b * tau / 2 * expm1(-2 * _dt / tau));
+    phi_d = exp(-_dt / tau);
+  }
+
+  const bool quantize = this->quantized &&
+      !ignition::math::equal(this->precision, 0.0, 1e-6);
+
+  double whiteNoise[kNoiseBlockSize];
+  double biasNoise[kNoiseBlockSize];
+  for (std::size_t start = 0; start < _count; start += kNoiseBlockSize)
+  {
+    const std::size_t n = std::min(kNoiseBlockSize, _count - start);
+    this->Normals(whiteNoise, n, this->mean, this->stdDev);
+
+    T *values = _values + start * _stride;
+    if (dynamicBias)
+    {
+      // The bias is a random walk, so it has to be advanced sample by
+      // sample.
+      this->Normals(biasNoise, n, 0.0, sigma_b_d);
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        this->bias = phi_d * this->bias + biasNoise[i];
+        whiteNoise[i] += this->bias;
+      }
+    }
+    else
+    {
+      for (std::size_t i = 0; i < n; ++i)
+        whiteNoise[i] += this->bias;
+    }
+
+    if (quantize)
+    {
+      const double precision = this->precision;
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        T &value = values[i * _stride];
+        value = static_cast<T>(std::round((value + whiteNoise[i]) /
+            precision) * precision);
+      }
+    }
+    else
+    {
+      for (std::size_t i = 0; i < n; ++i)
+      {
+        T &value = values[i * _stride];
+        value = static_cast<T>(value + whiteNoise[i]);
+      }
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModelPrivate::SampleBias()
+{
+  this->bias = this->rng.Normal(this->biasMean, this->biasStdDev);
+
+  // With equal probability, we pick a negative bias (by convention,
+  // rateBiasMean should be positive, though it would work fine if
+  // negative).
+  if (this->rng.Uniform() < 0.5)
+    this->bias = -this->bias;
+}
+
 //////////////////////////////////////////////////
 GaussianNoiseModel::GaussianNoiseModel()
   : Noise(NoiseType::GAUSSIAN), dataPtr(new GaussianNoiseModelPrivate())
 {
+  // Until SetSeed is called, derive the stream from the global math::Rand
+  // seed, so that seeding math::Rand keeps making runs repeatable.
+  this->dataPtr->rng.Seed(RandomStream::Combine(
+      ignition::math::Rand::Seed(), streamCounter++));
 }
 
 //////////////////////////////////////////////////
@@ -83,17 +350,9 @@ void GaussianNoiseModel::Load(const sdf::Noise &_sdf)
   this->dataPtr->dynamicBiasCorrTime = _sdf.DynamicBiasCorrelationTime();
 
   // Sample the bias
-  double biasMean = 0;
-  double biasStdDev = 0;
-  biasMean = _sdf.BiasMean();
-  biasStdDev = _sdf.BiasStdDev();
-  this->dataPtr->bias = ignition::math::Rand::DblNormal(biasMean, biasStdDev);
-
-  // With equal probability, we pick a negative bias (by convention,
-  // rateBiasMean should be positive, though it would work fine if
-  // negative).
-  if (ignition::math::Rand::DblUniform() < 0.5)
-    this->dataPtr->bias = -this->dataPtr->bias;
+  this->dataPtr->biasMean = _sdf.BiasMean();
+  this->dataPtr->biasStdDev = _sdf.BiasStdDev();
+  this->dataPtr->SampleBias();
 
   this->Print(out);
 
@@ -102,13 +361,30 @@ void GaussianNoiseModel::Load(const sdf::Noise &_sdf)
     ignerr << "Noise precision cannot be less than 0" << std::endl;
   else if (!ignition::math::equal(this->dataPtr->precision, 0.0, 1e-6))
     this->dataPtr->quantized = true;
+
+  // Optional table mode, enabled with a custom element such as
+  // <ignition:noise_table_size>65536</ignition:noise_table_size>
+  const std::string tableKey = "ignition:noise_table_size";
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement(tableKey))
+  {
+    const std::string value = elem->GetElement(tableKey)->Get<std::string>();
+    try
+    {
+      this->SetTableSize(static_cast<std::size_t>(std::stoul(value)));
+    }
+    catch(...)
+    {
+      ignerr << "Invalid noise table size [" << value << "]" << std::endl;
+    }
+  }
 }
 
 //////////////////////////////////////////////////
 double GaussianNoiseModel::ApplyImpl(double _in, double _dt)
 {
   // Generate independent (uncorrelated) Gaussian noise to each input value.
-  double whiteNoise = ignition::math::Rand::DblNormal(
+  double whiteNoise = this->dataPtr->Normal(
       this->dataPtr->mean, this->dataPtr->stdDev);
 
   // Generate varying (correlated) bias to each input value.
@@ -132,7 +408,7 @@ double GaussianNoiseModel::ApplyImpl(double _in, double _dt)
         tau / 2 * expm1(-2 * _dt / tau));
     double phi_d = exp(-_dt / tau);
     this->dataPtr->bias = phi_d * this->dataPtr->bias +
-      ignition::math::Rand::DblNormal(0, sigma_b_d);
+      this->dataPtr->Normal(0, sigma_b_d);
   }
 
   double output = _in + this->dataPtr->bias + whiteNoise;
@@ -149,6 +425,76 @@ double GaussianNoiseModel::ApplyImpl(double _in, double _dt)
   return output;
 }
 
+//////////////////////////////////////////////////
+void GaussianNoiseModel::ApplyBatchImpl(double *_values, std::size_t _count,
+    double _dt, std::size_t _stride)
+{
+  this->dataPtr->ApplyBatch(_values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModel::ApplyBatchImpl(float *_values, std::size_t _count,
+    double _dt, std::size_t _stride)
+{
+  this->dataPtr->ApplyBatch(_values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModel::SetSeed(std::uint64_t _seed)
+{
+  this->dataPtr->rng.Seed(_seed);
+  this->dataPtr->SampleBias();
+  if (this->dataPtr->table)
+    this->dataPtr->BuildTable(this->dataPtr->table->size());
+}
+
+//////////////////////////////////////////////////
+void GaussianNoiseModel::SetTableSize(std::size_t _size)
+{
+  if (_size == 0u)
+  {
+    this->dataPtr->table.reset();
+    return;
+  }
+
+  if (_size > kMaxTableSize)
+  {
+    ignwarn << "Noise table size [" << _size << "] is too large, using ["
+            << kMaxTableSize << "] instead." << std::endl;
+    _size = kMaxTableSize;
+  }
+
+  // Round up to a power of two, so that the table can be indexed with a
+  // mask.
+  std::size_t size = 1u;
+  while (size < _size)
+    size <<= 1u;
+
+  if (!this->dataPtr->table || this->dataPtr->table->size() != size)
+    this->dataPtr->BuildTable(size);
+}
+
+//////////////////////////////////////////////////
+std::size_t GaussianNoiseModel::TableSize() const
+{
+  return this->dataPtr->table ? this->dataPtr->table->size() : 0u;
+}
+
+//////////////////////////////////////////////////
+NoisePtr GaussianNoiseModel::Fork(std::uint64_t _seed) const
+{
+  std::shared_ptr<GaussianNoiseModel> noise =
+      std::make_shared<GaussianNoiseModel>();
+  *noise->dataPtr = *this->dataPtr;
+
+  // Keep the bias of this model, only the stream differs. A table is
+  // shared, but walked through differently.
+  noise->dataPtr->rng.Seed(_seed);
+  if (noise->dataPtr->table)
+    noise->dataPtr->ResetTableWalk();
+  return noise;
+}
+
 //////////////////////////////////////////////////
 double GaussianNoiseModel::Mean() const
 {
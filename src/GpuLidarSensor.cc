@@ -25,6 +25,16 @@
 #pragma warning(pop)
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <ignition/common/Console.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/msgs/Utility.hh>
@@ -33,29 +43,176 @@
 #include "ignition/sensors/GpuLidarSensor.hh"
 #include "ignition/sensors/SensorFactory.hh"
 
+#include "HeaderUtil.hh"
+#include "LidarResample.hh"
+#include "PointCloudFilter.hh"
+#include "PointCloudUtil.hh"
+
 using namespace ignition::sensors;
 
+/// \brief Render of a GpuRays shared by a group of lidars. The lidar that
+/// created it renders with its own rays, the others sample their rays from
+/// its scan.
+struct SharedGpuRays
+{
+  /// \brief Rendering sensor of the group
+  ignition::rendering::GpuRaysPtr rays;
+
+  /// \brief Parent of the lidars of the group
+  std::string parent;
+
+  /// \brief Rays of the render
+  LidarRayPattern pattern;
+
+  /// \brief Minimum range of the render
+  double rangeMin = 0.0;
+
+  /// \brief Maximum range of the render
+  double rangeMax = 0.0;
+
+  /// \brief Latest pose of the lidar that created the render
+  ignition::math::Pose3d pose;
+
+  /// \brief Latest scan of the render
+  std::vector<float> buffer;
+
+  /// \brief Time of the latest scan
+  std::chrono::steady_clock::duration stamp{0};
+
+  /// \brief True once the render produced a scan
+  bool rendered = false;
+
+  /// \brief Protects the scan and pose
+  std::mutex mutex;
+};
+
+/// \brief Shared renders, keyed by scene and group name
+static std::map<std::pair<ignition::rendering::Scene *, std::string>,
+    std::weak_ptr<SharedGpuRays>> sharedGpuRays;
+
+/// \brief Protects sharedGpuRays
+static std::mutex sharedGpuRaysMutex;
+
+/// \brief Largest distance between the lidars of a group, in meters
+static const double kMaxSharedRaysOffset = 0.1;
+
+/// \brief Get a pose in the frame of another pose.
+/// \param[in] _base Pose of the frame
+/// \param[in] _pose Pose to express in the frame
+/// \return _pose relative to _base
+static ignition::math::Pose3d RelativePose(
+    const ignition::math::Pose3d &_base, const ignition::math::Pose3d &_pose)
+{
+  return ignition::math::Pose3d(
+      _base.Rot().RotateVectorReverse(_pose.Pos() - _base.Pos()),
+      _base.Rot().Inverse() * _pose.Rot());
+}
+
 /// \brief Private data for the GpuLidar class
 class ignition::sensors::GpuLidarSensorPrivate
 {
-  /// \brief Fill the point cloud packed message
+  /// \brief Fill rows of a point cloud packed message
   /// \param[in] _laserBuffer Lidar data buffer.
-  public: void FillPointCloudMsg(const float *_laserBuffer);
+  /// \param[in] _firstRow First row of the scan to fill the message with
+  /// \param[in,out] _msg Message, filled with as many rows as its height
+  public: void FillPointCloudMsg(const float *_laserBuffer,
+              const uint32_t _firstRow, msgs::PointCloudPacked &_msg);
+
+  /// \brief Rebuild the ray directions if the angle limits or the ray
+  /// counts changed since they were last computed.
+  /// \param[in] _width Number of horizontal rays
+  /// \param[in] _height Number of vertical rays
+  public: void UpdateRayDirections(const uint32_t _width,
+              const uint32_t _height);
+
+  /// \brief Unit direction of each ray, 3 values per ray in the order of
+  /// the laser buffer.
+  public: std::vector<float> rayDirections;
+
+  /// \brief Rays of this lidar
+  public: LidarRayPattern rayPattern;
+
+  /// \brief Horizontal and vertical angle limits the ray directions were
+  /// computed for: minimum and maximum azimuth, then inclination.
+  public: std::array<double, 4> rayAngles{{0.0, 0.0, 0.0, 0.0}};
+
+  /// \brief Number of horizontal rays of the ray directions
+  public: uint32_t rayWidth = 0u;
+
+  /// \brief Number of vertical rays of the ray directions
+  public: uint32_t rayHeight = 0u;
 
   /// \brief Rendering camera
   public: ignition::rendering::GpuRaysPtr gpuRays;
 
+  /// \brief Name of the group of lidars sharing a render
+  public: std::string sharedRaysGroup;
+
+  /// \brief Render shared with the other lidars of the group, null when
+  /// rendering alone
+  public: std::shared_ptr<SharedGpuRays> sharedRays;
+
+  /// \brief Samples the rays of this lidar from the shared render. Only
+  /// configured when another lidar created the render.
+  public: LidarResampler resampler;
+
+  /// \brief True once a failure to sample the shared render was reported
+  public: bool resampleWarned = false;
+
+  /// \brief Number of floats allocated for the laser buffer
+  public: std::size_t laserBufferSize = 0u;
+
+  /// \brief Rendering sensors of the sectors of the sweep, children of
+  /// gpuRays. Empty when whole sweeps are rendered at once.
+  public: std::vector<ignition::rendering::GpuRaysPtr> sectorRays;
+
+  /// \brief Index of the sector rendered by the next update
+  public: unsigned int sweepSector = 0u;
+
+  /// \brief Scan of the latest rendered sector
+  public: std::vector<float> sectorBuffer;
+
   /// \brief Connection to the Manager's scene change event.
   public: ignition::common::ConnectionPtr sceneChangeConnection;
 
   /// \brief The point cloud message.
   public: msgs::PointCloudPacked pointMsg;
 
-  /// \brief Transport node.
-  public: transport::Node node;
+  /// \brief Number of rows of the point cloud chunks, 0 to publish whole
+  /// point clouds
+  public: uint32_t pointChunkRows = 0u;
+
+  /// \brief Point cloud chunk message, reused across chunks
+  public: msgs::PointCloudPacked chunkMsg;
+
+  /// \brief Id of the next point cloud published in chunks
+  public: uint64_t pointScanId = 0u;
+
+  /// \brief Encodes the point clouds before they are published
+  public: PointCloudUtil pointsUtil;
+
+  /// \brief Downsamples the point clouds before they are published
+  public: PointCloudFilter pointFilter;
+
+  /// \brief Downsampled point cloud message, reused across frames
+  public: msgs::PointCloudPacked filteredPointMsg;
+
+  /// \brief Encoded point cloud message, reused across frames
+  public: msgs::PointCloudPacked encodedPointMsg;
 
   /// \brief Publisher for the publish point cloud message.
   public: transport::Node::Publisher pointPub;
+
+  /// \brief When the point clouds are produced
+  public: LidarOutputMode pointCloudOutput = LidarOutputMode::AUTO;
+
+  /// \brief Connections handed out by ConnectNewLidarFrame. Expired
+  /// connections no longer have a subscriber.
+  public: std::vector<std::weak_ptr<ignition::common::Connection>>
+      frameConnections;
+
+  /// \brief Protects frameConnections
+  public: mutable std::mutex frameConnectionsMutex;
 };
 
 //////////////////////////////////////////////////
@@ -97,10 +254,34 @@ void GpuLidarSensor::SetScene(ignition::rendering::ScenePtr _scene)
 void GpuLidarSensor::RemoveGpuRays(
     ignition::rendering::ScenePtr _scene)
 {
+  if (this->dataPtr->sharedRays)
+  {
+    // Only the last lidar of a group destroys the shared render
+    std::lock_guard<std::mutex> lock(sharedGpuRaysMutex);
+    const bool last = this->dataPtr->sharedRays.use_count() == 1;
+    this->dataPtr->sharedRays.reset();
+    this->dataPtr->resampler.Clear();
+    if (!last)
+    {
+      this->dataPtr->gpuRays.reset();
+      return;
+    }
+    for (auto it = sharedGpuRays.begin(); it != sharedGpuRays.end();)
+    {
+      if (it->second.expired())
+        it = sharedGpuRays.erase(it);
+      else
+        ++it;
+    }
+  }
+
   if (_scene)
   {
+    for (auto &rays : this->dataPtr->sectorRays)
+      _scene->DestroySensor(rays);
     _scene->DestroySensor(this->dataPtr->gpuRays);
   }
+  this->dataPtr->sectorRays.clear();
   this->dataPtr->gpuRays.reset();
   this->dataPtr->gpuRays = nullptr;
 }
@@ -125,18 +306,36 @@ bool GpuLidarSensor::Load(const sdf::Sensor &_sdf)
       {"intensity", msgs::PointCloudPacked::Field::FLOAT32},
       {"ring", msgs::PointCloudPacked::Field::UINT16}});
 
+  this->dataPtr->pointFilter.Load(_sdf.Element());
+  this->dataPtr->pointsUtil.Load(_sdf.Element());
+
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:shared_rays"))
+  {
+    this->dataPtr->sharedRaysGroup =
+        elem->Get<std::string>("ignition:shared_rays");
+  }
+  if (elem && elem->HasElement("ignition:point_cloud_chunk_rows"))
+  {
+    this->dataPtr->pointChunkRows =
+        elem->Get<unsigned int>("ignition:point_cloud_chunk_rows");
+  }
+  this->LoadOutputMode(elem, "ignition:point_cloud_output",
+      this->dataPtr->pointCloudOutput);
+
   if (this->Scene())
     this->CreateLidar();
 
   this->dataPtr->sceneChangeConnection =
     RenderingEvents::ConnectSceneChangeCallback(
-        std::bind(&GpuLidarSensor::SetScene, this, std::placeholders::_1));
+        std::bind(&GpuLidarSensor::OnSceneChange, this,
+        std::placeholders::_1));
 
   // Create the point cloud publisher
   this->SetTopic(this->Topic() + "/points");
 
   this->dataPtr->pointPub =
-      this->dataPtr->node.Advertise<ignition::msgs::PointCloudPacked>(
+      this->TransportNode().Advertise<ignition::msgs::PointCloudPacked>(
           this->Topic());
 
   if (!this->dataPtr->pointPub)
@@ -145,6 +344,7 @@ bool GpuLidarSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pointPub);
 
   this->initialized = true;
 
@@ -168,6 +368,19 @@ bool GpuLidarSensor::Init()
 //////////////////////////////////////////////////
 bool GpuLidarSensor::CreateLidar()
 {
+  this->dataPtr->rayPattern.angleMin = this->AngleMin().Radian();
+  this->dataPtr->rayPattern.angleMax = this->AngleMax().Radian();
+  this->dataPtr->rayPattern.verticalAngleMin =
+      this->VerticalAngleMin().Radian();
+  this->dataPtr->rayPattern.verticalAngleMax =
+      this->VerticalAngleMax().Radian();
+
+  if (!this->dataPtr->sharedRaysGroup.empty() && this->JoinSharedRays())
+  {
+    this->ResetSweepSectors();
+    return true;
+  }
+
   this->dataPtr->gpuRays = this->Scene()->CreateGpuRays(
       this->Name());
 
@@ -208,12 +421,170 @@ bool GpuLidarSensor::CreateLidar()
   this->dataPtr->pointMsg.set_row_step(
       this->dataPtr->pointMsg.point_step() *
       this->dataPtr->pointMsg.width());
+  this->dataPtr->rayPattern.width = this->dataPtr->pointMsg.width();
+  this->dataPtr->rayPattern.height = this->dataPtr->pointMsg.height();
 
   this->AddSensor(this->dataPtr->gpuRays);
+  this->ResetSweepSectors();
+
+  // Start a group that other lidars can join, unless this lidar couldn't
+  // join an existing one
+  if (!this->dataPtr->sharedRaysGroup.empty())
+  {
+    std::lock_guard<std::mutex> lock(sharedGpuRaysMutex);
+    auto &group =
+        sharedGpuRays[{this->Scene().get(), this->dataPtr->sharedRaysGroup}];
+    if (group.expired())
+    {
+      auto shared = std::make_shared<SharedGpuRays>();
+      shared->rays = this->dataPtr->gpuRays;
+      shared->parent = this->Parent();
+      shared->pattern = this->dataPtr->rayPattern;
+      shared->rangeMin = this->RangeMin();
+      shared->rangeMax = this->RangeMax();
+      shared->pose = this->Pose();
+      group = shared;
+      this->dataPtr->sharedRays = shared;
+    }
+  }
 
   return true;
 }
 
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetSweepSectors(const unsigned int _sectors)
+{
+  const unsigned int previous = this->SweepSectors();
+  Lidar::SetSweepSectors(_sectors);
+
+  // Without rays yet, CreateLidar() creates the sectors
+  if (this->dataPtr->gpuRays && this->SweepSectors() != previous)
+    this->ResetSweepSectors();
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::ResetSweepSectors()
+{
+  for (auto &rays : this->dataPtr->sectorRays)
+    this->Scene()->DestroySensor(rays);
+  this->dataPtr->sectorRays.clear();
+  this->dataPtr->sweepSector = 0u;
+
+  const unsigned int sectors = this->SweepSectors();
+  if (sectors <= 1u)
+    return;
+
+  if (!this->dataPtr->sharedRaysGroup.empty())
+  {
+    ignwarn << "Lidar [" << this->Name() << "] shares its rays, so it "
+      << "renders whole sweeps instead of sectors.\n";
+    Lidar::SetSweepSectors(1u);
+    return;
+  }
+  this->CreateSweepSectors(sectors);
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::CreateSweepSectors(const unsigned int _sectors)
+{
+  const double step = this->AngleResolution();
+  const double angleMin = this->AngleMin().Radian();
+  for (unsigned int k = 0; k < _sectors; ++k)
+  {
+    unsigned int first = 0u;
+    unsigned int columns = 0u;
+    this->SweepSectorColumns(k, first, columns);
+
+    ignition::rendering::GpuRaysPtr rays = this->Scene()->CreateGpuRays(
+        this->Name() + "_sector_" + std::to_string(k));
+    if (!rays)
+    {
+      ignerr << "Unable to create gpu laser sensor for sector [" << k
+        << "] of lidar [" << this->Name() << "], rendering whole sweeps.\n";
+      for (auto &created : this->dataPtr->sectorRays)
+        this->Scene()->DestroySensor(created);
+      this->dataPtr->sectorRays.clear();
+
+      // Back to the rate of whole sweeps
+      Lidar::SetSweepSectors(1u);
+      return;
+    }
+
+    rays->SetNearClipPlane(this->RangeMin());
+    rays->SetFarClipPlane(this->RangeMax());
+    rays->SetClamp(false);
+    rays->SetAngleMin(angleMin + first * step);
+    rays->SetAngleMax(angleMin + (first + columns - 1u) * step);
+    rays->SetVerticalAngleMin(this->VerticalAngleMin().Radian());
+    rays->SetVerticalAngleMax(this->VerticalAngleMax().Radian());
+    rays->SetRayCount(columns);
+    rays->SetVerticalRayCount(this->VerticalRayCount());
+
+    // The sectors follow the pose of the lidar
+    this->dataPtr->gpuRays->AddChild(rays);
+    this->dataPtr->sectorRays.push_back(rays);
+  }
+}
+
+//////////////////////////////////////////////////
+bool GpuLidarSensor::JoinSharedRays()
+{
+  std::lock_guard<std::mutex> lock(sharedGpuRaysMutex);
+  auto it = sharedGpuRays.find(
+      {this->Scene().get(), this->dataPtr->sharedRaysGroup});
+  if (it == sharedGpuRays.end())
+    return false;
+  std::shared_ptr<SharedGpuRays> shared = it->second.lock();
+  if (!shared || !shared->rays)
+    return false;
+
+  LidarRayPattern pattern = this->dataPtr->rayPattern;
+  pattern.width = this->RangeCount();
+  pattern.height = this->VerticalRangeCount();
+
+  ignition::math::Pose3d offset;
+  {
+    std::lock_guard<std::mutex> sharedLock(shared->mutex);
+    offset = RelativePose(shared->pose, this->Pose());
+  }
+
+  std::string reason;
+  if (shared->parent != this->Parent())
+    reason = "it has another parent";
+  else if (offset.Pos().Length() > kMaxSharedRaysOffset)
+    reason = "it is too far";
+  else if (this->RangeMin() < shared->rangeMin ||
+      this->RangeMax() > shared->rangeMax)
+    reason = "its range limits exceed those of the render";
+  else if (!this->dataPtr->resampler.Configure(shared->pattern, pattern,
+      offset))
+    reason = "some of its rays are outside of the render";
+
+  if (!reason.empty())
+  {
+    ignwarn << "Lidar [" << this->Name() << "] can't share the rays of group ["
+      << this->dataPtr->sharedRaysGroup << "] because " << reason
+      << ". It will render alone.\n";
+    this->dataPtr->resampler.Clear();
+    return false;
+  }
+
+  this->dataPtr->sharedRays = shared;
+  this->dataPtr->gpuRays = shared->rays;
+  this->dataPtr->resampleWarned = false;
+
+  this->dataPtr->rayPattern = pattern;
+  this->dataPtr->pointMsg.set_width(pattern.width);
+  this->dataPtr->pointMsg.set_height(pattern.height);
+  this->dataPtr->pointMsg.set_row_step(
+      this->dataPtr->pointMsg.point_step() *
+      this->dataPtr->pointMsg.width());
+
+  // Render() then renders the shared rays
+  this->AddSensor(this->dataPtr->gpuRays);
+  return true;
+}
+
 //////////////////////////////////////////////////
 bool GpuLidarSensor::Update(const ignition::common::Time &_now)
 {
@@ -236,40 +607,258 @@ bool GpuLidarSensor::Update(const std::chrono::steady_clock::duration &_now)
     return false;
   }
 
-  int len = this->dataPtr->gpuRays->RayCount() *
-    this->dataPtr->gpuRays->VerticalRayCount() * 3;
+  const std::size_t renderSize = this->dataPtr->gpuRays->RayCount() *
+    this->dataPtr->gpuRays->VerticalRayCount() * 3u;
+  // Noise is applied to the ray counts of this lidar, which only match the
+  // sampled range counts with a resolution of 1
+  std::size_t len = !this->dataPtr->resampler.Configured() ?
+    renderSize : std::max(this->dataPtr->resampler.OutputSize(),
+        static_cast<std::size_t>(this->RayCount()) *
+        this->VerticalRayCount() * 3u);
+
+  // Sectors are copied in the range columns of the sweep
+  if (!this->dataPtr->sectorRays.empty())
+  {
+    len = std::max(len, static_cast<std::size_t>(this->RangeCount()) *
+        this->VerticalRangeCount() * 3u);
+  }
 
-  if (this->laserBuffer == nullptr)
+  if (this->laserBuffer == nullptr || this->dataPtr->laserBufferSize != len)
   {
+    delete [] this->laserBuffer;
     this->laserBuffer = new float[len];
+    this->dataPtr->laserBufferSize = len;
   }
 
-  this->Render();
+  // Index of the sector of the sweep rendered by this update
+  const unsigned int sector = this->dataPtr->sweepSector;
+  unsigned int firstColumn = 0u;
+  unsigned int columns = this->RangeCount();
+  if (this->dataPtr->sharedRays)
+  {
+    this->UpdateSharedRays(_now, renderSize);
+  }
+  else if (!this->dataPtr->sectorRays.empty())
+  {
+    this->SweepSectorColumns(sector, firstColumn, columns);
+    this->UpdateSweepSector(sector, firstColumn, columns);
+    this->dataPtr->sweepSector = (sector + 1u) %
+        static_cast<unsigned int>(this->dataPtr->sectorRays.size());
+  }
+  else
+  {
+    this->Render();
 
-  /// \todo(anyone) It would be nice to remove this copy.
-  this->dataPtr->gpuRays->Copy(this->laserBuffer);
+    /// \todo(anyone) It would be nice to remove this copy.
+    auto copyStart = std::chrono::steady_clock::now();
+    this->dataPtr->gpuRays->Copy(this->laserBuffer);
+    this->RecordPhase(UpdatePhase::COPY, copyStart);
+    this->RecordReadbackBytes(renderSize * sizeof(float));
+  }
 
   // Apply noise before publishing the data.
-  this->ApplyNoise();
+  // GPU rays don't run render passes, so unlike camera noise this can't be
+  // done with a rendering::GaussianNoisePass before the readback.
+  auto noiseStart = std::chrono::steady_clock::now();
+  if (this->dataPtr->sectorRays.empty())
+    this->ApplyNoise();
+  else
+    this->ApplyNoise(firstColumn, columns);
+  this->RecordPhase(UpdatePhase::NOISE, noiseStart);
+
+  if (this->dataPtr->sectorRays.empty())
+  {
+    this->PublishLidarScan(_now);
+  }
+  else
+  {
+    this->PublishLidarSector(_now, sector);
 
-  this->PublishLidarScan(_now);
+    // Point clouds are only published for complete sweeps
+    if (sector + 1u < this->dataPtr->sectorRays.size())
+      return true;
+  }
 
-  if (this->dataPtr->pointPub.HasConnections())
+  if (this->OutputActive(this->dataPtr->pointCloudOutput,
+      this->dataPtr->pointPub))
   {
-    // Set the time stamp
-    *this->dataPtr->pointMsg.mutable_header()->mutable_stamp() =
-      msgs::Convert(_now);
-    this->dataPtr->pointMsg.set_is_dense(true);
+    const uint32_t height = this->dataPtr->pointMsg.height();
+    const uint32_t chunkRows = this->dataPtr->pointChunkRows;
+    if (chunkRows > 0u && chunkRows < height)
+    {
+      this->PublishPointCloudChunks(_now);
+    }
+    else
+    {
+      // Set the time stamp
+      this->StampHeader(this->dataPtr->pointMsg.mutable_header(), _now);
+      this->dataPtr->pointMsg.set_is_dense(true);
+
+      auto messageStart = std::chrono::steady_clock::now();
+      this->dataPtr->FillPointCloudMsg(this->laserBuffer, 0u,
+          this->dataPtr->pointMsg);
+      this->PublishPointCloud(this->dataPtr->pointMsg, messageStart);
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::PublishPointCloudChunks(
+    const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("GpuLidarSensor::PublishPointCloudChunks");
+  const msgs::PointCloudPacked &cloud = this->dataPtr->pointMsg;
+  msgs::PointCloudPacked &chunk = this->dataPtr->chunkMsg;
+  if (chunk.field_size() != cloud.field_size())
+    *chunk.mutable_field() = cloud.field();
+  chunk.set_is_bigendian(cloud.is_bigendian());
+  chunk.set_point_step(cloud.point_step());
+  chunk.set_row_step(cloud.row_step());
+  chunk.set_width(cloud.width());
+  chunk.set_is_dense(true);
+
+  // The chunks of a point cloud share its stamp and sequence number
+  this->StampHeader(chunk.mutable_header(), _now);
+
+  const uint32_t height = cloud.height();
+  const uint32_t chunkRows = this->dataPtr->pointChunkRows;
+  const uint32_t chunkCount = (height + chunkRows - 1u) / chunkRows;
+  ignition::msgs::Header &header = *chunk.mutable_header();
+  SetHeaderValue(header, "scan_id", this->dataPtr->pointScanId++);
+  SetHeaderValue(header, "chunk_count", static_cast<uint64_t>(chunkCount));
+
+  for (uint32_t c = 0u; c < chunkCount; ++c)
+  {
+    auto messageStart = std::chrono::steady_clock::now();
+    const uint32_t firstRow = c * chunkRows;
+    chunk.set_height(std::min(chunkRows, height - firstRow));
+    SetHeaderValue(header, "chunk", static_cast<uint64_t>(c));
+    SetHeaderValue(header, "first_row", static_cast<uint64_t>(firstRow));
+    this->dataPtr->FillPointCloudMsg(this->laserBuffer, firstRow, chunk);
+    this->PublishPointCloud(chunk, messageStart);
+  }
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::PublishPointCloud(msgs::PointCloudPacked &_cloud,
+    const std::chrono::steady_clock::time_point &_messageStart)
+{
+  // downsample into a separate message before serializing
+  msgs::PointCloudPacked *cloud = &_cloud;
+  if (this->dataPtr->pointFilter.Enabled())
+  {
+    this->dataPtr->pointFilter.Apply(*cloud,
+        this->dataPtr->filteredPointMsg);
+    cloud = &this->dataPtr->filteredPointMsg;
+  }
+
+  // encode with a reduced precision or compression, if requested
+  if (this->dataPtr->pointsUtil.Encoded() &&
+      this->dataPtr->pointsUtil.EncodeMsg(*cloud,
+      this->dataPtr->encodedPointMsg))
+  {
+    cloud = &this->dataPtr->encodedPointMsg;
+  }
+  this->RecordPhase(UpdatePhase::MESSAGE, _messageStart);
 
-    this->dataPtr->FillPointCloudMsg(this->laserBuffer);
+  {
+    IGN_PROFILE("GpuLidarSensor::Update Publish point cloud");
+    auto publishStart = std::chrono::steady_clock::now();
+    this->PublishShared(this->dataPtr->pointPub, *cloud,
+        cloud->mutable_data(), cloud->mutable_header(), "pointMsg");
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(cloud->ByteSizeLong());
+  }
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::UpdateSweepSector(const unsigned int _sector,
+    const unsigned int _firstColumn, const unsigned int _columns)
+{
+  const ignition::rendering::GpuRaysPtr &rays =
+      this->dataPtr->sectorRays[_sector];
+  this->RenderCamera(rays);
+
+  auto copyStart = std::chrono::steady_clock::now();
+  const std::size_t sectorStride = rays->RangeCount();
+  std::vector<float> &buffer = this->dataPtr->sectorBuffer;
+  buffer.resize(sectorStride * rays->VerticalRangeCount() * 3u);
+  rays->Copy(buffer.data());
+  this->RecordReadbackBytes(buffer.size() * sizeof(float));
+
+  // Copy the sector in its columns of the sweep, which keeps the other
+  // sectors of the previous updates. Rows are as wide as the range count,
+  // as in PublishLidarSector().
+  const std::size_t width = this->RangeCount();
+  const unsigned int rows = std::min(rays->VerticalRangeCount(),
+      this->VerticalRangeCount());
+  const std::size_t sectorWidth = std::min<std::size_t>(sectorStride,
+      std::min<std::size_t>(_columns, width - _firstColumn));
+  for (unsigned int j = 0; j < rows; ++j)
+  {
+    const float *src = buffer.data() + j * sectorStride * 3u;
+    std::copy(src, src + sectorWidth * 3u,
+        this->laserBuffer + (j * width + _firstColumn) * 3u);
+  }
+  this->RecordPhase(UpdatePhase::COPY, copyStart);
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::UpdateSharedRays(
+    const std::chrono::steady_clock::duration &_now,
+    const std::size_t _renderSize)
+{
+  SharedGpuRays &shared = *this->dataPtr->sharedRays;
+  std::lock_guard<std::mutex> lock(shared.mutex);
 
+  // The first lidar of the group updated at a time renders for all of them
+  std::chrono::steady_clock::time_point copyStart;
+  if (!shared.rendered || shared.stamp != _now)
+  {
+    this->Render();
+
+    copyStart = std::chrono::steady_clock::now();
+    shared.buffer.resize(_renderSize);
+    shared.rays->Copy(shared.buffer.data());
+    this->RecordReadbackBytes(shared.buffer.size() * sizeof(float));
+    shared.stamp = _now;
+    shared.rendered = true;
+  }
+  else
+  {
+    copyStart = std::chrono::steady_clock::now();
+  }
+
+  if (!this->dataPtr->resampler.Configured())
+  {
+    // This lidar created the render
+    shared.pose = this->Pose();
+    std::copy(shared.buffer.begin(), shared.buffer.end(), this->laserBuffer);
+  }
+  else
+  {
+    // Map the rays again if the lidars moved relative to each other
+    const ignition::math::Pose3d offset =
+        RelativePose(shared.pose, this->Pose());
+    const ignition::math::Pose3d &mapped = this->dataPtr->resampler.Offset();
+    if ((!offset.Pos().Equal(mapped.Pos(), 1e-6) ||
+         !offset.Rot().Equal(mapped.Rot(), 1e-6)) &&
+        !this->dataPtr->resampler.Configure(shared.pattern,
+            this->dataPtr->rayPattern, offset))
     {
-      this->AddSequence(this->dataPtr->pointMsg.mutable_header());
-      IGN_PROFILE("GpuLidarSensor::Update Publish point cloud");
-      this->dataPtr->pointPub.Publish(this->dataPtr->pointMsg);
+      if (!this->dataPtr->resampleWarned)
+      {
+        ignwarn << "Lidar [" << this->Name() << "] moved out of the render "
+          << "of group [" << this->dataPtr->sharedRaysGroup << "], keeping "
+          << "its previous rays.\n";
+        this->dataPtr->resampleWarned = true;
+      }
     }
+    this->dataPtr->resampler.Resample(shared.buffer.data(), this->RangeMin(),
+        this->RangeMax(), this->laserBuffer);
   }
-  return true;
+  this->RecordPhase(UpdatePhase::COPY, copyStart);
 }
 
 /////////////////////////////////////////////////
@@ -278,7 +867,18 @@ ignition::common::ConnectionPtr GpuLidarSensor::ConnectNewLidarFrame(
                   unsigned int _height, unsigned int _channels,
                   const std::string &/*_format*/)> _subscriber)
 {
-  return this->dataPtr->gpuRays->ConnectNewGpuRaysFrame(_subscriber);
+  auto connection = this->dataPtr->gpuRays->ConnectNewGpuRaysFrame(
+      _subscriber);
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->frameConnectionsMutex);
+  auto &connections = this->dataPtr->frameConnections;
+  connections.erase(std::remove_if(connections.begin(), connections.end(),
+      [](const std::weak_ptr<ignition::common::Connection> &_c)
+      {
+        return _c.expired();
+      }), connections.end());
+  connections.push_back(connection);
+  return connection;
 }
 
 /////////////////////////////////////////////////
@@ -287,6 +887,24 @@ ignition::rendering::GpuRaysPtr GpuLidarSensor::GpuRays() const
   return this->dataPtr->gpuRays;
 }
 
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetSharedRaysGroup(const std::string &_group)
+{
+  this->dataPtr->sharedRaysGroup = _group;
+}
+
+//////////////////////////////////////////////////
+std::string GpuLidarSensor::SharedRaysGroup() const
+{
+  return this->dataPtr->sharedRaysGroup;
+}
+
+//////////////////////////////////////////////////
+bool GpuLidarSensor::SharesRays() const
+{
+  return this->dataPtr->resampler.Configured();
+}
+
 //////////////////////////////////////////////////
 bool GpuLidarSensor::IsHorizontal() const
 {
@@ -306,74 +924,214 @@ ignition::math::Angle GpuLidarSensor::VFOV() const
 }
 
 //////////////////////////////////////////////////
-void GpuLidarSensorPrivate::FillPointCloudMsg(const float *_laserBuffer)
+void GpuLidarSensor::SetPointCloudStride(const unsigned int _stride)
 {
-  IGN_PROFILE("GpuLidarSensorPrivate::FillPointCloudMsg");
-  uint32_t width = this->pointMsg.width();
-  uint32_t height = this->pointMsg.height();
-  unsigned int channels = 3;
+  this->dataPtr->pointFilter.SetStride(_stride);
+}
 
-  float angleStep =
-    (this->gpuRays->AngleMax() - this->gpuRays->AngleMin()).Radian() /
-    (this->gpuRays->RangeCount()-1);
+//////////////////////////////////////////////////
+unsigned int GpuLidarSensor::PointCloudStride() const
+{
+  return this->dataPtr->pointFilter.Stride();
+}
 
-  float verticleAngleStep = (this->gpuRays->VerticalAngleMax() -
-      this->gpuRays->VerticalAngleMin()).Radian() /
-    (this->gpuRays->VerticalRangeCount()-1);
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetVoxelLeafSize(const double _leafSize)
+{
+  this->dataPtr->pointFilter.SetLeafSize(_leafSize);
+}
 
-  // Angles of ray currently processing, azimuth is horizontal, inclination
-  // is vertical
-  float inclination = this->gpuRays->VerticalAngleMin().Radian();
+//////////////////////////////////////////////////
+double GpuLidarSensor::VoxelLeafSize() const
+{
+  return this->dataPtr->pointFilter.LeafSize();
+}
 
-  std::string *msgBuffer = this->pointMsg.mutable_data();
-  msgBuffer->resize(this->pointMsg.row_step() *
-      this->pointMsg.height());
-  char *msgBufferIndex = msgBuffer->data();
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetPointCloudResolution(const double _resolution)
+{
+  this->dataPtr->pointsUtil.SetResolution(_resolution);
+}
 
-  // Iterate over scan and populate point cloud
-  for (uint32_t j = 0; j < height; ++j)
+//////////////////////////////////////////////////
+double GpuLidarSensor::PointCloudResolution() const
+{
+  return this->dataPtr->pointsUtil.Resolution();
+}
+
+//////////////////////////////////////////////////
+bool GpuLidarSensor::SetPointCloudCompression(const bool _compress)
+{
+  return this->dataPtr->pointsUtil.SetCompression(_compress);
+}
+
+//////////////////////////////////////////////////
+bool GpuLidarSensor::PointCloudCompression() const
+{
+  return this->dataPtr->pointsUtil.Compression();
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetPointCloudChunkRows(const unsigned int _rows)
+{
+  this->dataPtr->pointChunkRows = _rows;
+}
+
+//////////////////////////////////////////////////
+unsigned int GpuLidarSensor::PointCloudChunkRows() const
+{
+  return this->dataPtr->pointChunkRows;
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensor::SetPointCloudOutput(const LidarOutputMode _mode)
+{
+  this->dataPtr->pointCloudOutput = _mode;
+}
+
+//////////////////////////////////////////////////
+LidarOutputMode GpuLidarSensor::PointCloudOutput() const
+{
+  return this->dataPtr->pointCloudOutput;
+}
+
+//////////////////////////////////////////////////
+void GpuLidarSensorPrivate::UpdateRayDirections(const uint32_t _width,
+    const uint32_t _height)
+{
+  const std::array<double, 4> angles{{
+      this->rayPattern.angleMin, this->rayPattern.angleMax,
+      this->rayPattern.verticalAngleMin, this->rayPattern.verticalAngleMax}};
+  if (_width == this->rayWidth && _height == this->rayHeight &&
+      angles == this->rayAngles)
   {
-    float azimuth = this->gpuRays->AngleMin().Radian();
+    return;
+  }
 
-    for (uint32_t i = 0; i < width; ++i)
+  IGN_PROFILE("GpuLidarSensorPrivate::UpdateRayDirections");
+  this->rayAngles = angles;
+  this->rayWidth = _width;
+  this->rayHeight = _height;
+
+  const double angleStep = _width > 1u ?
+      (angles[1] - angles[0]) / (_width - 1u) : 0.0;
+  const double verticalAngleStep = _height > 1u ?
+      (angles[3] - angles[2]) / (_height - 1u) : 0.0;
+
+  // Azimuth is horizontal, inclination is vertical.
+  // See https://en.wikipedia.org/wiki/Spherical_coordinate_system
+  std::vector<double> cosAzimuth(_width);
+  std::vector<double> sinAzimuth(_width);
+  for (uint32_t i = 0; i < _width; ++i)
+  {
+    const double azimuth = angles[0] + i * angleStep;
+    cosAzimuth[i] = std::cos(azimuth);
+    sinAzimuth[i] = std::sin(azimuth);
+  }
+
+  this->rayDirections.resize(static_cast<std::size_t>(_width) * _height * 3u);
+  float *direction = this->rayDirections.data();
+  for (uint32_t j = 0; j < _height; ++j)
+  {
+    const double inclination = angles[2] + j * verticalAngleStep;
+    const double cosInclination = std::cos(inclination);
+    const float sinInclination = static_cast<float>(std::sin(inclination));
+    for (uint32_t i = 0; i < _width; ++i)
     {
-      // Index of current point, and the depth value at that point
-      auto index = j * width * channels + i * channels;
-      float depth = _laserBuffer[index];
-      float intensity = _laserBuffer[index + 1];
-      uint16_t ring = j;
+      *direction++ = static_cast<float>(cosInclination * cosAzimuth[i]);
+      *direction++ = static_cast<float>(cosInclination * sinAzimuth[i]);
+      *direction++ = sinInclination;
+    }
+  }
+}
 
-      int fieldIndex = 0;
+//////////////////////////////////////////////////
+void GpuLidarSensorPrivate::FillPointCloudMsg(const float *_laserBuffer,
+    const uint32_t _firstRow, msgs::PointCloudPacked &_msg)
+{
+  IGN_PROFILE("GpuLidarSensorPrivate::FillPointCloudMsg");
+  const uint32_t width = this->pointMsg.width();
+  const uint32_t lastRow = std::min(_firstRow + _msg.height(),
+      this->pointMsg.height());
+  const unsigned int channels = 3;
 
-      // Convert spherical coordinates to Cartesian for pointcloud
-      // See https://en.wikipedia.org/wiki/Spherical_coordinate_system
-      *reinterpret_cast<float *>(msgBufferIndex +
-          this->pointMsg.field(fieldIndex++).offset()) =
-        depth * std::cos(inclination) * std::cos(azimuth);
+  // The ray geometry only changes with the angle limits and ray counts,
+  // so each point is its range times a cached unit direction
+  this->UpdateRayDirections(width, this->pointMsg.height());
 
-      *reinterpret_cast<float *>(msgBufferIndex +
-          this->pointMsg.field(fieldIndex++).offset()) =
-        depth * std::cos(inclination) * std::sin(azimuth);
+  const uint32_t xOffset = _msg.field(0).offset();
+  const uint32_t yOffset = _msg.field(1).offset();
+  const uint32_t zOffset = _msg.field(2).offset();
+  const uint32_t intensityOffset = _msg.field(3).offset();
+  const uint32_t ringOffset = _msg.field(4).offset();
+  const uint32_t pointStep = _msg.point_step();
 
-      *reinterpret_cast<float *>(msgBufferIndex +
-          this->pointMsg.field(fieldIndex++).offset()) =
-        depth * std::sin(inclination);
+  std::string *msgBuffer = _msg.mutable_data();
+  msgBuffer->resize(_msg.row_step() * _msg.height());
+  char *msgBufferIndex = msgBuffer->data();
 
-      // Intensity
-      *reinterpret_cast<float *>(msgBufferIndex +
-          this->pointMsg.field(fieldIndex++).offset()) = intensity;
+  // Iterate over scan and populate point cloud
+  const std::size_t firstRay = static_cast<std::size_t>(_firstRow) * width;
+  const float *direction = this->rayDirections.data() + firstRay * 3u;
+  const float *laser = _laserBuffer + firstRay * channels;
+  for (uint32_t j = _firstRow; j < lastRow; ++j)
+  {
+    const uint16_t ring = static_cast<uint16_t>(j);
+    for (uint32_t i = 0; i < width; ++i)
+    {
+      const float depth = laser[0];
+
+      *reinterpret_cast<float *>(msgBufferIndex + xOffset) =
+          depth * direction[0];
+      *reinterpret_cast<float *>(msgBufferIndex + yOffset) =
+          depth * direction[1];
+      *reinterpret_cast<float *>(msgBufferIndex + zOffset) =
+          depth * direction[2];
+      *reinterpret_cast<float *>(msgBufferIndex + intensityOffset) =
+          laser[1];
+      *reinterpret_cast<uint16_t *>(msgBufferIndex + ringOffset) = ring;
+
+      // Move to the next point.
+      msgBufferIndex += pointStep;
+      laser += channels;
+      direction += 3;
+    }
+  }
+}
 
-      // Ring
-      *reinterpret_cast<uint16_t *>(msgBufferIndex +
-          this->pointMsg.field(fieldIndex++).offset()) = ring;
+//////////////////////////////////////////////////
+SensorMemory GpuLidarSensor::MemoryUsage() const
+{
+  SensorMemory memory = Lidar::MemoryUsage();
+  memory.renderTargetBytes += RenderTargetBytes(this->dataPtr->gpuRays);
+  for (const auto &rays : this->dataPtr->sectorRays)
+    memory.renderTargetBytes += RenderTargetBytes(rays);
+  memory.readbackBytes += this->dataPtr->laserBufferSize * sizeof(float) +
+      this->dataPtr->sectorBuffer.capacity() * sizeof(float);
+  memory.messageBytes += this->dataPtr->pointMsg.SpaceUsedLong() +
+      this->dataPtr->chunkMsg.SpaceUsedLong() +
+      this->dataPtr->filteredPointMsg.SpaceUsedLong() +
+      this->dataPtr->encodedPointMsg.SpaceUsedLong();
+  return memory;
+}
 
-      // Move the index to the next point.
-      msgBufferIndex += this->pointMsg.point_step();
+//////////////////////////////////////////////////
+bool GpuLidarSensor::HasConnections() const
+{
+  if (Lidar::HasConnections() ||
+      (this->dataPtr->pointCloudOutput != LidarOutputMode::DISABLED &&
+       this->HasConsumers(this->dataPtr->pointPub)))
+  {
+    return true;
+  }
 
-      azimuth += angleStep;
-    }
-    inclination += verticleAngleStep;
+  std::lock_guard<std::mutex> lock(this->dataPtr->frameConnectionsMutex);
+  for (const auto &connection : this->dataPtr->frameConnections)
+  {
+    if (!connection.expired())
+      return true;
   }
+  return false;
 }
 
 IGN_SENSORS_REGISTER_SENSOR(GpuLidarSensor)
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#include "HeaderUtil.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+msgs::Header::Map *ignition::sensors::HeaderEntry(msgs::Header &_header,
+    const std::string &_key)
+{
+  for (int i = 0; i < _header.data_size(); ++i)
+  {
+    if (_header.data(i).key() == _key)
+      return _header.mutable_data(i);
+  }
+  msgs::Header::Map *entry = _header.add_data();
+  entry->set_key(_key);
+  return entry;
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderEntryValue(msgs::Header::Map &_entry,
+    const char *_value, const std::size_t _size)
+{
+  if (_entry.value_size() == 0)
+  {
+    _entry.add_value(_value, _size);
+    return;
+  }
+
+  std::string *value = _entry.mutable_value(0);
+  if (value->size() != _size ||
+      std::memcmp(value->data(), _value, _size) != 0)
+  {
+    value->assign(_value, _size);
+  }
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderEntryValue(msgs::Header::Map &_entry,
+    const uint64_t _value)
+{
+  char buffer[20];
+  char *end = buffer + sizeof(buffer);
+  char *begin = end;
+  uint64_t value = _value;
+  do
+  {
+    *--begin = static_cast<char>('0' + value % 10u);
+    value /= 10u;
+  } while (value > 0u);
+
+  SetHeaderEntryValue(_entry, begin, end - begin);
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderEntryValue(msgs::Header::Map &_entry,
+    const double _value)
+{
+  char buffer[32];
+  const int size = std::snprintf(buffer, sizeof(buffer), "%.*g",
+      std::numeric_limits<double>::max_digits10, _value);
+  if (size > 0)
+  {
+    SetHeaderEntryValue(_entry, buffer,
+        std::min<std::size_t>(size, sizeof(buffer) - 1u));
+  }
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderValue(msgs::Header &_header,
+    const std::string &_key, const std::string &_value)
+{
+  SetHeaderEntryValue(*HeaderEntry(_header, _key), _value.data(),
+      _value.size());
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderValue(msgs::Header &_header,
+    const std::string &_key, const uint64_t _value)
+{
+  SetHeaderEntryValue(*HeaderEntry(_header, _key), _value);
+}
+
+//////////////////////////////////////////////////
+void ignition::sensors::SetHeaderValue(msgs::Header &_header,
+    const std::string &_key, const double _value)
+{
+  SetHeaderEntryValue(*HeaderEntry(_header, _key), _value);
+}
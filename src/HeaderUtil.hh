@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_HEADERUTIL_HH_
+#define IGNITION_SENSORS_HEADERUTIL_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/header.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Get a header entry, adding it the first time.
+    /// \param[in,out] _header Header.
+    /// \param[in] _key Key of the entry.
+    /// \return The first entry with the key.
+    IGNITION_SENSORS_VISIBLE msgs::Header::Map *HeaderEntry(
+        msgs::Header &_header, const std::string &_key);
+
+    /// \brief Set the first value of a header entry. The value is only
+    /// written if it changed, and reuses the memory of the previous one.
+    /// \param[in,out] _entry Header entry.
+    /// \param[in] _value Characters of the value.
+    /// \param[in] _size Number of characters.
+    IGNITION_SENSORS_VISIBLE void SetHeaderEntryValue(
+        msgs::Header::Map &_entry, const char *_value,
+        const std::size_t _size);
+
+    /// \brief Set the first value of a header entry to the decimal digits
+    /// of an integer, without allocating once the entry has a value.
+    /// \param[in,out] _entry Header entry.
+    /// \param[in] _value Value.
+    IGNITION_SENSORS_VISIBLE void SetHeaderEntryValue(
+        msgs::Header::Map &_entry, const uint64_t _value);
+
+    /// \brief Set the first value of a header entry to a floating point
+    /// number, with the digits needed to read back the same double.
+    /// \param[in,out] _entry Header entry.
+    /// \param[in] _value Value.
+    IGNITION_SENSORS_VISIBLE void SetHeaderEntryValue(
+        msgs::Header::Map &_entry, const double _value);
+
+    /// \brief Set the first value of a header entry, adding the entry the
+    /// first time.
+    /// \param[in,out] _header Header.
+    /// \param[in] _key Key of the entry.
+    /// \param[in] _value Value of the entry.
+    IGNITION_SENSORS_VISIBLE void SetHeaderValue(msgs::Header &_header,
+        const std::string &_key, const std::string &_value);
+
+    /// \brief Set the first value of a header entry to an integer, adding
+    /// the entry the first time.
+    /// \param[in,out] _header Header.
+    /// \param[in] _key Key of the entry.
+    /// \param[in] _value Value of the entry.
+    IGNITION_SENSORS_VISIBLE void SetHeaderValue(msgs::Header &_header,
+        const std::string &_key, const uint64_t _value);
+
+    /// \brief Set the first value of a header entry to a floating point
+    /// number, adding the entry the first time.
+    /// \param[in,out] _header Header.
+    /// \param[in] _key Key of the entry.
+    /// \param[in] _value Value of the entry.
+    IGNITION_SENSORS_VISIBLE void SetHeaderValue(msgs::Header &_header,
+        const std::string &_key, const double _value);
+    }
+  }
+}
+
+#endif
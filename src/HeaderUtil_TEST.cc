@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "HeaderUtil.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/////////////////////////////////////////////////
+TEST(HeaderUtilTest, SetValues)
+{
+  msgs::Header header;
+  SetHeaderValue(header, "chunk", static_cast<uint64_t>(0u));
+  SetHeaderValue(header, "name", std::string("first"));
+  ASSERT_EQ(2, header.data_size());
+  EXPECT_EQ("chunk", header.data(0).key());
+  EXPECT_EQ("0", header.data(0).value(0));
+  EXPECT_EQ("first", header.data(1).value(0));
+
+  // Entries are updated in place
+  SetHeaderValue(header, "chunk",
+      std::numeric_limits<uint64_t>::max());
+  SetHeaderValue(header, "name", std::string("second"));
+  ASSERT_EQ(2, header.data_size());
+  ASSERT_EQ(1, header.data(0).value_size());
+  EXPECT_EQ("18446744073709551615", header.data(0).value(0));
+  ASSERT_EQ(1, header.data(1).value_size());
+  EXPECT_EQ("second", header.data(1).value(0));
+
+  // Only the first value is set
+  header.mutable_data(1)->add_value("extra");
+  SetHeaderValue(header, "name", std::string("third"));
+  ASSERT_EQ(2, header.data(1).value_size());
+  EXPECT_EQ("third", header.data(1).value(0));
+  EXPECT_EQ("extra", header.data(1).value(1));
+
+  EXPECT_EQ(header.mutable_data(0), HeaderEntry(header, "chunk"));
+  msgs::Header::Map *entry = HeaderEntry(header, "new");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(3, header.data_size());
+  EXPECT_EQ("new", entry->key());
+  EXPECT_EQ(0, entry->value_size());
+}
+
+/////////////////////////////////////////////////
+TEST(HeaderUtilTest, FullPrecision)
+{
+  msgs::Header header;
+  for (double value : {0.1, -0.5235987755982988, 1e-300, 123456.789})
+  {
+    SetHeaderValue(header, "value", value);
+    ASSERT_EQ(1, header.data_size());
+    EXPECT_EQ(value, std::stod(header.data(0).value(0)));
+  }
+  SetHeaderValue(header, "value", 2.0);
+  EXPECT_EQ("2", header.data(0).value(0));
+}
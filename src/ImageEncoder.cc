@@ -0,0 +1,933 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef WITH_JPEG
+#include <csetjmp>
+#include <cstdio>
+#include <cstdlib>
+#include <jpeglib.h>
+#endif
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Filesystem.hh>
+#include <ignition/common/Image.hh>
+#include <ignition/common/Profiler.hh>
+
+#include "ImageEncoder.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Threads shared by all compressed image publishers and frame
+  /// writers.
+  class EncoderThreadPool
+  {
+    /// \brief Get the process wide pool.
+    /// \return The pool.
+    public: static EncoderThreadPool &Instance()
+    {
+      static EncoderThreadPool pool;
+      return pool;
+    }
+
+    /// \brief Constructor. Starts the threads.
+    public: EncoderThreadPool()
+    {
+      unsigned int count = std::max(1u,
+          std::min(8u, std::thread::hardware_concurrency() / 2u));
+      for (unsigned int i = 0u; i < count; ++i)
+        this->threads.emplace_back(&EncoderThreadPool::Run, this);
+    }
+
+    /// \brief Destructor. Runs the remaining jobs and joins the threads.
+    public: ~EncoderThreadPool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+      }
+      this->cv.notify_all();
+      for (auto &thread : this->threads)
+        thread.join();
+    }
+
+    /// \brief Schedule a job.
+    /// \param[in] _job The job.
+    public: void Post(std::function<void()> _job)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->jobs.push_back(std::move(_job));
+      }
+      this->cv.notify_one();
+    }
+
+    /// \brief Thread function
+    private: void Run()
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      while (true)
+      {
+        this->cv.wait(lock, [this]
+            {
+              return this->stop || !this->jobs.empty();
+            });
+        if (this->jobs.empty())
+          return;
+
+        auto job = std::move(this->jobs.front());
+        this->jobs.pop_front();
+        lock.unlock();
+        job();
+        job = nullptr;
+        lock.lock();
+      }
+    }
+
+    /// \brief Background threads
+    private: std::vector<std::thread> threads;
+
+    /// \brief Jobs waiting to run
+    private: std::deque<std::function<void()>> jobs;
+
+    /// \brief True when the threads should exit
+    private: bool stop = false;
+
+    /// \brief Protects jobs and stop
+    private: std::mutex mutex;
+
+    /// \brief Signaled when a job is posted or the pool stops
+    private: std::condition_variable cv;
+  };
+
+  /// \brief Buffers of an image being encoded
+  struct EncoderJob
+  {
+    /// \brief Copy of the raw image
+    msgs::Image raw;
+
+    /// \brief Encoded image message
+    msgs::Image encoded;
+  };
+
+  /// \brief A frame waiting to be written
+  struct FrameJob
+  {
+    /// \brief Copy of the frame, with rows packed without padding
+    msgs::Image image;
+
+    /// \brief Encoded file contents
+    std::string encoded;
+
+    /// \brief File format
+    FrameFileFormat format = FrameFileFormat::PNG;
+
+    /// \brief Full path of the file
+    std::string filename;
+  };
+
+  /// \brief Layout of the pixels of a raw image
+  struct PixelLayout
+  {
+    /// \brief Number of channels
+    unsigned int channels = 0u;
+
+    /// \brief Bytes per channel, 1 or 2
+    unsigned int bytes = 0u;
+  };
+
+  /// \brief Get the layout of a pixel format.
+  /// \param[in] _format Pixel format.
+  /// \param[out] _layout Layout of _format.
+  /// \return False if the format isn't supported.
+  bool Layout(const msgs::PixelFormatType _format, PixelLayout &_layout)
+  {
+    switch (_format)
+    {
+      case msgs::PixelFormatType::L_INT8:
+      case msgs::PixelFormatType::BAYER_RGGB8:
+      case msgs::PixelFormatType::BAYER_BGGR8:
+      case msgs::PixelFormatType::BAYER_GBRG8:
+      case msgs::PixelFormatType::BAYER_GRBG8:
+        // Bayer mosaics are stored as gray images
+        _layout = {1u, 1u};
+        return true;
+      case msgs::PixelFormatType::L_INT16:
+        _layout = {1u, 2u};
+        return true;
+      case msgs::PixelFormatType::RGB_INT8:
+        _layout = {3u, 1u};
+        return true;
+      case msgs::PixelFormatType::RGBA_INT8:
+        _layout = {4u, 1u};
+        return true;
+      case msgs::PixelFormatType::RGB_INT16:
+        _layout = {3u, 2u};
+        return true;
+      default:
+        return false;
+    }
+  }
+
+#ifdef WITH_ZLIB
+  /// \brief Append a big endian 32 bit integer.
+  /// \param[in,out] _data Buffer to append to.
+  /// \param[in] _value Integer to append.
+  void AppendUint32(std::string &_data, const uint32_t _value)
+  {
+    const char bytes[4] = {
+      static_cast<char>(_value >> 24), static_cast<char>(_value >> 16),
+      static_cast<char>(_value >> 8), static_cast<char>(_value)};
+    _data.append(bytes, 4u);
+  }
+
+  /// \brief Write a big endian 32 bit integer.
+  /// \param[out] _dst Destination.
+  /// \param[in] _value Integer to write.
+  void WriteUint32(char *_dst, const uint32_t _value)
+  {
+    _dst[0] = static_cast<char>(_value >> 24);
+    _dst[1] = static_cast<char>(_value >> 16);
+    _dst[2] = static_cast<char>(_value >> 8);
+    _dst[3] = static_cast<char>(_value);
+  }
+
+  /// \brief Append a PNG chunk.
+  /// \param[in,out] _data Buffer to append to.
+  /// \param[in] _type Four letter chunk type.
+  /// \param[in] _payload Chunk data.
+  /// \param[in] _size Size of _payload.
+  void AppendChunk(std::string &_data, const char *_type,
+      const unsigned char *_payload, const uint32_t _size)
+  {
+    AppendUint32(_data, _size);
+    const std::size_t start = _data.size();
+    _data.append(_type, 4u);
+    _data.append(reinterpret_cast<const char *>(_payload), _size);
+    const uLong crc = crc32(0u,
+        reinterpret_cast<const Bytef *>(_data.data() + start), _size + 4u);
+    AppendUint32(_data, static_cast<uint32_t>(crc));
+  }
+
+  /// \brief Encode an image as PNG.
+  /// \param[in] _image Raw image.
+  /// \param[in] _layout Pixel layout of the image.
+  /// \param[in] _level Compression level between 0 and 9.
+  /// \param[out] _data Encoded image.
+  /// \return True on success.
+  bool EncodePng(const msgs::Image &_image, const PixelLayout &_layout,
+      const int _level, std::string &_data)
+  {
+    const uint32_t width = _image.width();
+    const uint32_t height = _image.height();
+    const std::size_t pixelBytes = _layout.channels * _layout.bytes;
+    const std::size_t rowBytes = width * pixelBytes;
+    const std::size_t step = _image.step() > 0u ? _image.step() : rowBytes;
+
+    // Rows filtered with the PNG "sub" filter, each prefixed by its filter
+    // type. Encoding threads are long lived, so the buffer is reused.
+    thread_local std::vector<unsigned char> filtered;
+    filtered.resize(height * (rowBytes + 1u));
+
+    const unsigned char *src =
+        reinterpret_cast<const unsigned char *>(_image.data().data());
+    for (uint32_t y = 0u; y < height; ++y)
+    {
+      const unsigned char *in = src + y * step;
+      unsigned char *out = filtered.data() + y * (rowBytes + 1u);
+      *out++ = 1u;
+      if (_layout.bytes == 1u)
+      {
+        std::memcpy(out, in, rowBytes);
+      }
+      else
+      {
+        // PNG samples are big endian
+        for (std::size_t i = 0u; i < rowBytes; i += 2u)
+        {
+          uint16_t sample;
+          std::memcpy(&sample, in + i, 2u);
+          out[i] = static_cast<unsigned char>(sample >> 8);
+          out[i + 1u] = static_cast<unsigned char>(sample);
+        }
+      }
+
+      for (std::size_t i = rowBytes; i-- > pixelBytes;)
+        out[i] = static_cast<unsigned char>(out[i] - out[i - pixelBytes]);
+    }
+
+    static const unsigned char signature[8] =
+        {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    unsigned char header[13];
+    WriteUint32(reinterpret_cast<char *>(header), width);
+    WriteUint32(reinterpret_cast<char *>(header + 4), height);
+    header[8] = static_cast<unsigned char>(8u * _layout.bytes);
+    header[9] = _layout.channels == 1u ? 0u :
+        (_layout.channels == 3u ? 2u : 6u);
+    header[10] = 0u;
+    header[11] = 0u;
+    header[12] = 0u;
+
+    _data.clear();
+    _data.append(reinterpret_cast<const char *>(signature), 8u);
+    AppendChunk(_data, "IHDR", header, 13u);
+
+    // Deflate straight into the IDAT chunk
+    const std::size_t offset = _data.size();
+    uLongf compressedSize = compressBound(filtered.size());
+    _data.resize(offset + 8u + compressedSize + 4u);
+    char *chunk = &_data[offset];
+    if (compress2(reinterpret_cast<Bytef *>(chunk + 8), &compressedSize,
+          filtered.data(), filtered.size(), _level) != Z_OK)
+    {
+      return false;
+    }
+    WriteUint32(chunk, static_cast<uint32_t>(compressedSize));
+    std::memcpy(chunk + 4, "IDAT", 4u);
+    const uLong crc = crc32(0u, reinterpret_cast<const Bytef *>(chunk + 4),
+        static_cast<uInt>(compressedSize + 4u));
+    WriteUint32(chunk + 8 + compressedSize, static_cast<uint32_t>(crc));
+    _data.resize(offset + 8u + compressedSize + 4u);
+
+    AppendChunk(_data, "IEND", nullptr, 0u);
+    return true;
+  }
+#endif
+
+  /// \brief Get whether an image can be saved as PNM.
+  /// \param[in] _format Pixel format.
+  /// \return True for gray, Bayer and RGB images.
+  bool PnmSupported(const msgs::PixelFormatType _format)
+  {
+    PixelLayout layout;
+    return Layout(_format, layout) &&
+        (layout.channels == 1u || layout.channels == 3u);
+  }
+
+  /// \brief Encode an image as binary PGM or PPM.
+  /// \param[in] _image Image with packed rows.
+  /// \param[in] _layout Pixel layout of the image.
+  /// \param[out] _data Encoded image.
+  void EncodePnm(const msgs::Image &_image, const PixelLayout &_layout,
+      std::string &_data)
+  {
+    _data = (_layout.channels == 1u ? "P5\n" : "P6\n") +
+        std::to_string(_image.width()) + " " +
+        std::to_string(_image.height()) + "\n" +
+        (_layout.bytes == 1u ? "255\n" : "65535\n");
+
+    const std::size_t offset = _data.size();
+    const std::string &src = _image.data();
+    _data.append(src);
+    if (_layout.bytes == 2u)
+    {
+      // PNM samples are big endian
+      for (std::size_t i = offset; i + 1u < _data.size(); i += 2u)
+      {
+        uint16_t sample;
+        std::memcpy(&sample, src.data() + (i - offset), 2u);
+        _data[i] = static_cast<char>(sample >> 8);
+        _data[i + 1u] = static_cast<char>(sample);
+      }
+    }
+  }
+
+  /// \brief Save a PNG file with ignition::common::Image. Used when this
+  /// build has no PNG encoder of its own.
+  /// \param[in] _image Image with packed rows.
+  /// \param[in] _filename File to save.
+  /// \return False if the pixel format isn't supported.
+  bool SaveCommonPng(const msgs::Image &_image, const std::string &_filename)
+  {
+    common::Image::PixelFormatType format;
+    switch (_image.pixel_format_type())
+    {
+      case msgs::PixelFormatType::L_INT8:
+      case msgs::PixelFormatType::BAYER_RGGB8:
+      case msgs::PixelFormatType::BAYER_BGGR8:
+      case msgs::PixelFormatType::BAYER_GBRG8:
+      case msgs::PixelFormatType::BAYER_GRBG8:
+        format = common::Image::L_INT8;
+        break;
+      case msgs::PixelFormatType::L_INT16:
+        format = common::Image::L_INT16;
+        break;
+      case msgs::PixelFormatType::RGB_INT8:
+        format = common::Image::RGB_INT8;
+        break;
+      case msgs::PixelFormatType::RGBA_INT8:
+        format = common::Image::RGBA_INT8;
+        break;
+      case msgs::PixelFormatType::RGB_INT16:
+        format = common::Image::RGB_INT16;
+        break;
+      default:
+        return false;
+    }
+
+    common::Image image;
+    image.SetFromData(
+        reinterpret_cast<const unsigned char *>(_image.data().data()),
+        _image.width(), _image.height(), format);
+    image.SavePNG(_filename);
+    return true;
+  }
+
+#ifdef WITH_JPEG
+  /// \brief Error manager that returns control to the encoder instead of
+  /// exiting the process.
+  struct JpegError
+  {
+    /// \brief libjpeg error manager
+    jpeg_error_mgr mgr;
+
+    /// \brief Where to jump on errors
+    std::jmp_buf jump;
+  };
+
+  /// \brief libjpeg error handler
+  /// \param[in] _info Compressor that failed.
+  void JpegErrorExit(j_common_ptr _info)
+  {
+    std::longjmp(reinterpret_cast<JpegError *>(_info->err)->jump, 1);
+  }
+
+  /// \brief Encode an image as JPEG.
+  /// \param[in] _image Raw image.
+  /// \param[in] _layout Pixel layout of the image.
+  /// \param[in] _quality Quality between 1 and 100.
+  /// \param[out] _data Encoded image.
+  /// \return True on success.
+  bool EncodeJpeg(const msgs::Image &_image, const PixelLayout &_layout,
+      const int _quality, std::string &_data)
+  {
+    if (_layout.bytes != 1u || (_layout.channels != 1u &&
+        _layout.channels != 3u))
+    {
+      return false;
+    }
+
+    const std::size_t rowBytes = _image.width() * _layout.channels;
+    const std::size_t step = _image.step() > 0u ? _image.step() : rowBytes;
+    unsigned char *src = reinterpret_cast<unsigned char *>(
+        const_cast<char *>(_image.data().data()));
+
+    jpeg_compress_struct info;
+    JpegError error;
+    info.err = jpeg_std_error(&error.mgr);
+    error.mgr.error_exit = JpegErrorExit;
+
+    unsigned char *buffer = nullptr;
+    unsigned long size = 0u;
+    if (setjmp(error.jump))
+    {
+      jpeg_destroy_compress(&info);
+      std::free(buffer);
+      return false;
+    }
+
+    jpeg_create_compress(&info);
+    jpeg_mem_dest(&info, &buffer, &size);
+    info.image_width = _image.width();
+    info.image_height = _image.height();
+    info.input_components = static_cast<int>(_layout.channels);
+    info.in_color_space = _layout.channels == 1u ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&info);
+    jpeg_set_quality(&info, _quality, TRUE);
+    jpeg_start_compress(&info, TRUE);
+    while (info.next_scanline < info.image_height)
+    {
+      JSAMPROW row = src + info.next_scanline * step;
+      jpeg_write_scanlines(&info, &row, 1);
+    }
+    jpeg_finish_compress(&info);
+    jpeg_destroy_compress(&info);
+
+    _data.assign(reinterpret_cast<const char *>(buffer), size);
+    std::free(buffer);
+    return true;
+  }
+#endif
+}
+
+/// \brief Private data for CompressedImagePublisher
+class ignition::sensors::CompressedImagePublisherPrivate :
+  public std::enable_shared_from_this<CompressedImagePublisherPrivate>
+{
+  /// \brief Encode and publish an image. Called by the background threads.
+  /// \param[in] _job Image to encode.
+  public: void Run(std::unique_ptr<EncoderJob> _job);
+
+  /// \brief Publisher of the compressed images
+  public: transport::Node::Publisher pub;
+
+  /// \brief Encoding
+  public: ImageCompression compression = ImageCompression::NONE;
+
+  /// \brief Quality or compression level
+  public: int quality = -1;
+
+  /// \brief Value of the "format" header entry
+  public: std::string format;
+
+  /// \brief Maximum number of images being encoded
+  public: std::size_t depth = 1u;
+
+  /// \brief Number of images being encoded
+  public: std::size_t inFlight = 0u;
+
+  /// \brief Number of dropped images
+  public: std::uint64_t dropped = 0u;
+
+  /// \brief Buffers of finished jobs, reused by later images
+  public: std::vector<std::unique_ptr<EncoderJob>> freeJobs;
+
+  /// \brief Protects the members above
+  public: std::mutex mutex;
+
+  /// \brief Signaled when an image has been published
+  public: std::condition_variable cv;
+};
+
+//////////////////////////////////////////////////
+void CompressedImagePublisherPrivate::Run(std::unique_ptr<EncoderJob> _job)
+{
+  IGN_PROFILE("CompressedImagePublisher::Encode");
+  const msgs::Image &raw = _job->raw;
+  msgs::Image &encoded = _job->encoded;
+  encoded.set_width(raw.width());
+  encoded.set_height(raw.height());
+  // The data isn't rows of pixels anymore
+  encoded.set_step(0u);
+  encoded.set_pixel_format_type(raw.pixel_format_type());
+  encoded.mutable_header()->CopyFrom(raw.header());
+  auto entry = encoded.mutable_header()->add_data();
+  entry->set_key("format");
+  entry->add_value(this->format);
+
+  if (CompressedImagePublisher::Encode(this->compression, raw, this->quality,
+        *encoded.mutable_data()))
+  {
+    this->pub.Publish(encoded);
+  }
+  else
+  {
+    ignerr << "Unable to encode image with pixel format ["
+           << static_cast<int>(raw.pixel_format_type()) << "] as ["
+           << this->format << "].\n";
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->freeJobs.push_back(std::move(_job));
+    --this->inFlight;
+  }
+  this->cv.notify_all();
+}
+
+//////////////////////////////////////////////////
+CompressedImagePublisher::CompressedImagePublisher(
+    const transport::Node::Publisher &_pub,
+    const ImageCompression _compression, const int _quality,
+    const std::size_t _depth)
+  : dataPtr(std::make_shared<CompressedImagePublisherPrivate>())
+{
+  this->dataPtr->pub = _pub;
+  this->dataPtr->compression = _compression;
+  this->dataPtr->quality = _quality;
+  this->dataPtr->depth = std::max<std::size_t>(1u, _depth);
+  if (_compression == ImageCompression::PNG)
+    this->dataPtr->format = "png";
+  else if (_compression == ImageCompression::JPEG)
+    this->dataPtr->format = "jpeg";
+}
+
+//////////////////////////////////////////////////
+CompressedImagePublisher::~CompressedImagePublisher()
+{
+  this->Flush();
+}
+
+//////////////////////////////////////////////////
+bool CompressedImagePublisher::Push(const msgs::Image &_image)
+{
+  IGN_PROFILE("CompressedImagePublisher::Push");
+  std::unique_ptr<EncoderJob> job;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    if (this->dataPtr->inFlight >= this->dataPtr->depth)
+    {
+      ++this->dataPtr->dropped;
+      return false;
+    }
+    ++this->dataPtr->inFlight;
+    if (!this->dataPtr->freeJobs.empty())
+    {
+      job = std::move(this->dataPtr->freeJobs.back());
+      this->dataPtr->freeJobs.pop_back();
+    }
+  }
+
+  if (!job)
+    job.reset(new EncoderJob);
+
+  // Assigning keeps the capacity of the buffers of the reused job
+  job->raw.CopyFrom(_image);
+
+  auto self = this->dataPtr;
+  EncoderJob *raw = job.release();
+  EncoderThreadPool::Instance().Post([self, raw]()
+      {
+        self->Run(std::unique_ptr<EncoderJob>(raw));
+      });
+  return true;
+}
+
+//////////////////////////////////////////////////
+void CompressedImagePublisher::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->cv.wait(lock, [this]
+      {
+        return this->dataPtr->inFlight == 0u;
+      });
+}
+
+//////////////////////////////////////////////////
+bool CompressedImagePublisher::HasConnections() const
+{
+  return this->dataPtr->pub && this->dataPtr->pub.HasConnections();
+}
+
+//////////////////////////////////////////////////
+ImageCompression CompressedImagePublisher::Compression() const
+{
+  return this->dataPtr->compression;
+}
+
+//////////////////////////////////////////////////
+std::uint64_t CompressedImagePublisher::DroppedCount() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->dropped;
+}
+
+//////////////////////////////////////////////////
+bool CompressedImagePublisher::Encode(const ImageCompression _compression,
+    const msgs::Image &_image, const int _quality, std::string &_data)
+{
+  PixelLayout layout;
+  if (!Layout(_image.pixel_format_type(), layout) ||
+      _image.width() == 0u || _image.height() == 0u)
+  {
+    return false;
+  }
+
+  const std::size_t rowBytes =
+      _image.width() * layout.channels * layout.bytes;
+  const std::size_t step = _image.step() > 0u ? _image.step() : rowBytes;
+  if (step < rowBytes ||
+      _image.data().size() < step * (_image.height() - 1u) + rowBytes)
+  {
+    return false;
+  }
+
+  switch (_compression)
+  {
+#ifdef WITH_ZLIB
+    case ImageCompression::PNG:
+      return EncodePng(_image, layout,
+          _quality < 0 ? 1 : std::min(_quality, 9), _data);
+#endif
+#ifdef WITH_JPEG
+    case ImageCompression::JPEG:
+      return EncodeJpeg(_image, layout,
+          _quality < 0 ? 90 : std::max(1, std::min(_quality, 100)), _data);
+#endif
+    default:
+      return false;
+  }
+}
+
+//////////////////////////////////////////////////
+bool CompressedImagePublisher::Supported(const ImageCompression _compression)
+{
+  switch (_compression)
+  {
+#ifdef WITH_ZLIB
+    case ImageCompression::PNG:
+      return true;
+#endif
+#ifdef WITH_JPEG
+    case ImageCompression::JPEG:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+/// \brief Private data for FrameWriter
+class ignition::sensors::FrameWriterPrivate
+{
+  /// \brief Write a frame. Called by the background threads.
+  /// \param[in] _job Frame to write.
+  public: void Run(std::unique_ptr<FrameJob> _job);
+
+  /// \brief Directory to save frames in
+  public: std::string path;
+
+  /// \brief Prefix of the file names
+  public: std::string prefix;
+
+  /// \brief File format of new frames
+  public: FrameFileFormat format = FrameFileFormat::PNG;
+
+  /// \brief Maximum number of queued frames
+  public: std::size_t depth = 1u;
+
+  /// \brief Number of queued frames
+  public: std::size_t inFlight = 0u;
+
+  /// \brief Number of dropped frames
+  public: std::uint64_t dropped = 0u;
+
+  /// \brief Number of written frames
+  public: std::uint64_t saved = 0u;
+
+  /// \brief Index of the next accepted frame, used in file names
+  public: std::uint64_t counter = 0u;
+
+  /// \brief True once the directory exists
+  public: bool directoryReady = false;
+
+  /// \brief Buffers of finished jobs, reused by later frames
+  public: std::vector<std::unique_ptr<FrameJob>> freeJobs;
+
+  /// \brief Protects the members above
+  public: std::mutex mutex;
+
+  /// \brief Signaled when a frame has been written
+  public: std::condition_variable cv;
+};
+
+//////////////////////////////////////////////////
+void FrameWriterPrivate::Run(std::unique_ptr<FrameJob> _job)
+{
+  IGN_PROFILE("FrameWriter::Write");
+  bool ready;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!this->directoryReady)
+    {
+      // Attempt to create the directory if it doesn't exist
+      this->directoryReady = common::isDirectory(this->path) ||
+          common::createDirectories(this->path);
+      if (!this->directoryReady)
+      {
+        ignerr << "Unable to create directory [" << this->path
+               << "] to save frames in.\n";
+      }
+    }
+    ready = this->directoryReady;
+  }
+
+  bool written = false;
+  if (ready)
+  {
+    PixelLayout layout;
+    Layout(_job->image.pixel_format_type(), layout);
+    bool encoded = false;
+    if (_job->format == FrameFileFormat::PNM)
+    {
+      EncodePnm(_job->image, layout, _job->encoded);
+      encoded = true;
+    }
+    else
+    {
+      encoded = CompressedImagePublisher::Encode(ImageCompression::PNG,
+          _job->image, -1, _job->encoded);
+    }
+
+    if (encoded)
+    {
+      std::ofstream file(_job->filename, std::ios::binary);
+      file.write(_job->encoded.data(),
+          static_cast<std::streamsize>(_job->encoded.size()));
+      written = static_cast<bool>(file);
+    }
+    else
+    {
+      written = SaveCommonPng(_job->image, _job->filename);
+    }
+
+    if (!written)
+      ignerr << "Unable to save frame [" << _job->filename << "].\n";
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->freeJobs.push_back(std::move(_job));
+    --this->inFlight;
+    if (written)
+      ++this->saved;
+  }
+  this->cv.notify_all();
+}
+
+//////////////////////////////////////////////////
+FrameWriter::FrameWriter(const std::string &_path,
+    const std::string &_prefix, const std::size_t _depth)
+  : dataPtr(std::make_shared<FrameWriterPrivate>())
+{
+  this->dataPtr->path = _path;
+  this->dataPtr->prefix = _prefix;
+  this->dataPtr->depth = std::max<std::size_t>(1u, _depth);
+}
+
+//////////////////////////////////////////////////
+FrameWriter::~FrameWriter()
+{
+  this->Flush();
+}
+
+//////////////////////////////////////////////////
+void FrameWriter::SetFormat(const FrameFileFormat _format)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->format = _format;
+}
+
+//////////////////////////////////////////////////
+FrameFileFormat FrameWriter::Format() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->format;
+}
+
+//////////////////////////////////////////////////
+bool FrameWriter::Push(const unsigned char *_data, const unsigned int _width,
+    const unsigned int _height, const unsigned int _step,
+    const msgs::PixelFormatType _format)
+{
+  IGN_PROFILE("FrameWriter::Push");
+  PixelLayout layout;
+  if (!_data || _width == 0u || _height == 0u || !Layout(_format, layout))
+    return false;
+
+  const std::size_t rowBytes = _width * layout.channels * layout.bytes;
+  const std::size_t step = _step > 0u ? _step : rowBytes;
+  if (step < rowBytes)
+    return false;
+
+  std::unique_ptr<FrameJob> job;
+  FrameFileFormat format;
+  std::uint64_t index;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    if (this->dataPtr->inFlight >= this->dataPtr->depth)
+    {
+      ++this->dataPtr->dropped;
+      return false;
+    }
+    ++this->dataPtr->inFlight;
+    index = this->dataPtr->counter++;
+    format = this->dataPtr->format;
+    if (!this->dataPtr->freeJobs.empty())
+    {
+      job = std::move(this->dataPtr->freeJobs.back());
+      this->dataPtr->freeJobs.pop_back();
+    }
+  }
+
+  if (!job)
+    job.reset(new FrameJob);
+
+  job->format = format == FrameFileFormat::PNM && PnmSupported(_format) ?
+      FrameFileFormat::PNM : FrameFileFormat::PNG;
+  std::string extension = job->format == FrameFileFormat::PNG ? ".png" :
+      (layout.channels == 1u ? ".pgm" : ".ppm");
+  job->filename = common::joinPaths(this->dataPtr->path,
+      this->dataPtr->prefix + std::to_string(index) + extension);
+
+  // Pack the rows. Resizing keeps the capacity of the reused buffer.
+  msgs::Image &image = job->image;
+  image.set_width(_width);
+  image.set_height(_height);
+  image.set_step(static_cast<uint32_t>(rowBytes));
+  image.set_pixel_format_type(_format);
+  std::string &data = *image.mutable_data();
+  data.resize(rowBytes * _height);
+  if (step == rowBytes)
+  {
+    std::memcpy(&data[0], _data, data.size());
+  }
+  else
+  {
+    for (unsigned int y = 0u; y < _height; ++y)
+      std::memcpy(&data[y * rowBytes], _data + y * step, rowBytes);
+  }
+
+  auto self = this->dataPtr;
+  FrameJob *raw = job.release();
+  EncoderThreadPool::Instance().Post([self, raw]()
+      {
+        self->Run(std::unique_ptr<FrameJob>(raw));
+      });
+  return true;
+}
+
+//////////////////////////////////////////////////
+void FrameWriter::Flush()
+{
+  std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->cv.wait(lock, [this]
+      {
+        return this->dataPtr->inFlight == 0u;
+      });
+}
+
+//////////////////////////////////////////////////
+std::uint64_t FrameWriter::DroppedCount() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->dropped;
+}
+
+//////////////////////////////////////////////////
+std::uint64_t FrameWriter::SavedCount() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->saved;
+}
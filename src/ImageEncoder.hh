@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_IMAGEENCODER_HH_
+#define IGNITION_SENSORS_IMAGEENCODER_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/image.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/SuppressWarning.hh>
+#include <ignition/transport/Node.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+#include "ignition/sensors/Sensor.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class CompressedImagePublisherPrivate;
+    class FrameWriterPrivate;
+
+    /// \brief Encodes raw image messages and publishes them from a shared
+    /// pool of background threads, so that compression doesn't add to the
+    /// update time of a sensor. The published messages are copies of the
+    /// raw ones, whose data holds the encoded image, and whose header has a
+    /// "format" entry set to "png" or "jpeg". Their step is 0, and their
+    /// pixel_format_type is the one of the decoded image, so the encoding is
+    /// only carried by the "format" entry and the topic.
+    class IGNITION_SENSORS_VISIBLE CompressedImagePublisher
+    {
+      /// \brief Constructor
+      /// \param[in] _pub Publisher of the compressed messages.
+      /// \param[in] _compression Encoding to use.
+      /// \param[in] _quality JPEG quality between 1 and 100, or PNG
+      /// compression level between 0 and 9. Negative values use the default
+      /// of the encoding, which favors speed.
+      /// \param[in] _depth Maximum number of images being encoded at the
+      /// same time. Images pushed beyond that are dropped. Zero is treated
+      /// as one.
+      public: CompressedImagePublisher(const transport::Node::Publisher &_pub,
+                  const ImageCompression _compression, const int _quality,
+                  const std::size_t _depth);
+
+      /// \brief Destructor. Waits for the images being encoded.
+      public: ~CompressedImagePublisher();
+
+      /// \brief Queue a copy of an image for encoding and publishing. The
+      /// copy reuses the buffers of previously published images.
+      /// \param[in] _image Raw image.
+      /// \return False if the image was dropped because too many images are
+      /// being encoded.
+      public: bool Push(const msgs::Image &_image);
+
+      /// \brief Block until all pushed images have been published.
+      public: void Flush();
+
+      /// \brief Get whether the compressed topic has subscribers.
+      /// \return True if there are subscribers.
+      public: bool HasConnections() const;
+
+      /// \brief Get the encoding of the published images.
+      /// \return The encoding.
+      public: ImageCompression Compression() const;
+
+      /// \brief Get the number of images dropped so far because too many
+      /// images were being encoded.
+      /// \return Number of dropped images.
+      public: std::uint64_t DroppedCount() const;
+
+      /// \brief Encode the data of an image. PNG supports the L_INT8,
+      /// L_INT16, RGB_INT8, RGBA_INT8 and RGB_INT16 pixel formats, JPEG
+      /// supports L_INT8 and RGB_INT8. Bayer images are encoded as L_INT8
+      /// images.
+      /// \param[in] _compression Encoding to use.
+      /// \param[in] _image Raw image.
+      /// \param[in] _quality JPEG quality between 1 and 100, or PNG
+      /// compression level between 0 and 9. Negative values use the default.
+      /// \param[out] _data Encoded image. Its capacity is reused.
+      /// \return False if the encoding or the pixel format of the image
+      /// isn't supported.
+      public: static bool Encode(const ImageCompression _compression,
+                  const msgs::Image &_image, const int _quality,
+                  std::string &_data);
+
+      /// \brief Get whether an encoding is available in this build.
+      /// \param[in] _compression Encoding.
+      /// \return True if images can be encoded with _compression.
+      public: static bool Supported(const ImageCompression _compression);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer. It is shared with the encoding jobs.
+      private: std::shared_ptr<CompressedImagePublisherPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+
+    /// \brief Saves frames to disk from the background threads shared with
+    /// CompressedImagePublisher, so that encoding and file I/O don't add to
+    /// the update time of a sensor. Files are named <prefix><n>.<ext>, where
+    /// n counts the saved frames from zero.
+    class IGNITION_SENSORS_VISIBLE FrameWriter
+    {
+      /// \brief Constructor
+      /// \param[in] _path Directory to save frames in. It is created when
+      /// the first frame is saved.
+      /// \param[in] _prefix Prefix of the file names.
+      /// \param[in] _depth Maximum number of frames waiting to be written.
+      /// Frames pushed beyond that are dropped. Zero is treated as one.
+      public: FrameWriter(const std::string &_path, const std::string &_prefix,
+                  const std::size_t _depth);
+
+      /// \brief Destructor. Waits for the queued frames to be written.
+      public: ~FrameWriter();
+
+      /// \brief Set the file format of frames pushed from now on.
+      /// \param[in] _format File format.
+      public: void SetFormat(const FrameFileFormat _format);
+
+      /// \brief Get the file format of new frames.
+      /// \return File format.
+      public: FrameFileFormat Format() const;
+
+      /// \brief Queue a copy of a frame to be written. The copy reuses the
+      /// buffers of previously written frames.
+      /// \param[in] _data Pixel data.
+      /// \param[in] _width Width in pixels.
+      /// \param[in] _height Height in pixels.
+      /// \param[in] _step Size of a row in bytes.
+      /// \param[in] _format Pixel format. L_INT8, L_INT16, RGB_INT8,
+      /// RGBA_INT8, RGB_INT16 and the 8 bit Bayer formats are supported.
+      /// \return False if the frame was dropped because too many frames are
+      /// waiting to be written, or if its pixel format isn't supported.
+      public: bool Push(const unsigned char *_data, const unsigned int _width,
+                  const unsigned int _height, const unsigned int _step,
+                  const msgs::PixelFormatType _format);
+
+      /// \brief Block until all queued frames have been written.
+      public: void Flush();
+
+      /// \brief Get the number of frames dropped so far because too many
+      /// frames were waiting to be written.
+      /// \return Number of dropped frames.
+      public: std::uint64_t DroppedCount() const;
+
+      /// \brief Get the number of frames written so far.
+      /// \return Number of written frames.
+      public: std::uint64_t SavedCount() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer. It is shared with the writing jobs.
+      private: std::shared_ptr<FrameWriterPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
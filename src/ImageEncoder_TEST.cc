@@ -0,0 +1,209 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+#include <ignition/common/Filesystem.hh>
+#include <ignition/transport/Node.hh>
+
+#include "ImageEncoder.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Create a test image.
+/// \param[in] _format Pixel format.
+/// \param[in] _bytesPerPixel Size of a pixel of _format.
+/// \return A 32x16 image with padded rows.
+msgs::Image TestImage(const msgs::PixelFormatType _format,
+    const unsigned int _bytesPerPixel)
+{
+  msgs::Image image;
+  image.set_width(32u);
+  image.set_height(16u);
+  image.set_step(32u * _bytesPerPixel + 4u);
+  image.set_pixel_format_type(_format);
+  std::string data(image.step() * image.height(), '\0');
+  for (std::size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<char>(i % 251u);
+  image.set_data(data);
+  return image;
+}
+
+//////////////////////////////////////////////////
+TEST(ImageEncoder, Png)
+{
+  if (!CompressedImagePublisher::Supported(ImageCompression::PNG))
+    return;
+
+  std::string data;
+  msgs::Image image = TestImage(msgs::PixelFormatType::RGB_INT8, 3u);
+  ASSERT_TRUE(CompressedImagePublisher::Encode(ImageCompression::PNG, image,
+      -1, data));
+  ASSERT_GT(data.size(), 33u);
+  EXPECT_EQ(std::string("\x89PNG\r\n\x1a\n", 8u), data.substr(0u, 8u));
+  EXPECT_EQ("IHDR", data.substr(12u, 4u));
+
+  // Width and height are big endian, followed by bit depth and color type
+  EXPECT_EQ(32, static_cast<unsigned char>(data[19]));
+  EXPECT_EQ(16, static_cast<unsigned char>(data[23]));
+  EXPECT_EQ(8, data[24]);
+  EXPECT_EQ(2, data[25]);
+  EXPECT_EQ("IEND", data.substr(data.size() - 8u, 4u));
+
+  image = TestImage(msgs::PixelFormatType::L_INT16, 2u);
+  ASSERT_TRUE(CompressedImagePublisher::Encode(ImageCompression::PNG, image,
+      9, data));
+  EXPECT_EQ(16, data[24]);
+  EXPECT_EQ(0, data[25]);
+
+  // Unsupported pixel format and truncated data
+  image = TestImage(msgs::PixelFormatType::R_FLOAT32, 4u);
+  EXPECT_FALSE(CompressedImagePublisher::Encode(ImageCompression::PNG, image,
+      -1, data));
+  image = TestImage(msgs::PixelFormatType::RGB_INT8, 3u);
+  image.mutable_data()->resize(10u);
+  EXPECT_FALSE(CompressedImagePublisher::Encode(ImageCompression::PNG, image,
+      -1, data));
+}
+
+//////////////////////////////////////////////////
+TEST(ImageEncoder, Jpeg)
+{
+  EXPECT_FALSE(CompressedImagePublisher::Supported(ImageCompression::NONE));
+  if (!CompressedImagePublisher::Supported(ImageCompression::JPEG))
+    return;
+
+  std::string data;
+  msgs::Image image = TestImage(msgs::PixelFormatType::RGB_INT8, 3u);
+  ASSERT_TRUE(CompressedImagePublisher::Encode(ImageCompression::JPEG, image,
+      50, data));
+  ASSERT_GT(data.size(), 4u);
+  EXPECT_EQ(std::string("\xff\xd8", 2u), data.substr(0u, 2u));
+  EXPECT_EQ(std::string("\xff\xd9", 2u), data.substr(data.size() - 2u));
+
+  // JPEG only supports 8 bit images
+  image = TestImage(msgs::PixelFormatType::L_INT16, 2u);
+  EXPECT_FALSE(CompressedImagePublisher::Encode(ImageCompression::JPEG,
+      image, -1, data));
+}
+
+//////////////////////////////////////////////////
+TEST(ImageEncoder, Publisher)
+{
+  if (!CompressedImagePublisher::Supported(ImageCompression::PNG))
+    return;
+
+  const std::string topic = "/image_encoder_test/compressed";
+  std::atomic<unsigned int> received{0u};
+  transport::Node node;
+  std::function<void(const msgs::Image &)> cb =
+      [&received](const msgs::Image &_msg)
+      {
+        EXPECT_EQ(32u, _msg.width());
+        EXPECT_EQ(0u, _msg.step());
+        ASSERT_GT(_msg.header().data_size(), 0);
+        EXPECT_EQ("format", _msg.header().data(0).key());
+        EXPECT_EQ("png", _msg.header().data(0).value(0));
+        ++received;
+      };
+  EXPECT_TRUE(node.Subscribe(topic, cb));
+  auto pub = node.Advertise<msgs::Image>(topic);
+  ASSERT_TRUE(pub);
+
+  CompressedImagePublisher publisher(pub, ImageCompression::PNG, -1, 1u);
+  EXPECT_EQ(ImageCompression::PNG, publisher.Compression());
+  EXPECT_EQ(0u, publisher.DroppedCount());
+
+  // Images pushed while another one is encoded are dropped
+  msgs::Image image = TestImage(msgs::PixelFormatType::RGB_INT8, 3u);
+  unsigned int pushed = 0u;
+  for (int i = 0; i < 20; ++i)
+  {
+    if (publisher.Push(image))
+      ++pushed;
+  }
+  publisher.Flush();
+  EXPECT_GE(pushed, 1u);
+  EXPECT_EQ(20u - pushed, publisher.DroppedCount());
+
+  for (int i = 0; i < 50 && received < pushed; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(pushed, received);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageEncoder, FrameWriter)
+{
+  std::string path = common::joinPaths(common::cwd(),
+      "ImageEncoder_TEST_frames");
+  common::removeAll(path);
+
+  msgs::Image image = TestImage(msgs::PixelFormatType::RGB_INT8, 3u);
+  const unsigned char *data =
+      reinterpret_cast<const unsigned char *>(image.data().data());
+  const unsigned int count = 20u;
+  {
+    FrameWriter writer(path, "frame_", 2u);
+    EXPECT_EQ(FrameFileFormat::PNG, writer.Format());
+    writer.SetFormat(FrameFileFormat::PNM);
+    EXPECT_EQ(FrameFileFormat::PNM, writer.Format());
+
+    // Frames beyond the queue depth are dropped, never blocked on
+    unsigned int accepted = 0u;
+    for (unsigned int i = 0u; i < count; ++i)
+    {
+      accepted += writer.Push(data, image.width(), image.height(),
+          image.step(), image.pixel_format_type()) ? 1u : 0u;
+    }
+    EXPECT_FALSE(writer.Push(data, image.width(), image.height(),
+        image.step(), msgs::PixelFormatType::BGRA_INT8));
+
+    writer.Flush();
+    EXPECT_GT(accepted, 0u);
+    EXPECT_EQ(accepted, writer.SavedCount());
+    EXPECT_EQ(count - accepted, writer.DroppedCount());
+  }
+
+  // Accepted frames are numbered without gaps
+  std::ifstream file(common::joinPaths(path, "frame_0.ppm"),
+      std::ios::binary);
+  ASSERT_TRUE(file.good());
+  std::string header;
+  std::getline(file, header);
+  EXPECT_EQ("P6", header);
+  std::getline(file, header);
+  EXPECT_EQ("32 16", header);
+  std::getline(file, header);
+  EXPECT_EQ("255", header);
+
+  // Packed rows, without the padding of the source image
+  std::string pixels((std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+  ASSERT_EQ(32u * 3u * 16u, pixels.size());
+  EXPECT_EQ(image.data().substr(image.step(), 32u * 3u),
+      pixels.substr(32u * 3u, 32u * 3u));
+
+  common::removeAll(path);
+}
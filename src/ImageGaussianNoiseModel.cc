@@ -95,11 +95,22 @@ void ImageGaussianNoiseModel::SetCamera(rendering::CameraPtr _camera)
       rpSystem->Create<rendering::GaussianNoisePass>();
     this->dataPtr->gaussianNoisePass =
         std::dynamic_pointer_cast<rendering::GaussianNoisePass>(noisePass);
-    this->dataPtr->gaussianNoisePass->SetMean(this->dataPtr->mean);
-    this->dataPtr->gaussianNoisePass->SetStdDev(this->dataPtr->stdDev);
-    this->dataPtr->gaussianNoisePass->SetEnabled(true);
-    _camera->AddRenderPass(this->dataPtr->gaussianNoisePass);
   }
+
+  // The noise is only ever applied by the render pass. Say so instead of
+  // silently publishing data without noise.
+  if (!this->dataPtr->gaussianNoisePass)
+  {
+    ignwarn << "Render engine [" << engine->Name() << "] doesn't support "
+            << "Gaussian noise passes. No noise will be applied to the "
+            << "images of camera [" << _camera->Name() << "]." << std::endl;
+    return;
+  }
+
+  this->dataPtr->gaussianNoisePass->SetMean(this->dataPtr->mean);
+  this->dataPtr->gaussianNoisePass->SetStdDev(this->dataPtr->stdDev);
+  this->dataPtr->gaussianNoisePass->SetEnabled(true);
+  _camera->AddRenderPass(this->dataPtr->gaussianNoisePass);
 }
 
 //////////////////////////////////////////////////
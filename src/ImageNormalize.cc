@@ -0,0 +1,491 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IGN_SENSORS_NORMALIZE_SSE2
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+#include "ImageNormalize.hh"
+#include "WorkerPool.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for ImageNormalizer
+class ignition::sensors::ImageNormalizerPrivate
+{
+  /// \brief Run a function over bands of rows, in parallel for large
+  /// images.
+  /// \param[in] _width Width of the image.
+  /// \param[in] _height Height of the image.
+  /// \param[in] _func Function called with the index, first pixel and
+  /// number of pixels of each band.
+  /// \return Number of bands.
+  public: std::size_t ForBands(const unsigned int _width,
+              const unsigned int _height,
+              const std::function<void(std::size_t, std::size_t,
+                  std::size_t)> &_func);
+
+  /// \brief Number of threads, including the calling thread
+  public: unsigned int threadCount = 1u;
+
+  /// \brief Threads for large images. Created on first use.
+  public: std::unique_ptr<WorkerPool> pool;
+
+  /// \brief Largest depth of each band
+  public: std::vector<float> bandMax;
+
+  /// \brief Smallest temperature of each band
+  public: std::vector<uint16_t> bandMinTemp;
+
+  /// \brief Largest temperature of each band
+  public: std::vector<uint16_t> bandMaxTemp;
+
+  /// \brief RGB pixel of each temperature from lutMin to lutMax, in the
+  /// first 3 of 4 bytes. Reused while the temperature range of the images
+  /// and the palette don't change.
+  public: std::vector<uint32_t> temperatureLut;
+
+  /// \brief Temperature of the first entry of temperatureLut
+  public: uint16_t lutMin = 0u;
+
+  /// \brief Temperature of the last entry of temperatureLut
+  public: uint16_t lutMax = 0u;
+
+  /// \brief Palette of temperatureLut, nullptr for grayscale
+  public: const unsigned char *lutPalette = nullptr;
+};
+
+namespace
+{
+  /// \brief Images with fewer pixels are processed on the calling thread
+  const std::size_t kParallelPixels = 512u * 512u;
+
+  /// \brief Write gray levels as RGB pixels.
+  /// \param[in] _gray Gray levels.
+  /// \param[in] _count Number of gray levels.
+  /// \param[out] _rgb RGB pixels.
+  inline void WriteGray(const unsigned char *_gray, const std::size_t _count,
+      unsigned char *_rgb)
+  {
+    if (_count == 0u)
+      return;
+
+    // Each pixel is written with one 4 byte store whose last byte is
+    // overwritten by the next pixel
+    for (std::size_t i = 0u; i + 1u < _count; ++i)
+    {
+      const uint32_t rgbx = _gray[i] * 0x01010101u;
+      std::memcpy(_rgb + i * 3u, &rgbx, sizeof(rgbx));
+    }
+    unsigned char *last = _rgb + (_count - 1u) * 3u;
+    last[0] = last[1] = last[2] = _gray[_count - 1u];
+  }
+
+  /// \brief Gray level of a depth.
+  /// \param[in] _depth Depth.
+  /// \param[in] _factor 255 divided by the depth that maps to black.
+  /// \return Gray level.
+  inline unsigned char DepthGray(const float _depth, const float _factor)
+  {
+    if (!std::isfinite(_depth))
+      return 0u;
+    const float gray = 255.0f - _depth * _factor;
+    return static_cast<unsigned char>(
+        std::min(255.0f, std::max(0.0f, gray)));
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t ImageNormalizerPrivate::ForBands(const unsigned int _width,
+    const unsigned int _height,
+    const std::function<void(std::size_t, std::size_t, std::size_t)> &_func)
+{
+  const std::size_t pixels = static_cast<std::size_t>(_width) * _height;
+  std::size_t bands = 1u;
+  if (this->threadCount > 1u && pixels >= kParallelPixels)
+    bands = std::min<std::size_t>(this->threadCount, _height);
+
+  if (bands <= 1u)
+  {
+    _func(0u, 0u, pixels);
+    return 1u;
+  }
+
+  if (!this->pool || this->pool->ThreadCount() != this->threadCount)
+    this->pool.reset(new WorkerPool(this->threadCount));
+
+  const std::size_t bandRows = (_height + bands - 1u) / bands;
+  bands = (_height + bandRows - 1u) / bandRows;
+  this->pool->ParallelFor(bands, [&](std::size_t _band)
+      {
+        const std::size_t firstRow = _band * bandRows;
+        const std::size_t rows = std::min<std::size_t>(bandRows,
+            _height - firstRow);
+        _func(_band, firstRow * _width, rows * _width);
+      });
+  return bands;
+}
+
+//////////////////////////////////////////////////
+ImageNormalizer::ImageNormalizer()
+  : dataPtr(new ImageNormalizerPrivate)
+{
+  // Up to 4 threads by default, one per core oversubscribes the sensors
+  // updated in parallel
+  this->SetThreadCount(
+      std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+}
+
+//////////////////////////////////////////////////
+ImageNormalizer::~ImageNormalizer()
+{
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::SetThreadCount(const unsigned int _count)
+{
+  this->dataPtr->threadCount = _count > 0u ? _count :
+      std::max(1u, std::thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////
+unsigned int ImageNormalizer::ThreadCount() const
+{
+  return this->dataPtr->threadCount;
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::ConvertDepth(const float *_data,
+    const unsigned int _width, const unsigned int _height,
+    unsigned char *_rgb)
+{
+  IGN_PROFILE("ImageNormalizer::ConvertDepth");
+  std::vector<float> &bandMax = this->dataPtr->bandMax;
+  bandMax.assign(std::max(1u, this->dataPtr->threadCount), 0.0f);
+  const std::size_t bands = this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t _band, std::size_t _first, std::size_t _count)
+      {
+        bandMax[_band] = MaxDepth(_data + _first, _count);
+      });
+  const float maxDepth = *std::max_element(bandMax.begin(),
+      bandMax.begin() + bands);
+
+  this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t, std::size_t _first, std::size_t _count)
+      {
+        DepthToGray(_data + _first, _count, maxDepth, _rgb + _first * 3u);
+      });
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::ConvertTemperature(const uint16_t *_data,
+    const unsigned int _width, const unsigned int _height,
+    unsigned char *_rgb, const unsigned char *_palette)
+{
+  IGN_PROFILE("ImageNormalizer::ConvertTemperature");
+  if (_width == 0u || _height == 0u)
+    return;
+
+  std::vector<uint16_t> &bandMin = this->dataPtr->bandMinTemp;
+  std::vector<uint16_t> &bandMax = this->dataPtr->bandMaxTemp;
+  bandMin.resize(std::max(1u, this->dataPtr->threadCount));
+  bandMax.resize(bandMin.size());
+  const std::size_t bands = this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t _band, std::size_t _first, std::size_t _count)
+      {
+        TemperatureRange(_data + _first, _count, bandMin[_band],
+            bandMax[_band]);
+      });
+  const uint16_t minTemp = *std::min_element(bandMin.begin(),
+      bandMin.begin() + bands);
+  const uint16_t maxTemp = *std::max_element(bandMax.begin(),
+      bandMax.begin() + bands);
+
+  // The color only depends on the temperature, so it is looked up in a
+  // table that spans the range of the image. The table is rebuilt when the
+  // range or the palette change, which costs one entry per temperature in
+  // the range.
+  std::vector<uint32_t> &lut = this->dataPtr->temperatureLut;
+  if (lut.empty() || minTemp != this->dataPtr->lutMin ||
+      maxTemp != this->dataPtr->lutMax ||
+      _palette != this->dataPtr->lutPalette)
+  {
+    const uint32_t range = maxTemp > minTemp ? maxTemp - minTemp : 1u;
+    lut.resize(static_cast<std::size_t>(maxTemp - minTemp) + 1u);
+    for (uint32_t t = 0u; t < lut.size(); ++t)
+    {
+      const uint32_t level = std::min<uint32_t>(255u, 255u * t / range);
+      if (_palette)
+        std::memcpy(&lut[t], _palette + level * 3u, 3u);
+      else
+        lut[t] = level * 0x01010101u;
+    }
+    this->dataPtr->lutMin = minTemp;
+    this->dataPtr->lutMax = maxTemp;
+    this->dataPtr->lutPalette = _palette;
+  }
+
+  const uint32_t *pixels = lut.data();
+  this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t, std::size_t _first, std::size_t _count)
+      {
+        if (_count == 0u)
+          return;
+
+        // Each pixel is written with one 4 byte store whose last byte is
+        // overwritten by the next pixel, as in WriteGray()
+        const uint16_t *data = _data + _first;
+        unsigned char *rgb = _rgb + _first * 3u;
+        for (std::size_t i = 0u; i + 1u < _count; ++i)
+          std::memcpy(rgb + i * 3u, &pixels[data[i] - minTemp], 4u);
+        std::memcpy(rgb + (_count - 1u) * 3u,
+            &pixels[data[_count - 1u] - minTemp], 3u);
+      });
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::QuantizeDepth(const float *_data,
+    const unsigned int _width, const unsigned int _height,
+    const float _unit, uint16_t *_out)
+{
+  IGN_PROFILE("ImageNormalizer::QuantizeDepth");
+  this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t, std::size_t _first, std::size_t _count)
+      {
+        DepthToUnits(_data + _first, _count, _unit, _out + _first);
+      });
+}
+
+//////////////////////////////////////////////////
+float ImageNormalizer::MaxDepth(const float *_data, const std::size_t _count)
+{
+  float maxDepth = 0.0f;
+  std::size_t i = 0u;
+#ifdef IGN_SENSORS_NORMALIZE_SSE2
+  // Infinite and NaN depths are replaced by 0 before the comparison
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  __m128 max4 = _mm_setzero_ps();
+  for (; i + 4u <= _count; i += 4u)
+  {
+    const __m128 v = _mm_loadu_ps(_data + i);
+    const __m128 finite = _mm_cmplt_ps(_mm_and_ps(v, absMask), inf);
+    max4 = _mm_max_ps(max4, _mm_and_ps(v, finite));
+  }
+  max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+  max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+  maxDepth = _mm_cvtss_f32(max4);
+#endif
+  for (; i < _count; ++i)
+  {
+    if (_data[i] > maxDepth && std::isfinite(_data[i]))
+      maxDepth = _data[i];
+  }
+  return maxDepth;
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::DepthToGray(const float *_data,
+    const std::size_t _count, const float _maxDepth, unsigned char *_rgb)
+{
+  if (!(_maxDepth > 0.0f) || !std::isfinite(_maxDepth))
+  {
+    std::fill(_rgb, _rgb + _count * 3u, 0u);
+    return;
+  }
+
+  const float factor = 255.0f / _maxDepth;
+  std::size_t i = 0u;
+#ifdef IGN_SENSORS_NORMALIZE_SSE2
+  const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+  const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+  const __m128 factor4 = _mm_set1_ps(factor);
+  const __m128 white = _mm_set1_ps(255.0f);
+  const __m128 black = _mm_setzero_ps();
+  alignas(16) unsigned char gray[16];
+  for (; i + 16u <= _count; i += 16u)
+  {
+    __m128i levels[4];
+    for (int k = 0; k < 4; ++k)
+    {
+      const __m128 v = _mm_loadu_ps(_data + i + k * 4);
+      const __m128 finite = _mm_cmplt_ps(_mm_and_ps(v, absMask), inf);
+      __m128 g = _mm_sub_ps(white, _mm_mul_ps(v, factor4));
+      g = _mm_min_ps(_mm_max_ps(g, black), white);
+      levels[k] = _mm_cvttps_epi32(_mm_and_ps(g, finite));
+    }
+    const __m128i lo = _mm_packs_epi32(levels[0], levels[1]);
+    const __m128i hi = _mm_packs_epi32(levels[2], levels[3]);
+    _mm_store_si128(reinterpret_cast<__m128i *>(gray),
+        _mm_packus_epi16(lo, hi));
+    WriteGray(gray, 16u, _rgb + i * 3u);
+  }
+#endif
+  for (; i < _count; ++i)
+  {
+    const unsigned char g = DepthGray(_data[i], factor);
+    WriteGray(&g, 1u, _rgb + i * 3u);
+  }
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::DepthToUnits(const float *_data,
+    const std::size_t _count, const float _unit, uint16_t *_out)
+{
+  if (!(_unit > 0.0f) || !std::isfinite(_unit))
+  {
+    std::fill(_out, _out + _count, 0u);
+    return;
+  }
+
+  // Depths are rounded by truncating depth / unit + 0.5, which is out of
+  // range from 65535.5 units on
+  const float factor = 1.0f / _unit;
+  const float limit = 65536.0f;
+  std::size_t i = 0u;
+#ifdef IGN_SENSORS_NORMALIZE_SSE2
+  // NaN fails both comparisons. SSE2 only packs to signed 16 bit integers,
+  // so values are offset to the signed range
+  const __m128 factor4 = _mm_set1_ps(factor);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 limit4 = _mm_set1_ps(limit);
+  const __m128i offset32 = _mm_set1_epi32(0x8000);
+  const __m128i offset16 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+  for (; i + 8u <= _count; i += 8u)
+  {
+    __m128i units[2];
+    for (int k = 0; k < 2; ++k)
+    {
+      const __m128 v = _mm_loadu_ps(_data + i + k * 4);
+      const __m128 q = _mm_add_ps(_mm_mul_ps(v, factor4), half);
+      const __m128 valid = _mm_and_ps(_mm_cmpgt_ps(v, zero),
+          _mm_cmplt_ps(q, limit4));
+      const __m128i n = _mm_and_si128(_mm_cvttps_epi32(q),
+          _mm_castps_si128(valid));
+      units[k] = _mm_sub_epi32(n, offset32);
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(_out + i),
+        _mm_xor_si128(_mm_packs_epi32(units[0], units[1]), offset16));
+  }
+#endif
+  for (; i < _count; ++i)
+  {
+    const float q = _data[i] * factor + 0.5f;
+    _out[i] = (_data[i] > 0.0f && q < limit) ?
+        static_cast<uint16_t>(q) : 0u;
+  }
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::TemperatureRange(const uint16_t *_data,
+    const std::size_t _count, uint16_t &_min, uint16_t &_max)
+{
+  _min = std::numeric_limits<uint16_t>::max();
+  _max = 0u;
+  std::size_t i = 0u;
+#ifdef IGN_SENSORS_NORMALIZE_SSE2
+  if (_count >= 8u)
+  {
+    // SSE2 only compares signed 16 bit integers, so values are offset to
+    // the signed range
+    const __m128i offset = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+    __m128i min8 = _mm_set1_epi16(0x7fff);
+    __m128i max8 = _mm_set1_epi16(static_cast<int16_t>(0x8000));
+    for (; i + 8u <= _count; i += 8u)
+    {
+      const __m128i v = _mm_xor_si128(offset, _mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(_data + i)));
+      min8 = _mm_min_epi16(min8, v);
+      max8 = _mm_max_epi16(max8, v);
+    }
+    alignas(16) uint16_t mins[8];
+    alignas(16) uint16_t maxs[8];
+    _mm_store_si128(reinterpret_cast<__m128i *>(mins),
+        _mm_xor_si128(min8, offset));
+    _mm_store_si128(reinterpret_cast<__m128i *>(maxs),
+        _mm_xor_si128(max8, offset));
+    _min = *std::min_element(mins, mins + 8);
+    _max = *std::max_element(maxs, maxs + 8);
+  }
+#endif
+  for (; i < _count; ++i)
+  {
+    _min = std::min(_min, _data[i]);
+    _max = std::max(_max, _data[i]);
+  }
+}
+
+//////////////////////////////////////////////////
+void ImageNormalizer::TemperatureToGray(const uint16_t *_data,
+    const std::size_t _count, const uint16_t _min, const uint16_t _max,
+    unsigned char *_rgb)
+{
+  const uint32_t range = _max > _min ? _max - _min : 1u;
+  std::size_t i = 0u;
+#ifdef IGN_SENSORS_NORMALIZE_SSE2
+  // 255 * (t - min) is exact in single precision, and the correctly
+  // rounded quotient truncates to the same level as integer division
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i min8 = _mm_set1_epi16(static_cast<int16_t>(_min));
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 range4 = _mm_set1_ps(static_cast<float>(range));
+  alignas(16) unsigned char gray[16];
+  for (; i + 16u <= _count; i += 16u)
+  {
+    __m128i levels[4];
+    for (int k = 0; k < 2; ++k)
+    {
+      // Values below _min saturate to 0
+      const __m128i v = _mm_subs_epu16(_mm_loadu_si128(
+          reinterpret_cast<const __m128i *>(_data + i + k * 8)), min8);
+      const __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+      const __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero));
+      levels[k * 2] = _mm_cvttps_epi32(
+          _mm_div_ps(_mm_mul_ps(lo, scale), range4));
+      levels[k * 2 + 1] = _mm_cvttps_epi32(
+          _mm_div_ps(_mm_mul_ps(hi, scale), range4));
+    }
+    const __m128i lo = _mm_packs_epi32(levels[0], levels[1]);
+    const __m128i hi = _mm_packs_epi32(levels[2], levels[3]);
+    _mm_store_si128(reinterpret_cast<__m128i *>(gray),
+        _mm_packus_epi16(lo, hi));
+    WriteGray(gray, 16u, _rgb + i * 3u);
+  }
+#endif
+  for (; i < _count; ++i)
+  {
+    const uint32_t t = _data[i] > _min ? _data[i] - _min : 0u;
+    const unsigned char g = static_cast<unsigned char>(
+        std::min<uint32_t>(255u, 255u * t / range));
+    WriteGray(&g, 1u, _rgb + i * 3u);
+  }
+}
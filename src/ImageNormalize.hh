@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_IMAGENORMALIZE_HH_
+#define IGNITION_SENSORS_IMAGENORMALIZE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class ImageNormalizerPrivate;
+
+    /// \brief Converts depth and temperature images to grayscale RGB
+    /// images for visualization and saved frames, and depth images to
+    /// integer depths. Values are normalized by
+    /// the range of each image, found with a reduction over the image. The
+    /// kernels use SSE2 where available, and large images are split in
+    /// bands of rows processed in parallel.
+    class IGNITION_SENSORS_VISIBLE ImageNormalizer
+    {
+      /// \brief Constructor
+      public: ImageNormalizer();
+
+      /// \brief Destructor
+      public: ~ImageNormalizer();
+
+      /// \brief Set the number of threads used for large images.
+      /// \param[in] _count Number of threads, including the calling
+      /// thread. 0 uses one thread per core, and 1 processes all images on
+      /// the calling thread. The default is one per core, up to 4.
+      public: void SetThreadCount(const unsigned int _count);
+
+      /// \brief Get the number of threads used for large images.
+      /// \return Number of threads, including the calling thread.
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Convert a depth image. The largest finite depth maps to
+      /// black, and depths closer to the camera are brighter. Infinite and
+      /// NaN depths are black, negative depths are white, and all pixels
+      /// are black if no depth is positive.
+      /// \param[in] _data Depths, with packed rows.
+      /// \param[in] _width Width of the image.
+      /// \param[in] _height Height of the image.
+      /// \param[out] _rgb RGB image, with packed rows of _width * 3 bytes.
+      public: void ConvertDepth(const float *_data, const unsigned int _width,
+                  const unsigned int _height, unsigned char *_rgb);
+
+      /// \brief Convert a temperature image. The coldest pixel maps to
+      /// black and the hottest to white. Pixels are converted with a lookup
+      /// table over the range of the image, which is kept while following
+      /// images have the same range.
+      /// \param[in] _data Temperatures, with packed rows.
+      /// \param[in] _width Width of the image.
+      /// \param[in] _height Height of the image.
+      /// \param[out] _rgb RGB image, with packed rows of _width * 3 bytes.
+      /// \param[in] _palette Optional false color palette of 256 RGB
+      /// colors, from the coldest to the hottest. It must stay valid and
+      /// unchanged while it is used. nullptr for grayscale.
+      public: void ConvertTemperature(const uint16_t *_data,
+                  const unsigned int _width, const unsigned int _height,
+                  unsigned char *_rgb,
+                  const unsigned char *_palette = nullptr);
+
+      /// \brief Convert a depth image to 16 bit unsigned integer depths,
+      /// such as millimeters, as published by many depth cameras. Depths
+      /// are rounded to the nearest unit. Depths that are infinite, NaN,
+      /// not positive or too far to be represented are 0.
+      /// \param[in] _data Depths in meters, with packed rows.
+      /// \param[in] _width Width of the image.
+      /// \param[in] _height Height of the image.
+      /// \param[in] _unit Meters per unit, e.g. 0.001 for millimeters.
+      /// \param[out] _out Integer depths, with packed rows.
+      public: void QuantizeDepth(const float *_data,
+                  const unsigned int _width, const unsigned int _height,
+                  const float _unit, uint16_t *_out);
+
+      /// \brief Get the largest finite depth of an image.
+      /// \param[in] _data Depths.
+      /// \param[in] _count Number of depths.
+      /// \return Largest finite depth, or 0 if no depth is positive.
+      public: static float MaxDepth(const float *_data,
+                  const std::size_t _count);
+
+      /// \brief Convert depths to gray levels, for a given largest depth.
+      /// \param[in] _data Depths.
+      /// \param[in] _count Number of depths.
+      /// \param[in] _maxDepth Depth that maps to black.
+      /// \param[out] _rgb RGB pixels, 3 bytes per depth.
+      public: static void DepthToGray(const float *_data,
+                  const std::size_t _count, const float _maxDepth,
+                  unsigned char *_rgb);
+
+      /// \brief Convert depths to 16 bit unsigned integer depths, as in
+      /// QuantizeDepth().
+      /// \param[in] _data Depths in meters.
+      /// \param[in] _count Number of depths.
+      /// \param[in] _unit Meters per unit.
+      /// \param[out] _out Integer depths.
+      public: static void DepthToUnits(const float *_data,
+                  const std::size_t _count, const float _unit,
+                  uint16_t *_out);
+
+      /// \brief Get the range of the values of a temperature image.
+      /// \param[in] _data Temperatures.
+      /// \param[in] _count Number of temperatures, at least 1.
+      /// \param[out] _min Smallest temperature.
+      /// \param[out] _max Largest temperature.
+      public: static void TemperatureRange(const uint16_t *_data,
+                  const std::size_t _count, uint16_t &_min, uint16_t &_max);
+
+      /// \brief Convert temperatures to gray levels, for a given range.
+      /// \param[in] _data Temperatures.
+      /// \param[in] _count Number of temperatures.
+      /// \param[in] _min Temperature that maps to black.
+      /// \param[in] _max Temperature that maps to white.
+      /// \param[out] _rgb RGB pixels, 3 bytes per temperature.
+      public: static void TemperatureToGray(const uint16_t *_data,
+                  const std::size_t _count, const uint16_t _min,
+                  const uint16_t _max, unsigned char *_rgb);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<ImageNormalizerPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "ImageNormalize.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Reference conversion of a depth image
+  std::vector<unsigned char> ReferenceDepth(const std::vector<float> &_data)
+  {
+    float maxDepth = 0.0f;
+    for (float d : _data)
+    {
+      if (d > maxDepth && std::isfinite(d))
+        maxDepth = d;
+    }
+
+    std::vector<unsigned char> rgb(_data.size() * 3u, 0u);
+    if (maxDepth <= 0.0f)
+      return rgb;
+    const float factor = 255.0f / maxDepth;
+    for (std::size_t i = 0u; i < _data.size(); ++i)
+    {
+      unsigned char g = 0u;
+      if (std::isfinite(_data[i]))
+      {
+        float v = 255.0f - _data[i] * factor;
+        g = static_cast<unsigned char>(std::min(255.0f, std::max(0.0f, v)));
+      }
+      rgb[i * 3u] = rgb[i * 3u + 1u] = rgb[i * 3u + 2u] = g;
+    }
+    return rgb;
+  }
+
+  /// \brief Reference conversion of a temperature image
+  std::vector<unsigned char> ReferenceTemperature(
+      const std::vector<uint16_t> &_data)
+  {
+    uint16_t minTemp = *std::min_element(_data.begin(), _data.end());
+    uint16_t maxTemp = *std::max_element(_data.begin(), _data.end());
+    uint32_t range = maxTemp > minTemp ? maxTemp - minTemp : 1u;
+    std::vector<unsigned char> rgb(_data.size() * 3u);
+    for (std::size_t i = 0u; i < _data.size(); ++i)
+    {
+      unsigned char g = static_cast<unsigned char>(
+          255u * (_data[i] - minTemp) / range);
+      rgb[i * 3u] = rgb[i * 3u + 1u] = rgb[i * 3u + 2u] = g;
+    }
+    return rgb;
+  }
+
+  /// \brief Make a depth image with a few special values
+  std::vector<float> DepthImage(const unsigned int _width,
+      const unsigned int _height)
+  {
+    std::vector<float> data(static_cast<std::size_t>(_width) * _height);
+    for (std::size_t i = 0u; i < data.size(); ++i)
+      data[i] = 0.01f * static_cast<float>((i * 7919u) % 1000u);
+    data[2] = 12.5f;
+    data[1] = std::numeric_limits<float>::infinity();
+    data[5] = -std::numeric_limits<float>::infinity();
+    data[9] = std::numeric_limits<float>::quiet_NaN();
+    data[data.size() - 2u] = -1.0f;
+    data[data.size() - 1u] = std::numeric_limits<float>::infinity();
+    return data;
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ImageNormalize, Depth)
+{
+  // Sizes that aren't multiples of the vector width
+  for (unsigned int width : {5u, 16u, 37u})
+  {
+    const std::vector<float> data = DepthImage(width, 3u);
+    EXPECT_FLOAT_EQ(12.5f, ImageNormalizer::MaxDepth(data.data(),
+        data.size()));
+
+    ImageNormalizer normalizer;
+    std::vector<unsigned char> rgb(data.size() * 3u, 1u);
+    normalizer.ConvertDepth(data.data(), width, 3u, rgb.data());
+    EXPECT_EQ(ReferenceDepth(data), rgb) << width;
+
+    // Infinite and NaN depths are black, negative depths white
+    EXPECT_EQ(0u, rgb[1 * 3]);
+    EXPECT_EQ(0u, rgb[5 * 3]);
+    EXPECT_EQ(0u, rgb[9 * 3]);
+    EXPECT_EQ(255u, rgb[(data.size() - 2u) * 3u]);
+  }
+
+  // No positive depth
+  std::vector<float> empty(20u, std::numeric_limits<float>::infinity());
+  empty[3] = 0.0f;
+  EXPECT_FLOAT_EQ(0.0f, ImageNormalizer::MaxDepth(empty.data(),
+      empty.size()));
+  std::vector<unsigned char> rgb(empty.size() * 3u, 1u);
+  ImageNormalizer normalizer;
+  normalizer.ConvertDepth(empty.data(), 20u, 1u, rgb.data());
+  EXPECT_EQ(std::vector<unsigned char>(rgb.size(), 0u), rgb);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageNormalize, Temperature)
+{
+  for (unsigned int width : {5u, 16u, 37u})
+  {
+    std::vector<uint16_t> data(width * 3u);
+    for (std::size_t i = 0u; i < data.size(); ++i)
+      data[i] = static_cast<uint16_t>(20000u + (i * 7919u) % 40000u);
+
+    uint16_t minTemp = 0u;
+    uint16_t maxTemp = 0u;
+    ImageNormalizer::TemperatureRange(data.data(), data.size(), minTemp,
+        maxTemp);
+    EXPECT_EQ(*std::min_element(data.begin(), data.end()), minTemp);
+    EXPECT_EQ(*std::max_element(data.begin(), data.end()), maxTemp);
+
+    ImageNormalizer normalizer;
+    std::vector<unsigned char> rgb(data.size() * 3u, 1u);
+    normalizer.ConvertTemperature(data.data(), width, 3u, rgb.data());
+    EXPECT_EQ(ReferenceTemperature(data), rgb) << width;
+  }
+
+  // Full range, and a flat image
+  std::vector<uint16_t> data = {0u, 65535u, 1u, 65534u, 32768u, 257u, 3u,
+      4u, 5u, 6u, 7u, 8u, 9u, 10u, 11u, 12u, 13u};
+  std::vector<unsigned char> rgb(data.size() * 3u);
+  ImageNormalizer normalizer;
+  normalizer.ConvertTemperature(data.data(), 17u, 1u, rgb.data());
+  EXPECT_EQ(ReferenceTemperature(data), rgb);
+  EXPECT_EQ(255u, rgb[3]);
+
+  std::vector<uint16_t> flat(40u, 300u);
+  rgb.resize(flat.size() * 3u);
+  normalizer.ConvertTemperature(flat.data(), 40u, 1u, rgb.data());
+  EXPECT_EQ(std::vector<unsigned char>(rgb.size(), 0u), rgb);
+
+  // The lookup table is rebuilt when the range changes, and reused when it
+  // comes back to a previous range
+  for (uint16_t offset : {0u, 0u, 1000u, 0u})
+  {
+    std::vector<uint16_t> shifted(data.size());
+    for (std::size_t i = 0u; i < data.size(); ++i)
+      shifted[i] = static_cast<uint16_t>(30000u + (i * 37u) % 500u + offset);
+    shifted[3] = static_cast<uint16_t>(29000u + offset);
+    rgb.resize(shifted.size() * 3u);
+    normalizer.ConvertTemperature(shifted.data(), 17u, 1u, rgb.data());
+    EXPECT_EQ(ReferenceTemperature(shifted), rgb) << offset;
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(ImageNormalize, TemperaturePalette)
+{
+  std::vector<unsigned char> palette(256u * 3u);
+  for (unsigned int i = 0u; i < 256u; ++i)
+  {
+    palette[i * 3u] = static_cast<unsigned char>(i);
+    palette[i * 3u + 1u] = static_cast<unsigned char>(255u - i);
+    palette[i * 3u + 2u] = static_cast<unsigned char>(i / 2u);
+  }
+
+  std::vector<uint16_t> data(37u);
+  for (std::size_t i = 0u; i < data.size(); ++i)
+    data[i] = static_cast<uint16_t>(30000u + (i * 7919u) % 3000u);
+
+  // Each pixel gets the color of its gray level
+  ImageNormalizer normalizer;
+  std::vector<unsigned char> gray(data.size() * 3u);
+  normalizer.ConvertTemperature(data.data(), 37u, 1u, gray.data());
+  std::vector<unsigned char> rgb(data.size() * 3u);
+  normalizer.ConvertTemperature(data.data(), 37u, 1u, rgb.data(),
+      palette.data());
+  for (std::size_t i = 0u; i < data.size(); ++i)
+  {
+    const unsigned char level = gray[i * 3u];
+    EXPECT_EQ(palette[level * 3u], rgb[i * 3u]) << i;
+    EXPECT_EQ(palette[level * 3u + 1u], rgb[i * 3u + 1u]) << i;
+    EXPECT_EQ(palette[level * 3u + 2u], rgb[i * 3u + 2u]) << i;
+  }
+
+  // Back to grayscale with the same range
+  normalizer.ConvertTemperature(data.data(), 37u, 1u, rgb.data());
+  EXPECT_EQ(gray, rgb);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageNormalize, QuantizeDepth)
+{
+  const float inf = std::numeric_limits<float>::infinity();
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> data = {0.0f, 0.0004f, 0.0006f, 1.0f, 1.2344f,
+      65.535f, 65.5356f, 100.0f, -1.0f, inf, -inf, nan, 0.25f, 2.0f,
+      3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+  std::vector<uint16_t> expected = {0u, 0u, 1u, 1000u, 1234u, 65535u, 0u,
+      0u, 0u, 0u, 0u, 0u, 250u, 2000u, 3000u, 4000u, 5000u, 6000u, 7000u};
+
+  ImageNormalizer normalizer;
+  std::vector<uint16_t> units(data.size(), 1u);
+  normalizer.QuantizeDepth(data.data(), data.size(), 1u, 0.001f,
+      units.data());
+  EXPECT_EQ(expected, units);
+
+  // Other units, and an invalid unit
+  ImageNormalizer::DepthToUnits(data.data(), data.size(), 0.01f,
+      units.data());
+  EXPECT_EQ(100u, units[3]);
+  EXPECT_EQ(10000u, units[7]);
+  ImageNormalizer::DepthToUnits(data.data(), data.size(), 0.0f,
+      units.data());
+  EXPECT_EQ(std::vector<uint16_t>(data.size(), 0u), units);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageNormalize, Parallel)
+{
+  // Large images are split in bands, which must not change the result
+  const unsigned int width = 640u;
+  const unsigned int height = 481u;
+  const std::vector<float> depth = DepthImage(width, height);
+  std::vector<uint16_t> temp(depth.size());
+  for (std::size_t i = 0u; i < temp.size(); ++i)
+    temp[i] = static_cast<uint16_t>((i * 7919u) % 65536u);
+
+  ImageNormalizer serial;
+  serial.SetThreadCount(1u);
+  EXPECT_EQ(1u, serial.ThreadCount());
+  ImageNormalizer parallel;
+  parallel.SetThreadCount(4u);
+  EXPECT_EQ(4u, parallel.ThreadCount());
+
+  std::vector<unsigned char> serialRgb(depth.size() * 3u);
+  std::vector<unsigned char> parallelRgb(depth.size() * 3u);
+  serial.ConvertDepth(depth.data(), width, height, serialRgb.data());
+  parallel.ConvertDepth(depth.data(), width, height, parallelRgb.data());
+  EXPECT_EQ(ReferenceDepth(depth), serialRgb);
+  EXPECT_EQ(serialRgb, parallelRgb);
+
+  serial.ConvertTemperature(temp.data(), width, height, serialRgb.data());
+  parallel.ConvertTemperature(temp.data(), width, height,
+      parallelRgb.data());
+  EXPECT_EQ(ReferenceTemperature(temp), serialRgb);
+  EXPECT_EQ(serialRgb, parallelRgb);
+
+  std::vector<uint16_t> serialUnits(depth.size());
+  std::vector<uint16_t> parallelUnits(depth.size());
+  serial.QuantizeDepth(depth.data(), width, height, 0.001f,
+      serialUnits.data());
+  parallel.QuantizeDepth(depth.data(), width, height, 0.001f,
+      parallelUnits.data());
+  EXPECT_EQ(serialUnits, parallelUnits);
+}
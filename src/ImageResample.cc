@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+#include "ImageResample.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for ImageResampler
+class ignition::sensors::ImageResamplerPrivate
+{
+  /// \brief Width of source images
+  public: unsigned int srcWidth = 0u;
+
+  /// \brief Height of source images
+  public: unsigned int srcHeight = 0u;
+
+  /// \brief Number of channels
+  public: unsigned int channels = 0u;
+
+  /// \brief Left column of the region
+  public: unsigned int roiX = 0u;
+
+  /// \brief Top row of the region
+  public: unsigned int roiY = 0u;
+
+  /// \brief Width of output images, 0 if not configured
+  public: unsigned int dstWidth = 0u;
+
+  /// \brief Height of output images, 0 if not configured
+  public: unsigned int dstHeight = 0u;
+
+  /// \brief First source column of each output column, relative to roiX,
+  /// followed by the end of the last one
+  public: std::vector<unsigned int> columns;
+
+  /// \brief First source row of each output row, relative to roiY,
+  /// followed by the end of the last one
+  public: std::vector<unsigned int> rows;
+
+  /// \brief Channel sums of an output row, reused by Resample()
+  public: mutable std::vector<uint32_t> sums;
+};
+
+namespace
+{
+  /// \brief Split source pixels between output pixels.
+  /// \param[in] _src Number of source pixels.
+  /// \param[in] _dst Number of output pixels.
+  /// \param[out] _starts First source pixel of each output pixel, then the
+  /// end of the last one. When upscaling, output pixels repeat the nearest
+  /// source pixel.
+  void Spans(const unsigned int _src, const unsigned int _dst,
+      std::vector<unsigned int> &_starts)
+  {
+    _starts.resize(_dst + 1u);
+    for (unsigned int i = 0u; i <= _dst; ++i)
+    {
+      _starts[i] = static_cast<unsigned int>(
+          static_cast<uint64_t>(i) * _src / _dst);
+    }
+  }
+
+  /// \brief Get the channels sampled by a Bayer pattern.
+  /// \param[in] _format Bayer pixel format.
+  /// \param[out] _pattern RGB channel of the top left, top right, bottom
+  /// left and bottom right pixels of each 2x2 block.
+  /// \return False if _format isn't a Bayer format.
+  bool BayerPattern(const msgs::PixelFormatType _format,
+      unsigned int (&_pattern)[4])
+  {
+    switch (_format)
+    {
+      case msgs::PixelFormatType::BAYER_RGGB8:
+        _pattern[0] = 0u; _pattern[1] = 1u; _pattern[2] = 1u; _pattern[3] = 2u;
+        return true;
+      case msgs::PixelFormatType::BAYER_BGGR8:
+        _pattern[0] = 2u; _pattern[1] = 1u; _pattern[2] = 1u; _pattern[3] = 0u;
+        return true;
+      case msgs::PixelFormatType::BAYER_GBRG8:
+        _pattern[0] = 1u; _pattern[1] = 2u; _pattern[2] = 0u; _pattern[3] = 1u;
+        return true;
+      case msgs::PixelFormatType::BAYER_GRBG8:
+        _pattern[0] = 1u; _pattern[1] = 0u; _pattern[2] = 2u; _pattern[3] = 1u;
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /// \brief Get the source pixels covered by an output pixel.
+  /// \param[in] _starts Spans computed by Spans().
+  /// \param[in] _i Output pixel.
+  /// \param[in] _src Number of source pixels.
+  /// \param[out] _begin First source pixel.
+  /// \param[out] _end Past the last source pixel. At least _begin + 1.
+  void Span(const std::vector<unsigned int> &_starts, const unsigned int _i,
+      const unsigned int _src, unsigned int &_begin, unsigned int &_end)
+  {
+    _begin = _starts[_i];
+    _end = _starts[_i + 1u];
+    if (_end <= _begin)
+      _end = _begin + 1u;
+    if (_end > _src)
+    {
+      _end = _src;
+      _begin = _end - 1u;
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+ImageResampler::ImageResampler()
+  : dataPtr(new ImageResamplerPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+ImageResampler::~ImageResampler()
+{
+}
+
+//////////////////////////////////////////////////
+bool ImageResampler::Configure(const unsigned int _srcWidth,
+    const unsigned int _srcHeight, const unsigned int _channels,
+    const unsigned int _roiX, const unsigned int _roiY,
+    const unsigned int _roiWidth, const unsigned int _roiHeight,
+    const unsigned int _dstWidth, const unsigned int _dstHeight)
+{
+  this->dataPtr->dstWidth = 0u;
+  this->dataPtr->dstHeight = 0u;
+
+  if (_srcWidth == 0u || _srcHeight == 0u || _channels == 0u ||
+      _channels > 4u || _roiWidth == 0u || _roiHeight == 0u ||
+      _dstWidth == 0u || _dstHeight == 0u ||
+      _roiX >= _srcWidth || _roiY >= _srcHeight ||
+      _roiWidth > _srcWidth - _roiX || _roiHeight > _srcHeight - _roiY)
+  {
+    return false;
+  }
+
+  this->dataPtr->srcWidth = _srcWidth;
+  this->dataPtr->srcHeight = _srcHeight;
+  this->dataPtr->channels = _channels;
+  this->dataPtr->roiX = _roiX;
+  this->dataPtr->roiY = _roiY;
+  Spans(_roiWidth, _dstWidth, this->dataPtr->columns);
+  Spans(_roiHeight, _dstHeight, this->dataPtr->rows);
+  this->dataPtr->sums.assign(_dstWidth * _channels, 0u);
+  this->dataPtr->dstWidth = _dstWidth;
+  this->dataPtr->dstHeight = _dstHeight;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool ImageResampler::Configured() const
+{
+  return this->dataPtr->dstWidth > 0u;
+}
+
+//////////////////////////////////////////////////
+bool ImageResampler::Matches(const unsigned int _srcWidth,
+    const unsigned int _srcHeight, const unsigned int _channels) const
+{
+  return this->Configured() && this->dataPtr->srcWidth == _srcWidth &&
+      this->dataPtr->srcHeight == _srcHeight &&
+      this->dataPtr->channels == _channels;
+}
+
+//////////////////////////////////////////////////
+std::size_t ImageResampler::OutputSize() const
+{
+  return static_cast<std::size_t>(this->dataPtr->dstWidth) *
+      this->dataPtr->dstHeight * this->dataPtr->channels;
+}
+
+//////////////////////////////////////////////////
+bool ImageResampler::Resample(const unsigned char *_src,
+    const unsigned int _srcStep, unsigned char *_dst) const
+{
+  IGN_PROFILE("ImageResampler::Resample");
+  if (!this->Configured() || !_src || !_dst)
+    return false;
+
+  const ImageResamplerPrivate &d = *this->dataPtr;
+  const unsigned int channels = d.channels;
+  const unsigned int roiWidth = d.columns.back();
+  const unsigned int roiHeight = d.rows.back();
+  const std::size_t dstRow = static_cast<std::size_t>(d.dstWidth) * channels;
+  const unsigned char *origin = _src +
+      static_cast<std::size_t>(d.roiY) * _srcStep + d.roiX * channels;
+
+  // A crop at full resolution is a copy of rows
+  if (roiWidth == d.dstWidth && roiHeight == d.dstHeight)
+  {
+    for (unsigned int y = 0u; y < d.dstHeight; ++y)
+      std::memcpy(_dst + y * dstRow, origin + y * _srcStep, dstRow);
+    return true;
+  }
+
+  std::vector<uint32_t> &sums = d.sums;
+  for (unsigned int oy = 0u; oy < d.dstHeight; ++oy)
+  {
+    unsigned int y0, y1;
+    Span(d.rows, oy, roiHeight, y0, y1);
+
+    // Sum the source rows of this output row, one output pixel at a time
+    std::fill(sums.begin(), sums.end(), 0u);
+    for (unsigned int y = y0; y < y1; ++y)
+    {
+      const unsigned char *row = origin + y * _srcStep;
+      uint32_t *sum = sums.data();
+      for (unsigned int ox = 0u; ox < d.dstWidth; ++ox, sum += channels)
+      {
+        unsigned int x0, x1;
+        Span(d.columns, ox, roiWidth, x0, x1);
+        const unsigned char *px = row + x0 * channels;
+        for (unsigned int x = x0; x < x1; ++x)
+        {
+          for (unsigned int c = 0u; c < channels; ++c)
+            sum[c] += *px++;
+        }
+      }
+    }
+
+    // Average, rounding to nearest
+    unsigned char *out = _dst + oy * dstRow;
+    const uint32_t *sum = sums.data();
+    for (unsigned int ox = 0u; ox < d.dstWidth; ++ox)
+    {
+      unsigned int x0, x1;
+      Span(d.columns, ox, roiWidth, x0, x1);
+      const uint32_t count = (x1 - x0) * (y1 - y0);
+      for (unsigned int c = 0u; c < channels; ++c)
+        *out++ = static_cast<unsigned char>((*sum++ + count / 2u) / count);
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+unsigned int ImageResampler::ConvertedPixelSize(
+    const msgs::PixelFormatType _format)
+{
+  unsigned int pattern[4];
+  if (_format == msgs::PixelFormatType::L_INT8 ||
+      BayerPattern(_format, pattern))
+  {
+    return 1u;
+  }
+  if (_format == msgs::PixelFormatType::L_INT16)
+    return 2u;
+  return 0u;
+}
+
+//////////////////////////////////////////////////
+bool ImageResampler::ConvertRgb(const unsigned char *_src,
+    const unsigned int _width, const unsigned int _height,
+    const unsigned int _srcStep, const msgs::PixelFormatType _format,
+    unsigned char *_dst)
+{
+  IGN_PROFILE("ImageResampler::ConvertRgb");
+  if (!_src || !_dst)
+    return false;
+
+  unsigned int pattern[4];
+  if (BayerPattern(_format, pattern))
+  {
+    for (unsigned int y = 0u; y < _height; ++y)
+    {
+      const unsigned char *row = _src + static_cast<std::size_t>(y) * _srcStep;
+      unsigned char *out = _dst + static_cast<std::size_t>(y) * _width;
+      const unsigned int even = pattern[(y & 1u) * 2u];
+      const unsigned int odd = pattern[(y & 1u) * 2u + 1u];
+      unsigned int x = 0u;
+      for (; x + 1u < _width; x += 2u)
+      {
+        out[x] = row[x * 3u + even];
+        out[x + 1u] = row[x * 3u + 3u + odd];
+      }
+      if (x < _width)
+        out[x] = row[x * 3u + even];
+    }
+    return true;
+  }
+
+  // BT.601 luma with 16 bit fixed point weights
+  const uint32_t kR = 19595u;
+  const uint32_t kG = 38470u;
+  const uint32_t kB = 7471u;
+  if (_format == msgs::PixelFormatType::L_INT8)
+  {
+    for (unsigned int y = 0u; y < _height; ++y)
+    {
+      const unsigned char *px = _src + static_cast<std::size_t>(y) * _srcStep;
+      unsigned char *out = _dst + static_cast<std::size_t>(y) * _width;
+      for (unsigned int x = 0u; x < _width; ++x, px += 3)
+      {
+        out[x] = static_cast<unsigned char>(
+            (kR * px[0] + kG * px[1] + kB * px[2] + 32768u) >> 16);
+      }
+    }
+    return true;
+  }
+
+  if (_format == msgs::PixelFormatType::L_INT16)
+  {
+    for (unsigned int y = 0u; y < _height; ++y)
+    {
+      const unsigned char *px = _src + static_cast<std::size_t>(y) * _srcStep;
+      uint16_t *out = reinterpret_cast<uint16_t *>(
+          _dst + static_cast<std::size_t>(y) * _width * 2u);
+      for (unsigned int x = 0u; x < _width; ++x, px += 3)
+      {
+        // Scaling by 257 maps 255 to 65535, and fits in 32 bits
+        const uint32_t luma = kR * px[0] + kG * px[1] + kB * px[2];
+        out[x] = static_cast<uint16_t>((luma * 257u + 32768u) >> 16);
+      }
+    }
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_IMAGERESAMPLE_HH_
+#define IGNITION_SENSORS_IMAGERESAMPLE_HH_
+
+#include <cstddef>
+#include <memory>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/image.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class ImageResamplerPrivate;
+
+    /// \brief Crops a region of an image with 8 bit channels and scales it
+    /// to another size. Each output pixel is the average of the source
+    /// pixels it covers, so downscaled images don't alias. The source
+    /// columns of every output pixel are computed once by Configure().
+    /// ConvertRgb() converts the pixel format of images.
+    class IGNITION_SENSORS_VISIBLE ImageResampler
+    {
+      /// \brief Constructor
+      public: ImageResampler();
+
+      /// \brief Destructor
+      public: ~ImageResampler();
+
+      /// \brief Set the geometry of the resampling.
+      /// \param[in] _srcWidth Width of source images in pixels.
+      /// \param[in] _srcHeight Height of source images in pixels.
+      /// \param[in] _channels Number of channels, between 1 and 4.
+      /// \param[in] _roiX Left column of the region to resample.
+      /// \param[in] _roiY Top row of the region to resample.
+      /// \param[in] _roiWidth Width of the region.
+      /// \param[in] _roiHeight Height of the region.
+      /// \param[in] _dstWidth Width of output images.
+      /// \param[in] _dstHeight Height of output images.
+      /// \return False if a size is zero, there are too many channels, or
+      /// the region doesn't fit in the source images.
+      public: bool Configure(const unsigned int _srcWidth,
+                  const unsigned int _srcHeight, const unsigned int _channels,
+                  const unsigned int _roiX, const unsigned int _roiY,
+                  const unsigned int _roiWidth, const unsigned int _roiHeight,
+                  const unsigned int _dstWidth, const unsigned int _dstHeight);
+
+      /// \brief Get whether Configure() was called successfully.
+      /// \return True if Resample() can be called.
+      public: bool Configured() const;
+
+      /// \brief Get whether the configuration matches a source image.
+      /// \param[in] _srcWidth Width of source images in pixels.
+      /// \param[in] _srcHeight Height of source images in pixels.
+      /// \param[in] _channels Number of channels.
+      /// \return True if configured for such images.
+      public: bool Matches(const unsigned int _srcWidth,
+                  const unsigned int _srcHeight,
+                  const unsigned int _channels) const;
+
+      /// \brief Resample an image.
+      /// \param[in] _src Source image.
+      /// \param[in] _srcStep Size of a row of the source image in bytes.
+      /// \param[out] _dst Output image, with packed rows. It must hold
+      /// OutputSize() bytes.
+      /// \return False if not configured.
+      public: bool Resample(const unsigned char *_src,
+                  const unsigned int _srcStep, unsigned char *_dst) const;
+
+      /// \brief Get the size of output images.
+      /// \return Size in bytes, or 0 if not configured.
+      public: std::size_t OutputSize() const;
+
+      /// \brief Get the size of a pixel of the formats produced by
+      /// ConvertRgb().
+      /// \param[in] _format Pixel format.
+      /// \return Size in bytes, or 0 if ConvertRgb() doesn't produce
+      /// _format.
+      public: static unsigned int ConvertedPixelSize(
+                  const msgs::PixelFormatType _format);
+
+      /// \brief Convert an RGB image with 8 bit channels to a gray image or
+      /// a Bayer mosaic, which have a third of the data. Gray levels are the
+      /// BT.601 luma of the pixels. L_INT16 images scale it to 16 bits.
+      /// \param[in] _src Source image.
+      /// \param[in] _width Width in pixels.
+      /// \param[in] _height Height in pixels.
+      /// \param[in] _srcStep Size of a row of the source image in bytes.
+      /// \param[in] _format L_INT8, L_INT16, BAYER_RGGB8, BAYER_BGGR8,
+      /// BAYER_GBRG8 or BAYER_GRBG8.
+      /// \param[out] _dst Output image, with packed rows. It must hold
+      /// _width * _height * ConvertedPixelSize(_format) bytes.
+      /// \return False if _format isn't supported.
+      public: static bool ConvertRgb(const unsigned char *_src,
+                  const unsigned int _width, const unsigned int _height,
+                  const unsigned int _srcStep,
+                  const msgs::PixelFormatType _format, unsigned char *_dst);
+
+      /// \brief Private data pointer
+      private: std::unique_ptr<ImageResamplerPrivate> dataPtr;
+    };
+    }
+  }
+}
+
+#endif
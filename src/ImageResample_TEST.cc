@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "ImageResample.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+TEST(ImageResample, Configure)
+{
+  ImageResampler resampler;
+  EXPECT_FALSE(resampler.Configured());
+  EXPECT_EQ(0u, resampler.OutputSize());
+  EXPECT_FALSE(resampler.Resample(nullptr, 0u, nullptr));
+
+  // Region outside of the image
+  EXPECT_FALSE(resampler.Configure(8u, 4u, 3u, 6u, 0u, 4u, 4u, 2u, 2u));
+  EXPECT_FALSE(resampler.Configure(8u, 4u, 3u, 0u, 4u, 8u, 1u, 2u, 2u));
+  // Empty output and too many channels
+  EXPECT_FALSE(resampler.Configure(8u, 4u, 3u, 0u, 0u, 8u, 4u, 0u, 2u));
+  EXPECT_FALSE(resampler.Configure(8u, 4u, 5u, 0u, 0u, 8u, 4u, 2u, 2u));
+  EXPECT_FALSE(resampler.Configured());
+
+  EXPECT_TRUE(resampler.Configure(8u, 4u, 3u, 0u, 0u, 8u, 4u, 2u, 2u));
+  EXPECT_TRUE(resampler.Configured());
+  EXPECT_TRUE(resampler.Matches(8u, 4u, 3u));
+  EXPECT_FALSE(resampler.Matches(8u, 4u, 1u));
+  EXPECT_EQ(2u * 2u * 3u, resampler.OutputSize());
+}
+
+//////////////////////////////////////////////////
+TEST(ImageResample, Downscale)
+{
+  // 4x4 gray image with padded rows, halved to 2x2
+  const unsigned int step = 6u;
+  std::vector<unsigned char> src = {
+     0,  2, 10, 20, 99, 99,
+     4,  6, 30, 40, 99, 99,
+    50, 50,  1,  1, 99, 99,
+    50, 51,  1,  2, 99, 99};
+
+  ImageResampler resampler;
+  ASSERT_TRUE(resampler.Configure(4u, 4u, 1u, 0u, 0u, 4u, 4u, 2u, 2u));
+  std::vector<unsigned char> dst(resampler.OutputSize());
+  ASSERT_TRUE(resampler.Resample(src.data(), step, dst.data()));
+  EXPECT_EQ(3u, dst[0]);
+  EXPECT_EQ(25u, dst[1]);
+  // 50.25 and 1.25 round to nearest
+  EXPECT_EQ(50u, dst[2]);
+  EXPECT_EQ(1u, dst[3]);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageResample, Roi)
+{
+  // 4x3 RGB image where each pixel holds its column, row and their sum
+  const unsigned int width = 4u;
+  const unsigned int height = 3u;
+  std::vector<unsigned char> src(width * height * 3u);
+  for (unsigned int y = 0u; y < height; ++y)
+  {
+    for (unsigned int x = 0u; x < width; ++x)
+    {
+      unsigned char *px = &src[(y * width + x) * 3u];
+      px[0] = static_cast<unsigned char>(x);
+      px[1] = static_cast<unsigned char>(y);
+      px[2] = static_cast<unsigned char>(x + y);
+    }
+  }
+
+  // Crop at full resolution
+  ImageResampler resampler;
+  ASSERT_TRUE(resampler.Configure(width, height, 3u, 1u, 1u, 2u, 2u, 2u,
+      2u));
+  std::vector<unsigned char> dst(resampler.OutputSize());
+  ASSERT_TRUE(resampler.Resample(src.data(), width * 3u, dst.data()));
+  const std::vector<unsigned char> crop = {1, 1, 2, 2, 1, 3, 1, 2, 3, 2, 2,
+      4};
+  EXPECT_EQ(crop, dst);
+
+  // Upscaling repeats the nearest pixel
+  ASSERT_TRUE(resampler.Configure(width, height, 3u, 3u, 2u, 1u, 1u, 2u,
+      1u));
+  dst.resize(resampler.OutputSize());
+  ASSERT_TRUE(resampler.Resample(src.data(), width * 3u, dst.data()));
+  const std::vector<unsigned char> corner = {3, 2, 5, 3, 2, 5};
+  EXPECT_EQ(corner, dst);
+}
+
+//////////////////////////////////////////////////
+TEST(ImageResample, ConvertRgb)
+{
+  // 3x2 image with padded rows
+  const unsigned int step = 10u;
+  std::vector<unsigned char> src = {
+    255,   0,   0,    0, 255,   0,    0,   0, 255,   7,
+     10,  20,  30,  255, 255, 255,    0,   0,   0,   7};
+
+  EXPECT_EQ(1u, ImageResampler::ConvertedPixelSize(
+      msgs::PixelFormatType::L_INT8));
+  EXPECT_EQ(2u, ImageResampler::ConvertedPixelSize(
+      msgs::PixelFormatType::L_INT16));
+  EXPECT_EQ(1u, ImageResampler::ConvertedPixelSize(
+      msgs::PixelFormatType::BAYER_GRBG8));
+  EXPECT_EQ(0u, ImageResampler::ConvertedPixelSize(
+      msgs::PixelFormatType::RGB_INT8));
+
+  std::vector<unsigned char> dst(3u * 2u * 2u);
+  EXPECT_FALSE(ImageResampler::ConvertRgb(src.data(), 3u, 2u, step,
+      msgs::PixelFormatType::RGBA_INT8, dst.data()));
+
+  // BT.601 luma
+  ASSERT_TRUE(ImageResampler::ConvertRgb(src.data(), 3u, 2u, step,
+      msgs::PixelFormatType::L_INT8, dst.data()));
+  const std::vector<unsigned char> gray = {76, 150, 29, 18, 255, 0};
+  EXPECT_EQ(gray, std::vector<unsigned char>(dst.begin(), dst.begin() + 6));
+
+  ASSERT_TRUE(ImageResampler::ConvertRgb(src.data(), 3u, 2u, step,
+      msgs::PixelFormatType::L_INT16, dst.data()));
+  const uint16_t *gray16 = reinterpret_cast<const uint16_t *>(dst.data());
+  EXPECT_EQ(65535u, gray16[4]);
+  EXPECT_EQ(0u, gray16[5]);
+  EXPECT_NEAR(76.245 * 257.0, gray16[0], 1.0);
+
+  // Each pixel keeps the channel of its place in the 2x2 pattern
+  ASSERT_TRUE(ImageResampler::ConvertRgb(src.data(), 3u, 2u, step,
+      msgs::PixelFormatType::BAYER_RGGB8, dst.data()));
+  const std::vector<unsigned char> rggb = {255, 255, 0, 20, 255, 0};
+  EXPECT_EQ(rggb, std::vector<unsigned char>(dst.begin(), dst.begin() + 6));
+
+  ASSERT_TRUE(ImageResampler::ConvertRgb(src.data(), 3u, 2u, step,
+      msgs::PixelFormatType::BAYER_BGGR8, dst.data()));
+  const std::vector<unsigned char> bggr = {0, 255, 255, 20, 255, 0};
+  EXPECT_EQ(bggr, std::vector<unsigned char>(dst.begin(), dst.begin() + 6));
+}
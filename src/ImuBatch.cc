@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+#include "ignition/sensors/ImuBatch.hh"
+#include "ignition/sensors/ImuSensor.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Components of the state of the sensors, each stored in its own
+/// array
+enum ImuComponent
+{
+  // Inputs
+  POS_X, POS_Y, POS_Z,
+  ROT_W, ROT_X, ROT_Y, ROT_Z,
+  REF_W, REF_X, REF_Y, REF_Z,
+  ANG_X, ANG_Y, ANG_Z,
+  ACC_X, ACC_Y, ACC_Z,
+  GRAVITY_X, GRAVITY_Y, GRAVITY_Z,
+
+  // Outputs
+  ORIENT_W, ORIENT_X, ORIENT_Y, ORIENT_Z,
+  BODY_ACC_X, BODY_ACC_Y, BODY_ACC_Z,
+
+  IMU_COMPONENT_END
+};
+
+/// \brief Private data for ImuBatch
+class ignition::sensors::ImuBatchPrivate
+{
+  /// \brief Add a value to every array.
+  /// \param[in] _values Value of every component
+  public: void PushBack(
+              const std::array<double, IMU_COMPONENT_END> &_values);
+
+  /// \brief Compute the outputs of all the sensors.
+  public: void Compute();
+
+  /// \brief Sensors of the batch
+  public: std::vector<ImuSensor *> sensors;
+
+  /// \brief One array per component, indexed like the sensors
+  public: std::array<std::vector<double>, IMU_COMPONENT_END> state;
+};
+
+//////////////////////////////////////////////////
+void ImuBatchPrivate::PushBack(
+    const std::array<double, IMU_COMPONENT_END> &_values)
+{
+  for (int c = 0; c < IMU_COMPONENT_END; ++c)
+    this->state[c].push_back(_values[c]);
+}
+
+//////////////////////////////////////////////////
+void ImuBatchPrivate::Compute()
+{
+  IGN_PROFILE("ImuBatchPrivate::Compute");
+  const std::size_t count = this->sensors.size();
+  auto &st = this->state;
+  const double *qw = st[ROT_W].data(), *qx = st[ROT_X].data(),
+      *qy = st[ROT_Y].data(), *qz = st[ROT_Z].data();
+  const double *rw = st[REF_W].data(), *rx = st[REF_X].data(),
+      *ry = st[REF_Y].data(), *rz = st[REF_Z].data();
+  const double *ax = st[ACC_X].data(), *ay = st[ACC_Y].data(),
+      *az = st[ACC_Z].data();
+  const double *gx = st[GRAVITY_X].data(), *gy = st[GRAVITY_Y].data(),
+      *gz = st[GRAVITY_Z].data();
+  double *ow = st[ORIENT_W].data(), *ox = st[ORIENT_X].data(),
+      *oy = st[ORIENT_Y].data(), *oz = st[ORIENT_Z].data();
+  double *bx = st[BODY_ACC_X].data(), *by = st[BODY_ACC_Y].data(),
+      *bz = st[BODY_ACC_Z].data();
+
+  // Same results as ImuSensor::Update(): the gravity rotated by the inverse
+  // of the orientation of the sensor, which treats a null orientation as the
+  // identity, and the orientation relative to the inverse of the reference.
+  // The loops don't branch, so they are vectorized.
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    const double norm = qw[i] * qw[i] + qx[i] * qx[i] + qy[i] * qy[i] +
+        qz[i] * qz[i];
+    const bool null = norm == 0.0;
+    const double w = null ? 1.0 : qw[i];
+    const double inv = null ? 1.0 : 1.0 / norm;
+
+    // q^-1 g q = (w^2 - u.u) g + 2 (u.g) u + 2 w (g x u), over |q|^2
+    const double uu = qx[i] * qx[i] + qy[i] * qy[i] + qz[i] * qz[i];
+    const double ug = qx[i] * gx[i] + qy[i] * gy[i] + qz[i] * gz[i];
+    const double s = w * w - uu;
+    const double cx = gy[i] * qz[i] - gz[i] * qy[i];
+    const double cy = gz[i] * qx[i] - gx[i] * qz[i];
+    const double cz = gx[i] * qy[i] - gy[i] * qx[i];
+    bx[i] = ax[i] - (s * gx[i] + 2.0 * (ug * qx[i] + w * cx)) * inv;
+    by[i] = ay[i] - (s * gy[i] + 2.0 * (ug * qy[i] + w * cy)) * inv;
+    bz[i] = az[i] - (s * gz[i] + 2.0 * (ug * qz[i] + w * cz)) * inv;
+  }
+
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    // Conjugate of the reference over its squared norm, times the rotation
+    const double norm = rw[i] * rw[i] + rx[i] * rx[i] + ry[i] * ry[i] +
+        rz[i] * rz[i];
+    const bool null = norm == 0.0;
+    const double inv = null ? 1.0 : 1.0 / norm;
+    const double w = (null ? 1.0 : rw[i]) * inv;
+    const double x = -rx[i] * inv;
+    const double y = -ry[i] * inv;
+    const double z = -rz[i] * inv;
+    ow[i] = w * qw[i] - x * qx[i] - y * qy[i] - z * qz[i];
+    ox[i] = w * qx[i] + x * qw[i] + y * qz[i] - z * qy[i];
+    oy[i] = w * qy[i] - x * qz[i] + y * qw[i] + z * qx[i];
+    oz[i] = w * qz[i] + x * qy[i] - y * qx[i] + z * qw[i];
+  }
+}
+
+//////////////////////////////////////////////////
+ImuBatch::ImuBatch()
+  : dataPtr(new ImuBatchPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+ImuBatch::~ImuBatch()
+{
+}
+
+//////////////////////////////////////////////////
+std::size_t ImuBatch::AddSensor(ImuSensor *_sensor)
+{
+  auto &sensors = this->dataPtr->sensors;
+  if (!_sensor ||
+      std::find(sensors.begin(), sensors.end(), _sensor) != sensors.end())
+  {
+    return sensors.size();
+  }
+
+  const math::Pose3d pose = _sensor->WorldPose();
+  const math::Quaterniond reference = _sensor->OrientationReference();
+  const math::Vector3d angularVel = _sensor->AngularVelocity();
+  const math::Vector3d linearAcc = _sensor->LinearAcceleration();
+  const math::Vector3d gravity = _sensor->Gravity();
+  std::array<double, IMU_COMPONENT_END> values;
+  values.fill(0.0);
+  values[POS_X] = pose.Pos().X();
+  values[POS_Y] = pose.Pos().Y();
+  values[POS_Z] = pose.Pos().Z();
+  values[ROT_W] = pose.Rot().W();
+  values[ROT_X] = pose.Rot().X();
+  values[ROT_Y] = pose.Rot().Y();
+  values[ROT_Z] = pose.Rot().Z();
+  values[REF_W] = reference.W();
+  values[REF_X] = reference.X();
+  values[REF_Y] = reference.Y();
+  values[REF_Z] = reference.Z();
+  values[ANG_X] = angularVel.X();
+  values[ANG_Y] = angularVel.Y();
+  values[ANG_Z] = angularVel.Z();
+  values[ACC_X] = linearAcc.X();
+  values[ACC_Y] = linearAcc.Y();
+  values[ACC_Z] = linearAcc.Z();
+  values[GRAVITY_X] = gravity.X();
+  values[GRAVITY_Y] = gravity.Y();
+  values[GRAVITY_Z] = gravity.Z();
+
+  sensors.push_back(_sensor);
+  this->dataPtr->PushBack(values);
+  return sensors.size() - 1u;
+}
+
+//////////////////////////////////////////////////
+bool ImuBatch::RemoveSensor(const ImuSensor *_sensor)
+{
+  auto &sensors = this->dataPtr->sensors;
+  auto it = std::find(sensors.begin(), sensors.end(), _sensor);
+  if (it == sensors.end())
+    return false;
+
+  const std::size_t index = static_cast<std::size_t>(it - sensors.begin());
+  sensors[index] = sensors.back();
+  sensors.pop_back();
+  for (auto &values : this->dataPtr->state)
+  {
+    values[index] = values.back();
+    values.pop_back();
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t ImuBatch::SensorCount() const
+{
+  return this->dataPtr->sensors.size();
+}
+
+//////////////////////////////////////////////////
+ImuSensor *ImuBatch::SensorByIndex(const std::size_t _index) const
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return nullptr;
+  return this->dataPtr->sensors[_index];
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetWorldPose(const std::size_t _index,
+    const math::Pose3d &_pose)
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return;
+
+  auto &state = this->dataPtr->state;
+  state[POS_X][_index] = _pose.Pos().X();
+  state[POS_Y][_index] = _pose.Pos().Y();
+  state[POS_Z][_index] = _pose.Pos().Z();
+  state[ROT_W][_index] = _pose.Rot().W();
+  state[ROT_X][_index] = _pose.Rot().X();
+  state[ROT_Y][_index] = _pose.Rot().Y();
+  state[ROT_Z][_index] = _pose.Rot().Z();
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetAngularVelocity(const std::size_t _index,
+    const math::Vector3d &_angularVel)
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return;
+
+  auto &state = this->dataPtr->state;
+  state[ANG_X][_index] = _angularVel.X();
+  state[ANG_Y][_index] = _angularVel.Y();
+  state[ANG_Z][_index] = _angularVel.Z();
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetLinearAcceleration(const std::size_t _index,
+    const math::Vector3d &_linearAcc)
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return;
+
+  auto &state = this->dataPtr->state;
+  state[ACC_X][_index] = _linearAcc.X();
+  state[ACC_Y][_index] = _linearAcc.Y();
+  state[ACC_Z][_index] = _linearAcc.Z();
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetStates(const double *_poses, const double *_angularVel,
+    const double *_linearAcc)
+{
+  IGN_PROFILE("ImuBatch::SetStates");
+  auto &state = this->dataPtr->state;
+  const std::size_t count = this->dataPtr->sensors.size();
+  if (_poses)
+  {
+    for (int c = 0; c < 7; ++c)
+    {
+      double *values = state[POS_X + c].data();
+      for (std::size_t i = 0u; i < count; ++i)
+        values[i] = _poses[i * 7u + c];
+    }
+  }
+  for (int c = 0; c < 3; ++c)
+  {
+    if (_angularVel)
+    {
+      double *values = state[ANG_X + c].data();
+      for (std::size_t i = 0u; i < count; ++i)
+        values[i] = _angularVel[i * 3u + c];
+    }
+    if (_linearAcc)
+    {
+      double *values = state[ACC_X + c].data();
+      for (std::size_t i = 0u; i < count; ++i)
+        values[i] = _linearAcc[i * 3u + c];
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetOrientationReference(const std::size_t _index,
+    const math::Quaterniond &_orient)
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return;
+
+  auto &state = this->dataPtr->state;
+  state[REF_W][_index] = _orient.W();
+  state[REF_X][_index] = _orient.X();
+  state[REF_Y][_index] = _orient.Y();
+  state[REF_Z][_index] = _orient.Z();
+  this->dataPtr->sensors[_index]->SetOrientationReference(_orient);
+}
+
+//////////////////////////////////////////////////
+void ImuBatch::SetGravity(const math::Vector3d &_gravity)
+{
+  auto &state = this->dataPtr->state;
+  std::fill(state[GRAVITY_X].begin(), state[GRAVITY_X].end(), _gravity.X());
+  std::fill(state[GRAVITY_Y].begin(), state[GRAVITY_Y].end(), _gravity.Y());
+  std::fill(state[GRAVITY_Z].begin(), state[GRAVITY_Z].end(), _gravity.Z());
+  for (auto *sensor : this->dataPtr->sensors)
+    sensor->SetGravity(_gravity);
+}
+
+//////////////////////////////////////////////////
+std::size_t ImuBatch::Update(const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("ImuBatch::Update");
+  this->dataPtr->Compute();
+
+  const auto &state = this->dataPtr->state;
+  std::size_t updated = 0u;
+  for (std::size_t i = 0u; i < this->dataPtr->sensors.size(); ++i)
+  {
+    // Only visit the sensors that are due
+    ImuSensor *sensor = this->dataPtr->sensors[i];
+    if (sensor->UpdateRate() > 0.0 && _now < sensor->NextDataUpdateTime())
+      continue;
+
+    sensor->SetBatchState(_now,
+        math::Pose3d(state[POS_X][i], state[POS_Y][i], state[POS_Z][i],
+            state[ROT_W][i], state[ROT_X][i], state[ROT_Y][i],
+            state[ROT_Z][i]),
+        math::Vector3d(state[ANG_X][i], state[ANG_Y][i], state[ANG_Z][i]),
+        math::Vector3d(state[BODY_ACC_X][i], state[BODY_ACC_Y][i],
+            state[BODY_ACC_Z][i]),
+        math::Quaterniond(state[ORIENT_W][i], state[ORIENT_X][i],
+            state[ORIENT_Y][i], state[ORIENT_Z][i]));
+    // Through Sensor::Update() to keep the schedule and the statistics
+    Sensor *base = sensor;
+    if (base->Update(_now, false))
+      ++updated;
+  }
+  return updated;
+}
@@ -14,16 +14,25 @@
  * limitations under the License.
  *
 */
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
 #pragma warning(disable: 4251)
 #endif
+#include <ignition/msgs/double_v.pb.h>
 #include <ignition/msgs/imu.pb.h>
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
 
+#include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/transport/Node.hh>
 
@@ -38,12 +47,14 @@ using namespace sensors;
 /// \brief Private data for ImuSensor
 class ignition::sensors::ImuSensorPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
-
   /// \brief publisher to publish imu messages.
   public: transport::Node::Publisher pub;
 
+  /// \brief Event that is used to trigger callbacks when a new message
+  /// is generated
+  public: ignition::common::EventT<
+          void(const ignition::msgs::IMU &)> dataEvent;
+
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
 
@@ -72,8 +83,38 @@ class ignition::sensors::ImuSensorPrivate
   public: std::chrono::steady_clock::duration prevStep
     {std::chrono::steady_clock::duration::zero()};
 
-  /// \brief Noise added to sensor data
-  public: std::map<SensorNoiseType, NoisePtr> noises;
+  /// \brief Noise added to sensor data, indexed by SensorNoiseType. Slots
+  /// without noise are null.
+  public: std::array<NoisePtr, SENSOR_NOISE_TYPE_END> noises;
+
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: msgs::IMU msg;
+
+  /// \brief Publisher of batches of samples
+  public: transport::Node::Publisher batchPub;
+
+  /// \brief Event that is used to trigger callbacks when a batch is full
+  public: ignition::common::EventT<
+          void(const std::vector<ignition::msgs::IMU> &)> batchEvent;
+
+  /// \brief Samples of the current batch. Empty if batching is disabled.
+  public: std::vector<msgs::IMU> batch;
+
+  /// \brief Number of samples in the current batch
+  public: std::size_t batchCount = 0u;
+
+  /// \brief Message that batches are published with
+  public: msgs::Double_V batchMsg;
+
+  /// \brief True if an ImuBatch set the state of the update at
+  /// batchStateTime, which already includes the gravity and the
+  /// orientation.
+  public: bool batchState = false;
+
+  /// \brief Time of the update the batch state is for
+  public: std::chrono::steady_clock::duration batchStateTime
+    {std::chrono::steady_clock::duration::zero()};
 };
 
 //////////////////////////////////////////////////
@@ -117,13 +158,14 @@ bool ImuSensor::Load(const sdf::Sensor &_sdf)
     this->SetTopic("/imu");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::IMU>(this->Topic());
+      this->TransportNode().Advertise<ignition::msgs::IMU>(this->Topic());
 
   if (!this->dataPtr->pub)
   {
     ignerr << "Unable to create publisher on topic[" << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   const std::map<SensorNoiseType, sdf::Noise> noises = {
     {ACCELEROMETER_X_NOISE_M_S_S, _sdf.ImuSensor()->LinearAccelerationXNoise()},
@@ -142,6 +184,16 @@ bool ImuSensor::Load(const sdf::Sensor &_sdf)
     }
   }
 
+  // Give every noise model its own reproducible random stream
+  for (std::size_t i = 0; i < this->dataPtr->noises.size(); ++i)
+  {
+    if (this->dataPtr->noises[i])
+    {
+      this->dataPtr->noises[i]->SetSeed(
+          this->NoiseSeed(static_cast<unsigned int>(i)));
+    }
+  }
+
   this->dataPtr->initialized = true;
   return true;
 }
@@ -190,18 +242,30 @@ bool ImuSensor::Update(const std::chrono::steady_clock::duration &_now)
     dt = 0.0;
   }
 
-  // Add contribution from gravity
-  // Skip if gravity is not enabled?
-  this->dataPtr->linearAcc -=
-      this->dataPtr->worldPose.Rot().Inverse().RotateVector(
-      this->dataPtr->gravity);
+  // The gravity and the orientation are already in the state set by a
+  // batch
+  if (!this->dataPtr->batchState || this->dataPtr->batchStateTime != _now)
+  {
+    // Add contribution from gravity
+    // Skip if gravity is not enabled?
+    this->dataPtr->linearAcc -=
+        this->dataPtr->worldPose.Rot().Inverse().RotateVector(
+        this->dataPtr->gravity);
+
+    // Set the IMU orientation
+    // imu orientation with respect to reference frame
+    this->dataPtr->orientation =
+        this->dataPtr->orientationReference.Inverse() *
+        this->dataPtr->worldPose.Rot();
+  }
+  this->dataPtr->batchState = false;
 
   // Convenience method to apply noise to a channel, if present.
   auto applyNoise = [&](SensorNoiseType noiseType, double & value)
   {
-    if (this->dataPtr->noises.find(noiseType) != this->dataPtr->noises.end()) {
-      value = this->dataPtr->noises[noiseType]->Apply(value, dt);
-    }
+    const NoisePtr &noise = this->dataPtr->noises[noiseType];
+    if (noise)
+      value = noise->Apply(value, dt);
   };
 
   applyNoise(ACCELEROMETER_X_NOISE_M_S_S, this->dataPtr->linearAcc.X());
@@ -211,31 +275,72 @@ bool ImuSensor::Update(const std::chrono::steady_clock::duration &_now)
   applyNoise(GYROSCOPE_Y_NOISE_RAD_S, this->dataPtr->angularVel.Y());
   applyNoise(GYROSCOPE_Z_NOISE_RAD_S, this->dataPtr->angularVel.Z());
 
-  // Set the IMU orientation
-  // imu orientation with respect to reference frame
-  this->dataPtr->orientation =
-      this->dataPtr->orientationReference.Inverse() *
-      this->dataPtr->worldPose.Rot();
+  const bool batched = !this->dataPtr->batch.empty();
+  const bool publish = !batched && this->HasConsumers(this->dataPtr->pub);
+  const bool callbacks = this->dataPtr->dataEvent.ConnectionCount() > 0;
+  if (!batched && !publish && !callbacks)
+  {
+    // Nobody consumes the message, don't build it
+    this->dataPtr->prevStep = _now;
+    this->dataPtr->timeInitialized = true;
+    return true;
+  }
 
-  msgs::IMU msg;
-  *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
+  msgs::IMU &msg = batched ?
+      this->dataPtr->batch[this->dataPtr->batchCount++] : this->dataPtr->msg;
+  this->StampHeader(msg.mutable_header(), _now);
   msg.set_entity_name(this->Name());
-  auto frame = msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
 
   msgs::Set(msg.mutable_orientation(), this->dataPtr->orientation);
   msgs::Set(msg.mutable_angular_velocity(), this->dataPtr->angularVel);
   msgs::Set(msg.mutable_linear_acceleration(), this->dataPtr->linearAcc);
 
   // publish
-  this->AddSequence(msg.mutable_header());
-  this->dataPtr->pub.Publish(msg);
+  if (publish)
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (callbacks)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an IMU callback.\n";
+    }
+  }
+
+  if (batched && this->dataPtr->batchCount == this->dataPtr->batch.size())
+  {
+    this->PublishBatch(_now);
+    this->dataPtr->batchCount = 0u;
+  }
+
   this->dataPtr->prevStep = _now;
   this->dataPtr->timeInitialized = true;
   return true;
 }
 
+//////////////////////////////////////////////////
+void ImuSensor::SetBatchState(const std::chrono::steady_clock::duration &_now,
+    const math::Pose3d &_pose, const math::Vector3d &_angularVel,
+    const math::Vector3d &_linearAcc, const math::Quaterniond &_orientation)
+{
+  this->dataPtr->worldPose = _pose;
+  this->dataPtr->angularVel = _angularVel;
+  this->dataPtr->linearAcc = _linearAcc;
+  this->dataPtr->orientation = _orientation;
+  this->dataPtr->batchState = true;
+  this->dataPtr->batchStateTime = _now;
+}
+
 //////////////////////////////////////////////////
 void ImuSensor::SetAngularVelocity(const math::Vector3d &_angularVel)
 {
@@ -302,4 +407,144 @@ math::Quaterniond ImuSensor::Orientation() const
   return this->dataPtr->orientation;
 }
 
+//////////////////////////////////////////////////
+bool ImuSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->HasConsumers(this->dataPtr->batchPub) ||
+      this->dataPtr->dataEvent.ConnectionCount() > 0 ||
+      this->dataPtr->batchEvent.ConnectionCount() > 0;
+}
+
+//////////////////////////////////////////////////
+bool ImuSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::IMU *>(&_msg);
+  if (msg && _topic == this->Topic() &&
+      this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(*msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an IMU callback.\n";
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr ImuSensor::ConnectDataCallback(
+    std::function<void(const ignition::msgs::IMU &)> _callback)
+{
+  return this->dataPtr->dataEvent.Connect(_callback);
+}
+
+//////////////////////////////////////////////////
+bool ImuSensor::SetBatchSize(const unsigned int _size)
+{
+  if (!this->dataPtr->initialized)
+  {
+    ignerr << "Unable to set the batch size of an IMU that isn't loaded.\n";
+    return false;
+  }
+
+  this->dataPtr->batchCount = 0u;
+  if (_size <= 1u)
+  {
+    this->dataPtr->batch.clear();
+    return true;
+  }
+
+  if (!this->dataPtr->batchPub)
+  {
+    std::string topic = this->Topic() + "/batch";
+    this->dataPtr->batchPub =
+        this->TransportNode().Advertise<ignition::msgs::Double_V>(topic);
+    if (!this->dataPtr->batchPub)
+    {
+      ignerr << "Unable to create publisher on topic[" << topic << "].\n";
+      this->dataPtr->batch.clear();
+      return false;
+    }
+    this->SetOutputTopic(topic, &this->dataPtr->batchPub);
+  }
+
+  this->dataPtr->batch.resize(_size);
+  return true;
+}
+
+//////////////////////////////////////////////////
+unsigned int ImuSensor::BatchSize() const
+{
+  return std::max<unsigned int>(1u,
+      static_cast<unsigned int>(this->dataPtr->batch.size()));
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr ImuSensor::ConnectBatchCallback(
+    std::function<void(const std::vector<ignition::msgs::IMU> &)> _callback)
+{
+  return this->dataPtr->batchEvent.Connect(_callback);
+}
+
+//////////////////////////////////////////////////
+void ImuSensor::PublishBatch(const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("ImuSensor::PublishBatch");
+  const auto &batch = this->dataPtr->batch;
+
+  if (this->HasConsumers(this->dataPtr->batchPub))
+  {
+    auto messageStart = std::chrono::steady_clock::now();
+    msgs::Double_V &msg = this->dataPtr->batchMsg;
+    this->StampHeader(msg.mutable_header(), _now, "batch");
+
+    const int valuesPerSample = 11;
+    msg.mutable_data()->Resize(
+        static_cast<int>(batch.size()) * valuesPerSample, 0.0);
+    double *values = msg.mutable_data()->mutable_data();
+    for (const auto &sample : batch)
+    {
+      const auto &stamp = sample.header().stamp();
+      *values++ = stamp.sec() + stamp.nsec() * 1e-9;
+      *values++ = sample.orientation().w();
+      *values++ = sample.orientation().x();
+      *values++ = sample.orientation().y();
+      *values++ = sample.orientation().z();
+      *values++ = sample.angular_velocity().x();
+      *values++ = sample.angular_velocity().y();
+      *values++ = sample.angular_velocity().z();
+      *values++ = sample.linear_acceleration().x();
+      *values++ = sample.linear_acceleration().y();
+      *values++ = sample.linear_acceleration().z();
+    }
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->batchPub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (this->dataPtr->batchEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->batchEvent(batch);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an IMU batch callback.\n";
+    }
+  }
+}
+
 IGN_SENSORS_REGISTER_SENSOR(ImuSensor)
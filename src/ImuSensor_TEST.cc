@@ -29,6 +29,7 @@
 #endif
 
 #include <ignition/sensors/Export.hh>
+#include <ignition/sensors/ImuBatch.hh>
 #include <ignition/sensors/ImuSensor.hh>
 #include <ignition/sensors/Manager.hh>
 
@@ -311,6 +312,237 @@ TEST(ImuSensor_TEST, ComputeNoise)
   EXPECT_GT(sensor->LinearAcceleration().SquaredLength(), 0.0);
 }
 
+//////////////////////////////////////////////////
+TEST(ImuSensor_TEST, DataCallback)
+{
+  ignition::sensors::Manager mgr;
+
+  const double update_rate = 100;
+  sdf::ElementPtr imuSDF = ImuSensorToSDF("TestImu_Callback", update_rate,
+    "/ignition/sensors/test/imu_callback",
+    noNoiseParameters(update_rate, 0.0), noNoiseParameters(update_rate, 0.0),
+    true, false);
+
+  auto sensor = mgr.CreateSensor<ignition::sensors::ImuSensor>(imuSDF);
+  ASSERT_NE(nullptr, sensor);
+
+  // Without subscribers or callbacks, nobody consumes the data
+  EXPECT_FALSE(sensor->HasConnections());
+
+  int count = 0;
+  ignition::msgs::IMU received;
+  auto connection = sensor->ConnectDataCallback(
+      [&](const ignition::msgs::IMU &_msg)
+      {
+        received = _msg;
+        ++count;
+      });
+  EXPECT_TRUE(sensor->HasConnections());
+
+  sensor->SetAngularVelocity(math::Vector3d(1, 2, 3));
+  sensor->SetLinearAcceleration(math::Vector3d::Zero);
+  sensor->SetWorldPose(math::Pose3d::Zero);
+  sensor->SetGravity(math::Vector3d::Zero);
+
+  EXPECT_TRUE(sensor->Update(std::chrono::milliseconds(10)));
+  EXPECT_EQ(1, count);
+  EXPECT_EQ("TestImu_Callback", received.entity_name());
+  EXPECT_DOUBLE_EQ(2.0, received.angular_velocity().y());
+  EXPECT_EQ(0, received.header().stamp().sec());
+  EXPECT_EQ(10000000, received.header().stamp().nsec());
+
+  // Breaking the connection stops the callbacks
+  connection.reset();
+  EXPECT_TRUE(sensor->Update(std::chrono::milliseconds(20)));
+  EXPECT_EQ(1, count);
+}
+
+
+//////////////////////////////////////////////////
+TEST(ImuSensor_TEST, Batch)
+{
+  ignition::sensors::Manager mgr;
+
+  const double update_rate = 1000;
+  sdf::ElementPtr imuSDF = ImuSensorToSDF("TestImu_Batch", update_rate,
+    "/ignition/sensors/test/imu_batch",
+    noNoiseParameters(update_rate, 0.0), noNoiseParameters(update_rate, 0.0),
+    true, false);
+
+  auto sensor = mgr.CreateSensor<ignition::sensors::ImuSensor>(imuSDF);
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(1u, sensor->BatchSize());
+
+  int sampleCount = 0;
+  auto dataConnection = sensor->ConnectDataCallback(
+      [&](const ignition::msgs::IMU &)
+      {
+        ++sampleCount;
+      });
+
+  std::vector<std::vector<ignition::msgs::IMU>> batches;
+  auto batchConnection = sensor->ConnectBatchCallback(
+      [&](const std::vector<ignition::msgs::IMU> &_batch)
+      {
+        batches.push_back(_batch);
+      });
+
+  EXPECT_TRUE(sensor->SetBatchSize(4u));
+  EXPECT_EQ(4u, sensor->BatchSize());
+
+  sensor->SetLinearAcceleration(math::Vector3d::Zero);
+  sensor->SetWorldPose(math::Pose3d::Zero);
+  sensor->SetGravity(math::Vector3d::Zero);
+
+  for (int i = 1; i <= 10; ++i)
+  {
+    sensor->SetAngularVelocity(math::Vector3d(i, 0, 0));
+    EXPECT_TRUE(sensor->Update(std::chrono::milliseconds(i)));
+  }
+
+  // Every sample reaches the data callback, full batches reach the batch
+  // callback with their own time stamps
+  EXPECT_EQ(10, sampleCount);
+  ASSERT_EQ(2u, batches.size());
+  for (std::size_t b = 0; b < batches.size(); ++b)
+  {
+    ASSERT_EQ(4u, batches[b].size());
+    for (std::size_t i = 0; i < 4u; ++i)
+    {
+      const int step = static_cast<int>(b * 4u + i + 1u);
+      EXPECT_EQ(step * 1000000, batches[b][i].header().stamp().nsec());
+      EXPECT_DOUBLE_EQ(step, batches[b][i].angular_velocity().x());
+    }
+  }
+
+  // Disabling batching discards the partial batch
+  EXPECT_TRUE(sensor->SetBatchSize(1u));
+  EXPECT_EQ(1u, sensor->BatchSize());
+  EXPECT_TRUE(sensor->Update(std::chrono::milliseconds(11)));
+  EXPECT_EQ(11, sampleCount);
+  EXPECT_EQ(2u, batches.size());
+}
+
+//////////////////////////////////////////////////
+TEST(ImuSensor_TEST, ImuBatch)
+{
+  ignition::sensors::Manager mgr;
+
+  // Sensors updated by a batch, and the same sensors updated one by one
+  const double update_rate = 100;
+  std::vector<ignition::sensors::ImuSensor *> batched;
+  std::vector<ignition::sensors::ImuSensor *> single;
+  for (int i = 0; i < 6; ++i)
+  {
+    for (auto *sensors : {&batched, &single})
+    {
+      const std::string name = "TestImu_ImuBatch" + std::to_string(i) +
+          (sensors == &batched ? "b" : "s");
+      sdf::ElementPtr imuSDF = ImuSensorToSDF(name, update_rate,
+          "/ignition/sensors/test/" + name,
+          noNoiseParameters(update_rate, 0.0),
+          noNoiseParameters(update_rate, 0.0), true, false);
+      auto sensor = mgr.CreateSensor<ignition::sensors::ImuSensor>(imuSDF);
+      ASSERT_NE(nullptr, sensor);
+      sensors->push_back(sensor);
+    }
+  }
+
+  ignition::sensors::ImuBatch batch;
+  EXPECT_EQ(0u, batch.SensorCount());
+  for (std::size_t i = 0; i < batched.size(); ++i)
+    EXPECT_EQ(i, batch.AddSensor(batched[i]));
+  EXPECT_EQ(batched.size(), batch.AddSensor(batched[0]));
+  EXPECT_EQ(batched.size(), batch.AddSensor(nullptr));
+  EXPECT_EQ(batched.size(), batch.SensorCount());
+  EXPECT_EQ(batched[2], batch.SensorByIndex(2));
+  EXPECT_EQ(nullptr, batch.SensorByIndex(batched.size()));
+
+  const math::Vector3d gravity(0, 0, -9.8);
+  batch.SetGravity(gravity);
+  for (auto *sensor : single)
+    sensor->SetGravity(gravity);
+
+  // Only one sensor has a consumer
+  int count = 0;
+  ignition::msgs::IMU received;
+  auto connection = batched[1]->ConnectDataCallback(
+      [&](const ignition::msgs::IMU &_msg)
+      {
+        received = _msg;
+        ++count;
+      });
+
+  std::vector<double> poses;
+  std::vector<double> angularVel;
+  std::vector<double> linearAcc;
+  for (std::size_t i = 0; i < batched.size(); ++i)
+  {
+    const double a = 0.3 * static_cast<double>(i);
+    const math::Pose3d pose(1.0 * i, 2, 3, a, -0.5 * a, 0.2 + a);
+    const math::Quaterniond reference(0.1, a, 0);
+    const math::Vector3d w(a, 1, -a);
+    const math::Vector3d acc(2, -a, 0.5);
+
+    // The first sensors get their state one at a time, the others in bulk
+    if (i < 3)
+    {
+      batch.SetWorldPose(i, pose);
+      batch.SetAngularVelocity(i, w);
+      batch.SetLinearAcceleration(i, acc);
+    }
+    for (double value : {pose.Pos().X(), pose.Pos().Y(), pose.Pos().Z(),
+        pose.Rot().W(), pose.Rot().X(), pose.Rot().Y(), pose.Rot().Z()})
+    {
+      poses.push_back(value);
+    }
+    for (double value : {w.X(), w.Y(), w.Z()})
+      angularVel.push_back(value);
+    for (double value : {acc.X(), acc.Y(), acc.Z()})
+      linearAcc.push_back(value);
+    batch.SetOrientationReference(i, reference);
+
+    single[i]->SetWorldPose(pose);
+    single[i]->SetAngularVelocity(w);
+    single[i]->SetLinearAcceleration(acc);
+    single[i]->SetOrientationReference(reference);
+  }
+  batch.SetStates(poses.data(), angularVel.data(), linearAcc.data());
+
+  const auto now = std::chrono::milliseconds(0);
+  EXPECT_EQ(batched.size(), batch.Update(now));
+  for (auto *sensor : single)
+    EXPECT_TRUE(sensor->Update(now));
+
+  for (std::size_t i = 0; i < batched.size(); ++i)
+  {
+    EXPECT_EQ(single[i]->WorldPose(), batched[i]->WorldPose());
+    EXPECT_EQ(single[i]->AngularVelocity(), batched[i]->AngularVelocity());
+    EXPECT_EQ(single[i]->LinearAcceleration(),
+        batched[i]->LinearAcceleration());
+    EXPECT_EQ(single[i]->Orientation(), batched[i]->Orientation());
+    EXPECT_EQ(std::chrono::milliseconds(10),
+        batched[i]->NextDataUpdateTime());
+  }
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(batched[1]->Name(), received.entity_name());
+  EXPECT_NEAR(single[1]->LinearAcceleration().Z(),
+      received.linear_acceleration().z(), 1e-12);
+
+  // Sensors that aren't due aren't updated
+  EXPECT_EQ(0u, batch.Update(std::chrono::milliseconds(5)));
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(batched.size(), batch.Update(std::chrono::milliseconds(10)));
+  EXPECT_EQ(2, count);
+
+  // The last sensor takes the index of a removed one
+  EXPECT_TRUE(batch.RemoveSensor(batched[1]));
+  EXPECT_FALSE(batch.RemoveSensor(batched[1]));
+  EXPECT_EQ(batched.size() - 1u, batch.SensorCount());
+  EXPECT_EQ(batched.back(), batch.SensorByIndex(1));
+  EXPECT_EQ(batched.size() - 1u, batch.Update(std::chrono::milliseconds(20)));
+  EXPECT_EQ(2, count);
+}
 
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
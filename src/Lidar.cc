@@ -14,39 +14,327 @@
  * limitations under the License.
  *
 */
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/pointcloud_packed.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <ignition/common/Console.hh>
 #include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
+#include <ignition/common/Util.hh>
 #include <ignition/transport/Node.hh>
 #include <sdf/Lidar.hh>
 
 #include "ignition/sensors/GaussianNoiseModel.hh"
 #include "ignition/sensors/Lidar.hh"
 #include "ignition/sensors/Noise.hh"
-#include "ignition/sensors/SensorFactory.hh"
 #include "ignition/sensors/SensorTypes.hh"
 
+#include "HeaderUtil.hh"
+#include "RandomStream.hh"
+#include "SnapshotBuffer.hh"
+#include "WorkerPool.hh"
+
 using namespace ignition::sensors;
 
+/// \brief Minimum number of rays that get noise as one batch. Scans with
+/// more rays are split into groups of rows of at least this size.
+static const std::size_t kMinNoiseChunkRays = 16384u;
+
 /// \brief Private data for Lidar class
 class ignition::sensors::LidarPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
-
   /// \brief publisher to publish images
   public: transport::Node::Publisher pub;
 
   /// \brief Laser message to publish data.
   public: ignition::msgs::LaserScan laserMsg;
 
-  /// \brief Noise added to sensor data
-  public: std::map<SensorNoiseType, NoisePtr> noises;
+  /// \brief Latest scan, readable without locking lidarMutex
+  public: SnapshotBuffer<ignition::msgs::LaserScan> snapshot;
+
+  /// \brief Noise added to sensor data, indexed by SensorNoiseType. Slots
+  /// without noise are null.
+  public: std::array<NoisePtr, SENSOR_NOISE_TYPE_END> noises;
+
+  /// \brief Noise models for the groups of rows of the scan. The first
+  /// one is the lidar noise model itself, the others are forks of it.
+  public: std::vector<NoisePtr> noiseChunks;
+
+  /// \brief Number of rows in each group of noiseChunks.
+  public: unsigned int noiseChunkRows = 0u;
+
+  /// \brief Number of rows the groups of noiseChunks were made for.
+  public: unsigned int noiseRows = 0u;
+
+  /// \brief Threads that apply noise to the groups of rows in parallel.
+  /// Only created for scans with more than one group and more than one
+  /// noise thread.
+  public: std::unique_ptr<WorkerPool> noisePool;
+
+  /// \brief Number of threads applying noise, 0 for one per core
+  public: unsigned int noiseThreadCount = 1u;
 
   /// \brief Sdf sensor.
   public: sdf::Lidar sdfLidar;
+
+  /// \brief Number of azimuth sectors of the sweep
+  public: unsigned int sweepSectors = 1u;
+
+  /// \brief When the laser scans are produced
+  public: LidarOutputMode scanOutput = LidarOutputMode::ENABLED;
+
+  /// \brief Topic of the laser scans
+  public: std::string scanTopic;
+
+  /// \brief Message of the latest sector of the sweep
+  public: ignition::msgs::LaserScan sectorMsg;
+
+  /// \brief Publisher of the complete sweeps, only advertised when the
+  /// sweep has sectors
+  public: transport::Node::Publisher fullPub;
+
+  /// \brief Advertise complete sweeps, if not done yet.
+  /// \param[in] _node Node of the sensor
+  /// \return True if the publisher is valid.
+  public: bool AdvertiseFullScans(transport::Node &_node);
+
+  /// \brief When the compact scans are published
+  public: LidarOutputMode packedOutput = LidarOutputMode::DISABLED;
+
+  /// \brief Bits of the intensities of compact scans, 0 for none
+  public: unsigned int packedIntensityBits = 8u;
+
+  /// \brief Latest compact scan
+  public: ignition::msgs::PointCloudPacked packedMsg;
+
+  /// \brief Resolution, range limits and angle limits written in the
+  /// header of packedMsg, which is only rewritten when they change
+  public: std::array<double, 7> packedGeometry = {{
+      std::numeric_limits<double>::quiet_NaN()}};
+
+  /// \brief Publisher of the compact scans, only advertised once they are
+  /// enabled
+  public: transport::Node::Publisher packedPub;
+
+  /// \brief Advertise compact scans, if not done yet.
+  /// \param[in] _node Node of the sensor
+  /// \return True if the publisher is valid.
+  public: bool AdvertisePackedScans(transport::Node &_node);
+
+  /// \brief Pack the whole laser buffer in packedMsg, except its stamp.
+  /// \param[in] _buffer Laser buffer, 3 values per range
+  /// \param[in] _width Number of columns of the buffer
+  /// \param[in] _rows Number of rows of the buffer
+  /// \param[in] _rangeMax Maximum range
+  /// \param[in] _resolution Meters per range unit
+  public: void FillPacked(const float *_buffer, const unsigned int _width,
+              const unsigned int _rows, const double _rangeMax,
+              const double _resolution);
+
+  /// \brief Copy columns of a laser buffer in the ranges and intensities
+  /// of a scan. The repeated fields are only resized when the number of
+  /// ranges changes. NaN ranges are replaced by the maximum range.
+  /// \param[in] _buffer Laser buffer, 3 values per range
+  /// \param[in] _width Number of columns of the buffer
+  /// \param[in] _rows Number of rows of the buffer
+  /// \param[in] _first First column to copy
+  /// \param[in] _columns Number of columns to copy
+  /// \param[in] _rangeMax Maximum range
+  /// \param[out] _msg Scan to fill
+  public: static void FillScan(const float *_buffer,
+              const unsigned int _width, const unsigned int _rows,
+              const unsigned int _first, const unsigned int _columns,
+              const double _rangeMax, ignition::msgs::LaserScan &_msg);
 };
 
+//////////////////////////////////////////////////
+bool LidarPrivate::AdvertiseFullScans(transport::Node &_node)
+{
+  if (!this->fullPub && !this->scanTopic.empty())
+  {
+    this->fullPub = _node.Advertise<ignition::msgs::LaserScan>(
+        this->scanTopic + "/full");
+    if (!this->fullPub)
+    {
+      ignerr << "Unable to create publisher on topic["
+        << this->scanTopic << "/full].\n";
+    }
+  }
+  return static_cast<bool>(this->fullPub);
+}
+
+//////////////////////////////////////////////////
+bool LidarPrivate::AdvertisePackedScans(transport::Node &_node)
+{
+  if (!this->packedPub && !this->scanTopic.empty())
+  {
+    this->packedPub = _node.Advertise<ignition::msgs::PointCloudPacked>(
+        this->scanTopic + "/packed");
+    if (!this->packedPub)
+    {
+      ignerr << "Unable to create publisher on topic["
+        << this->scanTopic << "/packed].\n";
+    }
+  }
+  return static_cast<bool>(this->packedPub);
+}
+
+//////////////////////////////////////////////////
+void LidarPrivate::FillPacked(const float *_buffer, const unsigned int _width,
+    const unsigned int _rows, const double _rangeMax,
+    const double _resolution)
+{
+  using Field = ignition::msgs::PointCloudPacked::Field;
+  ignition::msgs::PointCloudPacked &msg = this->packedMsg;
+  const bool wide = std::ceil(_rangeMax / _resolution) >=
+      std::numeric_limits<uint16_t>::max();
+  const uint32_t rangeBytes = wide ? 4u : 2u;
+  const uint32_t intensityBytes = this->packedIntensityBits / 8u;
+  const uint32_t pointStep = rangeBytes + intensityBytes;
+
+  // The layout only changes with the range or the intensity bits
+  if (msg.point_step() != pointStep || msg.field_size() == 0 ||
+      msg.field(0).datatype() != (wide ? Field::UINT32 : Field::UINT16))
+  {
+    msg.clear_field();
+    auto *field = msg.add_field();
+    field->set_name("range");
+    field->set_offset(0u);
+    field->set_datatype(wide ? Field::UINT32 : Field::UINT16);
+    field->set_count(1u);
+    if (intensityBytes > 0u)
+    {
+      field = msg.add_field();
+      field->set_name("intensity");
+      field->set_offset(rangeBytes);
+      field->set_datatype(intensityBytes == 1u ? Field::UINT8 :
+          Field::UINT16);
+      field->set_count(1u);
+    }
+    const uint16_t probe = 1u;
+    msg.set_is_bigendian(*reinterpret_cast<const uint8_t *>(&probe) == 0u);
+    msg.set_is_dense(true);
+  }
+  msg.set_width(_width);
+  msg.set_height(_rows);
+  msg.set_point_step(pointStep);
+  msg.set_row_step(_width * pointStep);
+
+  // The geometry of the scan rarely changes, so its header entries are
+  // kept between scans
+  const std::array<double, 7> geometry = {{_resolution,
+      this->laserMsg.range_min(), this->laserMsg.range_max(),
+      this->laserMsg.angle_min(), this->laserMsg.angle_max(),
+      this->laserMsg.vertical_angle_min(),
+      this->laserMsg.vertical_angle_max()}};
+  if (geometry != this->packedGeometry)
+  {
+    static const char *const keys[] = {"range_resolution", "range_min",
+        "range_max", "angle_min", "angle_max", "vertical_angle_min",
+        "vertical_angle_max"};
+    auto *header = msg.mutable_header();
+    for (std::size_t i = 0u; i < geometry.size(); ++i)
+      SetHeaderValue(*header, keys[i], geometry[i]);
+    this->packedGeometry = geometry;
+  }
+
+  // The largest value of the field stands for infinity
+  const double rangeLimit = wide ?
+      std::numeric_limits<uint32_t>::max() :
+      std::numeric_limits<uint16_t>::max();
+  const double intensityLimit =
+      std::ldexp(1.0, static_cast<int>(this->packedIntensityBits)) - 1.0;
+  const double inverse = 1.0 / _resolution;
+
+  const std::size_t count = static_cast<std::size_t>(_width) * _rows;
+  std::string *data = msg.mutable_data();
+  data->resize(count * pointStep);
+  char *out = &(*data)[0];
+  for (std::size_t i = 0u; i < count; ++i, _buffer += 3, out += pointStep)
+  {
+    double range = _buffer[0];
+    if (std::isnan(range))
+      range = _rangeMax;
+    double units = rangeLimit;
+    if (!std::isinf(range) || range < 0.0)
+    {
+      units = range > 0.0 ?
+          std::min(std::round(range * inverse), rangeLimit - 1.0) : 0.0;
+    }
+    if (wide)
+    {
+      const uint32_t value = static_cast<uint32_t>(units);
+      std::memcpy(out, &value, sizeof(value));
+    }
+    else
+    {
+      const uint16_t value = static_cast<uint16_t>(units);
+      std::memcpy(out, &value, sizeof(value));
+    }
+
+    if (intensityBytes == 0u)
+      continue;
+    const double intensity = std::isnan(_buffer[1]) ? 0.0 :
+        std::max(0.0, std::min(std::round(_buffer[1]), intensityLimit));
+    if (intensityBytes == 1u)
+    {
+      out[rangeBytes] = static_cast<char>(static_cast<uint8_t>(intensity));
+    }
+    else
+    {
+      const uint16_t value = static_cast<uint16_t>(intensity);
+      std::memcpy(out + rangeBytes, &value, sizeof(value));
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void LidarPrivate::FillScan(const float *_buffer, const unsigned int _width,
+    const unsigned int _rows, const unsigned int _first,
+    const unsigned int _columns, const double _rangeMax,
+    ignition::msgs::LaserScan &_msg)
+{
+  const int count = static_cast<int>(_columns * _rows);
+  auto *ranges = _msg.mutable_ranges();
+  auto *intensities = _msg.mutable_intensities();
+  if (ranges->size() != count || intensities->size() != count)
+  {
+    ranges->Resize(count, ignition::math::NAN_D);
+    intensities->Resize(count, ignition::math::NAN_D);
+  }
+
+  double *rangeOut = ranges->mutable_data();
+  double *intensityOut = intensities->mutable_data();
+  for (unsigned int j = 0; j < _rows; ++j)
+  {
+    const float *buffer =
+        _buffer + (static_cast<std::size_t>(j) * _width + _first) * 3u;
+    for (unsigned int i = 0; i < _columns; ++i, buffer += 3)
+    {
+      const float range = buffer[0];
+      *rangeOut++ = std::isnan(range) ? _rangeMax : range;
+      *intensityOut++ = buffer[1];
+    }
+  }
+}
+
 //////////////////////////////////////////////////
 Lidar::Lidar()
   : dataPtr(new LidarPrivate())
@@ -110,7 +398,7 @@ bool Lidar::Load(const sdf::Sensor &_sdf)
     this->SetTopic("/lidar");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::LaserScan>(
+      this->TransportNode().Advertise<ignition::msgs::LaserScan>(
         this->Topic());
   if (!this->dataPtr->pub)
   {
@@ -118,10 +406,51 @@ bool Lidar::Load(const sdf::Sensor &_sdf)
       << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
   ignmsg << "Publishing laser scans on [" << this->Topic() << "]" << std::endl;
 
   // Load ray atributes
   this->dataPtr->sdfLidar = *_sdf.LidarSensor();
+  this->dataPtr->scanTopic = this->Topic();
+
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:sweep_sectors"))
+  {
+    this->dataPtr->sweepSectors = std::max(1u,
+        elem->Get<unsigned int>("ignition:sweep_sectors"));
+  }
+  this->LoadOutputMode(elem, "ignition:scan_output",
+      this->dataPtr->scanOutput);
+  if (elem && elem->HasElement("ignition:noise_threads"))
+  {
+    this->SetNoiseThreadCount(
+        elem->Get<unsigned int>("ignition:noise_threads"));
+  }
+  this->LoadOutputMode(elem, "ignition:packed_output",
+      this->dataPtr->packedOutput);
+  if (elem && elem->HasElement("ignition:packed_intensity_bits"))
+  {
+    this->SetPackedIntensityBits(
+        elem->Get<unsigned int>("ignition:packed_intensity_bits"));
+  }
+  if (this->dataPtr->packedOutput != LidarOutputMode::DISABLED &&
+      this->dataPtr->AdvertisePackedScans(this->TransportNode()))
+  {
+    this->SetOutputTopic(this->dataPtr->scanTopic + "/packed",
+        &this->dataPtr->packedPub);
+  }
+
+  // Each update scans one sector. Sensors that fall back to whole sweeps
+  // put the rate back with SetSweepSectors().
+  const unsigned int sectors = this->SweepSectors();
+  if (sectors > 1u)
+  {
+    this->SetUpdateRate(this->UpdateRate() * sectors);
+    if (!this->dataPtr->AdvertiseFullScans(this->TransportNode()))
+      return false;
+    this->SetOutputTopic(this->dataPtr->scanTopic + "/full",
+        &this->dataPtr->fullPub);
+  }
 
   if (this->RayCount() == 0 || this->VerticalRayCount() == 0)
   {
@@ -164,6 +493,16 @@ bool Lidar::Load(const sdf::Sensor &_sdf)
     }
   }
 
+  // Give every noise model its own reproducible random stream
+  for (std::size_t i = 0; i < this->dataPtr->noises.size(); ++i)
+  {
+    if (this->dataPtr->noises[i])
+    {
+      this->dataPtr->noises[i]->SetSeed(
+          this->NoiseSeed(static_cast<unsigned int>(i)));
+    }
+  }
+
   this->initialized = true;
   return true;
 }
@@ -202,20 +541,94 @@ bool Lidar::Update(const std::chrono::steady_clock::duration &/*_now*/)
 //////////////////////////////////////////////////
 void Lidar::ApplyNoise()
 {
-  if (this->dataPtr->noises.find(LIDAR_NOISE) != this->dataPtr->noises.end())
+  IGN_PROFILE("Lidar::ApplyNoise");
+  const NoisePtr &noise = this->dataPtr->noises[LIDAR_NOISE];
+  if (!noise || !this->laserBuffer)
+    return;
+
+  const unsigned int columns = this->RayCount();
+  const unsigned int rows = this->VerticalRayCount();
+  if (columns == 0u || rows == 0u)
+    return;
+
+  // Split the scan into groups of rows. The groups only depend on the scan
+  // size, so that the noise is the same no matter how many threads apply
+  // it. Start over if the noise model changed, e.g. to a custom callback.
+  if (this->dataPtr->noiseChunks.empty() ||
+      this->dataPtr->noiseChunks.front() != noise ||
+      this->dataPtr->noiseRows != rows ||
+      (this->dataPtr->noiseChunks.size() > 1u &&
+       noise->Type() != NoiseType::GAUSSIAN))
   {
-    for (unsigned int j = 0; j < this->VerticalRayCount(); ++j)
+    unsigned int chunkRows = static_cast<unsigned int>(
+        (kMinNoiseChunkRays + columns - 1u) / columns);
+    chunkRows = std::max(1u, std::min(chunkRows, rows));
+    const unsigned int chunkCount = (rows + chunkRows - 1u) / chunkRows;
+
+    this->dataPtr->noiseChunks.clear();
+    this->dataPtr->noiseChunks.push_back(noise);
+
+    // Custom noise callbacks aren't known to be thread safe, so they get
+    // a single group.
+    if (noise->Type() == NoiseType::GAUSSIAN)
     {
-      for (unsigned int i = 0; i < this->RayCount(); ++i)
+      const std::uint64_t seed = this->NoiseSeed(LIDAR_NOISE);
+      for (unsigned int c = 1u; c < chunkCount; ++c)
       {
-        int index = j * this->RayCount() + i;
-        double range = this->laserBuffer[index*3];
-        range = this->dataPtr->noises[LIDAR_NOISE]->Apply(range);
-        range = ignition::math::clamp(range,
-            this->RangeMin(), this->RangeMax());
-        this->laserBuffer[index*3] = range;
+        this->dataPtr->noiseChunks.push_back(
+            noise->Fork(RandomStream::Combine(seed, c)));
       }
     }
+    else
+    {
+      chunkRows = rows;
+    }
+
+    this->dataPtr->noiseChunkRows = chunkRows;
+    this->dataPtr->noiseRows = rows;
+  }
+
+  const unsigned int threads = std::min(this->NoiseThreadCount(),
+      static_cast<unsigned int>(this->dataPtr->noiseChunks.size()));
+  if (threads < 2u)
+  {
+    this->dataPtr->noisePool.reset();
+  }
+  else if (!this->dataPtr->noisePool ||
+      this->dataPtr->noisePool->ThreadCount() != threads)
+  {
+    this->dataPtr->noisePool.reset(new WorkerPool(threads));
+  }
+
+  const float rangeMin = static_cast<float>(this->RangeMin());
+  const float rangeMax = static_cast<float>(this->RangeMax());
+  const unsigned int chunkRows = this->dataPtr->noiseChunkRows;
+  float *buffer = this->laserBuffer;
+
+  // Ranges are the first of the three channels of each ray.
+  auto applyChunk = [&](std::size_t _chunk)
+  {
+    const std::size_t firstRow = _chunk * chunkRows;
+    const std::size_t lastRow = std::min<std::size_t>(
+        firstRow + chunkRows, rows);
+    const std::size_t count = (lastRow - firstRow) * columns;
+    float *ranges = buffer + firstRow * columns * 3u;
+
+    this->dataPtr->noiseChunks[_chunk]->ApplyBatch(ranges, count, 0.0, 3u);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      float &range = ranges[i * 3u];
+      range = std::min(std::max(range, rangeMin), rangeMax);
+    }
+  };
+
+  const std::size_t chunkCount = this->dataPtr->noiseChunks.size();
+  if (this->dataPtr->noisePool)
+    this->dataPtr->noisePool->ParallelFor(chunkCount, applyChunk);
+  else
+  {
+    for (std::size_t c = 0; c < chunkCount; ++c)
+      applyChunk(c);
   }
 }
 
@@ -232,52 +645,339 @@ bool Lidar::PublishLidarScan(const std::chrono::steady_clock::duration &_now)
   if (!this->laserBuffer)
     return false;
 
+  const bool packed = this->dataPtr->packedPub &&
+      this->OutputActive(this->dataPtr->packedOutput,
+      this->dataPtr->packedPub);
+  if (!this->OutputActive(this->dataPtr->scanOutput, this->dataPtr->pub))
+  {
+    if (packed)
+    {
+      std::lock_guard<std::mutex> lock(this->lidarMutex);
+      this->PublishPackedScan(_now);
+    }
+    return true;
+  }
+
   std::lock_guard<std::mutex> lock(this->lidarMutex);
 
-  *this->dataPtr->laserMsg.mutable_header()->mutable_stamp() =
-    msgs::Convert(_now);
-  // Remove 'data' entries before adding new ones
-  this->dataPtr->laserMsg.mutable_header()->clear_data();
-  auto frame = this->dataPtr->laserMsg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
+  this->StampHeader(this->dataPtr->laserMsg.mutable_header(), _now);
   this->dataPtr->laserMsg.set_frame(this->Name());
 
   // Store the latest laser scans into laserMsg
   msgs::Set(this->dataPtr->laserMsg.mutable_world_pose(),
       this->Pose());
 
-  const int numRays = this->RayCount() * this->VerticalRayCount();
-  if (this->dataPtr->laserMsg.ranges_size() != numRays)
+  // The message holds one range per value of the laser buffer
+  const unsigned int columns = this->RangeCount();
+  LidarPrivate::FillScan(this->laserBuffer, columns,
+      this->VerticalRangeCount(), 0u, columns, this->RangeMax(),
+      this->dataPtr->laserMsg);
+
+  // Make the new scan visible to other threads
+  this->dataPtr->snapshot.Back().CopyFrom(this->dataPtr->laserMsg);
+  this->dataPtr->snapshot.Publish();
+
+  // publish
   {
-    // igndbg << "Size mismatch; allocating memory\n";
-    this->dataPtr->laserMsg.clear_ranges();
-    this->dataPtr->laserMsg.clear_intensities();
-    for (int i = 0; i < numRays; ++i)
-    {
-      this->dataPtr->laserMsg.add_ranges(ignition::math::NAN_F);
-      this->dataPtr->laserMsg.add_intensities(ignition::math::NAN_F);
-    }
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, this->dataPtr->laserMsg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(this->dataPtr->laserMsg.ByteSizeLong());
+  }
+
+  if (packed)
+    this->PublishPackedScan(_now);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void Lidar::PublishPackedScan(const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("Lidar::PublishPackedScan");
+  this->StampHeader(this->dataPtr->packedMsg.mutable_header(), _now,
+      "packed");
+  this->dataPtr->FillPacked(this->laserBuffer, this->RangeCount(),
+      this->VerticalRangeCount(), this->RangeMax(),
+      this->PackedRangeResolution());
+
+  auto publishStart = std::chrono::steady_clock::now();
+  this->Publish(this->dataPtr->packedPub, this->dataPtr->packedMsg);
+  this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+  this->RecordPublishedBytes(this->dataPtr->packedMsg.ByteSizeLong());
+}
+
+//////////////////////////////////////////////////
+void Lidar::SetPackedOutput(const LidarOutputMode _mode)
+{
+  this->dataPtr->packedOutput = _mode;
+  if (_mode != LidarOutputMode::DISABLED && this->initialized &&
+      this->dataPtr->AdvertisePackedScans(this->TransportNode()))
+  {
+    this->SetOutputTopic(this->dataPtr->scanTopic + "/packed",
+        &this->dataPtr->packedPub);
   }
+}
+
+//////////////////////////////////////////////////
+LidarOutputMode Lidar::PackedOutput() const
+{
+  return this->dataPtr->packedOutput;
+}
+
+//////////////////////////////////////////////////
+bool Lidar::SetPackedIntensityBits(const unsigned int _bits)
+{
+  if (_bits != 0u && _bits != 8u && _bits != 16u)
+  {
+    ignwarn << "Compact scans of sensor [" << this->Name() << "] can't "
+            << "have [" << _bits << "] bit intensities, only 0, 8 or 16.\n";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(this->lidarMutex);
+  this->dataPtr->packedIntensityBits = _bits;
+  return true;
+}
 
+//////////////////////////////////////////////////
+unsigned int Lidar::PackedIntensityBits() const
+{
+  return this->dataPtr->packedIntensityBits;
+}
+
+//////////////////////////////////////////////////
+double Lidar::PackedRangeResolution() const
+{
+  const double resolution = this->RangeResolution();
+  return resolution > 0.0 ? resolution : 0.001;
+}
+
+//////////////////////////////////////////////////
+void Lidar::SetScanOutput(const LidarOutputMode _mode)
+{
+  this->dataPtr->scanOutput = _mode;
+}
+
+//////////////////////////////////////////////////
+LidarOutputMode Lidar::ScanOutput() const
+{
+  return this->dataPtr->scanOutput;
+}
+
+//////////////////////////////////////////////////
+void Lidar::LoadOutputMode(const sdf::ElementPtr &_sdf,
+    const std::string &_element, LidarOutputMode &_mode) const
+{
+  if (!_sdf || !_sdf->HasElement(_element))
+    return;
+
+  const std::string name = common::lowercase(
+      _sdf->Get<std::string>(_element));
+  if (name == "auto")
+  {
+    _mode = LidarOutputMode::AUTO;
+  }
+  else if (name == "enabled")
+  {
+    _mode = LidarOutputMode::ENABLED;
+  }
+  else if (name == "disabled")
+  {
+    _mode = LidarOutputMode::DISABLED;
+  }
+  else
+  {
+    ignwarn << "Unknown output mode [" << name << "] in <" << _element
+            << "> of sensor [" << this->Name() << "]. Ignoring it.\n";
+  }
+}
+
+//////////////////////////////////////////////////
+bool Lidar::OutputActive(const LidarOutputMode _mode,
+    const transport::Node::Publisher &_pub) const
+{
+  switch (_mode)
+  {
+    case LidarOutputMode::ENABLED:
+      return true;
+    case LidarOutputMode::DISABLED:
+      return false;
+    case LidarOutputMode::AUTO:
+    default:
+      return this->HasConsumers(_pub);
+  }
+}
+
+//////////////////////////////////////////////////
+void Lidar::SetSweepSectors(const unsigned int _sectors)
+{
+  const unsigned int previous = this->SweepSectors();
+  this->dataPtr->sweepSectors = std::max(1u, _sectors);
+  const unsigned int sectors = this->SweepSectors();
+  if (!this->initialized || sectors == previous)
+    return;
+
+  // Keep the rate of whole sweeps
+  this->SetUpdateRate(this->UpdateRate() / previous * sectors);
+  if (sectors > 1u && this->dataPtr->AdvertiseFullScans(this->TransportNode()))
+  {
+    this->SetOutputTopic(this->dataPtr->scanTopic + "/full",
+        &this->dataPtr->fullPub);
+  }
+}
+
+//////////////////////////////////////////////////
+unsigned int Lidar::SweepSectors() const
+{
+  // Sectors have at least two columns
+  const unsigned int columns = this->RangeCount();
+  if (columns == 0u)
+    return this->dataPtr->sweepSectors;
+  return std::min(this->dataPtr->sweepSectors, std::max(1u, columns / 2u));
+}
+
+//////////////////////////////////////////////////
+void Lidar::SweepSectorColumns(const unsigned int _sector,
+    unsigned int &_first, unsigned int &_columns) const
+{
+  const unsigned int sectors = this->SweepSectors();
+  const std::uint64_t columns = this->RangeCount();
+  if (_sector >= sectors)
+  {
+    _first = 0u;
+    _columns = 0u;
+    return;
+  }
+  _first = static_cast<unsigned int>(columns * _sector / sectors);
+  _columns = static_cast<unsigned int>(
+      columns * (_sector + 1u) / sectors) - _first;
+}
+
+//////////////////////////////////////////////////
+void Lidar::SetNoiseThreadCount(const unsigned int _threads)
+{
+  this->dataPtr->noiseThreadCount = _threads;
+}
+
+//////////////////////////////////////////////////
+unsigned int Lidar::NoiseThreadCount() const
+{
+  return this->dataPtr->noiseThreadCount > 0u ?
+      this->dataPtr->noiseThreadCount :
+      std::max(1u, std::thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////
+void Lidar::ApplyNoise(const unsigned int _firstColumn,
+    const unsigned int _columns)
+{
+  IGN_PROFILE("Lidar::ApplyNoise");
+  const NoisePtr &noise = this->dataPtr->noises[LIDAR_NOISE];
+  // Sectors are in the range columns, see PublishLidarSector()
+  const unsigned int width = this->RangeCount();
+  if (!noise || !this->laserBuffer || _columns == 0u ||
+      _firstColumn + _columns > width)
+  {
+    return;
+  }
+
+  const float rangeMin = static_cast<float>(this->RangeMin());
+  const float rangeMax = static_cast<float>(this->RangeMax());
   for (unsigned int j = 0; j < this->VerticalRangeCount(); ++j)
   {
-    for (unsigned int i = 0; i < this->RangeCount(); ++i)
+    float *ranges = this->laserBuffer +
+        (static_cast<std::size_t>(j) * width + _firstColumn) * 3u;
+    noise->ApplyBatch(ranges, _columns, 0.0, 3u);
+    for (unsigned int i = 0; i < _columns; ++i)
     {
-      int index = j * this->RangeCount() + i;
-      double range = this->laserBuffer[index*3];
+      float &range = ranges[i * 3u];
+      range = std::min(std::max(range, rangeMin), rangeMax);
+    }
+  }
+}
 
-      range = ignition::math::isnan(range) ? this->RangeMax() : range;
-      this->dataPtr->laserMsg.set_ranges(index, range);
-      this->dataPtr->laserMsg.set_intensities(index,
-          this->laserBuffer[index * 3 + 1]);
+//////////////////////////////////////////////////
+bool Lidar::PublishLidarSector(
+    const std::chrono::steady_clock::duration &_now,
+    const unsigned int _sector)
+{
+  IGN_PROFILE("Lidar::PublishLidarSector");
+  unsigned int first = 0u;
+  unsigned int columns = 0u;
+  this->SweepSectorColumns(_sector, first, columns);
+  if (!this->laserBuffer || columns == 0u)
+    return false;
+
+  // Sectors are only useful with the complete sweeps, so either
+  // subscription keeps the scans going
+  const bool packed = this->dataPtr->packedPub &&
+      this->OutputActive(this->dataPtr->packedOutput,
+      this->dataPtr->packedPub);
+  if (!this->OutputActive(this->dataPtr->scanOutput, this->dataPtr->pub) &&
+      !this->OutputActive(this->dataPtr->scanOutput, this->dataPtr->fullPub))
+  {
+    if (packed && _sector + 1u == this->SweepSectors())
+    {
+      std::lock_guard<std::mutex> lock(this->lidarMutex);
+      this->PublishPackedScan(_now);
     }
+    return true;
   }
 
-  // publish
-  this->AddSequence(this->dataPtr->laserMsg.mutable_header());
-  this->dataPtr->pub.Publish(this->dataPtr->laserMsg);
+  std::lock_guard<std::mutex> lock(this->lidarMutex);
+
+  const unsigned int width = this->RangeCount();
+  const unsigned int rows = this->VerticalRangeCount();
+  const double step = this->AngleResolution();
+  const double angleMin = this->AngleMin().Radian();
+  msgs::LaserScan &sectorMsg = this->dataPtr->sectorMsg;
+  const msgs::LaserScan &laserMsg = this->dataPtr->laserMsg;
+
+  this->StampHeader(sectorMsg.mutable_header(), _now);
+  sectorMsg.set_frame(this->Name());
+  msgs::Set(sectorMsg.mutable_world_pose(), this->Pose());
+  sectorMsg.set_count(columns);
+  sectorMsg.set_range_min(laserMsg.range_min());
+  sectorMsg.set_range_max(laserMsg.range_max());
+  sectorMsg.set_angle_min(angleMin + first * step);
+  sectorMsg.set_angle_max(angleMin + (first + columns - 1u) * step);
+  sectorMsg.set_angle_step(laserMsg.angle_step());
+  sectorMsg.set_vertical_angle_min(laserMsg.vertical_angle_min());
+  sectorMsg.set_vertical_angle_max(laserMsg.vertical_angle_max());
+  sectorMsg.set_vertical_angle_step(laserMsg.vertical_angle_step());
+  sectorMsg.set_vertical_count(rows);
+  LidarPrivate::FillScan(this->laserBuffer, width, rows, first, columns,
+      this->RangeMax(), sectorMsg);
 
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, sectorMsg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(sectorMsg.ByteSizeLong());
+  }
+
+  if (_sector + 1u < this->SweepSectors())
+    return true;
+
+  // The sweep is complete
+  this->StampHeader(this->dataPtr->laserMsg.mutable_header(), _now, "full");
+  this->dataPtr->laserMsg.set_frame(this->Name());
+  msgs::Set(this->dataPtr->laserMsg.mutable_world_pose(), this->Pose());
+  LidarPrivate::FillScan(this->laserBuffer, width, rows, 0u, width,
+      this->RangeMax(), this->dataPtr->laserMsg);
+
+  this->dataPtr->snapshot.Back().CopyFrom(this->dataPtr->laserMsg);
+  this->dataPtr->snapshot.Publish();
+
+  if (this->HasConsumers(this->dataPtr->fullPub))
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->fullPub, this->dataPtr->laserMsg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(this->dataPtr->laserMsg.ByteSizeLong());
+  }
+
+  if (packed)
+    this->PublishPackedScan(_now);
   return true;
 }
 
@@ -413,30 +1113,39 @@ void Lidar::SetVerticalAngleMax(const double _angle)
 //////////////////////////////////////////////////
 void Lidar::Ranges(std::vector<double> &_ranges) const
 {
-  std::lock_guard<std::mutex> lock(this->lidarMutex);
+  auto scan = this->dataPtr->snapshot.Latest();
+  if (!scan)
+  {
+    _ranges.clear();
+    return;
+  }
 
-  _ranges.resize(this->dataPtr->laserMsg.ranges_size());
-  memcpy(&_ranges[0], this->dataPtr->laserMsg.ranges().data(),
-         sizeof(_ranges[0]) * this->dataPtr->laserMsg.ranges_size());
+  _ranges.assign(scan->ranges().begin(), scan->ranges().end());
 }
 
 //////////////////////////////////////////////////
 double Lidar::Range(const int _index) const
 {
-  std::lock_guard<std::mutex> lock(this->lidarMutex);
-
-  if (this->dataPtr->laserMsg.ranges_size() == 0)
+  auto scan = this->dataPtr->snapshot.Latest();
+  if (!scan || scan->ranges_size() == 0)
   {
     ignwarn << "ranges not constructed yet (zero sized)\n";
     return 0.0;
   }
-  if (_index < 0 || _index > this->dataPtr->laserMsg.ranges_size())
+  if (_index < 0 || _index >= scan->ranges_size())
   {
     ignerr << "Invalid range index[" << _index << "]\n";
     return 0.0;
   }
 
-  return this->dataPtr->laserMsg.ranges(_index);
+  return scan->ranges(_index);
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<const ignition::msgs::LaserScan>
+    Lidar::LaserScanSnapshot() const
+{
+  return this->dataPtr->snapshot.Latest();
 }
 
 //////////////////////////////////////////////////
@@ -460,4 +1169,30 @@ bool Lidar::IsActive() const
   return true;
 }
 
-IGN_SENSORS_REGISTER_SENSOR(Lidar)
+//////////////////////////////////////////////////
+SensorMemory Lidar::MemoryUsage() const
+{
+  // The laser buffer is allocated by the subclasses, which add it
+  SensorMemory memory;
+  std::lock_guard<std::mutex> lock(this->lidarMutex);
+  memory.messageBytes += this->dataPtr->laserMsg.SpaceUsedLong() +
+      this->dataPtr->packedMsg.SpaceUsedLong();
+  auto latest = this->dataPtr->snapshot.Latest();
+  if (latest)
+    memory.messageBytes += latest->SpaceUsedLong();
+  return memory;
+}
+
+//////////////////////////////////////////////////
+bool Lidar::HasConnections() const
+{
+  if (this->dataPtr->packedOutput != LidarOutputMode::DISABLED &&
+      this->HasConsumers(this->dataPtr->packedPub))
+  {
+    return true;
+  }
+  if (this->dataPtr->scanOutput == LidarOutputMode::DISABLED)
+    return false;
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->HasConsumers(this->dataPtr->fullPub);
+}
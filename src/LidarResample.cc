@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+#include <ignition/math/Helpers.hh>
+#include <ignition/math/Vector3.hh>
+
+#include "LidarResample.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for LidarResampler
+class ignition::sensors::LidarResamplerPrivate
+{
+  /// \brief Offset of the target the rays were mapped for
+  public: math::Pose3d offset;
+
+  /// \brief Source ray of each target ray. Empty if not configured.
+  public: std::vector<uint32_t> indices;
+
+  /// \brief Direction of the source ray of each target ray, in the frame
+  /// of the source, 3 values per target ray
+  public: std::vector<float> directions;
+
+  /// \brief Origin of the target in the frame of the source
+  public: math::Vector3d origin;
+
+  /// \brief True if the target origin is the source origin, in which case
+  /// ranges are copied
+  public: bool sameOrigin = true;
+};
+
+namespace
+{
+  /// \brief Inclination tolerance of sources with a single row of rays,
+  /// which have no spacing to derive it from
+  const double kSingleRowTolerance = 1e-3;
+
+  /// \brief Angle step between the rays of an axis.
+  /// \param[in] _min Minimum angle
+  /// \param[in] _max Maximum angle
+  /// \param[in] _count Number of rays
+  /// \return Step, 0 for a single ray
+  double AngleStep(const double _min, const double _max,
+      const unsigned int _count)
+  {
+    return _count > 1u ? (_max - _min) / (_count - 1u) : 0.0;
+  }
+
+  /// \brief Find the ray of an axis nearest to an angle.
+  /// \param[in] _angle Angle of the direction
+  /// \param[in] _min Minimum angle of the axis
+  /// \param[in] _step Angle step of the axis
+  /// \param[in] _count Number of rays of the axis
+  /// \param[in] _tolerance Largest distance to the nearest ray
+  /// \param[out] _index Index of the nearest ray
+  /// \return False if no ray is within the tolerance
+  bool NearestRay(const double _angle, const double _min, const double _step,
+      const unsigned int _count, const double _tolerance,
+      unsigned int &_index)
+  {
+    double position = 0.0;
+    if (_step != 0.0)
+      position = std::round((_angle - _min) / _step);
+    if (position < 0.0 || position > _count - 1.0)
+      return false;
+    _index = static_cast<unsigned int>(position);
+    return std::abs(_min + _index * _step - _angle) <= _tolerance;
+  }
+}
+
+//////////////////////////////////////////////////
+LidarResampler::LidarResampler()
+  : dataPtr(new LidarResamplerPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+LidarResampler::~LidarResampler()
+{
+}
+
+//////////////////////////////////////////////////
+bool LidarResampler::Configure(const LidarRayPattern &_source,
+    const LidarRayPattern &_target, const math::Pose3d &_offset)
+{
+  IGN_PROFILE("LidarResampler::Configure");
+  if (_source.width == 0u || _source.height == 0u ||
+      _target.width == 0u || _target.height == 0u)
+  {
+    return false;
+  }
+
+  const double step =
+      AngleStep(_source.angleMin, _source.angleMax, _source.width);
+  const double verticalStep = AngleStep(_source.verticalAngleMin,
+      _source.verticalAngleMax, _source.height);
+  const double tolerance = 0.5 * std::abs(step) + 1e-9;
+  const double verticalTolerance = _source.height > 1u ?
+      0.5 * std::abs(verticalStep) + 1e-9 : kSingleRowTolerance;
+
+  const double targetStep =
+      AngleStep(_target.angleMin, _target.angleMax, _target.width);
+  const double targetVerticalStep = AngleStep(_target.verticalAngleMin,
+      _target.verticalAngleMax, _target.height);
+
+  const std::size_t count =
+      static_cast<std::size_t>(_target.width) * _target.height;
+  std::vector<uint32_t> indices(count);
+  std::vector<float> directions(count * 3u);
+  std::size_t k = 0u;
+  for (unsigned int j = 0u; j < _target.height; ++j)
+  {
+    const double inclination =
+        _target.verticalAngleMin + j * targetVerticalStep;
+    for (unsigned int i = 0u; i < _target.width; ++i, ++k)
+    {
+      // Direction of the target ray in the frame of the source
+      const double azimuth = _target.angleMin + i * targetStep;
+      const math::Vector3d direction = _offset.Rot().RotateVector(
+          math::Vector3d(std::cos(inclination) * std::cos(azimuth),
+                         std::cos(inclination) * std::sin(azimuth),
+                         std::sin(inclination)));
+
+      const double sourceInclination =
+          std::asin(math::clamp(direction.Z(), -1.0, 1.0));
+      double sourceAzimuth = std::atan2(direction.Y(), direction.X());
+      // Bring the azimuth in the turn of the source limits
+      if (sourceAzimuth < _source.angleMin - tolerance)
+        sourceAzimuth += 2.0 * IGN_PI;
+      else if (sourceAzimuth > _source.angleMax + tolerance)
+        sourceAzimuth -= 2.0 * IGN_PI;
+
+      unsigned int column = 0u;
+      unsigned int row = 0u;
+      if (!NearestRay(sourceAzimuth, _source.angleMin, step, _source.width,
+              tolerance, column) ||
+          !NearestRay(sourceInclination, _source.verticalAngleMin,
+              verticalStep, _source.height, verticalTolerance, row))
+      {
+        return false;
+      }
+
+      indices[k] = row * _source.width + column;
+      const double rayAzimuth = _source.angleMin + column * step;
+      const double rayInclination =
+          _source.verticalAngleMin + row * verticalStep;
+      directions[k * 3u] =
+          static_cast<float>(std::cos(rayInclination) * std::cos(rayAzimuth));
+      directions[k * 3u + 1u] =
+          static_cast<float>(std::cos(rayInclination) * std::sin(rayAzimuth));
+      directions[k * 3u + 2u] = static_cast<float>(std::sin(rayInclination));
+    }
+  }
+
+  this->dataPtr->offset = _offset;
+  this->dataPtr->origin = _offset.Pos();
+  this->dataPtr->sameOrigin = _offset.Pos() == math::Vector3d::Zero;
+  this->dataPtr->indices.swap(indices);
+  this->dataPtr->directions.swap(directions);
+  return true;
+}
+
+//////////////////////////////////////////////////
+void LidarResampler::Clear()
+{
+  this->dataPtr->offset = math::Pose3d::Zero;
+  this->dataPtr->indices.clear();
+  this->dataPtr->directions.clear();
+}
+
+//////////////////////////////////////////////////
+bool LidarResampler::Configured() const
+{
+  return !this->dataPtr->indices.empty();
+}
+
+//////////////////////////////////////////////////
+const math::Pose3d &LidarResampler::Offset() const
+{
+  return this->dataPtr->offset;
+}
+
+//////////////////////////////////////////////////
+bool LidarResampler::Resample(const float *_source, const double _rangeMin,
+    const double _rangeMax, float *_target) const
+{
+  if (!this->Configured())
+    return false;
+
+  IGN_PROFILE("LidarResampler::Resample");
+  const float inf = std::numeric_limits<float>::infinity();
+  const float originX = static_cast<float>(this->dataPtr->origin.X());
+  const float originY = static_cast<float>(this->dataPtr->origin.Y());
+  const float originZ = static_cast<float>(this->dataPtr->origin.Z());
+  const std::size_t count = this->dataPtr->indices.size();
+  const uint32_t *index = this->dataPtr->indices.data();
+  const float *direction = this->dataPtr->directions.data();
+  for (std::size_t k = 0u; k < count; ++k, direction += 3, _target += 3)
+  {
+    const float *ray = _source + index[k] * 3u;
+    float range = ray[0];
+    if (std::isfinite(range))
+    {
+      if (!this->dataPtr->sameOrigin)
+      {
+        // Distance from the target origin to the point hit by the ray
+        const float x = range * direction[0] - originX;
+        const float y = range * direction[1] - originY;
+        const float z = range * direction[2] - originZ;
+        range = std::sqrt(x * x + y * y + z * z);
+      }
+      if (range < _rangeMin)
+        range = -inf;
+      else if (range > _rangeMax)
+        range = inf;
+    }
+    _target[0] = range;
+    _target[1] = ray[1];
+    _target[2] = ray[2];
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t LidarResampler::OutputSize() const
+{
+  return this->dataPtr->indices.size() * 3u;
+}
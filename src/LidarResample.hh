@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_LIDARRESAMPLE_HH_
+#define IGNITION_SENSORS_LIDARRESAMPLE_HH_
+
+#include <cstddef>
+#include <memory>
+
+#include <ignition/math/Pose3.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class LidarResamplerPrivate;
+
+    /// \brief Angle limits and number of rays of a lidar scan. Rays are
+    /// evenly spaced between the limits, row by row from the lowest
+    /// inclination, like the buffers filled by rendering::GpuRays.
+    struct LidarRayPattern
+    {
+      /// \brief Minimum azimuth, in radians
+      double angleMin = 0.0;
+
+      /// \brief Maximum azimuth, in radians
+      double angleMax = 0.0;
+
+      /// \brief Minimum inclination, in radians
+      double verticalAngleMin = 0.0;
+
+      /// \brief Maximum inclination, in radians
+      double verticalAngleMax = 0.0;
+
+      /// \brief Number of rays in a row
+      unsigned int width = 0u;
+
+      /// \brief Number of rows
+      unsigned int height = 0u;
+    };
+
+    /// \brief Samples the scan of a lidar from the scan of another lidar
+    /// mounted close to it. Every ray of the target is mapped once, by
+    /// Configure(), to the source ray with the nearest direction. The range
+    /// of a target ray is the distance from the target origin to the point
+    /// hit by its source ray, so small mounting offsets are compensated for,
+    /// but surfaces only visible from the target origin are missed.
+    class IGNITION_SENSORS_VISIBLE LidarResampler
+    {
+      /// \brief Constructor
+      public: LidarResampler();
+
+      /// \brief Destructor
+      public: ~LidarResampler();
+
+      /// \brief Map the rays of the target scan to the rays of the source.
+      /// \param[in] _source Rays of the source scan.
+      /// \param[in] _target Rays of the target scan.
+      /// \param[in] _offset Pose of the target lidar in the frame of the
+      /// source lidar.
+      /// \return False if a pattern has no rays or a target ray points
+      /// outside of the source scan, in which case the previous mapping is
+      /// kept.
+      public: bool Configure(const LidarRayPattern &_source,
+                  const LidarRayPattern &_target,
+                  const math::Pose3d &_offset);
+
+      /// \brief Forget the mapping of the rays.
+      public: void Clear();
+
+      /// \brief Get whether Configure() was called successfully.
+      /// \return True if Resample() can be called.
+      public: bool Configured() const;
+
+      /// \brief Get the pose of the target the rays were mapped for.
+      /// \return Pose of the target in the frame of the source.
+      public: const math::Pose3d &Offset() const;
+
+      /// \brief Sample a target scan. The range, intensity and retro values
+      /// of each target ray are those of its source ray, with the range
+      /// measured from the target origin. Finite ranges outside of the
+      /// target limits are set to -inf and +inf, as per REP 117.
+      /// \param[in] _source Source scan, 3 values per source ray.
+      /// \param[in] _rangeMin Minimum range of the target.
+      /// \param[in] _rangeMax Maximum range of the target.
+      /// \param[out] _target Target scan. It must hold OutputSize() values.
+      /// \return False if not configured.
+      public: bool Resample(const float *_source, const double _rangeMin,
+                  const double _rangeMax, float *_target) const;
+
+      /// \brief Get the number of values of target scans.
+      /// \return Number of floats, or 0 if not configured.
+      public: std::size_t OutputSize() const;
+
+      /// \brief Private data pointer
+      private: std::unique_ptr<LidarResamplerPrivate> dataPtr;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <ignition/math/Helpers.hh>
+
+#include "LidarResample.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Make a ray pattern.
+LidarRayPattern Pattern(const double _angleMin, const double _angleMax,
+    const unsigned int _width, const double _verticalAngleMin,
+    const double _verticalAngleMax, const unsigned int _height)
+{
+  LidarRayPattern pattern;
+  pattern.angleMin = _angleMin;
+  pattern.angleMax = _angleMax;
+  pattern.width = _width;
+  pattern.verticalAngleMin = _verticalAngleMin;
+  pattern.verticalAngleMax = _verticalAngleMax;
+  pattern.height = _height;
+  return pattern;
+}
+
+//////////////////////////////////////////////////
+TEST(LidarResample, Configure)
+{
+  LidarResampler resampler;
+  EXPECT_FALSE(resampler.Configured());
+  EXPECT_EQ(0u, resampler.OutputSize());
+  EXPECT_FALSE(resampler.Resample(nullptr, 0.0, 1.0, nullptr));
+
+  const LidarRayPattern source = Pattern(-1.0, 1.0, 21u, -0.2, 0.2, 5u);
+  EXPECT_FALSE(resampler.Configure(source,
+      Pattern(-1.0, 1.0, 0u, 0.0, 0.0, 1u), math::Pose3d::Zero));
+
+  // Rays beyond the source azimuth or inclination
+  EXPECT_FALSE(resampler.Configure(source,
+      Pattern(-1.2, 1.0, 11u, 0.0, 0.0, 1u), math::Pose3d::Zero));
+  EXPECT_FALSE(resampler.Configure(source,
+      Pattern(-1.0, 1.0, 11u, 0.0, 0.0, 1u),
+      math::Pose3d(0, 0, 0, 0, 0.5, 0)));
+  EXPECT_FALSE(resampler.Configured());
+
+  EXPECT_TRUE(resampler.Configure(source,
+      Pattern(-0.5, 0.5, 11u, -0.1, 0.1, 3u),
+      math::Pose3d(0.01, 0, 0, 0, 0, 0.2)));
+  EXPECT_TRUE(resampler.Configured());
+  EXPECT_EQ(11u * 3u * 3u, resampler.OutputSize());
+  EXPECT_EQ(math::Pose3d(0.01, 0, 0, 0, 0, 0.2), resampler.Offset());
+
+  // A failure keeps the previous mapping
+  EXPECT_FALSE(resampler.Configure(source,
+      Pattern(-1.2, 1.0, 11u, 0.0, 0.0, 1u), math::Pose3d::Zero));
+  EXPECT_TRUE(resampler.Configured());
+  EXPECT_EQ(11u * 3u * 3u, resampler.OutputSize());
+
+  resampler.Clear();
+  EXPECT_FALSE(resampler.Configured());
+
+  // A full turn source covers any yaw
+  EXPECT_TRUE(resampler.Configure(
+      Pattern(-IGN_PI, IGN_PI, 361u, 0.0, 0.0, 1u),
+      Pattern(-1.0, 1.0, 21u, 0.0, 0.0, 1u),
+      math::Pose3d(0, 0, 0, 0, 0, 3.0)));
+}
+
+//////////////////////////////////////////////////
+TEST(LidarResample, SamePattern)
+{
+  // Same rays and origin, the scan is copied
+  const LidarRayPattern pattern = Pattern(-1.0, 1.0, 5u, -0.1, 0.1, 2u);
+  LidarResampler resampler;
+  ASSERT_TRUE(resampler.Configure(pattern, pattern, math::Pose3d::Zero));
+
+  std::vector<float> source(5u * 2u * 3u);
+  for (std::size_t i = 0u; i < source.size(); ++i)
+    source[i] = 1.0f + static_cast<float>(i);
+  std::vector<float> target(resampler.OutputSize());
+  ASSERT_TRUE(resampler.Resample(source.data(), 0.0, 100.0, target.data()));
+  for (std::size_t i = 0u; i < source.size(); ++i)
+    EXPECT_FLOAT_EQ(source[i], target[i]) << i;
+}
+
+//////////////////////////////////////////////////
+TEST(LidarResample, Offset)
+{
+  // A single row source with a ray every degree, sampled by a lidar
+  // rotated by 10 degrees and mounted 5 cm ahead
+  const LidarRayPattern source =
+      Pattern(-IGN_PI / 2, IGN_PI / 2, 181u, 0.0, 0.0, 1u);
+  const LidarRayPattern target = Pattern(-0.5, 0.5, 3u, 0.0, 0.0, 1u);
+  LidarResampler resampler;
+  ASSERT_TRUE(resampler.Configure(source, target,
+      math::Pose3d(0.05, 0, 0, 0, 0, IGN_DTOR(10))));
+
+  // Wall 2 m ahead of the source
+  std::vector<float> scan(181u * 3u);
+  for (unsigned int i = 0u; i < 181u; ++i)
+  {
+    const double azimuth = -IGN_PI / 2 + IGN_DTOR(i);
+    scan[i * 3u] = static_cast<float>(2.0 / std::cos(azimuth));
+    scan[i * 3u + 1u] = static_cast<float>(i);
+    scan[i * 3u + 2u] = 0.0f;
+  }
+
+  std::vector<float> ranges(resampler.OutputSize());
+  ASSERT_TRUE(resampler.Resample(scan.data(), 0.1, 10.0, ranges.data()));
+  for (unsigned int i = 0u; i < 3u; ++i)
+  {
+    // The nearest source ray is within half a degree of the target ray
+    const double azimuth = -0.5 + i * 0.5 + IGN_DTOR(10);
+    const int column = static_cast<int>(
+        std::round(IGN_RTOD(azimuth + IGN_PI / 2)));
+    EXPECT_FLOAT_EQ(static_cast<float>(column), ranges[i * 3u + 1u]);
+
+    // The range is measured from the target origin
+    const double sourceAzimuth = -IGN_PI / 2 + IGN_DTOR(column);
+    const double x = 2.0 - 0.05;
+    const double y = 2.0 * std::tan(sourceAzimuth);
+    EXPECT_NEAR(std::sqrt(x * x + y * y), ranges[i * 3u], 1e-4);
+  }
+
+  // Ranges beyond the target limits
+  ASSERT_TRUE(resampler.Resample(scan.data(), 0.1, 1.5, ranges.data()));
+  EXPECT_TRUE(std::isinf(ranges[0]) && ranges[0] > 0.0f);
+  ASSERT_TRUE(resampler.Resample(scan.data(), 5.0, 10.0, ranges.data()));
+  EXPECT_TRUE(std::isinf(ranges[0]) && ranges[0] < 0.0f);
+
+  // Rays without returns stay infinite
+  for (unsigned int i = 0u; i < 181u; ++i)
+    scan[i * 3u] = std::numeric_limits<float>::infinity();
+  ASSERT_TRUE(resampler.Resample(scan.data(), 0.1, 10.0, ranges.data()));
+  EXPECT_TRUE(std::isinf(ranges[3]) && ranges[3] > 0.0f);
+}
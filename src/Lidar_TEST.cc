@@ -17,8 +17,20 @@
 #include <gtest/gtest.h>
 #include <sdf/sdf.hh>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <ignition/math/Angle.hh>
 #include <ignition/math/Helpers.hh>
+#include <ignition/transport/Node.hh>
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
@@ -31,6 +43,7 @@
 
 #include <ignition/sensors/Export.hh>
 #include <ignition/sensors/Manager.hh>
+#include <ignition/sensors/CpuLidarSensor.hh>
 #include <ignition/sensors/Lidar.hh>
 
 sdf::ElementPtr LidarToSDF(const std::string &name, double update_rate,
@@ -38,7 +51,7 @@ sdf::ElementPtr LidarToSDF(const std::string &name, double update_rate,
     double horz_min_angle, double horz_max_angle, double vert_samples,
     double vert_resolution, double vert_min_angle, double vert_max_angle,
     double range_resolution, double range_min, double range_max,
-    bool always_on, bool visualize)
+    bool always_on, bool visualize, const std::string &extra = "")
 {
   std::ostringstream stream;
   stream
@@ -72,6 +85,7 @@ sdf::ElementPtr LidarToSDF(const std::string &name, double update_rate,
     << "      </ray>"
     << "      <always_on>"<< always_on <<"</always_on>"
     << "      <visualize>" << visualize << "</visualize>"
+    << extra
     << "    </sensor>"
     << "  </link>"
     << " </model>"
@@ -162,6 +176,286 @@ TEST(Lidar_TEST, CreateLaser)
   EXPECT_TRUE(sensor->IsActive());
 }
 
+/////////////////////////////////////////////////
+/// \brief Test ray casting of a CPU lidar
+TEST(Lidar_TEST, CpuLidar)
+{
+  ignition::sensors::Manager mgr;
+
+  sdf::ElementPtr lidarSDF = LidarToSDF("TestCpuLidar", 10,
+    "/ignition/sensors/test/cpu_lidar", 11, 1, -0.5, 0.5, 3, 1, -0.1, 0.1,
+    0.01, 0.1, 10.0, true, false);
+
+  // Lidar sensors cast rays on the CPU
+  auto *sensor = mgr.CreateSensor<ignition::sensors::CpuLidarSensor>(
+      lidarSDF);
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_FALSE(sensor->IsRenderingSensor());
+
+  // Nothing to hit
+  ASSERT_TRUE(sensor->Update(std::chrono::steady_clock::duration::zero()));
+  ASSERT_NE(nullptr, sensor->laserBuffer);
+  for (unsigned int i = 0; i < 11u * 3u; ++i)
+    EXPECT_TRUE(std::isinf(sensor->laserBuffer[i * 3])) << i;
+
+  // A wall 4 m ahead, made of two triangles
+  std::vector<ignition::math::Vector3d> vertices = {
+    {0, -5, -5}, {0, 5, -5}, {0, 5, 5}, {0, -5, 5}};
+  EXPECT_FALSE(sensor->SetMesh("wall", vertices, {0, 1, 4}));
+  EXPECT_TRUE(sensor->SetMesh("wall", vertices, {0, 1, 2, 0, 2, 3}, 0.5));
+  EXPECT_EQ(1u, sensor->MeshCount());
+  EXPECT_TRUE(sensor->SetMeshPose("wall",
+      ignition::math::Pose3d(4, 0, 0, 0, 0, 0)));
+
+  int frames = 0;
+  auto connection = sensor->ConnectNewLidarFrame(
+      [&frames](const float *, unsigned int _width, unsigned int _height,
+          unsigned int _channels, const std::string &)
+      {
+        EXPECT_EQ(11u, _width);
+        EXPECT_EQ(3u, _height);
+        EXPECT_EQ(3u, _channels);
+        ++frames;
+      });
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(1)));
+  EXPECT_EQ(1, frames);
+
+  const double angleStep = 1.0 / 10.0;
+  const double verticalStep = 0.2 / 2.0;
+  for (unsigned int j = 0; j < 3u; ++j)
+  {
+    for (unsigned int i = 0; i < 11u; ++i)
+    {
+      const double azimuth = -0.5 + i * angleStep;
+      const double inclination = -0.1 + j * verticalStep;
+      const float *ray = sensor->laserBuffer + (j * 11u + i) * 3u;
+      EXPECT_NEAR(4.0 / std::cos(azimuth) / std::cos(inclination), ray[0],
+          1e-4);
+      EXPECT_FLOAT_EQ(0.5f, ray[1]);
+    }
+  }
+  EXPECT_NEAR(4.0 / std::cos(0.5) / std::cos(0.1), sensor->Range(0), 1e-4);
+
+  // Out of range
+  EXPECT_TRUE(sensor->SetMeshPose("wall",
+      ignition::math::Pose3d(20, 0, 0, 0, 0, 0)));
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(2)));
+  EXPECT_TRUE(std::isinf(sensor->laserBuffer[0]));
+
+  EXPECT_TRUE(sensor->RemoveMesh("wall"));
+  EXPECT_FALSE(sensor->RemoveMesh("wall"));
+  EXPECT_EQ(0u, sensor->MeshCount());
+}
+
+/////////////////////////////////////////////////
+/// \brief Test the output modes of the laser scans
+TEST(Lidar_TEST, ScanOutput)
+{
+  ignition::sensors::Manager mgr;
+
+  sdf::ElementPtr lidarSDF = LidarToSDF("TestScanOutput", 10,
+    "/ignition/sensors/test/scan_output", 11, 1, -0.5, 0.5, 3, 1, -0.1, 0.1,
+    0.01, 0.1, 10.0, true, false,
+    "<ignition:scan_output>Disabled</ignition:scan_output>");
+
+  auto *sensor = mgr.CreateSensor<ignition::sensors::CpuLidarSensor>(
+      lidarSDF);
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(ignition::sensors::LidarOutputMode::DISABLED,
+      sensor->ScanOutput());
+
+  // Disabled scans aren't produced, but the buffer is still filled
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(1)));
+  ASSERT_NE(nullptr, sensor->laserBuffer);
+  EXPECT_EQ(nullptr, sensor->LaserScanSnapshot());
+  EXPECT_FALSE(sensor->HasConnections());
+
+  sensor->SetScanOutput(ignition::sensors::LidarOutputMode::ENABLED);
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(2)));
+  auto scan = sensor->LaserScanSnapshot();
+  ASSERT_NE(nullptr, scan);
+  EXPECT_EQ(2, scan->header().stamp().sec());
+
+  // Without subscribers, automatic scans keep the latest one
+  sensor->SetScanOutput(ignition::sensors::LidarOutputMode::AUTO);
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(3)));
+  EXPECT_EQ(scan, sensor->LaserScanSnapshot());
+
+  ignition::transport::Node node;
+  std::function<void(const ignition::msgs::LaserScan &)> cb =
+      [](const ignition::msgs::LaserScan &) {};
+  ASSERT_TRUE(node.Subscribe("/ignition/sensors/test/scan_output", cb));
+  for (int sleep = 0; sleep < 100 && !sensor->HasConnections(); ++sleep)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ASSERT_TRUE(sensor->HasConnections());
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(4)));
+  ASSERT_NE(scan, sensor->LaserScanSnapshot());
+  EXPECT_EQ(4, sensor->LaserScanSnapshot()->header().stamp().sec());
+}
+
+/////////////////////////////////////////////////
+/// \brief Test the number of threads applying noise
+TEST(Lidar_TEST, NoiseThreads)
+{
+  ignition::sensors::Manager mgr;
+
+  // Noise is applied by the updating thread unless asked for
+  auto *sensor = mgr.CreateSensor<ignition::sensors::CpuLidarSensor>(
+      LidarToSDF("TestNoiseThreadsDefault", 10,
+      "/ignition/sensors/test/noise_threads_default", 11, 1, -0.5, 0.5, 3,
+      1, -0.1, 0.1, 0.01, 0.1, 10.0, true, false));
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(1u, sensor->NoiseThreadCount());
+  sensor->SetNoiseThreadCount(0u);
+  EXPECT_EQ(std::max(1u, std::thread::hardware_concurrency()),
+      sensor->NoiseThreadCount());
+
+  sensor = mgr.CreateSensor<ignition::sensors::CpuLidarSensor>(
+      LidarToSDF("TestNoiseThreads", 10,
+      "/ignition/sensors/test/noise_threads", 11, 1, -0.5, 0.5, 3, 1, -0.1,
+      0.1, 0.01, 0.1, 10.0, true, false,
+      "<ignition:noise_threads>3</ignition:noise_threads>"));
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(3u, sensor->NoiseThreadCount());
+  ASSERT_TRUE(sensor->Update(std::chrono::seconds(1)));
+}
+
+/////////////////////////////////////////////////
+/// \brief Test the compact scans
+TEST(Lidar_TEST, PackedOutput)
+{
+  ignition::sensors::Manager mgr;
+
+  sdf::ElementPtr lidarSDF = LidarToSDF("TestPackedOutput", 10,
+    "/ignition/sensors/test/packed_output", 11, 1, -0.5, 0.5, 3, 1, -0.1,
+    0.1, 0.01, 0.1, 10.0, true, false,
+    "<ignition:packed_output>Enabled</ignition:packed_output>"
+    "<ignition:packed_intensity_bits>16</ignition:packed_intensity_bits>");
+
+  auto *sensor = mgr.CreateSensor<ignition::sensors::CpuLidarSensor>(
+      lidarSDF);
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(ignition::sensors::LidarOutputMode::ENABLED,
+      sensor->PackedOutput());
+  EXPECT_EQ(16u, sensor->PackedIntensityBits());
+  EXPECT_FALSE(sensor->SetPackedIntensityBits(12u));
+  EXPECT_EQ(16u, sensor->PackedIntensityBits());
+  EXPECT_DOUBLE_EQ(0.01, sensor->PackedRangeResolution());
+
+  // A wall 4 m ahead
+  std::vector<ignition::math::Vector3d> vertices = {
+    {0, -5, -5}, {0, 5, -5}, {0, 5, 5}, {0, -5, 5}};
+  EXPECT_TRUE(sensor->SetMesh("wall", vertices, {0, 1, 2, 0, 2, 3}, 300.4));
+  EXPECT_TRUE(sensor->SetMeshPose("wall",
+      ignition::math::Pose3d(4, 0, 0, 0, 0, 0)));
+
+  std::mutex mutex;
+  ignition::msgs::PointCloudPacked packed;
+  bool received = false;
+  ignition::transport::Node node;
+  std::function<void(const ignition::msgs::PointCloudPacked &)> cb =
+      [&](const ignition::msgs::PointCloudPacked &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        packed = _msg;
+        received = true;
+      };
+  ASSERT_TRUE(node.Subscribe("/ignition/sensors/test/packed_output/packed",
+      cb));
+
+  int seconds = 0;
+  auto update = [&]()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      received = false;
+    }
+    for (int sleep = 0; sleep < 100; ++sleep)
+    {
+      EXPECT_TRUE(sensor->Update(std::chrono::seconds(++seconds)));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      std::lock_guard<std::mutex> lock(mutex);
+      if (received)
+        return true;
+    }
+    return false;
+  };
+
+  ASSERT_TRUE(update());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ(11u, packed.width());
+    EXPECT_EQ(3u, packed.height());
+    EXPECT_EQ(4u, packed.point_step());
+    EXPECT_EQ(44u, packed.row_step());
+    ASSERT_EQ(2, packed.field_size());
+    EXPECT_EQ("range", packed.field(0).name());
+    EXPECT_EQ(ignition::msgs::PointCloudPacked::Field::UINT16,
+        packed.field(0).datatype());
+    EXPECT_EQ("intensity", packed.field(1).name());
+    EXPECT_EQ(2u, packed.field(1).offset());
+    ASSERT_EQ(11u * 3u * 4u, packed.data().size());
+
+    // Ranges are in multiples of the range resolution of the sensor
+    for (unsigned int i = 0; i < 11u * 3u; ++i)
+    {
+      uint16_t range;
+      uint16_t intensity;
+      std::memcpy(&range, packed.data().data() + i * 4u, sizeof(range));
+      std::memcpy(&intensity, packed.data().data() + i * 4u + 2u,
+          sizeof(intensity));
+      EXPECT_NEAR(sensor->laserBuffer[i * 3] * 100.0, range, 0.5) << i;
+      EXPECT_EQ(300u, intensity) << i;
+    }
+
+    // The geometry is in the header with full precision
+    auto headerValue = [&packed](const std::string &_key)
+    {
+      for (const auto &entry : packed.header().data())
+      {
+        if (entry.key() == _key && entry.value_size() == 1)
+          return std::stod(entry.value(0));
+      }
+      return std::nan("");
+    };
+    EXPECT_EQ(sensor->PackedRangeResolution(),
+        headerValue("range_resolution"));
+    EXPECT_EQ(sensor->RangeMin(), headerValue("range_min"));
+    EXPECT_EQ(sensor->RangeMax(), headerValue("range_max"));
+    EXPECT_EQ(sensor->AngleMin().Radian(), headerValue("angle_min"));
+    EXPECT_EQ(sensor->AngleMax().Radian(), headerValue("angle_max"));
+    EXPECT_EQ(sensor->VerticalAngleMin().Radian(),
+        headerValue("vertical_angle_min"));
+    EXPECT_EQ(sensor->VerticalAngleMax().Radian(),
+        headerValue("vertical_angle_max"));
+  }
+
+  // Without intensities, rays without a hit have the largest range
+  EXPECT_TRUE(sensor->SetPackedIntensityBits(0u));
+  EXPECT_TRUE(sensor->SetMeshPose("wall",
+      ignition::math::Pose3d(20, 0, 0, 0, 0, 0)));
+  ASSERT_TRUE(update());
+  std::lock_guard<std::mutex> lock(mutex);
+  EXPECT_EQ(2u, packed.point_step());
+  ASSERT_EQ(1, packed.field_size());
+  ASSERT_EQ(11u * 3u * 2u, packed.data().size());
+  uint16_t range;
+  std::memcpy(&range, packed.data().data(), sizeof(range));
+  EXPECT_EQ(65535u, range);
+
+  // The header entries are kept, not added again
+  int geometryEntries = 0;
+  for (const auto &entry : packed.header().data())
+  {
+    if (entry.key().find("angle") != std::string::npos ||
+        entry.key().find("range") != std::string::npos)
+    {
+      ++geometryEntries;
+    }
+  }
+  EXPECT_EQ(7, geometryEntries);
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -15,9 +15,14 @@
  *
 */
 
+#include <algorithm>
+#include <cmath>
 #include <mutex>
+#include <utility>
+#include <vector>
 
 #include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
 
 #include <ignition/transport/Node.hh>
@@ -28,18 +33,42 @@
 #include "ignition/sensors/SensorFactory.hh"
 #include "ignition/sensors/LogicalCameraSensor.hh"
 
+#include "ModelGrid.hh"
+#include "SnapshotBuffer.hh"
+
 using namespace ignition;
 using namespace sensors;
 
+/// \brief Header key of delta messages
+static const char kDeltaKey[] = "delta";
+
+/// \brief Header key of the models removed by a delta message
+static const char kRemovedKey[] = "removed";
+
 /// \brief Private data for LogicalCameraSensor
 class ignition::sensors::LogicalCameraSensorPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
+  /// \brief Fill deltaMsg with the changes of msg since the models were
+  /// last published, or make the next message a keyframe.
+  /// \return True if deltaMsg is to be published, false to publish msg as
+  /// a keyframe.
+  public: bool BuildDelta();
+
+  /// \brief Get whether a model moved enough to be published again.
+  /// \param[in] _published Pose last published
+  /// \param[in] _pose Current pose
+  /// \return True if the pose changed more than the tolerances.
+  public: bool Moved(const math::Pose3d &_published,
+              const math::Pose3d &_pose) const;
 
   /// \brief publisher to publish logical camera messages.
   public: transport::Node::Publisher pub;
 
+  /// \brief Event that is used to trigger callbacks when a new message
+  /// is generated
+  public: ignition::common::EventT<
+          void(const ignition::msgs::LogicalCameraImage &)> dataEvent;
+
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
 
@@ -55,10 +84,134 @@ class ignition::sensors::LogicalCameraSensorPrivate
   /// \brief List of models in the world
   public: std::map<std::string, math::Pose3d> models;
 
+  /// \brief Positions of the models, bucketed so that only the models
+  /// around the frustum are tested against it
+  public: ModelGrid<std::string> grid;
+
+  /// \brief Models shared with other sensors, used instead of models
+  /// when set
+  public: std::shared_ptr<const ModelPoseSnapshot> modelSnapshot;
+
+  /// \brief Indices of the snapshot models around the frustum
+  public: std::vector<std::size_t> candidates;
+
+  /// \brief Name and world pose of the models found in the frustum during
+  /// the last update
+  public: std::vector<std::pair<const std::string *, const math::Pose3d *>>
+          hits;
+
   /// \brief Msg containg info on models detected by logical camera
   ignition::msgs::LogicalCameraImage msg;
+
+  /// \brief Latest image, readable without locking mutex
+  public: SnapshotBuffer<msgs::LogicalCameraImage> snapshot;
+
+  /// \brief True to publish the changes of the images only
+  public: bool deltaPublishing = false;
+
+  /// \brief Distance a model must move to be published again
+  public: double positionTolerance = 0.01;
+
+  /// \brief Angle a model must turn to be published again
+  public: double angleTolerance = 0.01;
+
+  /// \brief Number of messages from one keyframe to the next
+  public: unsigned int keyframeInterval = 30u;
+
+  /// \brief Number of messages published since the last keyframe, the
+  /// next message is a keyframe when it reaches keyframeInterval
+  public: unsigned int sinceKeyframe = 0u;
+
+  /// \brief True if no keyframe was published yet
+  public: bool needKeyframe = true;
+
+  /// \brief Models as last published, sorted by name, with their poses
+  /// relative to the sensor
+  public: std::vector<std::pair<std::string, math::Pose3d>> published;
+
+  /// \brief Scratch buffer for the next content of published
+  public: std::vector<std::pair<std::string, math::Pose3d>> nextPublished;
+
+  /// \brief Delta message, reused between updates
+  public: msgs::LogicalCameraImage deltaMsg;
+
+  /// \brief Image rebuilt from replayed delta messages, for the callbacks
+  public: msgs::LogicalCameraImage replayImage;
 };
 
+//////////////////////////////////////////////////
+bool LogicalCameraSensorPrivate::Moved(const math::Pose3d &_published,
+    const math::Pose3d &_pose) const
+{
+  if (_published.Pos().Distance(_pose.Pos()) > this->positionTolerance)
+    return true;
+
+  // Angle of the rotation from one orientation to the other
+  const double w = std::min(1.0, std::abs(
+      (_published.Rot().Inverse() * _pose.Rot()).W()));
+  return 2.0 * std::acos(w) > this->angleTolerance;
+}
+
+//////////////////////////////////////////////////
+bool LogicalCameraSensorPrivate::BuildDelta()
+{
+  const bool keyframe = this->needKeyframe ||
+      ++this->sinceKeyframe >= this->keyframeInterval;
+  auto &next = this->nextPublished;
+  next.clear();
+  if (keyframe)
+  {
+    for (const auto &model : this->msg.model())
+      next.emplace_back(model.name(), msgs::Convert(model.pose()));
+    this->published.swap(next);
+    this->sinceKeyframe = 0u;
+    this->needKeyframe = false;
+    return false;
+  }
+
+  // Both lists are sorted by name, so walking them side by side finds the
+  // models that entered, left or moved
+  auto &delta = this->deltaMsg;
+  delta.clear_model();
+  delta.mutable_pose()->CopyFrom(this->msg.pose());
+  delta.mutable_header()->CopyFrom(this->msg.header());
+  delta.mutable_header()->add_data()->set_key(kDeltaKey);
+  auto removed = delta.mutable_header()->add_data();
+  removed->set_key(kRemovedKey);
+
+  auto oldIt = this->published.begin();
+  const auto oldEnd = this->published.end();
+  for (const auto &model : this->msg.model())
+  {
+    while (oldIt != oldEnd && oldIt->first < model.name())
+    {
+      removed->add_value(oldIt->first);
+      ++oldIt;
+    }
+
+    const math::Pose3d pose = msgs::Convert(model.pose());
+    if (oldIt != oldEnd && oldIt->first == model.name())
+    {
+      if (!this->Moved(oldIt->second, pose))
+      {
+        next.push_back(std::move(*oldIt));
+        ++oldIt;
+        continue;
+      }
+      ++oldIt;
+    }
+    next.emplace_back(model.name(), pose);
+    delta.add_model()->CopyFrom(model);
+  }
+  for (; oldIt != oldEnd; ++oldIt)
+    removed->add_value(oldIt->first);
+  if (removed->value_size() == 0)
+    delta.mutable_header()->mutable_data()->RemoveLast();
+
+  this->published.swap(next);
+  return true;
+}
+
 //////////////////////////////////////////////////
 LogicalCameraSensor::LogicalCameraSensor()
   : dataPtr(new LogicalCameraSensorPrivate())
@@ -101,6 +254,10 @@ bool LogicalCameraSensor::Load(sdf::ElementPtr _sdf)
   this->dataPtr->frustum.SetAspectRatio(
       cameraSdf->Get<double>("aspect_ratio"));
 
+  // Cells about as large as the frustum keep the number of cells visited
+  // by each query small
+  this->dataPtr->grid.SetCellSize(this->dataPtr->frustum.Far());
+
   if (!Sensor::Load(_sdf))
     return false;
 
@@ -108,7 +265,7 @@ bool LogicalCameraSensor::Load(sdf::ElementPtr _sdf)
     this->SetTopic("/logical_camera");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::LogicalCameraImage>(
+      this->TransportNode().Advertise<ignition::msgs::LogicalCameraImage>(
       this->Topic());
 
   if (!this->dataPtr->pub)
@@ -116,6 +273,7 @@ bool LogicalCameraSensor::Load(sdf::ElementPtr _sdf)
     ignerr << "Unable to create publisher on topic[" << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   this->dataPtr->initialized = true;
   return true;
@@ -125,7 +283,49 @@ bool LogicalCameraSensor::Load(sdf::ElementPtr _sdf)
 void LogicalCameraSensor::SetModelPoses(
     std::map<std::string, math::Pose3d> &&_models)
 {
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+
+  // Both maps are sorted by name, so walking them side by side finds the
+  // added, removed and moved models. Only those touch the grid.
+  auto &grid = this->dataPtr->grid;
+  auto oldIt = this->dataPtr->models.cbegin();
+  auto oldEnd = this->dataPtr->models.cend();
+  for (const auto &model : _models)
+  {
+    while (oldIt != oldEnd && oldIt->first < model.first)
+    {
+      grid.Remove(oldIt->first);
+      ++oldIt;
+    }
+    if (oldIt != oldEnd && oldIt->first == model.first)
+    {
+      if (oldIt->second.Pos() != model.second.Pos())
+        grid.Set(model.first, model.second.Pos());
+      ++oldIt;
+    }
+    else
+    {
+      grid.Set(model.first, model.second.Pos());
+    }
+  }
+  for (; oldIt != oldEnd; ++oldIt)
+    grid.Remove(oldIt->first);
+
   this->dataPtr->models = std::move(_models);
+  this->dataPtr->modelSnapshot.reset();
+}
+
+//////////////////////////////////////////////////
+void LogicalCameraSensor::SetModelPoseSnapshot(
+    std::shared_ptr<const ModelPoseSnapshot> _snapshot)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->modelSnapshot = std::move(_snapshot);
+  if (!this->dataPtr->models.empty())
+  {
+    this->dataPtr->models.clear();
+    this->dataPtr->grid.Clear();
+  }
 }
 
 //////////////////////////////////////////////////
@@ -153,27 +353,102 @@ bool LogicalCameraSensor::Update(
   // set frustum pose
   this->dataPtr->frustum.SetPose(this->Pose());
 
-  this->dataPtr->msg.clear_model();
-  for (const auto &it : this->dataPtr->models)
+  // Box around the corners of the frustum
+  const math::Pose3d &pose = this->Pose();
+  const auto &frustum = this->dataPtr->frustum;
+  const double tanHalfFov = std::tan(frustum.FOV().Radian() * 0.5);
+  math::Vector3d boxMin(math::INF_D, math::INF_D, math::INF_D);
+  math::Vector3d boxMax(-math::INF_D, -math::INF_D, -math::INF_D);
+  for (const double dist : {frustum.Near(), frustum.Far()})
   {
-    if (this->dataPtr->frustum.Contains(it.second.Pos()))
+    const double halfWidth = dist * tanHalfFov;
+    const double halfHeight = halfWidth / frustum.AspectRatio();
+    for (const double y : {-halfWidth, halfWidth})
     {
-      msgs::LogicalCameraImage::Model *modelMsg =
-          this->dataPtr->msg.add_model();
-      modelMsg->set_name(it.first);
-      msgs::Set(modelMsg->mutable_pose(), it.second - this->Pose());
+      for (const double z : {-halfHeight, halfHeight})
+      {
+        const math::Vector3d corner =
+            pose.Pos() + pose.Rot().RotateVector(math::Vector3d(dist, y, z));
+        boxMin.Min(corner);
+        boxMax.Max(corner);
+      }
     }
   }
-  *this->dataPtr->msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-  // Remove 'data' entries before adding new ones
-  this->dataPtr->msg.mutable_header()->clear_data();
-  auto frame = this->dataPtr->msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
+
+  // Only test the models around the frustum, then sort them by name so
+  // the message lists them in name order either way
+  auto &hits = this->dataPtr->hits;
+  hits.clear();
+  const auto &snapshot = this->dataPtr->modelSnapshot;
+  if (snapshot)
+  {
+    auto &candidates = this->dataPtr->candidates;
+    candidates.clear();
+    snapshot->Candidates(boxMin, boxMax, candidates);
+    for (const std::size_t index : candidates)
+    {
+      const math::Pose3d &modelPose = snapshot->Pose(index);
+      if (frustum.Contains(modelPose.Pos()))
+        hits.emplace_back(&snapshot->Name(index), &modelPose);
+    }
+  }
+  else
+  {
+    this->dataPtr->grid.Query(boxMin, boxMax,
+        [&](const std::string &_name)
+        {
+          auto it = this->dataPtr->models.find(_name);
+          if (it != this->dataPtr->models.end() &&
+              frustum.Contains(it->second.Pos()))
+          {
+            hits.emplace_back(&it->first, &it->second);
+          }
+        });
+  }
+  std::sort(hits.begin(), hits.end(),
+      [](const auto &_a, const auto &_b)
+      {
+        return *_a.first < *_b.first;
+      });
+
+  this->dataPtr->msg.clear_model();
+  for (const auto &hit : hits)
+  {
+    msgs::LogicalCameraImage::Model *modelMsg =
+        this->dataPtr->msg.add_model();
+    modelMsg->set_name(*hit.first);
+    msgs::Set(modelMsg->mutable_pose(), *hit.second - pose);
+  }
+  this->StampHeader(this->dataPtr->msg.mutable_header(), _now);
+
+  // Make the new image visible to other threads
+  this->dataPtr->snapshot.Back().CopyFrom(this->dataPtr->msg);
+  this->dataPtr->snapshot.Publish();
 
   // publish
-  this->AddSequence(this->dataPtr->msg.mutable_header());
-  this->dataPtr->pub.Publish(this->dataPtr->msg);
+  if (this->HasConsumers(this->dataPtr->pub))
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    const msgs::LogicalCameraImage &out =
+        this->dataPtr->deltaPublishing && this->dataPtr->BuildDelta() ?
+        this->dataPtr->deltaMsg : this->dataPtr->msg;
+    this->Publish(this->dataPtr->pub, out);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(out.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(this->dataPtr->msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in a logical camera callback.\n";
+    }
+  }
 
   return true;
 }
@@ -204,9 +479,136 @@ double LogicalCameraSensor::AspectRatio() const
 
 //////////////////////////////////////////////////
 msgs::LogicalCameraImage LogicalCameraSensor::Image() const
+{
+  auto image = this->dataPtr->snapshot.Latest();
+  return image ? *image : msgs::LogicalCameraImage();
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<const msgs::LogicalCameraImage>
+    LogicalCameraSensor::ImageSnapshot() const
+{
+  return this->dataPtr->snapshot.Latest();
+}
+
+//////////////////////////////////////////////////
+bool LogicalCameraSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->dataPtr->dataEvent.ConnectionCount() > 0;
+}
+
+//////////////////////////////////////////////////
+bool LogicalCameraSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::LogicalCameraImage *>(&_msg);
+  if (!msg || _topic != this->Topic())
+    return true;
+
+  // Callbacks get full images, also from recorded delta messages
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  ApplyDelta(*msg, this->dataPtr->replayImage);
+  if (this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(this->dataPtr->replayImage);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in a logical camera callback.\n";
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+void LogicalCameraSensor::SetDeltaPublishing(const bool _delta,
+    const double _positionTolerance, const double _angleTolerance,
+    const unsigned int _keyframeInterval)
 {
   std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-  return this->dataPtr->msg;
+  this->dataPtr->deltaPublishing = _delta;
+  this->dataPtr->positionTolerance = std::max(0.0, _positionTolerance);
+  this->dataPtr->angleTolerance = std::max(0.0, _angleTolerance);
+  this->dataPtr->keyframeInterval = std::max(_keyframeInterval, 1u);
+  this->dataPtr->needKeyframe = true;
+}
+
+//////////////////////////////////////////////////
+bool LogicalCameraSensor::DeltaPublishing() const
+{
+  return this->dataPtr->deltaPublishing;
+}
+
+//////////////////////////////////////////////////
+void LogicalCameraSensor::ApplyDelta(const msgs::LogicalCameraImage &_msg,
+    msgs::LogicalCameraImage &_image)
+{
+  const msgs::Header::Map *removed = nullptr;
+  bool delta = false;
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == kDeltaKey)
+      delta = true;
+    else if (data.key() == kRemovedKey)
+      removed = &data;
+  }
+  if (!delta)
+  {
+    _image.CopyFrom(_msg);
+    return;
+  }
+
+  // Merge the sorted lists of models, dropping the removed ones
+  msgs::LogicalCameraImage image;
+  image.mutable_pose()->CopyFrom(_msg.pose());
+  image.mutable_header()->CopyFrom(_msg.header());
+  auto data = image.mutable_header()->mutable_data();
+  for (int i = data->size() - 1; i >= 0; --i)
+  {
+    const std::string &key = data->Get(i).key();
+    if (key == kDeltaKey || key == kRemovedKey)
+      data->DeleteSubrange(i, 1);
+  }
+
+  auto isRemoved = [removed](const std::string &_name)
+  {
+    return removed && std::find(removed->value().begin(),
+        removed->value().end(), _name) != removed->value().end();
+  };
+
+  int oldIndex = 0;
+  const int oldCount = _image.model_size();
+  for (const auto &model : _msg.model())
+  {
+    for (; oldIndex < oldCount &&
+        _image.model(oldIndex).name() < model.name(); ++oldIndex)
+    {
+      if (!isRemoved(_image.model(oldIndex).name()))
+        image.add_model()->CopyFrom(_image.model(oldIndex));
+    }
+    if (oldIndex < oldCount && _image.model(oldIndex).name() == model.name())
+      ++oldIndex;
+    image.add_model()->CopyFrom(model);
+  }
+  for (; oldIndex < oldCount; ++oldIndex)
+  {
+    if (!isRemoved(_image.model(oldIndex).name()))
+      image.add_model()->CopyFrom(_image.model(oldIndex));
+  }
+  _image.Swap(&image);
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr LogicalCameraSensor::ConnectDataCallback(
+    std::function<void(const ignition::msgs::LogicalCameraImage &)> _callback)
+{
+  return this->dataPtr->dataEvent.Connect(_callback);
 }
 
 IGN_SENSORS_REGISTER_SENSOR(LogicalCameraSensor)
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+#include "ignition/sensors/MagnetometerBatch.hh"
+#include "ignition/sensors/MagnetometerSensor.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Components of the state of the sensors, each stored in its own
+/// array
+enum MagnetometerComponent
+{
+  // Inputs
+  POS_X, POS_Y, POS_Z,
+  ROT_W, ROT_X, ROT_Y, ROT_Z,
+  WORLD_X, WORLD_Y, WORLD_Z,
+
+  // Outputs
+  FIELD_X, FIELD_Y, FIELD_Z,
+
+  MAGNETOMETER_COMPONENT_END
+};
+
+/// \brief Private data for MagnetometerBatch
+class ignition::sensors::MagnetometerBatchPrivate
+{
+  /// \brief Set a value, and remember if it changed.
+  /// \param[in] _component Component of the value
+  /// \param[in] _index Index of the sensor
+  /// \param[in] _value New value
+  public: void Set(const int _component, const std::size_t _index,
+              const double _value);
+
+  /// \brief Compute the fields in the frames of all the sensors.
+  public: void Compute();
+
+  /// \brief Sensors of the batch
+  public: std::vector<MagnetometerSensor *> sensors;
+
+  /// \brief One array per component, indexed like the sensors
+  public: std::array<std::vector<double>, MAGNETOMETER_COMPONENT_END> state;
+
+  /// \brief True if a rotation or a field changed since the last Compute()
+  public: bool dirty = true;
+};
+
+//////////////////////////////////////////////////
+void MagnetometerBatchPrivate::Set(const int _component,
+    const std::size_t _index, const double _value)
+{
+  double &value = this->state[_component][_index];
+  // The positions don't change the field
+  if (_component >= ROT_W && value != _value)
+    this->dirty = true;
+  value = _value;
+}
+
+//////////////////////////////////////////////////
+void MagnetometerBatchPrivate::Compute()
+{
+  IGN_PROFILE("MagnetometerBatchPrivate::Compute");
+  const std::size_t count = this->sensors.size();
+  auto &st = this->state;
+  const double *qw = st[ROT_W].data(), *qx = st[ROT_X].data(),
+      *qy = st[ROT_Y].data(), *qz = st[ROT_Z].data();
+  const double *mx = st[WORLD_X].data(), *my = st[WORLD_Y].data(),
+      *mz = st[WORLD_Z].data();
+  double *fx = st[FIELD_X].data(), *fy = st[FIELD_Y].data(),
+      *fz = st[FIELD_Z].data();
+
+  // Same result as MagnetometerSensor::Update(): the field rotated by the
+  // inverse of the orientation of the sensor, which treats a null
+  // orientation as the identity. The loop doesn't branch, so it's
+  // vectorized.
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    const double norm = qw[i] * qw[i] + qx[i] * qx[i] + qy[i] * qy[i] +
+        qz[i] * qz[i];
+    const bool null = norm == 0.0;
+    const double w = null ? 1.0 : qw[i];
+    const double inv = null ? 1.0 : 1.0 / norm;
+
+    // q^-1 m q = (w^2 - u.u) m + 2 (u.m) u + 2 w (m x u), over |q|^2
+    const double uu = qx[i] * qx[i] + qy[i] * qy[i] + qz[i] * qz[i];
+    const double um = qx[i] * mx[i] + qy[i] * my[i] + qz[i] * mz[i];
+    const double s = w * w - uu;
+    const double cx = my[i] * qz[i] - mz[i] * qy[i];
+    const double cy = mz[i] * qx[i] - mx[i] * qz[i];
+    const double cz = mx[i] * qy[i] - my[i] * qx[i];
+    fx[i] = (s * mx[i] + 2.0 * (um * qx[i] + w * cx)) * inv;
+    fy[i] = (s * my[i] + 2.0 * (um * qy[i] + w * cy)) * inv;
+    fz[i] = (s * mz[i] + 2.0 * (um * qz[i] + w * cz)) * inv;
+  }
+  this->dirty = false;
+}
+
+//////////////////////////////////////////////////
+MagnetometerBatch::MagnetometerBatch()
+  : dataPtr(new MagnetometerBatchPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+MagnetometerBatch::~MagnetometerBatch()
+{
+}
+
+//////////////////////////////////////////////////
+std::size_t MagnetometerBatch::AddSensor(MagnetometerSensor *_sensor)
+{
+  auto &sensors = this->dataPtr->sensors;
+  if (!_sensor ||
+      std::find(sensors.begin(), sensors.end(), _sensor) != sensors.end())
+  {
+    return sensors.size();
+  }
+
+  sensors.push_back(_sensor);
+  for (auto &values : this->dataPtr->state)
+    values.push_back(0.0);
+
+  const std::size_t index = sensors.size() - 1u;
+  this->SetWorldPose(index, _sensor->WorldPose());
+  const math::Vector3d field = _sensor->WorldMagneticField();
+  this->dataPtr->Set(WORLD_X, index, field.X());
+  this->dataPtr->Set(WORLD_Y, index, field.Y());
+  this->dataPtr->Set(WORLD_Z, index, field.Z());
+  this->dataPtr->dirty = true;
+  return index;
+}
+
+//////////////////////////////////////////////////
+bool MagnetometerBatch::RemoveSensor(const MagnetometerSensor *_sensor)
+{
+  auto &sensors = this->dataPtr->sensors;
+  auto it = std::find(sensors.begin(), sensors.end(), _sensor);
+  if (it == sensors.end())
+    return false;
+
+  const std::size_t index = static_cast<std::size_t>(it - sensors.begin());
+  sensors[index] = sensors.back();
+  sensors.pop_back();
+  for (auto &values : this->dataPtr->state)
+  {
+    values[index] = values.back();
+    values.pop_back();
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::size_t MagnetometerBatch::SensorCount() const
+{
+  return this->dataPtr->sensors.size();
+}
+
+//////////////////////////////////////////////////
+MagnetometerSensor *MagnetometerBatch::SensorByIndex(
+    const std::size_t _index) const
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return nullptr;
+  return this->dataPtr->sensors[_index];
+}
+
+//////////////////////////////////////////////////
+void MagnetometerBatch::SetWorldPose(const std::size_t _index,
+    const math::Pose3d &_pose)
+{
+  if (_index >= this->dataPtr->sensors.size())
+    return;
+
+  this->dataPtr->Set(POS_X, _index, _pose.Pos().X());
+  this->dataPtr->Set(POS_Y, _index, _pose.Pos().Y());
+  this->dataPtr->Set(POS_Z, _index, _pose.Pos().Z());
+  this->dataPtr->Set(ROT_W, _index, _pose.Rot().W());
+  this->dataPtr->Set(ROT_X, _index, _pose.Rot().X());
+  this->dataPtr->Set(ROT_Y, _index, _pose.Rot().Y());
+  this->dataPtr->Set(ROT_Z, _index, _pose.Rot().Z());
+}
+
+//////////////////////////////////////////////////
+void MagnetometerBatch::SetWorldPoses(const double *_poses)
+{
+  IGN_PROFILE("MagnetometerBatch::SetWorldPoses");
+  const std::size_t count = this->dataPtr->sensors.size();
+  for (int c = 0; c < 7; ++c)
+  {
+    double *values = this->dataPtr->state[POS_X + c].data();
+    bool changed = false;
+    for (std::size_t i = 0u; i < count; ++i)
+    {
+      const double value = _poses[i * 7u + c];
+      changed |= values[i] != value;
+      values[i] = value;
+    }
+    if (c >= ROT_W - POS_X && changed)
+      this->dataPtr->dirty = true;
+  }
+}
+
+//////////////////////////////////////////////////
+void MagnetometerBatch::SetWorldMagneticField(const math::Vector3d &_field)
+{
+  for (std::size_t i = 0u; i < this->dataPtr->sensors.size(); ++i)
+  {
+    this->dataPtr->Set(WORLD_X, i, _field.X());
+    this->dataPtr->Set(WORLD_Y, i, _field.Y());
+    this->dataPtr->Set(WORLD_Z, i, _field.Z());
+  }
+}
+
+//////////////////////////////////////////////////
+std::size_t MagnetometerBatch::Update(
+    const std::chrono::steady_clock::duration &_now)
+{
+  IGN_PROFILE("MagnetometerBatch::Update");
+  if (this->dataPtr->dirty)
+    this->dataPtr->Compute();
+
+  const auto &state = this->dataPtr->state;
+  std::size_t updated = 0u;
+  for (std::size_t i = 0u; i < this->dataPtr->sensors.size(); ++i)
+  {
+    // Only visit the sensors that are due
+    MagnetometerSensor *sensor = this->dataPtr->sensors[i];
+    if (sensor->UpdateRate() > 0.0 && _now < sensor->NextDataUpdateTime())
+      continue;
+
+    sensor->SetBatchState(_now,
+        math::Pose3d(state[POS_X][i], state[POS_Y][i], state[POS_Z][i],
+            state[ROT_W][i], state[ROT_X][i], state[ROT_Y][i],
+            state[ROT_Z][i]),
+        math::Vector3d(state[WORLD_X][i], state[WORLD_Y][i],
+            state[WORLD_Z][i]),
+        math::Vector3d(state[FIELD_X][i], state[FIELD_Y][i],
+            state[FIELD_Z][i]));
+
+    // Through Sensor::Update() to keep the schedule and the statistics
+    Sensor *base = sensor;
+    if (base->Update(_now, false))
+      ++updated;
+  }
+  return updated;
+}
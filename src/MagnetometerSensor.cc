@@ -15,6 +15,8 @@
  *
 */
 
+#include <array>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
@@ -25,6 +27,8 @@
 #pragma warning(pop)
 #endif
 
+#include <ignition/common/Console.hh>
+#include <ignition/common/Event.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/transport/Node.hh>
 #include <sdf/Magnetometer.hh>
@@ -40,12 +44,14 @@ using namespace sensors;
 /// \brief Private data for MagnetometerSensor
 class ignition::sensors::MagnetometerSensorPrivate
 {
-  /// \brief node to create publisher
-  public: transport::Node node;
-
   /// \brief publisher to publish magnetometer messages.
   public: transport::Node::Publisher pub;
 
+  /// \brief Event that is used to trigger callbacks when a new message
+  /// is generated
+  public: ignition::common::EventT<
+          void(const ignition::msgs::Magnetometer &)> dataEvent;
+
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
 
@@ -60,10 +66,59 @@ class ignition::sensors::MagnetometerSensorPrivate
   /// \brief World pose of the magnetometer
   public: ignition::math::Pose3d worldPose;
 
-  /// \brief Noise added to sensor data
-  public: std::map<SensorNoiseType, NoisePtr> noises;
+  /// \brief Noise added to sensor data, indexed by SensorNoiseType. Slots
+  /// without noise are null.
+  public: std::array<NoisePtr, SENSOR_NOISE_TYPE_END> noises;
+
+  /// \brief Message published on every update. It is kept between updates
+  /// so that its memory is reused.
+  public: msgs::Magnetometer msg;
+
+  /// \brief Field in body frame before noise, for fieldRotation and
+  /// fieldWorld.
+  public: ignition::math::Vector3d noiseFreeField;
+
+  /// \brief World rotation noiseFreeField was computed for
+  public: ignition::math::Quaterniond fieldRotation;
+
+  /// \brief World field noiseFreeField was computed for
+  public: ignition::math::Vector3d fieldWorld;
+
+  /// \brief True once noiseFreeField has been computed
+  public: bool fieldValid = false;
+
+  /// \brief True if a MagnetometerBatch set the field of the update at
+  /// batchStateTime.
+  public: bool batchState = false;
+
+  /// \brief Time of the update the batch state is for
+  public: std::chrono::steady_clock::duration batchStateTime
+    {std::chrono::steady_clock::duration::zero()};
 };
 
+/// \brief Check if two rotations are exactly the same. The equality
+/// operator of quaternions has a tolerance that is too large to tell if a
+/// pose changed.
+/// \param[in] _a First rotation
+/// \param[in] _b Second rotation
+/// \return True if all the components are equal
+static bool SameRotation(const math::Quaterniond &_a,
+    const math::Quaterniond &_b)
+{
+  return _a.W() == _b.W() && _a.X() == _b.X() && _a.Y() == _b.Y() &&
+      _a.Z() == _b.Z();
+}
+
+/// \brief Check if two vectors are exactly the same. Magnetic fields are
+/// much smaller than the tolerance of the equality operator of vectors.
+/// \param[in] _a First vector
+/// \param[in] _b Second vector
+/// \return True if all the components are equal
+static bool SameVector(const math::Vector3d &_a, const math::Vector3d &_b)
+{
+  return _a.X() == _b.X() && _a.Y() == _b.Y() && _a.Z() == _b.Z();
+}
+
 //////////////////////////////////////////////////
 MagnetometerSensor::MagnetometerSensor()
   : dataPtr(new MagnetometerSensorPrivate())
@@ -105,7 +160,7 @@ bool MagnetometerSensor::Load(const sdf::Sensor &_sdf)
     this->SetTopic("/magnetometer");
 
   this->dataPtr->pub =
-      this->dataPtr->node.Advertise<ignition::msgs::Magnetometer>(
+      this->TransportNode().Advertise<ignition::msgs::Magnetometer>(
       this->Topic());
 
   if (!this->dataPtr->pub)
@@ -113,6 +168,7 @@ bool MagnetometerSensor::Load(const sdf::Sensor &_sdf)
     ignerr << "Unable to create publisher on topic[" << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->pub);
 
   // Load the noise parameters
   if (_sdf.MagnetometerSensor()->XNoise().Type() != sdf::NoiseType::NONE)
@@ -133,6 +189,16 @@ bool MagnetometerSensor::Load(const sdf::Sensor &_sdf)
       NoiseFactory::NewNoiseModel(_sdf.MagnetometerSensor()->ZNoise());
   }
 
+  // Give every noise model its own reproducible random stream
+  for (std::size_t i = 0; i < this->dataPtr->noises.size(); ++i)
+  {
+    if (this->dataPtr->noises[i])
+    {
+      this->dataPtr->noises[i]->SetSeed(
+          this->NoiseSeed(static_cast<unsigned int>(i)));
+    }
+  }
+
   this->dataPtr->initialized = true;
   return true;
 }
@@ -163,51 +229,91 @@ bool MagnetometerSensor::Update(
     return false;
   }
 
-  // compute magnetic field in body frame
-  this->dataPtr->localField =
-      this->dataPtr->worldPose.Rot().Inverse().RotateVector(
-      this->dataPtr->worldField);
-
-  msgs::Magnetometer msg;
-  *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-  auto frame = msg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
-
-  // Apply magnetometer noise after converting to body frame
-  if (this->dataPtr->noises.find(MAGNETOMETER_X_NOISE_TESLA) !=
-      this->dataPtr->noises.end())
+  // compute magnetic field in body frame, unless a batch already did or
+  // neither the rotation nor the field changed since the last update
+  const bool batched = this->dataPtr->batchState &&
+      this->dataPtr->batchStateTime == _now;
+  this->dataPtr->batchState = false;
+  if (!batched && (!this->dataPtr->fieldValid ||
+      !SameRotation(this->dataPtr->worldPose.Rot(),
+          this->dataPtr->fieldRotation) ||
+      !SameVector(this->dataPtr->worldField, this->dataPtr->fieldWorld)))
   {
-    this->dataPtr->localField.X(
-        this->dataPtr->noises[MAGNETOMETER_X_NOISE_TESLA]->Apply(
-          this->dataPtr->localField.X()));
+    this->dataPtr->noiseFreeField =
+        this->dataPtr->worldPose.Rot().Inverse().RotateVector(
+        this->dataPtr->worldField);
+    this->dataPtr->fieldRotation = this->dataPtr->worldPose.Rot();
+    this->dataPtr->fieldWorld = this->dataPtr->worldField;
+    this->dataPtr->fieldValid = true;
   }
+  this->dataPtr->localField = this->dataPtr->noiseFreeField;
 
-  if (this->dataPtr->noises.find(MAGNETOMETER_Y_NOISE_TESLA) !=
-      this->dataPtr->noises.end())
-  {
-    this->dataPtr->localField.Y(
-        this->dataPtr->noises[MAGNETOMETER_Y_NOISE_TESLA]->Apply(
-          this->dataPtr->localField.Y()));
-  }
+  // Apply magnetometer noise after converting to body frame
+  const NoisePtr &xNoise = this->dataPtr->noises[MAGNETOMETER_X_NOISE_TESLA];
+  if (xNoise)
+    this->dataPtr->localField.X(xNoise->Apply(this->dataPtr->localField.X()));
+
+  const NoisePtr &yNoise = this->dataPtr->noises[MAGNETOMETER_Y_NOISE_TESLA];
+  if (yNoise)
+    this->dataPtr->localField.Y(yNoise->Apply(this->dataPtr->localField.Y()));
+
+  const NoisePtr &zNoise = this->dataPtr->noises[MAGNETOMETER_Z_NOISE_TESLA];
+  if (zNoise)
+    this->dataPtr->localField.Z(zNoise->Apply(this->dataPtr->localField.Z()));
 
-  if (this->dataPtr->noises.find(MAGNETOMETER_Z_NOISE_TESLA) !=
-      this->dataPtr->noises.end())
+  const bool publish = this->HasConsumers(this->dataPtr->pub);
+  const bool callbacks = this->dataPtr->dataEvent.ConnectionCount() > 0;
+  if (!publish && !callbacks)
   {
-    this->dataPtr->localField.Z(
-        this->dataPtr->noises[MAGNETOMETER_Z_NOISE_TESLA]->Apply(
-          this->dataPtr->localField.Z()));
+    // Nobody consumes the message, don't build it
+    return true;
   }
 
+  msgs::Magnetometer &msg = this->dataPtr->msg;
+  this->StampHeader(msg.mutable_header(), _now);
   msgs::Set(msg.mutable_field_tesla(), this->dataPtr->localField);
 
   // publish
-  this->AddSequence(msg.mutable_header());
-  this->dataPtr->pub.Publish(msg);
+  if (publish)
+  {
+    auto publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->pub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // Trigger callbacks.
+  if (callbacks)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in a magnetometer callback.\n";
+    }
+  }
 
   return true;
 }
 
+//////////////////////////////////////////////////
+void MagnetometerSensor::SetBatchState(
+    const std::chrono::steady_clock::duration &_now,
+    const math::Pose3d &_pose, const math::Vector3d &_worldField,
+    const math::Vector3d &_field)
+{
+  this->dataPtr->worldPose = _pose;
+  this->dataPtr->worldField = _worldField;
+  this->dataPtr->noiseFreeField = _field;
+  this->dataPtr->fieldRotation = _pose.Rot();
+  this->dataPtr->fieldWorld = _worldField;
+  this->dataPtr->fieldValid = true;
+  this->dataPtr->batchState = true;
+  this->dataPtr->batchStateTime = _now;
+}
+
 //////////////////////////////////////////////////
 void MagnetometerSensor::SetWorldPose(const math::Pose3d _pose)
 {
@@ -238,4 +344,41 @@ math::Vector3d MagnetometerSensor::MagneticField() const
   return this->dataPtr->localField;
 }
 
+//////////////////////////////////////////////////
+bool MagnetometerSensor::HasConnections() const
+{
+  return this->HasConsumers(this->dataPtr->pub) ||
+      this->dataPtr->dataEvent.ConnectionCount() > 0;
+}
+
+//////////////////////////////////////////////////
+bool MagnetometerSensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->Sensor::ReplayMessage(_topic, _msg))
+    return false;
+
+  auto msg = dynamic_cast<const ignition::msgs::Magnetometer *>(&_msg);
+  if (msg && _topic == this->Topic() &&
+      this->dataPtr->dataEvent.ConnectionCount() > 0)
+  {
+    try
+    {
+      this->dataPtr->dataEvent(*msg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in a magnetometer callback.\n";
+    }
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::common::ConnectionPtr MagnetometerSensor::ConnectDataCallback(
+    std::function<void(const ignition::msgs::Magnetometer &)> _callback)
+{
+  return this->dataPtr->dataEvent.Connect(_callback);
+}
+
 IGN_SENSORS_REGISTER_SENSOR(MagnetometerSensor)
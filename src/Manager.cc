@@ -15,20 +15,165 @@
  *
 */
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/double_v.pb.h>
+#include <ignition/msgs/param_v.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
 #include "ignition/sensors/Manager.hh"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <typeindex>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include <ignition/common/PluginLoader.hh>
 #include <ignition/common/Plugin.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/common/SystemPaths.hh>
 #include <ignition/common/Console.hh>
+#include <ignition/common/Util.hh>
+#include <ignition/msgs/Factory.hh>
+#include <ignition/msgs/Utility.hh>
+#include <ignition/transport/Node.hh>
+#include <ignition/transport/TopicUtils.hh>
 
 #include "ignition/sensors/config.hh"
+#include "ignition/sensors/PipelineTrace.hh"
+#include "ignition/sensors/RecordingSink.hh"
 #include "ignition/sensors/SensorFactory.hh"
 
+#include "ReadingAggregator.hh"
+#include "RemoteRenderClient.hh"
+#include "RenderThread.hh"
+#include "WorkerPool.hh"
+
 using namespace ignition::sensors;
 
+namespace
+{
+/// \brief Counter used to generate frame ids passed to
+/// Sensor::PrepareFrame. Shared by all managers so that ids are unique even
+/// when rendering sensors of different managers share a scene.
+std::atomic<uint64_t> frameIdCounter{0u};
+
+/// \brief Scheduling state of a sensor owned by the manager.
+class SensorState
+{
+  /// \brief The sensor
+  public: ignition::sensors::Sensor *sensor = nullptr;
+
+  /// \brief Incremented each time the sensor is queued. Queue entries
+  /// with an older version are stale and are discarded.
+  public: uint64_t version = 0u;
+
+  /// \brief True if the sensor has no update rate and must be updated on
+  /// every RunOnce call.
+  public: bool everyCycle = false;
+
+  /// \brief Cached result of Sensor::IsRenderingSensor()
+  public: bool rendering = false;
+
+  /// \brief Worker thread the sensor is updated on with sticky workers,
+  /// modulo the number of threads.
+  public: unsigned int worker = 0u;
+
+  /// \brief Index of the group of sensors with the same concrete type.
+  public: std::size_t typeGroup = 0u;
+
+  /// \brief Moving average of the wall time of recent updates.
+  public: std::chrono::steady_clock::duration cost{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief Number of budgeted updates the sensor was deferred in a row.
+  public: unsigned int deferrals = 0u;
+
+  /// \brief Wall time spent so far on the stages of the current update,
+  /// with batched rendering.
+  public: std::chrono::steady_clock::duration stageCost{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief Number of updates of the sensor when the last diagnostics
+  /// were published, to compute its achieved rate.
+  public: uint64_t diagnosticsUpdateCount = 0u;
+};
+
+/// \brief Entry in the time-ordered update queue.
+class QueueEntry
+{
+  /// \brief Time at which the sensor is due.
+  public: std::chrono::steady_clock::duration time;
+
+  /// \brief Id of the sensor.
+  public: SensorId id;
+
+  /// \brief SensorState::version when the entry was queued.
+  public: uint64_t version;
+};
+
+/// \brief Orders the update queue so that the earliest entry is on top.
+/// Ties are broken by sensor id to keep the update order stable.
+class QueueEntryCompare
+{
+  /// \brief Compare two entries
+  /// \param[in] _a First entry
+  /// \param[in] _b Second entry
+  /// \return True if _a is due after _b
+  public: bool operator()(const QueueEntry &_a, const QueueEntry &_b) const
+  {
+    return _a.time > _b.time || (_a.time == _b.time && _a.id > _b.id);
+  }
+};
+
+/// \brief Channel of a recording being replayed.
+class ReplayChannel
+{
+  /// \brief Sensor with the recorded name, null if there is none
+  public: ignition::sensors::Sensor *sensor = nullptr;
+
+  /// \brief Message of the recorded type, reused for every read. Null if
+  /// the type is unknown.
+  public: std::unique_ptr<google::protobuf::Message> msg;
+
+  /// \brief Publisher on the recorded topic, advertised the first time a
+  /// message isn't published by a sensor
+  public: ignition::transport::Node::Publisher pub;
+
+  /// \brief Whether pub was advertised
+  public: bool advertised = false;
+};
+
+/// \brief Aggregated readings of the sensors of a type
+class AggregatedOutput
+{
+  /// \brief Topic of the aggregated readings
+  public: std::string topic;
+
+  /// \brief Publisher of the aggregated readings
+  public: ignition::transport::Node::Publisher pub;
+
+  /// \brief Readings of the current step
+  public: ReadingAggregator aggregator;
+
+  /// \brief Aggregated message, reused between steps
+  public: ignition::msgs::Double_V msg;
+};
+}
+
 class ignition::sensors::ManagerPrivate
 {
   /// \brief constructor
@@ -37,11 +182,323 @@ class ignition::sensors::ManagerPrivate
   /// \brief destructor
   public: ~ManagerPrivate();
 
+  /// \brief Start tracking the schedule of a newly created sensor.
+  /// \param[in] _sensor The sensor
+  public: void AddSensor(ignition::sensors::Sensor *_sensor);
+
+  /// \brief Queue a sensor according to its current update rate and next
+  /// update time, discarding any previous queue entry.
+  /// \param[in] _id Id of the sensor
+  /// \param[in] _state Scheduling state of the sensor
+  public: void Schedule(SensorId _id, SensorState &_state);
+
+  /// \brief Reschedule sensors whose schedule changed outside of RunOnce.
+  public: void ProcessScheduleChanges();
+
+  /// \brief Rebuild everyCycleSensors and allSensors from sensors.
+  public: void UpdateSensorLists();
+
+  /// \brief Bring the schedule up to date and get the earliest update
+  /// time in the queue. Waits for rendering in flight, since rendered
+  /// sensors are queued again once done.
+  /// \param[in] _after If _held isn't null, entries at or before this
+  /// time are moved to _held.
+  /// \param[in,out] _held If not null, entries moved out of the queue,
+  /// with those of pending triggered sensors.
+  /// \return The earliest update time, or max() if the queue is empty.
+  public: std::chrono::steady_clock::duration NextQueuedTime(
+              const std::chrono::steady_clock::duration &_after =
+                  std::chrono::steady_clock::duration::min(),
+              std::vector<QueueEntry> *_held = nullptr);
+
+  /// \brief Update the sensors that are due and queue them again.
+  /// \param[in] _time The current simulated time
+  /// \param[in] _budget Wall time budget, or null for no budget.
+  /// \param[out] _deferred Ids of deferred sensors, may be null.
+  public: void UpdateDueSensors(
+              const std::chrono::steady_clock::duration &_time,
+              const std::chrono::steady_clock::duration *_budget = nullptr,
+              std::vector<SensorId> *_deferred = nullptr);
+
+  /// \brief Keep the highest priority sensors of dueSensors that fit in a
+  /// budget and move the others to deferredSensors.
+  /// \param[in] _budget Wall time budget.
+  public: void SelectWithinBudget(
+              const std::chrono::steady_clock::duration &_budget);
+
+  /// \brief Publish diagnostics if a topic is set and they are due.
+  /// \param[in] _time Current simulated time.
+  public: void UpdateDiagnostics(
+              const std::chrono::steady_clock::duration &_time);
+
+  /// \brief Publish the statistics of all sensors on diagnosticsPub.
+  /// \param[in] _time Current simulated time.
+  public: void PublishDiagnostics(
+              const std::chrono::steady_clock::duration &_time);
+
+  /// \brief Update the given sensors, using the worker pool if enabled.
+  /// \param[in] _sensors Sensors to update
+  /// \param[in] _time The current simulated time
+  /// \param[in] _force Force the update
+  public: void UpdateSensors(const std::vector<SensorState *> &_sensors,
+              const std::chrono::steady_clock::duration &_time,
+              bool _force);
+
+  /// \brief Update rendering sensors, on the thread that owns the
+  /// rendering context.
+  /// \param[in] _sensors Rendering sensors to update
+  /// \param[in] _time The current simulated time
+  /// \param[in] _force Force the update
+  public: void RenderSensors(const std::vector<SensorState *> &_sensors,
+              const std::chrono::steady_clock::duration &_time,
+              bool _force);
+
+  /// \brief Publish the messages the sensors held back, in list order,
+  /// when deterministic is set.
+  /// \param[in] _sensors Sensors that were updated
+  public: void CommitPublishes(const std::vector<SensorState *> &_sensors);
+
+  /// \brief Call a function for each sensor, on the worker pool if there
+  /// is one, each sensor on its own worker with sticky workers.
+  /// \param[in] _sensors The sensors
+  /// \param[in] _func Function to call
+  public: void ForEachOnWorkers(const std::vector<SensorState *> &_sensors,
+              const std::function<void(SensorState *)> &_func);
+
+  /// \brief Spread the sensors over the worker threads again, such as
+  /// when their number changed.
+  public: void AssignWorkers();
+
+  /// \brief Pass the readings of a sensor to the aggregated output of its
+  /// type, if there is one.
+  /// \param[in] _sensor The sensor
+  public: void AttachAggregatedOutput(ignition::sensors::Sensor *_sensor);
+
+  /// \brief Publish the readings aggregated during a step.
+  /// \param[in] _time Simulated time of the step
+  public: void PublishAggregated(
+              const std::chrono::steady_clock::duration &_time);
+
+  /// \brief Wait for the render thread to finish the rendering sensors of
+  /// the previous RunOnce call, and queue them again. Does nothing without
+  /// a render thread.
+  public: void FinishRendering();
+
+  /// \brief Find the sensors of the replayed channels by name.
+  public: void ResolveReplayChannels();
+
+  /// \brief Publish the recorded messages up to a simulated time.
+  /// \param[in] _time The current simulated time
+  public: void Replay(const std::chrono::steady_clock::duration &_time);
+
   /// \brief Loaded sensors.
   public: std::map<SensorId, std::unique_ptr<Sensor>> sensors;
 
   /// \brief Sensor factory for creating sensors from plugins;
   public: SensorFactory sensorFactory;
+
+  /// \brief Scheduling state of each loaded sensor.
+  public: std::unordered_map<SensorId, SensorState> states;
+
+  /// \brief Sensors with an update rate, ordered by next update time.
+  public: std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+              QueueEntryCompare> updateQueue;
+
+  /// \brief Sensors without an update rate, in id order.
+  public: std::vector<SensorState *> everyCycleSensors;
+
+  /// \brief All sensors, in id order. Used for forced updates.
+  public: std::vector<SensorState *> allSensors;
+
+  /// \brief True when sensors were added or removed, or changed between
+  /// having and not having an update rate, since the sensor lists were
+  /// last built.
+  public: bool sensorListsDirty = true;
+
+  /// \brief Time of the latest RunOnce() call
+  public: std::chrono::steady_clock::duration lastRunTime{
+              std::chrono::steady_clock::duration::min()};
+
+  /// \brief Sensors due in the current RunOnce call.
+  public: std::vector<SensorState *> dueSensors;
+
+  /// \brief Due sensors that didn't fit in the budget of the current
+  /// RunOnce call.
+  public: std::vector<SensorState *> deferredSensors;
+
+  /// \brief Scratch buffer used to sort due sensors by priority.
+  public: std::vector<SensorState *> budgetCandidates;
+
+  /// \brief Ids of sensors whose schedule changed outside of RunOnce.
+  public: std::vector<SensorId> scheduleChanges;
+
+  /// \brief Protects scheduleChanges, which can be written from worker
+  /// threads.
+  public: std::mutex scheduleChangesMutex;
+
+  /// \brief Pool used to update sensors concurrently. Null when sensors
+  /// are updated serially.
+  public: std::unique_ptr<WorkerPool> workerPool;
+
+  /// \brief Sensors that can be updated by the worker pool in the current
+  /// RunOnce call.
+  public: std::vector<SensorState *> parallelSensors;
+
+  /// \brief Rendering sensors, updated on the calling thread.
+  public: std::vector<SensorState *> serialSensors;
+
+  /// \brief Rendering sensors updated in stages in the current RunOnce
+  /// call.
+  public: std::vector<SensorState *> stagedSensors;
+
+  /// \brief Whether rendering sensors are updated in batched stages.
+  public: bool batchedRendering = false;
+
+  /// \brief Whether sensors hold their messages back so they are
+  /// published in update order, see Manager::SetDeterministic().
+  public: bool deterministic = false;
+
+  /// \brief Whether each sensor is updated on the same worker thread,
+  /// see Manager::SetStickyWorkers().
+  public: bool stickyWorkers = false;
+
+  /// \brief Cores of the background worker threads, see
+  /// Manager::SetWorkerAffinity().
+  public: std::vector<int> workerCores;
+
+  /// \brief Scratch buffer with the worker of each sensor of a parallel
+  /// update.
+  public: std::vector<unsigned int> sensorWorkers;
+
+  /// \brief Thread rendering sensors are updated on, null when they are
+  /// updated on the thread calling RunOnce.
+  public: std::unique_ptr<RenderThread> renderThread;
+
+  /// \brief Rendering sensors handed to the render thread by the last
+  /// RunOnce call.
+  public: std::vector<SensorState *> renderSensors;
+
+  /// \brief True if renderSensors must be queued again once rendered.
+  public: bool renderReschedule = false;
+
+  /// \brief Called on the render thread once renderSensors are updated
+  public: std::function<void(const std::chrono::steady_clock::duration &)>
+              renderCallback;
+
+  /// \brief Whether renderQuality overrides the profiles of sensors.
+  public: bool overrideRenderQuality = false;
+
+  /// \brief Render quality profile of all rendering sensors, if
+  /// overrideRenderQuality is true.
+  public: RenderQualityProfile renderQuality = RenderQualityProfile::FULL;
+
+  /// \brief Poses of the models in the world, given to every sensor
+  public: std::shared_ptr<const ModelPoseSnapshot> modelPoses;
+
+  /// \brief Sink recording the messages of all sensors, may be null
+  public: std::shared_ptr<RecordingSink> recordingSink;
+
+  /// \brief Recording the sensor outputs are served from, null unless
+  /// replaying
+  public: std::unique_ptr<RecordingReader> replay;
+
+  /// \brief Channels of replay, indexed by RecordingChannel::id
+  public: std::vector<ReplayChannel> replayChannels;
+
+  /// \brief Indices of the entries of replay, sorted by simulated time
+  public: std::vector<std::size_t> replayOrder;
+
+  /// \brief Index in replayOrder of the next message to publish
+  public: std::size_t replayNext = 0u;
+
+  /// \brief Simulated time of the latest replay
+  public: std::chrono::steady_clock::duration replayTime{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief True if sensors were added or removed since the replayed
+  /// channels were resolved
+  public: bool replayChannelsDirty = true;
+
+  /// \brief Client of the render service rendering sensors are rendered
+  /// by, null when they render in this process.
+  public: std::unique_ptr<RemoteRenderClient> remoteRendering;
+
+  /// \brief Scratch buffer with the rendering sensors of a remote request.
+  public: std::vector<Sensor *> remoteSensors;
+
+  /// \brief Whether sensors are updated grouped by concrete type.
+  public: bool groupByType = false;
+
+  /// \brief Whether sensors skip updates while they have no consumers.
+  public: bool lazyUpdates = false;
+
+  /// \brief Name of the world of the sensors
+  public: std::string worldName;
+
+  /// \brief Number of render devices the rendering sensors are spread over
+  public: unsigned int renderDeviceCount = 1u;
+
+  /// \brief Whether new sensors are staggered over their update period.
+  public: bool staggerUpdates = false;
+
+  /// \brief Whether new sensors keep as little state as they can.
+  public: bool compactSensors = false;
+
+  /// \brief Number of sensors staggered so far for each update rate.
+  public: std::map<double, uint64_t> staggerCounts;
+
+  /// \brief Index of the group of each concrete sensor type.
+  public: std::unordered_map<std::type_index, std::size_t> typeGroups;
+
+  /// \brief Scratch buffer with the start of each type group.
+  public: std::vector<std::size_t> groupOffsets;
+
+  /// \brief Scratch buffer with sensors sorted by type group.
+  public: std::vector<SensorState *> groupedSensors;
+
+  /// \brief Node used for publishing diagnostics, aggregated readings and
+  /// replayed messages. The sensors advertise their outputs on it too,
+  /// instead of creating a node each.
+  public: std::shared_ptr<ignition::transport::Node> node{
+              std::make_shared<ignition::transport::Node>()};
+
+  /// \brief Publisher for diagnostics
+  public: ignition::transport::Node::Publisher diagnosticsPub;
+
+  /// \brief Topic diagnostics are published on. Empty if disabled.
+  public: std::string diagnosticsTopic;
+
+  /// \brief Simulated time between diagnostics messages
+  public: std::chrono::steady_clock::duration diagnosticsPeriod{
+              std::chrono::seconds(1)};
+
+  /// \brief Simulated time of the next diagnostics message
+  public: std::chrono::steady_clock::duration nextDiagnosticsTime{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief Simulated time of the last diagnostics message, the start
+  /// of the window the achieved rates are computed over.
+  public: std::chrono::steady_clock::duration lastDiagnosticsTime{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief True once diagnostics were published on the current topic
+  public: bool diagnosticsPublished = false;
+
+  /// \brief True if diagnostics are due but wait for the frame in flight
+  /// on the render thread, see FinishRendering().
+  public: bool diagnosticsPending = false;
+
+  /// \brief Simulated time of the pending diagnostics
+  public: std::chrono::steady_clock::duration diagnosticsPendingTime{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief Aggregated outputs, by SDF type of their sensors
+  public: std::map<std::string, std::unique_ptr<AggregatedOutput>>
+              aggregatedOutputs;
+
+  /// \brief File the pipeline trace is written to on destruction, from
+  /// the IGN_SENSORS_TRACE environment variable. Empty if not tracing.
+  public: std::string tracePath;
 };
 
 //////////////////////////////////////////////////
@@ -55,69 +512,1747 @@ ManagerPrivate::~ManagerPrivate()
 }
 
 //////////////////////////////////////////////////
-Manager::Manager() :
-  dataPtr(new ManagerPrivate)
+void ManagerPrivate::AddSensor(ignition::sensors::Sensor *_sensor)
+{
+  SensorId id = _sensor->Id();
+  SensorState &state = this->states[id];
+  state.sensor = _sensor;
+  state.rendering = _sensor->IsRenderingSensor();
+  if (this->lazyUpdates)
+    _sensor->SetLazyUpdates(true);
+  if (this->compactSensors)
+    _sensor->SetCompact(true);
+  if (this->batchedRendering && state.rendering)
+    _sensor->SetStagedUpdates(true);
+  if (this->deterministic)
+    _sensor->SetDeferredPublish(true);
+  if (this->overrideRenderQuality && state.rendering)
+    _sensor->SetRenderQuality(this->renderQuality);
+  if (this->modelPoses)
+    _sensor->SetModelPoseSnapshot(this->modelPoses);
+  if (this->recordingSink)
+    _sensor->SetRecordingSink(this->recordingSink);
+  this->replayChannelsDirty = true;
+  _sensor->SetWorldName(this->worldName);
+  if (this->remoteRendering && state.rendering)
+  {
+    _sensor->SetRemoteRendered(true);
+    this->remoteRendering->AddSensor(_sensor);
+  }
+  if (state.rendering)
+  {
+    // Until their costs are measured, new sensors go to the device with the
+    // fewest rendering sensors
+    std::vector<unsigned int> counts(this->renderDeviceCount, 0u);
+    for (const auto &s : this->states)
+    {
+      if (s.second.rendering && s.second.sensor != _sensor)
+        ++counts[s.second.sensor->RenderDevice() % counts.size()];
+    }
+    _sensor->SetRenderDevice(static_cast<unsigned int>(
+        std::min_element(counts.begin(), counts.end()) - counts.begin()));
+  }
+
+  // New sensors go to the worker with the fewest sensors
+  const unsigned int threadCount =
+      this->workerPool ? this->workerPool->ThreadCount() : 1u;
+  std::vector<unsigned int> workerCounts(threadCount, 0u);
+  for (const auto &s : this->states)
+  {
+    if (s.second.sensor != _sensor)
+      ++workerCounts[s.second.worker % threadCount];
+  }
+  state.worker = static_cast<unsigned int>(std::min_element(
+      workerCounts.begin(), workerCounts.end()) - workerCounts.begin());
+
+  const double rate = _sensor->UpdateRate();
+  if (this->staggerUpdates && rate > 0.0 && _sensor->Staggerable())
+  {
+    // The van der Corput sequence spreads any number of sensors evenly
+    // over the period: 0, 1/2, 1/4, 3/4, 1/8, ...
+    uint64_t k = this->staggerCounts[rate]++;
+    double fraction = 0.0;
+    for (double base = 0.5; k > 0u; k >>= 1u, base *= 0.5)
+    {
+      if (k & 1u)
+        fraction += base;
+    }
+    _sensor->SetUpdatePhase(std::chrono::nanoseconds(
+        std::llround(fraction / rate * 1e9)));
+  }
+
+  auto group = this->typeGroups.emplace(std::type_index(typeid(*_sensor)),
+      this->typeGroups.size());
+  state.typeGroup = group.first->second;
+
+  _sensor->SetScheduleChangedCallback([this](SensorId _id)
+      {
+        std::lock_guard<std::mutex> lock(this->scheduleChangesMutex);
+        this->scheduleChanges.push_back(_id);
+      });
+  this->AttachAggregatedOutput(_sensor);
+
+  this->Schedule(id, state);
+  this->sensorListsDirty = true;
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::AttachAggregatedOutput(
+    ignition::sensors::Sensor *_sensor)
 {
+  auto iter = this->aggregatedOutputs.find(_sensor->SdfSensor().TypeStr());
+  if (iter == this->aggregatedOutputs.end())
+  {
+    _sensor->SetPublishCallback(nullptr);
+    return;
+  }
+
+  AggregatedOutput *output = iter->second.get();
+  const std::string name = _sensor->Name();
+  _sensor->SetPublishCallback(
+      [output, name](SensorId _id, const google::protobuf::Message &_msg)
+      {
+        output->aggregator.Add(_id, name, _msg);
+      });
 }
 
 //////////////////////////////////////////////////
-Manager::~Manager()
+void ManagerPrivate::PublishAggregated(
+    const std::chrono::steady_clock::duration &_time)
 {
+  for (auto &entry : this->aggregatedOutputs)
+  {
+    AggregatedOutput &output = *entry.second;
+    if (!output.pub.HasConnections())
+    {
+      output.aggregator.Clear();
+      continue;
+    }
+    if (output.aggregator.Flush(_time, output.msg))
+      output.pub.Publish(output.msg);
+  }
 }
 
 //////////////////////////////////////////////////
-bool Manager::Init()
+void ManagerPrivate::Schedule(SensorId _id, SensorState &_state)
 {
-  return true;
+  ++_state.version;
+
+  // Triggered sensors stay in the queue, so they aren't visited while idle
+  bool everyCycle = _state.sensor->UpdateRate() <= 0.0 &&
+      !_state.sensor->Triggered();
+  if (everyCycle != _state.everyCycle)
+  {
+    _state.everyCycle = everyCycle;
+    this->sensorListsDirty = true;
+  }
+
+  // Idle triggered sensors are queued again when triggered
+  const auto next = _state.sensor->NextDataUpdateTime();
+  if (!everyCycle && next != std::chrono::steady_clock::duration::max())
+    this->updateQueue.push({next, _id, _state.version});
 }
 
 //////////////////////////////////////////////////
-ignition::sensors::Sensor *Manager::Sensor(
-    ignition::sensors::SensorId _id)
+void ManagerPrivate::ProcessScheduleChanges()
 {
-  auto iter = this->dataPtr->sensors.find(_id);
-  return iter != this->dataPtr->sensors.end() ? iter->second.get() : nullptr;
+  std::vector<SensorId> changes;
+  {
+    std::lock_guard<std::mutex> lock(this->scheduleChangesMutex);
+    if (this->scheduleChanges.empty())
+      return;
+    changes.swap(this->scheduleChanges);
+  }
+
+  for (const SensorId id : changes)
+  {
+    auto iter = this->states.find(id);
+    if (iter != this->states.end())
+      this->Schedule(id, iter->second);
+  }
 }
 
 //////////////////////////////////////////////////
-void Manager::AddPluginPaths(const std::string &_paths)
+void ManagerPrivate::UpdateSensorLists()
 {
-  this->dataPtr->sensorFactory.AddPluginPaths(_paths);
+  this->everyCycleSensors.clear();
+  this->allSensors.clear();
+  for (auto &s : this->sensors)
+  {
+    SensorState &state = this->states[s.first];
+    this->allSensors.push_back(&state);
+    if (state.everyCycle)
+      this->everyCycleSensors.push_back(&state);
+  }
+  this->sensorListsDirty = false;
 }
 
 //////////////////////////////////////////////////
-bool Manager::Remove(const ignition::sensors::SensorId _id)
+std::chrono::steady_clock::duration ManagerPrivate::NextQueuedTime(
+    const std::chrono::steady_clock::duration &_after,
+    std::vector<QueueEntry> *_held)
 {
-  return this->dataPtr->sensors.erase(_id) > 0;
+  this->FinishRendering();
+  this->ProcessScheduleChanges();
+  if (this->sensorListsDirty)
+    this->UpdateSensorLists();
+
+  // Drop stale entries, so the top is the next update
+  auto &queue = this->updateQueue;
+  while (!queue.empty())
+  {
+    const QueueEntry &entry = queue.top();
+    auto iter = this->states.find(entry.id);
+    if (iter != this->states.end() &&
+        iter->second.version == entry.version)
+    {
+      if (!_held || (entry.time > _after &&
+          !iter->second.sensor->Triggered()))
+      {
+        return entry.time;
+      }
+      _held->push_back(entry);
+    }
+    queue.pop();
+  }
+  return std::chrono::steady_clock::duration::max();
 }
 
 //////////////////////////////////////////////////
-void Manager::RunOnce(const ignition::common::Time &_time, bool _force)
+/// \brief Track the recent cost of a sensor for budgeted updates.
+/// \param[in] _state State of the sensor
+/// \param[in] _elapsed Wall time of the last update
+static void RecordCost(SensorState *_state,
+    const std::chrono::steady_clock::duration &_elapsed)
 {
-  this->RunOnce(math::secNsecToDuration(_time.sec, _time.nsec), _force);
+  if (_state->cost == std::chrono::steady_clock::duration::zero())
+    _state->cost = _elapsed;
+  else
+    _state->cost = (_state->cost * 7 + _elapsed) / 8;
 }
 
 //////////////////////////////////////////////////
-void Manager::RunOnce(
-  const std::chrono::steady_clock::duration &_time, bool _force)
+void ManagerPrivate::UpdateSensors(const std::vector<SensorState *> &_sensors,
+    const std::chrono::steady_clock::duration &_time, bool _force)
 {
-  IGN_PROFILE("SensorManager::RunOnce");
-  for (auto &s : this->dataPtr->sensors)
+  const std::vector<SensorState *> *sensors = &_sensors;
+  if (this->groupByType && this->typeGroups.size() > 1u)
+  {
+    // Counting sort by type group, which keeps the id order within each
+    // group.
+    auto &offsets = this->groupOffsets;
+    offsets.assign(this->typeGroups.size() + 1u, 0u);
+    for (auto &s : _sensors)
+      ++offsets[s->typeGroup + 1u];
+    for (std::size_t i = 1u; i < offsets.size(); ++i)
+      offsets[i] += offsets[i - 1u];
+
+    this->groupedSensors.resize(_sensors.size());
+    for (auto &s : _sensors)
+      this->groupedSensors[offsets[s->typeGroup]++] = s;
+    sensors = &this->groupedSensors;
+  }
+
+  this->parallelSensors.clear();
+  this->serialSensors.clear();
+  for (auto &s : *sensors)
+  {
+    if (s->rendering)
+      this->serialSensors.push_back(s);
+    else
+      this->parallelSensors.push_back(s);
+  }
+
+  // Update a sensor
+  auto update = [&](SensorState *_state)
   {
-    s.second->Update(_time, _force);
+    auto start = std::chrono::steady_clock::now();
+    _state->sensor->Update(_time, _force);
+    RecordCost(_state, std::chrono::steady_clock::now() - start);
+  };
+
+  // Sensors that don't render have no shared mutable state, so they can be
+  // updated concurrently.
+  auto &parallel = this->parallelSensors;
+  this->ForEachOnWorkers(parallel, update);
+
+  // Publish in the order of the list, whichever thread updated the sensors
+  this->CommitPublishes(parallel);
+
+  if (this->serialSensors.empty())
+    return;
+
+  if (this->remoteRendering)
+  {
+    // The local sensors only keep their schedule, the render service
+    // renders them while the caller gets on with the next step.
+    this->remoteSensors.clear();
+    for (auto &s : this->serialSensors)
+    {
+      s->sensor->Update(_time, _force);
+      this->remoteSensors.push_back(s->sensor);
+    }
+    this->remoteRendering->Request(this->remoteSensors, _time,
+        this->modelPoses);
+    return;
+  }
+
+  if (!this->renderThread)
+  {
+    this->RenderSensors(this->serialSensors, _time, _force);
+    return;
   }
+
+  // The render thread works on its own copy of the list, so the caller can
+  // get on with the next step. FinishRendering() waits for it.
+  this->renderSensors = this->serialSensors;
+  this->renderThread->Post([this, _time, _force]
+      {
+        this->RenderSensors(this->renderSensors, _time, _force);
+        if (this->renderCallback)
+          this->renderCallback(_time);
+      });
 }
 
-/////////////////////////////////////////////////
-ignition::sensors::SensorId Manager::CreateSensor(const sdf::Sensor &_sdf)
+//////////////////////////////////////////////////
+void ManagerPrivate::RenderSensors(const std::vector<SensorState *> &_sensors,
+    const std::chrono::steady_clock::duration &_time, bool _force)
 {
-  auto sensor = this->dataPtr->sensorFactory.CreateSensor(_sdf);
-  if (!sensor)
-    return NO_SENSOR;
+  // Update a sensor
+  auto update = [&](SensorState *_state)
+  {
+    auto start = std::chrono::steady_clock::now();
+    _state->sensor->Update(_time, _force);
+    RecordCost(_state, std::chrono::steady_clock::now() - start);
+  };
 
-  SensorId id = sensor->Id();
-  this->dataPtr->sensors[id] = std::move(sensor);
-  return id;
+  // Let rendering sensors update each scene once for all of them, then
+  // render. Rendering sensors stay on the thread that owns the rendering
+  // context.
+  {
+    IGN_PROFILE("SensorManager::RunOnce PrepareFrame");
+    uint64_t frameId = ++frameIdCounter;
+    for (auto &s : _sensors)
+      s->sensor->PrepareFrame(frameId);
+  }
+
+  if (!this->batchedRendering)
+  {
+    for (auto &s : _sensors)
+      update(s);
+    this->CommitPublishes(_sensors);
+    return;
+  }
+
+  // Submit the renders of all staged sensors before reading back any of
+  // them, so the GPU renders the frames of later sensors while earlier ones
+  // are copied. Building and publishing messages doesn't need the rendering
+  // context, so it runs on the worker threads.
+  auto &staged = this->stagedSensors;
+  staged.clear();
+  for (auto &s : _sensors)
+  {
+    if (!s->sensor->StagedUpdates())
+    {
+      update(s);
+      continue;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    s->sensor->Update(_time, _force);
+    s->stageCost = std::chrono::steady_clock::now() - start;
+    staged.push_back(s);
+  }
+
+  auto readback = [&](SensorState *_state)
+  {
+    IGN_PROFILE("SensorManager::RunOnce ReadbackFrame");
+    auto start = std::chrono::steady_clock::now();
+    _state->sensor->ReadbackFrame();
+    _state->stageCost += std::chrono::steady_clock::now() - start;
+  };
+  auto process = [&](SensorState *_state)
+  {
+    IGN_PROFILE("SensorManager::RunOnce ProcessFrame");
+    auto start = std::chrono::steady_clock::now();
+    _state->sensor->ProcessFrame();
+    RecordCost(_state,
+        _state->stageCost + (std::chrono::steady_clock::now() - start));
+  };
+
+  // Each frame is processed by a free worker as soon as it is read back,
+  // while this thread reads back the next ones. Workers that must keep
+  // their sensors read back all frames first.
+  if (this->workerPool && !this->stickyWorkers && !this->deterministic)
+  {
+    this->workerPool->Pipeline(staged.size(),
+        [&](std::size_t _index) { readback(staged[_index]); },
+        [&](std::size_t _index) { process(staged[_index]); });
+  }
+  else
+  {
+    for (auto &s : staged)
+      readback(s);
+    this->ForEachOnWorkers(staged, process);
+  }
+  this->CommitPublishes(_sensors);
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::CommitPublishes(
+    const std::vector<SensorState *> &_sensors)
+{
+  if (!this->deterministic)
+    return;
+
+  for (auto &s : _sensors)
+    s->sensor->CommitPublishes();
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::ForEachOnWorkers(
+    const std::vector<SensorState *> &_sensors,
+    const std::function<void(SensorState *)> &_func)
+{
+  if (!this->workerPool)
+  {
+    for (auto &s : _sensors)
+      _func(s);
+    return;
+  }
+
+  auto job = [&](std::size_t _index)
+  {
+    _func(_sensors[_index]);
+  };
+  if (!this->stickyWorkers)
+  {
+    this->workerPool->ParallelFor(_sensors.size(), job);
+    return;
+  }
+
+  this->sensorWorkers.clear();
+  for (auto &s : _sensors)
+    this->sensorWorkers.push_back(s->worker);
+  this->workerPool->ParallelFor(this->sensorWorkers, job);
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::AssignWorkers()
+{
+  const unsigned int threadCount =
+      this->workerPool ? this->workerPool->ThreadCount() : 1u;
+
+  // In id order, so the same sensors share a worker from run to run
+  std::vector<SensorState *> sorted;
+  for (auto &s : this->states)
+    sorted.push_back(&s.second);
+  std::sort(sorted.begin(), sorted.end(),
+      [](const SensorState *_a, const SensorState *_b)
+      {
+        return _a->sensor->Id() < _b->sensor->Id();
+      });
+  for (std::size_t i = 0u; i < sorted.size(); ++i)
+    sorted[i]->worker = static_cast<unsigned int>(i % threadCount);
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::FinishRendering()
+{
+  if (!this->renderThread)
+    return;
+
+  IGN_PROFILE("SensorManager::FinishRendering");
+  this->renderThread->Wait();
+  if (this->renderReschedule)
+  {
+    for (auto &s : this->renderSensors)
+    {
+      if (!s->everyCycle)
+        this->Schedule(s->sensor->Id(), *s);
+    }
+  }
+  this->renderReschedule = false;
+  this->renderSensors.clear();
+
+  if (this->diagnosticsPending)
+  {
+    this->diagnosticsPending = false;
+    if (!this->diagnosticsTopic.empty())
+      this->PublishDiagnostics(this->diagnosticsPendingTime);
+  }
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::UpdateDueSensors(
+    const std::chrono::steady_clock::duration &_time,
+    const std::chrono::steady_clock::duration *_budget,
+    std::vector<SensorId> *_deferred)
+{
+  // Collect the sensors that are due, skipping stale queue entries.
+  auto &due = this->dueSensors;
+  due = this->everyCycleSensors;
+  auto &queue = this->updateQueue;
+  while (!queue.empty() && queue.top().time <= _time)
+  {
+    QueueEntry entry = queue.top();
+    queue.pop();
+
+    auto iter = this->states.find(entry.id);
+    if (iter == this->states.end() ||
+        iter->second.version != entry.version)
+    {
+      continue;
+    }
+    due.push_back(&iter->second);
+  }
+
+  this->deferredSensors.clear();
+  if (_budget)
+    this->SelectWithinBudget(*_budget);
+
+  this->UpdateSensors(due, _time, false);
+
+  // Queue the sensors again at their new update time. Sensors without an
+  // update rate are not queued. Sensors on the render thread only know
+  // their new update time once FinishRendering() returns.
+  for (auto &s : due)
+  {
+    if (!s->everyCycle &&
+        !(s->rendering && this->renderThread && !this->remoteRendering))
+    {
+      this->Schedule(s->sensor->Id(), *s);
+    }
+  }
+  if (this->renderThread && !this->renderSensors.empty())
+    this->renderReschedule = true;
+
+  // Deferred sensors are queued again at the same time, so they are due on
+  // the next call.
+  if (_deferred)
+    _deferred->clear();
+  for (auto &s : this->deferredSensors)
+  {
+    if (!s->everyCycle)
+      this->Schedule(s->sensor->Id(), *s);
+    if (_deferred)
+      _deferred->push_back(s->sensor->Id());
+  }
+  this->ProcessScheduleChanges();
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::SelectWithinBudget(
+    const std::chrono::steady_clock::duration &_budget)
+{
+  IGN_PROFILE("SensorManager::SelectWithinBudget");
+  auto &candidates = this->budgetCandidates;
+  candidates = this->dueSensors;
+  std::stable_sort(candidates.begin(), candidates.end(),
+      [](const SensorState *_a, const SensorState *_b)
+      {
+        return static_cast<int64_t>(_a->sensor->Priority()) + _a->deferrals >
+            static_cast<int64_t>(_b->sensor->Priority()) + _b->deferrals;
+      });
+
+  // Sensors that don't render share the worker threads, rendering sensors
+  // run one after the other.
+  const auto threads = static_cast<int64_t>(
+      this->workerPool ? this->workerPool->ThreadCount() : 1u);
+  auto serialCost = std::chrono::steady_clock::duration::zero();
+  auto parallelCost = std::chrono::steady_clock::duration::zero();
+
+  auto &due = this->dueSensors;
+  due.clear();
+  for (auto &s : candidates)
+  {
+    auto newSerial = serialCost + (s->rendering ? s->cost :
+        std::chrono::steady_clock::duration::zero());
+    auto newParallel = parallelCost + (s->rendering ?
+        std::chrono::steady_clock::duration::zero() : s->cost);
+
+    if (due.empty() || newSerial + newParallel / threads <= _budget)
+    {
+      serialCost = newSerial;
+      parallelCost = newParallel;
+      s->deferrals = 0u;
+      due.push_back(s);
+    }
+    else
+    {
+      ++s->deferrals;
+      this->deferredSensors.push_back(s);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::UpdateDiagnostics(
+    const std::chrono::steady_clock::duration &_time)
+{
+  if (!this->diagnosticsTopic.empty() && _time >= this->nextDiagnosticsTime)
+  {
+    this->nextDiagnosticsTime = _time + this->diagnosticsPeriod;
+    if (!this->diagnosticsPub.HasConnections())
+      return;
+
+    // The statistics of rendering sensors can't be read while the render
+    // thread updates them, so they are published once it's done
+    if (this->renderThread && !this->renderSensors.empty())
+    {
+      this->diagnosticsPending = true;
+      this->diagnosticsPendingTime = _time;
+    }
+    else
+    {
+      this->PublishDiagnostics(_time);
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::PublishDiagnostics(
+    const std::chrono::steady_clock::duration &_time)
+{
+  IGN_PROFILE("SensorManager::PublishDiagnostics");
+  auto addDouble = [](ignition::msgs::Param *_param, const std::string &_key,
+      double _value)
+  {
+    ignition::msgs::Any any;
+    any.set_type(ignition::msgs::Any::DOUBLE);
+    any.set_double_value(_value);
+    (*_param->mutable_params())[_key] = any;
+  };
+  auto toMs = [](const std::chrono::steady_clock::duration &_d)
+  {
+    return std::chrono::duration<double, std::milli>(_d).count();
+  };
+  auto addTime = [&](ignition::msgs::Param *_param, const std::string &_key,
+      const TimeStats &_stats)
+  {
+    double mean = _stats.count > 0u ?
+        toMs(_stats.total) / static_cast<double>(_stats.count) : 0.0;
+    addDouble(_param, _key + "_mean_ms", mean);
+    addDouble(_param, _key + "_max_ms", toMs(_stats.max));
+    addDouble(_param, _key + "_p50_ms", toMs(_stats.Percentile(0.5)));
+    addDouble(_param, _key + "_p99_ms", toMs(_stats.Percentile(0.99)));
+    addDouble(_param, _key + "_allocations",
+        static_cast<double>(_stats.allocations));
+  };
+  static const char *phaseNames[] = {"render", "copy", "message", "publish",
+      "noise"};
+  static_assert(sizeof(phaseNames) / sizeof(phaseNames[0]) ==
+      static_cast<std::size_t>(UpdatePhase::PHASE_COUNT),
+      "Every update phase needs a name");
+
+  // Achieved rates are averaged since the previous message
+  const double window = this->diagnosticsPublished ?
+      std::chrono::duration<double>(_time - this->lastDiagnosticsTime).count()
+      : 0.0;
+  this->lastDiagnosticsTime = _time;
+  this->diagnosticsPublished = true;
+
+  ignition::msgs::Param_V msg;
+  *msg.mutable_header()->mutable_stamp() = ignition::msgs::Convert(_time);
+  for (auto &s : this->sensors)
+  {
+    SensorStats stats = s.second->Stats();
+    auto param = msg.add_param();
+
+    double achievedRate = 0.0;
+    auto state = this->states.find(s.first);
+    if (state != this->states.end())
+    {
+      uint64_t &lastCount = state->second.diagnosticsUpdateCount;
+      if (window > 0.0 && stats.updateCount >= lastCount)
+      {
+        achievedRate =
+            static_cast<double>(stats.updateCount - lastCount) / window;
+      }
+      lastCount = stats.updateCount;
+    }
+
+    ignition::msgs::Any name;
+    name.set_type(ignition::msgs::Any::STRING);
+    name.set_string_value(s.second->Name());
+    (*param->mutable_params())["name"] = name;
+
+    addDouble(param, "id", static_cast<double>(s.first));
+    addDouble(param, "update_rate", s.second->UpdateRate());
+    addDouble(param, "achieved_rate", achievedRate);
+    addDouble(param, "has_subscribers",
+        s.second->HasConnections() ? 1.0 : 0.0);
+    addDouble(param, "update_count", static_cast<double>(stats.updateCount));
+    addDouble(param, "failed_update_count",
+        static_cast<double>(stats.failedUpdateCount));
+    addDouble(param, "skipped_update_count",
+        static_cast<double>(stats.skippedUpdateCount));
+    addDouble(param, "backpressure_skip_count",
+        static_cast<double>(stats.backpressureSkipCount));
+    addDouble(param, "bytes_published",
+        static_cast<double>(stats.bytesPublished));
+    addDouble(param, "bytes_read_back",
+        static_cast<double>(stats.bytesReadBack));
+    addDouble(param, "dropped_message_count",
+        static_cast<double>(stats.droppedMessageCount));
+    addDouble(param, "dropped_save_count",
+        static_cast<double>(stats.droppedSaveCount));
+
+    const SensorMemory memory = s.second->MemoryUsage();
+    addDouble(param, "render_target_bytes",
+        static_cast<double>(memory.renderTargetBytes));
+    addDouble(param, "readback_bytes",
+        static_cast<double>(memory.readbackBytes));
+    addDouble(param, "message_bytes",
+        static_cast<double>(memory.messageBytes));
+    addTime(param, "update", stats.update);
+    addTime(param, "publish_delay", stats.publishDelay);
+    for (std::size_t i = 0u; i < stats.phases.size(); ++i)
+      addTime(param, phaseNames[i], stats.phases[i]);
+  }
+  this->diagnosticsPub.Publish(msg);
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::ResolveReplayChannels()
+{
+  std::map<std::string, Sensor *> byName;
+  for (const auto &sensor : this->sensors)
+    byName.insert({sensor.second->Name(), sensor.second.get()});
+
+  const auto &channels = this->replay->Channels();
+  for (std::size_t i = 0u; i < channels.size(); ++i)
+  {
+    auto iter = byName.find(channels[i].sensorName);
+    this->replayChannels[i].sensor =
+        iter == byName.end() ? nullptr : iter->second;
+  }
+  this->replayChannelsDirty = false;
+}
+
+//////////////////////////////////////////////////
+void ManagerPrivate::Replay(const std::chrono::steady_clock::duration &_time)
+{
+  IGN_PROFILE("SensorManager::Replay");
+  if (this->replayChannelsDirty)
+    this->ResolveReplayChannels();
+
+  const auto &entries = this->replay->Entries();
+  const auto &channels = this->replay->Channels();
+
+  // Going back in time continues from the first message at the new time
+  if (_time < this->replayTime)
+  {
+    this->replayNext = static_cast<std::size_t>(std::lower_bound(
+        this->replayOrder.begin(), this->replayOrder.end(), _time,
+        [&](const std::size_t _index,
+            const std::chrono::steady_clock::duration &_t)
+        {
+          return entries[_index].simTime < _t;
+        }) - this->replayOrder.begin());
+  }
+  this->replayTime = _time;
+
+  for (; this->replayNext < this->replayOrder.size(); ++this->replayNext)
+  {
+    const RecordingEntry &entry =
+        entries[this->replayOrder[this->replayNext]];
+    if (entry.simTime > _time)
+      break;
+
+    ReplayChannel &channel = this->replayChannels[entry.channel];
+    const RecordingChannel &recorded = channels[entry.channel];
+    if (!channel.msg || !this->replay->Read(entry, *channel.msg))
+      continue;
+
+    if (channel.sensor &&
+        channel.sensor->ReplayMessage(recorded.topic, *channel.msg))
+    {
+      continue;
+    }
+
+    if (!channel.advertised)
+    {
+      channel.advertised = true;
+      channel.pub = this->node->Advertise(recorded.topic, recorded.type);
+      if (!channel.pub)
+      {
+        ignerr << "Unable to create publisher on topic [" << recorded.topic
+               << "] to replay sensor [" << recorded.sensorName << "].\n";
+      }
+    }
+    if (channel.pub)
+      channel.pub.Publish(*channel.msg);
+  }
+}
+
+//////////////////////////////////////////////////
+Manager::Manager() :
+  dataPtr(new ManagerPrivate)
+{
+  this->dataPtr->sensorFactory.SetTransportNode(this->dataPtr->node);
+
+  if (ignition::common::env("IGN_SENSORS_TRACE", this->dataPtr->tracePath) &&
+      !this->dataPtr->tracePath.empty() && !PipelineTrace::Enabled())
+  {
+    PipelineTrace::Enable();
+  }
+}
+
+//////////////////////////////////////////////////
+Manager::~Manager()
+{
+  this->dataPtr->FinishRendering();
+
+  if (!this->dataPtr->tracePath.empty())
+  {
+    std::map<SensorId, std::string> names;
+    for (const auto &sensor : this->dataPtr->sensors)
+      names[sensor.first] = sensor.second->Name();
+    PipelineTrace::WriteChromeTrace(this->dataPtr->tracePath, names);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Manager::Init()
+{
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::sensors::Sensor *Manager::Sensor(
+    ignition::sensors::SensorId _id)
+{
+  auto iter = this->dataPtr->sensors.find(_id);
+  return iter != this->dataPtr->sensors.end() ? iter->second.get() : nullptr;
+}
+
+//////////////////////////////////////////////////
+void Manager::AddPluginPaths(const std::string &_paths)
+{
+  this->dataPtr->sensorFactory.AddPluginPaths(_paths);
+}
+
+//////////////////////////////////////////////////
+bool Manager::PreloadSensorPlugins(const std::vector<std::string> &_types)
+{
+  return this->dataPtr->sensorFactory.PreloadSensorPlugins(_types);
+}
+
+//////////////////////////////////////////////////
+bool Manager::Remove(const ignition::sensors::SensorId _id)
+{
+  this->dataPtr->FinishRendering();
+  auto iter = this->dataPtr->sensors.find(_id);
+  if (iter != this->dataPtr->sensors.end() && this->dataPtr->remoteRendering)
+    this->dataPtr->remoteRendering->RemoveSensor(iter->second.get());
+  bool removed = this->dataPtr->sensors.erase(_id) > 0;
+  if (removed)
+  {
+    // Queue entries of the sensor become stale once its state is gone.
+    this->dataPtr->states.erase(_id);
+    this->dataPtr->sensorListsDirty = true;
+    this->dataPtr->replayChannelsDirty = true;
+  }
+  return removed;
+}
+
+//////////////////////////////////////////////////
+bool Manager::Stats(const ignition::sensors::SensorId _id,
+    SensorStats &_stats) const
+{
+  auto iter = this->dataPtr->sensors.find(_id);
+  if (iter == this->dataPtr->sensors.end())
+    return false;
+
+  _stats = iter->second->Stats();
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Manager::MemoryUsage(const ignition::sensors::SensorId _id,
+    SensorMemory &_memory) const
+{
+  auto iter = this->dataPtr->sensors.find(_id);
+  if (iter == this->dataPtr->sensors.end())
+    return false;
+
+  _memory = iter->second->MemoryUsage();
+  return true;
+}
+
+//////////////////////////////////////////////////
+SensorMemory Manager::TotalMemoryUsage() const
+{
+  SensorMemory total;
+  for (auto &s : this->dataPtr->sensors)
+    total += s.second->MemoryUsage();
+  return total;
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetDiagnosticsTopic(const std::string &_topic,
+    const std::chrono::steady_clock::duration &_period)
+{
+  this->dataPtr->diagnosticsPeriod = _period;
+  if (_topic.empty())
+  {
+    this->dataPtr->diagnosticsTopic.clear();
+    this->dataPtr->diagnosticsPub = ignition::transport::Node::Publisher();
+    return true;
+  }
+
+  std::string topic = ignition::transport::TopicUtils::AsValidTopic(_topic);
+  if (topic.empty())
+  {
+    ignerr << "Failed to set diagnostics topic [" << _topic << "]"
+           << std::endl;
+    return false;
+  }
+
+  this->dataPtr->diagnosticsPub =
+      this->dataPtr->node->Advertise<ignition::msgs::Param_V>(topic);
+  if (!this->dataPtr->diagnosticsPub)
+  {
+    ignerr << "Unable to create publisher on topic [" << topic << "]"
+           << std::endl;
+    this->dataPtr->diagnosticsTopic.clear();
+    return false;
+  }
+
+  this->dataPtr->diagnosticsTopic = topic;
+  this->dataPtr->nextDiagnosticsTime =
+      std::chrono::steady_clock::duration::zero();
+  this->dataPtr->diagnosticsPublished = false;
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string Manager::DiagnosticsTopic() const
+{
+  return this->dataPtr->diagnosticsTopic;
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetAggregatedTopic(const std::string &_type,
+    const std::string &_topic)
+{
+  auto &data = *this->dataPtr;
+  data.FinishRendering();
+  const std::string type = ignition::common::lowercase(_type);
+  auto iter = data.aggregatedOutputs.find(type);
+  if (_topic.empty())
+  {
+    if (iter == data.aggregatedOutputs.end())
+      return true;
+
+    // Detach the sensors before their output goes away
+    std::unique_ptr<AggregatedOutput> output = std::move(iter->second);
+    data.aggregatedOutputs.erase(iter);
+    for (auto &sensor : data.sensors)
+      data.AttachAggregatedOutput(sensor.second.get());
+    return true;
+  }
+
+  std::string topic = ignition::transport::TopicUtils::AsValidTopic(_topic);
+  if (topic.empty())
+  {
+    ignerr << "Failed to set aggregated topic [" << _topic << "]"
+           << std::endl;
+    return false;
+  }
+
+  ignition::transport::Node::Publisher pub =
+      data.node->Advertise<ignition::msgs::Double_V>(topic);
+  if (!pub)
+  {
+    ignerr << "Unable to create publisher on topic [" << topic << "]"
+           << std::endl;
+    return false;
+  }
+
+  if (iter == data.aggregatedOutputs.end())
+  {
+    iter = data.aggregatedOutputs.emplace(type,
+        std::unique_ptr<AggregatedOutput>(new AggregatedOutput())).first;
+  }
+  iter->second->topic = topic;
+  iter->second->pub = pub;
+  for (auto &sensor : data.sensors)
+    data.AttachAggregatedOutput(sensor.second.get());
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string Manager::AggregatedTopic(const std::string &_type) const
+{
+  auto iter = this->dataPtr->aggregatedOutputs.find(
+      ignition::common::lowercase(_type));
+  if (iter == this->dataPtr->aggregatedOutputs.end())
+    return "";
+  return iter->second->topic;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetGroupUpdatesByType(const bool _group)
+{
+  this->dataPtr->groupByType = _group;
+}
+
+//////////////////////////////////////////////////
+bool Manager::GroupUpdatesByType() const
+{
+  return this->dataPtr->groupByType;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetStaggerUpdates(const bool _stagger)
+{
+  this->dataPtr->staggerUpdates = _stagger;
+}
+
+//////////////////////////////////////////////////
+bool Manager::StaggerUpdates() const
+{
+  return this->dataPtr->staggerUpdates;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetCompactSensors(const bool _compact)
+{
+  this->dataPtr->compactSensors = _compact;
+}
+
+//////////////////////////////////////////////////
+bool Manager::CompactSensors() const
+{
+  return this->dataPtr->compactSensors;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetLazyUpdates(const bool _lazy)
+{
+  this->dataPtr->lazyUpdates = _lazy;
+  for (auto &s : this->dataPtr->sensors)
+    s.second->SetLazyUpdates(_lazy);
+}
+
+//////////////////////////////////////////////////
+bool Manager::LazyUpdates() const
+{
+  return this->dataPtr->lazyUpdates;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetBatchedRendering(const bool _batched)
+{
+  this->dataPtr->FinishRendering();
+  this->dataPtr->batchedRendering = _batched;
+  for (auto &s : this->dataPtr->states)
+  {
+    if (s.second.rendering)
+      s.second.sensor->SetStagedUpdates(_batched);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Manager::BatchedRendering() const
+{
+  return this->dataPtr->batchedRendering;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetAsyncRendering(const bool _async)
+{
+  if (_async == this->AsyncRendering())
+    return;
+
+  this->dataPtr->FinishRendering();
+  if (_async)
+    this->dataPtr->renderThread.reset(new RenderThread);
+  else
+    this->dataPtr->renderThread.reset();
+}
+
+//////////////////////////////////////////////////
+bool Manager::AsyncRendering() const
+{
+  return this->dataPtr->renderThread != nullptr;
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetRemoteRendering(const std::string &_service,
+    const unsigned int _depth)
+{
+  auto &data = *this->dataPtr;
+  data.FinishRendering();
+  for (auto &s : data.states)
+  {
+    if (s.second.rendering)
+      s.second.sensor->SetRemoteRendered(false);
+  }
+  data.remoteRendering.reset();
+  if (_service.empty())
+    return true;
+
+  std::unique_ptr<RemoteRenderClient> client(new RemoteRenderClient);
+  if (!client->Start(_service, _depth))
+    return false;
+
+  for (auto &s : data.states)
+  {
+    if (!s.second.rendering)
+      continue;
+    s.second.sensor->SetRemoteRendered(true);
+    client->AddSensor(s.second.sensor);
+  }
+  data.remoteRendering = std::move(client);
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string Manager::RemoteRendering() const
+{
+  if (!this->dataPtr->remoteRendering)
+    return "";
+  return this->dataPtr->remoteRendering->Service();
+}
+
+//////////////////////////////////////////////////
+void Manager::WaitForRendering()
+{
+  this->dataPtr->FinishRendering();
+}
+
+//////////////////////////////////////////////////
+bool Manager::RenderingDone() const
+{
+  return !this->dataPtr->renderThread || !this->dataPtr->renderThread->Busy();
+}
+
+//////////////////////////////////////////////////
+std::size_t Manager::WarmUp()
+{
+  auto &data = *this->dataPtr;
+  data.FinishRendering();
+
+  std::vector<ignition::sensors::Sensor *> sensors;
+  for (auto &s : data.states)
+  {
+    if (s.second.rendering && !s.second.sensor->RemoteRendered())
+      sensors.push_back(s.second.sensor);
+  }
+  if (sensors.empty())
+    return 0u;
+
+  std::size_t count = 0u;
+  this->RunOnRenderThread([&]
+      {
+        IGN_PROFILE("SensorManager::WarmUp");
+        // Update each scene once for all sensors
+        const uint64_t frameId = ++frameIdCounter;
+        for (auto *sensor : sensors)
+          sensor->PrepareFrame(frameId);
+        for (auto *sensor : sensors)
+        {
+          if (sensor->WarmUp())
+            ++count;
+        }
+      });
+  igndbg << "Warmed up [" << count << "] rendering sensors.\n";
+  return count;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetRenderCallback(
+    std::function<void(const std::chrono::steady_clock::duration &)>
+    _callback)
+{
+  this->dataPtr->FinishRendering();
+  this->dataPtr->renderCallback = std::move(_callback);
+}
+
+//////////////////////////////////////////////////
+void Manager::RunOnRenderThread(const std::function<void()> &_task)
+{
+  if (this->dataPtr->renderThread)
+    this->dataPtr->renderThread->Run(_task);
+  else
+    _task();
+}
+
+//////////////////////////////////////////////////
+void Manager::SetRenderQuality(const RenderQualityProfile _profile)
+{
+  this->dataPtr->FinishRendering();
+  this->dataPtr->overrideRenderQuality = true;
+  this->dataPtr->renderQuality = _profile;
+  for (auto &s : this->dataPtr->states)
+  {
+    if (s.second.rendering)
+      s.second.sensor->SetRenderQuality(_profile);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Manager::RenderQuality(RenderQualityProfile &_profile) const
+{
+  _profile = this->dataPtr->renderQuality;
+  return this->dataPtr->overrideRenderQuality;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetWorldName(const std::string &_world)
+{
+  this->dataPtr->worldName = _world;
+  for (auto &s : this->dataPtr->sensors)
+    s.second->SetWorldName(_world);
+}
+
+//////////////////////////////////////////////////
+std::string Manager::WorldName() const
+{
+  return this->dataPtr->worldName;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetRenderDeviceCount(const unsigned int _count)
+{
+  const unsigned int count = std::max(1u, _count);
+  if (count == this->dataPtr->renderDeviceCount)
+    return;
+  this->dataPtr->renderDeviceCount = count;
+  this->BalanceRenderDevices();
+}
+
+//////////////////////////////////////////////////
+unsigned int Manager::RenderDeviceCount() const
+{
+  return this->dataPtr->renderDeviceCount;
+}
+
+//////////////////////////////////////////////////
+bool Manager::BalanceRenderDevices()
+{
+  IGN_PROFILE("Manager::BalanceRenderDevices");
+  this->dataPtr->FinishRendering();
+
+  // Render seconds per simulated second of each rendering sensor
+  std::vector<std::pair<double, SensorState *>> costs;
+  for (auto &s : this->dataPtr->states)
+  {
+    if (!s.second.rendering)
+      continue;
+
+    const TimeStats &render = s.second.sensor->Stats().phases[
+        static_cast<std::size_t>(UpdatePhase::RENDER)];
+    const std::chrono::duration<double> time = render.count > 0u ?
+        std::chrono::duration<double>(render.total) / render.count :
+        std::chrono::duration<double>(s.second.cost);
+    const double rate = s.second.sensor->UpdateRate();
+    costs.emplace_back(time.count() * (rate > 0.0 ? rate : 1.0),
+        &s.second);
+  }
+
+  // Costliest first, ties in id order to keep the result stable
+  std::sort(costs.begin(), costs.end(),
+      [](const std::pair<double, SensorState *> &_a,
+         const std::pair<double, SensorState *> &_b)
+      {
+        return _a.first > _b.first || (_a.first == _b.first &&
+            _a.second->sensor->Id() < _b.second->sensor->Id());
+      });
+
+  // Each sensor goes to the device with the lowest cost so far, or with
+  // the fewest sensors among those, so that unmeasured sensors are spread
+  // evenly too
+  const unsigned int count = this->dataPtr->renderDeviceCount;
+  std::vector<std::pair<double, unsigned int>> loads(count, {0.0, 0u});
+  bool changed = false;
+  for (const auto &c : costs)
+  {
+    const unsigned int device = static_cast<unsigned int>(
+        std::min_element(loads.begin(), loads.end()) - loads.begin());
+    loads[device].first += c.first;
+    ++loads[device].second;
+    if (c.second->sensor->RenderDevice() != device)
+    {
+      c.second->sensor->SetRenderDevice(device);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetWorkerThreadCount(const unsigned int _count)
+{
+  const unsigned int count = _count > 0u ? _count :
+      std::max(1u, std::thread::hardware_concurrency());
+  if (count == this->WorkerThreadCount())
+    return;
+
+  // The render thread uses the pool for the staged updates
+  this->dataPtr->FinishRendering();
+  if (count < 2u)
+  {
+    this->dataPtr->workerPool.reset();
+  }
+  else
+  {
+    this->dataPtr->workerPool.reset(new WorkerPool(count));
+    this->dataPtr->workerPool->SetFixedPartitioning(
+        this->dataPtr->deterministic);
+    if (!this->dataPtr->workerCores.empty())
+      this->dataPtr->workerPool->SetThreadAffinity(
+          this->dataPtr->workerCores);
+  }
+  this->dataPtr->AssignWorkers();
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetWorkerAffinity(const std::vector<int> &_cores)
+{
+  auto &data = *this->dataPtr;
+  data.FinishRendering();
+  data.workerCores = _cores;
+  if (!data.workerPool)
+    return true;
+
+  // A new pool, so that the threads left out aren't pinned anymore
+  const unsigned int count = data.workerPool->ThreadCount();
+  data.workerPool.reset(new WorkerPool(count));
+  data.workerPool->SetFixedPartitioning(data.deterministic);
+  return data.workerPool->SetThreadAffinity(_cores);
+}
+
+//////////////////////////////////////////////////
+std::vector<int> Manager::WorkerAffinity() const
+{
+  return this->dataPtr->workerCores;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetStickyWorkers(const bool _sticky)
+{
+  // The render thread picks the workers of the staged updates with it
+  this->dataPtr->FinishRendering();
+  this->dataPtr->stickyWorkers = _sticky;
+}
+
+//////////////////////////////////////////////////
+bool Manager::StickyWorkers() const
+{
+  return this->dataPtr->stickyWorkers;
+}
+
+//////////////////////////////////////////////////
+unsigned int Manager::WorkerThreadCount() const
+{
+  return this->dataPtr->workerPool ?
+      this->dataPtr->workerPool->ThreadCount() : 1u;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetDeterministic(const bool _deterministic)
+{
+  this->dataPtr->FinishRendering();
+  this->dataPtr->deterministic = _deterministic;
+  if (this->dataPtr->workerPool)
+    this->dataPtr->workerPool->SetFixedPartitioning(_deterministic);
+  for (auto &s : this->dataPtr->states)
+    s.second.sensor->SetDeferredPublish(_deterministic);
+}
+
+//////////////////////////////////////////////////
+bool Manager::Deterministic() const
+{
+  return this->dataPtr->deterministic;
+}
+
+//////////////////////////////////////////////////
+void Manager::RunOnce(const ignition::common::Time &_time, bool _force)
+{
+  this->RunOnce(math::secNsecToDuration(_time.sec, _time.nsec), _force);
+}
+
+//////////////////////////////////////////////////
+void Manager::RunOnce(
+  const std::chrono::steady_clock::duration &_time, bool _force)
+{
+  IGN_PROFILE("SensorManager::RunOnce");
+  this->dataPtr->FinishRendering();
+  this->dataPtr->lastRunTime = _time;
+  this->dataPtr->ProcessScheduleChanges();
+  if (this->dataPtr->sensorListsDirty)
+    this->dataPtr->UpdateSensorLists();
+
+  // Forced updates don't change the schedule
+  if (this->dataPtr->replay)
+  {
+    this->dataPtr->Replay(_time);
+  }
+  else if (_force)
+  {
+    this->dataPtr->UpdateSensors(this->dataPtr->allSensors, _time, _force);
+  }
+  else
+  {
+    this->dataPtr->UpdateDueSensors(_time);
+  }
+
+  this->dataPtr->PublishAggregated(_time);
+  this->dataPtr->UpdateDiagnostics(_time);
+}
+
+//////////////////////////////////////////////////
+void Manager::RunOnce(const std::chrono::steady_clock::duration &_time,
+    const std::chrono::steady_clock::duration &_budget,
+    std::vector<ignition::sensors::SensorId> *_deferred)
+{
+  IGN_PROFILE("SensorManager::RunOnce");
+  this->dataPtr->FinishRendering();
+  this->dataPtr->lastRunTime = _time;
+  this->dataPtr->ProcessScheduleChanges();
+  if (this->dataPtr->sensorListsDirty)
+    this->dataPtr->UpdateSensorLists();
+
+  if (this->dataPtr->replay)
+    this->dataPtr->Replay(_time);
+  else
+    this->dataPtr->UpdateDueSensors(_time, &_budget, _deferred);
+  this->dataPtr->PublishAggregated(_time);
+  this->dataPtr->UpdateDiagnostics(_time);
+}
+
+//////////////////////////////////////////////////
+std::size_t Manager::RunUntil(const std::chrono::steady_clock::duration &_time)
+{
+  IGN_PROFILE("SensorManager::RunUntil");
+  auto &data = *this->dataPtr;
+  if (data.replay)
+  {
+    this->RunOnce(_time);
+    return 1u;
+  }
+
+  // Step through the update times between the previous run and _time in
+  // order. Triggered sensors and sensors due at or before the previous
+  // step are held out of the queue, they update at _time.
+  std::size_t steps = 0u;
+  std::vector<QueueEntry> held;
+  auto previous = data.lastRunTime;
+  auto next = data.NextQueuedTime(previous, &held);
+  while (next < _time)
+  {
+    this->RunOnce(next);
+    ++steps;
+    previous = next;
+    next = data.NextQueuedTime(previous, &held);
+  }
+  for (const QueueEntry &entry : held)
+    data.updateQueue.push(entry);
+
+  if (next <= _time || !held.empty() || !data.everyCycleSensors.empty())
+  {
+    this->RunOnce(_time);
+    ++steps;
+  }
+  return steps;
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration Manager::NextDueTime()
+{
+  auto &data = *this->dataPtr;
+  const auto next = data.NextQueuedTime();
+  if (data.replay || !data.everyCycleSensors.empty())
+    return std::chrono::steady_clock::duration::zero();
+  return next;
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetPoses(const std::vector<ignition::sensors::SensorId> &_ids,
+    const std::vector<ignition::math::Pose3d> &_poses)
+{
+  IGN_PROFILE("SensorManager::SetPoses");
+  // The render thread may still read the poses of the previous frame
+  this->dataPtr->FinishRendering();
+
+  if (_ids.size() != _poses.size())
+  {
+    ignerr << "Got [" << _ids.size() << "] sensor ids but ["
+           << _poses.size() << "] poses.\n";
+    return false;
+  }
+
+  bool result = true;
+  const auto end = this->dataPtr->states.end();
+  for (std::size_t i = 0; i < _ids.size(); ++i)
+  {
+    auto iter = this->dataPtr->states.find(_ids[i]);
+    if (iter == end)
+    {
+      result = false;
+      continue;
+    }
+    iter->second.sensor->SetPose(_poses[i]);
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+bool Manager::UpdateSensors(
+    const std::vector<ignition::sensors::SensorId> &_ids,
+    const std::chrono::steady_clock::duration &_time)
+{
+  IGN_PROFILE("SensorManager::UpdateSensors");
+  auto &data = *this->dataPtr;
+  data.FinishRendering();
+
+  bool result = true;
+  std::vector<SensorState *> sensors;
+  sensors.reserve(_ids.size());
+  for (const SensorId id : _ids)
+  {
+    auto iter = data.states.find(id);
+    if (iter == data.states.end())
+    {
+      result = false;
+      continue;
+    }
+    sensors.push_back(&iter->second);
+  }
+
+  // Forced updates don't change the schedule
+  data.UpdateSensors(sensors, _time, true);
+  data.PublishAggregated(_time);
+  return result;
+}
+
+//////////////////////////////////////////////////
+bool Manager::ReconfigureSensor(const ignition::sensors::SensorId _id,
+    const sdf::Sensor &_sdf)
+{
+  this->dataPtr->FinishRendering();
+  auto iter = this->dataPtr->states.find(_id);
+  if (iter == this->dataPtr->states.end())
+  {
+    ignerr << "Unable to reconfigure unknown sensor [" << _id << "].\n";
+    return false;
+  }
+
+  ignition::sensors::Sensor *sensor = iter->second.sensor;
+  if (!iter->second.rendering)
+    return sensor->Reconfigure(_sdf);
+
+  bool result = false;
+  this->RunOnRenderThread([&]
+      {
+        result = sensor->Reconfigure(_sdf);
+      });
+  return result;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetModelPoses(
+    std::shared_ptr<const ModelPoseSnapshot> _snapshot)
+{
+  IGN_PROFILE("SensorManager::SetModelPoses");
+  for (auto &s : this->dataPtr->states)
+    s.second.sensor->SetModelPoseSnapshot(_snapshot);
+  this->dataPtr->modelPoses = std::move(_snapshot);
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<const ModelPoseSnapshot> Manager::ModelPoses() const
+{
+  return this->dataPtr->modelPoses;
+}
+
+//////////////////////////////////////////////////
+void Manager::SetRecordingSink(std::shared_ptr<RecordingSink> _sink)
+{
+  this->dataPtr->recordingSink = std::move(_sink);
+  for (auto &s : this->dataPtr->sensors)
+    s.second->SetRecordingSink(this->dataPtr->recordingSink);
+}
+
+//////////////////////////////////////////////////
+bool Manager::SetReplay(const std::string &_directory)
+{
+  auto &data = *this->dataPtr;
+  data.replay.reset();
+  data.replayChannels.clear();
+  data.replayOrder.clear();
+  data.replayNext = 0u;
+  data.replayTime = std::chrono::steady_clock::duration::zero();
+  if (_directory.empty())
+    return true;
+
+  std::unique_ptr<RecordingReader> reader(new RecordingReader());
+  if (!reader->Open(_directory))
+  {
+    ignerr << "Unable to replay recording [" << _directory << "].\n";
+    return false;
+  }
+
+  data.replayChannels.resize(reader->Channels().size());
+  for (const RecordingChannel &channel : reader->Channels())
+  {
+    data.replayChannels[channel.id].msg =
+        ignition::msgs::Factory::New(channel.type);
+    if (!data.replayChannels[channel.id].msg)
+    {
+      ignerr << "Unknown message type [" << channel.type << "] of sensor ["
+             << channel.sensorName << "], its messages aren't replayed.\n";
+    }
+  }
+
+  // Sensors may publish the messages of an update after later updates of
+  // other sensors, for example with asynchronous rendering
+  const auto &entries = reader->Entries();
+  data.replayOrder.resize(entries.size());
+  for (std::size_t i = 0u; i < entries.size(); ++i)
+    data.replayOrder[i] = i;
+  std::stable_sort(data.replayOrder.begin(), data.replayOrder.end(),
+      [&](const std::size_t _a, const std::size_t _b)
+      {
+        return entries[_a].simTime < entries[_b].simTime;
+      });
+
+  data.replay = std::move(reader);
+  data.replayChannelsDirty = true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool Manager::Replaying() const
+{
+  return this->dataPtr->replay != nullptr;
+}
+
+//////////////////////////////////////////////////
+bool Manager::RunOnce(const std::chrono::steady_clock::duration &_time,
+    const std::vector<ignition::sensors::SensorId> &_ids,
+    const std::vector<ignition::math::Pose3d> &_poses, bool _force)
+{
+  bool result = this->SetPoses(_ids, _poses);
+  this->RunOnce(_time, _force);
+  return result;
+}
+
+/////////////////////////////////////////////////
+ignition::sensors::SensorId Manager::CreateSensor(const sdf::Sensor &_sdf)
+{
+  auto sensor = this->dataPtr->sensorFactory.CreateSensor(_sdf);
+  if (!sensor)
+    return NO_SENSOR;
+
+  SensorId id = sensor->Id();
+  this->dataPtr->AddSensor(sensor.get());
+  this->dataPtr->sensors[id] = std::move(sensor);
+  return id;
+}
+
+//////////////////////////////////////////////////
+ignition::sensors::SensorId Manager::CloneSensor(
+    const ignition::sensors::SensorId _id, const std::string &_name,
+    const std::string &_topic, const std::string &_parent)
+{
+  auto iter = this->dataPtr->sensors.find(_id);
+  if (iter == this->dataPtr->sensors.end())
+  {
+    ignerr << "Unable to clone sensor [" << _id << "], it doesn't exist."
+           << std::endl;
+    return NO_SENSOR;
+  }
+
+  auto sensor = this->dataPtr->sensorFactory.CloneSensor(*iter->second,
+      _name, _topic, _parent);
+  if (!sensor)
+    return NO_SENSOR;
+
+  // Clones of compact sensors keep one copy of their configuration
+  if (this->dataPtr->compactSensors && iter->second->Compact())
+    sensor->ShareSdf(*iter->second);
+
+  SensorId id = sensor->Id();
+  this->dataPtr->AddSensor(sensor.get());
+  this->dataPtr->sensors[id] = std::move(sensor);
+  return id;
+}
+
+//////////////////////////////////////////////////
+std::vector<ignition::sensors::SensorId> Manager::CreateSensors(
+    const std::vector<sdf::Sensor> &_sdfs)
+{
+  IGN_PROFILE("SensorManager::CreateSensors");
+  std::vector<SensorId> ids(_sdfs.size(), NO_SENSOR);
+
+  // Instantiate all sensors first to find out which of them use rendering.
+  std::vector<std::unique_ptr<ignition::sensors::Sensor>> created(
+      _sdfs.size());
+  std::vector<std::size_t> parallel;
+  std::vector<std::size_t> serial;
+  for (std::size_t i = 0u; i < _sdfs.size(); ++i)
+  {
+    created[i] = this->dataPtr->sensorFactory.NewSensor(_sdfs[i].TypeStr());
+    if (!created[i])
+      continue;
+
+    if (created[i]->IsRenderingSensor())
+      serial.push_back(i);
+    else
+      parallel.push_back(i);
+  }
+
+  auto load = [&](std::size_t _index)
+  {
+    auto &sensor = created[_index];
+    if (!sensor->Load(_sdfs[_index]))
+    {
+      ignerr << "Sensor::Load failed for sensor [" << _sdfs[_index].Name()
+             << "]" << std::endl;
+      sensor.reset();
+    }
+    else if (!sensor->Init())
+    {
+      ignerr << "Sensor::Init failed for sensor [" << _sdfs[_index].Name()
+             << "]" << std::endl;
+      sensor.reset();
+    }
+  };
+
+  if (this->dataPtr->workerPool)
+  {
+    this->dataPtr->workerPool->ParallelFor(parallel.size(),
+        [&](std::size_t _index)
+        {
+          load(parallel[_index]);
+        });
+  }
+  else
+  {
+    for (auto index : parallel)
+      load(index);
+  }
+
+  // Rendering sensors create their rendering resources while loading, which
+  // has to happen on the rendering thread.
+  for (auto index : serial)
+    load(index);
+
+  for (std::size_t i = 0u; i < created.size(); ++i)
+  {
+    if (!created[i])
+      continue;
+
+    ids[i] = created[i]->Id();
+    this->dataPtr->AddSensor(created[i].get());
+    this->dataPtr->sensors[ids[i]] = std::move(created[i]);
+  }
+  return ids;
 }
 
 /////////////////////////////////////////////////
@@ -128,6 +2263,7 @@ ignition::sensors::SensorId Manager::CreateSensor(sdf::ElementPtr _sdf)
     return NO_SENSOR;
 
   SensorId id = sensor->Id();
+  this->dataPtr->AddSensor(sensor.get());
   this->dataPtr->sensors[id] = std::move(sensor);
   return id;
 }
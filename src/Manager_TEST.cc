@@ -16,6 +16,10 @@
 */
 
 #include <gtest/gtest.h>
+
+#include <algorithm>
+#include <thread>
+
 #include <ignition/sensors/Manager.hh>
 
 /// \brief Test sensor manager
@@ -55,6 +59,182 @@ TEST(Manager, removeSensor)
   // \todo(nkoenig) Add a sensor, then remove it
 }
 
+//////////////////////////////////////////////////
+TEST(Manager, workerThreadCount)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_TRUE(mgr.Init());
+
+  EXPECT_EQ(1u, mgr.WorkerThreadCount());
+
+  mgr.SetWorkerThreadCount(4u);
+  EXPECT_EQ(4u, mgr.WorkerThreadCount());
+
+  // Running without sensors is a no-op in both modes
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  mgr.SetWorkerThreadCount(1u);
+  EXPECT_EQ(1u, mgr.WorkerThreadCount());
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  // 0 uses one thread per core
+  mgr.SetWorkerThreadCount(0u);
+  EXPECT_EQ(std::max(1u, std::thread::hardware_concurrency()),
+      mgr.WorkerThreadCount());
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, groupUpdatesByType)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.GroupUpdatesByType());
+
+  mgr.SetGroupUpdatesByType(true);
+  EXPECT_TRUE(mgr.GroupUpdatesByType());
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  mgr.SetGroupUpdatesByType(false);
+  EXPECT_FALSE(mgr.GroupUpdatesByType());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, batchedRendering)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.BatchedRendering());
+
+  mgr.SetBatchedRendering(true);
+  EXPECT_TRUE(mgr.BatchedRendering());
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  mgr.SetBatchedRendering(false);
+  EXPECT_FALSE(mgr.BatchedRendering());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, asyncRendering)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.AsyncRendering());
+  EXPECT_TRUE(mgr.RenderingDone());
+
+  // Tasks run on the calling thread without a render thread
+  std::thread::id taskThread;
+  mgr.RunOnRenderThread([&] { taskThread = std::this_thread::get_id(); });
+  EXPECT_EQ(std::this_thread::get_id(), taskThread);
+
+  mgr.SetAsyncRendering(true);
+  EXPECT_TRUE(mgr.AsyncRendering());
+  mgr.RunOnRenderThread([&] { taskThread = std::this_thread::get_id(); });
+  EXPECT_NE(std::this_thread::get_id(), taskThread);
+
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+  mgr.WaitForRendering();
+  EXPECT_TRUE(mgr.RenderingDone());
+
+  mgr.SetAsyncRendering(false);
+  EXPECT_FALSE(mgr.AsyncRendering());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, workerPlacement)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.StickyWorkers());
+  EXPECT_TRUE(mgr.WorkerAffinity().empty());
+
+  mgr.SetStickyWorkers(true);
+  EXPECT_TRUE(mgr.StickyWorkers());
+  mgr.SetWorkerThreadCount(3u);
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  // Unpinned workers are always allowed
+  EXPECT_TRUE(mgr.SetWorkerAffinity({-1, -1}));
+  EXPECT_EQ((std::vector<int>{-1, -1}), mgr.WorkerAffinity());
+  EXPECT_EQ(3u, mgr.WorkerThreadCount());
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+
+  EXPECT_TRUE(mgr.SetWorkerAffinity({}));
+  mgr.SetStickyWorkers(false);
+  EXPECT_FALSE(mgr.StickyWorkers());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, warmUp)
+{
+  // Nothing to warm up without rendering sensors
+  ignition::sensors::Manager mgr;
+  EXPECT_EQ(0u, mgr.WarmUp());
+
+  mgr.SetAsyncRendering(true);
+  EXPECT_EQ(0u, mgr.WarmUp());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, compactSensors)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.CompactSensors());
+
+  mgr.SetCompactSensors(true);
+  EXPECT_TRUE(mgr.CompactSensors());
+
+  mgr.SetCompactSensors(false);
+  EXPECT_FALSE(mgr.CompactSensors());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, memoryUsage)
+{
+  ignition::sensors::Manager mgr;
+  ignition::sensors::SensorMemory memory;
+  EXPECT_FALSE(mgr.MemoryUsage(ignition::sensors::NO_SENSOR, memory));
+
+  memory = mgr.TotalMemoryUsage();
+  EXPECT_EQ(0u, memory.renderTargetBytes);
+  EXPECT_EQ(0u, memory.readbackBytes);
+  EXPECT_EQ(0u, memory.messageBytes);
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, renderQuality)
+{
+  ignition::sensors::Manager mgr;
+  ignition::sensors::RenderQualityProfile profile;
+  EXPECT_FALSE(mgr.RenderQuality(profile));
+
+  mgr.SetRenderQuality(ignition::sensors::RenderQualityProfile::FAST);
+  EXPECT_TRUE(mgr.RenderQuality(profile));
+  EXPECT_EQ(ignition::sensors::RenderQualityProfile::FAST, profile);
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, worldName)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_EQ("", mgr.WorldName());
+
+  mgr.SetWorldName("orchard");
+  EXPECT_EQ("orchard", mgr.WorldName());
+}
+
+//////////////////////////////////////////////////
+TEST(Manager, renderDevices)
+{
+  ignition::sensors::Manager mgr;
+  EXPECT_EQ(1u, mgr.RenderDeviceCount());
+
+  mgr.SetRenderDeviceCount(4u);
+  EXPECT_EQ(4u, mgr.RenderDeviceCount());
+
+  // Nothing to move without rendering sensors
+  EXPECT_FALSE(mgr.BalanceRenderDevices());
+
+  mgr.SetRenderDeviceCount(0u);
+  EXPECT_EQ(1u, mgr.RenderDeviceCount());
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_MODELGRID_HH_
+#define IGNITION_SENSORS_MODELGRID_HH_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ignition/math/Vector3.hh>
+
+#include "ignition/sensors/config.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Uniform grid of model positions. Models are bucketed in
+    /// cubic cells, so a box query only visits the models of the cells it
+    /// overlaps instead of every model. Moving a model only touches the
+    /// grid when it changes cells. Only empty cells are dropped, so the
+    /// memory is proportional to the number of models.
+    /// \tparam IdT Type identifying models, such as their name or index.
+    template<typename IdT>
+    class ModelGrid
+    {
+      /// \brief Constructor
+      /// \param[in] _cellSize Edge length of the cells, in meters
+      public: explicit ModelGrid(const double _cellSize = 1.0)
+      {
+        this->SetCellSize(_cellSize);
+      }
+
+      /// \brief Set the edge length of the cells. Models already in the
+      /// grid are bucketed again.
+      /// \param[in] _cellSize Edge length of the cells, in meters. Values
+      /// that aren't finite or positive are ignored.
+      public: void SetCellSize(const double _cellSize)
+      {
+        if (!std::isfinite(_cellSize) || _cellSize <= 0.0 ||
+            _cellSize == this->cellSize)
+        {
+          return;
+        }
+        this->cellSize = _cellSize;
+
+        std::vector<std::pair<IdT, math::Vector3d>> all;
+        all.reserve(this->models.size());
+        for (const auto &model : this->models)
+          all.emplace_back(model.first, model.second.position);
+        this->Clear();
+        for (const auto &model : all)
+          this->Set(model.first, model.second);
+      }
+
+      /// \brief Get the edge length of the cells.
+      /// \return Edge length, in meters
+      public: double CellSize() const
+      {
+        return this->cellSize;
+      }
+
+      /// \brief Add a model, or move it if it's already in the grid.
+      /// \param[in] _id Id of the model
+      /// \param[in] _position Position of the model
+      public: void Set(const IdT &_id,
+                  const math::Vector3d &_position)
+      {
+        const Key key = this->KeyOf(_position);
+        auto it = this->models.find(_id);
+        if (it != this->models.end())
+        {
+          it->second.position = _position;
+          if (it->second.key == key)
+            return;
+          this->Unlink(_id, it->second.key);
+          it->second.key = key;
+        }
+        else
+        {
+          this->models.emplace(_id, Entry{_position, key});
+        }
+        this->cells[key].push_back(_id);
+      }
+
+      /// \brief Remove a model.
+      /// \param[in] _id Id of the model
+      public: void Remove(const IdT &_id)
+      {
+        auto it = this->models.find(_id);
+        if (it == this->models.end())
+          return;
+        this->Unlink(_id, it->second.key);
+        this->models.erase(it);
+      }
+
+      /// \brief Remove all models.
+      public: void Clear()
+      {
+        this->models.clear();
+        this->cells.clear();
+      }
+
+      /// \brief Get the number of models in the grid.
+      /// \return Number of models
+      public: std::size_t Size() const
+      {
+        return this->models.size();
+      }
+
+      /// \brief Call a function with the id of each model in a cell that
+      /// overlaps a box. The models may lie outside the box, callers are
+      /// expected to run their own exact test, and are visited in no
+      /// particular order.
+      /// \param[in] _min Minimum corner of the box
+      /// \param[in] _max Maximum corner of the box
+      /// \param[in] _func Function called with each candidate id
+      public: template<typename F>
+              void Query(const math::Vector3d &_min,
+                  const math::Vector3d &_max, F &&_func) const
+      {
+        const Key lo = this->KeyOf(_min);
+        const Key hi = this->KeyOf(_max);
+        std::int64_t lower[3];
+        std::int64_t upper[3];
+        Unpack(lo, lower);
+        Unpack(hi, upper);
+
+        double volume = 1.0;
+        for (int i = 0; i < 3; ++i)
+        {
+          if (upper[i] < lower[i])
+            return;
+          volume *= static_cast<double>(upper[i] - lower[i] + 1);
+        }
+
+        // Walk the occupied cells instead of the box when the box spans
+        // more cells than there are occupied ones
+        if (volume > static_cast<double>(this->cells.size()))
+        {
+          for (const auto &cell : this->cells)
+          {
+            std::int64_t index[3];
+            Unpack(cell.first, index);
+            if (index[0] < lower[0] || index[0] > upper[0] ||
+                index[1] < lower[1] || index[1] > upper[1] ||
+                index[2] < lower[2] || index[2] > upper[2])
+            {
+              continue;
+            }
+            for (const IdT &id : cell.second)
+              _func(id);
+          }
+          return;
+        }
+
+        for (std::int64_t x = lower[0]; x <= upper[0]; ++x)
+        {
+          for (std::int64_t y = lower[1]; y <= upper[1]; ++y)
+          {
+            for (std::int64_t z = lower[2]; z <= upper[2]; ++z)
+            {
+              auto cell = this->cells.find(Pack(x, y, z));
+              if (cell == this->cells.end())
+                continue;
+              for (const IdT &id : cell->second)
+                _func(id);
+            }
+          }
+        }
+      }
+
+      /// \brief Packed cell indices, 21 bits per axis
+      private: using Key = std::uint64_t;
+
+      /// \brief Bits used by each cell index
+      private: static constexpr int kBits = 21;
+
+      /// \brief Largest cell index on each axis
+      private: static constexpr std::int64_t kLimit =
+          (std::int64_t(1) << (kBits - 1)) - 1;
+
+      /// \brief Cell and position of a model
+      private: struct Entry
+      {
+        /// \brief Position of the model
+        math::Vector3d position;
+
+        /// \brief Cell of the model
+        Key key;
+      };
+
+      /// \brief Pack cell indices in a key.
+      /// \param[in] _x Index along x
+      /// \param[in] _y Index along y
+      /// \param[in] _z Index along z
+      /// \return Key of the cell
+      private: static Key Pack(const std::int64_t _x, const std::int64_t _y,
+                   const std::int64_t _z)
+      {
+        const Key mask = (Key(1) << kBits) - 1;
+        return ((Key(_x + kLimit) & mask) << (2 * kBits)) |
+               ((Key(_y + kLimit) & mask) << kBits) |
+               (Key(_z + kLimit) & mask);
+      }
+
+      /// \brief Unpack the cell indices of a key.
+      /// \param[in] _key Key of the cell
+      /// \param[out] _index Indices along x, y and z
+      private: static void Unpack(const Key _key, std::int64_t _index[3])
+      {
+        const Key mask = (Key(1) << kBits) - 1;
+        _index[0] = std::int64_t((_key >> (2 * kBits)) & mask) - kLimit;
+        _index[1] = std::int64_t((_key >> kBits) & mask) - kLimit;
+        _index[2] = std::int64_t(_key & mask) - kLimit;
+      }
+
+      /// \brief Get the key of the cell holding a position. Positions
+      /// beyond the grid are clamped to its border cells.
+      /// \param[in] _position Position
+      /// \return Key of the cell
+      private: Key KeyOf(const math::Vector3d &_position) const
+      {
+        std::int64_t index[3];
+        for (int i = 0; i < 3; ++i)
+        {
+          const double cell = std::floor(_position[i] / this->cellSize);
+          // NaN falls in the upper border cells
+          index[i] = cell < static_cast<double>(kLimit) ?
+              (cell > static_cast<double>(-kLimit) ?
+               static_cast<std::int64_t>(cell) : -kLimit) : kLimit;
+        }
+        return Pack(index[0], index[1], index[2]);
+      }
+
+      /// \brief Remove a model id from a cell, dropping the cell once
+      /// it's empty.
+      /// \param[in] _id Id of the model
+      /// \param[in] _key Key of the cell
+      private: void Unlink(const IdT &_id, const Key _key)
+      {
+        auto cell = this->cells.find(_key);
+        if (cell == this->cells.end())
+          return;
+        auto &ids = cell->second;
+        auto it = std::find(ids.begin(), ids.end(), _id);
+        if (it != ids.end())
+        {
+          *it = std::move(ids.back());
+          ids.pop_back();
+        }
+        if (ids.empty())
+          this->cells.erase(cell);
+      }
+
+      /// \brief Edge length of the cells, in meters
+      private: double cellSize = 0.0;
+
+      /// \brief Models in the grid
+      private: std::unordered_map<IdT, Entry> models;
+
+      /// \brief Ids of the models in each occupied cell
+      private: std::unordered_map<Key, std::vector<IdT>> cells;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <set>
+#include <string>
+
+#include "ModelGrid.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Get the names of the candidates of a box query
+std::set<std::string> Candidates(const ModelGrid<std::string> &_grid,
+    const math::Vector3d &_min, const math::Vector3d &_max)
+{
+  std::set<std::string> names;
+  _grid.Query(_min, _max, [&](const std::string &_name)
+      {
+        names.insert(_name);
+      });
+  return names;
+}
+
+//////////////////////////////////////////////////
+TEST(ModelGrid, Query)
+{
+  ModelGrid<std::string> grid(10.0);
+  EXPECT_DOUBLE_EQ(10.0, grid.CellSize());
+  EXPECT_TRUE(Candidates(grid, math::Vector3d(-1, -1, -1),
+      math::Vector3d(1, 1, 1)).empty());
+
+  grid.Set("near", math::Vector3d(1, 2, 0));
+  grid.Set("far", math::Vector3d(105, 0, 0));
+  grid.Set("below", math::Vector3d(0, 0, -25));
+  EXPECT_EQ(3u, grid.Size());
+
+  auto names = Candidates(grid, math::Vector3d(0, 0, 0),
+      math::Vector3d(5, 5, 5));
+  EXPECT_EQ(std::set<std::string>({"near"}), names);
+
+  names = Candidates(grid, math::Vector3d(-30, -30, -30),
+      math::Vector3d(30, 30, 30));
+  EXPECT_EQ(std::set<std::string>({"near", "below"}), names);
+
+  // A box spanning more cells than there are models
+  names = Candidates(grid, math::Vector3d(-1e6, -1e6, -1e6),
+      math::Vector3d(1e6, 1e6, 1e6));
+  EXPECT_EQ(3u, names.size());
+
+  // An inverted box has no candidates
+  EXPECT_TRUE(Candidates(grid, math::Vector3d(30, 30, 30),
+      math::Vector3d(-30, -30, -30)).empty());
+}
+
+//////////////////////////////////////////////////
+TEST(ModelGrid, MoveAndRemove)
+{
+  ModelGrid<std::string> grid(1.0);
+  grid.Set("a", math::Vector3d(0.5, 0.5, 0.5));
+  grid.Set("b", math::Vector3d(0.6, 0.5, 0.5));
+
+  // Moving within a cell and across cells
+  grid.Set("a", math::Vector3d(0.7, 0.5, 0.5));
+  grid.Set("b", math::Vector3d(-3.5, 0.5, 0.5));
+  EXPECT_EQ(2u, grid.Size());
+  EXPECT_EQ(std::set<std::string>({"a"}), Candidates(grid,
+      math::Vector3d(0, 0, 0), math::Vector3d(0.9, 0.9, 0.9)));
+  EXPECT_EQ(std::set<std::string>({"b"}), Candidates(grid,
+      math::Vector3d(-4, 0, 0), math::Vector3d(-3, 0.9, 0.9)));
+
+  grid.Remove("a");
+  grid.Remove("missing");
+  EXPECT_EQ(1u, grid.Size());
+  EXPECT_TRUE(Candidates(grid, math::Vector3d(0, 0, 0),
+      math::Vector3d(0.9, 0.9, 0.9)).empty());
+
+  // Changing the cell size keeps the models
+  grid.SetCellSize(100.0);
+  EXPECT_DOUBLE_EQ(100.0, grid.CellSize());
+  EXPECT_EQ(std::set<std::string>({"b"}), Candidates(grid,
+      math::Vector3d(-0.9, 0, 0), math::Vector3d(0.9, 0.9, 0.9)));
+
+  grid.Clear();
+  EXPECT_EQ(0u, grid.Size());
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/sensors/ModelPoseSnapshot.hh"
+
+#include <algorithm>
+#include <utility>
+
+#include <ignition/common/Console.hh>
+
+#include "ModelGrid.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for ModelPoseSnapshot
+class ignition::sensors::ModelPoseSnapshotPrivate
+{
+  /// \brief Name of each model
+  public: std::shared_ptr<const std::vector<std::string>> names;
+
+  /// \brief Pose of each model
+  public: std::vector<math::Pose3d> poses;
+
+  /// \brief Positions of the models, by index
+  public: ModelGrid<std::size_t> grid;
+};
+
+//////////////////////////////////////////////////
+ModelPoseSnapshot::ModelPoseSnapshot(
+    std::shared_ptr<const std::vector<std::string>> _names,
+    std::vector<math::Pose3d> _poses, const double _cellSize)
+  : dataPtr(new ModelPoseSnapshotPrivate())
+{
+  if (!_names)
+  {
+    ignerr << "Model pose snapshot created without a name table.\n";
+    _names = std::make_shared<const std::vector<std::string>>();
+  }
+
+  if (_names->size() != _poses.size())
+  {
+    ignerr << "Got [" << _names->size() << "] model names but ["
+           << _poses.size() << "] poses, extra entries are dropped.\n";
+  }
+
+  this->dataPtr->names = std::move(_names);
+  this->dataPtr->poses = std::move(_poses);
+  const std::size_t count =
+      std::min(this->dataPtr->names->size(), this->dataPtr->poses.size());
+  this->dataPtr->poses.resize(count);
+
+  this->dataPtr->grid.SetCellSize(_cellSize);
+  for (std::size_t i = 0; i < count; ++i)
+    this->dataPtr->grid.Set(i, this->dataPtr->poses[i].Pos());
+}
+
+//////////////////////////////////////////////////
+ModelPoseSnapshot::~ModelPoseSnapshot()
+{
+}
+
+//////////////////////////////////////////////////
+std::size_t ModelPoseSnapshot::Count() const
+{
+  return this->dataPtr->poses.size();
+}
+
+//////////////////////////////////////////////////
+const std::shared_ptr<const std::vector<std::string>> &
+    ModelPoseSnapshot::NameTable() const
+{
+  return this->dataPtr->names;
+}
+
+//////////////////////////////////////////////////
+const std::string &ModelPoseSnapshot::Name(const std::size_t _index) const
+{
+  return (*this->dataPtr->names)[_index];
+}
+
+//////////////////////////////////////////////////
+const math::Pose3d &ModelPoseSnapshot::Pose(const std::size_t _index) const
+{
+  return this->dataPtr->poses[_index];
+}
+
+//////////////////////////////////////////////////
+void ModelPoseSnapshot::Candidates(const math::Vector3d &_min,
+    const math::Vector3d &_max, std::vector<std::size_t> &_indices) const
+{
+  this->dataPtr->grid.Query(_min, _max, [&](const std::size_t _index)
+      {
+        _indices.push_back(_index);
+      });
+}
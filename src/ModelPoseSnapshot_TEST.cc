@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ignition/sensors/ModelPoseSnapshot.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+TEST(ModelPoseSnapshot, Candidates)
+{
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"origin", "far", "close"});
+  std::vector<math::Pose3d> poses{
+      math::Pose3d(0, 0, 0, 0, 0, 0),
+      math::Pose3d(200, 0, 0, 0, 0, 0),
+      math::Pose3d(3, 4, 0, 0, 0, 0)};
+  ModelPoseSnapshot snapshot(names, poses, 10.0);
+
+  EXPECT_EQ(3u, snapshot.Count());
+  EXPECT_EQ(names, snapshot.NameTable());
+  EXPECT_EQ("far", snapshot.Name(1));
+  EXPECT_EQ(poses[2], snapshot.Pose(2));
+
+  std::vector<std::size_t> indices;
+  snapshot.Candidates(math::Vector3d(-1, -1, -1), math::Vector3d(5, 5, 5),
+      indices);
+  std::sort(indices.begin(), indices.end());
+  EXPECT_EQ(std::vector<std::size_t>({0u, 2u}), indices);
+
+  // Indices are appended
+  snapshot.Candidates(math::Vector3d(195, -5, -5),
+      math::Vector3d(205, 5, 5), indices);
+  EXPECT_EQ(3u, indices.size());
+  EXPECT_EQ(1u, indices.back());
+}
+
+//////////////////////////////////////////////////
+TEST(ModelPoseSnapshot, Mismatch)
+{
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"a", "b"});
+  ModelPoseSnapshot shorter(names, {math::Pose3d::Zero});
+  EXPECT_EQ(1u, shorter.Count());
+
+  ModelPoseSnapshot empty(nullptr, {math::Pose3d::Zero});
+  EXPECT_EQ(0u, empty.Count());
+  ASSERT_NE(nullptr, empty.NameTable());
+
+  std::vector<std::size_t> indices;
+  empty.Candidates(math::Vector3d(-1, -1, -1), math::Vector3d(1, 1, 1),
+      indices);
+  EXPECT_TRUE(indices.empty());
+}
@@ -22,6 +22,7 @@
 #endif
 
 #include <functional>
+#include <vector>
 
 #include <ignition/common/Console.hh>
 
@@ -41,6 +42,24 @@ class ignition::sensors::NoisePrivate
 
   /// \brief Callback function for applying custom noise to sensor data.
   public: std::function<double(double, double)> customNoiseCallback;
+
+  /// \brief Callback function for applying custom noise to batches of
+  /// double values.
+  public: std::function<void(double *, std::size_t, double, std::size_t)>
+      customBatchCallback;
+
+  /// \brief Callback function for applying custom noise to batches of
+  /// float values.
+  public: std::function<void(float *, std::size_t, double, std::size_t)>
+      customFloatBatchCallback;
+
+  /// \brief Values handed to the double batch callback by the float
+  /// ApplyBatch, kept to reuse their memory.
+  public: std::vector<double> doubleScratch;
+
+  /// \brief Values handed to the float batch callback by the double
+  /// ApplyBatch, kept to reuse their memory.
+  public: std::vector<float> floatScratch;
 };
 
 //////////////////////////////////////////////////
@@ -131,6 +150,17 @@ double Noise::Apply(double _in, double _dt)
   {
     if (this->dataPtr->customNoiseCallback)
       return this->dataPtr->customNoiseCallback(_in, _dt);
+    else if (this->dataPtr->customBatchCallback)
+    {
+      this->dataPtr->customBatchCallback(&_in, 1u, _dt, 1u);
+      return _in;
+    }
+    else if (this->dataPtr->customFloatBatchCallback)
+    {
+      float value = static_cast<float>(_in);
+      this->dataPtr->customFloatBatchCallback(&value, 1u, _dt, 1u);
+      return value;
+    }
     else
     {
       ignerr << "Custom noise callback function not set!"
@@ -149,6 +179,128 @@ double Noise::ApplyImpl(double _in, double /*_dt*/)
   return _in;
 }
 
+//////////////////////////////////////////////////
+template<typename T, typename U>
+static void ApplyCustomBatch(
+    const std::function<void(T *, std::size_t, double, std::size_t)> &_batchCb,
+    const std::function<void(U *, std::size_t, double, std::size_t)>
+        &_otherBatchCb,
+    const std::function<double(double, double)> &_cb,
+    std::vector<U> &_scratch,
+    T *_values, std::size_t _count, double _dt, std::size_t _stride)
+{
+  if (_batchCb)
+  {
+    _batchCb(_values, _count, _dt, _stride);
+  }
+  else if (_otherBatchCb)
+  {
+    // Convert the values for the batch callback of the other type
+    _scratch.resize(_count);
+    for (std::size_t i = 0; i < _count; ++i)
+      _scratch[i] = static_cast<U>(_values[i * _stride]);
+    _otherBatchCb(_scratch.data(), _count, _dt, 1u);
+    for (std::size_t i = 0; i < _count; ++i)
+      _values[i * _stride] = static_cast<T>(_scratch[i]);
+  }
+  else if (_cb)
+  {
+    for (std::size_t i = 0; i < _count; ++i)
+    {
+      T &value = _values[i * _stride];
+      value = static_cast<T>(_cb(value, _dt));
+    }
+  }
+  else
+  {
+    ignerr << "Custom noise callback function not set!"
+        << " Please call SetCustomNoiseCallback within a sensor plugin."
+        << std::endl;
+  }
+}
+
+//////////////////////////////////////////////////
+template<typename T>
+static void ApplyEachImpl(Noise &_noise, T *_values, std::size_t _count,
+    double _dt, std::size_t _stride)
+{
+  for (std::size_t i = 0; i < _count; ++i)
+  {
+    T &value = _values[i * _stride];
+    value = static_cast<T>(_noise.ApplyImpl(value, _dt));
+  }
+}
+
+//////////////////////////////////////////////////
+void Noise::ApplyBatch(double *_values, std::size_t _count, double _dt,
+    std::size_t _stride)
+{
+  if (this->dataPtr->type == NoiseType::NONE || !_values || _count == 0u)
+    return;
+  if (_stride == 0u)
+    _stride = 1u;
+
+  if (this->dataPtr->type == NoiseType::CUSTOM)
+  {
+    ApplyCustomBatch(this->dataPtr->customBatchCallback,
+        this->dataPtr->customFloatBatchCallback,
+        this->dataPtr->customNoiseCallback, this->dataPtr->floatScratch,
+        _values, _count, _dt, _stride);
+    return;
+  }
+
+  this->ApplyBatchImpl(_values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void Noise::ApplyBatch(float *_values, std::size_t _count, double _dt,
+    std::size_t _stride)
+{
+  if (this->dataPtr->type == NoiseType::NONE || !_values || _count == 0u)
+    return;
+  if (_stride == 0u)
+    _stride = 1u;
+
+  if (this->dataPtr->type == NoiseType::CUSTOM)
+  {
+    ApplyCustomBatch(this->dataPtr->customFloatBatchCallback,
+        this->dataPtr->customBatchCallback,
+        this->dataPtr->customNoiseCallback, this->dataPtr->doubleScratch,
+        _values, _count, _dt, _stride);
+    return;
+  }
+
+  this->ApplyBatchImpl(_values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void Noise::ApplyBatchImpl(double *_values, std::size_t _count, double _dt,
+    std::size_t _stride)
+{
+  ApplyEachImpl(*this, _values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void Noise::ApplyBatchImpl(float *_values, std::size_t _count, double _dt,
+    std::size_t _stride)
+{
+  ApplyEachImpl(*this, _values, _count, _dt, _stride);
+}
+
+//////////////////////////////////////////////////
+void Noise::SetSeed(std::uint64_t /*_seed*/)
+{
+}
+
+//////////////////////////////////////////////////
+NoisePtr Noise::Fork(std::uint64_t _seed) const
+{
+  NoisePtr noise(new Noise(this->dataPtr->type));
+  *noise->dataPtr = *this->dataPtr;
+  noise->SetSeed(_seed);
+  return noise;
+}
+
 //////////////////////////////////////////////////
 NoiseType Noise::Type() const
 {
@@ -162,6 +314,22 @@ void Noise::SetCustomNoiseCallback(std::function<double(double, double)> _cb)
   this->dataPtr->customNoiseCallback = _cb;
 }
 
+//////////////////////////////////////////////////
+void Noise::SetCustomBatchNoiseCallback(
+    std::function<void(double *, std::size_t, double, std::size_t)> _cb)
+{
+  this->dataPtr->type = NoiseType::CUSTOM;
+  this->dataPtr->customBatchCallback = _cb;
+}
+
+//////////////////////////////////////////////////
+void Noise::SetCustomBatchNoiseCallback(
+    std::function<void(float *, std::size_t, double, std::size_t)> _cb)
+{
+  this->dataPtr->type = NoiseType::CUSTOM;
+  this->dataPtr->customFloatBatchCallback = _cb;
+}
+
 //////////////////////////////////////////////////
 void Noise::Print(std::ostream &_out) const
 {
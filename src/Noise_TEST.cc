@@ -388,6 +388,217 @@ TEST(NoiseTest, ApplyGaussianQuantized)
   }
 }
 
+//////////////////////////////////////////////////
+// Helper function for computing sample mean and variance
+void SampleStats(const std::vector<double> &_values, double &_mean,
+    double &_variance)
+{
+  double sum = std::accumulate(_values.begin(), _values.end(), 0.0);
+  _mean = sum / _values.size();
+  double sqSum = 0.0;
+  for (double v : _values)
+    sqSum += (v - _mean) * (v - _mean);
+  _variance = sqSum / _values.size();
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, ApplyBatch)
+{
+  double mean = 10.0;
+  double stddev = 5.0;
+  double biasMean = 100.0;
+  double biasStddev = 0.0;
+
+  // NONE leaves the values untouched
+  {
+    sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+        NoiseSdf("none", 0, 0, 0, 0, 0));
+    std::vector<double> values(100, 42.0);
+    noise->ApplyBatch(values.data(), values.size());
+    for (double v : values)
+      EXPECT_DOUBLE_EQ(42.0, v);
+  }
+
+  // Gaussian batch has the same statistics as the per value path
+  {
+    sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+        NoiseSdf("gaussian", mean, stddev, biasMean, biasStddev, 0));
+    sensors::GaussianNoiseModelPtr gaussianNoise =
+      std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(noise);
+    ASSERT_NE(nullptr, gaussianNoise);
+
+    double x = 42.0;
+    std::vector<double> values(g_applyCount, x);
+    noise->ApplyBatch(values.data(), values.size());
+
+    double sampleMean, sampleVariance;
+    SampleStats(values, sampleMean, sampleVariance);
+
+    double expectedMean = x + gaussianNoise->Mean() + gaussianNoise->Bias();
+    EXPECT_NEAR(sampleMean, expectedMean,
+        g_sigma * stddev / sqrt(g_applyCount));
+    double variance = stddev * stddev;
+    EXPECT_NEAR(sampleVariance, variance,
+        g_sigma * sqrt(2 * variance * variance / (g_applyCount - 1)));
+  }
+
+  // Strided float batch only touches every third value
+  {
+    sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+        NoiseSdf("gaussian", 0.0, stddev, 0.0, 0.0, 0));
+    const std::size_t count = g_applyCount;
+    std::vector<float> buffer(count * 3u, 7.0f);
+    noise->ApplyBatch(buffer.data(), count, 0.0, 3u);
+
+    std::vector<double> values;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      values.push_back(buffer[i * 3u]);
+      EXPECT_FLOAT_EQ(7.0f, buffer[i * 3u + 1u]);
+      EXPECT_FLOAT_EQ(7.0f, buffer[i * 3u + 2u]);
+    }
+
+    double sampleMean, sampleVariance;
+    SampleStats(values, sampleMean, sampleVariance);
+    EXPECT_NEAR(sampleMean, 7.0, g_sigma * stddev / sqrt(count));
+    double variance = stddev * stddev;
+    EXPECT_NEAR(sampleVariance, variance,
+        g_sigma * sqrt(2 * variance * variance / (count - 1)));
+  }
+
+  // Quantization is applied in the same pass
+  {
+    sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+        NoiseSdf("gaussian_quantized", 0.0, 0.0, 0.0, 0.0, 0.3));
+    std::vector<double> values = {0.32, 0.28, -12.92, -12.88};
+    noise->ApplyBatch(values.data(), values.size());
+    EXPECT_NEAR(values[0], 0.3, 1e-6);
+    EXPECT_NEAR(values[1], 0.3, 1e-6);
+    EXPECT_NEAR(values[2], -12.9, 1e-6);
+    EXPECT_NEAR(values[3], -12.9, 1e-6);
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, Seed)
+{
+  sdf::ElementPtr sdf = NoiseSdf("gaussian", 0.0, 2.0, 1.0, 0.5, 0);
+  sensors::NoisePtr noiseA = sensors::NoiseFactory::NewNoiseModel(sdf);
+  sensors::NoisePtr noiseB = sensors::NoiseFactory::NewNoiseModel(sdf);
+  sensors::NoisePtr noiseC = sensors::NoiseFactory::NewNoiseModel(sdf);
+  ASSERT_NE(nullptr, noiseA);
+  ASSERT_NE(nullptr, noiseB);
+  ASSERT_NE(nullptr, noiseC);
+
+  // Models with the same seed produce the same noise, regardless of the
+  // order they are used in
+  noiseA->SetSeed(1234u);
+  noiseB->SetSeed(1234u);
+  noiseC->SetSeed(4321u);
+
+  std::vector<double> valuesB(100, 0.0);
+  noiseB->ApplyBatch(valuesB.data(), valuesB.size(), 0.1);
+  std::vector<double> valuesA(100, 0.0);
+  noiseA->ApplyBatch(valuesA.data(), valuesA.size(), 0.1);
+  std::vector<double> valuesC(100, 0.0);
+  noiseC->ApplyBatch(valuesC.data(), valuesC.size(), 0.1);
+
+  EXPECT_EQ(valuesA, valuesB);
+  EXPECT_NE(valuesA, valuesC);
+
+  // The same holds for the per value path
+  for (unsigned int i = 0; i < 100; ++i)
+    EXPECT_DOUBLE_EQ(noiseA->Apply(1.0, 0.1), noiseB->Apply(1.0, 0.1));
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, Fork)
+{
+  sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+      NoiseSdf("gaussian", 1.0, 2.0, 3.0, 0.5, 0));
+  ASSERT_NE(nullptr, noise);
+  noise->SetSeed(42u);
+
+  // Forks keep the parameters and sampled bias
+  sensors::NoisePtr forkA = noise->Fork(1u);
+  sensors::NoisePtr forkB = noise->Fork(1u);
+  sensors::NoisePtr forkC = noise->Fork(2u);
+  auto gaussian =
+      std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(noise);
+  auto gaussianFork =
+      std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(forkA);
+  ASSERT_NE(nullptr, gaussian);
+  ASSERT_NE(nullptr, gaussianFork);
+  EXPECT_DOUBLE_EQ(gaussian->Mean(), gaussianFork->Mean());
+  EXPECT_DOUBLE_EQ(gaussian->StdDev(), gaussianFork->StdDev());
+  EXPECT_DOUBLE_EQ(gaussian->Bias(), gaussianFork->Bias());
+
+  // Forks with the same seed match, others draw different noise
+  std::vector<double> valuesA(100, 0.0);
+  std::vector<double> valuesB(100, 0.0);
+  std::vector<double> valuesC(100, 0.0);
+  std::vector<double> values(100, 0.0);
+  forkA->ApplyBatch(valuesA.data(), valuesA.size());
+  forkB->ApplyBatch(valuesB.data(), valuesB.size());
+  forkC->ApplyBatch(valuesC.data(), valuesC.size());
+  noise->ApplyBatch(values.data(), values.size());
+  EXPECT_EQ(valuesA, valuesB);
+  EXPECT_NE(valuesA, valuesC);
+  EXPECT_NE(valuesA, values);
+
+  // Models without randomness fork into the same type
+  sensors::NoisePtr none = sensors::NoiseFactory::NewNoiseModel(
+      NoiseSdf("none", 0, 0, 0, 0, 0));
+  sensors::NoisePtr noneFork = none->Fork(1u);
+  ASSERT_NE(nullptr, noneFork);
+  EXPECT_EQ(sensors::NoiseType::NONE, noneFork->Type());
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, Table)
+{
+  double mean = 1.0;
+  double stddev = 2.0;
+  sensors::NoisePtr noise = sensors::NoiseFactory::NewNoiseModel(
+      NoiseSdf("gaussian", mean, stddev, 0.0, 0.0, 0));
+  sensors::GaussianNoiseModelPtr gaussian =
+    std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(noise);
+  ASSERT_NE(nullptr, gaussian);
+  EXPECT_EQ(0u, gaussian->TableSize());
+
+  // Sizes are rounded up to a power of two
+  gaussian->SetTableSize(1000u);
+  EXPECT_EQ(1024u, gaussian->TableSize());
+  gaussian->SetTableSize(4096u);
+  EXPECT_EQ(4096u, gaussian->TableSize());
+
+  // Table noise has the requested statistics
+  const std::size_t count = 4096u;
+  std::vector<double> values(count, 0.0);
+  noise->ApplyBatch(values.data(), values.size());
+
+  double sampleMean, sampleVariance;
+  SampleStats(values, sampleMean, sampleVariance);
+  EXPECT_NEAR(sampleMean, mean, g_sigma * stddev / sqrt(count));
+  double variance = stddev * stddev;
+  EXPECT_NEAR(sampleVariance, variance,
+      g_sigma * sqrt(2 * variance * variance / (count - 1)));
+
+  // It is reproducible from a seed, also in table mode
+  sensors::NoisePtr other = sensors::NoiseFactory::NewNoiseModel(
+      NoiseSdf("gaussian", mean, stddev, 0.0, 0.0, 0));
+  std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(other)->
+      SetTableSize(4096u);
+  noise->SetSeed(7u);
+  other->SetSeed(7u);
+  for (unsigned int i = 0; i < 100; ++i)
+    EXPECT_DOUBLE_EQ(noise->Apply(0.0), other->Apply(0.0));
+
+  // Disabling table mode goes back to the random stream
+  gaussian->SetTableSize(0u);
+  EXPECT_EQ(0u, gaussian->TableSize());
+}
+
 //////////////////////////////////////////////////
 // Callback function for applying custom noise
 double OnApplyCustomNoise(double _in, double /*_dt*/)
@@ -412,6 +623,120 @@ TEST(NoiseTest, OnApplyNoise)
     double value = noise->Apply(i);
     EXPECT_DOUBLE_EQ(value, i*2);
   }
+
+  // The custom callback is also used by the batch path
+  std::vector<double> values = {1.0, 2.0, 3.0};
+  noise->ApplyBatch(values.data(), values.size());
+  EXPECT_DOUBLE_EQ(2.0, values[0]);
+  EXPECT_DOUBLE_EQ(4.0, values[1]);
+  EXPECT_DOUBLE_EQ(6.0, values[2]);
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, OnApplyBatchNoise)
+{
+  sensors::NoisePtr noise(new sensors::Noise(sensors::NoiseType::NONE));
+
+  int doubleCalls = 0;
+  noise->SetCustomBatchNoiseCallback(
+      [&doubleCalls](double *_values, std::size_t _count, double _dt,
+        std::size_t _stride)
+      {
+        ++doubleCalls;
+        for (std::size_t i = 0; i < _count; ++i)
+          _values[i * _stride] += _dt;
+      });
+  EXPECT_EQ(sensors::NoiseType::CUSTOM, noise->Type());
+
+  int floatCalls = 0;
+  noise->SetCustomBatchNoiseCallback(
+      [&floatCalls](float *_values, std::size_t _count, double /*_dt*/,
+        std::size_t _stride)
+      {
+        ++floatCalls;
+        for (std::size_t i = 0; i < _count; ++i)
+          _values[i * _stride] *= 2.0f;
+      });
+
+  // The whole batch is handed over in one call
+  std::vector<double> values = {1.0, 2.0, 3.0, 4.0};
+  noise->ApplyBatch(values.data(), 2u, 0.5, 2u);
+  EXPECT_EQ(1, doubleCalls);
+  EXPECT_DOUBLE_EQ(1.5, values[0]);
+  EXPECT_DOUBLE_EQ(2.0, values[1]);
+  EXPECT_DOUBLE_EQ(3.5, values[2]);
+  EXPECT_DOUBLE_EQ(4.0, values[3]);
+
+  std::vector<float> floats(100, 1.0f);
+  noise->ApplyBatch(floats.data(), floats.size());
+  EXPECT_EQ(1, floatCalls);
+  for (float f : floats)
+    EXPECT_FLOAT_EQ(2.0f, f);
+
+  // Without a per value callback, Apply uses the batch callback
+  EXPECT_DOUBLE_EQ(11.0, noise->Apply(10.0, 1.0));
+  EXPECT_EQ(2, doubleCalls);
+
+  // The per value callback still takes precedence for single values
+  noise->SetCustomNoiseCallback(
+    std::bind(&OnApplyCustomNoise,
+      std::placeholders::_1, std::placeholders::_2));
+  EXPECT_DOUBLE_EQ(20.0, noise->Apply(10.0, 1.0));
+  EXPECT_EQ(2, doubleCalls);
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, OnApplyDoubleBatchNoiseToFloats)
+{
+  sensors::NoisePtr noise(new sensors::Noise(sensors::NoiseType::NONE));
+
+  int calls = 0;
+  noise->SetCustomBatchNoiseCallback(
+      [&calls](double *_values, std::size_t _count, double _dt,
+        std::size_t _stride)
+      {
+        ++calls;
+        for (std::size_t i = 0; i < _count; ++i)
+          _values[i * _stride] += _dt;
+      });
+
+  // Float values go through the double batch callback, keeping the stride
+  std::vector<float> values = {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f};
+  noise->ApplyBatch(values.data(), 3u, 0.5, 2u);
+  EXPECT_EQ(1, calls);
+  EXPECT_FLOAT_EQ(1.5f, values[0]);
+  EXPECT_FLOAT_EQ(2.0f, values[1]);
+  EXPECT_FLOAT_EQ(3.5f, values[2]);
+  EXPECT_FLOAT_EQ(4.0f, values[3]);
+  EXPECT_FLOAT_EQ(5.5f, values[4]);
+  EXPECT_FLOAT_EQ(6.0f, values[5]);
+}
+
+//////////////////////////////////////////////////
+TEST(NoiseTest, OnApplyFloatBatchNoiseToDoubles)
+{
+  sensors::NoisePtr noise(new sensors::Noise(sensors::NoiseType::NONE));
+
+  int calls = 0;
+  noise->SetCustomBatchNoiseCallback(
+      [&calls](float *_values, std::size_t _count, double /*_dt*/,
+        std::size_t _stride)
+      {
+        ++calls;
+        for (std::size_t i = 0; i < _count; ++i)
+          _values[i * _stride] *= 2.0f;
+      });
+
+  // Double values go through the float batch callback, keeping the stride
+  std::vector<double> values = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+  noise->ApplyBatch(values.data(), 2u, 0.1, 3u);
+  EXPECT_EQ(1, calls);
+  EXPECT_DOUBLE_EQ(2.0, values[0]);
+  EXPECT_DOUBLE_EQ(2.0, values[1]);
+  EXPECT_DOUBLE_EQ(3.0, values[2]);
+  EXPECT_DOUBLE_EQ(8.0, values[3]);
+  EXPECT_DOUBLE_EQ(5.0, values[4]);
+  EXPECT_DOUBLE_EQ(6.0, values[5]);
 }
 
 /////////////////////////////////////////////////
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include <ignition/common/Console.hh>
+
+#include "ignition/sensors/PipelineTrace.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Slot of the ring. The fields are atomics so that a reader can
+  /// copy a slot while a writer fills it, seq tells whether the copy is
+  /// whole.
+  class TraceSlot
+  {
+    /// \brief Index of the event in the slot plus one, or zero while the
+    /// slot is being written.
+    public: std::atomic<uint64_t> seq{0u};
+
+    /// \brief TraceEvent::stage
+    public: std::atomic<int> stage{0};
+
+    /// \brief TraceEvent::sensor
+    public: std::atomic<SensorId> sensor{NO_SENSOR};
+
+    /// \brief TraceEvent::simTime, in clock ticks
+    public: std::atomic<int64_t> simTime{0};
+
+    /// \brief TraceEvent::start, in clock ticks since the clock epoch
+    public: std::atomic<int64_t> start{0};
+
+    /// \brief TraceEvent::duration, in clock ticks
+    public: std::atomic<int64_t> duration{0};
+
+    /// \brief TraceEvent::thread
+    public: std::atomic<uint32_t> thread{0u};
+  };
+
+  /// \brief Ring buffer of events.
+  class TraceRing
+  {
+    /// \brief Constructor
+    /// \param[in] _capacity Number of slots
+    public: explicit TraceRing(const std::size_t _capacity)
+            : slots(std::max<std::size_t>(1u, _capacity))
+    {
+    }
+
+    /// \brief The slots, event i goes to slot i modulo the size.
+    public: std::vector<TraceSlot> slots;
+
+    /// \brief Index of the next event
+    public: std::atomic<uint64_t> next{0u};
+  };
+
+  /// \brief Ring being recorded to, null while disabled.
+  std::atomic<TraceRing *> activeRing{nullptr};
+
+  /// \brief Ring of the latest Enable(), read by Events().
+  std::atomic<TraceRing *> latestRing{nullptr};
+
+  /// \brief Number of threads that recorded an event so far.
+  std::atomic<uint32_t> threadCount{0u};
+
+  /// \brief Number of the calling thread, zero until it records an event.
+  thread_local uint32_t tlsThread = 0u;
+
+  /// \brief Protects Enable() and Disable().
+  std::mutex &RingMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+
+  /// \brief Every ring created. Recording threads may still hold an
+  /// earlier ring after Enable() swaps it, so rings are only freed at exit.
+  std::vector<std::unique_ptr<TraceRing>> &Rings()
+  {
+    static std::vector<std::unique_ptr<TraceRing>> rings;
+    return rings;
+  }
+
+  /// \brief Write a string as a JSON string.
+  /// \param[in] _out Stream to write to
+  /// \param[in] _text String to write
+  void WriteJsonString(std::ostream &_out, const std::string &_text)
+  {
+    _out << '"';
+    for (const char c : _text)
+    {
+      if (c == '"' || c == '\\')
+        _out << '\\' << c;
+      else if (static_cast<unsigned char>(c) < 0x20u)
+      {
+        _out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+             << static_cast<int>(c) << std::dec << std::setfill(' ');
+      }
+      else
+        _out << c;
+    }
+    _out << '"';
+  }
+}
+
+//////////////////////////////////////////////////
+void PipelineTrace::Enable(const std::size_t _capacity)
+{
+  std::lock_guard<std::mutex> lock(RingMutex());
+  Rings().emplace_back(new TraceRing(_capacity));
+  latestRing.store(Rings().back().get());
+  activeRing.store(Rings().back().get(), std::memory_order_release);
+}
+
+//////////////////////////////////////////////////
+void PipelineTrace::Disable()
+{
+  std::lock_guard<std::mutex> lock(RingMutex());
+  activeRing.store(nullptr, std::memory_order_release);
+}
+
+//////////////////////////////////////////////////
+bool PipelineTrace::Enabled()
+{
+  return activeRing.load(std::memory_order_relaxed) != nullptr;
+}
+
+//////////////////////////////////////////////////
+void PipelineTrace::Record(const TraceStage _stage, const SensorId _sensor,
+    const std::chrono::steady_clock::duration &_simTime,
+    const std::chrono::steady_clock::time_point &_start,
+    const std::chrono::steady_clock::time_point &_end)
+{
+  TraceRing *ring = activeRing.load(std::memory_order_acquire);
+  if (!ring || _stage < TraceStage::SCHEDULE ||
+      _stage >= TraceStage::STAGE_COUNT)
+  {
+    return;
+  }
+
+  if (tlsThread == 0u)
+    tlsThread = ++threadCount;
+
+  const uint64_t index = ring->next.fetch_add(1u, std::memory_order_relaxed);
+  TraceSlot &slot = ring->slots[index % ring->slots.size()];
+
+  // Readers drop the slot until seq is set again
+  slot.seq.store(0u, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.stage.store(static_cast<int>(_stage), std::memory_order_relaxed);
+  slot.sensor.store(_sensor, std::memory_order_relaxed);
+  slot.simTime.store(_simTime.count(), std::memory_order_relaxed);
+  slot.start.store(_start.time_since_epoch().count(),
+      std::memory_order_relaxed);
+  slot.duration.store((_end - _start).count(), std::memory_order_relaxed);
+  slot.thread.store(tlsThread, std::memory_order_relaxed);
+  slot.seq.store(index + 1u, std::memory_order_release);
+}
+
+//////////////////////////////////////////////////
+std::vector<TraceEvent> PipelineTrace::Events()
+{
+  std::vector<TraceEvent> events;
+  TraceRing *ring = latestRing.load(std::memory_order_acquire);
+  if (!ring)
+    return events;
+
+  using Duration = std::chrono::steady_clock::duration;
+  std::vector<std::pair<uint64_t, TraceEvent>> copies;
+  copies.reserve(ring->slots.size());
+  for (const TraceSlot &slot : ring->slots)
+  {
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq == 0u)
+      continue;
+
+    TraceEvent event;
+    event.stage = static_cast<TraceStage>(
+        slot.stage.load(std::memory_order_relaxed));
+    event.sensor = slot.sensor.load(std::memory_order_relaxed);
+    event.simTime = Duration(slot.simTime.load(std::memory_order_relaxed));
+    event.start = std::chrono::steady_clock::time_point(
+        Duration(slot.start.load(std::memory_order_relaxed)));
+    event.duration = Duration(slot.duration.load(std::memory_order_relaxed));
+    event.thread = slot.thread.load(std::memory_order_relaxed);
+
+    // Drop the copy if a writer took the slot meanwhile
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) != seq)
+      continue;
+    copies.emplace_back(seq, event);
+  }
+
+  std::sort(copies.begin(), copies.end(),
+      [](const std::pair<uint64_t, TraceEvent> &_a,
+         const std::pair<uint64_t, TraceEvent> &_b)
+      {
+        return _a.first < _b.first;
+      });
+  events.reserve(copies.size());
+  for (const auto &copy : copies)
+    events.push_back(copy.second);
+  return events;
+}
+
+//////////////////////////////////////////////////
+void PipelineTrace::WriteChromeTrace(std::ostream &_out,
+    const std::map<SensorId, std::string> &_names)
+{
+  const std::vector<TraceEvent> events = Events();
+
+  // Timestamps are microseconds since the earliest event
+  std::chrono::steady_clock::time_point origin;
+  if (!events.empty())
+  {
+    origin = std::min_element(events.begin(), events.end(),
+        [](const TraceEvent &_a, const TraceEvent &_b)
+        {
+          return _a.start < _b.start;
+        })->start;
+  }
+
+  _out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  _out << std::fixed << std::setprecision(3);
+  bool first = true;
+  for (const TraceEvent &event : events)
+  {
+    if (!first)
+      _out << ",";
+    first = false;
+
+    auto name = _names.find(event.sensor);
+    _out << "\n{\"name\":\"" << StageName(event.stage) << "\""
+         << ",\"cat\":\"sensors\",\"ph\":\"X\",\"pid\":1"
+         << ",\"tid\":" << event.thread
+         << ",\"ts\":" << std::chrono::duration<double, std::micro>(
+                event.start - origin).count()
+         << ",\"dur\":" << std::chrono::duration<double, std::micro>(
+                event.duration).count()
+         << ",\"args\":{\"sensor\":";
+    if (name != _names.end())
+      WriteJsonString(_out, name->second);
+    else
+      _out << "\"" << event.sensor << "\"";
+    _out << ",\"sensor_id\":" << event.sensor
+         << ",\"sim_time\":" << std::setprecision(6)
+         << std::chrono::duration<double>(event.simTime).count()
+         << std::setprecision(3) << "}}";
+  }
+  _out << "\n]}" << std::endl;
+}
+
+//////////////////////////////////////////////////
+bool PipelineTrace::WriteChromeTrace(const std::string &_path,
+    const std::map<SensorId, std::string> &_names)
+{
+  std::ofstream out(_path);
+  if (!out)
+  {
+    ignerr << "Unable to open pipeline trace file [" << _path << "]\n";
+    return false;
+  }
+
+  WriteChromeTrace(out, _names);
+  if (!out)
+  {
+    ignerr << "Unable to write pipeline trace file [" << _path << "]\n";
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+std::string PipelineTrace::StageName(const TraceStage _stage)
+{
+  switch (_stage)
+  {
+    case TraceStage::SCHEDULE:
+      return "schedule";
+    case TraceStage::RENDER:
+      return "render";
+    case TraceStage::READBACK:
+      return "readback";
+    case TraceStage::FILL:
+      return "fill";
+    case TraceStage::PUBLISH:
+      return "publish";
+    case TraceStage::NOISE:
+      return "noise";
+    default:
+      return "";
+  }
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ignition/sensors/PipelineTrace.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+/// \brief Record a stage that started _startUs after _origin and took
+/// _durationUs.
+void RecordAt(const TraceStage _stage, const SensorId _sensor,
+    const std::chrono::steady_clock::time_point &_origin,
+    const int _startUs, const int _durationUs)
+{
+  const auto start = _origin + std::chrono::microseconds(_startUs);
+  PipelineTrace::Record(_stage, _sensor, std::chrono::milliseconds(_sensor),
+      start, start + std::chrono::microseconds(_durationUs));
+}
+
+//////////////////////////////////////////////////
+TEST(PipelineTrace, Ring)
+{
+  PipelineTrace::Disable();
+  const auto origin = std::chrono::steady_clock::now();
+  RecordAt(TraceStage::RENDER, 1u, origin, 0, 10);
+
+  PipelineTrace::Enable(4u);
+  EXPECT_TRUE(PipelineTrace::Enabled());
+  EXPECT_TRUE(PipelineTrace::Events().empty());
+
+  // The two oldest events are overwritten
+  for (int i = 0; i < 6; ++i)
+    RecordAt(TraceStage::FILL, static_cast<SensorId>(i + 1), origin, i, 1);
+
+  auto events = PipelineTrace::Events();
+  ASSERT_EQ(4u, events.size());
+  for (std::size_t i = 0u; i < events.size(); ++i)
+  {
+    EXPECT_EQ(TraceStage::FILL, events[i].stage);
+    EXPECT_EQ(i + 3u, events[i].sensor);
+    EXPECT_EQ(std::chrono::steady_clock::duration(
+        std::chrono::milliseconds(i + 3u)), events[i].simTime);
+    EXPECT_EQ(origin + std::chrono::microseconds(i + 2u), events[i].start);
+    EXPECT_EQ(std::chrono::steady_clock::duration(
+        std::chrono::microseconds(1)), events[i].duration);
+    EXPECT_NE(0u, events[i].thread);
+  }
+
+  // Disabling keeps the events
+  PipelineTrace::Disable();
+  EXPECT_FALSE(PipelineTrace::Enabled());
+  RecordAt(TraceStage::FILL, 100u, origin, 100, 1);
+  events = PipelineTrace::Events();
+  ASSERT_EQ(4u, events.size());
+  EXPECT_EQ(6u, events.back().sensor);
+
+  // Invalid stages are ignored
+  PipelineTrace::Enable(4u);
+  RecordAt(TraceStage::STAGE_COUNT, 1u, origin, 0, 1);
+  EXPECT_TRUE(PipelineTrace::Events().empty());
+  PipelineTrace::Disable();
+}
+
+//////////////////////////////////////////////////
+TEST(PipelineTrace, Threads)
+{
+  PipelineTrace::Enable(4000u);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([t]()
+        {
+          const auto origin = std::chrono::steady_clock::now();
+          for (int i = 0; i < 1000; ++i)
+          {
+            RecordAt(TraceStage::SCHEDULE, static_cast<SensorId>(t + 1),
+                origin, i, 1);
+          }
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  PipelineTrace::Disable();
+
+  const auto events = PipelineTrace::Events();
+  ASSERT_EQ(4000u, events.size());
+
+  // Each thread got its own number, and recorded the events of a sensor
+  std::set<uint32_t> numbers;
+  std::map<SensorId, uint32_t> sensorThreads;
+  for (const auto &event : events)
+  {
+    numbers.insert(event.thread);
+    auto inserted = sensorThreads.insert({event.sensor, event.thread});
+    EXPECT_EQ(inserted.first->second, event.thread);
+  }
+  EXPECT_EQ(4u, numbers.size());
+  EXPECT_EQ(4u, sensorThreads.size());
+}
+
+//////////////////////////////////////////////////
+TEST(PipelineTrace, ChromeTrace)
+{
+  PipelineTrace::Enable(16u);
+  const auto origin = std::chrono::steady_clock::now();
+  RecordAt(TraceStage::SCHEDULE, 1u, origin, 0, 100);
+  RecordAt(TraceStage::RENDER, 1u, origin, 10, 50);
+  RecordAt(TraceStage::PUBLISH, 2u, origin, 20, 5);
+  PipelineTrace::Disable();
+
+  std::ostringstream out;
+  PipelineTrace::WriteChromeTrace(out, {{1u, "cam \"front\""}});
+  const std::string json = out.str();
+
+  EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_NE(std::string::npos, json.find(
+      "{\"name\":\"schedule\",\"cat\":\"sensors\",\"ph\":\"X\",\"pid\":1"));
+  EXPECT_NE(std::string::npos, json.find(
+      "\"ts\":0.000,\"dur\":100.000,"
+      "\"args\":{\"sensor\":\"cam \\\"front\\\"\",\"sensor_id\":1,"
+      "\"sim_time\":0.001000}}"));
+  EXPECT_NE(std::string::npos, json.find(
+      "{\"name\":\"render\""));
+  EXPECT_NE(std::string::npos, json.find(
+      "\"ts\":10.000,\"dur\":50.000"));
+
+  // Unnamed sensors are shown by id
+  EXPECT_NE(std::string::npos, json.find(
+      "\"ts\":20.000,\"dur\":5.000,"
+      "\"args\":{\"sensor\":\"2\",\"sensor_id\":2,\"sim_time\":0.002000}}"));
+  EXPECT_EQ("\n]}\n", json.substr(json.size() - 4u));
+
+  EXPECT_FALSE(PipelineTrace::WriteChromeTrace(
+      std::string("/nonexistent/dir/trace.json")));
+}
+
+//////////////////////////////////////////////////
+TEST(PipelineTrace, StageName)
+{
+  EXPECT_EQ("schedule", PipelineTrace::StageName(TraceStage::SCHEDULE));
+  EXPECT_EQ("render", PipelineTrace::StageName(TraceStage::RENDER));
+  EXPECT_EQ("readback", PipelineTrace::StageName(TraceStage::READBACK));
+  EXPECT_EQ("fill", PipelineTrace::StageName(TraceStage::FILL));
+  EXPECT_EQ("publish", PipelineTrace::StageName(TraceStage::PUBLISH));
+  EXPECT_EQ("noise", PipelineTrace::StageName(TraceStage::NOISE));
+  EXPECT_EQ("", PipelineTrace::StageName(TraceStage::STAGE_COUNT));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
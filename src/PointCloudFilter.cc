@@ -0,0 +1,328 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "PointCloudFilter.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Profiler.hh>
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Marks the empty slots of the voxel table
+  const uint32_t kNoVoxel = UINT32_MAX;
+
+  /// \brief Points accumulated in a voxel
+  struct Voxel
+  {
+    /// \brief Sum of the x coordinates
+    double x;
+
+    /// \brief Sum of the y coordinates
+    double y;
+
+    /// \brief Sum of the z coordinates
+    double z;
+
+    /// \brief Number of points
+    uint32_t count;
+
+    /// \brief Byte offset of the first point in the input data
+    std::size_t first;
+  };
+
+  /// \brief Get the index of a voxel along an axis, clamped to 21 bits.
+  /// \param[in] _value Coordinate, finite
+  /// \param[in] _inverseLeaf Voxels per meter
+  /// \return Offset index, in [0, 2^21)
+  uint64_t VoxelIndex(const float _value, const double _inverseLeaf)
+  {
+    const double limit = 1048575.0;
+    const double index = std::floor(_value * _inverseLeaf);
+    return static_cast<uint64_t>(
+        std::min(limit, std::max(-limit, index)) + limit);
+  }
+}
+
+/// \brief Private data for PointCloudFilter
+class ignition::sensors::PointCloudFilterPrivate
+{
+  /// \brief Find the x, y and z fields of a point cloud.
+  /// \param[in] _msg Point cloud
+  /// \return False if a field is missing or isn't a float.
+  public: bool FindXyz(const msgs::PointCloudPacked &_msg);
+
+  /// \brief Stride of the decimation
+  public: unsigned int stride = 1u;
+
+  /// \brief Edge length of the voxels, 0 if disabled
+  public: double leafSize = 0.0;
+
+  /// \brief Byte offsets of x, y and z in a point
+  public: uint32_t xyz[3] = {0u, 0u, 0u};
+
+  /// \brief Voxel index of each slot of the hash table, kNoVoxel if empty
+  public: std::vector<uint32_t> slots;
+
+  /// \brief Key of each slot of the hash table
+  public: std::vector<uint64_t> keys;
+
+  /// \brief Voxels, in the order of their first point
+  public: std::vector<Voxel> voxels;
+
+  /// \brief True once a missing field was reported
+  public: bool warned = false;
+};
+
+//////////////////////////////////////////////////
+bool PointCloudFilterPrivate::FindXyz(const msgs::PointCloudPacked &_msg)
+{
+  const char *names[3] = {"x", "y", "z"};
+  for (int axis = 0; axis < 3; ++axis)
+  {
+    bool found = false;
+    for (const auto &field : _msg.field())
+    {
+      if (field.name() == names[axis] &&
+          field.datatype() == msgs::PointCloudPacked::Field::FLOAT32 &&
+          field.offset() + sizeof(float) <= _msg.point_step())
+      {
+        this->xyz[axis] = field.offset();
+        found = true;
+        break;
+      }
+    }
+    if (!found)
+      return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+PointCloudFilter::PointCloudFilter()
+  : dataPtr(new PointCloudFilterPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+PointCloudFilter::~PointCloudFilter()
+{
+}
+
+//////////////////////////////////////////////////
+void PointCloudFilter::Load(const sdf::ElementPtr &_sdf)
+{
+  if (!_sdf)
+    return;
+
+  if (_sdf->HasElement("ignition:point_cloud_stride"))
+  {
+    const int stride = _sdf->Get<int>("ignition:point_cloud_stride");
+    if (stride < 1)
+    {
+      ignwarn << "Invalid <ignition:point_cloud_stride> [" << stride
+              << "], point clouds aren't decimated.\n";
+    }
+    this->SetStride(static_cast<unsigned int>(std::max(1, stride)));
+  }
+
+  if (_sdf->HasElement("ignition:voxel_leaf_size"))
+  {
+    const double leaf = _sdf->Get<double>("ignition:voxel_leaf_size");
+    if (!std::isfinite(leaf) || leaf < 0.0)
+    {
+      ignwarn << "Invalid <ignition:voxel_leaf_size> [" << leaf
+              << "], point clouds aren't voxelized.\n";
+    }
+    this->SetLeafSize(leaf);
+  }
+}
+
+//////////////////////////////////////////////////
+void PointCloudFilter::SetStride(const unsigned int _stride)
+{
+  this->dataPtr->stride = std::max(1u, _stride);
+}
+
+//////////////////////////////////////////////////
+unsigned int PointCloudFilter::Stride() const
+{
+  return this->dataPtr->stride;
+}
+
+//////////////////////////////////////////////////
+void PointCloudFilter::SetLeafSize(const double _leafSize)
+{
+  this->dataPtr->leafSize =
+      std::isfinite(_leafSize) && _leafSize > 0.0 ? _leafSize : 0.0;
+}
+
+//////////////////////////////////////////////////
+double PointCloudFilter::LeafSize() const
+{
+  return this->dataPtr->leafSize;
+}
+
+//////////////////////////////////////////////////
+bool PointCloudFilter::Enabled() const
+{
+  return this->dataPtr->stride > 1u || this->dataPtr->leafSize > 0.0;
+}
+
+//////////////////////////////////////////////////
+bool PointCloudFilter::Apply(const msgs::PointCloudPacked &_in,
+    msgs::PointCloudPacked &_out)
+{
+  IGN_PROFILE("PointCloudFilter::Apply");
+  _out.mutable_header()->CopyFrom(_in.header());
+  *_out.mutable_field() = _in.field();
+  _out.set_is_bigendian(_in.is_bigendian());
+  _out.set_point_step(_in.point_step());
+
+  const std::size_t step = _in.point_step();
+  const std::size_t rowStep = _in.row_step();
+  const uint32_t width = _in.width();
+  const uint32_t height = _in.height();
+  const std::string &in = _in.data();
+  std::string *out = _out.mutable_data();
+
+  const bool voxelize = this->dataPtr->leafSize > 0.0;
+  const bool valid = step > 0u &&
+      in.size() >= (height > 0u ? (height - 1u) * rowStep : 0u) +
+      width * step && (!voxelize || this->dataPtr->FindXyz(_in));
+  if (!valid)
+  {
+    if (!this->dataPtr->warned)
+    {
+      ignwarn << "Point cloud without float x, y and z fields or with "
+              << "missing data, it isn't downsampled.\n";
+      this->dataPtr->warned = true;
+    }
+    _out.set_width(width);
+    _out.set_height(height);
+    _out.set_row_step(_in.row_step());
+    _out.set_is_dense(_in.is_dense());
+    out->assign(in);
+    return false;
+  }
+
+  const uint32_t stride = this->dataPtr->stride;
+  const uint32_t outWidth = (width + stride - 1u) / stride;
+  const uint32_t outHeight = (height + stride - 1u) / stride;
+
+  if (!voxelize)
+  {
+    out->resize(static_cast<std::size_t>(outWidth) * outHeight * step);
+    char *dst = &(*out)[0];
+    for (uint32_t j = 0u; j < height; j += stride)
+    {
+      const char *src = in.data() + j * rowStep;
+      for (uint32_t i = 0u; i < width; i += stride, dst += step)
+        std::memcpy(dst, src + i * step, step);
+    }
+    _out.set_width(outWidth);
+    _out.set_height(outHeight);
+    _out.set_row_step(static_cast<uint32_t>(outWidth * step));
+    _out.set_is_dense(_in.is_dense());
+    return true;
+  }
+
+  // Accumulate the finite points in the voxels of an open addressing hash
+  // table, sized for one voxel per point at most
+  const std::size_t points = static_cast<std::size_t>(outWidth) * outHeight;
+  std::size_t capacity = 16u;
+  while (capacity < points * 2u)
+    capacity *= 2u;
+  const std::size_t mask = capacity - 1u;
+  auto &slots = this->dataPtr->slots;
+  auto &keys = this->dataPtr->keys;
+  auto &voxels = this->dataPtr->voxels;
+  slots.assign(capacity, kNoVoxel);
+  keys.resize(capacity);
+  voxels.clear();
+
+  const double inverseLeaf = 1.0 / this->dataPtr->leafSize;
+  const uint32_t *offsets = this->dataPtr->xyz;
+  for (uint32_t j = 0u; j < height; j += stride)
+  {
+    for (uint32_t i = 0u; i < width; i += stride)
+    {
+      const std::size_t first = j * rowStep + i * step;
+      const char *point = in.data() + first;
+      float p[3];
+      std::memcpy(&p[0], point + offsets[0], sizeof(float));
+      std::memcpy(&p[1], point + offsets[1], sizeof(float));
+      std::memcpy(&p[2], point + offsets[2], sizeof(float));
+      if (!std::isfinite(p[0]) || !std::isfinite(p[1]) ||
+          !std::isfinite(p[2]))
+      {
+        continue;
+      }
+
+      const uint64_t key = VoxelIndex(p[0], inverseLeaf) << 42 |
+          VoxelIndex(p[1], inverseLeaf) << 21 | VoxelIndex(p[2], inverseLeaf);
+      std::size_t slot = (key * 0x9E3779B97F4A7C15ull) >> 20 & mask;
+      while (slots[slot] != kNoVoxel && keys[slot] != key)
+        slot = (slot + 1u) & mask;
+
+      if (slots[slot] == kNoVoxel)
+      {
+        slots[slot] = static_cast<uint32_t>(voxels.size());
+        keys[slot] = key;
+        voxels.push_back({p[0], p[1], p[2], 1u, first});
+      }
+      else
+      {
+        Voxel &voxel = voxels[slots[slot]];
+        voxel.x += p[0];
+        voxel.y += p[1];
+        voxel.z += p[2];
+        ++voxel.count;
+      }
+    }
+  }
+
+  // One point per voxel, with the fields of its first point
+  out->resize(voxels.size() * step);
+  char *dst = &(*out)[0];
+  for (const Voxel &voxel : voxels)
+  {
+    std::memcpy(dst, in.data() + voxel.first, step);
+    const float centroid[3] = {
+        static_cast<float>(voxel.x / voxel.count),
+        static_cast<float>(voxel.y / voxel.count),
+        static_cast<float>(voxel.z / voxel.count)};
+    std::memcpy(dst + offsets[0], &centroid[0], sizeof(float));
+    std::memcpy(dst + offsets[1], &centroid[1], sizeof(float));
+    std::memcpy(dst + offsets[2], &centroid[2], sizeof(float));
+    dst += step;
+  }
+  _out.set_width(static_cast<uint32_t>(voxels.size()));
+  _out.set_height(1u);
+  _out.set_row_step(static_cast<uint32_t>(voxels.size() * step));
+  _out.set_is_dense(true);
+  return true;
+}
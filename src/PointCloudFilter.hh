@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_POINTCLOUDFILTER_HH_
+#define IGNITION_SENSORS_POINTCLOUDFILTER_HH_
+
+#include <memory>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/pointcloud_packed.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/SuppressWarning.hh>
+#include <sdf/Element.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class PointCloudFilterPrivate;
+
+    /// \brief Downsamples the point clouds of sensors before they are
+    /// published, so that consumers that only need a fraction of the
+    /// points don't pay for serializing and sending all of them.
+    ///
+    /// Two stages are available, applied in this order:
+    /// - Stride decimation keeps every n-th point of every n-th row, and
+    ///   keeps the cloud organized.
+    /// - A voxel grid replaces the finite points of each cubic voxel by a
+    ///   single point at their centroid, with the other fields of the
+    ///   first point in the voxel. The result is unorganized, with a
+    ///   height of 1, and dense, since points that aren't finite are
+    ///   dropped.
+    ///
+    /// Points need float x, y and z fields. Other fields are copied as
+    /// they are, so any layout is supported.
+    class IGNITION_SENSORS_VISIBLE PointCloudFilter
+    {
+      /// \brief Constructor
+      public: PointCloudFilter();
+
+      /// \brief Destructor
+      public: ~PointCloudFilter();
+
+      /// \brief Read the filter settings from the
+      /// <ignition:point_cloud_stride> and <ignition:voxel_leaf_size>
+      /// elements of a sensor, if present.
+      /// \param[in] _sdf Sensor element, may be null.
+      public: void Load(const sdf::ElementPtr &_sdf);
+
+      /// \brief Set the stride of the decimation.
+      /// \param[in] _stride Keep one point out of _stride in each row and
+      /// one row out of _stride. 0 and 1 disable the decimation.
+      public: void SetStride(const unsigned int _stride);
+
+      /// \brief Get the stride of the decimation.
+      /// \return Stride, 1 if decimation is disabled.
+      public: unsigned int Stride() const;
+
+      /// \brief Set the edge length of the voxels.
+      /// \param[in] _leafSize Edge length in meters, 0 to disable the voxel
+      /// grid. Negative and non finite values also disable it.
+      public: void SetLeafSize(const double _leafSize);
+
+      /// \brief Get the edge length of the voxels.
+      /// \return Edge length in meters, 0 if the voxel grid is disabled.
+      public: double LeafSize() const;
+
+      /// \brief Check whether any stage is enabled.
+      /// \return True if Apply() changes point clouds.
+      public: bool Enabled() const;
+
+      /// \brief Downsample a point cloud.
+      /// \param[in] _in Filled point cloud.
+      /// \param[out] _out Downsampled point cloud, with the header, fields
+      /// and point step of _in. Its data buffer is reused between calls.
+      /// \return False if _in is missing data, or float x, y and z fields
+      /// while the voxel grid is enabled, in which case _out holds all the
+      /// points of _in.
+      public: bool Apply(const msgs::PointCloudPacked &_in,
+                  msgs::PointCloudPacked &_out);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<PointCloudFilterPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
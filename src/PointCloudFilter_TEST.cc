@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <ignition/msgs/Utility.hh>
+
+#include "PointCloudFilter.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Create a point cloud message with the layout of the sensors,
+/// where the point at column i and row j is at (i, j, _z) with an
+/// intensity of j * _width + i.
+msgs::PointCloudPacked PointCloudMsg(const unsigned int _width,
+    const unsigned int _height, const float _z = 1.0f)
+{
+  msgs::PointCloudPacked msg;
+  msgs::InitPointCloudPacked(msg, "test", true,
+      {{"xyz", msgs::PointCloudPacked::Field::FLOAT32},
+       {"intensity", msgs::PointCloudPacked::Field::FLOAT32}});
+  msg.set_width(_width);
+  msg.set_height(_height);
+  msg.set_row_step(msg.point_step() * _width);
+  msg.mutable_data()->resize(msg.row_step() * _height);
+  for (unsigned int j = 0u; j < _height; ++j)
+  {
+    for (unsigned int i = 0u; i < _width; ++i)
+    {
+      char *point = &(*msg.mutable_data())[
+          j * msg.row_step() + i * msg.point_step()];
+      const float values[4] = {static_cast<float>(i),
+          static_cast<float>(j), _z, static_cast<float>(j * _width + i)};
+      for (int f = 0; f < 4; ++f)
+      {
+        std::memcpy(point + msg.field(f).offset(), &values[f],
+            sizeof(float));
+      }
+    }
+  }
+  return msg;
+}
+
+/// \brief Read a float field of a point.
+float Value(const msgs::PointCloudPacked &_msg, const std::size_t _point,
+    const int _field)
+{
+  float value = 0.0f;
+  std::memcpy(&value, _msg.data().data() + _point * _msg.point_step() +
+      _msg.field(_field).offset(), sizeof(value));
+  return value;
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudFilter, Disabled)
+{
+  PointCloudFilter filter;
+  EXPECT_FALSE(filter.Enabled());
+  EXPECT_EQ(1u, filter.Stride());
+  EXPECT_DOUBLE_EQ(0.0, filter.LeafSize());
+
+  filter.SetStride(0u);
+  filter.SetLeafSize(-1.0);
+  EXPECT_FALSE(filter.Enabled());
+  filter.SetLeafSize(std::numeric_limits<double>::quiet_NaN());
+  EXPECT_DOUBLE_EQ(0.0, filter.LeafSize());
+  EXPECT_FALSE(filter.Enabled());
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudFilter, Stride)
+{
+  PointCloudFilter filter;
+  filter.SetStride(2u);
+  EXPECT_TRUE(filter.Enabled());
+
+  const msgs::PointCloudPacked in = PointCloudMsg(5u, 3u);
+  msgs::PointCloudPacked out;
+  ASSERT_TRUE(filter.Apply(in, out));
+
+  // Columns 0, 2 and 4 of rows 0 and 2
+  EXPECT_EQ(3u, out.width());
+  EXPECT_EQ(2u, out.height());
+  EXPECT_EQ(3u * in.point_step(), out.row_step());
+  EXPECT_EQ(in.point_step(), out.point_step());
+  EXPECT_EQ(in.field_size(), out.field_size());
+  ASSERT_EQ(6u * in.point_step(), out.data().size());
+  EXPECT_FLOAT_EQ(4.0f, Value(out, 2u, 0));
+  EXPECT_FLOAT_EQ(2.0f, Value(out, 4u, 1));
+  EXPECT_FLOAT_EQ(12.0f, Value(out, 4u, 3));
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudFilter, Voxel)
+{
+  PointCloudFilter filter;
+  filter.SetLeafSize(2.0);
+
+  msgs::PointCloudPacked in = PointCloudMsg(4u, 2u);
+
+  // The last point isn't finite and is dropped
+  const float inf = std::numeric_limits<float>::infinity();
+  std::memcpy(&(*in.mutable_data())[7u * in.point_step() +
+      in.field(0).offset()], &inf, sizeof(inf));
+
+  msgs::PointCloudPacked out;
+  ASSERT_TRUE(filter.Apply(in, out));
+
+  // Voxels of columns 0 to 1 and 2 to 3, in the order of their first point
+  EXPECT_EQ(2u, out.width());
+  EXPECT_EQ(1u, out.height());
+  EXPECT_TRUE(out.is_dense());
+  ASSERT_EQ(2u * in.point_step(), out.data().size());
+  EXPECT_FLOAT_EQ(0.5f, Value(out, 0u, 0));
+  EXPECT_FLOAT_EQ(0.5f, Value(out, 0u, 1));
+  EXPECT_FLOAT_EQ(1.0f, Value(out, 0u, 2));
+  EXPECT_FLOAT_EQ(0.0f, Value(out, 0u, 3));
+
+  // (2, 0), (3, 0) and (2, 1)
+  EXPECT_FLOAT_EQ(7.0f / 3.0f, Value(out, 1u, 0));
+  EXPECT_FLOAT_EQ(1.0f / 3.0f, Value(out, 1u, 1));
+  EXPECT_FLOAT_EQ(2.0f, Value(out, 1u, 3));
+
+  // With a stride of 2 only columns 0 and 2 of row 0 are left
+  filter.SetStride(2u);
+  ASSERT_TRUE(filter.Apply(in, out));
+  EXPECT_EQ(2u, out.width());
+  EXPECT_FLOAT_EQ(0.0f, Value(out, 0u, 0));
+  EXPECT_FLOAT_EQ(2.0f, Value(out, 1u, 0));
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudFilter, MissingFields)
+{
+  PointCloudFilter filter;
+  filter.SetLeafSize(1.0);
+
+  msgs::PointCloudPacked in;
+  msgs::InitPointCloudPacked(in, "test", true,
+      {{"intensity", msgs::PointCloudPacked::Field::FLOAT32}});
+  in.set_width(3u);
+  in.set_height(1u);
+  in.set_row_step(in.point_step() * 3u);
+  in.mutable_data()->resize(in.row_step());
+
+  msgs::PointCloudPacked out;
+  EXPECT_FALSE(filter.Apply(in, out));
+  EXPECT_EQ(3u, out.width());
+  EXPECT_EQ(in.data().size(), out.data().size());
+}
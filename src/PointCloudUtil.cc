@@ -17,11 +17,535 @@
 
 #include "PointCloudUtil.hh"
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#include <ignition/common/Console.hh>
+
+#include "WorkerPool.hh"
 
 using namespace ignition;
 using namespace sensors;
 
+/// \brief Private data for PointCloudUtil
+class ignition::sensors::PointCloudUtilPrivate
+{
+  /// \brief Run a function over bands of rows, in parallel for large
+  /// point clouds.
+  /// \param[in] _width Width of the point cloud.
+  /// \param[in] _height Height of the point cloud.
+  /// \param[in] _func Function called with the first row and number of
+  /// rows of each band.
+  public: void ForBands(const unsigned int _width,
+              const unsigned int _height,
+              const std::function<void(std::size_t, std::size_t)> &_func);
+
+  /// \brief Check whether a point cloud is split in bands filled in
+  /// parallel.
+  /// \param[in] _width Width of the point cloud.
+  /// \param[in] _height Height of the point cloud.
+  /// \return True if ForBands() runs more than one band.
+  public: bool Parallel(const unsigned int _width,
+              const unsigned int _height) const;
+
+  /// \brief Number of threads, including the calling thread
+  public: unsigned int threadCount = 1u;
+
+  /// \brief Index of the first point of each row in a compacted point
+  /// cloud, followed by the number of points left
+  public: std::vector<std::size_t> rowOffsets;
+
+  /// \brief Copy of a field from a filled point to an encoded point
+  public: struct FieldCopy
+  {
+    /// \brief Offset in the filled point
+    uint32_t from;
+
+    /// \brief Offset in the encoded point
+    uint32_t to;
+
+    /// \brief Size in the filled point
+    uint32_t size;
+
+    /// \brief True if the field is a coordinate encoded as an integer
+    bool quantize;
+  };
+
+  /// \brief Resolution of encoded coordinates, 0 for floats
+  public: double resolution = 0.0;
+
+  /// \brief The resolution, as written in the headers of encoded point
+  /// clouds
+  public: std::string resolutionText;
+
+  /// \brief True to deflate encoded point clouds
+  public: bool compress = false;
+
+  /// \brief Encoded points before compression
+  public: std::string encoded;
+
+  /// \brief Indices of the fields of the last encoded point cloud, in the
+  /// order of their offsets
+  public: std::vector<int> fieldOrder;
+
+  /// \brief Copies of the fields of the last encoded point cloud
+  public: std::vector<FieldCopy> fieldCopies;
+
+  /// \brief Tangents of the horizontal angles of the columns of the last
+  /// point cloud filled from depths, whose width was tangentWidth and
+  /// focal length tangentFocal
+  public: std::vector<float> yTangents;
+
+  /// \brief Width yTangents was computed for
+  public: uint32_t tangentWidth = 0u;
+
+  /// \brief Focal length yTangents was computed for
+  public: double tangentFocal = 0.0;
+
+  /// \brief Threads for large point clouds. Created on first use.
+  public: std::unique_ptr<WorkerPool> pool;
+
+  /// \brief Protects the creation of pool
+  public: std::mutex poolMutex;
+};
+
+namespace
+{
+  /// \brief Point clouds with fewer points are filled on the calling
+  /// thread
+  const std::size_t kParallelPoints = 512u * 512u;
+
+  /// \brief Number of positions computed at a time when filling points
+  /// from depths
+  const uint32_t kDepthChunk = 256u;
+
+  /// \brief Write the color of a point, as PointCloudLayout::WriteRgb()
+  /// does, with the endianness of the message known at compile time.
+  /// \tparam BigEndian True if the message is big endian
+  /// \param[out] _color First byte of the color field
+  /// \param[in] _rgb Red, green and blue
+  template<bool BigEndian>
+  void WriteRgb(char *_color, const unsigned char *_rgb)
+  {
+    _color[0] = static_cast<char>(_rgb[BigEndian ? 0 : 2]);
+    _color[1] = static_cast<char>(_rgb[1]);
+    _color[2] = static_cast<char>(_rgb[BigEndian ? 2 : 0]);
+  }
+
+  /// \brief Fill points from positions and RGB image data.
+  /// \tparam BigEndian True if the message is big endian
+  /// \tparam Stride Number of floats between the positions of two points
+  /// \param[in] _layout Layout of the message
+  /// \param[out] _points First point of the message
+  /// \param[in] _count Number of points
+  /// \param[in] _xyz Position of the first point
+  /// \param[in] _image RGB data
+  template<bool BigEndian, std::size_t Stride>
+  void FillPoints(const PointCloudLayout &_layout, char *_points,
+      const std::size_t _count, const float *_xyz,
+      const unsigned char *_image)
+  {
+    char *point = _points;
+    for (std::size_t i = 0u; i < _count; ++i, point += _layout.step)
+    {
+      _layout.WriteXyz(point, _xyz + i * Stride);
+      WriteRgb<BigEndian>(point + _layout.rgb, _image + i * 3u);
+    }
+  }
+
+  /// \brief Fill points from positions and RGB image data, choosing the
+  /// kernel for the endianness of the message once.
+  /// \tparam Stride Number of floats between the positions of two points
+  /// \param[in] _layout Layout of the message
+  /// \param[out] _points First point of the message
+  /// \param[in] _count Number of points
+  /// \param[in] _xyz Position of the first point
+  /// \param[in] _image RGB data
+  template<std::size_t Stride>
+  void FillPoints(const PointCloudLayout &_layout, char *_points,
+      const std::size_t _count, const float *_xyz,
+      const unsigned char *_image)
+  {
+    if (_layout.bigEndian)
+      FillPoints<true, Stride>(_layout, _points, _count, _xyz, _image);
+    else
+      FillPoints<false, Stride>(_layout, _points, _count, _xyz, _image);
+  }
+
+  /// \brief Fill points from point cloud data, whose colors are packed
+  /// in the fourth float of each point.
+  /// \tparam BigEndian True if the message is big endian
+  /// \param[in] _layout Layout of the message
+  /// \param[out] _points First point of the message
+  /// \param[in] _count Number of points
+  /// \param[in] _pointCloud Point cloud XYZ RGBA data
+  /// \param[out] _image Buffer the RGB data is written to, or null
+  template<bool BigEndian>
+  void FillPointsFromPacked(const PointCloudLayout &_layout, char *_points,
+      const std::size_t _count, const float *_pointCloud,
+      unsigned char *_image)
+  {
+    char *point = _points;
+    unsigned char scratch[3];
+    for (std::size_t i = 0u; i < _count; ++i, point += _layout.step)
+    {
+      const float *src = _pointCloud + i * 4u;
+      _layout.WriteXyz(point, src);
+
+      // Colors are decoded straight into the image buffer when there is one
+      unsigned char *color = _image ? _image + i * 3u : scratch;
+      PointCloudLayout::DecodeRgb(src[3], color);
+      WriteRgb<BigEndian>(point + _layout.rgb, color);
+    }
+  }
+
+  /// \brief Check whether the position of a point is finite.
+  /// \param[in] _layout Layout of the message
+  /// \param[in] _point First byte of the point
+  /// \return True if x, y and z are finite
+  bool IsFinite(const PointCloudLayout &_layout, const char *_point)
+  {
+    float xyz[3];
+    std::memcpy(&xyz[0], _point + _layout.x, sizeof(float));
+    std::memcpy(&xyz[1], _point + _layout.y, sizeof(float));
+    std::memcpy(&xyz[2], _point + _layout.z, sizeof(float));
+    return std::isfinite(xyz[0]) && std::isfinite(xyz[1]) &&
+        std::isfinite(xyz[2]);
+  }
+
+  /// \brief Get the size of a field.
+  /// \param[in] _field Field
+  /// \return Size in bytes
+  uint32_t FieldSize(const msgs::PointCloudPacked::Field &_field)
+  {
+    uint32_t size = 4u;
+    switch (_field.datatype())
+    {
+      case msgs::PointCloudPacked::Field::INT8:
+      case msgs::PointCloudPacked::Field::UINT8:
+        size = 1u;
+        break;
+      case msgs::PointCloudPacked::Field::INT16:
+      case msgs::PointCloudPacked::Field::UINT16:
+        size = 2u;
+        break;
+      case msgs::PointCloudPacked::Field::FLOAT64:
+        size = 8u;
+        break;
+      default:
+        break;
+    }
+    return size * std::max(1u, _field.count());
+  }
+
+  /// \brief Encode a coordinate as a 16 bit integer.
+  /// \param[in] _value Coordinate
+  /// \param[in] _inverse Units per meter
+  /// \return Coordinate in units, clamped, or -32768 if it isn't finite
+  int16_t Quantize(const float _value, const double _inverse)
+  {
+    if (!std::isfinite(_value))
+      return INT16_MIN;
+    const double units = std::round(_value * _inverse);
+    return static_cast<int16_t>(std::min(32767.0, std::max(-32767.0, units)));
+  }
+
+  /// \brief Copy the positions of point cloud data.
+  /// \param[in] _pointCloud Point cloud XYZ RGBA data
+  /// \param[in] _count Number of points
+  /// \param[out] _xyz XYZ data
+  void XyzFromPacked(const float *_pointCloud, const std::size_t _count,
+      float *_xyz)
+  {
+    for (std::size_t i = 0u; i < _count; ++i)
+      std::memcpy(_xyz + i * 3u, _pointCloud + i * 4u, 3u * sizeof(float));
+  }
+
+  /// \brief Decode the colors of point cloud data.
+  /// \param[in] _pointCloud Point cloud XYZ RGBA data
+  /// \param[in] _count Number of points
+  /// \param[out] _rgb RGB data
+  void RgbFromPacked(const float *_pointCloud, const std::size_t _count,
+      unsigned char *_rgb)
+  {
+    for (std::size_t i = 0u; i < _count; ++i)
+      PointCloudLayout::DecodeRgb(_pointCloud[i * 4u + 3u], _rgb + i * 3u);
+  }
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtilPrivate::ForBands(const unsigned int _width,
+    const unsigned int _height,
+    const std::function<void(std::size_t, std::size_t)> &_func)
+{
+  std::size_t bands = 1u;
+  if (this->Parallel(_width, _height))
+    bands = std::min<std::size_t>(this->threadCount, _height);
+
+  if (bands <= 1u)
+  {
+    _func(0u, _height);
+    return;
+  }
+
+  WorkerPool *workers = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(this->poolMutex);
+    if (!this->pool || this->pool->ThreadCount() != this->threadCount)
+      this->pool.reset(new WorkerPool(this->threadCount));
+    workers = this->pool.get();
+  }
+
+  const std::size_t bandRows = (_height + bands - 1u) / bands;
+  bands = (_height + bandRows - 1u) / bandRows;
+  workers->ParallelFor(bands, [&](std::size_t _band)
+      {
+        const std::size_t firstRow = _band * bandRows;
+        _func(firstRow, std::min<std::size_t>(bandRows, _height - firstRow));
+      });
+}
+
+//////////////////////////////////////////////////
+bool PointCloudUtilPrivate::Parallel(const unsigned int _width,
+    const unsigned int _height) const
+{
+  const std::size_t points = static_cast<std::size_t>(_width) * _height;
+  return this->threadCount > 1u && _height > 1u && points >= kParallelPoints;
+}
+
+//////////////////////////////////////////////////
+PointCloudUtil::PointCloudUtil()
+  : dataPtr(new PointCloudUtilPrivate)
+{
+  // Up to 4 threads by default, one per core oversubscribes the sensors
+  // updated in parallel
+  this->SetThreadCount(
+      std::min(4u, std::max(1u, std::thread::hardware_concurrency())));
+}
+
+//////////////////////////////////////////////////
+PointCloudUtil::~PointCloudUtil()
+{
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtil::SetThreadCount(const unsigned int _count)
+{
+  this->dataPtr->threadCount = _count > 0u ? _count :
+      std::max(1u, std::thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////
+unsigned int PointCloudUtil::ThreadCount() const
+{
+  return this->dataPtr->threadCount;
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtil::Load(const sdf::ElementPtr &_sdf)
+{
+  if (!_sdf)
+    return;
+
+  if (_sdf->HasElement("ignition:point_cloud_resolution"))
+  {
+    const double resolution =
+        _sdf->Get<double>("ignition:point_cloud_resolution");
+    if (!std::isfinite(resolution) || resolution < 0.0)
+    {
+      ignwarn << "Invalid <ignition:point_cloud_resolution> [" << resolution
+              << "], point cloud coordinates are published as floats.\n";
+    }
+    this->SetResolution(resolution);
+  }
+
+  if (_sdf->HasElement("ignition:point_cloud_compression"))
+    this->SetCompression(_sdf->Get<bool>("ignition:point_cloud_compression"));
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtil::SetResolution(const double _resolution)
+{
+  this->dataPtr->resolution =
+      std::isfinite(_resolution) && _resolution > 0.0 ? _resolution : 0.0;
+
+  std::ostringstream text;
+  text << this->dataPtr->resolution;
+  this->dataPtr->resolutionText = text.str();
+}
+
+//////////////////////////////////////////////////
+double PointCloudUtil::Resolution() const
+{
+  return this->dataPtr->resolution;
+}
+
+//////////////////////////////////////////////////
+bool PointCloudUtil::SetCompression(const bool _compress)
+{
+#ifdef WITH_ZLIB
+  this->dataPtr->compress = _compress;
+  return true;
+#else
+  this->dataPtr->compress = false;
+  if (_compress)
+  {
+    ignerr << "Point cloud compression requires zlib, which isn't "
+           << "available in this build.\n";
+  }
+  return !_compress;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool PointCloudUtil::Compression() const
+{
+  return this->dataPtr->compress;
+}
+
+//////////////////////////////////////////////////
+bool PointCloudUtil::Encoded() const
+{
+  return this->dataPtr->resolution > 0.0 || this->dataPtr->compress;
+}
+
+//////////////////////////////////////////////////
+bool PointCloudUtil::EncodeMsg(const msgs::PointCloudPacked &_in,
+    msgs::PointCloudPacked &_out) const
+{
+  const uint32_t width = _in.width();
+  const uint32_t height = _in.height();
+  const std::size_t rowStep = _in.row_step();
+  const std::string &in = _in.data();
+  if (_in.point_step() == 0u || (height > 0u && in.size() <
+      (height - 1u) * rowStep + static_cast<std::size_t>(width) *
+      _in.point_step()))
+  {
+    return false;
+  }
+
+  // Lay the encoded fields out back to back, in the order of their offsets
+  const bool quantize = this->dataPtr->resolution > 0.0;
+  std::vector<int> &order = this->dataPtr->fieldOrder;
+  order.resize(_in.field_size());
+  for (int i = 0; i < _in.field_size(); ++i)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int _a, int _b)
+      {
+        return _in.field(_a).offset() < _in.field(_b).offset();
+      });
+
+  std::vector<PointCloudUtilPrivate::FieldCopy> &copies =
+      this->dataPtr->fieldCopies;
+  copies.clear();
+  _out.clear_field();
+  uint32_t step = 0u;
+  for (const int index : order)
+  {
+    const auto &field = _in.field(index);
+    const bool coordinate = quantize &&
+        field.datatype() == msgs::PointCloudPacked::Field::FLOAT32 &&
+        field.count() <= 1u &&
+        (field.name() == "x" || field.name() == "y" || field.name() == "z");
+    const PointCloudUtilPrivate::FieldCopy copy{field.offset(), step,
+        FieldSize(field), coordinate};
+    if (copy.from + copy.size > _in.point_step())
+      continue;
+    copies.push_back(copy);
+
+    auto *out = _out.add_field();
+    out->CopyFrom(field);
+    out->set_offset(step);
+    if (coordinate)
+      out->set_datatype(msgs::PointCloudPacked::Field::INT16);
+    step += coordinate ? 2u : copy.size;
+  }
+
+  // Encode straight into the message unless it's compressed afterwards
+  std::string *encoded =
+      this->dataPtr->compress ? &this->dataPtr->encoded : _out.mutable_data();
+  encoded->resize(static_cast<std::size_t>(width) * height * step);
+  char *points = &(*encoded)[0];
+  const double inverse = quantize ? 1.0 / this->dataPtr->resolution : 0.0;
+  const std::size_t inStep = _in.point_step();
+  this->dataPtr->ForBands(width, height,
+      [&](std::size_t _firstRow, std::size_t _rows)
+      {
+        char *dst = points + _firstRow * width * step;
+        for (std::size_t j = _firstRow; j < _firstRow + _rows; ++j)
+        {
+          const char *src = in.data() + j * rowStep;
+          for (uint32_t i = 0u; i < width; ++i, src += inStep, dst += step)
+          {
+            for (const auto &copy : copies)
+            {
+              if (copy.quantize)
+              {
+                float value;
+                std::memcpy(&value, src + copy.from, sizeof(value));
+                const int16_t units = Quantize(value, inverse);
+                std::memcpy(dst + copy.to, &units, sizeof(units));
+              }
+              else
+              {
+                std::memcpy(dst + copy.to, src + copy.from, copy.size);
+              }
+            }
+          }
+        }
+      });
+
+  _out.mutable_header()->CopyFrom(_in.header());
+  _out.set_width(width);
+  _out.set_height(height);
+  _out.set_point_step(step);
+  _out.set_row_step(width * step);
+  _out.set_is_bigendian(_in.is_bigendian());
+  _out.set_is_dense(_in.is_dense());
+
+  if (quantize)
+  {
+    auto entry = _out.mutable_header()->add_data();
+    entry->set_key("xyz_resolution");
+    entry->add_value(this->dataPtr->resolutionText);
+  }
+
+#ifdef WITH_ZLIB
+  if (this->dataPtr->compress)
+  {
+    std::string *data = _out.mutable_data();
+    uLongf size = compressBound(encoded->size());
+    data->resize(size);
+    if (compress2(reinterpret_cast<Bytef *>(&(*data)[0]), &size,
+          reinterpret_cast<const Bytef *>(encoded->data()), encoded->size(),
+          Z_BEST_SPEED) == Z_OK)
+    {
+      data->resize(size);
+      auto entry = _out.mutable_header()->add_data();
+      entry->set_key("compression");
+      entry->add_value("zlib");
+    }
+    else
+    {
+      data->assign(*encoded);
+    }
+  }
+#endif
+  return true;
+}
+
 //////////////////////////////////////////////////
 void PointCloudUtil::FillMsg(msgs::PointCloudPacked &_msg,
     const math::Angle &_hfov, const unsigned char *_imageData,
@@ -30,118 +554,96 @@ void PointCloudUtil::FillMsg(msgs::PointCloudPacked &_msg,
   // Fill message. Logic borrowed from
   // https://github.com/ros-simulation/gazebo_ros_pkgs/blob/kinetic-devel/gazebo_plugins/src/gazebo_ros_depth_camera.cpp
 
+  PointCloudLayout layout;
+  if (!layout.Load(_msg))
+    return;
+
   uint32_t width = _msg.width();
   uint32_t height = _msg.height();
 
-  std::string *msgBuffer = _msg.mutable_data();
-  msgBuffer->resize(_msg.row_step() * _msg.height());
-  char *msgBufferIndex = msgBuffer->data();
+  std::string *msgData = _msg.mutable_data();
+  msgData->resize(_msg.row_step() * _msg.height());
+  char *msgBuffer = &(*msgData)[0];
 
   // For depth calculation from image
   double fl = width / (2.0 * std::tan(_hfov.Radian() / 2.0));
 
-  // Iterate over scan and populate point cloud
-  for (uint32_t j = 0; j < height; ++j)
+  // The angles only depend on the column and the row, so their tangents
+  // are computed once per column and once per row. The column tangents are
+  // kept until the width or field of view changes.
+  std::vector<float> &yTangents = this->dataPtr->yTangents;
+  if (this->dataPtr->tangentWidth != width ||
+      this->dataPtr->tangentFocal != fl || yTangents.size() != width)
   {
-    float pAngle = 0.0;
-    if (fl > 0 && height > 1)
-      pAngle = std::atan2((height-j-1) - 0.5 * (height - 1), fl);
-
+    yTangents.resize(width);
     for (uint32_t i = 0; i < width; ++i)
     {
-      int fieldIndex = 0;
-
-      // Current point depth
-      float depth = _depthData[j * width + i];
-
       float yAngle = 0.0;
       if (fl > 0 && width > 1)
         yAngle = std::atan2(0.5 * (width - 1) - i, fl);
-
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = depth;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) =
-        depth * std::tan(yAngle);
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) =
-        depth * std::tan(pAngle);
-
-      int imgIndex = i * 3 + j * width * 3;
-      int fieldOffset = _msg.field(fieldIndex).offset();
-      // Put image color data for each point, check endianess first.
-      if (_msg.is_bigendian())
-      {
-        *(msgBufferIndex + fieldOffset + 0) = _imageData[imgIndex + 0];
-        *(msgBufferIndex + fieldOffset + 1) = _imageData[imgIndex + 1];
-        *(msgBufferIndex + fieldOffset + 2) = _imageData[imgIndex + 2];
-      }
-      else
-      {
-        *(msgBufferIndex + fieldOffset + 0) = _imageData[imgIndex + 2];
-        *(msgBufferIndex + fieldOffset + 1) = _imageData[imgIndex + 1];
-        *(msgBufferIndex + fieldOffset + 2) = _imageData[imgIndex + 0];
-      }
-
-      // Add any padding
-      msgBufferIndex += _msg.point_step();
+      yTangents[i] = std::tan(yAngle);
     }
+    this->dataPtr->tangentWidth = width;
+    this->dataPtr->tangentFocal = fl;
   }
+
+  // Points are filled from the positions of chunks of each row, computed
+  // on the stack
+  this->dataPtr->ForBands(width, height,
+      [&](std::size_t _firstRow, std::size_t _rows)
+      {
+        float xyz[kDepthChunk * 3u];
+        const uint32_t lastRow = static_cast<uint32_t>(_firstRow + _rows);
+        for (uint32_t j = static_cast<uint32_t>(_firstRow); j < lastRow; ++j)
+        {
+          float pAngle = 0.0;
+          if (fl > 0 && height > 1)
+            pAngle = std::atan2((height-j-1) - 0.5 * (height - 1), fl);
+          const float pTangent = std::tan(pAngle);
+
+          const std::size_t rowFirst = static_cast<std::size_t>(j) * width;
+          for (uint32_t start = 0; start < width; start += kDepthChunk)
+          {
+            const uint32_t end = std::min<uint32_t>(width,
+                start + kDepthChunk);
+            for (uint32_t i = start; i < end; ++i)
+            {
+              // Current point depth
+              float depth = _depthData[rowFirst + i];
+              float *point = xyz + (i - start) * 3u;
+              point[0] = depth;
+              point[1] = depth * yTangents[i];
+              point[2] = depth * pTangent;
+            }
+
+            const std::size_t first = rowFirst + start;
+            FillPoints<3u>(layout, msgBuffer + first * layout.step,
+                end - start, xyz, _imageData + first * 3u);
+          }
+        }
+      });
 }
 
 //////////////////////////////////////////////////
 void PointCloudUtil::FillMsg(msgs::PointCloudPacked &_msg,
     const float *_xyzData, const unsigned char *_imageData) const
 {
-  uint32_t width = _msg.width();
-  uint32_t height = _msg.height();
+  PointCloudLayout layout;
+  if (!layout.Load(_msg))
+    return;
 
   std::string *msgBuffer = _msg.mutable_data();
   msgBuffer->resize(_msg.row_step() * _msg.height());
-  char *msgBufferIndex = msgBuffer->data();
 
-  // Iterate over scan and populate point cloud
-  for (uint32_t j = 0; j < height; ++j)
-  {
-    int step = j*width*3;
-    for (uint32_t i = 0; i < width; ++i)
-    {
-      int index = step + i*3;
-      float x = _xyzData[index];
-      float y = _xyzData[index + 1];
-      float z = _xyzData[index + 2];
-
-      int fieldIndex = 0;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = x;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = y;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = z;
-
-      uint8_t r = static_cast<uint8_t>(_imageData[index]);
-      uint8_t g = static_cast<uint8_t>(_imageData[index + 1]);
-      uint8_t b = static_cast<uint8_t>(_imageData[index + 2]);
-
-      int fieldOffset = _msg.field(fieldIndex).offset();
-      // Put image color data for each point, check endianess first.
-      if (_msg.is_bigendian())
+  char *points = &(*msgBuffer)[0];
+  this->dataPtr->ForBands(_msg.width(), _msg.height(),
+      [&](std::size_t _firstRow, std::size_t _rows)
       {
-        *(msgBufferIndex + fieldOffset + 0) = r;
-        *(msgBufferIndex + fieldOffset + 1) = g;
-        *(msgBufferIndex + fieldOffset + 2) = b;
-      }
-      else
-      {
-        *(msgBufferIndex + fieldOffset + 0) = b;
-        *(msgBufferIndex + fieldOffset + 1) = g;
-        *(msgBufferIndex + fieldOffset + 2) = r;
-      }
-
-      // Add any padding
-      msgBufferIndex += _msg.point_step();
-    }
-  }
+        const std::size_t first = _firstRow * _msg.width();
+        FillPoints<3u>(layout, points + first * layout.step,
+            _rows * _msg.width(), _xyzData + first * 3u,
+            _imageData + first * 3u);
+      });
 }
 
 //////////////////////////////////////////////////
@@ -150,76 +652,155 @@ void PointCloudUtil::FillMsg(msgs::PointCloudPacked &_msg,
     unsigned char *_imageData,
     float *_xyzData) const
 {
-  uint32_t width = _msg.width();
-  uint32_t height = _msg.height();
+  PointCloudLayout layout;
+  if (!layout.Load(_msg))
+    return;
 
   std::string *msgBuffer = _msg.mutable_data();
   msgBuffer->resize(_msg.row_step() * _msg.height());
-  char *msgBufferIndex = msgBuffer->data();
+  char *point = &(*msgBuffer)[0];
 
-  // Iterate over scan and populate point cloud
-  for (uint32_t j = 0; j < height; ++j)
-  {
-    int pcStep = j*width*4;
-    int imgStep = j*width*3;
-    for (uint32_t i = 0; i < width; ++i)
-    {
-      int pcIndex = pcStep + i*4;
-      float x = _pointCloudData[pcIndex];
-      float y = _pointCloudData[pcIndex + 1];
-      float z = _pointCloudData[pcIndex + 2];
-      float rgba = _pointCloudData[pcIndex + 3];
-
-      int fieldIndex = 0;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = x;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = y;
-      *reinterpret_cast<float*>(msgBufferIndex +
-          _msg.field(fieldIndex++).offset()) = z;
-
-      uint8_t r = 0u;
-      uint8_t g = 0u;
-      uint8_t b = 0u;
-      uint8_t a = 255u;
-      this->DecodeRGBAFromFloat(rgba, r, g, b, a);
-
-      int fieldOffset = _msg.field(fieldIndex).offset();
-      // Put image color data for each point, check endianess first.
-      if (_msg.is_bigendian())
+  unsigned char *image = _writeToBuffers ? _imageData : nullptr;
+  float *xyz = _writeToBuffers ? _xyzData : nullptr;
+  this->dataPtr->ForBands(_msg.width(), _msg.height(),
+      [&](std::size_t _firstRow, std::size_t _rows)
       {
-        *(msgBufferIndex + fieldOffset + 0) = r;
-        *(msgBufferIndex + fieldOffset + 1) = g;
-        *(msgBufferIndex + fieldOffset + 2) = b;
-      }
-      else
-      {
-        *(msgBufferIndex + fieldOffset + 0) = b;
-        *(msgBufferIndex + fieldOffset + 1) = g;
-        *(msgBufferIndex + fieldOffset + 2) = r;
-      }
+        const std::size_t first = _firstRow * _msg.width();
+        const std::size_t count = _rows * _msg.width();
+        const float *src = _pointCloudData + first * 4u;
+        char *dst = point + first * layout.step;
+        unsigned char *rgb = image ? image + first * 3u : nullptr;
+        if (layout.bigEndian)
+          FillPointsFromPacked<true>(layout, dst, count, src, rgb);
+        else
+          FillPointsFromPacked<false>(layout, dst, count, src, rgb);
+
+        // Fill buffers
+        if (xyz)
+          XyzFromPacked(src, count, xyz + first * 3u);
+      });
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtil::FillMsgFromPointCloud(msgs::PointCloudPacked &_msg,
+    const float *_pointCloudData, const unsigned char *_imageData) const
+{
+  PointCloudLayout layout;
+  if (!layout.Load(_msg))
+    return;
 
-      // Add any padding
-      msgBufferIndex += _msg.point_step();
+  std::string *msgBuffer = _msg.mutable_data();
+  msgBuffer->resize(_msg.row_step() * _msg.height());
 
-      // Fill buffers
-      int imgIndex = imgStep + i * 3;
-      if (_writeToBuffers && _xyzData)
+  char *points = &(*msgBuffer)[0];
+  this->dataPtr->ForBands(_msg.width(), _msg.height(),
+      [&](std::size_t _firstRow, std::size_t _rows)
       {
-        _xyzData[imgIndex + 0] = x;
-        _xyzData[imgIndex + 1] = y;
-        _xyzData[imgIndex + 2] = z;
-      }
-      if (_writeToBuffers && _imageData)
+        const std::size_t first = _firstRow * _msg.width();
+        FillPoints<4u>(layout, points + first * layout.step,
+            _rows * _msg.width(), _pointCloudData + first * 4u,
+            _imageData + first * 3u);
+      });
+}
+
+//////////////////////////////////////////////////
+void PointCloudUtil::CompactMsg(const msgs::PointCloudPacked &_in,
+    msgs::PointCloudPacked &_out) const
+{
+  PointCloudLayout layout;
+  if (!layout.Load(_in) || layout.step == 0u)
+    return;
+
+  const uint32_t width = _in.width();
+  const uint32_t height = _in.height();
+  const std::size_t rowStep = _in.row_step();
+  const std::size_t step = layout.step;
+  const std::string &in = _in.data();
+  if (height == 0u || in.size() < (height - 1u) * rowStep +
+      static_cast<std::size_t>(width) * step)
+  {
+    return;
+  }
+
+  _out.mutable_header()->CopyFrom(_in.header());
+  *_out.mutable_field() = _in.field();
+  _out.set_point_step(_in.point_step());
+  _out.set_is_bigendian(_in.is_bigendian());
+
+  std::string *out = _out.mutable_data();
+  std::size_t count = 0u;
+  if (!this->dataPtr->Parallel(width, height))
+  {
+    // Runs of finite points are appended as they are found, which only
+    // allocates when the cloud holds more points than ever before
+    out->clear();
+    for (uint32_t j = 0u; j < height; ++j)
+    {
+      const char *row = in.data() + j * rowStep;
+      uint32_t run = 0u;
+      for (uint32_t i = 0u; i <= width; ++i)
       {
-        _imageData[imgIndex + 0] = static_cast<unsigned char>(r);
-        _imageData[imgIndex + 1] = static_cast<unsigned char>(g);
-        _imageData[imgIndex + 2] = static_cast<unsigned char>(b);
+        if (i < width && IsFinite(layout, row + i * step))
+        {
+          ++run;
+          continue;
+        }
+        if (run > 0u)
+          out->append(row + (i - run) * step, run * step);
+        count += run;
+        run = 0u;
       }
     }
   }
-}
+  else
+  {
+    // Count the points left in each row, offset the rows by the sum of
+    // the counts of the rows above, then copy each band of rows to its
+    // offsets
+    std::vector<std::size_t> &offsets = this->dataPtr->rowOffsets;
+    offsets.assign(height + 1u, 0u);
+    this->dataPtr->ForBands(width, height,
+        [&](std::size_t _firstRow, std::size_t _rows)
+        {
+          for (std::size_t j = _firstRow; j < _firstRow + _rows; ++j)
+          {
+            const char *row = in.data() + j * rowStep;
+            std::size_t rowCount = 0u;
+            for (uint32_t i = 0u; i < width; ++i)
+              rowCount += IsFinite(layout, row + i * step) ? 1u : 0u;
+            offsets[j + 1u] = rowCount;
+          }
+        });
+    for (uint32_t j = 0u; j < height; ++j)
+      offsets[j + 1u] += offsets[j];
+    count = offsets[height];
+
+    out->resize(count * step);
+    char *points = &(*out)[0];
+    this->dataPtr->ForBands(width, height,
+        [&](std::size_t _firstRow, std::size_t _rows)
+        {
+          for (std::size_t j = _firstRow; j < _firstRow + _rows; ++j)
+          {
+            const char *row = in.data() + j * rowStep;
+            char *dst = points + offsets[j] * step;
+            for (uint32_t i = 0u; i < width; ++i)
+            {
+              const char *point = row + i * step;
+              if (!IsFinite(layout, point))
+                continue;
+              std::memcpy(dst, point, step);
+              dst += step;
+            }
+          }
+        });
+  }
 
+  _out.set_width(static_cast<uint32_t>(count));
+  _out.set_height(1u);
+  _out.set_row_step(static_cast<uint32_t>(count * step));
+  _out.set_is_dense(true);
+}
 
 //////////////////////////////////////////////////
 void PointCloudUtil::RGBFromPointCloud(unsigned char *_imageData,
@@ -227,25 +808,13 @@ void PointCloudUtil::RGBFromPointCloud(unsigned char *_imageData,
     const
 {
   // Iterate over scan and populate image data
-  for (uint32_t j = 0; j < _height; ++j)
-  {
-    int pcStep = j*_width*4;
-    int imgStep = j*_width*3;
-    for (uint32_t i = 0; i < _width; ++i)
-    {
-      int pcIndex = pcStep + i*4;
-      float rgba = _pointCloudData[pcIndex + 3];
-      uint8_t r = 0u;
-      uint8_t g = 0u;
-      uint8_t b = 0u;
-      uint8_t a = 255u;
-      this->DecodeRGBAFromFloat(rgba, r, g, b, a);
-      int imgIndex = imgStep + i * 3;
-      _imageData[imgIndex] = static_cast<unsigned char>(r);
-      _imageData[imgIndex + 1] = static_cast<unsigned char>(g);
-      _imageData[imgIndex + 2] = static_cast<unsigned char>(b);
-    }
-  }
+  this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t _firstRow, std::size_t _rows)
+      {
+        const std::size_t first = _firstRow * _width;
+        RgbFromPacked(_pointCloudData + first * 4u, _rows * _width,
+            _imageData + first * 3u);
+      });
 }
 
 //////////////////////////////////////////////////
@@ -254,19 +823,13 @@ void PointCloudUtil::XYZFromPointCloud(float *_xyzData,
     const
 {
   // Iterate over scan and populate image data
-  for (uint32_t j = 0; j < _height; ++j)
-  {
-    int pcStep = j*_width*4;
-    int imgStep = j*_width*3;
-    for (uint32_t i = 0; i < _width; ++i)
-    {
-      int pcIndex = pcStep + i*4;
-      int imgIndex = imgStep + i * 3;
-      _xyzData[imgIndex] = _pointCloudData[pcIndex];
-      _xyzData[imgIndex + 1] = _pointCloudData[pcIndex + 1];
-      _xyzData[imgIndex + 2] = _pointCloudData[pcIndex + 2];
-    }
-  }
+  this->dataPtr->ForBands(_width, _height,
+      [&](std::size_t _firstRow, std::size_t _rows)
+      {
+        const std::size_t first = _firstRow * _width;
+        XyzFromPacked(_pointCloudData + first * 4u, _rows * _width,
+            _xyzData + first * 3u);
+      });
 }
 
 //////////////////////////////////////////////////
@@ -18,6 +18,10 @@
 #ifndef IGNITION_SENSORS_POINTCLOUDUTIL_HH_
 #define IGNITION_SENSORS_POINTCLOUDUTIL_HH_
 
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
@@ -27,7 +31,9 @@
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
+#include <ignition/common/SuppressWarning.hh>
 #include <ignition/math/Angle.hh>
+#include <sdf/Element.hh>
 
 #include "ignition/sensors/config.hh"
 #include "ignition/sensors/Export.hh"
@@ -49,11 +55,176 @@ namespace ignition
     // Inline bracket to help doxygen filtering.
     inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
     //
+    /// \brief Byte offsets of the fields of the points of a
+    /// msgs::PointCloudPacked message whose first fields are x, y, z and
+    /// rgb, such as the messages of RgbdCameraSensor and DepthCameraSensor.
+    /// Reading them once per message instead of once per point keeps the
+    /// loops that fill messages tight.
+    class PointCloudLayout
+    {
+      /// \brief Read the layout of a message.
+      /// \param[in] _msg Initialized point cloud message.
+      /// \return False if the message has fewer than 4 fields.
+      public: bool Load(const msgs::PointCloudPacked &_msg)
+      {
+        if (_msg.field_size() < 4)
+          return false;
+        this->x = _msg.field(0).offset();
+        this->y = _msg.field(1).offset();
+        this->z = _msg.field(2).offset();
+        this->rgb = _msg.field(3).offset();
+        this->step = _msg.point_step();
+        this->bigEndian = _msg.is_bigendian();
+        this->packedXyz = this->y == this->x + 4u && this->z == this->x + 8u;
+        return true;
+      }
+
+      /// \brief Write the position of a point.
+      /// \param[out] _point First byte of the point.
+      /// \param[in] _xyz X, Y and Z.
+      public: void WriteXyz(char *_point, const float *_xyz) const
+      {
+        if (this->packedXyz)
+        {
+          std::memcpy(_point + this->x, _xyz, 3u * sizeof(float));
+        }
+        else
+        {
+          std::memcpy(_point + this->x, _xyz, sizeof(float));
+          std::memcpy(_point + this->y, _xyz + 1, sizeof(float));
+          std::memcpy(_point + this->z, _xyz + 2, sizeof(float));
+        }
+      }
+
+      /// \brief Write the color of a point.
+      /// \param[out] _point First byte of the point.
+      /// \param[in] _rgb Red, green and blue.
+      public: void WriteRgb(char *_point, const unsigned char *_rgb) const
+      {
+        char *color = _point + this->rgb;
+        if (this->bigEndian)
+        {
+          color[0] = static_cast<char>(_rgb[0]);
+          color[1] = static_cast<char>(_rgb[1]);
+          color[2] = static_cast<char>(_rgb[2]);
+        }
+        else
+        {
+          color[0] = static_cast<char>(_rgb[2]);
+          color[1] = static_cast<char>(_rgb[1]);
+          color[2] = static_cast<char>(_rgb[0]);
+        }
+      }
+
+      /// \brief Decode the red, green and blue values of a color packed in
+      /// a float by the rendering engine, as in
+      /// PointCloudUtil::DecodeRGBAFromFloat().
+      /// \param[in] _rgba Packed color.
+      /// \param[out] _rgb Red, green and blue.
+      public: static void DecodeRgb(const float _rgba, unsigned char *_rgb)
+      {
+        uint32_t bits = 0u;
+        std::memcpy(&bits, &_rgba, sizeof(bits));
+        _rgb[0] = static_cast<unsigned char>(bits >> 24 & 0xFF);
+        _rgb[1] = static_cast<unsigned char>(bits >> 16 & 0xFF);
+        _rgb[2] = static_cast<unsigned char>(bits >> 8 & 0xFF);
+      }
+
+      /// \brief Offset of x
+      public: uint32_t x = 0u;
+
+      /// \brief Offset of y
+      public: uint32_t y = 0u;
+
+      /// \brief Offset of z
+      public: uint32_t z = 0u;
+
+      /// \brief Offset of rgb
+      public: uint32_t rgb = 0u;
+
+      /// \brief Size of a point
+      public: uint32_t step = 0u;
+
+      /// \brief True if the data is big endian
+      public: bool bigEndian = false;
+
+      /// \brief True if x, y and z are consecutive
+      public: bool packedXyz = false;
+    };
+
+    /// \brief Forward declarations
+    class PointCloudUtilPrivate;
+
     /// \brief Helper class that fills a msgs::PointCloudPacked message using
     /// image and depth data. The RgbdCameraSensor and DepthCameraSensor
-    /// class use this.
+    /// class use this. Large point clouds are split in bands of rows filled
+    /// in parallel. An instance may be used by one thread at a time.
     class PointCloudUtil_EXPORTS_API PointCloudUtil
     {
+      /// \brief Constructor
+      public: PointCloudUtil();
+
+      /// \brief Destructor
+      public: ~PointCloudUtil();
+
+      /// \brief Set the number of threads used for large point clouds.
+      /// \param[in] _count Number of threads, including the calling
+      /// thread. 0 uses one thread per core, and 1 fills all point clouds
+      /// on the calling thread. The default is one per core, up to 4.
+      public: void SetThreadCount(const unsigned int _count);
+
+      /// \brief Get the number of threads used for large point clouds.
+      /// \return Number of threads, including the calling thread.
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Read the encoding of published point clouds from the
+      /// <ignition:point_cloud_resolution> and
+      /// <ignition:point_cloud_compression> elements of a sensor, if
+      /// present.
+      /// \param[in] _sdf Sensor element, may be null.
+      public: void Load(const sdf::ElementPtr &_sdf);
+
+      /// \brief Set the resolution of the coordinates encoded by
+      /// EncodeMsg(). With a positive resolution the FLOAT32 x, y and z
+      /// fields are encoded as INT16 fields in multiples of it, e.g. 0.001
+      /// for millimeters within 32.767 meters, and the header gets an
+      /// "xyz_resolution" entry. Coordinates beyond the range are clamped,
+      /// and coordinates that aren't finite are -32768.
+      /// \param[in] _resolution Meters per unit, or 0 to keep floats.
+      public: void SetResolution(const double _resolution);
+
+      /// \brief Get the resolution of the encoded coordinates.
+      /// \return Meters per unit, or 0 for floats.
+      public: double Resolution() const;
+
+      /// \brief Set whether EncodeMsg() deflates the data of point clouds
+      /// with zlib. Compressed messages have a "compression" header entry
+      /// set to "zlib", and their row step and height still describe the
+      /// inflated data.
+      /// \param[in] _compress True to compress.
+      /// \return False if compression was requested but zlib isn't
+      /// available in this build.
+      public: bool SetCompression(const bool _compress);
+
+      /// \brief Get whether encoded point clouds are compressed.
+      /// \return True if their data is deflated.
+      public: bool Compression() const;
+
+      /// \brief Check whether EncodeMsg() changes point clouds.
+      /// \return True if a resolution or compression is set.
+      public: bool Encoded() const;
+
+      /// \brief Encode a filled point cloud with the resolution and
+      /// compression set, into a message whose fields describe the
+      /// encoded points. Points are packed without padding.
+      /// \param[in] _in Filled point cloud.
+      /// \param[out] _out Encoded point cloud. Its buffers are reused
+      /// between calls.
+      /// \return False if _in is missing data, in which case _out isn't
+      /// changed.
+      public: bool EncodeMsg(const msgs::PointCloudPacked &_in,
+          msgs::PointCloudPacked &_out) const;
+
       /// \brief Fill a msgs::PointCloudPacked.
       /// \param[in,out] _msg Point cloud message to fill. This message
       /// should be initialized. See example usage in either
@@ -90,6 +261,33 @@ namespace ignition
           const float *_pointCloudData, bool _writeToBuffers = false,
           unsigned char *_imageData = 0, float *_xyzData = 0) const;
 
+      /// \brief Fill a msgs::PointCloudPacked with the positions of a
+      /// point cloud and the colors of a separate image, without extracting
+      /// the positions first.
+      /// \param[in,out] _msg Point cloud message to fill. This message
+      /// should be initialized. See example usage in DepthCameraSensor.
+      /// \param[in] _pointCloudData Point cloud XYZ RGBA data. The RGBA
+      /// values are ignored.
+      /// \param[in] _imageData RGB data.
+      public: void FillMsgFromPointCloud(msgs::PointCloudPacked &_msg,
+          const float *_pointCloudData,
+          const unsigned char *_imageData) const;
+
+      /// \brief Copy the points of a filled msgs::PointCloudPacked whose
+      /// position is finite, dropping the others, such as the points of
+      /// pixels beyond the clipping distances. Points keep their order.
+      /// The copy is unorganized and dense: its width is the number of
+      /// points left, its height 1 and is_dense is set. Large point clouds
+      /// are compacted in parallel, from a prefix sum of the number of
+      /// points left in each row.
+      /// \param[in] _in Point cloud message filled by one of the FillMsg
+      /// functions, or with the same layout. It keeps its size, so it can
+      /// be filled again without reallocating.
+      /// \param[out] _out Compacted point cloud. Its buffers are reused
+      /// between calls.
+      public: void CompactMsg(const msgs::PointCloudPacked &_in,
+          msgs::PointCloudPacked &_out) const;
+
       /// \brief Extract RGB data from point cloud data
       /// \param[out] _imageData RGB Image buffer to be filled.
       /// \param[in] _pointCloudData Point cloud XYZ data.
@@ -119,6 +317,11 @@ namespace ignition
       /// \param[out] _a Alpha [0-255]
       public: void DecodeRGBAFromFloat(float _rgba, uint8_t &_r, uint8_t &_g,
           uint8_t &_b, uint8_t &_a) const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<PointCloudUtilPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
     };
     }
   }
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include <ignition/msgs/Utility.hh>
+
+#include "PointCloudUtil.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Create a point cloud message with the layout of the sensors
+msgs::PointCloudPacked PointCloudMsg(const unsigned int _width,
+    const unsigned int _height)
+{
+  msgs::PointCloudPacked msg;
+  msgs::InitPointCloudPacked(msg, "test", true,
+      {{"xyz", msgs::PointCloudPacked::Field::FLOAT32},
+       {"rgb", msgs::PointCloudPacked::Field::FLOAT32}});
+  msg.set_width(_width);
+  msg.set_height(_height);
+  msg.set_row_step(msg.point_step() * _width);
+  return msg;
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudUtil, FillMsg)
+{
+  const unsigned int width = 3u;
+  const unsigned int height = 2u;
+  std::vector<float> cloud(width * height * 4u);
+  for (std::size_t i = 0u; i < width * height; ++i)
+  {
+    cloud[i * 4u] = static_cast<float>(i);
+    cloud[i * 4u + 1u] = -static_cast<float>(i);
+    cloud[i * 4u + 2u] = 0.5f;
+    // Red, green, blue and alpha from the highest byte
+    const uint32_t rgba = 0x10203040u + static_cast<uint32_t>(i);
+    std::memcpy(&cloud[i * 4u + 3u], &rgba, sizeof(rgba));
+  }
+
+  PointCloudUtil util;
+  msgs::PointCloudPacked msg = PointCloudMsg(width, height);
+  std::vector<unsigned char> rgb(width * height * 3u);
+  std::vector<float> xyz(width * height * 3u);
+  util.FillMsg(msg, cloud.data(), true, rgb.data(), xyz.data());
+
+  ASSERT_EQ(msg.row_step() * height, msg.data().size());
+  const char *point = msg.data().data() + 5u * msg.point_step();
+  float value = 0.0f;
+  std::memcpy(&value, point + msg.field(0).offset(), sizeof(value));
+  EXPECT_FLOAT_EQ(5.0f, value);
+  std::memcpy(&value, point + msg.field(1).offset(), sizeof(value));
+  EXPECT_FLOAT_EQ(-5.0f, value);
+
+  // Little endian messages hold blue first
+  const char *color = point + msg.field(3).offset();
+  EXPECT_EQ(0x30, color[0]);
+  EXPECT_EQ(0x20, color[1]);
+  EXPECT_EQ(0x10, color[2]);
+
+  EXPECT_EQ(0x10, rgb[15]);
+  EXPECT_EQ(0x20, rgb[16]);
+  EXPECT_EQ(0x30, rgb[17]);
+  EXPECT_FLOAT_EQ(-5.0f, xyz[16]);
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudUtil, Parallel)
+{
+  // Large point clouds are split in bands, which must not change the result
+  const unsigned int width = 640u;
+  const unsigned int height = 481u;
+  const std::size_t count = static_cast<std::size_t>(width) * height;
+  std::vector<float> depth(count);
+  std::vector<float> cloud(count * 4u);
+  std::vector<unsigned char> image(count * 3u);
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    depth[i] = 0.5f + static_cast<float>(i % 997u) * 0.01f;
+    cloud[i * 4u] = depth[i];
+    cloud[i * 4u + 1u] = static_cast<float>(i % 13u);
+    cloud[i * 4u + 2u] = -depth[i];
+    const uint32_t rgba = static_cast<uint32_t>(i * 2654435761u);
+    std::memcpy(&cloud[i * 4u + 3u], &rgba, sizeof(rgba));
+  }
+  for (std::size_t i = 0u; i < image.size(); ++i)
+    image[i] = static_cast<unsigned char>(i * 31u);
+
+  PointCloudUtil serial;
+  serial.SetThreadCount(1u);
+  EXPECT_EQ(1u, serial.ThreadCount());
+  PointCloudUtil parallel;
+  parallel.SetThreadCount(4u);
+  EXPECT_EQ(4u, parallel.ThreadCount());
+
+  msgs::PointCloudPacked serialMsg = PointCloudMsg(width, height);
+  msgs::PointCloudPacked parallelMsg = PointCloudMsg(width, height);
+
+  serial.FillMsg(serialMsg, math::Angle(1.05), image.data(), depth.data());
+  parallel.FillMsg(parallelMsg, math::Angle(1.05), image.data(),
+      depth.data());
+  EXPECT_EQ(serialMsg.data(), parallelMsg.data());
+
+  serial.FillMsgFromPointCloud(serialMsg, cloud.data(), image.data());
+  parallel.FillMsgFromPointCloud(parallelMsg, cloud.data(), image.data());
+  EXPECT_EQ(serialMsg.data(), parallelMsg.data());
+
+  std::vector<unsigned char> serialRgb(count * 3u);
+  std::vector<unsigned char> parallelRgb(count * 3u);
+  std::vector<float> serialXyz(count * 3u);
+  std::vector<float> parallelXyz(count * 3u);
+  serial.FillMsg(serialMsg, cloud.data(), true, serialRgb.data(),
+      serialXyz.data());
+  parallel.FillMsg(parallelMsg, cloud.data(), true, parallelRgb.data(),
+      parallelXyz.data());
+  EXPECT_EQ(serialMsg.data(), parallelMsg.data());
+  EXPECT_EQ(serialRgb, parallelRgb);
+  EXPECT_EQ(serialXyz, parallelXyz);
+
+  parallel.RGBFromPointCloud(parallelRgb.data(), cloud.data(), width,
+      height);
+  parallel.XYZFromPointCloud(parallelXyz.data(), cloud.data(), width,
+      height);
+  EXPECT_EQ(serialRgb, parallelRgb);
+  EXPECT_EQ(serialXyz, parallelXyz);
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudUtil, CompactMsg)
+{
+  // Every third point is beyond the far clip, every seventh one below the
+  // near clip
+  const unsigned int width = 640u;
+  const unsigned int height = 481u;
+  const std::size_t count = static_cast<std::size_t>(width) * height;
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<float> cloud(count * 4u);
+  std::vector<unsigned char> image(count * 3u, 0u);
+  std::size_t finite = 0u;
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    float depth = static_cast<float>(i);
+    if (i % 3u == 0u)
+      depth = inf;
+    else if (i % 7u == 0u)
+      depth = -inf;
+    else
+      ++finite;
+    cloud[i * 4u] = depth;
+    cloud[i * 4u + 1u] = depth;
+    cloud[i * 4u + 2u] = depth;
+  }
+
+  PointCloudUtil serial;
+  serial.SetThreadCount(1u);
+  PointCloudUtil parallel;
+  parallel.SetThreadCount(4u);
+
+  msgs::PointCloudPacked serialMsg = PointCloudMsg(width, height);
+  msgs::PointCloudPacked parallelMsg = PointCloudMsg(width, height);
+  serial.FillMsgFromPointCloud(serialMsg, cloud.data(), image.data());
+  parallel.FillMsgFromPointCloud(parallelMsg, cloud.data(), image.data());
+  msgs::PointCloudPacked serialDense;
+  msgs::PointCloudPacked parallelDense;
+  serial.CompactMsg(serialMsg, serialDense);
+  parallel.CompactMsg(parallelMsg, parallelDense);
+
+  // The filled messages keep their size
+  EXPECT_EQ(width, serialMsg.width());
+  EXPECT_EQ(height, serialMsg.height());
+
+  EXPECT_EQ(finite, serialDense.width());
+  EXPECT_EQ(1u, serialDense.height());
+  EXPECT_EQ(finite * serialDense.point_step(), serialDense.row_step());
+  EXPECT_EQ(serialDense.row_step(), serialDense.data().size());
+  EXPECT_EQ(serialMsg.field_size(), serialDense.field_size());
+  EXPECT_TRUE(serialDense.is_dense());
+  EXPECT_EQ(serialDense.width(), parallelDense.width());
+  EXPECT_EQ(serialDense.data(), parallelDense.data());
+
+  // Points keep their order
+  float value = 0.0f;
+  std::memcpy(&value, serialDense.data().data() +
+      serialDense.field(0).offset(), sizeof(value));
+  EXPECT_FLOAT_EQ(1.0f, value);
+  std::memcpy(&value, serialDense.data().data() + serialDense.point_step() +
+      serialDense.field(2).offset(), sizeof(value));
+  EXPECT_FLOAT_EQ(2.0f, value);
+}
+
+//////////////////////////////////////////////////
+TEST(PointCloudUtil, EncodeMsg)
+{
+  const unsigned int width = 64u;
+  const unsigned int height = 2u;
+  const std::size_t count = static_cast<std::size_t>(width) * height;
+  std::vector<float> cloud(count * 4u, 0.0f);
+  std::vector<unsigned char> image(count * 3u, 7u);
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    cloud[i * 4u] = 0.011f * static_cast<float>(i);
+    cloud[i * 4u + 1u] = -1.0f;
+    cloud[i * 4u + 2u] = 500.0f;
+  }
+  cloud[4u] = std::numeric_limits<float>::infinity();
+
+  PointCloudUtil util;
+  EXPECT_FALSE(util.Encoded());
+  msgs::PointCloudPacked msg = PointCloudMsg(width, height);
+  util.FillMsgFromPointCloud(msg, cloud.data(), image.data());
+
+  util.SetResolution(0.01);
+  EXPECT_DOUBLE_EQ(0.01, util.Resolution());
+  EXPECT_TRUE(util.Encoded());
+  msgs::PointCloudPacked encoded;
+  ASSERT_TRUE(util.EncodeMsg(msg, encoded));
+
+  // 16 bit coordinates followed by the color, without padding
+  ASSERT_EQ(4, encoded.field_size());
+  EXPECT_EQ(msgs::PointCloudPacked::Field::INT16,
+      encoded.field(0).datatype());
+  EXPECT_EQ("z", encoded.field(2).name());
+  EXPECT_EQ(4u, encoded.field(2).offset());
+  EXPECT_EQ("rgb", encoded.field(3).name());
+  EXPECT_EQ(msgs::PointCloudPacked::Field::FLOAT32,
+      encoded.field(3).datatype());
+  EXPECT_EQ(10u, encoded.point_step());
+  EXPECT_EQ(width * 10u, encoded.row_step());
+  ASSERT_EQ(count * 10u, encoded.data().size());
+
+  int16_t units[3];
+  std::memcpy(units, encoded.data().data() + 3u * 10u, sizeof(units));
+  EXPECT_EQ(3, units[0]);
+  EXPECT_EQ(-100, units[1]);
+  EXPECT_EQ(32767, units[2]);
+  std::memcpy(units, encoded.data().data() + 10u, sizeof(units));
+  EXPECT_EQ(INT16_MIN, units[0]);
+  EXPECT_EQ(0, std::memcmp(encoded.data().data() + 16u,
+      msg.data().data() + msg.point_step() + msg.field(3).offset(), 4u));
+
+  const auto &entry = encoded.header().data(encoded.header().data_size() - 1);
+  EXPECT_EQ("xyz_resolution", entry.key());
+  EXPECT_EQ("0.01", entry.value(0));
+
+  // Compression is only available with zlib
+  if (!util.SetCompression(true))
+  {
+    EXPECT_FALSE(util.Compression());
+    return;
+  }
+  EXPECT_TRUE(util.Compression());
+  ASSERT_TRUE(util.EncodeMsg(msg, encoded));
+  EXPECT_EQ(10u, encoded.point_step());
+  EXPECT_EQ(height, encoded.height());
+  EXPECT_LT(encoded.data().size(), count * 10u);
+  EXPECT_EQ("compression",
+      encoded.header().data(encoded.header().data_size() - 1).key());
+}
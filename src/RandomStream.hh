@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RANDOMSTREAM_HH_
+#define IGNITION_SENSORS_RANDOMSTREAM_HH_
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include <ignition/math/Helpers.hh>
+
+#include "ignition/sensors/config.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief A small, fast pseudo random number generator
+    /// (xoshiro256++). Every noise model owns one, so that noise can be
+    /// generated from several threads without sharing a generator, and so
+    /// that the sequence of a model doesn't depend on how other models are
+    /// scheduled. Not thread safe: a stream must be used by one thread at a
+    /// time.
+    class RandomStream
+    {
+      /// \brief Constructor.
+      /// \param[in] _seed Seed of the stream.
+      public: explicit RandomStream(std::uint64_t _seed = 0u)
+      {
+        this->Seed(_seed);
+      }
+
+      /// \brief Restart the stream from a seed. Streams seeded with the
+      /// same value produce the same sequence.
+      /// \param[in] _seed Seed of the stream.
+      public: void Seed(std::uint64_t _seed)
+      {
+        // Expand the seed with splitmix64, as recommended by the authors of
+        // xoshiro. This never yields an all zero state.
+        for (auto &s : this->state)
+          s = SplitMix64(_seed);
+        this->hasSpare = false;
+      }
+
+      /// \brief Get the next 64 random bits.
+      /// \return Uniformly distributed integer.
+      public: std::uint64_t Next()
+      {
+        const std::uint64_t result =
+          Rotl(this->state[0] + this->state[3], 23) + this->state[0];
+        const std::uint64_t t = this->state[1] << 17;
+        this->state[2] ^= this->state[0];
+        this->state[3] ^= this->state[1];
+        this->state[1] ^= this->state[2];
+        this->state[0] ^= this->state[3];
+        this->state[2] ^= t;
+        this->state[3] = Rotl(this->state[3], 45);
+        return result;
+      }
+
+      /// \brief Get a uniformly distributed value in [0, 1).
+      /// \return Random value.
+      public: double Uniform()
+      {
+        // The upper 53 bits fill the mantissa of a double exactly.
+        return static_cast<double>(this->Next() >> 11) * kTwoPowMinus53;
+      }
+
+      /// \brief Get a uniformly distributed value in (0, 1].
+      /// \return Random value, safe to take the logarithm of.
+      public: double UniformOpenZero()
+      {
+        return static_cast<double>((this->Next() >> 11) + 1u) *
+          kTwoPowMinus53;
+      }
+
+      /// \brief Get a normally distributed value. Samples are generated in
+      /// pairs with the Box-Muller transform.
+      /// \param[in] _mean Mean of the distribution.
+      /// \param[in] _stdDev Standard deviation of the distribution.
+      /// \return Random value.
+      public: double Normal(double _mean, double _stdDev)
+      {
+        if (this->hasSpare)
+        {
+          this->hasSpare = false;
+          return _mean + _stdDev * this->spare;
+        }
+
+        const double r = std::sqrt(-2.0 * std::log(this->UniformOpenZero()));
+        const double theta = 2.0 * IGN_PI * this->Uniform();
+        this->spare = r * std::sin(theta);
+        this->hasSpare = true;
+        return _mean + _stdDev * r * std::cos(theta);
+      }
+
+      /// \brief Combine a seed with a value to derive the seed of an
+      /// independent stream.
+      /// \param[in] _seed Seed to derive from.
+      /// \param[in] _value Value that identifies the new stream.
+      /// \return Derived seed.
+      public: static std::uint64_t Combine(std::uint64_t _seed,
+                  std::uint64_t _value)
+      {
+        std::uint64_t x = _seed ^ (_value + 0x9e3779b97f4a7c15ull +
+            (_seed << 6) + (_seed >> 2));
+        return SplitMix64(x);
+      }
+
+      /// \brief Combine a seed with a string to derive the seed of an
+      /// independent stream.
+      /// \param[in] _seed Seed to derive from.
+      /// \param[in] _value String that identifies the new stream.
+      /// \return Derived seed.
+      public: static std::uint64_t Combine(std::uint64_t _seed,
+                  const std::string &_value)
+      {
+        // 64 bit FNV-1a. std::hash isn't guaranteed to be the same across
+        // standard libraries, which would break reproducibility.
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (unsigned char c : _value)
+        {
+          hash ^= c;
+          hash *= 0x100000001b3ull;
+        }
+        return Combine(_seed, hash);
+      }
+
+      /// \brief One step of the splitmix64 generator.
+      /// \param[in,out] _x Generator state.
+      /// \return Next value.
+      private: static std::uint64_t SplitMix64(std::uint64_t &_x)
+      {
+        std::uint64_t z = (_x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+      }
+
+      /// \brief Rotate bits left.
+      /// \param[in] _x Value to rotate.
+      /// \param[in] _k Number of bits.
+      /// \return Rotated value.
+      private: static std::uint64_t Rotl(std::uint64_t _x, int _k)
+      {
+        return (_x << _k) | (_x >> (64 - _k));
+      }
+
+      /// \brief Scale from 53 random bits to [0, 1).
+      private: static constexpr double kTwoPowMinus53 =
+                   1.0 / 9007199254740992.0;
+
+      /// \brief Generator state.
+      private: std::uint64_t state[4];
+
+      /// \brief Second sample of the last Box-Muller pair.
+      private: double spare = 0.0;
+
+      /// \brief True if spare hasn't been returned yet.
+      private: bool hasSpare = false;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,772 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
+#include "RayCaster.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Number of rays traversed together
+  constexpr std::size_t kPacketSize = 8u;
+
+  /// \brief Largest number of primitives in a leaf of a hierarchy
+  constexpr uint32_t kMaxLeafSize = 4u;
+
+  /// \brief Number of bins nodes are split with
+  constexpr int kBinCount = 16;
+
+  /// \brief Depth from which nodes are split at their median, which bounds
+  /// the depth of the hierarchies
+  constexpr int kMedianSplitDepth = 40;
+
+  /// \brief Size of the traversal stacks, above the depth of any hierarchy
+  constexpr int kStackSize = 128;
+
+  /// \brief Infinity
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+
+  /// \brief Axis aligned bounding box
+  struct Box
+  {
+    /// \brief Minimum corner, +inf if the box is empty
+    float min[3] = {kInf, kInf, kInf};
+
+    /// \brief Maximum corner, -inf if the box is empty
+    float max[3] = {-kInf, -kInf, -kInf};
+
+    /// \brief Grow the box to hold a point.
+    /// \param[in] _point Point
+    void Grow(const float _point[3])
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        this->min[i] = std::min(this->min[i], _point[i]);
+        this->max[i] = std::max(this->max[i], _point[i]);
+      }
+    }
+
+    /// \brief Grow the box to hold another box.
+    /// \param[in] _box Box
+    void Grow(const Box &_box)
+    {
+      for (int i = 0; i < 3; ++i)
+      {
+        this->min[i] = std::min(this->min[i], _box.min[i]);
+        this->max[i] = std::max(this->max[i], _box.max[i]);
+      }
+    }
+
+    /// \brief Get half of the surface area of the box.
+    /// \return Half area, 0 if the box is empty
+    float HalfArea() const
+    {
+      if (this->max[0] < this->min[0])
+        return 0.0f;
+      const float x = this->max[0] - this->min[0];
+      const float y = this->max[1] - this->min[1];
+      const float z = this->max[2] - this->min[2];
+      return x * y + y * z + z * x;
+    }
+  };
+
+  /// \brief Node of a bounding volume hierarchy
+  struct BvhNode
+  {
+    /// \brief Bounds of the primitives of the node
+    Box box;
+
+    /// \brief First primitive of a leaf, or first of the two adjacent
+    /// children of an inner node
+    uint32_t first = 0u;
+
+    /// \brief Number of primitives of a leaf, 0 for inner nodes
+    uint32_t count = 0u;
+  };
+
+  /// \brief Triangle, with the edges used by the intersection test
+  struct Triangle
+  {
+    /// \brief First vertex
+    float v0[3];
+
+    /// \brief Second vertex minus the first
+    float e1[3];
+
+    /// \brief Third vertex minus the first
+    float e2[3];
+  };
+
+  /// \brief Rays sharing an origin, traversed together. Lanes without a
+  /// ray have a negative distance, which no box or triangle passes.
+  struct Packet
+  {
+    /// \brief Origin of the rays
+    float origin[3];
+
+    /// \brief Directions of the rays
+    float dx[kPacketSize];
+    float dy[kPacketSize];
+    float dz[kPacketSize];
+
+    /// \brief Inverse of the directions
+    float ix[kPacketSize];
+    float iy[kPacketSize];
+    float iz[kPacketSize];
+
+    /// \brief Distance to the nearest hit, or to the far limit
+    float t[kPacketSize];
+
+    /// \brief Retro reflectivity of the nearest hit
+    float retro[kPacketSize];
+
+    /// \brief Set the inverse directions from the directions.
+    void Invert()
+    {
+      // Zero components get a huge inverse instead of an infinite one, so
+      // the slab tests never multiply 0 by infinity
+      const float huge = 1e30f;
+      for (std::size_t k = 0u; k < kPacketSize; ++k)
+      {
+        this->ix[k] = this->dx[k] != 0.0f ? 1.0f / this->dx[k] :
+            std::copysign(huge, this->dx[k]);
+        this->iy[k] = this->dy[k] != 0.0f ? 1.0f / this->dy[k] :
+            std::copysign(huge, this->dy[k]);
+        this->iz[k] = this->dz[k] != 0.0f ? 1.0f / this->dz[k] :
+            std::copysign(huge, this->dz[k]);
+      }
+    }
+  };
+
+  /// \brief Intersect the rays of a packet with a box.
+  /// \param[in] _box Box
+  /// \param[in] _packet Rays
+  /// \param[in] _near Distance below which the box is ignored
+  /// \return Smallest entry distance of the rays that hit the box, or +inf
+  /// if none does
+  float Intersect(const Box &_box, const Packet &_packet, const float _near)
+  {
+    const float minX = _box.min[0] - _packet.origin[0];
+    const float minY = _box.min[1] - _packet.origin[1];
+    const float minZ = _box.min[2] - _packet.origin[2];
+    const float maxX = _box.max[0] - _packet.origin[0];
+    const float maxY = _box.max[1] - _packet.origin[1];
+    const float maxZ = _box.max[2] - _packet.origin[2];
+
+    float entries[kPacketSize];
+    for (std::size_t k = 0u; k < kPacketSize; ++k)
+    {
+      const float x0 = minX * _packet.ix[k];
+      const float x1 = maxX * _packet.ix[k];
+      const float y0 = minY * _packet.iy[k];
+      const float y1 = maxY * _packet.iy[k];
+      const float z0 = minZ * _packet.iz[k];
+      const float z1 = maxZ * _packet.iz[k];
+      const float entry = std::max(
+          std::max(std::min(x0, x1), std::min(y0, y1)),
+          std::max(std::min(z0, z1), _near));
+      const float exit = std::min(
+          std::min(std::max(x0, x1), std::max(y0, y1)),
+          std::min(std::max(z0, z1), _packet.t[k]));
+      entries[k] = entry <= exit ? entry : kInf;
+    }
+
+    float nearest = kInf;
+    for (std::size_t k = 0u; k < kPacketSize; ++k)
+      nearest = std::min(nearest, entries[k]);
+    return nearest;
+  }
+
+  /// \brief Intersect the rays of a packet with a two sided triangle
+  /// (Moller-Trumbore), keeping the nearest hit of each ray.
+  /// \param[in] _triangle Triangle
+  /// \param[in, out] _packet Rays
+  /// \param[in] _near Distance below which the triangle is ignored
+  void Intersect(const Triangle &_triangle, Packet &_packet,
+      const float _near)
+  {
+    const float *e1 = _triangle.e1;
+    const float *e2 = _triangle.e2;
+
+    // Terms that only depend on the shared origin
+    const float sx = _packet.origin[0] - _triangle.v0[0];
+    const float sy = _packet.origin[1] - _triangle.v0[1];
+    const float sz = _packet.origin[2] - _triangle.v0[2];
+    const float qx = sy * e1[2] - sz * e1[1];
+    const float qy = sz * e1[0] - sx * e1[2];
+    const float qz = sx * e1[1] - sy * e1[0];
+    const float qe2 = qx * e2[0] + qy * e2[1] + qz * e2[2];
+
+    for (std::size_t k = 0u; k < kPacketSize; ++k)
+    {
+      const float px = _packet.dy[k] * e2[2] - _packet.dz[k] * e2[1];
+      const float py = _packet.dz[k] * e2[0] - _packet.dx[k] * e2[2];
+      const float pz = _packet.dx[k] * e2[1] - _packet.dy[k] * e2[0];
+      const float inv = 1.0f / (px * e1[0] + py * e1[1] + pz * e1[2]);
+      const float u = (sx * px + sy * py + sz * pz) * inv;
+      const float v = (_packet.dx[k] * qx + _packet.dy[k] * qy +
+          _packet.dz[k] * qz) * inv;
+      const float t = qe2 * inv;
+      // NaNs from parallel rays fail the comparisons
+      const bool hit = u >= 0.0f && v >= 0.0f && u + v <= 1.0f &&
+          t > _near && t < _packet.t[k];
+      _packet.t[k] = hit ? t : _packet.t[k];
+    }
+  }
+
+  /// \brief Traverse a hierarchy with a packet, nearest child first.
+  /// \param[in] _nodes Nodes of the hierarchy, the root first
+  /// \param[in, out] _packet Rays
+  /// \param[in] _near Distance below which nodes are ignored
+  /// \param[in] _leaf Function called with the first primitive and the
+  /// number of primitives of each leaf hit by the packet
+  template<typename LeafFunc>
+  void Traverse(const std::vector<BvhNode> &_nodes, Packet &_packet,
+      const float _near, LeafFunc &&_leaf)
+  {
+    if (_nodes.empty() || !(Intersect(_nodes[0].box, _packet, _near) < kInf))
+      return;
+
+    uint32_t stack[kStackSize];
+    int size = 0;
+    uint32_t index = 0u;
+    while (true)
+    {
+      const BvhNode &node = _nodes[index];
+      if (node.count > 0u)
+      {
+        _leaf(node.first, node.count);
+      }
+      else
+      {
+        uint32_t nearChild = node.first;
+        uint32_t farChild = node.first + 1u;
+        float nearEntry = Intersect(_nodes[nearChild].box, _packet, _near);
+        float farEntry = Intersect(_nodes[farChild].box, _packet, _near);
+        if (farEntry < nearEntry)
+        {
+          std::swap(nearChild, farChild);
+          std::swap(nearEntry, farEntry);
+        }
+        if (nearEntry < kInf)
+        {
+          if (farEntry < kInf)
+            stack[size++] = farChild;
+          index = nearChild;
+          continue;
+        }
+      }
+
+      if (size == 0)
+        break;
+      index = stack[--size];
+    }
+  }
+
+  /// \brief Build a bounding volume hierarchy, splitting nodes with a
+  /// binned surface area heuristic.
+  /// \param[in] _bounds Bounds of the primitives
+  /// \param[out] _nodes Nodes of the hierarchy, the root first. Empty if
+  /// there are no primitives.
+  /// \param[out] _order Primitives in the order of the leaves
+  void BuildBvh(const std::vector<Box> &_bounds,
+      std::vector<BvhNode> &_nodes, std::vector<uint32_t> &_order)
+  {
+    const uint32_t count = static_cast<uint32_t>(_bounds.size());
+    _nodes.clear();
+    _order.resize(count);
+    std::iota(_order.begin(), _order.end(), 0u);
+    if (count == 0u)
+      return;
+
+    std::vector<float> centroids(count * 3u);
+    for (uint32_t i = 0u; i < count; ++i)
+    {
+      for (int a = 0; a < 3; ++a)
+      {
+        centroids[i * 3u + a] =
+            0.5f * (_bounds[i].min[a] + _bounds[i].max[a]);
+      }
+    }
+
+    _nodes.reserve(2u * count);
+    BvhNode root;
+    root.count = count;
+    _nodes.push_back(root);
+
+    struct Task
+    {
+      uint32_t node;
+      int depth;
+    };
+    std::vector<Task> tasks{{0u, 0}};
+    while (!tasks.empty())
+    {
+      const Task task = tasks.back();
+      tasks.pop_back();
+
+      const uint32_t first = _nodes[task.node].first;
+      const uint32_t size = _nodes[task.node].count;
+      Box box;
+      Box centroidBox;
+      for (uint32_t i = first; i < first + size; ++i)
+      {
+        box.Grow(_bounds[_order[i]]);
+        centroidBox.Grow(&centroids[_order[i] * 3u]);
+      }
+      _nodes[task.node].box = box;
+      if (size <= kMaxLeafSize)
+        continue;
+
+      // Split along the largest extent of the centroids
+      int axis = 0;
+      for (int a = 1; a < 3; ++a)
+      {
+        if (centroidBox.max[a] - centroidBox.min[a] >
+            centroidBox.max[axis] - centroidBox.min[axis])
+        {
+          axis = a;
+        }
+      }
+      const float lower = centroidBox.min[axis];
+      const float extent = centroidBox.max[axis] - lower;
+      // Primitives with the same centroid stay in one leaf
+      if (!(extent > 0.0f))
+        continue;
+
+      uint32_t *begin = _order.data() + first;
+      uint32_t *end = begin + size;
+      uint32_t *mid = begin;
+      if (task.depth < kMedianSplitDepth)
+      {
+        const float scale = kBinCount / extent;
+        auto binOf = [&](const uint32_t _prim)
+        {
+          const int bin = static_cast<int>(
+              (centroids[_prim * 3u + axis] - lower) * scale);
+          return std::min(bin, kBinCount - 1);
+        };
+
+        Box binBoxes[kBinCount];
+        uint32_t binCounts[kBinCount] = {};
+        for (uint32_t *prim = begin; prim != end; ++prim)
+        {
+          const int bin = binOf(*prim);
+          ++binCounts[bin];
+          binBoxes[bin].Grow(_bounds[*prim]);
+        }
+
+        // Cost of the primitives right of each split
+        float rightCosts[kBinCount] = {};
+        Box accumulated;
+        uint32_t accumulatedCount = 0u;
+        for (int b = kBinCount - 1; b > 0; --b)
+        {
+          accumulated.Grow(binBoxes[b]);
+          accumulatedCount += binCounts[b];
+          rightCosts[b] = accumulated.HalfArea() * accumulatedCount;
+        }
+
+        accumulated = Box();
+        accumulatedCount = 0u;
+        float bestCost = kInf;
+        int bestSplit = 1;
+        for (int b = 1; b < kBinCount; ++b)
+        {
+          accumulated.Grow(binBoxes[b - 1]);
+          accumulatedCount += binCounts[b - 1];
+          const float cost =
+              accumulated.HalfArea() * accumulatedCount + rightCosts[b];
+          if (cost < bestCost)
+          {
+            bestCost = cost;
+            bestSplit = b;
+          }
+        }
+
+        mid = std::partition(begin, end, [&](const uint32_t _prim)
+        {
+          return binOf(_prim) < bestSplit;
+        });
+      }
+
+      if (mid == begin || mid == end)
+      {
+        mid = begin + size / 2u;
+        std::nth_element(begin, mid, end,
+            [&](const uint32_t _a, const uint32_t _b)
+        {
+          return centroids[_a * 3u + axis] < centroids[_b * 3u + axis];
+        });
+      }
+
+      const uint32_t leftCount = static_cast<uint32_t>(mid - begin);
+      BvhNode left;
+      left.first = first;
+      left.count = leftCount;
+      BvhNode right;
+      right.first = first + leftCount;
+      right.count = size - leftCount;
+
+      const uint32_t child = static_cast<uint32_t>(_nodes.size());
+      _nodes.push_back(left);
+      _nodes.push_back(right);
+      _nodes[task.node].first = child;
+      _nodes[task.node].count = 0u;
+      tasks.push_back({child, task.depth + 1});
+      tasks.push_back({child + 1u, task.depth + 1});
+    }
+  }
+
+  /// \brief Columns of the rotation of a pose.
+  /// \param[in] _pose Pose
+  /// \param[out] _columns Images of the x, y and z axes, 3 values each
+  void RotationColumns(const math::Pose3d &_pose, float _columns[9])
+  {
+    const math::Vector3d axes[3] = {
+      _pose.Rot().RotateVector(math::Vector3d(1, 0, 0)),
+      _pose.Rot().RotateVector(math::Vector3d(0, 1, 0)),
+      _pose.Rot().RotateVector(math::Vector3d(0, 0, 1))};
+    for (int i = 0; i < 3; ++i)
+    {
+      _columns[i * 3] = static_cast<float>(axes[i].X());
+      _columns[i * 3 + 1] = static_cast<float>(axes[i].Y());
+      _columns[i * 3 + 2] = static_cast<float>(axes[i].Z());
+    }
+  }
+
+  /// \brief Triangle mesh with its own hierarchy
+  struct Mesh
+  {
+    /// \brief Triangles, in the order of the leaves once built
+    std::vector<Triangle> triangles;
+
+    /// \brief Hierarchy over the triangles
+    std::vector<BvhNode> nodes;
+
+    /// \brief World pose
+    math::Pose3d pose;
+
+    /// \brief Retro reflectivity
+    float retro = 0.0f;
+
+    /// \brief True if the triangles changed since the hierarchy was built
+    bool dirty = true;
+  };
+
+  /// \brief Mesh placed in the world, in the hierarchy over the meshes
+  struct Instance
+  {
+    /// \brief Mesh
+    const Mesh *mesh = nullptr;
+
+    /// \brief Rotation from the world to the frame of the mesh, row major
+    float rotation[9];
+
+    /// \brief Position of the mesh
+    float position[3];
+
+    /// \brief Retro reflectivity of the mesh
+    float retro = 0.0f;
+  };
+}
+
+/// \brief Private data for RayCaster
+class ignition::sensors::RayCasterPrivate
+{
+  /// \brief Meshes by name
+  public: std::map<std::string, Mesh> meshes;
+
+  /// \brief Meshes with triangles, in the order of the leaves of the
+  /// hierarchy over the meshes
+  public: std::vector<Instance> instances;
+
+  /// \brief Hierarchy over the world bounds of the meshes
+  public: std::vector<BvhNode> nodes;
+
+  /// \brief True if a mesh changed or moved since Build()
+  public: bool dirty = false;
+};
+
+//////////////////////////////////////////////////
+RayCaster::RayCaster()
+  : dataPtr(new RayCasterPrivate)
+{
+}
+
+//////////////////////////////////////////////////
+RayCaster::~RayCaster()
+{
+}
+
+//////////////////////////////////////////////////
+bool RayCaster::SetMesh(const std::string &_name,
+    const std::vector<math::Vector3d> &_vertices,
+    const std::vector<unsigned int> &_indices, const double _retro)
+{
+  if (_indices.size() % 3u != 0u)
+    return false;
+  for (const unsigned int index : _indices)
+  {
+    if (index >= _vertices.size())
+      return false;
+  }
+
+  std::vector<Triangle> triangles(_indices.size() / 3u);
+  for (std::size_t i = 0u; i < triangles.size(); ++i)
+  {
+    const math::Vector3d &v0 = _vertices[_indices[i * 3u]];
+    const math::Vector3d e1 = _vertices[_indices[i * 3u + 1u]] - v0;
+    const math::Vector3d e2 = _vertices[_indices[i * 3u + 2u]] - v0;
+    for (int a = 0; a < 3; ++a)
+    {
+      triangles[i].v0[a] = static_cast<float>(v0[a]);
+      triangles[i].e1[a] = static_cast<float>(e1[a]);
+      triangles[i].e2[a] = static_cast<float>(e2[a]);
+    }
+  }
+
+  Mesh &mesh = this->dataPtr->meshes[_name];
+  mesh.triangles.swap(triangles);
+  mesh.nodes.clear();
+  mesh.retro = static_cast<float>(_retro);
+  mesh.dirty = true;
+  this->dataPtr->dirty = true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool RayCaster::SetMeshPose(const std::string &_name,
+    const math::Pose3d &_pose)
+{
+  auto it = this->dataPtr->meshes.find(_name);
+  if (it == this->dataPtr->meshes.end())
+    return false;
+  if (it->second.pose != _pose)
+  {
+    it->second.pose = _pose;
+    this->dataPtr->dirty = true;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool RayCaster::RemoveMesh(const std::string &_name)
+{
+  if (this->dataPtr->meshes.erase(_name) == 0u)
+    return false;
+  this->dataPtr->dirty = true;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void RayCaster::Clear()
+{
+  this->dataPtr->meshes.clear();
+  this->dataPtr->dirty = true;
+}
+
+//////////////////////////////////////////////////
+std::size_t RayCaster::MeshCount() const
+{
+  return this->dataPtr->meshes.size();
+}
+
+//////////////////////////////////////////////////
+void RayCaster::Build()
+{
+  if (!this->dataPtr->dirty)
+    return;
+
+  IGN_PROFILE("RayCaster::Build");
+  std::vector<Box> bounds;
+  std::vector<uint32_t> order;
+  std::vector<Instance> instances;
+  std::vector<Box> instanceBounds;
+  for (auto &entry : this->dataPtr->meshes)
+  {
+    Mesh &mesh = entry.second;
+    if (mesh.dirty)
+    {
+      bounds.resize(mesh.triangles.size());
+      for (std::size_t i = 0u; i < mesh.triangles.size(); ++i)
+      {
+        const Triangle &triangle = mesh.triangles[i];
+        float v1[3];
+        float v2[3];
+        for (int a = 0; a < 3; ++a)
+        {
+          v1[a] = triangle.v0[a] + triangle.e1[a];
+          v2[a] = triangle.v0[a] + triangle.e2[a];
+        }
+        bounds[i] = Box();
+        bounds[i].Grow(triangle.v0);
+        bounds[i].Grow(v1);
+        bounds[i].Grow(v2);
+      }
+      BuildBvh(bounds, mesh.nodes, order);
+
+      std::vector<Triangle> sorted(mesh.triangles.size());
+      for (std::size_t i = 0u; i < order.size(); ++i)
+        sorted[i] = mesh.triangles[order[i]];
+      mesh.triangles.swap(sorted);
+      mesh.dirty = false;
+    }
+
+    if (mesh.nodes.empty())
+      continue;
+
+    Instance instance;
+    instance.mesh = &mesh;
+    instance.retro = mesh.retro;
+    float columns[9];
+    RotationColumns(mesh.pose, columns);
+    // The rows of the inverse rotation are the columns of the rotation
+    std::copy(columns, columns + 9, instance.rotation);
+    instance.position[0] = static_cast<float>(mesh.pose.Pos().X());
+    instance.position[1] = static_cast<float>(mesh.pose.Pos().Y());
+    instance.position[2] = static_cast<float>(mesh.pose.Pos().Z());
+
+    // World bounds of the local bounds of the mesh
+    const Box &local = mesh.nodes[0].box;
+    Box world;
+    for (int i = 0; i < 3; ++i)
+    {
+      float center = instance.position[i];
+      float extent = 0.0f;
+      for (int j = 0; j < 3; ++j)
+      {
+        const float r = columns[j * 3 + i];
+        center += r * 0.5f * (local.min[j] + local.max[j]);
+        extent += std::abs(r) * 0.5f * (local.max[j] - local.min[j]);
+      }
+      world.min[i] = center - extent;
+      world.max[i] = center + extent;
+    }
+    instances.push_back(instance);
+    instanceBounds.push_back(world);
+  }
+
+  BuildBvh(instanceBounds, this->dataPtr->nodes, order);
+  this->dataPtr->instances.resize(instances.size());
+  for (std::size_t i = 0u; i < order.size(); ++i)
+    this->dataPtr->instances[i] = instances[order[i]];
+  this->dataPtr->dirty = false;
+}
+
+//////////////////////////////////////////////////
+void RayCaster::Cast(const math::Pose3d &_pose, const float *_directions,
+    const std::size_t _count, const double _near, const double _far,
+    float *_out) const
+{
+  IGN_PROFILE("RayCaster::Cast");
+  const float nearLimit = static_cast<float>(std::max(0.0, _near));
+  const float farLimit = static_cast<float>(_far);
+  float columns[9];
+  RotationColumns(_pose, columns);
+
+  const std::vector<BvhNode> &nodes = this->dataPtr->nodes;
+  const std::vector<Instance> &instances = this->dataPtr->instances;
+  Packet packet;
+  packet.origin[0] = static_cast<float>(_pose.Pos().X());
+  packet.origin[1] = static_cast<float>(_pose.Pos().Y());
+  packet.origin[2] = static_cast<float>(_pose.Pos().Z());
+
+  for (std::size_t start = 0u; start < _count; start += kPacketSize)
+  {
+    const std::size_t lanes = std::min(kPacketSize, _count - start);
+    const float *direction = _directions + start * 3u;
+    for (std::size_t k = 0u; k < kPacketSize; ++k)
+    {
+      // Idle lanes repeat the last ray but never hit
+      const float *d = direction + std::min(k, lanes - 1u) * 3u;
+      packet.dx[k] = columns[0] * d[0] + columns[3] * d[1] + columns[6] * d[2];
+      packet.dy[k] = columns[1] * d[0] + columns[4] * d[1] + columns[7] * d[2];
+      packet.dz[k] = columns[2] * d[0] + columns[5] * d[1] + columns[8] * d[2];
+      packet.t[k] = k < lanes ? farLimit : -1.0f;
+      packet.retro[k] = 0.0f;
+    }
+    packet.Invert();
+
+    Traverse(nodes, packet, nearLimit,
+        [&](const uint32_t _first, const uint32_t _size)
+    {
+      for (uint32_t i = _first; i < _first + _size; ++i)
+      {
+        const Instance &instance = instances[i];
+        const float *r = instance.rotation;
+
+        // Rays in the frame of the mesh, which keeps distances
+        Packet local;
+        const float ox = packet.origin[0] - instance.position[0];
+        const float oy = packet.origin[1] - instance.position[1];
+        const float oz = packet.origin[2] - instance.position[2];
+        local.origin[0] = r[0] * ox + r[1] * oy + r[2] * oz;
+        local.origin[1] = r[3] * ox + r[4] * oy + r[5] * oz;
+        local.origin[2] = r[6] * ox + r[7] * oy + r[8] * oz;
+        for (std::size_t k = 0u; k < kPacketSize; ++k)
+        {
+          local.dx[k] = r[0] * packet.dx[k] + r[1] * packet.dy[k] +
+              r[2] * packet.dz[k];
+          local.dy[k] = r[3] * packet.dx[k] + r[4] * packet.dy[k] +
+              r[5] * packet.dz[k];
+          local.dz[k] = r[6] * packet.dx[k] + r[7] * packet.dy[k] +
+              r[8] * packet.dz[k];
+          local.t[k] = packet.t[k];
+        }
+        local.Invert();
+
+        const std::vector<Triangle> &triangles = instance.mesh->triangles;
+        Traverse(instance.mesh->nodes, local, nearLimit,
+            [&](const uint32_t _firstTriangle, const uint32_t _triangles)
+        {
+          for (uint32_t j = _firstTriangle;
+               j < _firstTriangle + _triangles; ++j)
+          {
+            Intersect(triangles[j], local, nearLimit);
+          }
+        });
+
+        for (std::size_t k = 0u; k < kPacketSize; ++k)
+        {
+          const bool hit = local.t[k] < packet.t[k];
+          packet.retro[k] = hit ? instance.retro : packet.retro[k];
+          packet.t[k] = local.t[k];
+        }
+      }
+    });
+
+    float *out = _out + start * 3u;
+    for (std::size_t k = 0u; k < lanes; ++k, out += 3)
+    {
+      out[0] = packet.t[k] < farLimit ? packet.t[k] : kInf;
+      out[1] = packet.retro[k];
+      out[2] = 0.0f;
+    }
+  }
+}
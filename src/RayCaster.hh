@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RAYCASTER_HH_
+#define IGNITION_SENSORS_RAYCASTER_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ignition/math/Pose3.hh>
+#include <ignition/math/Vector3.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class RayCasterPrivate;
+
+    /// \brief Casts rays against triangle meshes on the CPU. Each mesh has
+    /// its own bounding volume hierarchy in its local frame, and a second
+    /// hierarchy over the world bounds of the meshes is rebuilt when they
+    /// move, so moving a mesh doesn't rebuild its triangles. Rays are
+    /// traversed in packets of adjacent rays sharing an origin, which keeps
+    /// the inner loops over a packet free of branches so the compiler can
+    /// vectorize them.
+    ///
+    /// Meshes are changed from a single thread, then Build() is called
+    /// before Cast(), which may then be called from many threads at once.
+    class IGNITION_SENSORS_VISIBLE RayCaster
+    {
+      /// \brief Constructor
+      public: RayCaster();
+
+      /// \brief Destructor
+      public: ~RayCaster();
+
+      /// \brief Add a triangle mesh, or replace the triangles of a mesh
+      /// already added, keeping its pose.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _vertices Vertices, in the frame of the mesh
+      /// \param[in] _indices Three vertex indices per triangle
+      /// \param[in] _retro Retro reflectivity of the mesh
+      /// \return False if an index is out of bounds or the number of
+      /// indices isn't a multiple of 3.
+      public: bool SetMesh(const std::string &_name,
+                  const std::vector<math::Vector3d> &_vertices,
+                  const std::vector<unsigned int> &_indices,
+                  const double _retro = 0.0);
+
+      /// \brief Set the world pose of a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \param[in] _pose Pose of the mesh
+      /// \return False if there is no mesh with that name.
+      public: bool SetMeshPose(const std::string &_name,
+                  const math::Pose3d &_pose);
+
+      /// \brief Remove a mesh.
+      /// \param[in] _name Name of the mesh
+      /// \return False if there is no mesh with that name.
+      public: bool RemoveMesh(const std::string &_name);
+
+      /// \brief Remove all meshes.
+      public: void Clear();
+
+      /// \brief Get the number of meshes.
+      /// \return Number of meshes
+      public: std::size_t MeshCount() const;
+
+      /// \brief Build the hierarchies of the meshes that changed, and the
+      /// hierarchy over the meshes if any of them changed or moved.
+      public: void Build();
+
+      /// \brief Cast rays from an origin. Adjacent rays should have close
+      /// directions, as they are traversed together. Build() must have been
+      /// called since the meshes last changed.
+      /// \param[in] _pose World pose of the origin and frame of the rays
+      /// \param[in] _directions Unit directions of the rays, in the frame
+      /// of the origin, 3 values per ray
+      /// \param[in] _count Number of rays
+      /// \param[in] _near Distance below which surfaces are ignored
+      /// \param[in] _far Distance above which surfaces are ignored
+      /// \param[out] _out 3 values per ray, in the layout of the scans of
+      /// rendering::GpuRays: the distance to the nearest surface or +inf,
+      /// the retro reflectivity of its mesh or 0, and 0.
+      public: void Cast(const math::Pose3d &_pose, const float *_directions,
+                  const std::size_t _count, const double _near,
+                  const double _far, float *_out) const;
+
+      /// \brief Private data pointer
+      private: std::unique_ptr<RayCasterPrivate> dataPtr;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <ignition/math/Helpers.hh>
+
+#include "RayCaster.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Vertices of a unit cube centered on its origin.
+std::vector<math::Vector3d> CubeVertices()
+{
+  std::vector<math::Vector3d> vertices;
+  for (int i = 0; i < 8; ++i)
+  {
+    vertices.push_back(math::Vector3d(
+        (i & 1) ? 0.5 : -0.5, (i & 2) ? 0.5 : -0.5, (i & 4) ? 0.5 : -0.5));
+  }
+  return vertices;
+}
+
+/// \brief Indices of the triangles of the faces of the cube.
+std::vector<unsigned int> CubeIndices()
+{
+  return {0, 2, 1, 1, 2, 3,  4, 5, 6, 5, 7, 6,
+          0, 1, 4, 1, 5, 4,  2, 6, 3, 3, 6, 7,
+          0, 4, 2, 2, 4, 6,  1, 3, 5, 3, 7, 5};
+}
+
+/// \brief Cast a single ray.
+/// \return Range and retro value of the ray
+std::pair<float, float> CastRay(const RayCaster &_caster,
+    const math::Pose3d &_pose, const math::Vector3d &_direction,
+    const double _near = 0.0, const double _far = 100.0)
+{
+  const float direction[3] = {
+    static_cast<float>(_direction.X()),
+    static_cast<float>(_direction.Y()),
+    static_cast<float>(_direction.Z())};
+  float out[3];
+  _caster.Cast(_pose, direction, 1u, _near, _far, out);
+  EXPECT_FLOAT_EQ(0.0f, out[2]);
+  return {out[0], out[1]};
+}
+
+//////////////////////////////////////////////////
+TEST(RayCaster, Meshes)
+{
+  RayCaster caster;
+  EXPECT_EQ(0u, caster.MeshCount());
+  EXPECT_FALSE(caster.SetMeshPose("cube", math::Pose3d::Zero));
+  EXPECT_FALSE(caster.RemoveMesh("cube"));
+
+  // Invalid indices
+  EXPECT_FALSE(caster.SetMesh("cube", CubeVertices(), {0, 1}));
+  EXPECT_FALSE(caster.SetMesh("cube", CubeVertices(), {0, 1, 8}));
+  EXPECT_EQ(0u, caster.MeshCount());
+
+  // Nothing to hit
+  caster.Build();
+  EXPECT_TRUE(std::isinf(
+      CastRay(caster, math::Pose3d::Zero, math::Vector3d(1, 0, 0)).first));
+
+  ASSERT_TRUE(caster.SetMesh("cube", CubeVertices(), CubeIndices(), 0.5));
+  EXPECT_EQ(1u, caster.MeshCount());
+  EXPECT_TRUE(caster.SetMeshPose("cube", math::Pose3d(5, 0, 0, 0, 0, 0)));
+  caster.Build();
+
+  auto hit = CastRay(caster, math::Pose3d::Zero, math::Vector3d(1, 0, 0));
+  EXPECT_FLOAT_EQ(4.5f, hit.first);
+  EXPECT_FLOAT_EQ(0.5f, hit.second);
+
+  // Misses
+  hit = CastRay(caster, math::Pose3d::Zero, math::Vector3d(-1, 0, 0));
+  EXPECT_TRUE(std::isinf(hit.first) && hit.first > 0.0f);
+  EXPECT_FLOAT_EQ(0.0f, hit.second);
+  EXPECT_TRUE(std::isinf(CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(0, 0, 1)).first));
+
+  // The origin is rotated and moved with its pose
+  hit = CastRay(caster, math::Pose3d(5, -3, 0, 0, 0, IGN_PI / 2),
+      math::Vector3d(1, 0, 0));
+  EXPECT_NEAR(2.5f, hit.first, 1e-5);
+
+  // Surfaces beyond the limits are ignored, the back face is hit when the
+  // front face is nearer than the near limit
+  EXPECT_TRUE(std::isinf(CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(1, 0, 0), 0.0, 4.0).first));
+  EXPECT_FLOAT_EQ(5.5f, CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(1, 0, 0), 5.0, 10.0).first);
+
+  // Moving the mesh
+  EXPECT_TRUE(caster.SetMeshPose("cube", math::Pose3d(0, 0, 3, 0, 0, 0)));
+  caster.Build();
+  EXPECT_TRUE(std::isinf(CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(1, 0, 0)).first));
+  EXPECT_FLOAT_EQ(2.5f, CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(0, 0, 1)).first);
+
+  // Replacing the triangles keeps the pose
+  std::vector<math::Vector3d> vertices = CubeVertices();
+  for (auto &vertex : vertices)
+    vertex = math::Vector3d(vertex.X() * 2, vertex.Y() * 2, vertex.Z() * 2);
+  ASSERT_TRUE(caster.SetMesh("cube", vertices, CubeIndices()));
+  caster.Build();
+  hit = CastRay(caster, math::Pose3d::Zero, math::Vector3d(0, 0, 1));
+  EXPECT_FLOAT_EQ(2.0f, hit.first);
+  EXPECT_FLOAT_EQ(0.0f, hit.second);
+
+  EXPECT_TRUE(caster.RemoveMesh("cube"));
+  EXPECT_EQ(0u, caster.MeshCount());
+  caster.Build();
+  EXPECT_TRUE(std::isinf(CastRay(caster, math::Pose3d::Zero,
+      math::Vector3d(0, 0, 1)).first));
+}
+
+//////////////////////////////////////////////////
+TEST(RayCaster, NearestMesh)
+{
+  // Two cubes along the same ray, the nearest one is reported
+  RayCaster caster;
+  ASSERT_TRUE(caster.SetMesh("far", CubeVertices(), CubeIndices(), 0.2));
+  ASSERT_TRUE(caster.SetMesh("near", CubeVertices(), CubeIndices(), 0.8));
+  EXPECT_TRUE(caster.SetMeshPose("far", math::Pose3d(0, 8, 0, 0, 0, 0)));
+  EXPECT_TRUE(caster.SetMeshPose("near", math::Pose3d(0, 4, 0, 0, 0, 0.3)));
+  caster.Build();
+
+  auto hit = CastRay(caster, math::Pose3d::Zero, math::Vector3d(0, 1, 0));
+  EXPECT_LT(hit.first, 4.0f);
+  EXPECT_GT(hit.first, 3.0f);
+  EXPECT_FLOAT_EQ(0.8f, hit.second);
+
+  EXPECT_TRUE(caster.RemoveMesh("near"));
+  caster.Build();
+  hit = CastRay(caster, math::Pose3d::Zero, math::Vector3d(0, 1, 0));
+  EXPECT_FLOAT_EQ(7.5f, hit.first);
+  EXPECT_FLOAT_EQ(0.2f, hit.second);
+}
+
+//////////////////////////////////////////////////
+TEST(RayCaster, BruteForce)
+{
+  // Random triangle soup, compared with testing every triangle
+  std::mt19937 random(7u);
+  std::uniform_real_distribution<double> position(-10.0, 10.0);
+  std::uniform_real_distribution<double> offset(-1.0, 1.0);
+  std::vector<math::Vector3d> vertices;
+  std::vector<unsigned int> indices;
+  for (unsigned int i = 0u; i < 500u; ++i)
+  {
+    const math::Vector3d center(position(random), position(random),
+        position(random));
+    for (int v = 0; v < 3; ++v)
+    {
+      indices.push_back(static_cast<unsigned int>(vertices.size()));
+      vertices.push_back(math::Vector3d(center.X() + offset(random),
+          center.Y() + offset(random), center.Z() + offset(random)));
+    }
+  }
+
+  // The soup is split in two meshes, one of them moved
+  const std::size_t half = indices.size() / 2u;
+  const math::Pose3d pose(1, 2, -1, 0.1, 0.2, 0.3);
+  std::vector<math::Vector3d> secondVertices;
+  std::vector<unsigned int> secondIndices;
+  for (std::size_t i = half; i < indices.size(); ++i)
+  {
+    // Vertices of the second mesh in its frame
+    const math::Vector3d world = vertices[indices[i]];
+    secondIndices.push_back(static_cast<unsigned int>(secondVertices.size()));
+    secondVertices.push_back(
+        pose.Rot().RotateVectorReverse(world - pose.Pos()));
+  }
+  RayCaster caster;
+  ASSERT_TRUE(caster.SetMesh("first", vertices,
+      std::vector<unsigned int>(indices.begin(), indices.begin() + half)));
+  ASSERT_TRUE(caster.SetMesh("second", secondVertices, secondIndices));
+  EXPECT_TRUE(caster.SetMeshPose("second", pose));
+  caster.Build();
+
+  // A number of rays that isn't a multiple of the packets
+  const unsigned int count = 1001u;
+  std::vector<float> directions;
+  for (unsigned int i = 0u; i < count; ++i)
+  {
+    const double azimuth = 2.0 * IGN_PI * i / count;
+    const double inclination = 0.5 * std::sin(0.05 * i);
+    directions.push_back(static_cast<float>(
+        std::cos(inclination) * std::cos(azimuth)));
+    directions.push_back(static_cast<float>(
+        std::cos(inclination) * std::sin(azimuth)));
+    directions.push_back(static_cast<float>(std::sin(inclination)));
+  }
+  std::vector<float> out(count * 3u);
+  caster.Cast(math::Pose3d::Zero, directions.data(), count, 0.1, 12.0,
+      out.data());
+
+  unsigned int hits = 0u;
+  for (unsigned int r = 0u; r < count; ++r)
+  {
+    const math::Vector3d d(directions[r * 3u], directions[r * 3u + 1u],
+        directions[r * 3u + 2u]);
+    double nearest = std::numeric_limits<double>::infinity();
+    for (std::size_t t = 0u; t < indices.size(); t += 3u)
+    {
+      const math::Vector3d &v0 = vertices[indices[t]];
+      const math::Vector3d e1 = vertices[indices[t + 1u]] - v0;
+      const math::Vector3d e2 = vertices[indices[t + 2u]] - v0;
+      const math::Vector3d p = d.Cross(e2);
+      const double det = e1.Dot(p);
+      if (std::abs(det) < 1e-12)
+        continue;
+      const math::Vector3d s = -v0;
+      const double u = s.Dot(p) / det;
+      const math::Vector3d q = s.Cross(e1);
+      const double v = d.Dot(q) / det;
+      const double distance = e2.Dot(q) / det;
+      if (u >= 0.0 && v >= 0.0 && u + v <= 1.0 && distance > 0.1 &&
+          distance < 12.0)
+      {
+        nearest = std::min(nearest, distance);
+      }
+    }
+
+    if (std::isinf(nearest))
+    {
+      // Rays grazing an edge may go either way
+      if (!std::isinf(out[r * 3u]))
+      {
+        EXPECT_LT(out[r * 3u], 12.0f) << r;
+      }
+    }
+    else
+    {
+      ++hits;
+      EXPECT_NEAR(nearest, out[r * 3u], 1e-3) << r;
+    }
+  }
+  EXPECT_GT(hits, 50u);
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+#include <ignition/common/Console.hh>
+#include <ignition/msgs/Utility.hh>
+
+#include "ReadingAggregator.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Reading of one sensor
+class AggregatedRow
+{
+  /// \brief Id of the sensor
+  public: SensorId id = NO_SENSOR;
+
+  /// \brief Name of the sensor
+  public: std::string name;
+
+  /// \brief Values of the reading
+  public: std::vector<double> values;
+};
+
+/// \brief Private data for ReadingAggregator
+class ignition::sensors::ReadingAggregatorPrivate
+{
+  /// \brief Type of the aggregated messages, set by the first reading
+  public: const google::protobuf::Descriptor *descriptor = nullptr;
+
+  /// \brief Names of the values of a reading
+  public: std::vector<std::string> fields;
+
+  /// \brief Readings, the first count are in use. Rows are kept between
+  /// flushes to reuse their memory.
+  public: std::vector<AggregatedRow> rows;
+
+  /// \brief Number of rows in use
+  public: std::size_t count = 0u;
+
+  /// \brief Row of each sensor with a reading
+  public: std::unordered_map<SensorId, std::size_t> rowOfSensor;
+
+  /// \brief Scratch buffer with the rows ordered by sensor id
+  public: std::vector<const AggregatedRow *> order;
+
+  /// \brief True once a reading of another type was reported
+  public: bool warnedType = false;
+
+  /// \brief Protects the readings
+  public: mutable std::mutex mutex;
+};
+
+//////////////////////////////////////////////////
+/// \brief Check whether a field is aggregated.
+/// \param[in] _field The field
+/// \return True for singular numeric and message fields, except headers.
+static bool Aggregated(const google::protobuf::FieldDescriptor &_field)
+{
+  if (_field.is_repeated() ||
+      _field.cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_STRING)
+  {
+    return false;
+  }
+  return _field.cpp_type() !=
+      google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE ||
+      _field.message_type()->full_name() != "ignition.msgs.Header";
+}
+
+//////////////////////////////////////////////////
+/// \brief Append the names of the values of a message type.
+/// \param[in] _descriptor Type of the messages
+/// \param[in] _prefix Prefix of the names, for nested messages
+/// \param[in,out] _fields Names to append to
+static void AppendFields(const google::protobuf::Descriptor &_descriptor,
+    const std::string &_prefix, std::vector<std::string> &_fields)
+{
+  for (int i = 0; i < _descriptor.field_count(); ++i)
+  {
+    const google::protobuf::FieldDescriptor &field = *_descriptor.field(i);
+    if (!Aggregated(field))
+      continue;
+
+    if (field.cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE)
+    {
+      AppendFields(*field.message_type(), _prefix + field.name() + ".",
+          _fields);
+    }
+    else
+    {
+      _fields.push_back(_prefix + field.name());
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+ReadingAggregator::ReadingAggregator()
+  : dataPtr(new ReadingAggregatorPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+ReadingAggregator::~ReadingAggregator()
+{
+}
+
+//////////////////////////////////////////////////
+void ReadingAggregator::Add(const SensorId _id, const std::string &_name,
+    const google::protobuf::Message &_msg)
+{
+  auto &data = *this->dataPtr;
+  std::lock_guard<std::mutex> lock(data.mutex);
+  if (!data.descriptor)
+  {
+    data.descriptor = _msg.GetDescriptor();
+    data.fields.clear();
+    Fields(*data.descriptor, data.fields);
+  }
+  else if (data.descriptor != _msg.GetDescriptor())
+  {
+    if (!data.warnedType)
+    {
+      ignwarn << "Sensor [" << _name << "] published a ["
+              << _msg.GetTypeName() << "] reading, but the aggregated "
+              << "readings are [" << data.descriptor->full_name()
+              << "]. Dropping it.\n";
+      data.warnedType = true;
+    }
+    return;
+  }
+
+  auto slot = data.rowOfSensor.emplace(_id, data.count);
+  if (slot.second)
+  {
+    if (data.count == data.rows.size())
+      data.rows.emplace_back();
+    ++data.count;
+  }
+
+  AggregatedRow &row = data.rows[slot.first->second];
+  row.id = _id;
+  if (row.name != _name)
+    row.name = _name;
+  row.values.clear();
+  Values(_msg, row.values);
+}
+
+//////////////////////////////////////////////////
+std::size_t ReadingAggregator::Count() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->count;
+}
+
+//////////////////////////////////////////////////
+bool ReadingAggregator::Flush(
+    const std::chrono::steady_clock::duration &_time,
+    ignition::msgs::Double_V &_msg)
+{
+  auto &data = *this->dataPtr;
+  std::lock_guard<std::mutex> lock(data.mutex);
+  if (data.count == 0u)
+    return false;
+
+  // Parallel updates add readings in any order
+  data.order.clear();
+  for (std::size_t i = 0u; i < data.count; ++i)
+    data.order.push_back(&data.rows[i]);
+  std::sort(data.order.begin(), data.order.end(),
+      [](const AggregatedRow *_a, const AggregatedRow *_b)
+      {
+        return _a->id < _b->id;
+      });
+
+  auto header = _msg.mutable_header();
+  header->mutable_stamp()->CopyFrom(msgs::Convert(_time));
+  header->clear_data();
+  auto fields = header->add_data();
+  fields->set_key("fields");
+  for (const std::string &field : data.fields)
+    fields->add_value(field);
+  auto sensors = header->add_data();
+  sensors->set_key("sensors");
+
+  _msg.clear_data();
+  _msg.mutable_data()->Reserve(
+      static_cast<int>(data.count * data.fields.size()));
+  for (const AggregatedRow *row : data.order)
+  {
+    sensors->add_value(row->name);
+    for (const double value : row->values)
+      _msg.add_data(value);
+  }
+
+  data.count = 0u;
+  data.rowOfSensor.clear();
+  return true;
+}
+
+//////////////////////////////////////////////////
+void ReadingAggregator::Clear()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->count = 0u;
+  this->dataPtr->rowOfSensor.clear();
+}
+
+//////////////////////////////////////////////////
+void ReadingAggregator::Fields(
+    const google::protobuf::Descriptor &_descriptor,
+    std::vector<std::string> &_fields)
+{
+  AppendFields(_descriptor, "", _fields);
+}
+
+//////////////////////////////////////////////////
+void ReadingAggregator::Values(const google::protobuf::Message &_msg,
+    std::vector<double> &_values)
+{
+  const google::protobuf::Descriptor *descriptor = _msg.GetDescriptor();
+  const google::protobuf::Reflection *reflection = _msg.GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i)
+  {
+    const google::protobuf::FieldDescriptor *field = descriptor->field(i);
+    if (!Aggregated(*field))
+      continue;
+
+    switch (field->cpp_type())
+    {
+      case google::protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+        _values.push_back(reflection->GetDouble(_msg, field));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+        _values.push_back(reflection->GetFloat(_msg, field));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_INT32:
+        _values.push_back(reflection->GetInt32(_msg, field));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_INT64:
+        _values.push_back(static_cast<double>(
+            reflection->GetInt64(_msg, field)));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_UINT32:
+        _values.push_back(reflection->GetUInt32(_msg, field));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_UINT64:
+        _values.push_back(static_cast<double>(
+            reflection->GetUInt64(_msg, field)));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_BOOL:
+        _values.push_back(reflection->GetBool(_msg, field) ? 1.0 : 0.0);
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_ENUM:
+        _values.push_back(reflection->GetEnumValue(_msg, field));
+        break;
+      case google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+        // Unset messages give their default values
+        Values(reflection->GetMessage(_msg, field), _values);
+        break;
+      default:
+        break;
+    }
+  }
+}
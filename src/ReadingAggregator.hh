@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_READINGAGGREGATOR_HH_
+#define IGNITION_SENSORS_READINGAGGREGATOR_HH_
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/double_v.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/message.h>
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+#include "ignition/sensors/Sensor.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class ReadingAggregatorPrivate;
+
+    /// \brief Collects the readings of many sensors of a type and packs
+    /// them in one ignition::msgs::Double_V, as the Manager publishes them
+    /// with Manager::SetAggregatedTopic(). The values of a reading are the
+    /// numeric fields of its message in declaration order, with nested
+    /// messages flattened and headers, strings and repeated fields left
+    /// out. The "fields" header entry names the values of a reading,
+    /// such as "field_tesla.x", and the "sensors" header entry names the
+    /// sensor of each row. The data holds one row of values per sensor,
+    /// ordered by sensor id.
+    class IGNITION_SENSORS_VISIBLE ReadingAggregator
+    {
+      /// \brief Constructor
+      public: ReadingAggregator();
+
+      /// \brief Destructor
+      public: ~ReadingAggregator();
+
+      /// \brief Add the reading of a sensor. A later reading of the same
+      /// sensor replaces it. Readings whose message type differs from the
+      /// first reading are dropped. Safe to call from several threads.
+      /// \param[in] _id Id of the sensor
+      /// \param[in] _name Name of the sensor
+      /// \param[in] _msg Message the sensor published
+      public: void Add(const SensorId _id, const std::string &_name,
+                  const google::protobuf::Message &_msg);
+
+      /// \brief Get the number of sensors with a reading.
+      /// \return Number of readings added since the last Flush(), counting
+      /// each sensor once
+      public: std::size_t Count() const;
+
+      /// \brief Pack the readings added since the previous call and forget
+      /// them.
+      /// \param[in] _time Time to stamp the message with
+      /// \param[out] _msg Message with the readings
+      /// \return False if there was no reading, in which case _msg is
+      /// unchanged.
+      public: bool Flush(const std::chrono::steady_clock::duration &_time,
+                  ignition::msgs::Double_V &_msg);
+
+      /// \brief Forget the readings added since the previous Flush().
+      public: void Clear();
+
+      /// \brief Get the names of the values a message type aggregates to.
+      /// \param[in] _descriptor Type of the messages
+      /// \param[out] _fields Names of the values, nested fields joined
+      /// with dots
+      public: static void Fields(
+                  const google::protobuf::Descriptor &_descriptor,
+                  std::vector<std::string> &_fields);
+
+      /// \brief Append the values of a message.
+      /// \param[in] _msg The message
+      /// \param[in,out] _values Values to append to, in the order of
+      /// Fields()
+      public: static void Values(const google::protobuf::Message &_msg,
+                  std::vector<double> &_values);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<ReadingAggregatorPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/msgs/altimeter.pb.h>
+#include <ignition/msgs/magnetometer.pb.h>
+
+#include "ReadingAggregator.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Get the values of a header entry.
+/// \param[in] _msg Aggregated message
+/// \param[in] _key Key of the entry
+/// \return The values, empty if the entry is missing.
+static std::vector<std::string> HeaderValues(const msgs::Double_V &_msg,
+    const std::string &_key)
+{
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == _key)
+      return {data.value().begin(), data.value().end()};
+  }
+  return {};
+}
+
+//////////////////////////////////////////////////
+TEST(ReadingAggregator, Fields)
+{
+  std::vector<std::string> fields;
+  ReadingAggregator::Fields(*msgs::Magnetometer::descriptor(), fields);
+  EXPECT_EQ((std::vector<std::string>{"field_tesla.x", "field_tesla.y",
+      "field_tesla.z"}), fields);
+
+  msgs::Magnetometer msg;
+  msg.mutable_header()->mutable_stamp()->set_sec(3);
+  msg.mutable_field_tesla()->set_x(1.0);
+  msg.mutable_field_tesla()->set_z(-2.5);
+  std::vector<double> values;
+  ReadingAggregator::Values(msg, values);
+  EXPECT_EQ((std::vector<double>{1.0, 0.0, -2.5}), values);
+}
+
+//////////////////////////////////////////////////
+TEST(ReadingAggregator, Flush)
+{
+  ReadingAggregator aggregator;
+  msgs::Double_V msg;
+  EXPECT_FALSE(aggregator.Flush(std::chrono::seconds(1), msg));
+
+  msgs::Altimeter altimeter;
+  altimeter.set_vertical_position(5.0);
+  altimeter.set_vertical_velocity(-1.0);
+  altimeter.set_vertical_reference(100.0);
+  aggregator.Add(7u, "alt7", altimeter);
+  altimeter.set_vertical_position(2.0);
+  aggregator.Add(3u, "alt3", altimeter);
+
+  // A later reading of a sensor replaces the earlier one
+  altimeter.set_vertical_position(3.0);
+  aggregator.Add(3u, "alt3", altimeter);
+  EXPECT_EQ(2u, aggregator.Count());
+
+  // Readings of another type are dropped
+  aggregator.Add(4u, "mag4", msgs::Magnetometer());
+  EXPECT_EQ(2u, aggregator.Count());
+
+  ASSERT_TRUE(aggregator.Flush(std::chrono::milliseconds(1500), msg));
+  EXPECT_EQ(0u, aggregator.Count());
+  EXPECT_EQ(1, msg.header().stamp().sec());
+  EXPECT_EQ(500000000, msg.header().stamp().nsec());
+  EXPECT_EQ((std::vector<std::string>{"vertical_position",
+      "vertical_velocity", "vertical_reference"}),
+      HeaderValues(msg, "fields"));
+
+  // Rows are ordered by sensor id
+  EXPECT_EQ((std::vector<std::string>{"alt3", "alt7"}),
+      HeaderValues(msg, "sensors"));
+  ASSERT_EQ(6, msg.data_size());
+  EXPECT_DOUBLE_EQ(3.0, msg.data(0));
+  EXPECT_DOUBLE_EQ(-1.0, msg.data(1));
+  EXPECT_DOUBLE_EQ(100.0, msg.data(2));
+  EXPECT_DOUBLE_EQ(5.0, msg.data(3));
+
+  // Each flush only has the readings since the previous one
+  aggregator.Add(7u, "alt7", altimeter);
+  ASSERT_TRUE(aggregator.Flush(std::chrono::seconds(2), msg));
+  EXPECT_EQ((std::vector<std::string>{"alt7"}),
+      HeaderValues(msg, "sensors"));
+  EXPECT_EQ(3, msg.data_size());
+
+  aggregator.Add(7u, "alt7", altimeter);
+  aggregator.Clear();
+  EXPECT_FALSE(aggregator.Flush(std::chrono::seconds(3), msg));
+}
+
+//////////////////////////////////////////////////
+TEST(ReadingAggregator, Threads)
+{
+  ReadingAggregator aggregator;
+  std::vector<std::thread> threads;
+  for (unsigned int t = 0u; t < 4u; ++t)
+  {
+    threads.emplace_back([&aggregator, t]()
+        {
+          msgs::Altimeter altimeter;
+          for (unsigned int i = 0u; i < 100u; ++i)
+          {
+            const SensorId id = 1u + t * 100u + i;
+            altimeter.set_vertical_position(static_cast<double>(id));
+            aggregator.Add(id, std::to_string(id), altimeter);
+          }
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  msgs::Double_V msg;
+  ASSERT_TRUE(aggregator.Flush(std::chrono::seconds(1), msg));
+  ASSERT_EQ(1200, msg.data_size());
+  for (int i = 0; i < 400; ++i)
+    EXPECT_DOUBLE_EQ(1.0 + i, msg.data(i * 3));
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
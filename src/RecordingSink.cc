@@ -0,0 +1,684 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/sensors/RecordingSink.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Filesystem.hh>
+#include <ignition/common/Profiler.hh>
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Magic number at the start of every record, "ISRC"
+static const uint32_t kRecordMagic = 0x43525349u;
+
+/// \brief Records start at multiples of this
+static const uint64_t kRecordAlignment = 8u;
+
+/// \brief Maximum number of spare buffers kept for later records
+static const std::size_t kMaxSpareBuffers = 16u;
+
+/// \brief Header of a record in a segment file
+struct RecordHeader
+{
+  /// \brief kRecordMagic
+  uint32_t magic;
+
+  /// \brief Channel of the message
+  uint32_t channel;
+
+  /// \brief Simulated time of the message, in nanoseconds
+  int64_t simTime;
+
+  /// \brief Number of bytes of the serialized message
+  uint64_t size;
+};
+
+/// \brief Entry of index.bin
+struct IndexRecord
+{
+  /// \brief RecordingEntry::channel
+  uint32_t channel;
+
+  /// \brief RecordingEntry::segment
+  uint32_t segment;
+
+  /// \brief RecordingEntry::simTime, in nanoseconds
+  int64_t simTime;
+
+  /// \brief RecordingEntry::offset
+  uint64_t offset;
+
+  /// \brief RecordingEntry::size
+  uint64_t size;
+};
+
+static_assert(sizeof(RecordHeader) == 24u, "Unexpected record header size");
+static_assert(sizeof(IndexRecord) == 32u, "Unexpected index entry size");
+
+//////////////////////////////////////////////////
+/// \brief Get the path of a segment file.
+/// \param[in] _directory Directory of the recording
+/// \param[in] _segment Index of the segment
+/// \return Path of the segment file
+static std::string SegmentPath(const std::string &_directory,
+    const uint32_t _segment)
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "segment_%05u.bin", _segment);
+  return common::joinPaths(_directory, name);
+}
+
+/// \brief Private data for RecordingSink
+class ignition::sensors::RecordingSinkPrivate
+{
+  /// \brief A message waiting for the writer thread
+  public: struct Item
+  {
+    /// \brief Channel of the message
+    uint32_t channel;
+
+    /// \brief Simulated time of the message
+    std::chrono::steady_clock::duration simTime;
+
+    /// \brief Serialized message
+    std::string data;
+  };
+
+  /// \brief Write queued messages until stopped. Runs on the writer thread.
+  public: void Run();
+
+  /// \brief Append a message to the current segment. Only called by the
+  /// writer thread, or before it starts.
+  /// \param[in] _item The message
+  /// \return False on errors
+  public: bool Write(const Item &_item);
+
+  /// \brief Map a new segment file.
+  /// \param[in] _size Size of the segment
+  /// \return False on errors
+  public: bool OpenSegment(const uint64_t _size);
+
+  /// \brief Unmap the current segment file and truncate it to its content.
+  public: void CloseSegment();
+
+  /// \brief Directory of the recording
+  public: std::string directory;
+
+  /// \brief Size of new segments
+  public: uint64_t segmentBytes = 0u;
+
+  /// \brief Maximum number of queued bytes
+  public: uint64_t queueBytes = 0u;
+
+  /// \brief Messages waiting for the writer thread
+  public: std::deque<Item> queue;
+
+  /// \brief Serialized bytes in queue, and reserved for messages being
+  /// serialized
+  public: uint64_t queuedBytes = 0u;
+
+  /// \brief Buffers of written messages, reused by later messages
+  public: std::vector<std::string> spare;
+
+  /// \brief Channel of each output and message type
+  public: std::map<std::tuple<SensorId, const void *,
+      const google::protobuf::Descriptor *>, uint32_t> channelIds;
+
+  /// \brief Channels, indexed by id
+  public: std::vector<RecordingChannel> channels;
+
+  /// \brief True between Open() and Close()
+  public: bool open = false;
+
+  /// \brief True once the writer thread should exit
+  public: bool stop = false;
+
+  /// \brief True once writing failed, later messages are refused
+  public: bool failed = false;
+
+  /// \brief Protects the members above
+  public: mutable std::mutex mutex;
+
+  /// \brief Signaled when messages are queued or the writer should stop
+  public: std::condition_variable queueCv;
+
+  /// \brief Signaled when queued bytes were written
+  public: std::condition_variable roomCv;
+
+  /// \brief Writer thread
+  public: std::thread writer;
+
+  /// \brief Number of recorded messages
+  public: std::atomic<uint64_t> recordCount{0u};
+
+  /// \brief Number of written message bytes
+  public: std::atomic<uint64_t> writtenBytes{0u};
+
+  /// \brief Index file, only used by the writer thread
+  public: std::ofstream index;
+
+  /// \brief Index of the current segment
+  public: uint32_t segment = 0u;
+
+  /// \brief Descriptor of the current segment file, -1 if none
+  public: int fd = -1;
+
+  /// \brief Mapping of the current segment file
+  public: unsigned char *memory = nullptr;
+
+  /// \brief Size of the current segment file
+  public: uint64_t memorySize = 0u;
+
+  /// \brief Bytes used in the current segment file
+  public: uint64_t used = 0u;
+};
+
+//////////////////////////////////////////////////
+void RecordingSinkPrivate::Run()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true)
+  {
+    this->queueCv.wait(lock, [this]
+        {
+          return this->stop || !this->queue.empty();
+        });
+    if (this->queue.empty())
+      break;
+
+    Item item = std::move(this->queue.front());
+    this->queue.pop_front();
+    bool skip = this->failed;
+    lock.unlock();
+
+    bool written = !skip && this->Write(item);
+
+    lock.lock();
+    if (!skip && !written)
+    {
+      ignerr << "Stopping the recording in [" << this->directory
+             << "] after a write error.\n";
+      this->failed = true;
+    }
+    this->queuedBytes -= item.data.size();
+    if (this->spare.size() < kMaxSpareBuffers)
+      this->spare.push_back(std::move(item.data));
+    this->roomCv.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////
+bool RecordingSinkPrivate::Write(const Item &_item)
+{
+  IGN_PROFILE("RecordingSink::Write");
+  const uint64_t size = _item.data.size();
+  const uint64_t recordSize = (sizeof(RecordHeader) + size +
+      kRecordAlignment - 1u) / kRecordAlignment * kRecordAlignment;
+
+  if (!this->memory || this->used + recordSize > this->memorySize)
+  {
+    // The first segment is mapped by Open(), so segments only run out
+    const bool first = !this->memory;
+    this->CloseSegment();
+    if (!first)
+      ++this->segment;
+    if (!this->OpenSegment(std::max(this->segmentBytes, recordSize)))
+      return false;
+  }
+
+  RecordHeader header;
+  header.magic = kRecordMagic;
+  header.channel = _item.channel;
+  header.simTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _item.simTime).count();
+  header.size = size;
+  std::memcpy(this->memory + this->used, &header, sizeof(header));
+  if (size > 0u)
+  {
+    std::memcpy(this->memory + this->used + sizeof(header),
+        _item.data.data(), size);
+  }
+
+  IndexRecord entry;
+  entry.channel = _item.channel;
+  entry.segment = this->segment;
+  entry.simTime = header.simTime;
+  entry.offset = this->used + sizeof(header);
+  entry.size = size;
+  this->index.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+
+  this->used += recordSize;
+  this->writtenBytes += size;
+  return static_cast<bool>(this->index);
+}
+
+//////////////////////////////////////////////////
+bool RecordingSinkPrivate::OpenSegment(const uint64_t _size)
+{
+  const std::string path = SegmentPath(this->directory, this->segment);
+#ifdef _WIN32
+  ignerr << "Recording is not supported on this platform. Unable to create ["
+         << path << "]\n";
+  return false;
+#else
+  int file = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+  if (file < 0)
+  {
+    ignerr << "Unable to create recording segment [" << path << "]: "
+           << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  if (ftruncate(file, static_cast<off_t>(_size)) != 0)
+  {
+    ignerr << "Unable to allocate [" << _size << "] bytes for recording "
+           << "segment [" << path << "]: " << std::strerror(errno) << "\n";
+    close(file);
+    return false;
+  }
+
+  void *memory = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      file, 0);
+  if (memory == MAP_FAILED)
+  {
+    ignerr << "Unable to map recording segment [" << path << "]: "
+           << std::strerror(errno) << "\n";
+    close(file);
+    return false;
+  }
+
+  this->fd = file;
+  this->memory = static_cast<unsigned char *>(memory);
+  this->memorySize = _size;
+  this->used = 0u;
+  return true;
+#endif
+}
+
+//////////////////////////////////////////////////
+void RecordingSinkPrivate::CloseSegment()
+{
+#ifndef _WIN32
+  if (this->memory)
+    munmap(this->memory, this->memorySize);
+  if (this->fd >= 0)
+  {
+    if (ftruncate(this->fd, static_cast<off_t>(this->used)) != 0)
+    {
+      ignerr << "Unable to truncate recording segment ["
+             << SegmentPath(this->directory, this->segment) << "]: "
+             << std::strerror(errno) << "\n";
+    }
+    close(this->fd);
+  }
+#endif
+  this->fd = -1;
+  this->memory = nullptr;
+  this->memorySize = 0u;
+  this->used = 0u;
+}
+
+//////////////////////////////////////////////////
+RecordingSink::RecordingSink()
+  : dataPtr(new RecordingSinkPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+RecordingSink::~RecordingSink()
+{
+  this->Close();
+}
+
+//////////////////////////////////////////////////
+bool RecordingSink::Open(const std::string &_directory,
+    const uint64_t _segmentBytes, const uint64_t _queueBytes)
+{
+  this->Close();
+
+  if (!common::isDirectory(_directory) &&
+      !common::createDirectories(_directory))
+  {
+    ignerr << "Unable to create recording directory [" << _directory
+           << "].\n";
+    return false;
+  }
+
+  auto &data = *this->dataPtr;
+  data.directory = _directory;
+  data.segmentBytes = std::max<uint64_t>(_segmentBytes, kRecordAlignment);
+  data.queueBytes = std::max<uint64_t>(_queueBytes, 1u);
+  data.queue.clear();
+  data.queuedBytes = 0u;
+  data.channelIds.clear();
+  data.channels.clear();
+  data.stop = false;
+  data.failed = false;
+  data.recordCount = 0u;
+  data.writtenBytes = 0u;
+  data.segment = 0u;
+
+  const std::string indexPath = common::joinPaths(_directory, "index.bin");
+  data.index.open(indexPath, std::ios::binary | std::ios::trunc);
+  if (!data.index)
+  {
+    ignerr << "Unable to create recording index [" << indexPath << "].\n";
+    return false;
+  }
+
+  if (!data.OpenSegment(data.segmentBytes))
+  {
+    data.index.close();
+    return false;
+  }
+
+  data.open = true;
+  data.writer = std::thread(&RecordingSinkPrivate::Run, this->dataPtr.get());
+  return true;
+}
+
+//////////////////////////////////////////////////
+void RecordingSink::Close()
+{
+  auto &data = *this->dataPtr;
+  {
+    std::lock_guard<std::mutex> lock(data.mutex);
+    if (!data.open)
+      return;
+    data.open = false;
+    data.stop = true;
+  }
+  data.queueCv.notify_all();
+  data.roomCv.notify_all();
+  if (data.writer.joinable())
+    data.writer.join();
+
+  data.CloseSegment();
+  data.index.close();
+
+  const std::string channelsPath =
+      common::joinPaths(data.directory, "channels.txt");
+  std::ofstream channels(channelsPath);
+  for (const auto &channel : data.channels)
+  {
+    channels << channel.id << "\t" << channel.sensor << "\t" << channel.type
+             << "\t" << channel.sensorName << "\t" << channel.topic << "\n";
+  }
+  if (!channels)
+  {
+    ignerr << "Unable to write recording channels [" << channelsPath
+           << "].\n";
+  }
+}
+
+//////////////////////////////////////////////////
+bool RecordingSink::IsOpen() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->open;
+}
+
+//////////////////////////////////////////////////
+bool RecordingSink::Record(const Sensor &_sensor, const void *_output,
+    const std::chrono::steady_clock::duration &_simTime,
+    const google::protobuf::Message &_msg, const std::string &_topic)
+{
+  IGN_PROFILE("RecordingSink::Record");
+  auto &data = *this->dataPtr;
+  const uint64_t size = _msg.ByteSizeLong();
+
+  RecordingSinkPrivate::Item item;
+  item.simTime = _simTime;
+  {
+    std::unique_lock<std::mutex> lock(data.mutex);
+
+    // Wait for the writer rather than lose data. A message larger than
+    // the whole queue waits until the queue is empty.
+    data.roomCv.wait(lock, [&]
+        {
+          return !data.open || data.failed || data.queuedBytes == 0u ||
+              data.queuedBytes + size <= data.queueBytes;
+        });
+    if (!data.open || data.failed)
+      return false;
+
+    auto key = std::make_tuple(_sensor.Id(), _output, _msg.GetDescriptor());
+    auto iter = data.channelIds.find(key);
+    if (iter == data.channelIds.end())
+    {
+      RecordingChannel channel;
+      channel.id = static_cast<uint32_t>(data.channels.size());
+      channel.sensor = _sensor.Id();
+      channel.sensorName = _sensor.Name();
+      channel.topic = _topic.empty() ? _sensor.Topic() : _topic;
+      channel.type = _msg.GetDescriptor()->full_name();
+      data.channels.push_back(channel);
+      iter = data.channelIds.insert({key, channel.id}).first;
+    }
+    item.channel = iter->second;
+
+    if (!data.spare.empty())
+    {
+      item.data.swap(data.spare.back());
+      data.spare.pop_back();
+    }
+    data.queuedBytes += size;
+  }
+
+  // Serialize without holding the lock, so that sensors updating on other
+  // threads can record meanwhile
+  item.data.resize(size);
+  _msg.SerializeWithCachedSizesToArray(
+      reinterpret_cast<google::protobuf::uint8 *>(&item.data[0]));
+
+  {
+    std::lock_guard<std::mutex> lock(data.mutex);
+    data.queue.push_back(std::move(item));
+  }
+  data.queueCv.notify_one();
+  ++data.recordCount;
+  return true;
+}
+
+//////////////////////////////////////////////////
+uint64_t RecordingSink::RecordCount() const
+{
+  return this->dataPtr->recordCount;
+}
+
+//////////////////////////////////////////////////
+uint64_t RecordingSink::WrittenBytes() const
+{
+  return this->dataPtr->writtenBytes;
+}
+
+/// \brief Private data for RecordingReader
+class ignition::sensors::RecordingReaderPrivate
+{
+  /// \brief Directory of the recording
+  public: std::string directory;
+
+  /// \brief Channels of the recording
+  public: std::vector<RecordingChannel> channels;
+
+  /// \brief Index of the recording
+  public: std::vector<RecordingEntry> entries;
+
+  /// \brief Segment file of the last read, kept open because consecutive
+  /// messages are mostly in the same segment
+  public: std::ifstream segment;
+
+  /// \brief Index of the segment file that is open
+  public: uint32_t segmentIndex = 0u;
+
+  /// \brief Buffer for the messages read and parsed, reused between reads
+  public: std::string buffer;
+};
+
+//////////////////////////////////////////////////
+RecordingReader::RecordingReader()
+  : dataPtr(new RecordingReaderPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+RecordingReader::~RecordingReader() = default;
+
+//////////////////////////////////////////////////
+bool RecordingReader::Open(const std::string &_directory)
+{
+  auto &data = *this->dataPtr;
+  data.directory = _directory;
+  data.channels.clear();
+  data.entries.clear();
+  data.segment.close();
+
+  const std::string channelsPath =
+      common::joinPaths(_directory, "channels.txt");
+  std::ifstream channels(channelsPath);
+  if (!channels)
+  {
+    ignerr << "Unable to read recording channels [" << channelsPath
+           << "].\n";
+    return false;
+  }
+
+  std::string line;
+  while (std::getline(channels, line))
+  {
+    std::istringstream stream(line);
+    RecordingChannel channel;
+    std::string id;
+    std::string sensor;
+    if (!std::getline(stream, id, '\t') ||
+        !std::getline(stream, sensor, '\t') ||
+        !std::getline(stream, channel.type, '\t') ||
+        !std::getline(stream, channel.sensorName, '\t'))
+    {
+      ignerr << "Invalid line [" << line << "] in recording channels ["
+             << channelsPath << "].\n";
+      return false;
+    }
+    std::getline(stream, channel.topic);
+    channel.id = static_cast<uint32_t>(std::stoul(id));
+    channel.sensor = static_cast<SensorId>(std::stoull(sensor));
+    data.channels.push_back(channel);
+  }
+
+  const std::string indexPath = common::joinPaths(_directory, "index.bin");
+  std::ifstream index(indexPath, std::ios::binary);
+  if (!index)
+  {
+    ignerr << "Unable to read recording index [" << indexPath << "].\n";
+    return false;
+  }
+
+  IndexRecord record;
+  while (index.read(reinterpret_cast<char *>(&record), sizeof(record)))
+  {
+    RecordingEntry entry;
+    entry.channel = record.channel;
+    entry.simTime = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::nanoseconds(record.simTime));
+    entry.segment = record.segment;
+    entry.offset = record.offset;
+    entry.size = record.size;
+    data.entries.push_back(entry);
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+const std::vector<RecordingChannel> &RecordingReader::Channels() const
+{
+  return this->dataPtr->channels;
+}
+
+//////////////////////////////////////////////////
+const std::vector<RecordingEntry> &RecordingReader::Entries() const
+{
+  return this->dataPtr->entries;
+}
+
+//////////////////////////////////////////////////
+bool RecordingReader::Read(const RecordingEntry &_entry,
+    std::string &_data) const
+{
+  auto &data = *this->dataPtr;
+  if (!data.segment.is_open() || data.segmentIndex != _entry.segment)
+  {
+    const std::string path = SegmentPath(data.directory, _entry.segment);
+    data.segment.close();
+    data.segment.clear();
+    data.segment.open(path, std::ios::binary);
+    data.segmentIndex = _entry.segment;
+    if (!data.segment)
+    {
+      ignerr << "Unable to read recording segment [" << path << "].\n";
+      data.segment.close();
+      return false;
+    }
+  }
+
+  _data.resize(_entry.size);
+  data.segment.clear();
+  data.segment.seekg(static_cast<std::streamoff>(_entry.offset));
+  if (_entry.size > 0u)
+    data.segment.read(&_data[0], static_cast<std::streamsize>(_entry.size));
+  if (!data.segment)
+  {
+    ignerr << "Unable to read [" << _entry.size << "] bytes at offset ["
+           << _entry.offset << "] of recording segment ["
+           << SegmentPath(data.directory, _entry.segment) << "].\n";
+    data.segment.close();
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+bool RecordingReader::Read(const RecordingEntry &_entry,
+    google::protobuf::Message &_msg) const
+{
+  std::string &data = this->dataPtr->buffer;
+  return this->Read(_entry, data) && _msg.ParseFromString(data);
+}
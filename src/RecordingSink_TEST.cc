@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Filesystem.hh>
+#include <ignition/msgs/image.pb.h>
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/transport/Node.hh>
+
+#include "ignition/sensors/Manager.hh"
+#include "ignition/sensors/RecordingSink.hh"
+#include "ignition/sensors/Sensor.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Sensor that publishes an image on every update
+class RecordedSensor : public Sensor
+{
+  public: RecordedSensor()
+  {
+    this->SetTopic("/recording_test");
+    this->pub = this->node.Advertise<msgs::Image>(this->Topic());
+  }
+
+  public: bool Update(const std::chrono::steady_clock::duration &_now)
+      override
+  {
+    if (!this->HasConsumers(this->pub))
+      return true;
+
+    this->msg.set_width(++this->updateCount);
+    this->msg.set_data(
+        std::string(64u, static_cast<char>(this->updateCount)));
+    this->StampHeader(this->msg.mutable_header(), _now);
+    return this->PublishShared(this->pub, this->msg,
+        this->msg.mutable_data(), this->msg.mutable_header());
+  }
+
+  public: bool Update(const common::Time &) override
+  {
+    return false;
+  }
+
+  public: transport::Node node;
+
+  public: transport::Node::Publisher pub;
+
+  public: msgs::Image msg;
+
+  public: unsigned int updateCount = 0u;
+};
+
+/// \brief Sensor with a second output on a topic of its own
+class TwoOutputSensor : public RecordedSensor
+{
+  public: TwoOutputSensor()
+  {
+    this->SetOutputTopic(this->Topic(), &this->pub);
+    this->extraPub = this->node.Advertise<msgs::Int32>("/recording_test/extra");
+    this->SetOutputTopic("/recording_test/extra", &this->extraPub);
+  }
+
+  /// \brief Publish a message on the second output
+  /// \param[in] _msg The message
+  /// \return Result of Publish()
+  public: bool PublishExtra(const msgs::Int32 &_msg)
+  {
+    return this->Publish(this->extraPub, _msg);
+  }
+
+  /// \brief Expose SetOutputTopic() to the tests
+  /// \param[in] _topic Topic of the output
+  /// \param[in] _pub Publisher of the output, or null
+  public: void SetOutputTopicForTest(const std::string &_topic,
+              transport::Node::Publisher *_pub)
+  {
+    this->SetOutputTopic(_topic, _pub);
+  }
+
+  public: transport::Node::Publisher extraPub;
+};
+
+/// \brief Collects the messages of a topic
+class Int32Collector
+{
+  /// \brief Constructor
+  /// \param[in] _topic Topic to subscribe to
+  public: explicit Int32Collector(const std::string &_topic)
+  {
+    std::function<void(const msgs::Int32 &)> cb =
+        [this](const msgs::Int32 &_msg)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->received.push_back(_msg.data());
+        };
+    this->subscribed = this->node.Subscribe(_topic, cb);
+  }
+
+  /// \brief Wait until a number of messages arrived, or one second.
+  /// \param[in] _count Number of messages
+  /// \return The messages received so far
+  public: std::vector<int> WaitFor(const std::size_t _count)
+  {
+    for (int sleep = 0; sleep < 100; ++sleep)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->received.size() >= _count)
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->received;
+  }
+
+  public: transport::Node node;
+
+  public: bool subscribed = false;
+
+  public: std::mutex mutex;
+
+  public: std::vector<int> received;
+};
+
+//////////////////////////////////////////////////
+/// \brief Get an empty directory for a test.
+/// \param[in] _name Name of the directory
+/// \return Path of the directory
+std::string TestDirectory(const std::string &_name)
+{
+  std::string path = common::joinPaths(common::cwd(), _name);
+  common::removeAll(path);
+  return path;
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, Segments)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_segments");
+  RecordedSensor sensor;
+  int outputA = 0;
+  int outputB = 0;
+
+  RecordingSink sink;
+  EXPECT_FALSE(sink.IsOpen());
+  msgs::Int32 value;
+  EXPECT_FALSE(sink.Record(sensor, &outputA, std::chrono::seconds(0), value));
+
+  // Small segments and queue, so that records roll over to new segments
+  // and recording waits for the writer
+  ASSERT_TRUE(sink.Open(path, 256u, 64u));
+  EXPECT_TRUE(sink.IsOpen());
+
+  const int count = 100;
+  uint64_t bytes = 0u;
+  for (int i = 0; i < count; ++i)
+  {
+    value.set_data(i);
+    bytes += value.ByteSizeLong();
+    EXPECT_TRUE(sink.Record(sensor, i % 2 ? &outputB : &outputA,
+        std::chrono::milliseconds(i), value));
+  }
+
+  // Larger than a segment
+  msgs::Image image;
+  image.set_data(std::string(1000u, 'x'));
+  bytes += image.ByteSizeLong();
+  EXPECT_TRUE(sink.Record(sensor, &outputA, std::chrono::seconds(1), image));
+  EXPECT_EQ(static_cast<uint64_t>(count + 1), sink.RecordCount());
+
+  sink.Close();
+  EXPECT_FALSE(sink.IsOpen());
+  EXPECT_EQ(bytes, sink.WrittenBytes());
+  EXPECT_FALSE(sink.Record(sensor, &outputA, std::chrono::seconds(2), value));
+
+  RecordingReader reader;
+  ASSERT_TRUE(reader.Open(path));
+
+  // The image got a channel of its own, because its type differs
+  ASSERT_EQ(3u, reader.Channels().size());
+  for (uint32_t i = 0u; i < reader.Channels().size(); ++i)
+  {
+    const RecordingChannel &channel = reader.Channels()[i];
+    EXPECT_EQ(i, channel.id);
+    EXPECT_EQ(sensor.Id(), channel.sensor);
+    EXPECT_EQ(sensor.Name(), channel.sensorName);
+    EXPECT_EQ("/recording_test", channel.topic);
+  }
+  EXPECT_EQ("ignition.msgs.Int32", reader.Channels()[0].type);
+  EXPECT_EQ("ignition.msgs.Int32", reader.Channels()[1].type);
+  EXPECT_EQ("ignition.msgs.Image", reader.Channels()[2].type);
+
+  ASSERT_EQ(static_cast<std::size_t>(count + 1), reader.Entries().size());
+  for (int i = 0; i < count; ++i)
+  {
+    const RecordingEntry &entry = reader.Entries()[i];
+    EXPECT_EQ(static_cast<uint32_t>(i % 2), entry.channel);
+    EXPECT_EQ(std::chrono::steady_clock::duration(
+        std::chrono::milliseconds(i)), entry.simTime);
+    msgs::Int32 read;
+    ASSERT_TRUE(reader.Read(entry, read));
+    EXPECT_EQ(i, read.data());
+  }
+
+  const RecordingEntry &last = reader.Entries().back();
+  EXPECT_EQ(2u, last.channel);
+  EXPECT_GT(last.segment, 0u);
+  EXPECT_GT(last.size, 256u);
+  msgs::Image readImage;
+  ASSERT_TRUE(reader.Read(last, readImage));
+  EXPECT_EQ(image.data(), readImage.data());
+
+  // Records follow each other in the segments
+  std::ifstream segment(common::joinPaths(path, "segment_00000.bin"),
+      std::ios::binary | std::ios::ate);
+  ASSERT_TRUE(segment.good());
+  EXPECT_LE(static_cast<uint64_t>(segment.tellg()), 256u);
+  EXPECT_EQ(24u, reader.Entries()[0].offset);
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, Threads)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_threads");
+  std::vector<std::unique_ptr<RecordedSensor>> sensors;
+  for (int t = 0; t < 4; ++t)
+    sensors.emplace_back(new RecordedSensor());
+
+  RecordingSink sink;
+  ASSERT_TRUE(sink.Open(path, 4096u, 1024u));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t)
+  {
+    threads.emplace_back([&, t]()
+        {
+          msgs::Int32 value;
+          for (int i = 0; i < 500; ++i)
+          {
+            value.set_data(i);
+            sink.Record(*sensors[t], sensors[t].get(),
+                std::chrono::milliseconds(i), value);
+          }
+        });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  sink.Close();
+
+  RecordingReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  ASSERT_EQ(4u, reader.Channels().size());
+  ASSERT_EQ(2000u, reader.Entries().size());
+
+  // Messages of a channel keep their order
+  std::vector<int> next(4u, 0);
+  for (const auto &entry : reader.Entries())
+  {
+    msgs::Int32 value;
+    ASSERT_TRUE(reader.Read(entry, value));
+    EXPECT_EQ(next[entry.channel]++, value.data());
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, Sensor)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_sensor");
+  RecordedSensor sensor;
+  Sensor &base = sensor;
+
+  // Without subscribers, nothing is published
+  base.Update(std::chrono::seconds(1), false);
+  EXPECT_EQ(0u, sensor.updateCount);
+
+  auto sink = std::make_shared<RecordingSink>();
+  ASSERT_TRUE(sink->Open(path));
+  sensor.SetRecordingSink(sink);
+
+  // The sink consumes the data, with the bulk data also when it's
+  // published through shared memory
+  EXPECT_TRUE(base.Update(std::chrono::seconds(2), false));
+  EXPECT_TRUE(sensor.SetSharedMemoryPublishing(true, 2u));
+  EXPECT_TRUE(base.Update(std::chrono::seconds(3), false));
+  EXPECT_EQ(2u, sensor.updateCount);
+
+  sensor.SetRecordingSink(nullptr);
+  EXPECT_TRUE(base.Update(std::chrono::seconds(4), false));
+  EXPECT_EQ(2u, sensor.updateCount);
+  sink->Close();
+
+  RecordingReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  ASSERT_EQ(1u, reader.Channels().size());
+  EXPECT_EQ("ignition.msgs.Image", reader.Channels()[0].type);
+  ASSERT_EQ(2u, reader.Entries().size());
+  for (uint32_t i = 0u; i < 2u; ++i)
+  {
+    const RecordingEntry &entry = reader.Entries()[i];
+    EXPECT_EQ(std::chrono::steady_clock::duration(
+        std::chrono::seconds(i + 2u)), entry.simTime);
+    msgs::Image image;
+    ASSERT_TRUE(reader.Read(entry, image));
+    EXPECT_EQ(i + 1u, image.width());
+    EXPECT_EQ(std::string(64u, static_cast<char>(i + 1u)), image.data());
+    for (const auto &data : image.header().data())
+      EXPECT_NE("shm", data.key());
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, OutputTopics)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_topics");
+  TwoOutputSensor sensor;
+  Sensor &base = sensor;
+
+  auto sink = std::make_shared<RecordingSink>();
+  ASSERT_TRUE(sink->Open(path));
+  sensor.SetRecordingSink(sink);
+  msgs::Int32 value;
+  value.set_data(7);
+  EXPECT_TRUE(base.Update(std::chrono::seconds(1), false));
+  EXPECT_TRUE(sensor.PublishExtra(value));
+  sensor.SetRecordingSink(nullptr);
+  sink->Close();
+
+  // Each output is recorded with its own topic
+  RecordingReader reader;
+  ASSERT_TRUE(reader.Open(path));
+  ASSERT_EQ(2u, reader.Channels().size());
+  EXPECT_EQ("/recording_test", reader.Channels()[0].topic);
+  EXPECT_EQ("ignition.msgs.Image", reader.Channels()[0].type);
+  EXPECT_EQ("/recording_test/extra", reader.Channels()[1].topic);
+  EXPECT_EQ("ignition.msgs.Int32", reader.Channels()[1].type);
+
+  // Replayed messages go out on the output with the topic
+  Int32Collector collector("/recording_test/extra");
+  ASSERT_TRUE(collector.subscribed);
+  EXPECT_TRUE(sensor.ReplayMessage("/recording_test/extra", value));
+  EXPECT_FALSE(sensor.ReplayMessage("/recording_test/unknown", value));
+  EXPECT_EQ(std::vector<int>({7}), collector.WaitFor(1u));
+
+  // Removed outputs are not replayed
+  sensor.SetOutputTopicForTest("/recording_test/extra", nullptr);
+  EXPECT_FALSE(sensor.ReplayMessage("/recording_test/extra", value));
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, ManagerReplay)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_replay");
+  {
+    RecordedSensor sensor;
+    int output = 0;
+    RecordingSink sink;
+    ASSERT_TRUE(sink.Open(path));
+
+    // Recorded out of order, as with asynchronous rendering
+    msgs::Int32 value;
+    for (int i : {1, 2, 4, 3, 5, 6, 7, 8, 9, 10})
+    {
+      value.set_data(i);
+      EXPECT_TRUE(sink.Record(sensor, &output,
+          std::chrono::milliseconds(100 * i), value, "/replay_test"));
+    }
+    sink.Close();
+  }
+
+  Manager mgr;
+  EXPECT_FALSE(mgr.Replaying());
+  EXPECT_FALSE(mgr.SetReplay(common::joinPaths(path, "missing")));
+  EXPECT_FALSE(mgr.Replaying());
+  ASSERT_TRUE(mgr.SetReplay(path));
+  EXPECT_TRUE(mgr.Replaying());
+
+  // Without a sensor of the recorded name, the manager publishes the
+  // messages itself, in the order of their times
+  Int32Collector collector("/replay_test");
+  ASSERT_TRUE(collector.subscribed);
+  mgr.RunOnce(std::chrono::milliseconds(350));
+  EXPECT_EQ(std::vector<int>({1, 2, 3}), collector.WaitFor(3u));
+  mgr.RunOnce(std::chrono::seconds(1));
+  EXPECT_EQ(10u, collector.WaitFor(10u).size());
+
+  // Going back replays from the new time
+  mgr.RunOnce(std::chrono::milliseconds(500));
+  std::vector<int> received = collector.WaitFor(11u);
+  ASSERT_EQ(11u, received.size());
+  EXPECT_EQ(5, received.back());
+
+  EXPECT_TRUE(mgr.SetReplay(""));
+  EXPECT_FALSE(mgr.Replaying());
+  mgr.RunOnce(std::chrono::seconds(2));
+  EXPECT_EQ(11u, collector.WaitFor(12u).size());
+}
+
+//////////////////////////////////////////////////
+TEST(RecordingSink, Errors)
+{
+  const std::string path = TestDirectory("RecordingSink_TEST_errors");
+  {
+    std::ofstream file(path);
+    file << "not a directory";
+  }
+
+  RecordingSink sink;
+  EXPECT_FALSE(sink.Open(path));
+  EXPECT_FALSE(sink.IsOpen());
+
+  RecordingReader reader;
+  EXPECT_FALSE(reader.Open(path));
+  EXPECT_TRUE(reader.Entries().empty());
+  common::removeAll(path);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/pose_v.pb.h>
+#include <ignition/msgs/uint64.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Profiler.hh>
+#include <ignition/msgs/Factory.hh>
+#include <ignition/msgs/Utility.hh>
+#include <ignition/transport/Node.hh>
+#include <ignition/transport/TopicUtils.hh>
+
+#include "RemoteRenderClient.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Wall time after which the oldest request in flight is assumed
+/// lost, for example because the server wasn't discovered yet.
+static const std::chrono::steady_clock::duration kRequestTimeout =
+    std::chrono::seconds(1);
+
+/// \brief Output of a local sensor rendered by the server
+class RemoteOutput
+{
+  /// \brief The local sensor
+  public: Sensor *sensor = nullptr;
+
+  /// \brief Topic of the output on the local sensor
+  public: std::string topic;
+
+  /// \brief Message parsed from the server, reused between messages. Its
+  /// type is known once the first message arrives.
+  public: std::unique_ptr<google::protobuf::Message> msg;
+};
+
+/// \brief Model poses sent with a request that the server didn't
+/// acknowledge yet
+class SentModels
+{
+  /// \brief Frame number of the request
+  public: uint64_t frame = 0u;
+
+  /// \brief Names and poses of the models in the request
+  public: std::vector<std::pair<std::string, math::Pose3d>> models;
+};
+
+/// \brief Private data for RemoteRenderClient
+class ignition::sensors::RemoteRenderClientPrivate
+{
+  /// \brief Publish an output received from the server on its sensor.
+  /// \param[in] _serverTopic Topic the server published on
+  /// \param[in] _data Serialized message
+  /// \param[in] _size Size of the message
+  /// \param[in] _info Information about the message, with its type
+  public: void OnOutput(const std::string &_serverTopic, const char *_data,
+              const size_t _size, const transport::MessageInfo &_info);
+
+  /// \brief Take note of a request the server is done with.
+  /// \param[in] _msg Frame number of the request
+  public: void OnDone(const msgs::UInt64 &_msg);
+
+  /// \brief Name of the render service
+  public: std::string service;
+
+  /// \brief Maximum number of requests in flight
+  public: uint64_t depth = 2u;
+
+  /// \brief Node for the topics of the service
+  public: transport::Node node;
+
+  /// \brief Publisher of the requests
+  public: transport::Node::Publisher requestPub;
+
+  /// \brief Request being built, reused between requests
+  public: msgs::Pose_V request;
+
+  /// \brief Number of requests sent so far, the frame number of the last
+  /// request
+  public: uint64_t sentFrame = 0u;
+
+  /// \brief Frame number of the latest request the server is done with
+  public: std::atomic<uint64_t> doneFrame{0u};
+
+  /// \brief Wall time of the latest request sent while none was in flight,
+  /// or of the latest acknowledgement
+  public: std::atomic<std::chrono::steady_clock::rep> progressTime{0};
+
+  /// \brief True once a lost request was reported
+  public: bool warnedLost = false;
+
+  /// \brief Number of requests that weren't sent
+  public: std::atomic<uint64_t> skippedRequests{0u};
+
+  /// \brief Poses of the models as of the latest request the server
+  /// acknowledged. Models that differ from these are sent with every
+  /// request until one that has them is acknowledged.
+  public: std::unordered_map<std::string, math::Pose3d> ackedModels;
+
+  /// \brief Models sent with the requests in flight, oldest first
+  public: std::deque<SentModels> pendingModels;
+
+  /// \brief Relayed outputs, by topic on the server
+  public: std::map<std::string, RemoteOutput> outputs;
+
+  /// \brief Protects outputs, used by the transport threads
+  public: std::mutex outputsMutex;
+};
+
+//////////////////////////////////////////////////
+std::string ignition::sensors::RemoteRenderRequestTopic(
+    const std::string &_service)
+{
+  return _service + "/request";
+}
+
+//////////////////////////////////////////////////
+std::string ignition::sensors::RemoteRenderDoneTopic(
+    const std::string &_service)
+{
+  return _service + "/done";
+}
+
+//////////////////////////////////////////////////
+std::string ignition::sensors::RemoteRenderOutputTopic(
+    const std::string &_service, const std::string &_topic)
+{
+  if (!_topic.empty() && _topic[0] == '/')
+    return _service + _topic;
+  return _service + "/" + _topic;
+}
+
+//////////////////////////////////////////////////
+RemoteRenderClient::RemoteRenderClient()
+  : dataPtr(new RemoteRenderClientPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+RemoteRenderClient::~RemoteRenderClient()
+{
+  // Stop the transport callbacks before the outputs go away
+  for (const auto &topic : this->dataPtr->node.SubscribedTopics())
+    this->dataPtr->node.Unsubscribe(topic);
+}
+
+//////////////////////////////////////////////////
+bool RemoteRenderClient::Start(const std::string &_service,
+    const unsigned int _depth)
+{
+  auto &data = *this->dataPtr;
+  data.service = transport::TopicUtils::AsValidTopic(_service);
+  data.depth = std::max(_depth, 1u);
+  if (data.service.empty())
+  {
+    ignerr << "Invalid render service [" << _service << "].\n";
+    return false;
+  }
+
+  const std::string requestTopic = RemoteRenderRequestTopic(data.service);
+  data.requestPub = data.node.Advertise<msgs::Pose_V>(requestTopic);
+  if (!data.requestPub)
+  {
+    ignerr << "Unable to create publisher on topic [" << requestTopic
+           << "].\n";
+    return false;
+  }
+
+  const std::string doneTopic = RemoteRenderDoneTopic(data.service);
+  if (!data.node.Subscribe(doneTopic, &RemoteRenderClientPrivate::OnDone,
+        this->dataPtr.get()))
+  {
+    ignerr << "Unable to subscribe to topic [" << doneTopic << "].\n";
+    return false;
+  }
+  return true;
+}
+
+//////////////////////////////////////////////////
+const std::string &RemoteRenderClient::Service() const
+{
+  return this->dataPtr->service;
+}
+
+//////////////////////////////////////////////////
+void RemoteRenderClient::AddSensor(Sensor *_sensor)
+{
+  auto &data = *this->dataPtr;
+  for (const std::string &topic : _sensor->OutputTopics())
+  {
+    const std::string serverTopic =
+        RemoteRenderOutputTopic(data.service, topic);
+    {
+      std::lock_guard<std::mutex> lock(data.outputsMutex);
+      RemoteOutput &output = data.outputs[serverTopic];
+      output.sensor = _sensor;
+      output.topic = topic;
+      output.msg.reset();
+    }
+
+    std::function<void(const char *, const size_t,
+        const transport::MessageInfo &)> cb =
+        [this, serverTopic](const char *_data, const size_t _size,
+            const transport::MessageInfo &_info)
+        {
+          this->dataPtr->OnOutput(serverTopic, _data, _size, _info);
+        };
+    if (!data.node.SubscribeRaw(serverTopic, cb))
+    {
+      ignerr << "Unable to subscribe to topic [" << serverTopic
+             << "] of sensor [" << _sensor->Name() << "].\n";
+    }
+  }
+}
+
+//////////////////////////////////////////////////
+void RemoteRenderClient::RemoveSensor(Sensor *_sensor)
+{
+  auto &data = *this->dataPtr;
+  std::vector<std::string> topics;
+  {
+    std::lock_guard<std::mutex> lock(data.outputsMutex);
+    for (auto iter = data.outputs.begin(); iter != data.outputs.end();)
+    {
+      if (iter->second.sensor == _sensor)
+      {
+        topics.push_back(iter->first);
+        iter = data.outputs.erase(iter);
+      }
+      else
+      {
+        ++iter;
+      }
+    }
+  }
+
+  // Messages still arriving on the topics find no output
+  for (const std::string &topic : topics)
+    data.node.Unsubscribe(topic);
+}
+
+//////////////////////////////////////////////////
+bool RemoteRenderClient::Request(const std::vector<Sensor *> &_sensors,
+    const std::chrono::steady_clock::duration &_time,
+    const std::shared_ptr<const ModelPoseSnapshot> &_models)
+{
+  IGN_PROFILE("RemoteRenderClient::Request");
+  auto &data = *this->dataPtr;
+  const auto now = std::chrono::steady_clock::now();
+  const uint64_t done = data.doneFrame.load();
+  if (data.sentFrame > done && data.sentFrame - done >= data.depth)
+  {
+    const std::chrono::steady_clock::time_point progress(
+        std::chrono::steady_clock::duration(data.progressTime.load()));
+    if (now - progress < kRequestTimeout)
+    {
+      ++data.skippedRequests;
+      return false;
+    }
+
+    // Nothing came back for a while, so the requests in flight are lost
+    if (!data.warnedLost)
+    {
+      ignwarn << "No answer from render service [" << data.service
+              << "], sending requests again.\n";
+      data.warnedLost = true;
+    }
+    // Their models are sent again, as if they were never sent
+    data.pendingModels.clear();
+    data.doneFrame.store(data.sentFrame);
+  }
+
+  // The server has the models of the requests it acknowledged
+  const uint64_t acked = data.doneFrame.load();
+  while (!data.pendingModels.empty() &&
+      data.pendingModels.front().frame <= acked)
+  {
+    for (const auto &model : data.pendingModels.front().models)
+      data.ackedModels[model.first] = model.second;
+    data.pendingModels.pop_front();
+  }
+
+  auto &request = data.request;
+  request.clear_pose();
+  auto header = request.mutable_header();
+  header->mutable_stamp()->CopyFrom(msgs::Convert(_time));
+  header->clear_data();
+  auto frame = header->add_data();
+  frame->set_key("frame");
+  frame->add_value(std::to_string(data.sentFrame + 1u));
+
+  for (Sensor *sensor : _sensors)
+  {
+    auto pose = request.add_pose();
+    pose->set_name(sensor->Name());
+    msgs::Set(pose, sensor->Pose());
+  }
+  auto count = header->add_data();
+  count->set_key("sensors");
+  count->add_value(std::to_string(_sensors.size()));
+
+  // Scene deltas: the models that moved since the latest acknowledged
+  // request, so deltas of lost requests are sent again
+  SentModels sent;
+  sent.frame = data.sentFrame + 1u;
+  if (_models)
+  {
+    for (std::size_t i = 0u; i < _models->Count(); ++i)
+    {
+      const std::string &name = _models->Name(i);
+      const math::Pose3d &modelPose = _models->Pose(i);
+      auto known = data.ackedModels.find(name);
+      if (known != data.ackedModels.end() && known->second == modelPose)
+        continue;
+      sent.models.emplace_back(name, modelPose);
+      auto pose = request.add_pose();
+      pose->set_name(name);
+      msgs::Set(pose, modelPose);
+    }
+  }
+
+  if (!data.requestPub.Publish(request))
+    return false;
+
+  if (!sent.models.empty())
+    data.pendingModels.push_back(std::move(sent));
+
+  if (data.sentFrame == data.doneFrame.load())
+    data.progressTime.store(now.time_since_epoch().count());
+  ++data.sentFrame;
+  return true;
+}
+
+//////////////////////////////////////////////////
+uint64_t RemoteRenderClient::SkippedRequestCount() const
+{
+  return this->dataPtr->skippedRequests;
+}
+
+//////////////////////////////////////////////////
+void RemoteRenderClientPrivate::OnOutput(const std::string &_serverTopic,
+    const char *_data, const size_t _size,
+    const transport::MessageInfo &_info)
+{
+  IGN_PROFILE("RemoteRenderClient::OnOutput");
+  std::lock_guard<std::mutex> lock(this->outputsMutex);
+  auto iter = this->outputs.find(_serverTopic);
+  if (iter == this->outputs.end())
+    return;
+
+  RemoteOutput &output = iter->second;
+  if (!output.msg || output.msg->GetTypeName() != _info.Type())
+  {
+    output.msg = msgs::Factory::New(_info.Type());
+    if (!output.msg)
+    {
+      ignerr << "Unknown message type [" << _info.Type() << "] on topic ["
+             << _serverTopic << "].\n";
+      return;
+    }
+  }
+
+  if (!output.msg->ParseFromArray(_data, static_cast<int>(_size)))
+  {
+    ignerr << "Unable to parse message on topic [" << _serverTopic
+           << "].\n";
+    return;
+  }
+  output.sensor->ReplayMessage(output.topic, *output.msg);
+}
+
+//////////////////////////////////////////////////
+void RemoteRenderClientPrivate::OnDone(const msgs::UInt64 &_msg)
+{
+  uint64_t done = this->doneFrame.load();
+  while (_msg.data() > done &&
+      !this->doneFrame.compare_exchange_weak(done, _msg.data()))
+  {
+  }
+  this->progressTime.store(
+      std::chrono::steady_clock::now().time_since_epoch().count());
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_REMOTERENDERCLIENT_HH_
+#define IGNITION_SENSORS_REMOTERENDERCLIENT_HH_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+#include "ignition/sensors/ModelPoseSnapshot.hh"
+#include "ignition/sensors/Sensor.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class RemoteRenderClientPrivate;
+
+    /// \brief Topic of the render requests of a service. Requests are
+    /// ignition::msgs::Pose_V messages stamped with the simulated time. The
+    /// "frame" header entry numbers the requests, and the "sensors" header
+    /// entry gives the number of leading poses that are sensor poses, named
+    /// after their sensors. The remaining poses are the models that moved
+    /// since the latest request the server acknowledged.
+    /// \param[in] _service Name of the render service
+    /// \return Topic of the requests
+    IGNITION_SENSORS_VISIBLE std::string RemoteRenderRequestTopic(
+        const std::string &_service);
+
+    /// \brief Topic on which a render server acknowledges each request with
+    /// an ignition::msgs::UInt64 holding its frame number.
+    /// \param[in] _service Name of the render service
+    /// \return Topic of the acknowledgements
+    IGNITION_SENSORS_VISIBLE std::string RemoteRenderDoneTopic(
+        const std::string &_service);
+
+    /// \brief Topic on which a render server publishes an output of a
+    /// sensor.
+    /// \param[in] _service Name of the render service
+    /// \param[in] _topic Topic of the output on the simulation side
+    /// \return Topic of the output on the render server
+    IGNITION_SENSORS_VISIBLE std::string RemoteRenderOutputTopic(
+        const std::string &_service, const std::string &_topic);
+
+    /// \brief Simulation side of remote rendering, used by the Manager.
+    /// It streams the poses of the due rendering sensors and the moved
+    /// models to a RenderServer, and publishes the outputs the server sends
+    /// back through the local sensors with Sensor::ReplayMessage(). Up to a
+    /// number of requests are in flight, so rendering overlaps with the
+    /// next simulation steps.
+    class IGNITION_SENSORS_VISIBLE RemoteRenderClient
+    {
+      /// \brief Constructor
+      public: RemoteRenderClient();
+
+      /// \brief Destructor
+      public: ~RemoteRenderClient();
+
+      /// \brief Advertise the requests and subscribe to the acknowledgements
+      /// of a render service.
+      /// \param[in] _service Name of the render service
+      /// \param[in] _depth Maximum number of requests in flight, at least one
+      /// \return False if the topics of the service are invalid.
+      public: bool Start(const std::string &_service,
+                  const unsigned int _depth);
+
+      /// \brief Get the name of the render service.
+      /// \return Name given to Start()
+      public: const std::string &Service() const;
+
+      /// \brief Relay the outputs the server renders for a sensor. Outputs
+      /// the sensor registers later aren't relayed.
+      /// \param[in] _sensor A rendering sensor
+      public: void AddSensor(Sensor *_sensor);
+
+      /// \brief Stop relaying the outputs of a sensor. Once this returns,
+      /// the sensor isn't used anymore.
+      /// \param[in] _sensor A sensor given to AddSensor()
+      public: void RemoveSensor(Sensor *_sensor);
+
+      /// \brief Request the server to render sensors. Does nothing while
+      /// the maximum number of requests are in flight.
+      /// \param[in] _sensors Sensors to render
+      /// \param[in] _time The current simulated time
+      /// \param[in] _models Poses of the models, may be null. Only the
+      /// models that moved since the latest request the server
+      /// acknowledged are sent, so the moves of requests that were lost,
+      /// such as before the server was discovered, are sent again.
+      /// \return False if the request wasn't sent.
+      public: bool Request(const std::vector<Sensor *> &_sensors,
+                  const std::chrono::steady_clock::duration &_time,
+                  const std::shared_ptr<const ModelPoseSnapshot> &_models);
+
+      /// \brief Get the number of requests that weren't sent because too
+      /// many requests were in flight.
+      /// \return Number of skipped requests since Start()
+      public: uint64_t SkippedRequestCount() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<RemoteRenderClientPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
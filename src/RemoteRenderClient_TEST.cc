@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/msgs/pose_v.pb.h>
+#include <ignition/msgs/uint64.pb.h>
+#include <ignition/transport/Node.hh>
+
+#include "ignition/sensors/ModelPoseSnapshot.hh"
+#include "ignition/sensors/Sensor.hh"
+
+#include "RemoteRenderClient.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Rendering sensor that counts its local updates
+class RenderedSensor : public Sensor
+{
+  public: RenderedSensor()
+  {
+    this->SetTopic("/remote_test/camera");
+    this->pub = this->node.Advertise<msgs::Int32>(this->Topic());
+    this->SetOutputTopic(this->Topic(), &this->pub);
+  }
+
+  public: bool Update(const std::chrono::steady_clock::duration &) override
+  {
+    ++this->updateCount;
+    return true;
+  }
+
+  public: bool Update(const common::Time &) override
+  {
+    return false;
+  }
+
+  public: bool IsRenderingSensor() const override
+  {
+    return true;
+  }
+
+  public: transport::Node node;
+
+  public: transport::Node::Publisher pub;
+
+  public: unsigned int updateCount = 0u;
+};
+
+/// \brief Stands in for a RenderServer, collecting the requests
+class FakeServer
+{
+  /// \brief Constructor
+  /// \param[in] _service Name of the render service
+  public: explicit FakeServer(const std::string &_service)
+  {
+    std::function<void(const msgs::Pose_V &)> cb =
+        [this](const msgs::Pose_V &_msg)
+        {
+          std::lock_guard<std::mutex> lock(this->mutex);
+          this->requests.push_back(_msg);
+        };
+    this->subscribed =
+        this->node.Subscribe(RemoteRenderRequestTopic(_service), cb);
+    this->donePub =
+        this->node.Advertise<msgs::UInt64>(RemoteRenderDoneTopic(_service));
+    this->outputPub = this->node.Advertise<msgs::Int32>(
+        RemoteRenderOutputTopic(_service, "/remote_test/camera"));
+  }
+
+  /// \brief Wait until a number of requests arrived, or one second.
+  /// \param[in] _count Number of requests
+  /// \return The requests received so far
+  public: std::vector<msgs::Pose_V> WaitFor(const std::size_t _count)
+  {
+    for (int sleep = 0; sleep < 100; ++sleep)
+    {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        if (this->requests.size() >= _count)
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->requests;
+  }
+
+  public: transport::Node node;
+
+  public: transport::Node::Publisher donePub;
+
+  public: transport::Node::Publisher outputPub;
+
+  public: bool subscribed = false;
+
+  public: std::mutex mutex;
+
+  public: std::vector<msgs::Pose_V> requests;
+};
+
+/// \brief Get a header value of a request.
+/// \param[in] _msg The request
+/// \param[in] _key Key of the value
+/// \return The value, or empty if missing.
+static std::string HeaderValue(const msgs::Pose_V &_msg,
+    const std::string &_key)
+{
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == _key && data.value_size() > 0)
+      return data.value(0);
+  }
+  return "";
+}
+
+//////////////////////////////////////////////////
+TEST(RemoteRenderClient, Topics)
+{
+  EXPECT_EQ("/render/request", RemoteRenderRequestTopic("/render"));
+  EXPECT_EQ("/render/done", RemoteRenderDoneTopic("/render"));
+  EXPECT_EQ("/render/camera/image",
+      RemoteRenderOutputTopic("/render", "/camera/image"));
+  EXPECT_EQ("/render/camera", RemoteRenderOutputTopic("/render", "camera"));
+
+  RemoteRenderClient client;
+  EXPECT_FALSE(client.Start("", 2u));
+}
+
+//////////////////////////////////////////////////
+TEST(RemoteRenderClient, Pipeline)
+{
+  const std::string service = "/remote_test/service";
+  FakeServer server(service);
+  ASSERT_TRUE(server.subscribed);
+
+  RenderedSensor sensor;
+  sensor.SetPose(math::Pose3d(1, 2, 3, 0, 0, 0));
+  RemoteRenderClient client;
+  ASSERT_TRUE(client.Start(service, 2u));
+  EXPECT_EQ(service, client.Service());
+  client.AddSensor(&sensor);
+
+  // Remote sensors keep their schedule without updating locally
+  sensor.SetRemoteRendered(true);
+  EXPECT_TRUE(sensor.RemoteRendered());
+  Sensor &base = sensor;
+  base.Update(std::chrono::seconds(1), false);
+  EXPECT_EQ(0u, sensor.updateCount);
+
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"box", "sphere"});
+  auto models = std::make_shared<const ModelPoseSnapshot>(names,
+      std::vector<math::Pose3d>{math::Pose3d(5, 0, 0, 0, 0, 0),
+      math::Pose3d(0, 5, 0, 0, 0, 0)});
+  auto moved = std::make_shared<const ModelPoseSnapshot>(names,
+      std::vector<math::Pose3d>{math::Pose3d(5, 0, 0, 0, 0, 0),
+      math::Pose3d(0, 6, 0, 0, 0, 0)});
+
+  // The first requests are pipelined, the next one waits for the server
+  const std::vector<Sensor *> sensors{&sensor};
+  EXPECT_TRUE(client.Request(sensors, std::chrono::milliseconds(100),
+      models));
+  EXPECT_TRUE(client.Request(sensors, std::chrono::milliseconds(200),
+      moved));
+  EXPECT_FALSE(client.Request(sensors, std::chrono::milliseconds(300),
+      moved));
+  EXPECT_EQ(1u, client.SkippedRequestCount());
+
+  std::vector<msgs::Pose_V> requests = server.WaitFor(2u);
+  ASSERT_EQ(2u, requests.size());
+  EXPECT_EQ("1", HeaderValue(requests[0], "frame"));
+  EXPECT_EQ("1", HeaderValue(requests[0], "sensors"));
+  EXPECT_EQ(0, requests[0].header().stamp().sec());
+  EXPECT_EQ(100000000, requests[0].header().stamp().nsec());
+  ASSERT_EQ(3, requests[0].pose_size());
+  EXPECT_EQ(sensor.Name(), requests[0].pose(0).name());
+  EXPECT_DOUBLE_EQ(3.0, requests[0].pose(0).position().z());
+  EXPECT_EQ("box", requests[0].pose(1).name());
+  EXPECT_EQ("sphere", requests[0].pose(2).name());
+
+  // Models are sent again until a request with them is acknowledged
+  EXPECT_EQ("2", HeaderValue(requests[1], "frame"));
+  ASSERT_EQ(3, requests[1].pose_size());
+  EXPECT_EQ("box", requests[1].pose(1).name());
+  EXPECT_EQ("sphere", requests[1].pose(2).name());
+  EXPECT_DOUBLE_EQ(6.0, requests[1].pose(2).position().y());
+
+  // Once the server is done with a request, the next one goes out
+  msgs::UInt64 done;
+  done.set_data(1u);
+  EXPECT_TRUE(server.donePub.Publish(done));
+  bool sent = false;
+  for (int sleep = 0; sleep < 100 && !sent; ++sleep)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sent = client.Request(sensors, std::chrono::milliseconds(400), moved);
+  }
+  EXPECT_TRUE(sent);
+  requests = server.WaitFor(3u);
+  ASSERT_EQ(3u, requests.size());
+  EXPECT_EQ("3", HeaderValue(requests[2], "frame"));
+
+  // Only the model that moved since the acknowledged request is sent
+  ASSERT_EQ(2, requests[2].pose_size());
+  EXPECT_EQ("sphere", requests[2].pose(1).name());
+  EXPECT_DOUBLE_EQ(6.0, requests[2].pose(1).position().y());
+
+  // Once that is acknowledged too, models that stay still aren't sent
+  done.set_data(3u);
+  EXPECT_TRUE(server.donePub.Publish(done));
+  sent = false;
+  for (int sleep = 0; sleep < 100 && !sent; ++sleep)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    sent = client.Request(sensors, std::chrono::milliseconds(500), moved);
+  }
+  EXPECT_TRUE(sent);
+  requests = server.WaitFor(4u);
+  ASSERT_EQ(4u, requests.size());
+  EXPECT_EQ("4", HeaderValue(requests[3], "frame"));
+  EXPECT_EQ(1, requests[3].pose_size());
+}
+
+//////////////////////////////////////////////////
+TEST(RemoteRenderClient, LateServer)
+{
+  const std::string service = "/remote_test/late";
+  RenderedSensor sensor;
+  RemoteRenderClient client;
+  ASSERT_TRUE(client.Start(service, 1u));
+
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"box"});
+  auto models = std::make_shared<const ModelPoseSnapshot>(names,
+      std::vector<math::Pose3d>{math::Pose3d(5, 0, 0, 0, 0, 0)});
+
+  // Nobody gets the first request
+  const std::vector<Sensor *> sensors{&sensor};
+  EXPECT_TRUE(client.Request(sensors, std::chrono::milliseconds(100),
+      models));
+
+  // The server starts later. The model didn't move, but the server has
+  // never seen it, so it's in the requests it gets.
+  FakeServer server(service);
+  ASSERT_TRUE(server.subscribed);
+  std::vector<msgs::Pose_V> requests;
+  for (int i = 0; i < 10 && requests.empty(); ++i)
+  {
+    client.Request(sensors, std::chrono::milliseconds(200 + i), models);
+    requests = server.WaitFor(1u);
+  }
+  ASSERT_FALSE(requests.empty());
+  ASSERT_EQ(2, requests[0].pose_size());
+  EXPECT_EQ("box", requests[0].pose(1).name());
+  EXPECT_DOUBLE_EQ(5.0, requests[0].pose(1).position().x());
+}
+
+//////////////////////////////////////////////////
+TEST(RemoteRenderClient, Relay)
+{
+  const std::string service = "/remote_test/relay";
+  FakeServer server(service);
+
+  std::mutex mutex;
+  std::vector<int> received;
+  transport::Node node;
+  std::function<void(const msgs::Int32 &)> cb =
+      [&](const msgs::Int32 &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(_msg.data());
+      };
+  ASSERT_TRUE(node.Subscribe("/remote_test/camera", cb));
+
+  auto waitFor = [&](const std::size_t _count)
+  {
+    for (int sleep = 0; sleep < 100; ++sleep)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (received.size() >= _count)
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+  };
+
+  RenderedSensor sensor;
+  RemoteRenderClient client;
+  ASSERT_TRUE(client.Start(service, 1u));
+  client.AddSensor(&sensor);
+
+  // Outputs of the server come out on the topic of the local sensor
+  msgs::Int32 value;
+  bool relayed = false;
+  for (int i = 0; i < 50 && !relayed; ++i)
+  {
+    value.set_data(7);
+    EXPECT_TRUE(server.outputPub.Publish(value));
+    relayed = !waitFor(1u).empty();
+  }
+  ASSERT_TRUE(relayed);
+  EXPECT_EQ(7, waitFor(1u).front());
+
+  // Removed sensors don't get outputs anymore
+  client.RemoveSensor(&sensor);
+  const std::size_t count = waitFor(1u).size();
+  value.set_data(8);
+  server.outputPub.Publish(value);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_EQ(count, waitFor(count + 1u).size());
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/pose_v.pb.h>
+#include <ignition/msgs/uint64.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/common/Profiler.hh>
+#include <ignition/math/Helpers.hh>
+#include <ignition/msgs/Utility.hh>
+#include <ignition/transport/Node.hh>
+#include <ignition/transport/TopicUtils.hh>
+
+#include "ignition/sensors/RenderServer.hh"
+
+#include "RemoteRenderClient.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for RenderServer
+class ignition::sensors::RenderServerPrivate
+{
+  /// \brief Queue a request received from the simulation node.
+  /// \param[in] _msg The request
+  public: void OnRequest(const msgs::Pose_V &_msg);
+
+  /// \brief Render a request and acknowledge it.
+  /// \param[in] _request The request
+  public: void Render(const msgs::Pose_V &_request);
+
+  /// \brief Manager of the sensors
+  public: Manager *manager = nullptr;
+
+  /// \brief Name of the render service, empty until started
+  public: std::string service;
+
+  /// \brief Node for the topics of the service
+  public: std::unique_ptr<transport::Node> node;
+
+  /// \brief Publisher of the acknowledgements
+  public: transport::Node::Publisher donePub;
+
+  /// \brief Called for each model that moved
+  public: std::function<void(const std::string &, const math::Pose3d &)>
+              sceneCallback;
+
+  /// \brief Ids of the sensors of the server, by name
+  public: std::unordered_map<std::string, SensorId> sensorIds;
+
+  /// \brief Names of requested sensors the server doesn't have, reported
+  /// once each
+  public: std::unordered_set<std::string> unknownSensors;
+
+  /// \brief Requests waiting to be rendered
+  public: std::deque<msgs::Pose_V> requests;
+
+  /// \brief Protects requests, filled by the transport threads
+  public: std::mutex requestsMutex;
+
+  /// \brief Notified when a request is queued
+  public: std::condition_variable requestsCv;
+
+  /// \brief Scratch buffer with the ids of the sensors of a request
+  public: std::vector<SensorId> ids;
+
+  /// \brief Scratch buffer with the poses of the sensors of a request
+  public: std::vector<math::Pose3d> poses;
+
+  /// \brief Acknowledgement, reused between requests
+  public: msgs::UInt64 done;
+
+  /// \brief Number of requests rendered since Start()
+  public: uint64_t renderedCount = 0u;
+};
+
+//////////////////////////////////////////////////
+/// \brief Get a number from the header data of a request.
+/// \param[in] _request The request
+/// \param[in] _key Key of the header data
+/// \return The number, or 0 if the request doesn't have it.
+static uint64_t HeaderNumber(const msgs::Pose_V &_request,
+    const std::string &_key)
+{
+  for (const auto &data : _request.header().data())
+  {
+    if (data.key() == _key && data.value_size() > 0)
+    {
+      try
+      {
+        return std::stoull(data.value(0));
+      }
+      catch (...)
+      {
+        return 0u;
+      }
+    }
+  }
+  return 0u;
+}
+
+//////////////////////////////////////////////////
+RenderServer::RenderServer(Manager &_manager)
+  : dataPtr(new RenderServerPrivate())
+{
+  this->dataPtr->manager = &_manager;
+}
+
+//////////////////////////////////////////////////
+RenderServer::~RenderServer()
+{
+  this->Stop();
+}
+
+//////////////////////////////////////////////////
+bool RenderServer::Start(const std::string &_service)
+{
+  this->Stop();
+
+  auto &data = *this->dataPtr;
+  const std::string service = transport::TopicUtils::AsValidTopic(_service);
+  if (service.empty())
+  {
+    ignerr << "Invalid render service [" << _service << "].\n";
+    return false;
+  }
+
+  std::unique_ptr<transport::Node> node(new transport::Node());
+  const std::string doneTopic = RemoteRenderDoneTopic(service);
+  data.donePub = node->Advertise<msgs::UInt64>(doneTopic);
+  if (!data.donePub)
+  {
+    ignerr << "Unable to create publisher on topic [" << doneTopic
+           << "].\n";
+    return false;
+  }
+
+  const std::string requestTopic = RemoteRenderRequestTopic(service);
+  if (!node->Subscribe(requestTopic, &RenderServerPrivate::OnRequest,
+        this->dataPtr.get()))
+  {
+    ignerr << "Unable to subscribe to topic [" << requestTopic << "].\n";
+    return false;
+  }
+
+  data.node = std::move(node);
+  data.service = service;
+  data.renderedCount = 0u;
+  return true;
+}
+
+//////////////////////////////////////////////////
+void RenderServer::Stop()
+{
+  auto &data = *this->dataPtr;
+
+  // Stop the transport callbacks before dropping the requests
+  data.node.reset();
+  data.donePub = transport::Node::Publisher();
+  data.service.clear();
+
+  std::lock_guard<std::mutex> lock(data.requestsMutex);
+  data.requests.clear();
+}
+
+//////////////////////////////////////////////////
+SensorId RenderServer::CreateSensor(const sdf::Sensor &_sdf)
+{
+  auto &data = *this->dataPtr;
+  if (data.service.empty())
+  {
+    ignerr << "Start the render server before creating sensor ["
+           << _sdf.Name() << "].\n";
+    return NO_SENSOR;
+  }
+
+  std::string topic = _sdf.Topic();
+  if (topic.empty())
+  {
+    // Sensors pick their default topic while loading, so find it out with
+    // a sensor of the same type
+    SensorId probe = data.manager->CreateSensor(_sdf);
+    if (probe == NO_SENSOR)
+      return NO_SENSOR;
+    topic = data.manager->Sensor(probe)->Topic();
+    data.manager->Remove(probe);
+  }
+
+  sdf::Sensor sdf = _sdf;
+  sdf.SetTopic(RemoteRenderOutputTopic(data.service, topic));
+  SensorId id = data.manager->CreateSensor(sdf);
+  if (id == NO_SENSOR)
+    return NO_SENSOR;
+
+  if (!data.manager->Sensor(id)->IsRenderingSensor())
+  {
+    ignwarn << "Sensor [" << _sdf.Name() << "] doesn't render, the "
+            << "simulation node doesn't request it.\n";
+  }
+  data.sensorIds[_sdf.Name()] = id;
+  return id;
+}
+
+//////////////////////////////////////////////////
+void RenderServer::SetSceneCallback(std::function<void(const std::string &,
+    const math::Pose3d &)> _callback)
+{
+  this->dataPtr->sceneCallback = std::move(_callback);
+}
+
+//////////////////////////////////////////////////
+std::size_t RenderServer::ProcessRequests(
+    const std::chrono::steady_clock::duration &_timeout)
+{
+  auto &data = *this->dataPtr;
+  std::deque<msgs::Pose_V> requests;
+  {
+    std::unique_lock<std::mutex> lock(data.requestsMutex);
+    data.requestsCv.wait_for(lock, _timeout,
+        [&data] { return !data.requests.empty(); });
+    requests.swap(data.requests);
+  }
+
+  for (const auto &request : requests)
+    data.Render(request);
+  return requests.size();
+}
+
+//////////////////////////////////////////////////
+uint64_t RenderServer::RenderedRequestCount() const
+{
+  return this->dataPtr->renderedCount;
+}
+
+//////////////////////////////////////////////////
+void RenderServerPrivate::OnRequest(const msgs::Pose_V &_msg)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->requestsMutex);
+    this->requests.push_back(_msg);
+  }
+  this->requestsCv.notify_one();
+}
+
+//////////////////////////////////////////////////
+void RenderServerPrivate::Render(const msgs::Pose_V &_request)
+{
+  IGN_PROFILE("RenderServer::Render");
+  const int sensorCount = static_cast<int>(std::min<uint64_t>(
+      HeaderNumber(_request, "sensors"),
+      static_cast<uint64_t>(_request.pose_size())));
+
+  // The scene first, so the sensors render the models where they are now
+  if (this->sceneCallback)
+  {
+    for (int i = sensorCount; i < _request.pose_size(); ++i)
+    {
+      const auto &pose = _request.pose(i);
+      this->sceneCallback(pose.name(), msgs::Convert(pose));
+    }
+  }
+
+  this->ids.clear();
+  this->poses.clear();
+  for (int i = 0; i < sensorCount; ++i)
+  {
+    const auto &pose = _request.pose(i);
+    auto iter = this->sensorIds.find(pose.name());
+    if (iter == this->sensorIds.end())
+    {
+      if (this->unknownSensors.insert(pose.name()).second)
+      {
+        ignwarn << "Render service [" << this->service
+                << "] has no sensor [" << pose.name() << "].\n";
+      }
+      continue;
+    }
+    this->ids.push_back(iter->second);
+    this->poses.push_back(msgs::Convert(pose));
+  }
+
+  this->manager->SetPoses(this->ids, this->poses);
+  const auto &stamp = _request.header().stamp();
+  this->manager->UpdateSensors(this->ids,
+      math::secNsecToDuration(stamp.sec(), stamp.nsec()));
+  this->manager->WaitForRendering();
+  ++this->renderedCount;
+
+  this->done.set_data(HeaderNumber(_request, "frame"));
+  this->donePub.Publish(this->done);
+}
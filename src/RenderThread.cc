@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "RenderThread.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for RenderThread
+class ignition::sensors::RenderThreadPrivate
+{
+  /// \brief Main loop of the thread
+  public: void Loop();
+
+  /// \brief The thread
+  public: std::thread thread;
+
+  /// \brief Protects the members below
+  public: mutable std::mutex mutex;
+
+  /// \brief Signals the thread that a task was queued
+  public: std::condition_variable taskCv;
+
+  /// \brief Signals waiting callers that a task finished
+  public: std::condition_variable doneCv;
+
+  /// \brief Queued tasks, in order
+  public: std::deque<std::function<void()>> tasks;
+
+  /// \brief True while a task runs
+  public: bool running = false;
+
+  /// \brief Tells the thread to exit once the queue is empty
+  public: bool stop = false;
+};
+
+//////////////////////////////////////////////////
+void RenderThreadPrivate::Loop()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true)
+  {
+    this->taskCv.wait(lock, [&]
+        {
+          return this->stop || !this->tasks.empty();
+        });
+    if (this->tasks.empty())
+      return;
+
+    std::function<void()> task = std::move(this->tasks.front());
+    this->tasks.pop_front();
+    this->running = true;
+    lock.unlock();
+    task();
+    lock.lock();
+    this->running = false;
+    this->doneCv.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////
+RenderThread::RenderThread()
+  : dataPtr(new RenderThreadPrivate)
+{
+  this->dataPtr->thread = std::thread(
+      &RenderThreadPrivate::Loop, this->dataPtr.get());
+}
+
+//////////////////////////////////////////////////
+RenderThread::~RenderThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->stop = true;
+  }
+  this->dataPtr->taskCv.notify_all();
+  this->dataPtr->thread.join();
+}
+
+//////////////////////////////////////////////////
+void RenderThread::Post(std::function<void()> _task)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->tasks.push_back(std::move(_task));
+  }
+  this->dataPtr->taskCv.notify_one();
+}
+
+//////////////////////////////////////////////////
+void RenderThread::Run(const std::function<void()> &_task)
+{
+  if (this->IsCurrentThread())
+  {
+    _task();
+    return;
+  }
+
+  this->Post(_task);
+  this->Wait();
+}
+
+//////////////////////////////////////////////////
+void RenderThread::Wait()
+{
+  if (this->IsCurrentThread())
+    return;
+
+  std::unique_lock<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->doneCv.wait(lock, [&]
+      {
+        return this->dataPtr->tasks.empty() && !this->dataPtr->running;
+      });
+}
+
+//////////////////////////////////////////////////
+bool RenderThread::Busy() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return !this->dataPtr->tasks.empty() || this->dataPtr->running;
+}
+
+//////////////////////////////////////////////////
+bool RenderThread::IsCurrentThread() const
+{
+  return std::this_thread::get_id() == this->dataPtr->thread.get_id();
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RENDERTHREAD_HH_
+#define IGNITION_SENSORS_RENDERTHREAD_HH_
+
+#include <functional>
+#include <memory>
+
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class RenderThreadPrivate;
+
+    /// \brief A single thread that runs queued tasks in order. The Manager
+    /// uses this to render on a thread that owns the rendering context,
+    /// while the caller of RunOnce moves on to the next step.
+    class IGNITION_SENSORS_VISIBLE RenderThread
+    {
+      /// \brief Constructor. Starts the thread.
+      public: RenderThread();
+
+      /// \brief Destructor. Runs the queued tasks, then joins the thread.
+      public: ~RenderThread();
+
+      /// \brief Queue a task and return without waiting for it.
+      /// \param[in] _task Task to run on the thread
+      public: void Post(std::function<void()> _task);
+
+      /// \brief Run a task on the thread, after the queued ones, and wait
+      /// for it. Called from the thread itself, the task runs at once.
+      /// \param[in] _task Task to run on the thread
+      public: void Run(const std::function<void()> &_task);
+
+      /// \brief Wait until all the queued tasks have run. Returns at once
+      /// when called from the thread itself.
+      public: void Wait();
+
+      /// \brief Get whether a task is queued or running.
+      /// \return True if Wait() would block.
+      public: bool Busy() const;
+
+      /// \brief Get whether the calling thread is this thread.
+      /// \return True if called from a task.
+      public: bool IsCurrentThread() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<RenderThreadPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "RenderThread.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+TEST(RenderThread, Order)
+{
+  RenderThread thread;
+  EXPECT_FALSE(thread.IsCurrentThread());
+
+  // Tasks run in order, on the same thread
+  std::vector<int> values;
+  std::vector<std::thread::id> ids;
+  for (int i = 0; i < 100; ++i)
+  {
+    thread.Post([&, i]
+        {
+          values.push_back(i);
+          ids.push_back(std::this_thread::get_id());
+        });
+  }
+  thread.Wait();
+  EXPECT_FALSE(thread.Busy());
+
+  ASSERT_EQ(100u, values.size());
+  for (int i = 0; i < 100; ++i)
+  {
+    EXPECT_EQ(i, values[i]);
+    EXPECT_EQ(ids[0], ids[i]);
+  }
+  EXPECT_NE(std::this_thread::get_id(), ids[0]);
+}
+
+//////////////////////////////////////////////////
+TEST(RenderThread, Run)
+{
+  RenderThread thread;
+  bool current = false;
+  int nested = 0;
+  thread.Run([&]
+      {
+        current = thread.IsCurrentThread();
+
+        // Doesn't deadlock from a task
+        thread.Run([&] { ++nested; });
+        thread.Wait();
+      });
+  EXPECT_TRUE(current);
+  EXPECT_EQ(1, nested);
+}
+
+//////////////////////////////////////////////////
+TEST(RenderThread, Destructor)
+{
+  // Queued tasks still run
+  std::atomic<int> calls{0};
+  {
+    RenderThread thread;
+    for (int i = 0; i < 10; ++i)
+      thread.Post([&] { ++calls; });
+  }
+  EXPECT_EQ(10, calls);
+}
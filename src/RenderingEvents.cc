@@ -15,17 +15,237 @@
  *
 */
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <ignition/common/Profiler.hh>
+
 #include "ignition/sensors/RenderingEvents.hh"
+#include "ignition/sensors/RenderingSensor.hh"
 
 using namespace ignition::sensors;
 
 ignition::common::EventT<void(const ignition::rendering::ScenePtr &)>
 RenderingEvents::sceneEvent;
 
+/// \brief Protects the connections of sceneEvent, which sensors of
+/// different worlds may load on different threads
+static std::mutex sceneEventMutex;
+
+/// \brief All the rendering sensors, for RenderingEvents::SetWorldScene
+static std::vector<RenderingSensor *> renderingSensors;
+
+/// \brief Protects renderingSensors
+static std::mutex renderingSensorsMutex;
+
+/// \brief True to queue scene changes
+static std::atomic<bool> deferSceneChanges{false};
+
+/// \brief Queued scene changes, oldest first, one per sensor at most
+static std::deque<std::pair<RenderingSensor *,
+    ignition::rendering::ScenePtr>> pendingScenes;
+
+/// \brief Maximum number of scenes applied for a frame
+static unsigned int scenesPerFrame = 4u;
+
+/// \brief Frame for which appliedScenes counts the applied scenes
+static uint64_t appliedFrame = 0u;
+
+/// \brief Number of scenes applied for appliedFrame
+static unsigned int appliedScenes = 0u;
+
+/// \brief Protects pendingScenes, scenesPerFrame, appliedFrame and
+/// appliedScenes
+static std::mutex pendingScenesMutex;
+
 /////////////////////////////////////////////////
 ignition::common::ConnectionPtr RenderingEvents::ConnectSceneChangeCallback(
     std::function<void(const ignition::rendering::ScenePtr &)> _callback)
 {
+  std::lock_guard<std::mutex> lock(sceneEventMutex);
   return sceneEvent.Connect(_callback);
 }
 
+/////////////////////////////////////////////////
+void RenderingEvents::SetWorldScene(
+    const ignition::rendering::ScenePtr &_scene, const std::string &_world)
+{
+  if (_world.empty())
+  {
+    sceneEvent(_scene);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(renderingSensorsMutex);
+  for (RenderingSensor *sensor : renderingSensors)
+  {
+    if (sensor->WorldName() != _world)
+      continue;
+
+    if (deferSceneChanges)
+      QueueSceneChange(sensor, _scene);
+    else
+      sensor->SetScene(_scene);
+  }
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::SetDeviceScenes(
+    const std::vector<ignition::rendering::ScenePtr> &_scenes,
+    const std::string &_world)
+{
+  if (_scenes.empty())
+    return;
+
+  std::lock_guard<std::mutex> lock(renderingSensorsMutex);
+  for (RenderingSensor *sensor : renderingSensors)
+  {
+    if (sensor->WorldName() != _world)
+      continue;
+
+    const auto &scene = _scenes[sensor->RenderDevice() % _scenes.size()];
+    if (sensor->Scene() == scene)
+      continue;
+
+    if (deferSceneChanges)
+      QueueSceneChange(sensor, scene);
+    else
+      sensor->SetScene(scene);
+  }
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::SetDeferredSceneChanges(const bool _deferred,
+    const unsigned int _perFrame)
+{
+  {
+    std::lock_guard<std::mutex> lock(pendingScenesMutex);
+    scenesPerFrame = std::max(_perFrame, 1u);
+  }
+  deferSceneChanges = _deferred;
+  if (!_deferred)
+    ProcessSceneChanges(PendingSceneChangeCount());
+}
+
+/////////////////////////////////////////////////
+bool RenderingEvents::DeferredSceneChanges()
+{
+  return deferSceneChanges;
+}
+
+/////////////////////////////////////////////////
+std::size_t RenderingEvents::ProcessSceneChanges(const std::size_t _max)
+{
+  IGN_PROFILE("RenderingEvents::ProcessSceneChanges");
+  std::size_t count = 0u;
+  for (; count < _max; ++count)
+  {
+    std::pair<RenderingSensor *, ignition::rendering::ScenePtr> change;
+    {
+      std::lock_guard<std::mutex> lock(pendingScenesMutex);
+      if (pendingScenes.empty())
+        break;
+      change = std::move(pendingScenes.front());
+      pendingScenes.pop_front();
+      change.first->SetScenePending(false);
+    }
+
+    // Outside of the lock, since creating the cameras takes long and the
+    // sensor may queue another change meanwhile
+    change.first->SetScene(change.second);
+  }
+  return count;
+}
+
+/////////////////////////////////////////////////
+std::size_t RenderingEvents::PendingSceneChangeCount()
+{
+  std::lock_guard<std::mutex> lock(pendingScenesMutex);
+  return pendingScenes.size();
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::QueueSceneChange(RenderingSensor *_sensor,
+    const ignition::rendering::ScenePtr &_scene)
+{
+  std::lock_guard<std::mutex> lock(pendingScenesMutex);
+  _sensor->SetScenePending(true);
+  for (auto &change : pendingScenes)
+  {
+    if (change.first == _sensor)
+    {
+      change.second = _scene;
+      return;
+    }
+  }
+  pendingScenes.emplace_back(_sensor, _scene);
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::ApplySceneChange(RenderingSensor *_sensor,
+    const uint64_t _frameId)
+{
+  ignition::rendering::ScenePtr scene;
+  {
+    std::lock_guard<std::mutex> lock(pendingScenesMutex);
+    if (_frameId != appliedFrame)
+    {
+      appliedFrame = _frameId;
+      appliedScenes = 0u;
+    }
+    if (appliedScenes >= scenesPerFrame)
+      return;
+
+    auto it = std::find_if(pendingScenes.begin(), pendingScenes.end(),
+        [_sensor](const std::pair<RenderingSensor *,
+            ignition::rendering::ScenePtr> &_change)
+        {
+          return _change.first == _sensor;
+        });
+    if (it == pendingScenes.end())
+      return;
+
+    scene = std::move(it->second);
+    pendingScenes.erase(it);
+    _sensor->SetScenePending(false);
+    ++appliedScenes;
+  }
+
+  IGN_PROFILE("RenderingEvents::ApplySceneChange");
+  _sensor->SetScene(scene);
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::AddSensor(RenderingSensor *_sensor)
+{
+  std::lock_guard<std::mutex> lock(renderingSensorsMutex);
+  renderingSensors.push_back(_sensor);
+}
+
+/////////////////////////////////////////////////
+void RenderingEvents::RemoveSensor(RenderingSensor *_sensor)
+{
+  std::lock_guard<std::mutex> lock(renderingSensorsMutex);
+  auto it = std::find(renderingSensors.begin(), renderingSensors.end(),
+      _sensor);
+  if (it != renderingSensors.end())
+  {
+    *it = renderingSensors.back();
+    renderingSensors.pop_back();
+  }
+
+  std::lock_guard<std::mutex> pendingLock(pendingScenesMutex);
+  pendingScenes.erase(std::remove_if(pendingScenes.begin(),
+      pendingScenes.end(),
+      [_sensor](const std::pair<RenderingSensor *,
+          ignition::rendering::ScenePtr> &_change)
+      {
+        return _change.first == _sensor;
+      }), pendingScenes.end());
+}
+
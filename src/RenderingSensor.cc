@@ -15,6 +15,11 @@
  *
 */
 
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
 #include <ignition/common/Profiler.hh>
 
 // TODO(louise) Remove these pragmas once ign-rendering is disabling the
@@ -24,10 +29,12 @@
 #pragma warning(disable: 4251)
 #endif
 #include <ignition/rendering/Camera.hh>
+#include <ignition/rendering/PixelFormat.hh>
 #ifdef _WIN32
 #pragma warning(pop)
 #endif
 
+#include "ignition/sensors/RenderingEvents.hh"
 #include "ignition/sensors/RenderingSensor.hh"
 
 /// \brief Private data class for RenderingSensor
@@ -42,8 +49,32 @@ class ignition::sensors::RenderingSensorPrivate
   /// \brief Pointer to the internal rendering sensors used for generating
   /// sensor data
   public: std::vector<rendering::SensorPtr::weak_type> sensors;
+
+  /// \brief The sensors as cameras, indexed like sensors, resolved once in
+  /// AddSensor() so that Render() doesn't cast them. Null for sensors that
+  /// aren't cameras. Only used while the sensor hasn't expired.
+  public: std::vector<rendering::Camera *> cameras;
+
+  /// \brief True if the scene was already updated through PrepareFrame
+  /// for the next call to Render()
+  public: bool sceneUpdated = false;
+
+  /// \brief True while a scene change is queued in RenderingEvents
+  public: std::atomic<bool> scenePending{false};
+
+  /// \brief Update the scene graph, unless it is updated manually or was
+  /// already updated through PrepareFrame.
+  public: void UpdateScene();
 };
 
+/// \brief Id of the last frame for which each scene was updated through
+/// RenderingSensor::PrepareFrame. Keyed by scene so rendering sensors
+/// sharing a scene update it only once per frame.
+static std::map<ignition::rendering::Scene *, uint64_t> sceneFrames;
+
+/// \brief Protects sceneFrames
+static std::mutex sceneFramesMutex;
+
 using namespace ignition;
 using namespace sensors;
 
@@ -51,17 +82,78 @@ using namespace sensors;
 RenderingSensor::RenderingSensor() :
   dataPtr(new RenderingSensorPrivate)
 {
+  RenderingEvents::AddSensor(this);
 }
 
 //////////////////////////////////////////////////
 RenderingSensor::~RenderingSensor()
 {
+  RenderingEvents::RemoveSensor(this);
+}
+
+/////////////////////////////////////////////////
+bool RenderingSensor::IsRenderingSensor() const
+{
+  return true;
+}
+
+/////////////////////////////////////////////////
+void RenderingSensor::PrepareFrame(const uint64_t _frameId)
+{
+  if (this->dataPtr->scenePending)
+    RenderingEvents::ApplySceneChange(this, _frameId);
+
+  if (this->dataPtr->manualSceneUpdate || !this->dataPtr->scene)
+    return;
+
+  IGN_PROFILE("RenderingSensor::PrepareFrame");
+  {
+    std::lock_guard<std::mutex> lock(sceneFramesMutex);
+    uint64_t &lastFrame = sceneFrames[this->dataPtr->scene.get()];
+    if (lastFrame != _frameId)
+    {
+      this->dataPtr->scene->PreRender();
+      lastFrame = _frameId;
+    }
+  }
+  this->dataPtr->sceneUpdated = true;
 }
 
 /////////////////////////////////////////////////
 void RenderingSensor::SetScene(rendering::ScenePtr _scene)
 {
+  // The sensors belong to the previous scene
+  if (_scene != this->dataPtr->scene)
+  {
+    this->dataPtr->sensors.clear();
+    this->dataPtr->cameras.clear();
+  }
   this->dataPtr->scene = _scene;
+  this->dataPtr->sceneUpdated = false;
+}
+
+/////////////////////////////////////////////////
+void RenderingSensor::OnSceneChange(const rendering::ScenePtr &_scene)
+{
+  if (!this->WorldName().empty())
+    return;
+
+  if (RenderingEvents::DeferredSceneChanges())
+    RenderingEvents::QueueSceneChange(this, _scene);
+  else
+    this->SetScene(_scene);
+}
+
+/////////////////////////////////////////////////
+bool RenderingSensor::Ready() const
+{
+  return !this->dataPtr->scenePending;
+}
+
+/////////////////////////////////////////////////
+void RenderingSensor::SetScenePending(const bool _pending)
+{
+  this->dataPtr->scenePending = _pending;
 }
 
 /////////////////////////////////////////////////
@@ -73,7 +165,19 @@ rendering::ScenePtr RenderingSensor::Scene() const
 /////////////////////////////////////////////////
 void RenderingSensor::AddSensor(rendering::SensorPtr _sensor)
 {
+  if (!_sensor)
+    return;
+
+  // Each sensor is rendered once per frame
+  for (const auto &sensor : this->dataPtr->sensors)
+  {
+    if (sensor.lock() == _sensor)
+      return;
+  }
+
   this->dataPtr->sensors.push_back(_sensor);
+  this->dataPtr->cameras.push_back(
+      std::dynamic_pointer_cast<rendering::Camera>(_sensor).get());
 }
 
 /////////////////////////////////////////////////
@@ -92,24 +196,87 @@ bool RenderingSensor::ManualSceneUpdate() const
 void RenderingSensor::Render()
 {
   IGN_PROFILE("RenderingSensor::Render");
-  // Skip scene update. The user indicated that they will do this manually.
-  // Performance is improved when a global scene update occurs only once per
-  // frame, which can be acheived using a manual scene update.
-  if (!this->dataPtr->manualSceneUpdate)
-    this->dataPtr->scene->PreRender();
+  auto start = std::chrono::steady_clock::now();
+  this->dataPtr->UpdateScene();
 
-  for (auto rs : this->dataPtr->sensors)
+  for (std::size_t i = 0u; i < this->dataPtr->cameras.size(); ++i)
   {
-    auto s = rs.lock();
-    if (!s)
+    rendering::Camera *camera = this->dataPtr->cameras[i];
+    if (!camera || this->dataPtr->sensors[i].expired())
       continue;
-    rendering::CameraPtr rc =
-        std::dynamic_pointer_cast<rendering::Camera>(s);
-    if (rc)
-    {
-      rc->Render();
-      rc->PostRender();
-    }
+    camera->Render();
+    camera->PostRender();
+  }
+  this->RecordPhase(UpdatePhase::RENDER, start);
+}
+
+/////////////////////////////////////////////////
+bool RenderingSensor::WarmUp()
+{
+  if (!this->dataPtr->scene || this->dataPtr->scenePending)
+    return false;
+
+  IGN_PROFILE("RenderingSensor::WarmUp");
+  this->dataPtr->UpdateScene();
+  bool rendered = false;
+  for (std::size_t i = 0u; i < this->dataPtr->cameras.size(); ++i)
+  {
+    rendering::Camera *camera = this->dataPtr->cameras[i];
+    if (!camera || this->dataPtr->sensors[i].expired())
+      continue;
+    camera->Render();
+    camera->PostRender();
+    rendered = true;
+  }
+  return rendered;
+}
+
+/////////////////////////////////////////////////
+void RenderingSensor::RenderCamera(const rendering::CameraPtr &_camera)
+{
+  IGN_PROFILE("RenderingSensor::RenderCamera");
+  auto start = std::chrono::steady_clock::now();
+  this->dataPtr->UpdateScene();
+  if (_camera)
+  {
+    _camera->Render();
+    _camera->PostRender();
   }
+  this->RecordPhase(UpdatePhase::RENDER, start);
+}
+
+/////////////////////////////////////////////////
+void RenderingSensorPrivate::UpdateScene()
+{
+  // Skip scene update. The user indicated that they will do this manually.
+  // Performance is improved when a global scene update occurs only once per
+  // frame, which can be acheived using a manual scene update.
+  // The scene is also skipped if it was already updated for this frame
+  // through PrepareFrame.
+  if (!this->manualSceneUpdate && !this->sceneUpdated)
+    this->scene->PreRender();
+  this->sceneUpdated = false;
 }
 
+//////////////////////////////////////////////////
+unsigned int RenderingSensor::QualityAntiAliasing() const
+{
+  return this->RenderQuality() == RenderQualityProfile::FAST ? 0u : 2u;
+}
+
+//////////////////////////////////////////////////
+double RenderingSensor::QualityResolutionScale() const
+{
+  return this->RenderQuality() == RenderQualityProfile::FAST ? 0.5 : 1.0;
+}
+
+//////////////////////////////////////////////////
+uint64_t RenderingSensor::RenderTargetBytes(
+    const rendering::CameraPtr &_camera)
+{
+  if (!_camera)
+    return 0u;
+  return static_cast<uint64_t>(_camera->ImageWidth()) *
+      _camera->ImageHeight() *
+      rendering::PixelUtil::BytesPerPixel(_camera->ImageFormat());
+}
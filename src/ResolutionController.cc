@@ -0,0 +1,125 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include "ResolutionController.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Weight of a new frame time in the smoothed frame time
+  const double kSmoothing = 0.25;
+
+  /// \brief Fraction of the budget the predicted frame time must stay
+  /// under to scale up
+  const double kHeadroom = 0.8;
+}
+
+//////////////////////////////////////////////////
+void ResolutionController::SetBudget(
+    const std::chrono::steady_clock::duration &_budget)
+{
+  this->budget = std::max(_budget, std::chrono::steady_clock::duration(0));
+  this->Reset();
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration ResolutionController::Budget() const
+{
+  return this->budget;
+}
+
+//////////////////////////////////////////////////
+void ResolutionController::SetMinScale(const double _scale)
+{
+  this->minScale = std::min(1.0, std::max(0.1, _scale));
+  this->scale = std::max(this->scale, this->minScale);
+}
+
+//////////////////////////////////////////////////
+double ResolutionController::MinScale() const
+{
+  return this->minScale;
+}
+
+//////////////////////////////////////////////////
+bool ResolutionController::AddFrameTime(
+    const std::chrono::steady_clock::duration &_time)
+{
+  if (this->budget <= std::chrono::steady_clock::duration::zero())
+    return false;
+
+  const double time = std::chrono::duration<double>(_time).count();
+  if (this->average < 0.0)
+    this->average = time;
+  else
+    this->average += kSmoothing * (time - this->average);
+
+  const double limit = std::chrono::duration<double>(this->budget).count();
+  double newScale = this->scale;
+  if (this->average > limit)
+  {
+    this->underCount = 0u;
+    if (++this->overCount >= kDownFrames && this->scale > this->minScale)
+      newScale = std::max(this->minScale, this->scale * kStep);
+  }
+  else
+  {
+    this->overCount = 0u;
+    const double up = std::min(1.0, this->scale / kStep);
+    const double ratio = up / this->scale;
+    if (up > this->scale &&
+        this->average * ratio * ratio < kHeadroom * limit)
+    {
+      if (++this->underCount >= kUpFrames)
+        newScale = up;
+    }
+    else
+    {
+      this->underCount = 0u;
+    }
+  }
+
+  if (newScale == this->scale)
+    return false;
+
+  // Frame times at the new scale are expected to follow the pixel count
+  const double ratio = newScale / this->scale;
+  this->average *= ratio * ratio;
+  this->scale = newScale;
+  this->overCount = 0u;
+  this->underCount = 0u;
+  return true;
+}
+
+//////////////////////////////////////////////////
+double ResolutionController::Scale() const
+{
+  return this->scale;
+}
+
+//////////////////////////////////////////////////
+void ResolutionController::Reset()
+{
+  this->scale = 1.0;
+  this->average = -1.0;
+  this->overCount = 0u;
+  this->underCount = 0u;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RESOLUTIONCONTROLLER_HH_
+#define IGNITION_SENSORS_RESOLUTIONCONTROLLER_HH_
+
+#include <chrono>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Picks the resolution scale of a rendering sensor from its
+    /// measured frame times, so that frames fit in a time budget. The scale
+    /// goes down one step after a few frames over the budget, and back up
+    /// once the frame time predicted for the larger scale fits comfortably
+    /// for a longer while, which avoids oscillating between two sizes.
+    /// Frame times are assumed to be proportional to the number of pixels.
+    /// Not thread safe.
+    class IGNITION_SENSORS_VISIBLE ResolutionController
+    {
+      /// \brief Set the frame time budget.
+      /// \param[in] _budget Budget of a frame. Zero keeps the scale at 1.
+      public: void SetBudget(
+                  const std::chrono::steady_clock::duration &_budget);
+
+      /// \brief Get the frame time budget.
+      /// \return Budget of a frame.
+      public: std::chrono::steady_clock::duration Budget() const;
+
+      /// \brief Set the smallest scale.
+      /// \param[in] _scale Smallest scale, clamped to [0.1, 1].
+      public: void SetMinScale(const double _scale);
+
+      /// \brief Get the smallest scale.
+      /// \return Smallest scale.
+      public: double MinScale() const;
+
+      /// \brief Add the measured time of a frame rendered at Scale().
+      /// \param[in] _time Render time of the frame.
+      /// \return True if Scale() changed.
+      public: bool AddFrameTime(
+                  const std::chrono::steady_clock::duration &_time);
+
+      /// \brief Get the current scale.
+      /// \return Scale of the resolution, in [MinScale(), 1].
+      public: double Scale() const;
+
+      /// \brief Go back to full resolution and forget measured frame times.
+      public: void Reset();
+
+      /// \brief Number of frames over the budget before scaling down
+      public: static constexpr unsigned int kDownFrames = 3u;
+
+      /// \brief Number of frames with room in the budget before scaling up
+      public: static constexpr unsigned int kUpFrames = 10u;
+
+      /// \brief Factor applied to the scale by each step down
+      public: static constexpr double kStep = 0.75;
+
+      /// \brief Frame time budget
+      private: std::chrono::steady_clock::duration budget{0};
+
+      /// \brief Smallest scale
+      private: double minScale = 0.25;
+
+      /// \brief Current scale
+      private: double scale = 1.0;
+
+      /// \brief Smoothed frame time in seconds, negative before the first
+      /// frame
+      private: double average = -1.0;
+
+      /// \brief Consecutive frames over the budget
+      private: unsigned int overCount = 0u;
+
+      /// \brief Consecutive frames with room to scale up
+      private: unsigned int underCount = 0u;
+    };
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "ResolutionController.hh"
+
+using namespace ignition;
+using namespace sensors;
+using namespace std::chrono_literals;
+
+//////////////////////////////////////////////////
+TEST(ResolutionController, Disabled)
+{
+  ResolutionController controller;
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(), controller.Budget());
+  EXPECT_DOUBLE_EQ(1.0, controller.Scale());
+
+  // Without a budget the scale never changes
+  for (int i = 0; i < 20; ++i)
+    EXPECT_FALSE(controller.AddFrameTime(1s));
+  EXPECT_DOUBLE_EQ(1.0, controller.Scale());
+
+  controller.SetMinScale(0.0);
+  EXPECT_DOUBLE_EQ(0.1, controller.MinScale());
+  controller.SetMinScale(2.0);
+  EXPECT_DOUBLE_EQ(1.0, controller.MinScale());
+}
+
+//////////////////////////////////////////////////
+TEST(ResolutionController, Adapt)
+{
+  ResolutionController controller;
+  controller.SetBudget(10ms);
+  controller.SetMinScale(0.5);
+
+  // Frames within the budget keep full resolution
+  for (int i = 0; i < 20; ++i)
+    EXPECT_FALSE(controller.AddFrameTime(5ms));
+  EXPECT_DOUBLE_EQ(1.0, controller.Scale());
+
+  // A single slow frame doesn't change the scale
+  EXPECT_FALSE(controller.AddFrameTime(40ms));
+  controller.Reset();
+
+  // Frames over the budget scale down after a few frames
+  unsigned int changes = 0u;
+  for (unsigned int i = 0u; i < ResolutionController::kDownFrames; ++i)
+  {
+    if (controller.AddFrameTime(20ms))
+      ++changes;
+  }
+  EXPECT_EQ(1u, changes);
+  EXPECT_DOUBLE_EQ(ResolutionController::kStep, controller.Scale());
+
+  // The scale doesn't go below the minimum
+  for (int i = 0; i < 50; ++i)
+    controller.AddFrameTime(20ms);
+  EXPECT_DOUBLE_EQ(0.5, controller.Scale());
+
+  // Frames that leave room for a larger scale scale back up, slowly
+  for (unsigned int i = 0u; i + 1u < ResolutionController::kUpFrames; ++i)
+    EXPECT_FALSE(controller.AddFrameTime(1ms));
+  EXPECT_DOUBLE_EQ(0.5, controller.Scale());
+  for (int i = 0; i < 100; ++i)
+    controller.AddFrameTime(1ms);
+  EXPECT_DOUBLE_EQ(1.0, controller.Scale());
+
+  // A new budget starts from full resolution
+  controller.AddFrameTime(50ms);
+  controller.SetBudget(20ms);
+  EXPECT_DOUBLE_EQ(1.0, controller.Scale());
+}
+
+//////////////////////////////////////////////////
+TEST(ResolutionController, Steady)
+{
+  // Frame times proportional to the pixel count settle at the largest
+  // scale that fits the budget, without oscillating
+  ResolutionController controller;
+  controller.SetBudget(10ms);
+  const double fullTime = 0.016;
+  unsigned int changes = 0u;
+  for (int i = 0; i < 500; ++i)
+  {
+    const double s = controller.Scale();
+    const auto time = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(fullTime * s * s));
+    if (controller.AddFrameTime(time) && i > 100)
+      ++changes;
+  }
+  EXPECT_EQ(0u, changes);
+  const double s = controller.Scale();
+  EXPECT_LE(fullTime * s * s, 0.010);
+  EXPECT_DOUBLE_EQ(0.75, s);
+}
@@ -15,6 +15,11 @@
  *
 */
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
 #ifdef _WIN32
 #pragma warning(push)
 #pragma warning(disable: 4005)
@@ -52,7 +57,10 @@
 #include "ignition/sensors/RenderingEvents.hh"
 #include "ignition/sensors/SensorFactory.hh"
 
+#include "FrameBuffer.hh"
+#include "PointCloudFilter.hh"
 #include "PointCloudUtil.hh"
+#include "RgbdFill.hh"
 
 /// \brief Private data for RgbdCameraSensor
 class ignition::sensors::RgbdCameraSensorPrivate
@@ -79,8 +87,12 @@ class ignition::sensors::RgbdCameraSensorPrivate
                     unsigned int _channels,
                     const std::string &_format);
 
-  /// \brief node to create publisher
-  public: transport::Node node;
+  /// \brief Connect to or disconnect from the frames of the depth camera.
+  /// The depth camera only reads back and delivers the frames that have a
+  /// listener, and skips its read back entirely when nothing listens.
+  /// \param[in] _depth True to receive depth frames
+  /// \param[in] _cloud True to receive point cloud frames
+  public: void ConnectFrames(const bool _depth, const bool _cloud);
 
   /// \brief publisher to publish images
   public: transport::Node::Publisher imagePub;
@@ -98,10 +110,14 @@ class ignition::sensors::RgbdCameraSensorPrivate
   public: ignition::rendering::DepthCameraPtr depthCamera;
 
   /// \brief Depth data buffer.
-  public: float *depthBuffer = nullptr;
+  public: FrameBuffer<float> depthFrames;
 
   /// \brief Point cloud data buffer.
-  public: float *pointCloudBuffer = nullptr;
+  public: FrameBuffer<float> pointCloudFrames;
+
+  /// \brief Meters per unit of the published integer depths, or 0 to
+  /// publish floating point depths.
+  public: double depthUnit = 0.0;
 
   /// \brief True if a depth far clipping value has been set.
   public: bool hasDepthFarClip = false;
@@ -115,12 +131,9 @@ class ignition::sensors::RgbdCameraSensorPrivate
   /// \brief Depth camera near clipping distance in meters.
   public: double depthNearClip = 0.1;
 
-  /// \brief The number of channels (x, y, z, rgba, ...) in the
-  /// point cloud.
-  public: unsigned int channels = 4;
-
-  /// \brief Pointer to an image to be published
-  public: ignition::rendering::Image image;
+  /// \brief Fills the depth image, point cloud and color image messages
+  /// in a single pass over the frames.
+  public: RgbdFiller filler;
 
   /// \brief Noise added to sensor data
   public: std::map<SensorNoiseType, NoisePtr> noises;
@@ -137,15 +150,35 @@ class ignition::sensors::RgbdCameraSensorPrivate
   /// \brief Just a mutex for thread safety
   public: std::mutex mutex;
 
-  /// \brief SDF Sensor DOM object.
-  public: sdf::Sensor sdfSensor;
-
   /// \brief The point cloud message.
   public: msgs::PointCloudPacked pointMsg;
 
   /// \brief Helper class that can fill a msgs::PointCloudPacked
   /// image and depth data.
   public: PointCloudUtil pointsUtil;
+
+  /// \brief True to only publish the finite points of point clouds
+  public: bool densePoints = false;
+
+  /// \brief Downsamples the point clouds before they are published
+  public: PointCloudFilter pointFilter;
+
+  /// \brief Dense point cloud message, reused across frames
+  public: msgs::PointCloudPacked densePointMsg;
+
+  /// \brief Downsampled point cloud message, reused across frames
+  public: msgs::PointCloudPacked filteredPointMsg;
+
+  /// \brief Encoded point cloud message, reused across frames
+  public: msgs::PointCloudPacked encodedPointMsg;
+
+  /// \brief Depth image message published on every update. It is kept
+  /// between updates so that its memory is reused.
+  public: ignition::msgs::Image depthMsg;
+
+  /// \brief Color image message published on every update. It is kept
+  /// between updates so that its memory is reused.
+  public: ignition::msgs::Image imageMsg;
 };
 
 using namespace ignition;
@@ -162,10 +195,6 @@ RgbdCameraSensor::~RgbdCameraSensor()
 {
   this->dataPtr->depthConnection.reset();
   this->dataPtr->pointCloudConnection.reset();
-  if (this->dataPtr->depthBuffer)
-    delete [] this->dataPtr->depthBuffer;
-  if (this->dataPtr->pointCloudBuffer)
-    delete [] this->dataPtr->pointCloudBuffer;
 }
 
 //////////////////////////////////////////////////
@@ -198,11 +227,25 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
     return false;
   }
 
-  this->dataPtr->sdfSensor = _sdf;
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:depth_unit"))
+    this->SetDepthUnit(elem->Get<double>("ignition:depth_unit"));
+  if (elem && elem->HasElement("ignition:fill_threads"))
+  {
+    this->SetFillThreadCount(
+        elem->Get<unsigned int>("ignition:fill_threads"));
+  }
+  if (elem && elem->HasElement("ignition:dense_point_cloud"))
+  {
+    this->SetDensePointCloud(
+        elem->Get<bool>("ignition:dense_point_cloud"));
+  }
+  this->dataPtr->pointFilter.Load(elem);
+  this->dataPtr->pointsUtil.Load(elem);
 
   // Create the 2d image publisher
   this->dataPtr->imagePub =
-      this->dataPtr->node.Advertise<ignition::msgs::Image>(
+      this->TransportNode().Advertise<ignition::msgs::Image>(
           this->Topic() + "/image");
   if (!this->dataPtr->imagePub)
   {
@@ -210,10 +253,11 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() + "/image" << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic() + "/image", &this->dataPtr->imagePub);
 
   // Create the depth image publisher
   this->dataPtr->depthPub =
-      this->dataPtr->node.Advertise<ignition::msgs::Image>(
+      this->TransportNode().Advertise<ignition::msgs::Image>(
           this->Topic() + "/depth_image");
   if (!this->dataPtr->depthPub)
   {
@@ -221,10 +265,12 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() + "/depth_image" << "].\n";
     return false;
   }
+  this->SetOutputTopic(
+      this->Topic() + "/depth_image", &this->dataPtr->depthPub);
 
   // Create the point cloud publisher
   this->dataPtr->pointPub =
-      this->dataPtr->node.Advertise<ignition::msgs::PointCloudPacked>(
+      this->TransportNode().Advertise<ignition::msgs::PointCloudPacked>(
           this->Topic() + "/points");
   if (!this->dataPtr->pointPub)
   {
@@ -232,6 +278,7 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() + "/points" << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic() + "/points", &this->dataPtr->pointPub);
 
   if (!this->AdvertiseInfo(this->Topic() + "/camera_info"))
     return false;
@@ -252,7 +299,8 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
 
   this->dataPtr->sceneChangeConnection =
       RenderingEvents::ConnectSceneChangeCallback(
-      std::bind(&RgbdCameraSensor::SetScene, this, std::placeholders::_1));
+      std::bind(&RgbdCameraSensor::OnSceneChange, this,
+      std::placeholders::_1));
 
   this->dataPtr->initialized = true;
 
@@ -262,7 +310,7 @@ bool RgbdCameraSensor::Load(const sdf::Sensor &_sdf)
 //////////////////////////////////////////////////
 bool RgbdCameraSensor::CreateCameras()
 {
-  const sdf::Camera *cameraSdf = this->dataPtr->sdfSensor.CameraSensor();
+  const sdf::Camera *cameraSdf = this->SdfSensor().CameraSensor();
 
   if (!cameraSdf)
   {
@@ -297,6 +345,9 @@ bool RgbdCameraSensor::CreateCameras()
       this->dataPtr->depthNearClip = cameraSdf->DepthNearClip();
     }
   }
+  this->dataPtr->filler.SetDepthClip(
+      this->dataPtr->hasDepthNearClip, this->dataPtr->depthNearClip,
+      this->dataPtr->hasDepthFarClip, this->dataPtr->depthFarClip);
 
   this->dataPtr->depthCamera->SetVisibilityMask(cameraSdf->VisibilityMask());
 
@@ -327,7 +378,7 @@ bool RgbdCameraSensor::CreateCameras()
   }
 
   // \todo(nkoeng) these parameters via sdf
-  this->dataPtr->depthCamera->SetAntiAliasing(2);
+  this->dataPtr->depthCamera->SetAntiAliasing(this->QualityAntiAliasing());
 
   math::Angle angle = cameraSdf->HorizontalFov();
   // todo(anyone) verify that rgb pixels align with d for angles >90 degrees.
@@ -350,19 +401,9 @@ bool RgbdCameraSensor::CreateCameras()
 
   this->Scene()->RootVisual()->AddChild(this->dataPtr->depthCamera);
 
-  this->dataPtr->depthConnection =
-      this->dataPtr->depthCamera->ConnectNewDepthFrame(
-        std::bind(&RgbdCameraSensorPrivate::OnNewDepthFrame,
-        this->dataPtr.get(),
-        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
-        std::placeholders::_4, std::placeholders::_5));
-
-  this->dataPtr->pointCloudConnection =
-      this->dataPtr->depthCamera->ConnectNewRgbPointCloud(
-        std::bind(&RgbdCameraSensorPrivate::OnNewRgbPointCloud,
-        this->dataPtr.get(),
-        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
-        std::placeholders::_4, std::placeholders::_5));
+  // The frame connections are made by Update() for the outputs that are
+  // subscribed to.
+  this->dataPtr->ConnectFrames(false, false);
 
   // Set the values of the point message based on the camera information.
   this->dataPtr->pointMsg.set_width(this->ImageWidth());
@@ -395,15 +436,7 @@ void RgbdCameraSensorPrivate::OnNewDepthFrame(const float *_scan,
                     unsigned int /*_channels*/,
                     const std::string &/*_format*/)
 {
-  std::lock_guard<std::mutex> lock(this->mutex);
-
-  unsigned int depthSamples = _width * _height;
-  unsigned int depthBufferSize = depthSamples * sizeof(float);
-
-  if (!this->depthBuffer)
-    this->depthBuffer = new float[depthSamples];
-
-  memcpy(this->depthBuffer, _scan, depthBufferSize);
+  this->depthFrames.Write(_scan, _width, _height);
 }
 
 /////////////////////////////////////////////////
@@ -412,17 +445,36 @@ void RgbdCameraSensorPrivate::OnNewRgbPointCloud(const float *_scan,
                     unsigned int _channels,
                     const std::string &/*_format*/)
 {
-  std::lock_guard<std::mutex> lock(this->mutex);
-
-  unsigned int pointCloudSamples = _width * _height;
-  unsigned int pointCloudBufferSize = pointCloudSamples * _channels *
-      sizeof(float);
-  this->channels = _channels;
+  this->pointCloudFrames.Write(_scan, _width, _height, _channels);
+}
 
-  if (!this->pointCloudBuffer)
-    this->pointCloudBuffer = new float[pointCloudSamples * _channels];
+//////////////////////////////////////////////////
+void RgbdCameraSensorPrivate::ConnectFrames(const bool _depth,
+    const bool _cloud)
+{
+  if (_depth && !this->depthConnection)
+  {
+    this->depthConnection = this->depthCamera->ConnectNewDepthFrame(
+        std::bind(&RgbdCameraSensorPrivate::OnNewDepthFrame, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+        std::placeholders::_4, std::placeholders::_5));
+  }
+  else if (!_depth)
+  {
+    this->depthConnection.reset();
+  }
 
-  memcpy(this->pointCloudBuffer, _scan, pointCloudBufferSize);
+  if (_cloud && !this->pointCloudConnection)
+  {
+    this->pointCloudConnection = this->depthCamera->ConnectNewRgbPointCloud(
+        std::bind(&RgbdCameraSensorPrivate::OnNewRgbPointCloud, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3,
+        std::placeholders::_4, std::placeholders::_5));
+  }
+  else if (!_cloud)
+  {
+    this->pointCloudConnection.reset();
+  }
 }
 
 //////////////////////////////////////////////////
@@ -449,146 +501,148 @@ bool RgbdCameraSensor::Update(const std::chrono::steady_clock::duration &_now)
 
   unsigned int width = this->dataPtr->depthCamera->ImageWidth();
   unsigned int height = this->dataPtr->depthCamera->ImageHeight();
-  unsigned int depthSamples = height * width;
+
+  // Only receive the frames needed by the subscribed outputs. Depth is
+  // also needed to clip the point cloud.
+  const bool pointsSubscribed = this->HasConsumers(this->dataPtr->pointPub);
+  const bool imageSubscribed = this->HasConsumers(this->dataPtr->imagePub);
+  const bool needDepth = this->HasConsumers(this->dataPtr->depthPub) ||
+      (pointsSubscribed &&
+       (this->dataPtr->hasDepthNearClip || this->dataPtr->hasDepthFarClip));
+  const bool needCloud = pointsSubscribed || imageSubscribed;
+  this->dataPtr->ConnectFrames(needDepth, needCloud);
 
   // generate sensor data
   this->Render();
+  this->RecordReadbackBytes(this->dataPtr->depthFrames.TakeWrittenBytes() +
+      this->dataPtr->pointCloudFrames.TakeWrittenBytes());
+
+  // frames that weren't delivered by this render or that have another
+  // resolution can't be combined with this one
+  const float *depthData =
+      needDepth ? this->dataPtr->depthFrames.Acquire() : nullptr;
+  if (this->dataPtr->depthFrames.Width() != width ||
+      this->dataPtr->depthFrames.Height() != height)
+  {
+    depthData = nullptr;
+  }
+  const float *cloudData =
+      needCloud ? this->dataPtr->pointCloudFrames.Acquire() : nullptr;
+  if (this->dataPtr->pointCloudFrames.Width() != width ||
+      this->dataPtr->pointCloudFrames.Height() != height ||
+      this->dataPtr->pointCloudFrames.Channels() < 4u)
+  {
+    cloudData = nullptr;
+  }
+
+  const bool publishDepth =
+      depthData && this->HasConsumers(this->dataPtr->depthPub);
+  const bool publishPoints = cloudData && pointsSubscribed;
+  const bool publishImage = cloudData && imageSubscribed;
 
-  // create and publish the depthmessage
-  if (this->dataPtr->depthPub.HasConnections())
+  if (publishDepth)
   {
-    ignition::msgs::Image msg;
+    ignition::msgs::Image &msg = this->dataPtr->depthMsg;
     msg.set_width(width);
     msg.set_height(height);
+    const bool integerDepth = this->dataPtr->depthUnit > 0.0;
     msg.set_step(width * rendering::PixelUtil::BytesPerPixel(
-               rendering::PF_FLOAT32_R));
-    msg.set_pixel_format_type(msgs::PixelFormatType::R_FLOAT32);
-    *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-    auto frame = msg.mutable_header()->add_data();
-    frame->set_key("frame_id");
-    frame->add_value(this->Name());
-
-    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-
-    // The following code is a work around since ign-rendering's depth camera
-    // does not support 2 different clipping distances. An assumption is made
-    // that the depth clipping distances are within bounds of the rgb clipping
-    // distances, if not, the rgb clipping values will take priority.
-    if (this->dataPtr->hasDepthNearClip || this->dataPtr->hasDepthFarClip)
-    {
-      for (unsigned int i = 0; i < depthSamples; i++)
-      {
-        if (this->dataPtr->hasDepthFarClip &&
-            (this->dataPtr->depthBuffer[i] > this->dataPtr->depthFarClip))
-        {
-          this->dataPtr->depthBuffer[i] = ignition::math::INF_D;
-        }
-        if (this->dataPtr->hasDepthNearClip &&
-            (this->dataPtr->depthBuffer[i] < this->dataPtr->depthNearClip))
-        {
-          this->dataPtr->depthBuffer[i] = -ignition::math::INF_D;
-        }
-      }
-    }
-    msg.set_data(this->dataPtr->depthBuffer,
-        rendering::PixelUtil::MemorySize(rendering::PF_FLOAT32_R,
-        width, height));
+        integerDepth ? rendering::PF_L16 : rendering::PF_FLOAT32_R));
+    msg.set_pixel_format_type(integerDepth ?
+        msgs::PixelFormatType::L_INT16 : msgs::PixelFormatType::R_FLOAT32);
+    this->StampHeader(msg.mutable_header(), _now, "depthImage");
+  }
 
-    // publish
-    {
-      this->AddSequence(msg.mutable_header(), "depthImage");
-      IGN_PROFILE("RgbdCameraSensor::Update Publish depth image");
-      this->dataPtr->depthPub.Publish(msg);
-    }
+  if (publishPoints)
+  {
+    this->StampHeader(this->dataPtr->pointMsg.mutable_header(), _now,
+        "pointMsg");
+    this->dataPtr->pointMsg.set_is_dense(true);
   }
 
-  if (this->dataPtr->pointCloudBuffer)
+  if (publishImage)
   {
-    bool filledImgData = false;
-    if (this->dataPtr->image.Width() != width
-        || this->dataPtr->image.Height() != height)
+    ignition::msgs::Image &msg = this->dataPtr->imageMsg;
+    msg.set_width(width);
+    msg.set_height(height);
+    msg.set_step(width * rendering::PixelUtil::BytesPerPixel(
+        rendering::PF_R8G8B8));
+    msg.set_pixel_format_type(msgs::PixelFormatType::RGB_INT8);
+    this->StampHeader(msg.mutable_header(), _now, "rgbdImage");
+  }
+
+  // fill every subscribed output in one pass over the rendered data
+  msgs::PointCloudPacked *cloud = &this->dataPtr->pointMsg;
+  if (publishDepth || publishPoints || publishImage)
+  {
+    IGN_PROFILE("RgbdCameraSensor::Update Fill messages");
+    auto messageStart = std::chrono::steady_clock::now();
+    this->dataPtr->filler.Fill(depthData, cloudData,
+        this->dataPtr->pointCloudFrames.Channels(), width, height,
+        publishDepth ? &this->dataPtr->depthMsg : nullptr,
+        publishPoints ? &this->dataPtr->pointMsg : nullptr,
+        publishImage ? &this->dataPtr->imageMsg : nullptr);
+
+    // each later stage writes into its own message, so the buffer of every
+    // stage keeps its size across frames
+    if (publishPoints && this->dataPtr->densePoints)
     {
-      this->dataPtr->image =
-          rendering::Image(width, height, rendering::PF_R8G8B8);
+      this->dataPtr->pointsUtil.CompactMsg(*cloud,
+          this->dataPtr->densePointMsg);
+      cloud = &this->dataPtr->densePointMsg;
     }
 
-    // publish point cloud msg
-    if (this->dataPtr->pointPub.HasConnections())
+    // downsample before serializing
+    if (publishPoints && this->dataPtr->pointFilter.Enabled())
     {
-      *this->dataPtr->pointMsg.mutable_header()->mutable_stamp() =
-        msgs::Convert(_now);
-      // Set the time stamp
-      this->dataPtr->pointMsg.set_is_dense(true);
-
-      if ((this->dataPtr->hasDepthNearClip || this->dataPtr->hasDepthFarClip)
-          && this->dataPtr->depthBuffer)
-      {
-        for (unsigned int i = 0; i < depthSamples; i++)
-        {
-          float depthValue = this->dataPtr->depthBuffer[i];
-          if (std::isinf(depthValue))
-          {
-            unsigned int index = i * this->dataPtr->channels;
-
-            this->dataPtr->pointCloudBuffer[index] = depthValue;
-            this->dataPtr->pointCloudBuffer[index + 1] = depthValue;
-            this->dataPtr->pointCloudBuffer[index + 2] = depthValue;
-          }
-        }
-      }
-
-      {
-        IGN_PROFILE("RgbdCameraSensor::Update Fill Point Cloud");
-        // fill point cloud msg and image data
-        this->dataPtr->pointsUtil.FillMsg(this->dataPtr->pointMsg,
-            this->dataPtr->pointCloudBuffer, true,
-            this->dataPtr->image.Data<unsigned char>());
-        filledImgData = true;
-      }
-
-      // publish
-      {
-        this->AddSequence(this->dataPtr->pointMsg.mutable_header(), "pointMsg");
-        IGN_PROFILE("RgbdCameraSensor::Update Publish point cloud");
-        this->dataPtr->pointPub.Publish(this->dataPtr->pointMsg);
-      }
+      this->dataPtr->pointFilter.Apply(*cloud,
+          this->dataPtr->filteredPointMsg);
+      cloud = &this->dataPtr->filteredPointMsg;
     }
 
-    // publish the 2d image message
-    if (this->dataPtr->imagePub.HasConnections())
+    // encode with a reduced precision or compression, if requested
+    if (publishPoints && this->dataPtr->pointsUtil.Encoded() &&
+        this->dataPtr->pointsUtil.EncodeMsg(*cloud,
+        this->dataPtr->encodedPointMsg))
     {
-      if (!filledImgData)
-      {
-        IGN_PROFILE("RgbdCameraSensor::Update Fill RGB Image");
-        // extract image data from point cloud data
-        this->dataPtr->pointsUtil.RGBFromPointCloud(
-            this->dataPtr->image.Data<unsigned char>(),
-            this->dataPtr->pointCloudBuffer,
-            width, height);
-      }
-
-      unsigned char *data = this->dataPtr->image.Data<unsigned char>();
-
-      ignition::msgs::Image msg;
-      msg.set_width(width);
-      msg.set_height(height);
-      msg.set_step(width * rendering::PixelUtil::BytesPerPixel(
-          rendering::PF_R8G8B8));
-      msg.set_pixel_format_type(msgs::PixelFormatType::RGB_INT8);
-      *msg.mutable_header()->mutable_stamp() = msgs::Convert(_now);
-      auto frame = msg.mutable_header()->add_data();
-      frame->set_key("frame_id");
-      frame->add_value(this->Name());
-      msg.set_data(data, rendering::PixelUtil::MemorySize(rendering::PF_R8G8B8,
-        width, height));
-
-      // publish the image message
-      {
-        this->AddSequence(msg.mutable_header(), "rgbdImage");
-        IGN_PROFILE("RgbdCameraSensor::Update Publish RGB image");
-        this->dataPtr->imagePub.Publish(msg);
-      }
+      cloud = &this->dataPtr->encodedPointMsg;
     }
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+  }
+
+  // publish the depth image message
+  if (publishDepth)
+  {
+    IGN_PROFILE("RgbdCameraSensor::Update Publish depth image");
+    ignition::msgs::Image &msg = this->dataPtr->depthMsg;
+    auto publishStart = std::chrono::steady_clock::now();
+    this->PublishShared(this->dataPtr->depthPub, msg, msg.mutable_data(),
+        msg.mutable_header(), "depthImage");
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
+  }
+
+  // publish the point cloud message
+  if (publishPoints)
+  {
+    IGN_PROFILE("RgbdCameraSensor::Update Publish point cloud");
+    auto publishStart = std::chrono::steady_clock::now();
+    this->PublishShared(this->dataPtr->pointPub, *cloud,
+        cloud->mutable_data(), cloud->mutable_header(), "pointMsg");
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(cloud->ByteSizeLong());
+  }
+
+  // publish the 2d image message
+  if (publishImage)
+  {
+    IGN_PROFILE("RgbdCameraSensor::Update Publish RGB image");
+    ignition::msgs::Image &msg = this->dataPtr->imageMsg;
+    auto publishStart = std::chrono::steady_clock::now();
+    this->PublishShared(this->dataPtr->imagePub, msg,
+        msg.mutable_data(), msg.mutable_header(), "rgbdImage");
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
   }
 
   // publish the camera info message
@@ -609,4 +663,133 @@ unsigned int RgbdCameraSensor::ImageHeight() const
   return this->dataPtr->depthCamera->ImageHeight();
 }
 
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::HasConnections() const
+{
+  return
+      this->HasConsumers(this->dataPtr->imagePub) ||
+      this->HasConsumers(this->dataPtr->depthPub) ||
+      this->HasConsumers(this->dataPtr->pointPub);
+}
+
+//////////////////////////////////////////////////
+SensorMemory RgbdCameraSensor::MemoryUsage() const
+{
+  SensorMemory memory = CameraSensor::MemoryUsage();
+  memory.renderTargetBytes += RenderTargetBytes(this->dataPtr->depthCamera);
+  memory.readbackBytes += this->dataPtr->depthFrames.MemoryBytes() +
+      this->dataPtr->pointCloudFrames.MemoryBytes();
+  memory.messageBytes += this->dataPtr->depthMsg.SpaceUsedLong() +
+      this->dataPtr->imageMsg.SpaceUsedLong() +
+      this->dataPtr->pointMsg.SpaceUsedLong() +
+      this->dataPtr->densePointMsg.SpaceUsedLong() +
+      this->dataPtr->filteredPointMsg.SpaceUsedLong() +
+      this->dataPtr->encodedPointMsg.SpaceUsedLong();
+  return memory;
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::SupportsStagedUpdates() const
+{
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::SupportsCompressedOutput() const
+{
+  return false;
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::SupportsImageStreams() const
+{
+  return false;
+}
+
 IGN_SENSORS_REGISTER_SENSOR(RgbdCameraSensor)
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetDepthUnit(const double _unit)
+{
+  this->dataPtr->depthUnit =
+      std::isfinite(_unit) ? std::max(0.0, _unit) : 0.0;
+  this->dataPtr->filler.SetDepthUnit(this->dataPtr->depthUnit);
+}
+
+//////////////////////////////////////////////////
+double RgbdCameraSensor::DepthUnit() const
+{
+  return this->dataPtr->depthUnit;
+}
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetDensePointCloud(const bool _dense)
+{
+  this->dataPtr->densePoints = _dense;
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::DensePointCloud() const
+{
+  return this->dataPtr->densePoints;
+}
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetPointCloudStride(const unsigned int _stride)
+{
+  this->dataPtr->pointFilter.SetStride(_stride);
+}
+
+//////////////////////////////////////////////////
+unsigned int RgbdCameraSensor::PointCloudStride() const
+{
+  return this->dataPtr->pointFilter.Stride();
+}
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetVoxelLeafSize(const double _leafSize)
+{
+  this->dataPtr->pointFilter.SetLeafSize(_leafSize);
+}
+
+//////////////////////////////////////////////////
+double RgbdCameraSensor::VoxelLeafSize() const
+{
+  return this->dataPtr->pointFilter.LeafSize();
+}
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetPointCloudResolution(const double _resolution)
+{
+  this->dataPtr->pointsUtil.SetResolution(_resolution);
+}
+
+//////////////////////////////////////////////////
+double RgbdCameraSensor::PointCloudResolution() const
+{
+  return this->dataPtr->pointsUtil.Resolution();
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::SetPointCloudCompression(const bool _compress)
+{
+  return this->dataPtr->pointsUtil.SetCompression(_compress);
+}
+
+//////////////////////////////////////////////////
+bool RgbdCameraSensor::PointCloudCompression() const
+{
+  return this->dataPtr->pointsUtil.Compression();
+}
+
+//////////////////////////////////////////////////
+void RgbdCameraSensor::SetFillThreadCount(const unsigned int _count)
+{
+  this->dataPtr->filler.SetThreadCount(_count);
+}
+
+//////////////////////////////////////////////////
+unsigned int RgbdCameraSensor::FillThreadCount() const
+{
+  return this->dataPtr->filler.ThreadCount();
+}
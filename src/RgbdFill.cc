@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <ignition/math/Helpers.hh>
+
+#include "ImageNormalize.hh"
+#include "PointCloudUtil.hh"
+#include "RgbdFill.hh"
+#include "WorkerPool.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Private data for RgbdFiller
+class ignition::sensors::RgbdFillerPrivate
+{
+  /// \brief Number of threads, including the calling thread
+  public: unsigned int threadCount = 1u;
+
+  /// \brief Threads filling large images, created on the first fill
+  /// that needs them.
+  public: std::unique_ptr<WorkerPool> pool;
+
+  /// \brief Meters per unit of the integer depths, or 0 for float depths.
+  public: float depthUnit = 0.0f;
+
+  /// \brief True if a depth far clipping value has been set.
+  public: bool hasDepthFarClip = false;
+
+  /// \brief True if a depth near clipping value has been set.
+  public: bool hasDepthNearClip = false;
+
+  /// \brief Depth far clipping distance in meters.
+  public: double depthFarClip = 10.0;
+
+  /// \brief Depth near clipping distance in meters.
+  public: double depthNearClip = 0.1;
+};
+
+//////////////////////////////////////////////////
+RgbdFiller::RgbdFiller()
+  : dataPtr(new RgbdFillerPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+RgbdFiller::~RgbdFiller()
+{
+}
+
+//////////////////////////////////////////////////
+void RgbdFiller::SetThreadCount(const unsigned int _count)
+{
+  this->dataPtr->threadCount = _count > 0u ? _count :
+      std::max(1u, std::thread::hardware_concurrency());
+}
+
+//////////////////////////////////////////////////
+unsigned int RgbdFiller::ThreadCount() const
+{
+  return this->dataPtr->threadCount;
+}
+
+//////////////////////////////////////////////////
+void RgbdFiller::SetDepthClip(const bool _hasNear, const double _near,
+    const bool _hasFar, const double _far)
+{
+  this->dataPtr->hasDepthNearClip = _hasNear;
+  this->dataPtr->depthNearClip = _near;
+  this->dataPtr->hasDepthFarClip = _hasFar;
+  this->dataPtr->depthFarClip = _far;
+}
+
+//////////////////////////////////////////////////
+void RgbdFiller::SetDepthUnit(const double _unit)
+{
+  this->dataPtr->depthUnit = static_cast<float>(_unit);
+}
+
+//////////////////////////////////////////////////
+void RgbdFiller::Fill(const float *_depthData, const float *_cloudData,
+    const unsigned int _channels, const unsigned int _width,
+    const unsigned int _height, msgs::Image *_depthMsg,
+    msgs::PointCloudPacked *_pointMsg, msgs::Image *_imageMsg)
+{
+  const std::size_t count = static_cast<std::size_t>(_width) * _height;
+  const RgbdFillerPrivate &d = *this->dataPtr;
+
+  // Depths are written as floats, or as integers with a depth unit
+  const float depthUnit = d.depthUnit;
+  char *depthOut = nullptr;
+  uint16_t *unitsOut = nullptr;
+  if (_depthMsg && _depthData)
+  {
+    std::string *data = _depthMsg->mutable_data();
+    if (depthUnit > 0.0f)
+    {
+      data->resize(count * sizeof(uint16_t));
+      unitsOut = reinterpret_cast<uint16_t *>(&(*data)[0]);
+    }
+    else
+    {
+      data->resize(count * sizeof(float));
+      depthOut = &(*data)[0];
+    }
+  }
+
+  PointCloudLayout layout;
+  char *pointsOut = nullptr;
+  if (_pointMsg && _cloudData && _channels >= 4u && layout.Load(*_pointMsg))
+  {
+    std::string *data = _pointMsg->mutable_data();
+    data->resize(_pointMsg->row_step() * _pointMsg->height());
+    if (data->size() >= count * layout.step)
+      pointsOut = &(*data)[0];
+  }
+
+  unsigned char *imageOut = nullptr;
+  if (_imageMsg && _cloudData && _channels >= 4u)
+  {
+    std::string *data = _imageMsg->mutable_data();
+    data->resize(count * 3u);
+    imageOut = reinterpret_cast<unsigned char *>(&(*data)[0]);
+  }
+
+  if (!depthOut && !unitsOut && !pointsOut && !imageOut)
+    return;
+
+  // The following code is a work around since ign-rendering's depth camera
+  // does not support 2 different clipping distances. An assumption is made
+  // that the depth clipping distances are within bounds of the rgb clipping
+  // distances, if not, the rgb clipping values will take priority.
+  const bool clip = _depthData && (d.hasDepthNearClip || d.hasDepthFarClip);
+  const bool colors = pointsOut || imageOut;
+
+  auto fillRows = [&](const std::size_t _first, const std::size_t _last)
+  {
+    if (unitsOut)
+    {
+      ImageNormalizer::DepthToUnits(_depthData + _first, _last - _first,
+          depthUnit, unitsOut + _first);
+    }
+
+    unsigned char scratch[3];
+    for (std::size_t i = _first; i < _last; ++i)
+    {
+      float depth = 0.0f;
+      if (_depthData)
+      {
+        depth = _depthData[i];
+        if (d.hasDepthFarClip && depth > d.depthFarClip)
+          depth = ignition::math::INF_F;
+        else if (d.hasDepthNearClip && depth < d.depthNearClip)
+          depth = -ignition::math::INF_F;
+
+        if (depthOut)
+          std::memcpy(depthOut + i * sizeof(float), &depth, sizeof(float));
+        else if (unitsOut && std::isinf(depth))
+          unitsOut[i] = 0u;
+      }
+
+      if (!colors)
+        continue;
+
+      const float *src = _cloudData + i * _channels;
+      unsigned char *color = imageOut ? imageOut + i * 3u : scratch;
+      PointCloudLayout::DecodeRgb(src[3], color);
+
+      if (pointsOut)
+      {
+        char *point = pointsOut + i * layout.step;
+        if (clip && std::isinf(depth))
+        {
+          const float xyz[3] = {depth, depth, depth};
+          layout.WriteXyz(point, xyz);
+        }
+        else
+        {
+          layout.WriteXyz(point, src);
+        }
+        layout.WriteRgb(point, color);
+      }
+    }
+  };
+
+  // Split large images in bands of rows so that each thread walks its own
+  // contiguous part of every buffer.
+  const std::size_t kParallelPixels = 512u * 512u;
+  if (d.threadCount < 2u || count < kParallelPixels || _height < 2u)
+  {
+    fillRows(0u, count);
+    return;
+  }
+
+  if (!this->dataPtr->pool ||
+      this->dataPtr->pool->ThreadCount() != d.threadCount)
+  {
+    this->dataPtr->pool.reset(new WorkerPool(d.threadCount));
+  }
+
+  const std::size_t bands = std::min<std::size_t>(d.threadCount, _height);
+  const std::size_t bandRows = (_height + bands - 1u) / bands;
+  this->dataPtr->pool->ParallelFor(bands, [&](std::size_t _band)
+  {
+    const std::size_t first = _band * bandRows * _width;
+    const std::size_t last = std::min(first + bandRows * _width, count);
+    if (first < last)
+      fillRows(first, last);
+  });
+}
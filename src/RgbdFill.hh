@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_RGBDFILL_HH_
+#define IGNITION_SENSORS_RGBDFILL_HH_
+
+#include <memory>
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/image.pb.h>
+#include <ignition/msgs/pointcloud_packed.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class RgbdFillerPrivate;
+
+    /// \brief Fills the depth image, point cloud and color image messages
+    /// of an RGBD camera in a single pass over its depth and point cloud
+    /// frames, applying the depth clipping distances to both the depth
+    /// image and the point cloud. The RgbdCameraSensor uses this. Large
+    /// images can be split in bands of rows filled in parallel.
+    class IGNITION_SENSORS_VISIBLE RgbdFiller
+    {
+      /// \brief Constructor
+      public: RgbdFiller();
+
+      /// \brief Destructor
+      public: ~RgbdFiller();
+
+      /// \brief Set the number of threads used for large images.
+      /// \param[in] _count Number of threads, including the calling
+      /// thread. 0 uses one thread per core, and 1, the default, fills all
+      /// images on the calling thread.
+      public: void SetThreadCount(const unsigned int _count);
+
+      /// \brief Get the number of threads used for large images.
+      /// \return Number of threads, including the calling thread.
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Set the depth clipping distances. Depths beyond the far
+      /// distance become +infinity and depths closer than the near
+      /// distance become -infinity, as do all coordinates of their points.
+      /// \param[in] _hasNear True to clip near depths.
+      /// \param[in] _near Near clipping distance in meters.
+      /// \param[in] _hasFar True to clip far depths.
+      /// \param[in] _far Far clipping distance in meters.
+      public: void SetDepthClip(const bool _hasNear, const double _near,
+                  const bool _hasFar, const double _far);
+
+      /// \brief Set the unit of the integer depths, see
+      /// RgbdCameraSensor::SetDepthUnit().
+      /// \param[in] _unit Meters per unit, or 0 to fill float depths.
+      public: void SetDepthUnit(const double _unit);
+
+      /// \brief Fill the data of the messages. Their other fields, and the
+      /// point cloud fields and size, must be set by the caller.
+      /// \param[in] _depthData Depth frame, or nullptr if there is none.
+      /// \param[in] _cloudData Point cloud frame, or nullptr if there is
+      /// none. The first 4 values of each point are x, y, z and the color
+      /// packed by the rendering engine.
+      /// \param[in] _channels Number of values of each point.
+      /// \param[in] _width Width of the frames.
+      /// \param[in] _height Height of the frames.
+      /// \param[out] _depthMsg Depth image, or nullptr to skip it.
+      /// \param[out] _pointMsg Point cloud, or nullptr to skip it.
+      /// \param[out] _imageMsg Color image, or nullptr to skip it.
+      public: void Fill(const float *_depthData, const float *_cloudData,
+                  const unsigned int _channels, const unsigned int _width,
+                  const unsigned int _height, msgs::Image *_depthMsg,
+                  msgs::PointCloudPacked *_pointMsg,
+                  msgs::Image *_imageMsg);
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<RgbdFillerPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
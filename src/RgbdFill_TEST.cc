@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/msgs/Utility.hh>
+
+#include "PointCloudUtil.hh"
+#include "RgbdFill.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+namespace
+{
+  /// \brief Larger than the images filled in parallel
+  const unsigned int kWidth = 640u;
+  const unsigned int kHeight = 480u;
+
+  const double kNear = 0.5;
+  const double kFar = 8.0;
+
+  /// \brief Create a point cloud message with the layout of the sensor
+  msgs::PointCloudPacked PointCloudMsg()
+  {
+    msgs::PointCloudPacked msg;
+    msgs::InitPointCloudPacked(msg, "test", true,
+        {{"xyz", msgs::PointCloudPacked::Field::FLOAT32},
+         {"rgb", msgs::PointCloudPacked::Field::FLOAT32}});
+    msg.set_width(kWidth);
+    msg.set_height(kHeight);
+    msg.set_row_step(msg.point_step() * kWidth);
+    return msg;
+  }
+
+  /// \brief Depths in [0, 10), some of which are clipped
+  std::vector<float> DepthFrame()
+  {
+    std::vector<float> depths(kWidth * kHeight);
+    for (std::size_t i = 0u; i < depths.size(); ++i)
+      depths[i] = static_cast<float>(i % 1000u) * 0.01f;
+    return depths;
+  }
+
+  /// \brief Points with 4 channels and a packed color
+  std::vector<float> CloudFrame()
+  {
+    std::vector<float> cloud(kWidth * kHeight * 4u);
+    for (std::size_t i = 0u; i < kWidth * kHeight; ++i)
+    {
+      cloud[i * 4u] = static_cast<float>(i % kWidth) * 0.1f;
+      cloud[i * 4u + 1u] = static_cast<float>(i / kWidth) * 0.1f;
+      cloud[i * 4u + 2u] = static_cast<float>(i % 7u);
+      // keep the red byte low so that the packed color is never a NaN
+      const uint32_t bits = (i % 120u) << 24 | (i % 251u) << 16 |
+          (i % 13u) << 8 | 0xFFu;
+      std::memcpy(&cloud[i * 4u + 3u], &bits, sizeof(bits));
+    }
+    return cloud;
+  }
+}
+
+/////////////////////////////////////////////////
+/// \brief Compare with the serial path, which clips the depths, replaces
+/// the clipped points with their depth and fills the point cloud and
+/// image with PointCloudUtil.
+TEST(RgbdFillTest, MatchesSerialPath)
+{
+  const std::vector<float> depths = DepthFrame();
+  const std::vector<float> cloud = CloudFrame();
+
+  std::vector<float> expectedDepths = depths;
+  std::vector<float> clippedCloud = cloud;
+  for (std::size_t i = 0u; i < expectedDepths.size(); ++i)
+  {
+    float &depth = expectedDepths[i];
+    if (depth > kFar)
+      depth = std::numeric_limits<float>::infinity();
+    if (depth < kNear)
+      depth = -std::numeric_limits<float>::infinity();
+    if (std::isinf(depth))
+    {
+      clippedCloud[i * 4u] = depth;
+      clippedCloud[i * 4u + 1u] = depth;
+      clippedCloud[i * 4u + 2u] = depth;
+    }
+  }
+
+  PointCloudUtil pointsUtil;
+  pointsUtil.SetThreadCount(1u);
+  msgs::PointCloudPacked expectedPoints = PointCloudMsg();
+  std::vector<unsigned char> expectedImage(kWidth * kHeight * 3u);
+  pointsUtil.FillMsg(expectedPoints, clippedCloud.data(), true,
+      expectedImage.data());
+
+  for (unsigned int threads : {1u, 3u, 4u})
+  {
+    RgbdFiller filler;
+    filler.SetThreadCount(threads);
+    EXPECT_EQ(threads, filler.ThreadCount());
+    filler.SetDepthClip(true, kNear, true, kFar);
+
+    msgs::Image depthMsg;
+    msgs::Image imageMsg;
+    msgs::PointCloudPacked pointMsg = PointCloudMsg();
+    // fill twice to check that the message buffers are reused
+    for (int i = 0; i < 2; ++i)
+    {
+      filler.Fill(depths.data(), cloud.data(), 4u, kWidth, kHeight,
+          &depthMsg, &pointMsg, &imageMsg);
+    }
+
+    ASSERT_EQ(expectedDepths.size() * sizeof(float), depthMsg.data().size())
+        << threads;
+    EXPECT_EQ(0, std::memcmp(expectedDepths.data(), depthMsg.data().data(),
+        depthMsg.data().size())) << threads;
+
+    ASSERT_EQ(expectedPoints.data().size(), pointMsg.data().size())
+        << threads;
+    const uint32_t step = pointMsg.point_step();
+    for (std::size_t i = 0u; i < kWidth * kHeight; ++i)
+    {
+      // compare the fields only, the padding between them isn't written
+      for (int f = 0; f < 4; ++f)
+      {
+        const uint32_t offset = pointMsg.field(f).offset();
+        ASSERT_EQ(0, std::memcmp(
+            expectedPoints.data().data() + i * step + offset,
+            pointMsg.data().data() + i * step + offset,
+            f < 3 ? sizeof(float) : 3u)) << threads << " " << i;
+      }
+    }
+
+    ASSERT_EQ(expectedImage.size(), imageMsg.data().size()) << threads;
+    EXPECT_EQ(0, std::memcmp(expectedImage.data(), imageMsg.data().data(),
+        expectedImage.size())) << threads;
+  }
+}
+
+/////////////////////////////////////////////////
+TEST(RgbdFillTest, IntegerDepths)
+{
+  const std::vector<float> depths = DepthFrame();
+  const float unit = 0.001f;
+
+  std::vector<std::string> results;
+  for (unsigned int threads : {1u, 4u})
+  {
+    RgbdFiller filler;
+    filler.SetThreadCount(threads);
+    filler.SetDepthClip(true, kNear, true, kFar);
+    filler.SetDepthUnit(unit);
+
+    msgs::Image depthMsg;
+    filler.Fill(depths.data(), nullptr, 4u, kWidth, kHeight, &depthMsg,
+        nullptr, nullptr);
+    ASSERT_EQ(depths.size() * sizeof(uint16_t), depthMsg.data().size());
+
+    std::vector<uint16_t> units(depths.size());
+    std::memcpy(units.data(), depthMsg.data().data(), depthMsg.data().size());
+    for (std::size_t i = 0u; i < depths.size(); ++i)
+    {
+      if (depths[i] > kFar || depths[i] < kNear)
+      {
+        EXPECT_EQ(0u, units[i]) << i;
+      }
+      else
+      {
+        EXPECT_NEAR(depths[i] / unit, units[i], 1.0) << i;
+      }
+    }
+    results.push_back(depthMsg.data());
+  }
+  EXPECT_EQ(results[0], results[1]);
+}
+
+/////////////////////////////////////////////////
+TEST(RgbdFillTest, ThreadCount)
+{
+  RgbdFiller filler;
+  EXPECT_EQ(1u, filler.ThreadCount());
+  filler.SetThreadCount(0u);
+  EXPECT_EQ(std::max(1u, std::thread::hardware_concurrency()),
+      filler.ThreadCount());
+  filler.SetThreadCount(2u);
+  EXPECT_EQ(2u, filler.ThreadCount());
+}
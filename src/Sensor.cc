@@ -15,17 +15,64 @@
  *
 */
 
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs/boolean.pb.h>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
 #include "ignition/sensors/Sensor.hh"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 #include <ignition/common/Console.hh>
 #include <ignition/common/Profiler.hh>
+#include <ignition/common/Util.hh>
+#include <ignition/math/Helpers.hh>
+#include <ignition/math/Rand.hh>
 #include <ignition/transport/TopicUtils.hh>
 
 #include <ignition/sensors/Manager.hh>
+#include <ignition/sensors/PipelineTrace.hh>
+#include <ignition/sensors/RecordingSink.hh>
+#include <ignition/sensors/SharedMemoryRing.hh>
+
+#include "AsyncPublisher.hh"
+#include "HeaderUtil.hh"
+#include "RandomStream.hh"
 
 using namespace ignition::sensors;
 
+/// \brief A message held back until Sensor::CommitPublishes()
+class DeferredOutput
+{
+  /// \brief Publisher of the message
+  public: ignition::transport::Node::Publisher *pub = nullptr;
+
+  /// \brief Copy of the message, reused while the type stays the same
+  public: std::unique_ptr<google::protobuf::Message> msg;
+
+  /// \brief Simulated time of the update of the message
+  public: std::chrono::steady_clock::duration simTime{
+              std::chrono::steady_clock::duration::zero()};
+
+  /// \brief True to record the message, false to send it
+  public: bool record = false;
+};
 
 class ignition::sensors::SensorPrivate
 {
@@ -37,11 +84,76 @@ class ignition::sensors::SensorPrivate
   /// \return True if a valid topic was set.
   public: bool SetTopic(const std::string &_topic);
 
+  /// \brief Get the time of an update of the current schedule.
+  /// \param[in] _index Number of update periods since scheduleStart.
+  /// \return scheduleStart plus _index update periods, rounded to the
+  /// nearest nanosecond.
+  public: std::chrono::steady_clock::duration ScheduledTime(
+              uint64_t _index) const;
+
+  /// \brief Set the update rate and restart the schedule from the
+  /// currently pending update time.
+  /// \param[in] _hz Update rate, must not be negative.
+  public: void SetUpdateRate(double _hz);
+
+  /// \brief Call scheduleChangedCb if it is set.
+  public: void NotifyScheduleChanged();
+
+  /// \brief Increment a sequence and write its value into a header entry.
+  /// The value is formatted in place to avoid allocating memory.
+  /// \param[in,out] _seq Header entry of the sequence number.
+  /// \param[in] _seqKey Name of the sequence.
+  public: void SetSequenceValue(ignition::msgs::Header::Map *_seq,
+              const std::string &_seqKey);
+
+  /// \brief Hand a message to the recording sink, if there is one, or
+  /// hold it back if deferPublish is set.
+  /// \param[in] _sensor The sensor publishing the message
+  /// \param[in] _pub Publisher of the message, which tells the outputs of
+  /// the sensor apart
+  /// \param[in] _msg The message
+  public: void Record(const Sensor &_sensor,
+              ignition::transport::Node::Publisher &_pub,
+              const google::protobuf::Message &_msg);
+
+  /// \brief Hand a message to the recording sink.
+  /// \param[in] _sensor The sensor publishing the message
+  /// \param[in] _pub Publisher of the message
+  /// \param[in] _simTime Simulated time of the update of the message
+  /// \param[in] _msg The message
+  public: void RecordNow(const Sensor &_sensor,
+              const ignition::transport::Node::Publisher &_pub,
+              const std::chrono::steady_clock::duration &_simTime,
+              const google::protobuf::Message &_msg);
+
+  /// \brief Publish a message right away or through publishQueue, without
+  /// recording it, or hold it back if deferPublish is set.
+  /// \param[in] _pub Publisher to send the message with.
+  /// \param[in] _msg The message.
+  /// \return False if the message couldn't be published or was dropped.
+  public: bool Send(ignition::transport::Node::Publisher &_pub,
+              const google::protobuf::Message &_msg);
+
+  /// \brief Publish a message right away or through publishQueue.
+  /// \param[in] _pub Publisher to send the message with.
+  /// \param[in] _msg The message.
+  /// \return False if the message couldn't be published or was dropped.
+  public: bool SendNow(ignition::transport::Node::Publisher &_pub,
+              const google::protobuf::Message &_msg);
+
+  /// \brief Hold back a copy of a message until Sensor::CommitPublishes().
+  /// \param[in] _pub Publisher of the message
+  /// \param[in] _msg The message
+  /// \param[in] _record True to record the message, false to send it
+  public: void Defer(ignition::transport::Node::Publisher &_pub,
+              const google::protobuf::Message &_msg, const bool _record);
+
   /// \brief id given to sensor when constructed
   public: SensorId id;
 
   /// \brief Counter used to generate unique sensor identifiers.
-  public: static SensorId idCounter;
+  /// This is atomic so that sensors can be created from multiple threads.
+  public: static std::atomic<SensorId> idCounter;
 
   /// \brief name given to sensor when loaded
   public: std::string name;
@@ -49,6 +161,12 @@ class ignition::sensors::SensorPrivate
   /// \brief name given to the sensor parent link
   public: std::string parent;
 
+  /// \brief Name of the world of the sensor, empty for the default world
+  public: std::string worldName;
+
+  /// \brief Index of the render device of the sensor
+  public: unsigned int renderDevice = 0u;
+
   /// \brief topic to send sensor data
   public: std::string topic;
 
@@ -62,24 +180,170 @@ class ignition::sensors::SensorPrivate
   public: std::chrono::steady_clock::duration nextUpdateTime
     {std::chrono::steady_clock::duration::zero()};
 
-  /// \brief SDF element with sensor information.
-  public: sdf::ElementPtr sdf = nullptr;
+  /// \brief Time from which update times are counted for the current
+  /// update rate.
+  public: std::chrono::steady_clock::duration scheduleStart
+    {std::chrono::steady_clock::duration::zero()};
+
+  /// \brief Number of update periods from scheduleStart to nextUpdateTime
+  public: uint64_t scheduleIndex = 0u;
+
+  /// \brief How to recover after falling behind
+  public: CatchUpPolicy catchUp = CatchUpPolicy::BURST;
+
+  /// \brief Maximum number of missed updates for CatchUpPolicy::CAP
+  public: unsigned int maxMissed = 1u;
+
+  /// \brief Priority used by budgeted Manager updates
+  public: int priority = 0;
+
+  /// \brief Render quality profile of rendering sensors
+  public: RenderQualityProfile renderQuality = RenderQualityProfile::FULL;
+
+  /// \brief True if the Manager may stagger the first update
+  public: bool staggerable = true;
+
+  /// \brief True to skip updates while the sensor has no consumers
+  public: bool lazyUpdates = false;
+
+  /// \brief True if the sensor only updates when triggered
+  public: std::atomic<bool> triggered{false};
+
+  /// \brief True if a trigger arrived since the last update
+  public: std::atomic<bool> triggerPending{false};
+
+  /// \brief Topic triggers are received on. Empty for the default topic.
+  public: std::string triggerTopic;
+
+  /// \brief Node subscribed to the trigger topic, null if not subscribed.
+  /// It's not the node of the outputs: that one may be shared, and
+  /// unsubscribing from it would drop the triggers of other sensors.
+  public: std::unique_ptr<ignition::transport::Node> triggerNode;
+
+  /// \brief True if the outputs are rendered by a remote render service
+  public: bool remoteRendered = false;
+
+  /// \brief True if updates are skipped while consumers are busy
+  public: bool backpressure = false;
 
-  /// \brief SDF Sensor DOM object.
-  public: sdf::Sensor sdfSensor;
+  /// \brief True to split updates into stages
+  public: bool stagedUpdates = false;
 
-  /// \brief Sequence numbers that are used in sensor data message headers.
-  /// A map is used so that a single sensor can have multiple sensor
-  /// streams each with a sequence counter.
-  public: std::map<std::string, uint64_t> sequences;
+  /// \brief Copy of the SDF element the sensor was loaded from. It is
+  /// only made when SDF() is called, and not kept by compact sensors.
+  public: mutable sdf::ElementPtr sdf = nullptr;
+
+  /// \brief Protects sdf
+  public: mutable std::mutex sdfMutex;
+
+  /// \brief SDF Sensor DOM object, null until loaded. Compact sensors
+  /// share it with the sensor they were cloned from, see ShareSdf().
+  public: std::shared_ptr<const sdf::Sensor> sdfSensor;
+
+  /// \brief Topic of the SDF this sensor was loaded from, which may
+  /// differ from sdfSensor when it's shared.
+  public: std::string sdfTopic;
+
+  /// \brief True if the sensor keeps as little state as possible.
+  public: bool compact = false;
+
+  /// \brief Sequence numbers that are used in sensor data message headers,
+  /// by stream key, so that a single sensor can have multiple sensor
+  /// streams each with a sequence counter. Sensors have few streams, so
+  /// they're kept in a flat list.
+  public: std::vector<std::pair<std::string, uint64_t>> sequences;
+
+  /// \brief Called when the update schedule changes outside of Update().
+  public: std::function<void(SensorId)> scheduleChangedCb;
+
+  /// \brief Called with the messages published on the topic of the sensor
+  public: std::function<void(SensorId, const google::protobuf::Message &)>
+              publishCb;
+
+  /// \brief Node the outputs are advertised on, created on first use if
+  /// none was set.
+  public: std::shared_ptr<ignition::transport::Node> node;
+
+  /// \brief True once the node was used to advertise
+  public: bool nodeUsed = false;
+
+  /// \brief Queue of messages to publish asynchronously. Null when
+  /// publishing synchronously.
+  public: std::shared_ptr<AsyncPublishQueue> publishQueue;
+
+  /// \brief Number of slots of each shared memory ring. Zero when
+  /// shared memory publishing is disabled.
+  public: std::size_t sharedMemorySlots = 0u;
+
+  /// \brief Shared memory rings, by ring key. Rings are created on first
+  /// use and recreated when the data outgrows their slots.
+  public: std::map<std::string, std::unique_ptr<SharedMemoryRing>>
+      sharedMemoryRings;
+
+  /// \brief Number of rings created so far, used to give every ring a
+  /// new name.
+  public: unsigned int sharedMemoryRingCount = 0u;
+
+  /// \brief Sink recording the published messages, null if not recording
+  public: std::shared_ptr<RecordingSink> recordingSink;
+
+  /// \brief True to hold messages back until Sensor::CommitPublishes()
+  public: bool deferPublish = false;
+
+  /// \brief Messages held back, the first deferredCount are pending. The
+  /// messages are reused between updates.
+  public: std::vector<DeferredOutput> deferred;
+
+  /// \brief Number of messages held back
+  public: std::size_t deferredCount = 0u;
+
+  /// \brief Publishers of the outputs and their topics, see
+  /// Sensor::SetOutputTopic(). Protected by statsMutex.
+  public: std::vector<std::pair<ignition::transport::Node::Publisher *,
+              std::string>> outputs;
+
+  /// \brief Runtime statistics
+  public: SensorStats stats;
+
+  /// \brief Protects stats, which can be read from other threads while
+  /// the sensor updates.
+  public: mutable std::mutex statsMutex;
+
+  /// \brief Simulated and wall times at which the most recent updates
+  /// started, to find when the data of a stamped message was sampled.
+  public: std::array<std::pair<std::chrono::steady_clock::duration,
+              std::chrono::steady_clock::time_point>, 8> updateStarts{};
+
+  /// \brief Index of updateStarts written by the next update
+  public: std::size_t nextUpdateStart = 0u;
+
+  /// \brief Wall time at which the data of the messages being published
+  /// was sampled, the start of the matching update.
+  public: std::chrono::steady_clock::time_point sampleStart;
+
+  /// \brief True if sampleStart is valid
+  public: bool hasSampleStart = false;
+
+  /// \brief Allocation count of the updating thread at the end of the
+  /// last phase, the allocations after it are counted in the next phase.
+  public: uint64_t allocationMark = 0u;
+
+  /// \brief Thread allocationMark was read on
+  public: std::thread::id allocationThread;
+
+  /// \brief Simulated time of the latest update, for PipelineTrace and
+  /// the recording sink
+  public: std::chrono::steady_clock::duration updateSimTime{
+              std::chrono::steady_clock::duration::zero()};
 };
 
-SensorId SensorPrivate::idCounter = 0;
+std::atomic<SensorId> SensorPrivate::idCounter{0};
 
 //////////////////////////////////////////////////
 bool SensorPrivate::PopulateFromSDF(const sdf::Sensor &_sdf)
 {
-  this->sdfSensor = _sdf;
+  this->sdfSensor = std::make_shared<const sdf::Sensor>(_sdf);
+  this->sdfTopic = _sdf.Topic();
 
   // All SDF code gets auto converted to latest version. This code is
   // written assuming sdformat 1.7 is the latest
@@ -110,10 +374,104 @@ bool SensorPrivate::PopulateFromSDF(const sdf::Sensor &_sdf)
     this->pose = _sdf.RawPose();
   }
 
-  this->updateRate = _sdf.UpdateRate();
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:priority"))
+    this->priority = elem->Get<int>("ignition:priority");
+
+  if (elem && elem->HasElement("ignition:render_quality"))
+  {
+    const std::string quality = common::lowercase(
+        elem->Get<std::string>("ignition:render_quality"));
+    if (quality == "full")
+    {
+      this->renderQuality = RenderQualityProfile::FULL;
+    }
+    else if (quality == "fast")
+    {
+      this->renderQuality = RenderQualityProfile::FAST;
+    }
+    else
+    {
+      ignwarn << "Unknown render quality [" << quality << "] for sensor ["
+              << this->name << "]. Using [full].\n";
+      this->renderQuality = RenderQualityProfile::FULL;
+    }
+  }
+
+  if (elem && elem->HasElement("ignition:triggered"))
+    this->triggered = elem->Get<bool>("ignition:triggered");
+  if (elem && elem->HasElement("ignition:trigger_topic"))
+    this->triggerTopic = elem->Get<std::string>("ignition:trigger_topic");
+
+  this->SetUpdateRate(std::max(0.0, _sdf.UpdateRate()));
   return true;
 }
 
+//////////////////////////////////////////////////
+void SensorPrivate::SetUpdateRate(double _hz)
+{
+  if (ignition::math::equal(_hz, this->updateRate))
+    return;
+
+  this->updateRate = _hz;
+  this->scheduleStart = this->nextUpdateTime;
+  this->scheduleIndex = 0u;
+  this->NotifyScheduleChanged();
+}
+
+//////////////////////////////////////////////////
+void SensorPrivate::SetSequenceValue(ignition::msgs::Header::Map *_seq,
+    const std::string &_seqKey)
+{
+  // Sequences start at zero
+  uint64_t value = 0u;
+  auto iter = std::find_if(this->sequences.begin(), this->sequences.end(),
+      [&_seqKey](const std::pair<std::string, uint64_t> &_sequence)
+      {
+        return _sequence.first == _seqKey;
+      });
+  if (iter == this->sequences.end())
+    this->sequences.emplace_back(_seqKey, 0u);
+  else
+    value = ++iter->second;
+
+  SetHeaderEntryValue(*_seq, value);
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration SensorPrivate::ScheduledTime(
+    uint64_t _index) const
+{
+  const double rate = this->updateRate;
+  const uint64_t billion = 1000000000u;
+  uint64_t ns;
+  // Use integer math for integer rates, so that periods such as 1/300 s
+  // are exact on average and never accumulate rounding errors.
+  uint64_t intRate = static_cast<uint64_t>(rate);
+  if (intRate > 0u && ignition::math::equal(rate,
+        static_cast<double>(intRate), 0.0))
+  {
+    uint64_t secs = _index / intRate;
+    uint64_t rem = _index % intRate;
+    ns = secs * billion + (rem * billion + intRate / 2u) / intRate;
+  }
+  else
+  {
+    ns = static_cast<uint64_t>(
+        std::llround(static_cast<double>(_index) * 1e9 / rate));
+  }
+
+  return this->scheduleStart + std::chrono::duration_cast<
+      std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns));
+}
+
+//////////////////////////////////////////////////
+void SensorPrivate::NotifyScheduleChanged()
+{
+  if (this->scheduleChangedCb)
+    this->scheduleChangedCb(this->id);
+}
+
 //////////////////////////////////////////////////
 Sensor::Sensor() :
   dataPtr(new SensorPrivate)
@@ -124,196 +482,1177 @@ Sensor::Sensor() :
 //////////////////////////////////////////////////
 bool Sensor::Init()
 {
+  // Outputs get their default topics while loading
+  if (this->dataPtr->triggered && !this->dataPtr->triggerNode)
+  {
+    const std::string topic = this->dataPtr->triggerTopic.empty() ?
+        this->Topic() + "/trigger" : this->dataPtr->triggerTopic;
+    if (!this->SetTriggerTopic(topic))
+      return false;
+  }
   return true;
 }
 
 //////////////////////////////////////////////////
 Sensor::~Sensor()
 {
+  // Stop the triggers before the rest of the sensor goes away
+  this->dataPtr->triggerNode.reset();
+  if (this->dataPtr->publishQueue)
+    this->dataPtr->publishQueue->Flush();
 }
 
 //////////////////////////////////////////////////
 bool Sensor::Load(const sdf::Sensor &_sdf)
 {
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->sdfMutex);
+    this->dataPtr->sdf.reset();
+  }
   return this->dataPtr->PopulateFromSDF(_sdf);
 }
 
 //////////////////////////////////////////////////
 bool Sensor::Load(sdf::ElementPtr _sdf)
 {
-  if (!this->dataPtr->sdf)
+  sdf::Sensor sdfSensor;
+  sdfSensor.Load(_sdf);
+  return this->Sensor::Load(sdfSensor);
+}
+
+//////////////////////////////////////////////////
+bool Sensor::Reconfigure(const sdf::Sensor &_sdf)
+{
+  // Only the common settings may differ from the current SDF. The name
+  // and topic are checked by ReconfigureCommon(), since a shared SDF has
+  // those of another sensor.
+  const sdf::Sensor &current = this->SdfSensor();
+  sdf::Sensor rest = _sdf;
+  rest.SetName(current.Name());
+  rest.SetTopic(current.Topic());
+  rest.SetUpdateRate(current.UpdateRate());
+  rest.SetRawPose(current.RawPose());
+  rest.SetPoseRelativeTo(current.PoseRelativeTo());
+  if (!(rest == current))
   {
-    this->dataPtr->sdf = _sdf->Clone();
+    igndbg << "Sensor [" << this->dataPtr->name << "] must be created "
+           << "again to apply its new configuration.\n";
+    return false;
   }
-  else
-    this->dataPtr->sdf->Copy(_sdf);
+  return this->ReconfigureCommon(_sdf);
+}
 
-  sdf::Sensor sdfSensor;
-  sdfSensor.Load(_sdf);
-  return this->dataPtr->PopulateFromSDF(sdfSensor);
+//////////////////////////////////////////////////
+bool Sensor::ReconfigureCommon(const sdf::Sensor &_sdf)
+{
+  if (_sdf.Name() != this->dataPtr->name ||
+      _sdf.Type() != this->SdfSensor().Type() ||
+      _sdf.Topic() != this->dataPtr->sdfTopic)
+  {
+    igndbg << "Sensor [" << this->dataPtr->name << "] can't change its "
+           << "name, type or topic in place.\n";
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->sdfMutex);
+    this->dataPtr->sdf.reset();
+  }
+  return this->dataPtr->PopulateFromSDF(_sdf);
 }
 
 //////////////////////////////////////////////////
-sdf::ElementPtr Sensor::SDF() const
+bool Sensor::Ready() const
 {
-  return this->dataPtr->sdf;
+  return true;
 }
 
 //////////////////////////////////////////////////
-SensorId Sensor::Id() const
+bool Sensor::IsRenderingSensor() const
 {
-  return this->dataPtr->id;
+  return false;
 }
 
 //////////////////////////////////////////////////
-std::string Sensor::Name() const
+void Sensor::PrepareFrame(const uint64_t /*_frameId*/)
 {
-  return this->dataPtr->name;
 }
 
 //////////////////////////////////////////////////
-std::string Sensor::Topic() const
+bool Sensor::WarmUp()
 {
-  return this->dataPtr->topic;
+  return false;
 }
 
 //////////////////////////////////////////////////
-bool Sensor::SetTopic(const std::string &_topic)
+bool Sensor::SupportsStagedUpdates() const
 {
-  return this->dataPtr->SetTopic(_topic);
+  return false;
 }
 
 //////////////////////////////////////////////////
-bool SensorPrivate::SetTopic(const std::string &_topic)
+void Sensor::SetStagedUpdates(const bool _staged)
 {
-  auto validTopic = transport::TopicUtils::AsValidTopic(_topic);
-  if (validTopic.empty())
-  {
-    ignerr << "Failed to set sensor topic [" << _topic << "]" << std::endl;
-    return false;
-  }
+  this->dataPtr->stagedUpdates = _staged && this->SupportsStagedUpdates();
+}
 
-  this->topic = validTopic;
+//////////////////////////////////////////////////
+bool Sensor::StagedUpdates() const
+{
+  return this->dataPtr->stagedUpdates;
+}
+
+//////////////////////////////////////////////////
+void Sensor::ReadbackFrame()
+{
+}
+
+//////////////////////////////////////////////////
+void Sensor::ProcessFrame()
+{
+}
+
+//////////////////////////////////////////////////
+bool Sensor::HasConnections() const
+{
   return true;
 }
 
 //////////////////////////////////////////////////
-ignition::math::Pose3d Sensor::Pose() const
+void Sensor::SetLazyUpdates(const bool _lazy)
 {
-  return this->dataPtr->pose;
+  this->dataPtr->lazyUpdates = _lazy;
 }
 
 //////////////////////////////////////////////////
-std::string Sensor::Parent() const
+bool Sensor::LazyUpdates() const
 {
-  return this->dataPtr->parent;
+  return this->dataPtr->lazyUpdates;
 }
 
 //////////////////////////////////////////////////
-void Sensor::SetParent(const std::string &_parent)
+void Sensor::SetTriggered(const bool _triggered)
 {
-  this->dataPtr->parent = _parent;
+  if (!_triggered)
+    this->dataPtr->triggerPending = false;
+  if (this->dataPtr->triggered.exchange(_triggered) != _triggered)
+    this->dataPtr->NotifyScheduleChanged();
 }
 
 //////////////////////////////////////////////////
-void Sensor::SetPose(const ignition::math::Pose3d &_pose)
+bool Sensor::Triggered() const
 {
-  this->dataPtr->pose = _pose;
+  return this->dataPtr->triggered;
 }
 
 //////////////////////////////////////////////////
-double Sensor::UpdateRate() const
+void Sensor::Trigger()
 {
-  return this->dataPtr->updateRate;
+  if (!this->dataPtr->triggered)
+    return;
+
+  // Triggers before the next update coalesce into one
+  if (!this->dataPtr->triggerPending.exchange(true))
+    this->dataPtr->NotifyScheduleChanged();
 }
 
 //////////////////////////////////////////////////
-void Sensor::SetUpdateRate(const double _hz)
+bool Sensor::TriggerPending() const
+{
+  return this->dataPtr->triggerPending;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::SetTriggerTopic(const std::string &_topic)
 {
-  if (_hz < 0)
+  const std::string topic = transport::TopicUtils::AsValidTopic(_topic);
+  if (topic.empty())
   {
-    this->dataPtr->updateRate = 0;
+    ignerr << "Invalid trigger topic [" << _topic << "] for sensor ["
+           << this->Name() << "].\n";
+    return false;
   }
-  else
+
+  std::unique_ptr<transport::Node> node(new transport::Node());
+  std::function<void(const msgs::Boolean &)> cb =
+      [this](const msgs::Boolean &_msg)
+      {
+        if (_msg.data())
+          this->Trigger();
+      };
+  if (!node->Subscribe(topic, cb))
   {
-    this->dataPtr->updateRate = _hz;
+    ignerr << "Unable to subscribe to trigger topic [" << topic
+           << "] of sensor [" << this->Name() << "].\n";
+    return false;
   }
+
+  this->dataPtr->triggerNode = std::move(node);
+  this->dataPtr->triggerTopic = topic;
+  return true;
 }
 
 //////////////////////////////////////////////////
-bool Sensor::Update(const std::chrono::steady_clock::duration &_now,
-                  const bool _force)
+std::string Sensor::TriggerTopic() const
 {
-  IGN_PROFILE("Sensor::Update");
-  bool result = false;
+  return this->dataPtr->triggerNode ? this->dataPtr->triggerTopic : "";
+}
 
-  // Check if it's time to update
-  if (_now < this->dataPtr->nextUpdateTime && !_force &&
-      this->dataPtr->updateRate > 0)
-  {
-    return result;
-  }
+//////////////////////////////////////////////////
+void Sensor::SetRemoteRendered(const bool _remote)
+{
+  this->dataPtr->remoteRendered = _remote;
+}
 
-  // Make the update happen
-  result = this->Update(_now);
+//////////////////////////////////////////////////
+bool Sensor::RemoteRendered() const
+{
+  return this->dataPtr->remoteRendered;
+}
 
-  if (!_force && this->dataPtr->updateRate > 0.0)
-  {
-    // Update the time the plugin should be loaded
-    auto delta = std::chrono::duration_cast< std::chrono::milliseconds>
-      (std::chrono::duration< double >(1.0 / this->dataPtr->updateRate));
-    this->dataPtr->nextUpdateTime += delta;
-  }
+//////////////////////////////////////////////////
+bool Sensor::ConsumersBusy() const
+{
+  return this->dataPtr->publishQueue && this->dataPtr->publishQueue->Busy();
+}
 
-  return result;
+//////////////////////////////////////////////////
+void Sensor::SetModelPoseSnapshot(
+    std::shared_ptr<const ModelPoseSnapshot> /*_snapshot*/)
+{
 }
 
 //////////////////////////////////////////////////
-bool Sensor::Update(const ignition::common::Time &_now, const bool _force)
+void Sensor::SetBackpressure(const bool _enable)
 {
-  return this->Update(math::secNsecToDuration(_now.sec, _now.nsec), _force);
+  this->dataPtr->backpressure = _enable;
 }
 
 //////////////////////////////////////////////////
-std::chrono::steady_clock::duration Sensor::NextDataUpdateTime() const
+bool Sensor::Backpressure() const
 {
-  return this->dataPtr->nextUpdateTime;
+  return this->dataPtr->backpressure;
 }
 
 //////////////////////////////////////////////////
-ignition::common::Time Sensor::NextUpdateTime() const
+sdf::ElementPtr Sensor::SDF() const
 {
-  std::pair<uint64_t, uint64_t> secNsec =
-    math::durationToSecNsec(this->dataPtr->nextUpdateTime);
-  return common::Time(secNsec.first, secNsec.second);
+  std::lock_guard<std::mutex> lock(this->dataPtr->sdfMutex);
+  if (this->dataPtr->sdf)
+    return this->dataPtr->sdf;
+
+  sdf::ElementPtr elem = this->SdfSensor().Element();
+  if (!elem)
+    return nullptr;
+
+  // Compact sensors hand out a copy without keeping it
+  sdf::ElementPtr copy = elem->Clone();
+  if (!this->dataPtr->compact)
+    this->dataPtr->sdf = copy;
+  return copy;
 }
 
-/////////////////////////////////////////////////
-void Sensor::AddSequence(ignition::msgs::Header *_msg,
-                         const std::string &_seqKey)
+//////////////////////////////////////////////////
+const sdf::Sensor &Sensor::SdfSensor() const
 {
-  std::string value = "0";
+  static const sdf::Sensor empty;
+  if (!this->dataPtr->sdfSensor)
+    return empty;
+  return *this->dataPtr->sdfSensor;
+}
 
-  if (this->dataPtr->sequences.find(_seqKey) == this->dataPtr->sequences.end())
-    this->dataPtr->sequences[_seqKey] = 0;
-  else
-    value = std::to_string(++this->dataPtr->sequences[_seqKey]);
+//////////////////////////////////////////////////
+void Sensor::SetCompact(const bool _compact)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->sdfMutex);
+  this->dataPtr->compact = _compact;
+  if (_compact)
+    this->dataPtr->sdf.reset();
+}
 
-  // Set the value if a `sequence` key already exists.
-  for (int index = 0; index < _msg->data_size(); ++index)
+//////////////////////////////////////////////////
+bool Sensor::Compact() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->sdfMutex);
+  return this->dataPtr->compact;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::ShareSdf(const Sensor &_source)
+{
+  std::shared_ptr<const sdf::Sensor> shared = _source.dataPtr->sdfSensor;
+  if (!shared || !this->dataPtr->sdfSensor)
+    return false;
+  if (shared == this->dataPtr->sdfSensor)
+    return true;
+
+  // The SDFs may only differ in the settings each sensor keeps itself
+  const sdf::Sensor &own = *this->dataPtr->sdfSensor;
+  sdf::Sensor rest = *shared;
+  rest.SetName(own.Name());
+  rest.SetTopic(own.Topic());
+  rest.SetUpdateRate(own.UpdateRate());
+  rest.SetRawPose(own.RawPose());
+  rest.SetPoseRelativeTo(own.PoseRelativeTo());
+  if (!(rest == own))
   {
-    if (_msg->data(index).key() == "seq")
-    {
-      if (_msg->data(index).value_size() == 0)
-        _msg->mutable_data(index)->add_value(value);
-      else
-        _msg->mutable_data(index)->set_value(0, value);
-      return;
-    }
+    igndbg << "Sensor [" << this->dataPtr->name << "] can't share the SDF "
+           << "of sensor [" << _source.Name() << "], they differ.\n";
+    return false;
   }
 
-  // Otherwise, add the sequence key-value pair.
-  ignition::msgs::Header::Map *map = _msg->add_data();
-  map->set_key("seq");
-  map->add_value(value);
+  this->dataPtr->sdfSensor = std::move(shared);
+  return true;
+}
+
+//////////////////////////////////////////////////
+SensorId Sensor::Id() const
+{
+  return this->dataPtr->id;
+}
+
+//////////////////////////////////////////////////
+std::string Sensor::Name() const
+{
+  return this->dataPtr->name;
+}
+
+//////////////////////////////////////////////////
+std::string Sensor::Topic() const
+{
+  return this->dataPtr->topic;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::SetTopic(const std::string &_topic)
+{
+  return this->dataPtr->SetTopic(_topic);
+}
+
+//////////////////////////////////////////////////
+bool SensorPrivate::SetTopic(const std::string &_topic)
+{
+  auto validTopic = transport::TopicUtils::AsValidTopic(_topic);
+  if (validTopic.empty())
+  {
+    ignerr << "Failed to set sensor topic [" << _topic << "]" << std::endl;
+    return false;
+  }
+
+  this->topic = validTopic;
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::math::Pose3d Sensor::Pose() const
+{
+  return this->dataPtr->pose;
+}
+
+//////////////////////////////////////////////////
+std::string Sensor::Parent() const
+{
+  return this->dataPtr->parent;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetParent(const std::string &_parent)
+{
+  this->dataPtr->parent = _parent;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetWorldName(const std::string &_world)
+{
+  this->dataPtr->worldName = _world;
+}
+
+//////////////////////////////////////////////////
+std::string Sensor::WorldName() const
+{
+  return this->dataPtr->worldName;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetRenderDevice(const unsigned int _device)
+{
+  this->dataPtr->renderDevice = _device;
+}
+
+//////////////////////////////////////////////////
+unsigned int Sensor::RenderDevice() const
+{
+  return this->dataPtr->renderDevice;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetPose(const ignition::math::Pose3d &_pose)
+{
+  this->dataPtr->pose = _pose;
+}
+
+//////////////////////////////////////////////////
+double Sensor::UpdateRate() const
+{
+  return this->dataPtr->updateRate;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetUpdateRate(const double _hz)
+{
+  this->dataPtr->SetUpdateRate(_hz < 0 ? 0.0 : _hz);
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetCatchUpPolicy(const CatchUpPolicy _policy,
+    const unsigned int _maxMissed)
+{
+  this->dataPtr->catchUp = _policy;
+  this->dataPtr->maxMissed = _maxMissed;
+}
+
+//////////////////////////////////////////////////
+CatchUpPolicy Sensor::CatchUp() const
+{
+  return this->dataPtr->catchUp;
+}
+
+//////////////////////////////////////////////////
+unsigned int Sensor::MaxMissedUpdates() const
+{
+  return this->dataPtr->maxMissed;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetUpdatePhase(
+    const std::chrono::steady_clock::duration &_offset)
+{
+  if (this->dataPtr->updateRate <= 0.0)
+    return;
+
+  std::chrono::steady_clock::duration period = std::chrono::nanoseconds(
+      std::llround(1e9 / this->dataPtr->updateRate));
+  auto offset = _offset;
+  if (period > std::chrono::steady_clock::duration::zero())
+  {
+    offset %= period;
+    if (offset < std::chrono::steady_clock::duration::zero())
+      offset += period;
+  }
+
+  this->dataPtr->scheduleStart = this->dataPtr->nextUpdateTime + offset;
+  this->dataPtr->scheduleIndex = 0u;
+  this->dataPtr->nextUpdateTime = this->dataPtr->scheduleStart;
+  this->dataPtr->NotifyScheduleChanged();
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetStaggerable(const bool _staggerable)
+{
+  this->dataPtr->staggerable = _staggerable;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::Staggerable() const
+{
+  return this->dataPtr->staggerable;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetPriority(const int _priority)
+{
+  this->dataPtr->priority = _priority;
+}
+
+//////////////////////////////////////////////////
+int Sensor::Priority() const
+{
+  return this->dataPtr->priority;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetRenderQuality(const RenderQualityProfile _profile)
+{
+  this->dataPtr->renderQuality = _profile;
+}
+
+//////////////////////////////////////////////////
+RenderQualityProfile Sensor::RenderQuality() const
+{
+  return this->dataPtr->renderQuality;
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetScheduleChangedCallback(
+    std::function<void(SensorId)> _callback)
+{
+  this->dataPtr->scheduleChangedCb = std::move(_callback);
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetPublishCallback(std::function<void(SensorId,
+    const google::protobuf::Message &)> _callback)
+{
+  this->dataPtr->publishCb = std::move(_callback);
+}
+
+//////////////////////////////////////////////////
+bool Sensor::SetTransportNode(
+    std::shared_ptr<ignition::transport::Node> _node)
+{
+  if (this->dataPtr->nodeUsed && _node != this->dataPtr->node)
+  {
+    ignwarn << "Sensor [" << this->Name() << "] already advertised on "
+            << "another node, keeping it.\n";
+    return false;
+  }
+  this->dataPtr->node = std::move(_node);
+  return true;
+}
+
+//////////////////////////////////////////////////
+ignition::transport::Node &Sensor::TransportNode()
+{
+  if (!this->dataPtr->node)
+    this->dataPtr->node = std::make_shared<ignition::transport::Node>();
+  this->dataPtr->nodeUsed = true;
+  return *this->dataPtr->node;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::Update(const std::chrono::steady_clock::duration &_now,
+                  const bool _force)
+{
+  IGN_PROFILE("Sensor::Update");
+  bool result = false;
+
+  // Check if it's time to update. Triggered sensors update once for all
+  // the triggers since their last update.
+  const bool triggered = this->dataPtr->triggered && !_force;
+  if (triggered)
+  {
+    if (!this->dataPtr->triggerPending.exchange(false))
+      return result;
+  }
+  else if (_now < this->dataPtr->nextUpdateTime && !_force &&
+      this->dataPtr->updateRate > 0)
+  {
+    return result;
+  }
+
+  if (this->dataPtr->remoteRendered)
+  {
+    // The render service produces the data, only keep the schedule going
+  }
+  else if (!this->Ready())
+  {
+    // The resources of the sensor are still being created. Keep the
+    // trigger for the next update.
+    if (triggered)
+      this->dataPtr->triggerPending = true;
+    this->RecordSkippedUpdate();
+  }
+  else if (this->dataPtr->lazyUpdates && !_force && !this->HasConnections())
+  {
+    // Nobody consumes the data, only keep the schedule going
+    this->RecordSkippedUpdate();
+  }
+  else if (this->dataPtr->backpressure && !_force && this->ConsumersBusy())
+  {
+    // The consumers can't keep up, don't pile up more data for them
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    ++this->dataPtr->stats.skippedUpdateCount;
+    ++this->dataPtr->stats.backpressureSkipCount;
+  }
+  else
+  {
+    // Make the update happen
+    auto start = std::chrono::steady_clock::now();
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+      auto &starts = this->dataPtr->updateStarts;
+      starts[this->dataPtr->nextUpdateStart] = {_now, start};
+      this->dataPtr->nextUpdateStart =
+          (this->dataPtr->nextUpdateStart + 1u) % starts.size();
+      this->dataPtr->sampleStart = start;
+      this->dataPtr->hasSampleStart = true;
+      this->dataPtr->allocationMark = SensorStats::ThreadAllocationCount();
+      this->dataPtr->allocationThread = std::this_thread::get_id();
+      this->dataPtr->updateSimTime = _now;
+    }
+    const uint64_t allocationStart = SensorStats::ThreadAllocationCount();
+    result = this->Update(_now);
+    auto end = std::chrono::steady_clock::now();
+    auto elapsed = end - start;
+    PipelineTrace::Record(TraceStage::SCHEDULE, this->dataPtr->id, _now,
+        start, end);
+
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    this->dataPtr->stats.update.allocations +=
+        SensorStats::ThreadAllocationCount() - allocationStart;
+    this->dataPtr->stats.update.Add(elapsed);
+    if (result)
+      ++this->dataPtr->stats.updateCount;
+    else
+      ++this->dataPtr->stats.failedUpdateCount;
+  }
+
+  if (!_force && !triggered && this->dataPtr->updateRate > 0.0)
+  {
+    // Update the time the plugin should be loaded
+    uint64_t index = this->dataPtr->scheduleIndex + 1u;
+
+    // Find how many updates are still pending if we fell behind
+    if (this->dataPtr->catchUp != CatchUpPolicy::BURST &&
+        this->dataPtr->ScheduledTime(index) <= _now)
+    {
+      // First update index that is in the future
+      double elapsed = std::chrono::duration<double>(
+          _now - this->dataPtr->scheduleStart).count();
+      uint64_t future = static_cast<uint64_t>(
+          elapsed * this->dataPtr->updateRate) + 1u;
+      while (this->dataPtr->ScheduledTime(future) <= _now)
+        ++future;
+      while (future > index &&
+             this->dataPtr->ScheduledTime(future - 1u) > _now)
+      {
+        --future;
+      }
+
+      uint64_t allowed = this->dataPtr->catchUp == CatchUpPolicy::CAP ?
+          this->dataPtr->maxMissed : 0u;
+      if (future - index > allowed)
+      {
+        std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+        this->dataPtr->stats.skippedUpdateCount += future - allowed - index;
+        index = future - allowed;
+      }
+    }
+
+    this->dataPtr->scheduleIndex = index;
+    this->dataPtr->nextUpdateTime = this->dataPtr->ScheduledTime(index);
+  }
+
+  return result;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::Update(const ignition::common::Time &_now, const bool _force)
+{
+  return this->Update(math::secNsecToDuration(_now.sec, _now.nsec), _force);
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration Sensor::NextDataUpdateTime() const
+{
+  if (this->dataPtr->triggered)
+  {
+    return this->dataPtr->triggerPending ?
+        std::chrono::steady_clock::duration::zero() :
+        std::chrono::steady_clock::duration::max();
+  }
+  return this->dataPtr->nextUpdateTime;
+}
+
+//////////////////////////////////////////////////
+ignition::common::Time Sensor::NextUpdateTime() const
+{
+  std::pair<uint64_t, uint64_t> secNsec =
+    math::durationToSecNsec(this->dataPtr->nextUpdateTime);
+  return common::Time(secNsec.first, secNsec.second);
+}
+
+/////////////////////////////////////////////////
+void Sensor::AddSequence(ignition::msgs::Header *_msg,
+                         const std::string &_seqKey)
+{
+  this->dataPtr->SetSequenceValue(HeaderEntry(*_msg, "seq"), _seqKey);
+}
+
+//////////////////////////////////////////////////
+void Sensor::StampHeader(ignition::msgs::Header *_msg,
+    const std::chrono::steady_clock::duration &_now,
+    const std::string &_seqKey)
+{
+  {
+    // Messages stamped with the time of an earlier update, such as frames
+    // read back one update late, were sampled when that update started
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    this->dataPtr->hasSampleStart = false;
+    for (const auto &start : this->dataPtr->updateStarts)
+    {
+      if (start.first == _now &&
+          start.second != std::chrono::steady_clock::time_point())
+      {
+        this->dataPtr->sampleStart = start.second;
+        this->dataPtr->hasSampleStart = true;
+        break;
+      }
+    }
+  }
+
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      _now).count();
+  _msg->mutable_stamp()->set_sec(ns / 1000000000);
+  _msg->mutable_stamp()->set_nsec(ns % 1000000000);
+
+  ignition::msgs::Header::Map *frame = nullptr;
+  ignition::msgs::Header::Map *seq = nullptr;
+  for (int index = 0; index < _msg->data_size(); ++index)
+  {
+    const std::string &key = _msg->data(index).key();
+    if (!frame && key == "frame_id")
+      frame = _msg->mutable_data(index);
+    else if (!seq && key == "seq")
+      seq = _msg->mutable_data(index);
+  }
+
+  if (!frame)
+  {
+    frame = _msg->add_data();
+    frame->set_key("frame_id");
+  }
+  SetHeaderEntryValue(*frame, this->dataPtr->name.data(),
+      this->dataPtr->name.size());
+
+  if (!seq)
+  {
+    seq = _msg->add_data();
+    seq->set_key("seq");
+  }
+  this->dataPtr->SetSequenceValue(seq, _seqKey);
+}
+
+//////////////////////////////////////////////////
+SensorStats Sensor::Stats() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  return this->dataPtr->stats;
+}
+
+//////////////////////////////////////////////////
+SensorMemory Sensor::MemoryUsage() const
+{
+  return SensorMemory();
+}
+
+//////////////////////////////////////////////////
+void Sensor::ResetStats()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  this->dataPtr->stats = SensorStats();
+}
+
+//////////////////////////////////////////////////
+void Sensor::RecordPhase(const UpdatePhase _phase,
+    const std::chrono::steady_clock::time_point &_start)
+{
+  if (_phase >= UpdatePhase::PHASE_COUNT)
+    return;
+
+  auto end = std::chrono::steady_clock::now();
+  auto elapsed = end - _start;
+  const uint64_t allocationCount = SensorStats::ThreadAllocationCount();
+  uint64_t allocations = 0u;
+  std::chrono::steady_clock::duration simTime;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    TimeStats &stats =
+        this->dataPtr->stats.phases[static_cast<std::size_t>(_phase)];
+    stats.Add(elapsed);
+
+    // Allocations since the previous phase of the update on this thread
+    if (this->dataPtr->allocationThread == std::this_thread::get_id())
+    {
+      allocations = allocationCount - this->dataPtr->allocationMark;
+      stats.allocations += allocations;
+    }
+    this->dataPtr->allocationMark = allocationCount;
+    this->dataPtr->allocationThread = std::this_thread::get_id();
+    simTime = this->dataPtr->updateSimTime;
+  }
+
+  if (PipelineTrace::Enabled())
+  {
+    static const TraceStage stages[] = {TraceStage::RENDER,
+        TraceStage::READBACK, TraceStage::FILL, TraceStage::PUBLISH,
+        TraceStage::NOISE};
+    PipelineTrace::Record(stages[static_cast<std::size_t>(_phase)],
+        this->dataPtr->id, simTime, _start, end);
+  }
+
+#if IGN_PROFILER_ENABLE
+  static const char *phaseNames[] = {"render", "copy", "message", "publish",
+      "noise"};
+  IGN_PROFILE_LOG_TEXT((this->dataPtr->name + " " +
+      phaseNames[static_cast<std::size_t>(_phase)] + " allocations " +
+      std::to_string(allocations)).c_str());
+#endif
+}
+
+//////////////////////////////////////////////////
+void Sensor::RecordPublishedBytes(const uint64_t _bytes)
+{
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    this->dataPtr->stats.bytesPublished += _bytes;
+    if (this->dataPtr->hasSampleStart)
+      this->dataPtr->stats.publishDelay.Add(now - this->dataPtr->sampleStart);
+  }
+
+#if IGN_PROFILER_ENABLE
+  IGN_PROFILE_LOG_TEXT((this->dataPtr->name + " serialized bytes " +
+      std::to_string(_bytes)).c_str());
+#endif
+}
+
+//////////////////////////////////////////////////
+void Sensor::RecordReadbackBytes(const uint64_t _bytes)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    this->dataPtr->stats.bytesReadBack += _bytes;
+  }
+
+#if IGN_PROFILER_ENABLE
+  IGN_PROFILE_LOG_TEXT((this->dataPtr->name + " read back bytes " +
+      std::to_string(_bytes)).c_str());
+#endif
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetAsyncPublish(const bool _async, const std::size_t _queueDepth,
+    const PublishDropPolicy _policy)
+{
+  if (this->dataPtr->publishQueue)
+  {
+    this->dataPtr->publishQueue->Flush();
+    this->dataPtr->publishQueue.reset();
+  }
+
+  if (_async)
+  {
+    this->dataPtr->publishQueue =
+        std::make_shared<AsyncPublishQueue>(_queueDepth, _policy);
+  }
+}
+
+//////////////////////////////////////////////////
+bool Sensor::AsyncPublish() const
+{
+  return this->dataPtr->publishQueue != nullptr;
+}
+
+//////////////////////////////////////////////////
+void SensorPrivate::Record(const Sensor &_sensor,
+    ignition::transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->recordingSink)
+    return;
+
+  if (this->deferPublish)
+  {
+    this->Defer(_pub, _msg, true);
+    return;
+  }
+
+  std::chrono::steady_clock::duration simTime;
+  {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    simTime = this->updateSimTime;
+  }
+  this->RecordNow(_sensor, _pub, simTime, _msg);
+}
+
+//////////////////////////////////////////////////
+void SensorPrivate::RecordNow(const Sensor &_sensor,
+    const ignition::transport::Node::Publisher &_pub,
+    const std::chrono::steady_clock::duration &_simTime,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->recordingSink)
+    return;
+
+  std::string topic;
+  {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    for (const auto &output : this->outputs)
+    {
+      if (output.first == &_pub)
+      {
+        topic = output.second;
+        break;
+      }
+    }
+  }
+  this->recordingSink->Record(_sensor, &_pub, _simTime, _msg, topic);
+}
+
+//////////////////////////////////////////////////
+bool SensorPrivate::Send(ignition::transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg)
+{
+  if (this->deferPublish)
+  {
+    this->Defer(_pub, _msg, false);
+    return true;
+  }
+  return this->SendNow(_pub, _msg);
+}
+
+//////////////////////////////////////////////////
+bool SensorPrivate::SendNow(ignition::transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg)
+{
+  if (!this->publishQueue)
+    return _pub.Publish(_msg);
+
+  unsigned int dropped = this->publishQueue->Push(_pub, _msg);
+  if (dropped > 0u)
+  {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    this->stats.droppedMessageCount += dropped;
+  }
+  return dropped == 0u ||
+      this->publishQueue->Policy() != PublishDropPolicy::DROP_NEWEST;
+}
+
+//////////////////////////////////////////////////
+void SensorPrivate::Defer(ignition::transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg, const bool _record)
+{
+  if (this->deferredCount == this->deferred.size())
+    this->deferred.emplace_back();
+
+  DeferredOutput &output = this->deferred[this->deferredCount++];
+  output.pub = &_pub;
+  output.record = _record;
+  if (!output.msg || output.msg->GetDescriptor() != _msg.GetDescriptor())
+    output.msg.reset(_msg.New());
+  output.msg->CopyFrom(_msg);
+  if (_record)
+  {
+    std::lock_guard<std::mutex> lock(this->statsMutex);
+    output.simTime = this->updateSimTime;
+  }
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetDeferredPublish(const bool _deferred)
+{
+  if (!_deferred)
+    this->CommitPublishes();
+  this->dataPtr->deferPublish = _deferred;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::DeferredPublish() const
+{
+  return this->dataPtr->deferPublish;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::CommitPublishes()
+{
+  auto &data = *this->dataPtr;
+  bool result = true;
+  for (std::size_t i = 0u; i < data.deferredCount; ++i)
+  {
+    DeferredOutput &output = data.deferred[i];
+    if (output.record)
+      data.RecordNow(*this, *output.pub, output.simTime, *output.msg);
+    else
+      result = data.SendNow(*output.pub, *output.msg) && result;
+  }
+  data.deferredCount = 0u;
+  return result;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::Publish(ignition::transport::Node::Publisher &_pub,
+    const google::protobuf::Message &_msg)
+{
+  this->dataPtr->Record(*this, _pub, _msg);
+  if (this->dataPtr->publishCb)
+  {
+    bool primary = false;
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+      for (const auto &output : this->dataPtr->outputs)
+      {
+        if (output.first == &_pub)
+        {
+          primary = output.second == this->dataPtr->topic;
+          break;
+        }
+      }
+    }
+    if (primary)
+      this->dataPtr->publishCb(this->dataPtr->id, _msg);
+  }
+  return this->dataPtr->Send(_pub, _msg);
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetRecordingSink(std::shared_ptr<RecordingSink> _sink)
+{
+  this->dataPtr->recordingSink = std::move(_sink);
+}
+
+//////////////////////////////////////////////////
+void Sensor::SetOutputTopic(const std::string &_topic,
+    ignition::transport::Node::Publisher *_pub)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  auto &outputs = this->dataPtr->outputs;
+  outputs.erase(std::remove_if(outputs.begin(), outputs.end(),
+      [&](const std::pair<ignition::transport::Node::Publisher *,
+          std::string> &_output)
+      {
+        return _output.second == _topic || _output.first == _pub;
+      }), outputs.end());
+  if (_pub)
+    outputs.emplace_back(_pub, _topic);
+}
+
+//////////////////////////////////////////////////
+bool Sensor::ReplayMessage(const std::string &_topic,
+    const google::protobuf::Message &_msg)
+{
+  ignition::transport::Node::Publisher *pub = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+    for (const auto &output : this->dataPtr->outputs)
+    {
+      if (output.second == _topic)
+      {
+        pub = output.first;
+        break;
+      }
+    }
+  }
+  return pub && this->dataPtr->SendNow(*pub, _msg);
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> Sensor::OutputTopics() const
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  std::vector<std::string> topics;
+  topics.reserve(this->dataPtr->outputs.size());
+  for (const auto &output : this->dataPtr->outputs)
+    topics.push_back(output.second);
+  return topics;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::HasConsumers(
+    const ignition::transport::Node::Publisher &_pub) const
+{
+  return _pub && (_pub.HasConnections() || this->dataPtr->recordingSink);
+}
+
+//////////////////////////////////////////////////
+bool Sensor::SetSharedMemoryPublishing(const bool _enable,
+    const std::size_t _slotCount)
+{
+  this->dataPtr->sharedMemoryRings.clear();
+  this->dataPtr->sharedMemorySlots = 0u;
+
+  if (!_enable)
+    return true;
+
+#ifdef _WIN32
+  ignerr << "Shared memory publishing is not supported on this platform.\n";
+  return false;
+#else
+  this->dataPtr->sharedMemorySlots = std::max<std::size_t>(_slotCount, 1u);
+  return true;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool Sensor::SharedMemoryPublishing() const
+{
+  return this->dataPtr->sharedMemorySlots > 0u;
+}
+
+//////////////////////////////////////////////////
+bool Sensor::PublishShared(ignition::transport::Node::Publisher &_pub,
+    google::protobuf::Message &_msg, std::string *_data,
+    ignition::msgs::Header *_header, const std::string &_ringKey)
+{
+  if (this->dataPtr->sharedMemorySlots == 0u)
+    return this->Publish(_pub, _msg);
+
+  // Record the message with its data, not the shared memory handle
+  this->dataPtr->Record(*this, _pub, _msg);
+
+  auto &ring = this->dataPtr->sharedMemoryRings[_ringKey];
+  if (!ring || ring->SlotSize() < _data->size())
+  {
+#ifndef _WIN32
+    std::string name = "/ign_sensors_" + std::to_string(getpid()) + "_" +
+        std::to_string(this->dataPtr->id) + "_" +
+        std::to_string(this->dataPtr->sharedMemoryRingCount++);
+#else
+    std::string name;
+#endif
+    ring.reset(new SharedMemoryRing());
+    if (!ring->Create(name, this->dataPtr->sharedMemorySlots,
+          _data->size()))
+    {
+      ignerr << "Disabling shared memory publishing of sensor ["
+             << this->dataPtr->name << "].\n";
+      this->SetSharedMemoryPublishing(false);
+      return this->dataPtr->Send(_pub, _msg);
+    }
+  }
+
+  uint64_t sequence = ring->Write(_data->data(), _data->size());
+  if (sequence == 0u)
+    return this->dataPtr->Send(_pub, _msg);
+
+  // Publish the message with the handle instead of the data, then restore
+  // it so that callbacks and the next update get the message they expect.
+  // Swapping keeps the capacity of the data buffer.
+  std::string data;
+  data.swap(*_data);
+  auto entry = _header->add_data();
+  entry->set_key("shm");
+  entry->add_value(ring->Name());
+  entry->add_value(std::to_string(sequence));
+  entry->add_value(std::to_string(data.size()));
+
+  bool result = this->dataPtr->Send(_pub, _msg);
+
+  _header->mutable_data()->RemoveLast();
+  _data->swap(data);
+  return result;
+}
+
+//////////////////////////////////////////////////
+void Sensor::RecordSkippedUpdate()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  ++this->dataPtr->stats.skippedUpdateCount;
+}
+
+//////////////////////////////////////////////////
+void Sensor::RecordDroppedSave()
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->statsMutex);
+  ++this->dataPtr->stats.droppedSaveCount;
+}
+
+//////////////////////////////////////////////////
+std::uint64_t Sensor::NoiseSeed(unsigned int _stream) const
+{
+  std::uint64_t seed = RandomStream::Combine(
+      static_cast<std::uint64_t>(ignition::math::Rand::Seed()),
+      this->Name());
+  seed = RandomStream::Combine(seed, this->Topic());
+  return RandomStream::Combine(seed, static_cast<std::uint64_t>(_stream));
 }
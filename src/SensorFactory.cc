@@ -15,6 +15,13 @@
  *
 */
 
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
 #include <ignition/common/PluginLoader.hh>
 #include <ignition/common/SystemPaths.hh>
 #include <ignition/common/Console.hh>
@@ -31,16 +38,55 @@ class ignition::sensors::SensorFactoryPrivate
   /// \brief A map of loaded sensor plugins and their type.
   public: std::map<std::string, std::shared_ptr<SensorPlugin>> sensorPlugins;
 
+  /// \brief Sensor types whose plugins failed to load.
+  public: std::set<std::string> failedTypes;
+
+  /// \brief Protects the plugin registry.
+  public: mutable std::mutex mutex;
+
   /// \brief Stores paths to search for on file system
   public: ignition::common::SystemPaths systemPaths;
 
   /// \brief For loading plugins
   public: ignition::common::PluginLoader pluginLoader;
+
+  /// \brief Node given to new sensors, null for them to create their own.
+  public: std::shared_ptr<ignition::transport::Node> node;
 };
 
 using namespace ignition;
 using namespace sensors;
 
+/// \brief Sensor types registered with
+/// SensorFactory::RegisterStaticSensorTypes(), shared by all factories.
+class StaticSensorRegistry
+{
+  /// \brief Registered types, sorted by type string
+  public: std::vector<StaticSensorType> types;
+
+  /// \brief Protects types
+  public: std::mutex mutex;
+};
+
+/// \brief Get the registry of static sensor types. It's created on first
+/// use, so that tables can be registered from static initializers.
+/// \return The registry
+static StaticSensorRegistry &StaticRegistry()
+{
+  static StaticSensorRegistry registry;
+  return registry;
+}
+
+/// \brief Order static sensor types by type string
+/// \param[in] _a First entry
+/// \param[in] _b Second entry
+/// \return True if _a sorts before _b
+static bool StaticTypeLess(const StaticSensorType &_a,
+    const StaticSensorType &_b)
+{
+  return std::strcmp(_a.type, _b.type) < 0;
+}
+
 //////////////////////////////////////////////////
 SensorFactoryPrivate::SensorFactoryPrivate()
 {
@@ -50,7 +96,111 @@ SensorFactoryPrivate::SensorFactoryPrivate()
 //////////////////////////////////////////////////
 void SensorFactory::AddPluginPaths(const std::string &_path)
 {
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
   this->dataPtr->systemPaths.AddPluginPaths(_path);
+
+  // Previously missing plugins may be found on the new paths
+  this->dataPtr->failedTypes.clear();
+}
+
+//////////////////////////////////////////////////
+bool SensorFactory::PreloadSensorPlugins(
+    const std::vector<std::string> &_types)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  bool result = true;
+  StaticSensorType staticType;
+  for (const auto &type : _types)
+  {
+    if (!FindStaticSensorType(type, staticType))
+      result = this->SensorPluginForType(type, true) != nullptr && result;
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+std::vector<std::string> SensorFactory::PreloadAllSensorPlugins()
+{
+  static const std::vector<std::string> kBuiltinTypes =
+  {
+    "air_pressure",
+    "altimeter",
+    "camera",
+    "depth_camera",
+    "gpu_lidar",
+    "imu",
+    "lidar",
+    "logical_camera",
+    "magnetometer",
+    "rgbd_camera",
+    "thermal_camera",
+  };
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  std::vector<std::string> loaded;
+  StaticSensorType staticType;
+  for (const auto &type : kBuiltinTypes)
+  {
+    if (FindStaticSensorType(type, staticType) ||
+        this->SensorPluginForType(type, false))
+    {
+      loaded.push_back(type);
+    }
+  }
+  return loaded;
+}
+
+//////////////////////////////////////////////////
+bool SensorFactory::SensorPluginLoaded(const std::string &_type) const
+{
+  StaticSensorType staticType;
+  if (FindStaticSensorType(_type, staticType))
+    return true;
+
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  return this->dataPtr->sensorPlugins.find(_type) !=
+      this->dataPtr->sensorPlugins.end();
+}
+
+//////////////////////////////////////////////////
+std::shared_ptr<SensorPlugin> SensorFactory::SensorPluginForType(
+    const std::string &_type, const bool _verbose)
+{
+  auto it = this->dataPtr->sensorPlugins.find(_type);
+  if (it != this->dataPtr->sensorPlugins.end())
+    return it->second;
+
+  std::string fullPath = IGN_SENSORS_PLUGIN_NAME(_type);
+  if (this->dataPtr->failedTypes.count(_type) > 0)
+  {
+    if (_verbose)
+    {
+      ignerr << "Unable to instantiate sensor plugin for [" << fullPath
+             << "]\n";
+    }
+    return nullptr;
+  }
+
+  std::shared_ptr<SensorPlugin> sensorPlugin;
+  if (_verbose ||
+      !this->dataPtr->systemPaths.FindSharedLibrary(fullPath).empty())
+  {
+    sensorPlugin = this->LoadSensorPlugin(fullPath);
+  }
+
+  if (!sensorPlugin)
+  {
+    if (_verbose)
+    {
+      ignerr << "Unable to instantiate sensor plugin for [" << fullPath
+             << "]\n";
+    }
+    this->dataPtr->failedTypes.insert(_type);
+    return nullptr;
+  }
+
+  this->dataPtr->sensorPlugins[_type] = sensorPlugin;
+  return sensorPlugin;
 }
 
 //////////////////////////////////////////////////
@@ -93,37 +243,127 @@ std::shared_ptr<SensorPlugin> SensorFactory::LoadSensorPlugin(
   return sensorPlugin;
 }
 
+//////////////////////////////////////////////////
+void SensorFactory::RegisterStaticSensorTypes(
+    const StaticSensorType *_types, const std::size_t _count)
+{
+  auto &registry = StaticRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (std::size_t i = 0u; i < _count; ++i)
+  {
+    auto iter = std::lower_bound(registry.types.begin(),
+        registry.types.end(), _types[i], StaticTypeLess);
+    if (iter != registry.types.end() && !StaticTypeLess(_types[i], *iter))
+      *iter = _types[i];
+    else
+      registry.types.insert(iter, _types[i]);
+  }
+}
+
+//////////////////////////////////////////////////
+bool SensorFactory::FindStaticSensorType(const std::string &_type,
+    StaticSensorType &_entry)
+{
+  auto &registry = StaticRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  const StaticSensorType key{_type.c_str(), nullptr};
+  auto iter = std::lower_bound(registry.types.begin(), registry.types.end(),
+      key, StaticTypeLess);
+  if (iter == registry.types.end() || StaticTypeLess(key, *iter))
+    return false;
+  _entry = *iter;
+  return true;
+}
+
 /////////////////////////////////////////////////
-std::unique_ptr<Sensor> SensorFactory::CreateSensor(const sdf::Sensor &_sdf)
+std::unique_ptr<Sensor> SensorFactory::NewSensor(const std::string &_type)
 {
-  std::unique_ptr<Sensor> result;
-  std::shared_ptr<SensorPlugin> sensorPlugin;
-  std::string type = _sdf.TypeStr();
-  std::string fullPath = IGN_SENSORS_PLUGIN_NAME(type);
+  std::unique_ptr<Sensor> sensor;
 
-  auto it = this->dataPtr->sensorPlugins.find(type);
-  if (it != this->dataPtr->sensorPlugins.end())
-    sensorPlugin = it->second;
+  // Types linked into the application don't need a plugin
+  StaticSensorType staticType;
+  if (FindStaticSensorType(_type, staticType))
+  {
+    sensor.reset(staticType.create());
+    if (!sensor)
+    {
+      ignerr << "Unable to instantiate sensor of type [" << _type << "]\n";
+      return nullptr;
+    }
+  }
   else
   {
-    sensorPlugin = this->LoadSensorPlugin(fullPath);
+    std::shared_ptr<SensorPlugin> sensorPlugin;
+    {
+      std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+      sensorPlugin = this->SensorPluginForType(_type, true);
+    }
     if (!sensorPlugin)
+      return nullptr;
+
+    sensor.reset(sensorPlugin->New());
+    if (!sensor)
     {
-      ignerr << "Unable to instantiate sensor plugin for [" << fullPath
-        << "]\n";
+      ignerr << "Unable to instantiate sensor for ["
+             << IGN_SENSORS_PLUGIN_NAME(_type) << "]\n";
       return nullptr;
     }
+  }
 
-    this->dataPtr->sensorPlugins[type] = sensorPlugin;
+  std::shared_ptr<ignition::transport::Node> node;
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    node = this->dataPtr->node;
   }
+  if (node)
+    sensor->SetTransportNode(std::move(node));
+  return sensor;
+}
 
-  auto sensor = sensorPlugin->New();
-  if (!sensor)
+//////////////////////////////////////////////////
+void SensorFactory::SetTransportNode(
+    std::shared_ptr<ignition::transport::Node> _node)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+  this->dataPtr->node = std::move(_node);
+}
+
+/////////////////////////////////////////////////
+std::unique_ptr<Sensor> SensorFactory::CloneSensor(const Sensor &_sensor,
+    const std::string &_name, const std::string &_topic,
+    const std::string &_parent)
+{
+  sdf::Sensor sdfSensor = _sensor.SdfSensor();
+  if (sdfSensor.Type() == sdf::SensorType::NONE)
   {
-    ignerr << "Unable to instantiate sensor for [" << fullPath << "]\n";
+    ignerr << "Unable to clone sensor [" << _sensor.Name()
+           << "], it hasn't been loaded.\n";
     return nullptr;
   }
 
+  sdfSensor.SetName(_name);
+  sdfSensor.SetTopic(_topic);
+  sdfSensor.SetUpdateRate(_sensor.UpdateRate());
+
+  auto sensor = this->CreateSensor(sdfSensor);
+  if (!sensor)
+    return nullptr;
+
+  sensor->SetPose(_sensor.Pose());
+  sensor->SetParent(_parent);
+  return sensor;
+}
+
+/////////////////////////////////////////////////
+std::unique_ptr<Sensor> SensorFactory::CreateSensor(const sdf::Sensor &_sdf)
+{
+  std::string type = _sdf.TypeStr();
+  std::string fullPath = IGN_SENSORS_PLUGIN_NAME(type);
+
+  auto sensor = this->NewSensor(type);
+  if (!sensor)
+    return nullptr;
+
   if (!sensor->Load(_sdf))
   {
     ignerr << "Sensor::Load failed for plugin [" << fullPath << "]\n";
@@ -136,43 +376,22 @@ std::unique_ptr<Sensor> SensorFactory::CreateSensor(const sdf::Sensor &_sdf)
     return nullptr;
   }
 
-  result.reset(sensor);
-  return result;
+  return sensor;
 }
 
 /////////////////////////////////////////////////
 std::unique_ptr<Sensor> SensorFactory::CreateSensor(sdf::ElementPtr _sdf)
 {
-  std::unique_ptr<Sensor> result;
   if (_sdf)
   {
     if (_sdf->GetName() == "sensor")
     {
-      std::shared_ptr<SensorPlugin> sensorPlugin;
       std::string type = _sdf->Get<std::string>("type");
       std::string fullPath = IGN_SENSORS_PLUGIN_NAME(type);
-      auto it = this->dataPtr->sensorPlugins.find(type);
-      if (it != this->dataPtr->sensorPlugins.end())
-        sensorPlugin = it->second;
-      else
-      {
-        sensorPlugin = this->LoadSensorPlugin(fullPath);
-        if (!sensorPlugin)
-        {
-          ignerr << "Unable to instantiate sensor plugin for [" << fullPath
-                 << "]\n";
-          return nullptr;
-        }
-
-        this->dataPtr->sensorPlugins[type] = sensorPlugin;
-      }
 
-      auto sensor = sensorPlugin->New();
+      auto sensor = this->NewSensor(type);
       if (!sensor)
-      {
-        ignerr << "Unable to instantiate sensor for [" << fullPath << "]\n";
         return nullptr;
-      }
 
       if (!sensor->Load(_sdf))
       {
@@ -185,8 +404,7 @@ std::unique_ptr<Sensor> SensorFactory::CreateSensor(sdf::ElementPtr _sdf)
         ignerr << "Sensor::Init failed for plugin [" << fullPath << "]\n";
         return nullptr;
       }
-      result.reset(sensor);
-      return result;
+      return sensor;
     }
     else
     {
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "ignition/sensors/SensorStats.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Allocations recorded by the current thread
+static thread_local uint64_t tlsAllocations = 0u;
+
+//////////////////////////////////////////////////
+void SensorStats::RecordAllocation()
+{
+  ++tlsAllocations;
+}
+
+//////////////////////////////////////////////////
+uint64_t SensorStats::ThreadAllocationCount()
+{
+  return tlsAllocations;
+}
+
+//////////////////////////////////////////////////
+void TimeStats::Add(const std::chrono::steady_clock::duration &_time)
+{
+  ++this->count;
+  this->total += _time;
+  if (_time > this->max)
+    this->max = _time;
+
+  // Find the histogram bin from the number of bits of the time in
+  // microseconds.
+  auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+      _time).count();
+  std::size_t bin = 0u;
+  while (usec > 0 && bin < kHistogramBins - 1u)
+  {
+    usec >>= 1;
+    ++bin;
+  }
+  ++this->histogram[bin];
+}
+
+//////////////////////////////////////////////////
+std::chrono::steady_clock::duration TimeStats::Percentile(
+    const double _fraction) const
+{
+  if (this->count == 0u)
+    return std::chrono::steady_clock::duration::zero();
+
+  // Rank of the sample at the percentile, starting at 1
+  const double fraction = std::min(1.0, std::max(0.0, _fraction));
+  const uint64_t rank = std::max<uint64_t>(1u, static_cast<uint64_t>(
+      std::ceil(fraction * static_cast<double>(this->count))));
+
+  uint64_t seen = 0u;
+  for (std::size_t bin = 0u; bin + 1u < kHistogramBins; ++bin)
+  {
+    seen += this->histogram[bin];
+    if (seen >= rank)
+    {
+      // Bin i holds samples shorter than 2^i microseconds
+      const std::chrono::steady_clock::duration upper =
+          std::chrono::microseconds(uint64_t(1u) << bin);
+      return std::min(upper, this->max);
+    }
+  }
+  return this->max;
+}
+
+//////////////////////////////////////////////////
+SensorMemory &SensorMemory::operator+=(const SensorMemory &_other)
+{
+  this->renderTargetBytes += _other.renderTargetBytes;
+  this->readbackBytes += _other.readbackBytes;
+  this->messageBytes += _other.messageBytes;
+  return *this;
+}
@@ -16,9 +16,25 @@
 */
 #include <gtest/gtest.h>
 
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sdf/Magnetometer.hh>
+#include <sdf/Noise.hh>
+#include <sdf/Sensor.hh>
+
 #include <ignition/common/Console.hh>
+#include <ignition/msgs/boolean.pb.h>
+#include <ignition/msgs/image.pb.h>
+#include <ignition/msgs/int32.pb.h>
+#include <ignition/transport/Node.hh>
 #include <ignition/sensors/Export.hh>
+#include <ignition/sensors/PipelineTrace.hh>
 #include <ignition/sensors/Sensor.hh>
+#include <ignition/sensors/SensorFactory.hh>
+#include <ignition/sensors/SharedMemoryRing.hh>
 
 using namespace ignition;
 using namespace sensors;
@@ -27,7 +43,10 @@ class TestSensor : public Sensor
 {
   public: bool Update(const std::chrono::steady_clock::duration &) override
   {
+    auto start = std::chrono::steady_clock::now();
     updateCount++;
+    this->RecordPhase(UpdatePhase::MESSAGE, start);
+    this->RecordPublishedBytes(10u);
     return true;
   }
 
@@ -39,6 +58,158 @@ class TestSensor : public Sensor
   public: unsigned int updateCount{0};
 };
 
+class PublishingSensor : public TestSensor
+{
+  public: PublishingSensor()
+  {
+    this->pub = this->node.Advertise<msgs::Int32>("/sensor_test_async");
+  }
+
+  public: bool Update(const std::chrono::steady_clock::duration &) override
+  {
+    msgs::Int32 msg;
+    msg.set_data(static_cast<int>(updateCount++));
+    return this->Publish(this->pub, msg);
+  }
+
+  public: transport::Node node;
+
+  public: transport::Node::Publisher pub;
+};
+
+class ImageSensor : public TestSensor
+{
+  public: ImageSensor()
+  {
+    this->pub = this->node.Advertise<msgs::Image>("/sensor_test_shm");
+  }
+
+  public: bool Update(const std::chrono::steady_clock::duration &_now)
+      override
+  {
+    this->msg.set_width(static_cast<uint32_t>(++updateCount));
+    this->msg.set_data(std::string(64u, static_cast<char>(updateCount)));
+    this->StampHeader(this->msg.mutable_header(), _now);
+    return this->PublishShared(this->pub, this->msg,
+        this->msg.mutable_data(), this->msg.mutable_header());
+  }
+
+  public: transport::Node node;
+
+  public: transport::Node::Publisher pub;
+
+  public: msgs::Image msg;
+};
+
+class LazySensor : public TestSensor
+{
+  public: bool HasConnections() const override
+  {
+    return this->connected;
+  }
+
+  public: bool connected = false;
+};
+
+class UnreadySensor : public TestSensor
+{
+  public: bool Ready() const override
+  {
+    return this->ready;
+  }
+
+  public: bool ready = false;
+};
+
+class BusySensor : public TestSensor
+{
+  public: bool ConsumersBusy() const override
+  {
+    return this->busy;
+  }
+
+  public: bool busy = false;
+};
+
+class StagedSensor : public TestSensor
+{
+  public: bool SupportsStagedUpdates() const override
+  {
+    return true;
+  }
+
+  public: bool Update(const std::chrono::steady_clock::duration &) override
+  {
+    this->rendered = true;
+    if (!this->StagedUpdates())
+    {
+      this->ReadbackFrame();
+      this->ProcessFrame();
+    }
+    return true;
+  }
+
+  public: void ReadbackFrame() override
+  {
+    this->copied = this->rendered;
+    this->rendered = false;
+  }
+
+  public: void ProcessFrame() override
+  {
+    if (this->copied)
+      ++this->updateCount;
+    this->copied = false;
+  }
+
+  public: bool rendered = false;
+
+  public: bool copied = false;
+};
+
+class PipelinedSensor : public TestSensor
+{
+  public: bool Update(const std::chrono::steady_clock::duration &_now)
+      override
+  {
+    // Publish the frame of the previous update
+    if (this->hasPrevious)
+    {
+      this->StampHeader(this->msg.mutable_header(), this->previous);
+      this->RecordPublishedBytes(this->msg.ByteSizeLong());
+    }
+    this->previous = _now;
+    this->hasPrevious = true;
+    return true;
+  }
+
+  public: std::chrono::steady_clock::duration previous;
+
+  public: bool hasPrevious = false;
+
+  public: msgs::Image msg;
+};
+
+class CountingSensor : public TestSensor
+{
+  public: bool Update(const std::chrono::steady_clock::duration &) override
+  {
+    auto start = std::chrono::steady_clock::now();
+    SensorStats::RecordAllocation();
+    SensorStats::RecordAllocation();
+    this->RecordPhase(UpdatePhase::COPY, start);
+    this->RecordReadbackBytes(32u);
+
+    start = std::chrono::steady_clock::now();
+    SensorStats::RecordAllocation();
+    this->RecordPhase(UpdatePhase::MESSAGE, start);
+
+    // Allocations after the last phase only count in the whole update
+    SensorStats::RecordAllocation();
+    return true;
+  }
+};
+
 /// \brief Test sensor class
 class Sensor_TEST : public ::testing::Test
 {
@@ -66,10 +237,26 @@ TEST(Sensor_TEST, Sensor)
   sensor.SetUpdateRate(-123);
   EXPECT_DOUBLE_EQ(0, sensor.UpdateRate());
 
+  EXPECT_EQ(0, sensor.Priority());
+  sensor.SetPriority(-3);
+  EXPECT_EQ(-3, sensor.Priority());
+
+  EXPECT_EQ(RenderQualityProfile::FULL, sensor.RenderQuality());
+  sensor.SetRenderQuality(RenderQualityProfile::FAST);
+  EXPECT_EQ(RenderQualityProfile::FAST, sensor.RenderQuality());
+
   EXPECT_EQ("", sensor.Parent());
   sensor.SetParent("banana");
   EXPECT_EQ("banana", sensor.Parent());
 
+  EXPECT_EQ("", sensor.WorldName());
+  sensor.SetWorldName("orchard");
+  EXPECT_EQ("orchard", sensor.WorldName());
+
+  EXPECT_EQ(0u, sensor.RenderDevice());
+  sensor.SetRenderDevice(3u);
+  EXPECT_EQ(3u, sensor.RenderDevice());
+
   EXPECT_EQ("", sensor.Name());
 
   EXPECT_EQ("", sensor.Topic());
@@ -77,6 +264,795 @@ TEST(Sensor_TEST, Sensor)
   EXPECT_EQ(1u, sensor.Id());
 
   EXPECT_EQ(nullptr, sensor.SDF());
+
+  EXPECT_FALSE(sensor.IsRenderingSensor());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, UpdateSchedule)
+{
+  using namespace std::chrono_literals;
+  TestSensor sensor;
+  EXPECT_EQ(CatchUpPolicy::BURST, sensor.CatchUp());
+
+  // Update times of rates that don't divide a second don't drift
+  sensor.SetUpdateRate(300);
+  for (int i = 0; i < 300; ++i)
+    EXPECT_TRUE(sensor.Update(sensor.NextDataUpdateTime(), false));
+  EXPECT_EQ(300u, sensor.updateCount);
+  EXPECT_EQ(1s, sensor.NextDataUpdateTime());
+
+  // Changing the rate keeps the pending update time
+  sensor.SetUpdateRate(10);
+  EXPECT_EQ(1s, sensor.NextDataUpdateTime());
+  EXPECT_FALSE(sensor.Update(999ms, false));
+  EXPECT_TRUE(sensor.Update(1s, false));
+  EXPECT_EQ(1100ms, sensor.NextDataUpdateTime());
+
+  // Forced updates don't change the schedule
+  EXPECT_TRUE(sensor.Update(1050ms, true));
+  EXPECT_EQ(1100ms, sensor.NextDataUpdateTime());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Triggered)
+{
+  using namespace std::chrono_literals;
+  TestSensor sensor;
+  sensor.SetUpdateRate(10);
+  EXPECT_FALSE(sensor.Triggered());
+
+  // Sensors that aren't triggered ignore triggers
+  sensor.Trigger();
+  EXPECT_FALSE(sensor.TriggerPending());
+
+  // Triggered sensors stay idle until triggered
+  sensor.SetTriggered(true);
+  EXPECT_TRUE(sensor.Triggered());
+  EXPECT_EQ(std::chrono::steady_clock::duration::max(),
+      sensor.NextDataUpdateTime());
+  EXPECT_FALSE(sensor.Update(1s, false));
+  EXPECT_EQ(0u, sensor.updateCount);
+
+  // Triggers before an update coalesce into one
+  sensor.Trigger();
+  sensor.Trigger();
+  EXPECT_TRUE(sensor.TriggerPending());
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(),
+      sensor.NextDataUpdateTime());
+  EXPECT_TRUE(sensor.Update(1050ms, false));
+  EXPECT_EQ(1u, sensor.updateCount);
+  EXPECT_FALSE(sensor.TriggerPending());
+  EXPECT_FALSE(sensor.Update(2s, false));
+  EXPECT_EQ(1u, sensor.updateCount);
+
+  // Forced updates still happen
+  EXPECT_TRUE(sensor.Update(2s, true));
+  EXPECT_EQ(2u, sensor.updateCount);
+
+  // Triggers also come in as messages
+  EXPECT_FALSE(sensor.SetTriggerTopic(""));
+  EXPECT_TRUE(sensor.TriggerTopic().empty());
+  ASSERT_TRUE(sensor.SetTriggerTopic("/sensor_test_trigger"));
+  EXPECT_EQ("/sensor_test_trigger", sensor.TriggerTopic());
+
+  transport::Node node;
+  auto pub = node.Advertise<msgs::Boolean>("/sensor_test_trigger");
+  msgs::Boolean msg;
+  msg.set_data(false);
+  for (int i = 0; i < 20; ++i)
+  {
+    pub.Publish(msg);
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_FALSE(sensor.TriggerPending());
+
+  msg.set_data(true);
+  for (int i = 0; i < 100 && !sensor.TriggerPending(); ++i)
+  {
+    pub.Publish(msg);
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_TRUE(sensor.TriggerPending());
+  EXPECT_TRUE(sensor.Update(3s, false));
+  EXPECT_EQ(3u, sensor.updateCount);
+
+  // Back to its update rate
+  sensor.SetTriggered(false);
+  EXPECT_NE(std::chrono::steady_clock::duration::max(),
+      sensor.NextDataUpdateTime());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, CatchUpPolicy)
+{
+  using namespace std::chrono_literals;
+
+  // Burst generates every missed update
+  {
+    TestSensor sensor;
+    sensor.SetUpdateRate(10);
+    EXPECT_TRUE(sensor.Update(1050ms, false));
+    EXPECT_EQ(100ms, sensor.NextDataUpdateTime());
+  }
+
+  // Skip jumps to the next update in the future, keeping the phase
+  {
+    TestSensor sensor;
+    sensor.SetUpdateRate(10);
+    sensor.SetCatchUpPolicy(CatchUpPolicy::SKIP);
+    EXPECT_EQ(CatchUpPolicy::SKIP, sensor.CatchUp());
+    EXPECT_TRUE(sensor.Update(1050ms, false));
+    EXPECT_EQ(1100ms, sensor.NextDataUpdateTime());
+  }
+
+  // Cap generates at most the given number of missed updates
+  {
+    TestSensor sensor;
+    sensor.SetUpdateRate(10);
+    sensor.SetCatchUpPolicy(CatchUpPolicy::CAP, 2u);
+    EXPECT_EQ(CatchUpPolicy::CAP, sensor.CatchUp());
+    EXPECT_EQ(2u, sensor.MaxMissedUpdates());
+    EXPECT_TRUE(sensor.Update(1050ms, false));
+    EXPECT_EQ(900ms, sensor.NextDataUpdateTime());
+    EXPECT_TRUE(sensor.Update(1050ms, false));
+    EXPECT_TRUE(sensor.Update(1050ms, false));
+    EXPECT_EQ(1100ms, sensor.NextDataUpdateTime());
+    EXPECT_FALSE(sensor.Update(1050ms, false));
+    EXPECT_EQ(3u, sensor.updateCount);
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Stats)
+{
+  using namespace std::chrono_literals;
+  TestSensor sensor;
+  EXPECT_EQ(0u, sensor.Stats().updateCount);
+
+  sensor.SetUpdateRate(10);
+  sensor.SetCatchUpPolicy(CatchUpPolicy::SKIP);
+  EXPECT_TRUE(sensor.Update(0ms, false));
+  EXPECT_TRUE(sensor.Update(100ms, false));
+  EXPECT_FALSE(sensor.Update(150ms, false));
+  EXPECT_TRUE(sensor.Update(550ms, false));
+
+  SensorStats stats = sensor.Stats();
+  EXPECT_EQ(3u, stats.updateCount);
+  EXPECT_EQ(0u, stats.failedUpdateCount);
+  EXPECT_EQ(3u, stats.skippedUpdateCount);
+  EXPECT_EQ(30u, stats.bytesPublished);
+  EXPECT_EQ(3u, stats.update.count);
+  EXPECT_EQ(3u, stats.publishDelay.count);
+  EXPECT_LE(stats.publishDelay.max, stats.update.max);
+  EXPECT_EQ(3u, stats.phases[static_cast<int>(UpdatePhase::MESSAGE)].count);
+  EXPECT_EQ(0u, stats.phases[static_cast<int>(UpdatePhase::RENDER)].count);
+
+  uint64_t histogramCount = 0u;
+  for (auto count : stats.update.histogram)
+    histogramCount += count;
+  EXPECT_EQ(3u, histogramCount);
+
+  sensor.ResetStats();
+  EXPECT_EQ(0u, sensor.Stats().updateCount);
+  EXPECT_EQ(0u, sensor.Stats().bytesPublished);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, PhaseCounters)
+{
+  using namespace std::chrono_literals;
+  CountingSensor sensor;
+  EXPECT_TRUE(sensor.Update(0ms, false));
+  EXPECT_TRUE(sensor.Update(100ms, false));
+
+  SensorStats stats = sensor.Stats();
+  EXPECT_EQ(64u, stats.bytesReadBack);
+  EXPECT_EQ(4u, stats.phases[static_cast<int>(UpdatePhase::COPY)].allocations);
+  EXPECT_EQ(2u,
+      stats.phases[static_cast<int>(UpdatePhase::MESSAGE)].allocations);
+  EXPECT_EQ(8u, stats.update.allocations);
+
+  // Allocations outside of updates are not counted
+  const uint64_t count = SensorStats::ThreadAllocationCount();
+  SensorStats::RecordAllocation();
+  EXPECT_EQ(count + 1u, SensorStats::ThreadAllocationCount());
+  EXPECT_EQ(8u, sensor.Stats().update.allocations);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, PipelineTrace)
+{
+  using namespace std::chrono_literals;
+  CountingSensor sensor;
+  PipelineTrace::Enable(16u);
+  EXPECT_TRUE(sensor.Update(100ms, false));
+  PipelineTrace::Disable();
+
+  // The phases finish before the update that holds them
+  auto events = PipelineTrace::Events();
+  ASSERT_EQ(3u, events.size());
+  EXPECT_EQ(TraceStage::READBACK, events[0].stage);
+  EXPECT_EQ(TraceStage::FILL, events[1].stage);
+  EXPECT_EQ(TraceStage::SCHEDULE, events[2].stage);
+  for (const auto &event : events)
+  {
+    EXPECT_EQ(sensor.Id(), event.sensor);
+    EXPECT_EQ(std::chrono::steady_clock::duration(100ms), event.simTime);
+    EXPECT_GE(event.start, events[2].start);
+    EXPECT_LE(event.start + event.duration,
+        events[2].start + events[2].duration);
+  }
+
+  // Nothing is recorded while disabled
+  EXPECT_TRUE(sensor.Update(200ms, false));
+  EXPECT_EQ(3u, PipelineTrace::Events().size());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Percentile)
+{
+  using namespace std::chrono_literals;
+  TimeStats stats;
+  EXPECT_EQ(0us, stats.Percentile(0.5));
+
+  // 90 samples of 3us, in the bin up to 4us, and 10 of 100us
+  for (int i = 0; i < 90; ++i)
+    stats.Add(3us);
+  for (int i = 0; i < 10; ++i)
+    stats.Add(100us);
+
+  EXPECT_EQ(4us, stats.Percentile(0.5));
+  EXPECT_EQ(4us, stats.Percentile(0.9));
+  EXPECT_EQ(100us, stats.Percentile(0.99));
+  EXPECT_EQ(100us, stats.Percentile(1.0));
+  EXPECT_EQ(4us, stats.Percentile(-1.0));
+
+  // Samples beyond the last bin are reported as the longest one
+  stats.Add(1h);
+  EXPECT_EQ(std::chrono::steady_clock::duration(1h), stats.Percentile(1.0));
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, PublishDelay)
+{
+  using namespace std::chrono_literals;
+  PipelinedSensor sensor;
+  sensor.SetUpdateRate(10);
+  EXPECT_TRUE(sensor.Update(0ms, false));
+  std::this_thread::sleep_for(20ms);
+  EXPECT_TRUE(sensor.Update(100ms, false));
+
+  // The frame published by the second update is timed from the first one
+  SensorStats stats = sensor.Stats();
+  EXPECT_EQ(1u, stats.publishDelay.count);
+  EXPECT_GE(stats.publishDelay.max,
+      std::chrono::steady_clock::duration(20ms));
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, MemoryUsage)
+{
+  // The base class holds no buffers
+  TestSensor sensor;
+  SensorMemory memory = sensor.MemoryUsage();
+  EXPECT_EQ(0u, memory.renderTargetBytes);
+  EXPECT_EQ(0u, memory.readbackBytes);
+  EXPECT_EQ(0u, memory.messageBytes);
+
+  SensorMemory other;
+  other.renderTargetBytes = 1u;
+  other.readbackBytes = 2u;
+  other.messageBytes = 3u;
+  memory += other;
+  memory += other;
+  EXPECT_EQ(2u, memory.renderTargetBytes);
+  EXPECT_EQ(4u, memory.readbackBytes);
+  EXPECT_EQ(6u, memory.messageBytes);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, AsyncPublish)
+{
+  std::mutex mutex;
+  std::vector<int> received;
+  transport::Node node;
+  std::function<void(const msgs::Int32 &)> cb =
+      [&](const msgs::Int32 &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(_msg.data());
+      };
+  ASSERT_TRUE(node.Subscribe("/sensor_test_async", cb));
+
+  PublishingSensor sensor;
+  EXPECT_FALSE(sensor.AsyncPublish());
+  sensor.SetAsyncPublish(true, 1u, PublishDropPolicy::BLOCK);
+  EXPECT_TRUE(sensor.AsyncPublish());
+
+  const int count = 20;
+  for (int i = 0; i < count; ++i)
+    EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+
+  // Disabling waits for all queued messages
+  sensor.SetAsyncPublish(false);
+  EXPECT_FALSE(sensor.AsyncPublish());
+
+  for (int sleep = 0; sleep < 100; ++sleep)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (received.size() >= static_cast<std::size_t>(count))
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Blocking never drops, and messages stay in order
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(static_cast<std::size_t>(count), received.size());
+  for (int i = 0; i < count; ++i)
+    EXPECT_EQ(i, received[i]);
+  EXPECT_EQ(0u, sensor.Stats().droppedMessageCount);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Reconfigure)
+{
+  sdf::Sensor sdf;
+  sdf.SetName("reconfigured");
+  sdf.SetType(sdf::SensorType::MAGNETOMETER);
+  sdf.SetTopic("/sensor_test_reconfigure");
+  sdf.SetUpdateRate(10);
+  sdf.SetMagnetometerSensor(sdf::Magnetometer());
+
+  TestSensor sensor;
+  ASSERT_TRUE(sensor.Load(sdf));
+  EXPECT_DOUBLE_EQ(10.0, sensor.UpdateRate());
+
+  // Common settings change in place
+  sdf::Sensor faster = sdf;
+  faster.SetUpdateRate(20);
+  faster.SetRawPose(math::Pose3d(1, 2, 3, 0, 0, 0));
+  EXPECT_TRUE(sensor.Reconfigure(faster));
+  EXPECT_DOUBLE_EQ(20.0, sensor.UpdateRate());
+  EXPECT_EQ(math::Pose3d(1, 2, 3, 0, 0, 0), sensor.Pose());
+  EXPECT_EQ("/sensor_test_reconfigure", sensor.Topic());
+
+  // Other changes need a new sensor, and leave the sensor unchanged
+  sdf::Sensor moved = faster;
+  moved.SetTopic("/sensor_test_reconfigure_moved");
+  moved.SetUpdateRate(30);
+  EXPECT_FALSE(sensor.Reconfigure(moved));
+  EXPECT_DOUBLE_EQ(20.0, sensor.UpdateRate());
+
+  sdf::Noise noise;
+  noise.SetType(sdf::NoiseType::GAUSSIAN);
+  noise.SetStdDev(0.1);
+  sdf::Magnetometer magnetometer;
+  magnetometer.SetXNoise(noise);
+  sdf::Sensor noisy = faster;
+  noisy.SetMagnetometerSensor(magnetometer);
+  noisy.SetUpdateRate(30);
+  EXPECT_FALSE(sensor.Reconfigure(noisy));
+  EXPECT_DOUBLE_EQ(20.0, sensor.UpdateRate());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, ShareSdf)
+{
+  sdf::Sensor sdf;
+  sdf.SetName("source");
+  sdf.SetType(sdf::SensorType::MAGNETOMETER);
+  sdf.SetTopic("/sensor_test_share");
+  sdf.SetUpdateRate(10);
+  sdf.SetMagnetometerSensor(sdf::Magnetometer());
+
+  TestSensor source;
+  ASSERT_TRUE(source.Load(sdf));
+
+  sdf::Sensor cloneSdf = sdf;
+  cloneSdf.SetName("clone");
+  cloneSdf.SetTopic("/sensor_test_share/clone");
+  cloneSdf.SetUpdateRate(5);
+  TestSensor clone;
+  ASSERT_TRUE(clone.Load(cloneSdf));
+  EXPECT_FALSE(clone.Compact());
+  clone.SetCompact(true);
+  EXPECT_TRUE(clone.Compact());
+
+  // A clone keeps its own name, topic and rate when sharing the SDF
+  EXPECT_TRUE(clone.ShareSdf(source));
+  EXPECT_EQ(&source.SdfSensor(), &clone.SdfSensor());
+  EXPECT_EQ("clone", clone.Name());
+  EXPECT_EQ("/sensor_test_share/clone", clone.Topic());
+  EXPECT_DOUBLE_EQ(5.0, clone.UpdateRate());
+
+  // It's reconfigured against its own SDF, and gets a copy again
+  sdf::Sensor faster = cloneSdf;
+  faster.SetUpdateRate(20);
+  EXPECT_TRUE(clone.Reconfigure(faster));
+  EXPECT_DOUBLE_EQ(20.0, clone.UpdateRate());
+  EXPECT_NE(&source.SdfSensor(), &clone.SdfSensor());
+  EXPECT_EQ("clone", clone.SdfSensor().Name());
+
+  sdf::Sensor moved = faster;
+  moved.SetTopic("/sensor_test_share/moved");
+  EXPECT_FALSE(clone.Reconfigure(moved));
+
+  // Sensors with other settings don't share
+  sdf::Noise noise;
+  noise.SetType(sdf::NoiseType::GAUSSIAN);
+  noise.SetStdDev(0.1);
+  sdf::Magnetometer magnetometer;
+  magnetometer.SetXNoise(noise);
+  sdf::Sensor noisy = cloneSdf;
+  noisy.SetMagnetometerSensor(magnetometer);
+  TestSensor other;
+  ASSERT_TRUE(other.Load(noisy));
+  EXPECT_FALSE(other.ShareSdf(source));
+
+  TestSensor unloaded;
+  EXPECT_FALSE(unloaded.ShareSdf(source));
+  EXPECT_EQ(nullptr, unloaded.SDF());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, DeferredPublish)
+{
+  std::mutex mutex;
+  std::vector<int> received;
+  transport::Node node;
+  std::function<void(const msgs::Int32 &)> cb =
+      [&](const msgs::Int32 &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(_msg.data());
+      };
+  ASSERT_TRUE(node.Subscribe("/sensor_test_async", cb));
+
+  PublishingSensor sensor;
+  EXPECT_FALSE(sensor.DeferredPublish());
+  sensor.SetDeferredPublish(true);
+  EXPECT_TRUE(sensor.DeferredPublish());
+
+  // Nothing is published until the messages are committed
+  const int count = 5;
+  for (int i = 0; i < count; ++i)
+    EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_TRUE(received.empty());
+  }
+
+  EXPECT_TRUE(sensor.CommitPublishes());
+  EXPECT_TRUE(sensor.CommitPublishes());
+
+  // Disabling publishes the messages held back
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+  sensor.SetDeferredPublish(false);
+  EXPECT_FALSE(sensor.DeferredPublish());
+
+  for (int sleep = 0; sleep < 100; ++sleep)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (received.size() >= static_cast<std::size_t>(count + 1))
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // Messages are published once each, in order
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(static_cast<std::size_t>(count + 1), received.size());
+  for (int i = 0; i <= count; ++i)
+    EXPECT_EQ(i, received[i]);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, PublishCallback)
+{
+  class TopicSensor : public PublishingSensor
+  {
+    public: TopicSensor()
+    {
+      this->SetTopic("/sensor_test_async");
+      this->SetOutputTopic(this->Topic(), &this->pub);
+      this->otherPub = this->node.Advertise<msgs::Int32>(
+          "/sensor_test_async/other");
+      this->SetOutputTopic("/sensor_test_async/other", &this->otherPub);
+    }
+
+    public: bool PublishOther()
+    {
+      return this->Publish(this->otherPub, msgs::Int32());
+    }
+
+    public: transport::Node::Publisher otherPub;
+  };
+
+  TopicSensor sensor;
+  std::vector<int> values;
+  sensor.SetPublishCallback(
+      [&](SensorId _id, const google::protobuf::Message &_msg)
+      {
+        EXPECT_EQ(sensor.Id(), _id);
+        values.push_back(dynamic_cast<const msgs::Int32 &>(_msg).data());
+      });
+
+  // Only the messages on the topic of the sensor are passed
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+  sensor.PublishOther();
+  EXPECT_EQ((std::vector<int>{0, 1}), values);
+
+  sensor.SetPublishCallback(nullptr);
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero()));
+  EXPECT_EQ(2u, values.size());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, TransportNode)
+{
+  class NodeSensor : public TestSensor
+  {
+    public: bool Advertise(const std::string &_topic)
+    {
+      this->pub = this->TransportNode().Advertise<msgs::Int32>(_topic);
+      return static_cast<bool>(this->pub);
+    }
+
+    public: transport::Node *Node()
+    {
+      return &this->TransportNode();
+    }
+
+    public: transport::Node::Publisher pub;
+  };
+
+  auto node = std::make_shared<transport::Node>();
+  NodeSensor first;
+  NodeSensor second;
+  EXPECT_TRUE(first.SetTransportNode(node));
+  EXPECT_TRUE(second.SetTransportNode(node));
+  EXPECT_TRUE(first.Advertise("/sensor_test_node/first"));
+  EXPECT_TRUE(second.Advertise("/sensor_test_node/second"));
+  EXPECT_EQ(node.get(), first.Node());
+  EXPECT_EQ(node.get(), second.Node());
+
+  // Once a sensor advertised, it keeps its node
+  EXPECT_FALSE(first.SetTransportNode(std::make_shared<transport::Node>()));
+  EXPECT_EQ(node.get(), first.Node());
+  EXPECT_TRUE(first.SetTransportNode(node));
+
+  // Sensors without a node create their own
+  NodeSensor own;
+  EXPECT_TRUE(own.Advertise("/sensor_test_node/own"));
+  EXPECT_NE(node.get(), own.Node());
+
+  // The sensors keep the shared node alive
+  node.reset();
+  EXPECT_TRUE(first.Advertise("/sensor_test_node/again"));
+  EXPECT_EQ(first.Node(), second.Node());
+}
+
+//////////////////////////////////////////////////
+#ifndef _WIN32
+TEST(Sensor_TEST, SharedMemoryPublishing)
+{
+  std::mutex mutex;
+  std::vector<msgs::Image> received;
+  transport::Node node;
+  std::function<void(const msgs::Image &)> cb =
+      [&](const msgs::Image &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(_msg);
+      };
+  EXPECT_TRUE(node.Subscribe("/sensor_test_shm", cb));
+
+  ImageSensor sensor;
+  EXPECT_FALSE(sensor.SharedMemoryPublishing());
+  EXPECT_TRUE(sensor.SetSharedMemoryPublishing(true, 2u));
+  EXPECT_TRUE(sensor.SharedMemoryPublishing());
+
+  EXPECT_TRUE(sensor.Update(std::chrono::seconds(1)));
+
+  // The sensor's own message keeps its data and header
+  EXPECT_EQ(64u, sensor.msg.data().size());
+  for (int i = 0; i < sensor.msg.header().data_size(); ++i)
+    EXPECT_NE("shm", sensor.msg.header().data(i).key());
+
+  for (int sleep = 0; sleep < 100; ++sleep)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!received.empty())
+        break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ASSERT_EQ(1u, received.size());
+  const msgs::Image &msg = received[0];
+  EXPECT_EQ(1u, msg.width());
+  EXPECT_TRUE(msg.data().empty());
+
+  const msgs::Header::Map *entry = nullptr;
+  for (int i = 0; i < msg.header().data_size(); ++i)
+  {
+    if (msg.header().data(i).key() == "shm")
+      entry = &msg.header().data(i);
+  }
+  ASSERT_NE(nullptr, entry);
+  ASSERT_EQ(3, entry->value_size());
+  EXPECT_EQ("64", entry->value(2));
+
+  SharedMemoryRing ring;
+  ASSERT_TRUE(ring.Open(entry->value(0)));
+  std::string data;
+  EXPECT_TRUE(ring.Read(std::stoull(entry->value(1)), data));
+  EXPECT_EQ(std::string(64u, static_cast<char>(1)), data);
+
+  // Disabling removes the rings
+  EXPECT_TRUE(sensor.SetSharedMemoryPublishing(false));
+  EXPECT_FALSE(sensor.SharedMemoryPublishing());
+  SharedMemoryRing removed;
+  EXPECT_FALSE(removed.Open(entry->value(0)));
+}
+#endif
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, LazyUpdates)
+{
+  LazySensor sensor;
+  EXPECT_FALSE(sensor.LazyUpdates());
+  EXPECT_FALSE(sensor.HasConnections());
+
+  // Sensors without consumers update unless lazy updates are enabled
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(1u, sensor.updateCount);
+
+  sensor.SetLazyUpdates(true);
+  EXPECT_TRUE(sensor.LazyUpdates());
+  EXPECT_FALSE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(1u, sensor.updateCount);
+  EXPECT_EQ(1u, sensor.Stats().skippedUpdateCount);
+
+  // Forced updates are never skipped
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      true));
+  EXPECT_EQ(2u, sensor.updateCount);
+
+  sensor.connected = true;
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(3u, sensor.updateCount);
+  EXPECT_EQ(1u, sensor.Stats().skippedUpdateCount);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Ready)
+{
+  UnreadySensor sensor;
+  sensor.SetUpdateRate(10);
+  Sensor &base = sensor;
+
+  // Sensors that aren't ready skip even forced updates, and keep their
+  // schedule
+  EXPECT_FALSE(base.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_FALSE(base.Update(std::chrono::steady_clock::duration::zero(),
+      true));
+  EXPECT_EQ(0u, sensor.updateCount);
+  EXPECT_EQ(2u, sensor.Stats().skippedUpdateCount);
+  EXPECT_EQ(std::chrono::milliseconds(100), sensor.NextDataUpdateTime());
+
+  sensor.ready = true;
+  EXPECT_TRUE(base.Update(std::chrono::milliseconds(100), false));
+  EXPECT_EQ(1u, sensor.updateCount);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, Backpressure)
+{
+  // Without asynchronous publishing, consumers are never busy
+  TestSensor plain;
+  EXPECT_FALSE(plain.ConsumersBusy());
+
+  BusySensor sensor;
+  EXPECT_FALSE(sensor.Backpressure());
+  sensor.busy = true;
+
+  // Busy consumers don't skip updates unless backpressure is enabled
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(1u, sensor.updateCount);
+
+  sensor.SetBackpressure(true);
+  EXPECT_TRUE(sensor.Backpressure());
+  EXPECT_FALSE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(1u, sensor.updateCount);
+  EXPECT_EQ(1u, sensor.Stats().skippedUpdateCount);
+  EXPECT_EQ(1u, sensor.Stats().backpressureSkipCount);
+
+  // Forced updates are never skipped
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      true));
+  EXPECT_EQ(2u, sensor.updateCount);
+
+  // Updates resume once the consumers caught up
+  sensor.busy = false;
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      false));
+  EXPECT_EQ(3u, sensor.updateCount);
+  EXPECT_EQ(1u, sensor.Stats().backpressureSkipCount);
+
+  sensor.ResetStats();
+  EXPECT_EQ(0u, sensor.Stats().backpressureSkipCount);
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, StagedUpdates)
+{
+  // Ignored by sensors that don't support it
+  TestSensor plain;
+  EXPECT_FALSE(plain.SupportsStagedUpdates());
+  plain.SetStagedUpdates(true);
+  EXPECT_FALSE(plain.StagedUpdates());
+
+  StagedSensor sensor;
+  EXPECT_FALSE(sensor.StagedUpdates());
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      true));
+  EXPECT_EQ(1u, sensor.updateCount);
+
+  // Staged updates only render, the caller drives the other stages
+  sensor.SetStagedUpdates(true);
+  EXPECT_TRUE(sensor.StagedUpdates());
+  EXPECT_TRUE(sensor.Update(std::chrono::steady_clock::duration::zero(),
+      true));
+  EXPECT_TRUE(sensor.rendered);
+  EXPECT_EQ(1u, sensor.updateCount);
+
+  sensor.ReadbackFrame();
+  EXPECT_TRUE(sensor.copied);
+  sensor.ProcessFrame();
+  EXPECT_EQ(2u, sensor.updateCount);
+
+  sensor.SetStagedUpdates(false);
+  EXPECT_FALSE(sensor.StagedUpdates());
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, UpdatePhase)
+{
+  using namespace std::chrono_literals;
+  TestSensor sensor;
+  EXPECT_TRUE(sensor.Staggerable());
+  sensor.SetStaggerable(false);
+  EXPECT_FALSE(sensor.Staggerable());
+
+  // Sensors without a rate have no phase
+  sensor.SetUpdatePhase(30ms);
+  EXPECT_EQ(0ms, sensor.NextDataUpdateTime());
+
+  sensor.SetUpdateRate(10);
+  sensor.SetUpdatePhase(30ms);
+  EXPECT_EQ(30ms, sensor.NextDataUpdateTime());
+  EXPECT_FALSE(sensor.Update(0ms, false));
+  EXPECT_TRUE(sensor.Update(30ms, false));
+  EXPECT_EQ(130ms, sensor.NextDataUpdateTime());
+
+  // Offsets are wrapped into the period
+  sensor.SetUpdatePhase(250ms);
+  EXPECT_EQ(180ms, sensor.NextDataUpdateTime());
 }
 
 //////////////////////////////////////////////////
@@ -114,6 +1090,40 @@ TEST(Sensor_TEST, AddSequence)
   EXPECT_EQ("0", header2.data(0).value(0));
 }
 
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, StampHeader)
+{
+  using namespace std::chrono_literals;
+  TestSensor sensor;
+  ignition::msgs::Header header;
+  sensor.StampHeader(&header, 1500ms);
+  EXPECT_EQ(1, header.stamp().sec());
+  EXPECT_EQ(500000000, header.stamp().nsec());
+  ASSERT_EQ(2, header.data_size());
+  EXPECT_EQ("frame_id", header.data(0).key());
+  EXPECT_EQ(sensor.Name(), header.data(0).value(0));
+  EXPECT_EQ("seq", header.data(1).key());
+  EXPECT_EQ("0", header.data(1).value(0));
+
+  // Stamping the same header again only updates the values
+  for (int i = 0; i < 100; ++i)
+    sensor.StampHeader(&header, 2s);
+  EXPECT_EQ(2, header.stamp().sec());
+  EXPECT_EQ(0, header.stamp().nsec());
+  ASSERT_EQ(2, header.data_size());
+  EXPECT_EQ(1, header.data(0).value_size());
+  EXPECT_EQ(1, header.data(1).value_size());
+  EXPECT_EQ("100", header.data(1).value(0));
+
+  // Sequences are shared with AddSequence
+  sensor.AddSequence(&header);
+  EXPECT_EQ("101", header.data(1).value(0));
+
+  ignition::msgs::Header other;
+  sensor.StampHeader(&other, 0s, "other");
+  EXPECT_EQ("0", other.data(1).value(0));
+}
+
 //////////////////////////////////////////////////
 TEST(Sensor_TEST, Topic)
 {
@@ -129,6 +1139,41 @@ TEST(Sensor_TEST, Topic)
   EXPECT_FALSE(sensor.SetTopic(""));
 }
 
+/// \brief Create a test sensor for the static sensor registry
+/// \return New sensor
+static Sensor *NewStaticTestSensor()
+{
+  return new TestSensor();
+}
+
+//////////////////////////////////////////////////
+TEST(Sensor_TEST, StaticSensorTypes)
+{
+  SensorFactory factory;
+  EXPECT_FALSE(factory.SensorPluginLoaded("static_test"));
+  EXPECT_EQ(nullptr, factory.NewSensor("static_test"));
+
+  // Registered types are created without looking for plugins
+  static const StaticSensorType types[] =
+  {
+    {"static_test", &NewStaticTestSensor},
+    {"static_test_b", &NewStaticTestSensor},
+  };
+  SensorFactory::RegisterStaticSensorTypes(types, 2u);
+  EXPECT_TRUE(factory.SensorPluginLoaded("static_test"));
+  EXPECT_TRUE(factory.SensorPluginLoaded("static_test_b"));
+  EXPECT_FALSE(factory.SensorPluginLoaded("static_test_c"));
+  EXPECT_TRUE(factory.PreloadSensorPlugins({"static_test", "static_test_b"}));
+
+  auto sensor = factory.NewSensor("static_test");
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_NE(nullptr, dynamic_cast<TestSensor *>(sensor.get()));
+
+  // Registering a type again replaces it, for every factory
+  SensorFactory::RegisterStaticSensorTypes(types, 1u);
+  EXPECT_NE(nullptr, SensorFactory().NewSensor("static_test"));
+}
+
 //////////////////////////////////////////////////
 int main(int argc, char **argv)
 {
@@ -0,0 +1,476 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "ignition/sensors/SharedMemoryRing.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <set>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <ignition/common/Console.hh>
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief Identifies a mapped object as a sensor ring
+static const uint32_t kRingMagic = 0x49534852u;
+
+/// \brief Layout version of the ring
+static const uint32_t kRingVersion = 2u;
+
+/// \brief Alignment of the ring header and slots, to keep slots on
+/// separate cache lines.
+static const std::size_t kRingAlignment = 64u;
+
+/// \brief Start of the shared memory object
+struct RingHeader
+{
+  /// \brief Always kRingMagic
+  uint32_t magic;
+
+  /// \brief Always kRingVersion
+  uint32_t version;
+
+  /// \brief Number of slots
+  uint64_t slotCount;
+
+  /// \brief Maximum number of bytes per slot
+  uint64_t slotSize;
+
+  /// \brief Distance in bytes between the starts of two slots
+  uint64_t slotStride;
+
+  /// \brief Process id of the writer
+  int64_t writerPid;
+};
+
+/// \brief Start of every slot, followed by the data
+struct SlotHeader
+{
+  /// \brief Twice the sequence number of the write held by the slot, minus
+  /// one while the write is in progress. Zero if the slot is unused.
+  std::atomic<uint64_t> sequence;
+
+  /// \brief Number of data bytes
+  uint64_t size;
+};
+
+static_assert(sizeof(RingHeader) <= kRingAlignment,
+    "Ring header must fit in one cache line");
+static_assert(sizeof(SlotHeader) <= kRingAlignment,
+    "Slot header must fit in one cache line");
+
+/// \brief Private data for SharedMemoryRing
+class ignition::sensors::SharedMemoryRingPrivate
+{
+  /// \brief Get a slot.
+  /// \param[in] _sequence Sequence number of a write to the slot.
+  /// \return The slot, or nullptr if the sequence number is invalid.
+  public: SlotHeader *Slot(const uint64_t _sequence) const;
+
+  /// \brief Start of the mapping
+  public: unsigned char *memory = nullptr;
+
+  /// \brief Size of the mapping in bytes
+  public: std::size_t memorySize = 0u;
+
+  /// \brief Name of the shared memory object
+  public: std::string name;
+
+  /// \brief True if this object created the ring and may write to it
+  public: bool owner = false;
+
+  /// \brief Sequence number of the last write
+  public: uint64_t lastSequence = 0u;
+};
+
+//////////////////////////////////////////////////
+SlotHeader *SharedMemoryRingPrivate::Slot(const uint64_t _sequence) const
+{
+  if (!this->memory || _sequence == 0u)
+    return nullptr;
+
+  auto header = reinterpret_cast<const RingHeader *>(this->memory);
+  std::size_t index = (_sequence - 1u) % header->slotCount;
+  return reinterpret_cast<SlotHeader *>(this->memory + kRingAlignment +
+      index * header->slotStride);
+}
+
+#ifndef _WIN32
+/// \brief Names of the rings created by this process and not closed yet
+static std::set<std::string> &CreatedRings()
+{
+  static std::set<std::string> rings;
+  return rings;
+}
+
+/// \brief Mutex of CreatedRings()
+static std::mutex &CreatedRingsMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+//////////////////////////////////////////////////
+/// \brief Remove a ring created by this process from the system.
+/// \param[in] _name Name of the ring.
+static void UnlinkCreatedRing(const std::string &_name)
+{
+  shm_unlink(_name.c_str());
+  std::lock_guard<std::mutex> lock(CreatedRingsMutex());
+  CreatedRings().erase(_name);
+}
+
+//////////////////////////////////////////////////
+/// \brief Check whether an existing shared memory object is a ring left
+/// behind by a writer that died without closing it.
+/// \param[in] _name Name of the shared memory object.
+/// \return True if the ring is stale and can be replaced.
+static bool RingIsStale(const std::string &_name)
+{
+  int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < kRingAlignment)
+  {
+    close(fd);
+    return false;
+  }
+
+  void *memory = mmap(nullptr, kRingAlignment, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+    return false;
+
+  // Without a complete header, the ring may still be being created
+  auto header = static_cast<const RingHeader *>(memory);
+  bool stale = false;
+  if (header->magic == kRingMagic && header->version == kRingVersion &&
+      header->writerPid > 0)
+  {
+    pid_t pid = static_cast<pid_t>(header->writerPid);
+    if (pid == getpid())
+    {
+      // Not one of the rings of this process, so it was left behind by an
+      // earlier process with the same id
+      std::lock_guard<std::mutex> lock(CreatedRingsMutex());
+      stale = CreatedRings().count(_name) == 0u;
+    }
+    else
+    {
+      stale = kill(pid, 0) != 0 && errno == ESRCH;
+    }
+  }
+  munmap(memory, kRingAlignment);
+  return stale;
+}
+#endif
+
+//////////////////////////////////////////////////
+SharedMemoryRing::SharedMemoryRing()
+  : dataPtr(new SharedMemoryRingPrivate())
+{
+}
+
+//////////////////////////////////////////////////
+SharedMemoryRing::~SharedMemoryRing()
+{
+  this->Close();
+}
+
+//////////////////////////////////////////////////
+bool SharedMemoryRing::Create(const std::string &_name,
+    const std::size_t _slotCount, const std::size_t _slotSize)
+{
+  this->Close();
+
+  if (_slotCount == 0u)
+  {
+    ignerr << "A shared memory ring needs at least one slot.\n";
+    return false;
+  }
+
+#ifdef _WIN32
+  ignerr << "Shared memory rings are not supported on this platform. "
+         << "Unable to create [" << _name << "]\n";
+  return false;
+#else
+  std::size_t stride = kRingAlignment +
+      (_slotSize + kRingAlignment - 1u) / kRingAlignment * kRingAlignment;
+  std::size_t size = kRingAlignment + _slotCount * stride;
+
+  int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0 && errno == EEXIST && RingIsStale(_name))
+  {
+    ignwarn << "Replacing shared memory ring [" << _name << "] left behind "
+            << "by a writer that is not running anymore.\n";
+    shm_unlink(_name.c_str());
+    fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  }
+  if (fd < 0)
+  {
+    ignerr << "Unable to create shared memory [" << _name << "]: "
+           << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  {
+    // Before the header is written, so that other rings of this process
+    // never see this one as stale
+    std::lock_guard<std::mutex> lock(CreatedRingsMutex());
+    CreatedRings().insert(_name);
+  }
+
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+  {
+    ignerr << "Unable to allocate [" << size << "] bytes of shared memory ["
+           << _name << "]: " << std::strerror(errno) << "\n";
+    close(fd);
+    UnlinkCreatedRing(_name);
+    return false;
+  }
+
+  void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+  {
+    ignerr << "Unable to map shared memory [" << _name << "]: "
+           << std::strerror(errno) << "\n";
+    UnlinkCreatedRing(_name);
+    return false;
+  }
+
+  // The object is zero filled, so all slots start out unused. The magic
+  // number is written last so that readers never see a partial header.
+  auto header = static_cast<RingHeader *>(memory);
+  header->version = kRingVersion;
+  header->slotCount = _slotCount;
+  header->slotSize = _slotSize;
+  header->slotStride = stride;
+  header->writerPid = static_cast<int64_t>(getpid());
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic = kRingMagic;
+
+  this->dataPtr->memory = static_cast<unsigned char *>(memory);
+  this->dataPtr->memorySize = size;
+  this->dataPtr->name = _name;
+  this->dataPtr->owner = true;
+  this->dataPtr->lastSequence = 0u;
+  return true;
+#endif
+}
+
+//////////////////////////////////////////////////
+bool SharedMemoryRing::Open(const std::string &_name)
+{
+  this->Close();
+
+#ifdef _WIN32
+  ignerr << "Shared memory rings are not supported on this platform. "
+         << "Unable to open [" << _name << "]\n";
+  return false;
+#else
+  int fd = shm_open(_name.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+  {
+    ignerr << "Unable to open shared memory [" << _name << "]: "
+           << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<std::size_t>(info.st_size) < kRingAlignment)
+  {
+    ignerr << "Shared memory [" << _name << "] is not a sensor ring.\n";
+    close(fd);
+    return false;
+  }
+
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  void *memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (memory == MAP_FAILED)
+  {
+    ignerr << "Unable to map shared memory [" << _name << "]: "
+           << std::strerror(errno) << "\n";
+    return false;
+  }
+
+  auto header = static_cast<const RingHeader *>(memory);
+  if (header->magic != kRingMagic || header->version != kRingVersion ||
+      header->slotCount == 0u ||
+      kRingAlignment + header->slotCount * header->slotStride > size)
+  {
+    ignerr << "Shared memory [" << _name << "] is not a sensor ring.\n";
+    munmap(memory, size);
+    return false;
+  }
+
+  this->dataPtr->memory = static_cast<unsigned char *>(memory);
+  this->dataPtr->memorySize = size;
+  this->dataPtr->name = _name;
+  this->dataPtr->owner = false;
+  return true;
+#endif
+}
+
+//////////////////////////////////////////////////
+void SharedMemoryRing::Close()
+{
+  if (!this->dataPtr->memory)
+    return;
+
+#ifndef _WIN32
+  munmap(this->dataPtr->memory, this->dataPtr->memorySize);
+  if (this->dataPtr->owner)
+    UnlinkCreatedRing(this->dataPtr->name);
+#endif
+
+  this->dataPtr->memory = nullptr;
+  this->dataPtr->memorySize = 0u;
+  this->dataPtr->name.clear();
+  this->dataPtr->owner = false;
+  this->dataPtr->lastSequence = 0u;
+}
+
+//////////////////////////////////////////////////
+bool SharedMemoryRing::IsOpen() const
+{
+  return this->dataPtr->memory != nullptr;
+}
+
+//////////////////////////////////////////////////
+std::string SharedMemoryRing::Name() const
+{
+  return this->dataPtr->name;
+}
+
+//////////////////////////////////////////////////
+std::size_t SharedMemoryRing::SlotCount() const
+{
+  if (!this->dataPtr->memory)
+    return 0u;
+  return reinterpret_cast<const RingHeader *>(
+      this->dataPtr->memory)->slotCount;
+}
+
+//////////////////////////////////////////////////
+std::size_t SharedMemoryRing::SlotSize() const
+{
+  if (!this->dataPtr->memory)
+    return 0u;
+  return reinterpret_cast<const RingHeader *>(
+      this->dataPtr->memory)->slotSize;
+}
+
+//////////////////////////////////////////////////
+uint64_t SharedMemoryRing::Write(const void *_data, const std::size_t _size)
+{
+  if (!this->dataPtr->owner)
+  {
+    ignerr << "Only the creator of a shared memory ring may write to it.\n";
+    return 0u;
+  }
+
+  if (_size > this->SlotSize())
+  {
+    ignerr << "Unable to write [" << _size << "] bytes to shared memory ["
+           << this->dataPtr->name << "] with slots of ["
+           << this->SlotSize() << "] bytes.\n";
+    return 0u;
+  }
+
+  uint64_t sequence = this->dataPtr->lastSequence + 1u;
+  SlotHeader *slot = this->dataPtr->Slot(sequence);
+
+  // Mark the slot as being written before touching the data, so that
+  // readers of the previous write notice that it is gone.
+  slot->sequence.store(sequence * 2u - 1u, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  if (_size > 0u)
+  {
+    std::memcpy(reinterpret_cast<unsigned char *>(slot) + kRingAlignment,
+        _data, _size);
+  }
+  slot->size = _size;
+  slot->sequence.store(sequence * 2u, std::memory_order_release);
+
+  this->dataPtr->lastSequence = sequence;
+  return sequence;
+}
+
+//////////////////////////////////////////////////
+const unsigned char *SharedMemoryRing::Data(const uint64_t _sequence,
+    std::size_t &_size) const
+{
+  const SlotHeader *slot = this->dataPtr->Slot(_sequence);
+  if (!slot ||
+      slot->sequence.load(std::memory_order_acquire) != _sequence * 2u)
+  {
+    _size = 0u;
+    return nullptr;
+  }
+
+  // The size may be torn if the slot is being overwritten, which callers
+  // detect with IsCurrent(). Clamp it so that they never read past the slot.
+  auto header = reinterpret_cast<const RingHeader *>(this->dataPtr->memory);
+  _size = static_cast<std::size_t>(
+      std::min<uint64_t>(slot->size, header->slotSize));
+  return reinterpret_cast<const unsigned char *>(slot) + kRingAlignment;
+}
+
+//////////////////////////////////////////////////
+bool SharedMemoryRing::IsCurrent(const uint64_t _sequence) const
+{
+  const SlotHeader *slot = this->dataPtr->Slot(_sequence);
+  if (!slot)
+    return false;
+
+  // Make sure reads of the data are done before checking the sequence.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return slot->sequence.load(std::memory_order_relaxed) == _sequence * 2u;
+}
+
+//////////////////////////////////////////////////
+bool SharedMemoryRing::Read(const uint64_t _sequence,
+    std::string &_data) const
+{
+  std::size_t size = 0u;
+  const unsigned char *data = this->Data(_sequence, size);
+  if (!data)
+    return false;
+
+  _data.assign(reinterpret_cast<const char *>(data), size);
+  return this->IsCurrent(_sequence);
+}
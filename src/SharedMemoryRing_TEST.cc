@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "ignition/sensors/SharedMemoryRing.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+#ifndef _WIN32
+//////////////////////////////////////////////////
+TEST(SharedMemoryRing, WriteRead)
+{
+  std::string name = "/ign_sensors_test_ring";
+
+  SharedMemoryRing writer;
+  EXPECT_FALSE(writer.IsOpen());
+  EXPECT_EQ(0u, writer.Write("abc", 3u));
+
+  ASSERT_TRUE(writer.Create(name, 2u, 16u));
+  EXPECT_TRUE(writer.IsOpen());
+  EXPECT_EQ(name, writer.Name());
+  EXPECT_EQ(2u, writer.SlotCount());
+  EXPECT_EQ(16u, writer.SlotSize());
+
+  SharedMemoryRing reader;
+  ASSERT_TRUE(reader.Open(name));
+  EXPECT_EQ(2u, reader.SlotCount());
+  EXPECT_EQ(16u, reader.SlotSize());
+
+  // Readers can't write
+  EXPECT_EQ(0u, reader.Write("abc", 3u));
+
+  // Data larger than a slot is rejected
+  std::vector<char> large(17u, 'x');
+  EXPECT_EQ(0u, writer.Write(large.data(), large.size()));
+
+  uint64_t first = writer.Write("first", 5u);
+  uint64_t second = writer.Write("second", 6u);
+  EXPECT_EQ(1u, first);
+  EXPECT_EQ(2u, second);
+
+  std::string data;
+  EXPECT_TRUE(reader.Read(first, data));
+  EXPECT_EQ("first", data);
+  EXPECT_TRUE(reader.Read(second, data));
+  EXPECT_EQ("second", data);
+
+  std::size_t size = 0u;
+  const unsigned char *ptr = reader.Data(second, size);
+  ASSERT_NE(nullptr, ptr);
+  EXPECT_EQ(6u, size);
+  EXPECT_EQ('s', ptr[0]);
+  EXPECT_TRUE(reader.IsCurrent(second));
+
+  // The third write reuses the slot of the first one
+  uint64_t third = writer.Write("third", 5u);
+  EXPECT_EQ(3u, third);
+  EXPECT_FALSE(reader.IsCurrent(first));
+  EXPECT_FALSE(reader.Read(first, data));
+  EXPECT_EQ(nullptr, reader.Data(first, size));
+  EXPECT_TRUE(reader.Read(third, data));
+  EXPECT_EQ("third", data);
+
+  // Writes that haven't happened yet are not current
+  EXPECT_FALSE(reader.IsCurrent(5u));
+  EXPECT_FALSE(reader.IsCurrent(0u));
+
+  // Closing the writer removes the ring, but mapped readers keep working
+  writer.Close();
+  EXPECT_FALSE(writer.IsOpen());
+  EXPECT_TRUE(reader.Read(third, data));
+  SharedMemoryRing lateReader;
+  EXPECT_FALSE(lateReader.Open(name));
+}
+
+//////////////////////////////////////////////////
+TEST(SharedMemoryRing, CreateExisting)
+{
+  std::string name = "/ign_sensors_test_existing_ring";
+
+  // A ring whose writer is running is never replaced
+  SharedMemoryRing writer;
+  ASSERT_TRUE(writer.Create(name, 2u, 16u));
+  EXPECT_EQ(1u, writer.Write("live", 4u));
+
+  SharedMemoryRing other;
+  EXPECT_FALSE(other.Create(name, 4u, 32u));
+  EXPECT_FALSE(other.IsOpen());
+
+  SharedMemoryRing reader;
+  ASSERT_TRUE(reader.Open(name));
+  EXPECT_EQ(2u, reader.SlotCount());
+  std::string data;
+  EXPECT_TRUE(reader.Read(1u, data));
+  EXPECT_EQ("live", data);
+  reader.Close();
+
+  // The name can be reused once the writer closes the ring
+  writer.Close();
+  EXPECT_TRUE(other.Create(name, 4u, 32u));
+  EXPECT_EQ(4u, other.SlotCount());
+}
+
+//////////////////////////////////////////////////
+TEST(SharedMemoryRing, CreateStale)
+{
+  std::string name = "/ign_sensors_test_stale_ring";
+
+  // A writer that exits without closing its ring leaves it behind
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0)
+  {
+    SharedMemoryRing *leaked = new SharedMemoryRing();
+    _exit(leaked->Create(name, 2u, 16u) ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(child, waitpid(child, &status, 0));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(0, WEXITSTATUS(status));
+
+  SharedMemoryRing reader;
+  EXPECT_TRUE(reader.Open(name));
+  reader.Close();
+
+  // The stale ring is replaced
+  SharedMemoryRing writer;
+  ASSERT_TRUE(writer.Create(name, 3u, 8u));
+  EXPECT_EQ(3u, writer.SlotCount());
+  EXPECT_EQ(8u, writer.SlotSize());
+}
+
+//////////////////////////////////////////////////
+TEST(SharedMemoryRing, OpenInvalid)
+{
+  SharedMemoryRing reader;
+  EXPECT_FALSE(reader.Open("/ign_sensors_test_missing_ring"));
+  EXPECT_FALSE(reader.IsOpen());
+  EXPECT_EQ(0u, reader.SlotCount());
+  EXPECT_EQ(0u, reader.SlotSize());
+
+  SharedMemoryRing writer;
+  EXPECT_FALSE(writer.Create("/ign_sensors_test_empty_ring", 0u, 16u));
+}
+#endif
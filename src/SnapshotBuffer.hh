@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_SNAPSHOTBUFFER_HH_
+#define IGNITION_SENSORS_SNAPSHOTBUFFER_HH_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "ignition/sensors/config.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Holds the latest value produced by a sensor so that other
+    /// threads can read it without taking the sensor's lock and without
+    /// copying it. The sensor fills a back buffer and publishes it with an
+    /// atomic pointer swap. Readers get an immutable snapshot that stays
+    /// valid for as long as they hold it.
+    ///
+    /// A small set of buffers is recycled once no reader holds them any
+    /// more, so that steady-state updates don't allocate. Only one thread
+    /// may write at a time; any number of threads may read.
+    template<typename T>
+    class SnapshotBuffer
+    {
+      /// \brief Get the buffer to fill with the next value. Its content is
+      /// an older value, or default constructed.
+      /// \return Buffer that no reader can see.
+      public: T &Back()
+      {
+        std::shared_ptr<const T> latest = std::atomic_load(&this->latest);
+        for (std::size_t i = 0; i < this->buffers.size(); ++i)
+        {
+          auto &buffer = this->buffers[i];
+          if (!buffer)
+          {
+            buffer = std::make_shared<T>();
+            this->back = i;
+            return *buffer;
+          }
+
+          // A buffer that is only referenced from here can't be reached by
+          // readers, since it isn't the latest either.
+          if (buffer != latest && buffer.use_count() == 1)
+          {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            this->back = i;
+            return *buffer;
+          }
+        }
+
+        // Readers hold all buffers. Leave the oldest one to them.
+        this->back = (this->back + 1u) % this->buffers.size();
+        if (this->buffers[this->back] == latest)
+          this->back = (this->back + 1u) % this->buffers.size();
+        this->buffers[this->back] = std::make_shared<T>();
+        return *this->buffers[this->back];
+      }
+
+      /// \brief Make the buffer returned by the last call to Back() the
+      /// latest value.
+      public: void Publish()
+      {
+        std::shared_ptr<const T> value = this->buffers[this->back];
+        std::atomic_store(&this->latest, value);
+      }
+
+      /// \brief Get the latest value.
+      /// \return The latest published value, or nullptr if nothing was
+      /// published yet.
+      public: std::shared_ptr<const T> Latest() const
+      {
+        return std::atomic_load(&this->latest);
+      }
+
+      /// \brief Buffers that are recycled
+      private: std::array<std::shared_ptr<T>, 3> buffers;
+
+      /// \brief Index of the buffer returned by Back()
+      private: std::size_t back = 0u;
+
+      /// \brief The latest published value
+      private: std::shared_ptr<const T> latest;
+    };
+    }
+  }
+}
+
+#endif
@@ -26,12 +26,15 @@
 #endif
 
 #include <algorithm>
+#include <cmath>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include <ignition/common/Console.hh>
-#include <ignition/common/Image.hh>
 #include <ignition/common/Profiler.hh>
 #include <ignition/common/SystemPaths.hh>
+#include <ignition/common/Util.hh>
 
 #include <ignition/math/Angle.hh>
 #include <ignition/math/Helpers.hh>
@@ -43,31 +46,14 @@
 #include "ignition/sensors/RenderingEvents.hh"
 #include "ignition/sensors/SensorFactory.hh"
 
+#include "FrameBuffer.hh"
+#include "ImageNormalize.hh"
+
 /// \brief Private data for ThermalCameraSensor
 class ignition::sensors::ThermalCameraSensorPrivate
 {
-  /// \brief Save an image
-  /// \param[in] _data the image data to be saved
-  /// \param[in] _width width of image in pixels
-  /// \param[in] _height height of image in pixels
-  /// \param[in] _format The format the data is in
-  /// \return True if the image was saved successfully. False can mean
-  /// that the path provided to the constructor does exist and creation
-  /// of the path was not possible.
-  /// \sa ImageSaver
-  public: bool SaveImage(const uint16_t *_data, unsigned int _width,
-    unsigned int _height, ignition::common::Image::PixelFormatType _format);
-
-  /// \brief Helper function to convert temperature data to thermal image
-  /// \param[in] _data temperature data
-  /// \param[out] _imageBuffer resulting thermal image data
-  /// \param[in] _width width of image
-  /// \param[in] _height height of image
-  public: bool ConvertTemperatureToImage(const uint16_t *_data,
-    unsigned char *_imageBuffer, unsigned int _width, unsigned int _height);
-
-  /// \brief node to create publisher
-  public: transport::Node node;
+  /// \brief Converts temperature data to grayscale thermal images
+  public: ImageNormalizer normalizer;
 
   /// \brief true if Load() has been called and was successful
   public: bool initialized = false;
@@ -75,15 +61,11 @@ class ignition::sensors::ThermalCameraSensorPrivate
   /// \brief Rendering camera
   public: ignition::rendering::ThermalCameraPtr thermalCamera;
 
-  /// \brief Thermal data buffer.
-  public: uint16_t *thermalBuffer = nullptr;
-
-  /// \brief Thermal data buffer used when saving image.
-  public: unsigned char *imgThermalBuffer = nullptr;
+  /// \brief Thermal frames handed over by the thermal camera.
+  public: FrameBuffer<uint16_t> thermalFrames;
 
   /// \brief Thermal data buffer used when saving image.
-  public: math::Vector2i imgThermalBufferSize =
-      math::Vector2i::Zero;
+  public: std::vector<unsigned char> imgThermalBuffer;
 
   /// \brief Pointer to an image to be published
   public: ignition::rendering::Image image;
@@ -105,21 +87,6 @@ class ignition::sensors::ThermalCameraSensorPrivate
   /// \brief Just a mutex for thread safety
   public: std::mutex mutex;
 
-  /// \brief True to save images
-  public: bool saveImage = false;
-
-  /// \brief path directory to where images are saved
-  public: std::string saveImagePath = "./";
-
-  /// \brief Prefix of an image name
-  public: std::string saveImagePrefix = "./";
-
-  /// \brief counter used to set the image filename
-  public: std::uint64_t saveImageCounter = 0;
-
-  /// \brief SDF Sensor DOM object.
-  public: sdf::Sensor sdfSensor;
-
   /// \brief The point cloud message.
   public: msgs::Image thermalMsg;
 
@@ -140,8 +107,82 @@ class ignition::sensors::ThermalCameraSensorPrivate
 
   /// \brief Linear resolution. Defaults to 10mK
   public: float resolution = 0.01f;
+
+  /// \brief Publisher of the false color images
+  public: transport::Node::Publisher colorizedPub;
+
+  /// \brief False color image message, kept between updates so that its
+  /// memory is reused.
+  public: msgs::Image colorizedMsg;
+
+  /// \brief Palette of the false color images
+  public: ThermalPalette palette = ThermalPalette::IRON;
+
+  /// \brief 256 RGB colors of the palette, empty for grayscale
+  public: std::vector<unsigned char> paletteColors;
 };
 
+namespace
+{
+  /// \brief A color of a palette, at a position from 0 to 1
+  struct PaletteStop
+  {
+    /// \brief Position in the palette
+    float position;
+
+    /// \brief Red, green and blue
+    float rgb[3];
+  };
+
+  /// \brief Get the 256 colors of a palette.
+  /// \param[in] _palette Palette
+  /// \param[out] _colors RGB colors, empty for grayscale.
+  void PaletteColors(const ThermalPalette _palette,
+      std::vector<unsigned char> &_colors)
+  {
+    static const std::vector<PaletteStop> iron = {
+        {0.0f, {0.0f, 0.0f, 0.0f}},
+        {0.2f, {40.0f, 0.0f, 120.0f}},
+        {0.4f, {150.0f, 0.0f, 150.0f}},
+        {0.6f, {230.0f, 80.0f, 20.0f}},
+        {0.8f, {255.0f, 190.0f, 0.0f}},
+        {1.0f, {255.0f, 255.0f, 255.0f}}};
+    static const std::vector<PaletteStop> rainbow = {
+        {0.0f, {0.0f, 0.0f, 255.0f}},
+        {0.25f, {0.0f, 255.0f, 255.0f}},
+        {0.5f, {0.0f, 255.0f, 0.0f}},
+        {0.75f, {255.0f, 255.0f, 0.0f}},
+        {1.0f, {255.0f, 0.0f, 0.0f}}};
+
+    _colors.clear();
+    if (_palette != ThermalPalette::IRON &&
+        _palette != ThermalPalette::RAINBOW)
+    {
+      return;
+    }
+
+    const std::vector<PaletteStop> &stops =
+        _palette == ThermalPalette::IRON ? iron : rainbow;
+    _colors.resize(256u * 3u);
+    std::size_t stop = 0u;
+    for (unsigned int i = 0u; i < 256u; ++i)
+    {
+      const float position = i / 255.0f;
+      while (stop + 2u < stops.size() && position > stops[stop + 1u].position)
+        ++stop;
+      const PaletteStop &a = stops[stop];
+      const PaletteStop &b = stops[stop + 1u];
+      const float t = std::min(1.0f, std::max(0.0f,
+          (position - a.position) / (b.position - a.position)));
+      for (unsigned int c = 0u; c < 3u; ++c)
+      {
+        _colors[i * 3u + c] = static_cast<unsigned char>(
+            std::lround(a.rgb[c] + (b.rgb[c] - a.rgb[c]) * t));
+      }
+    }
+  }
+}
+
 using namespace ignition;
 using namespace sensors;
 
@@ -155,11 +196,6 @@ ThermalCameraSensor::ThermalCameraSensor()
 ThermalCameraSensor::~ThermalCameraSensor()
 {
   this->dataPtr->thermalConnection.reset();
-  if (this->dataPtr->thermalBuffer)
-    delete [] this->dataPtr->thermalBuffer;
-
-  if (this->dataPtr->imgThermalBuffer)
-    delete[] this->dataPtr->imgThermalBuffer;
 }
 
 //////////////////////////////////////////////////
@@ -200,11 +236,9 @@ bool ThermalCameraSensor::Load(const sdf::Sensor &_sdf)
     return false;
   }
 
-  this->dataPtr->sdfSensor = _sdf;
-
   // Create the thermal image publisher
   this->dataPtr->thermalPub =
-      this->dataPtr->node.Advertise<ignition::msgs::Image>(
+      this->TransportNode().Advertise<ignition::msgs::Image>(
           this->Topic());
 
   if (!this->dataPtr->thermalPub)
@@ -213,6 +247,47 @@ bool ThermalCameraSensor::Load(const sdf::Sensor &_sdf)
       << this->Topic() << "].\n";
     return false;
   }
+  this->SetOutputTopic(this->Topic(), &this->dataPtr->thermalPub);
+
+  // Create the false color image publisher
+  this->dataPtr->colorizedPub =
+      this->TransportNode().Advertise<ignition::msgs::Image>(
+          this->Topic() + "/colorized");
+  if (!this->dataPtr->colorizedPub)
+  {
+    ignerr << "Unable to create publisher on topic["
+      << this->Topic() + "/colorized" << "].\n";
+    return false;
+  }
+  this->SetOutputTopic(
+      this->Topic() + "/colorized", &this->dataPtr->colorizedPub);
+
+  ThermalPalette palette = this->dataPtr->palette;
+  sdf::ElementPtr elem = _sdf.Element();
+  if (elem && elem->HasElement("ignition:palette"))
+  {
+    const std::string name = common::lowercase(
+        elem->Get<std::string>("ignition:palette"));
+    if (name == "grayscale")
+    {
+      palette = ThermalPalette::GRAYSCALE;
+    }
+    else if (name == "iron")
+    {
+      palette = ThermalPalette::IRON;
+    }
+    else if (name == "rainbow")
+    {
+      palette = ThermalPalette::RAINBOW;
+    }
+    else
+    {
+      ignwarn << "Unknown thermal palette [" << name << "] for sensor ["
+              << this->Name() << "]. Using [iron].\n";
+      palette = ThermalPalette::IRON;
+    }
+  }
+  this->SetPalette(palette);
 
   if (!this->AdvertiseInfo())
     return false;
@@ -224,7 +299,8 @@ bool ThermalCameraSensor::Load(const sdf::Sensor &_sdf)
 
   this->dataPtr->sceneChangeConnection =
       RenderingEvents::ConnectSceneChangeCallback(
-      std::bind(&ThermalCameraSensor::SetScene, this, std::placeholders::_1));
+      std::bind(&ThermalCameraSensor::OnSceneChange, this,
+      std::placeholders::_1));
 
   this->dataPtr->initialized = true;
 
@@ -234,7 +310,7 @@ bool ThermalCameraSensor::Load(const sdf::Sensor &_sdf)
 //////////////////////////////////////////////////
 bool ThermalCameraSensor::CreateCamera()
 {
-  const sdf::Camera *cameraSdf = this->dataPtr->sdfSensor.CameraSensor();
+  const sdf::Camera *cameraSdf = this->SdfSensor().CameraSensor();
 
   if (!cameraSdf)
   {
@@ -309,11 +385,7 @@ bool ThermalCameraSensor::CreateCamera()
 
   // Create the directory to store frames
   if (cameraSdf->SaveFrames())
-  {
-    this->dataPtr->saveImagePath = cameraSdf->SaveFramesPath();
-    this->dataPtr->saveImagePrefix = this->Name() + "_";
-    this->dataPtr->saveImage = true;
-  }
+    this->EnableSaveFrames(cameraSdf->SaveFramesPath(), this->Name() + "_");
 
   this->dataPtr->thermalConnection =
       this->dataPtr->thermalCamera->ConnectNewThermalFrame(
@@ -330,15 +402,7 @@ void ThermalCameraSensor::OnNewThermalFrame(const uint16_t *_scan,
                     unsigned int /*_channels*/,
                     const std::string &/*_format*/)
 {
-  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-
-  unsigned int samples = _width * _height;
-  unsigned int thermalBufferSize = samples * sizeof(uint16_t);
-
-  if (!this->dataPtr->thermalBuffer)
-    this->dataPtr->thermalBuffer = new uint16_t[samples];
-
-  memcpy(this->dataPtr->thermalBuffer, _scan, thermalBufferSize);
+  this->dataPtr->thermalFrames.Write(_scan, _width, _height);
 }
 
 /////////////////////////////////////////////////
@@ -393,59 +457,120 @@ bool ThermalCameraSensor::Update(
     return false;
   }
 
-  if (!this->dataPtr->thermalPub.HasConnections() &&
-      this->dataPtr->imageEvent.ConnectionCount() == 0u)
+  if (!this->HasConnections())
+  {
+    this->RecordSkippedUpdate();
     return false;
+  }
 
   // generate sensor data - this triggers image callback
   this->Render();
+  this->RecordReadbackBytes(this->dataPtr->thermalFrames.TakeWrittenBytes());
 
-  if (!this->dataPtr->thermalBuffer)
+  const uint16_t *thermalData = this->dataPtr->thermalFrames.Acquire();
+  if (!thermalData)
     return false;
 
-  unsigned int width = this->dataPtr->thermalCamera->ImageWidth();
-  unsigned int height = this->dataPtr->thermalCamera->ImageHeight();
+  unsigned int width = this->dataPtr->thermalFrames.Width();
+  unsigned int height = this->dataPtr->thermalFrames.Height();
 
-  auto commonFormat = common::Image::L_INT16;
   auto msgsFormat = msgs::PixelFormatType::L_INT16;
 
-  // create message
-  this->dataPtr->thermalMsg.set_width(width);
-  this->dataPtr->thermalMsg.set_height(height);
-  this->dataPtr->thermalMsg.set_step(
-      width * rendering::PixelUtil::BytesPerPixel(rendering::PF_L16));
-  this->dataPtr->thermalMsg.set_pixel_format_type(msgsFormat);
-  auto stamp = this->dataPtr->thermalMsg.mutable_header()->mutable_stamp();
-  *stamp = msgs::Convert(_now);
-  auto frame = this->dataPtr->thermalMsg.mutable_header()->add_data();
-  frame->set_key("frame_id");
-  frame->add_value(this->Name());
+  const unsigned int step =
+      width * rendering::PixelUtil::BytesPerPixel(rendering::PF_L16);
 
-  std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
-  this->dataPtr->thermalMsg.set_data(this->dataPtr->thermalBuffer,
-      rendering::PixelUtil::MemorySize(rendering::PF_L16,
-      width, height));
+  // Image view callbacks alone don't need a message
+  ignition::msgs::Image &thermalMsg = this->dataPtr->thermalMsg;
+  const bool rawConsumers = this->PublishRawImages() &&
+      this->HasConsumers(this->dataPtr->thermalPub);
+  const bool buildMsg = rawConsumers || this->HasCompressedConnections() ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0u;
+
+  // create message
+  if (buildMsg)
+  {
+    thermalMsg.set_width(width);
+    thermalMsg.set_height(height);
+    thermalMsg.set_step(step);
+    thermalMsg.set_pixel_format_type(msgsFormat);
+    this->StampHeader(thermalMsg.mutable_header(), _now);
+    thermalMsg.set_data(thermalData,
+        rendering::PixelUtil::MemorySize(rendering::PF_L16, width, height));
+  }
 
   // publish the camera info message
+  auto publishStart = std::chrono::steady_clock::now();
   this->PublishInfo(_now);
 
-  this->dataPtr->thermalPub.Publish(this->dataPtr->thermalMsg);
+  if (buildMsg)
+  {
+    if (rawConsumers)
+      this->Publish(this->dataPtr->thermalPub, thermalMsg);
+    this->PublishCompressed(thermalMsg);
+  }
+  this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+  if (buildMsg)
+    this->RecordPublishedBytes(thermalMsg.ByteSizeLong());
 
   // Trigger callbacks.
-  try
+  if (this->dataPtr->imageEvent.ConnectionCount() > 0u)
   {
-    this->dataPtr->imageEvent(this->dataPtr->thermalMsg);
+    try
+    {
+      this->dataPtr->imageEvent(thermalMsg);
+    }
+    catch(...)
+    {
+      ignerr << "Exception thrown in an image callback.\n";
+    }
+  }
+
+  if (this->HasImageViewCallbacks())
+  {
+    ImageView view;
+    view.data = reinterpret_cast<const unsigned char *>(thermalData);
+    view.width = width;
+    view.height = height;
+    view.step = step;
+    view.format = msgsFormat;
+    view.stamp = _now;
+    this->DeliverImageView(view);
   }
-  catch(...)
+
+  // publish the false color image
+  if (this->HasConsumers(this->dataPtr->colorizedPub))
   {
-    ignerr << "Exception thrown in an image callback.\n";
+    IGN_PROFILE("ThermalCameraSensor::Update Colorize");
+    auto messageStart = std::chrono::steady_clock::now();
+    msgs::Image &msg = this->dataPtr->colorizedMsg;
+    msg.set_width(width);
+    msg.set_height(height);
+    msg.set_step(width * 3u);
+    msg.set_pixel_format_type(msgs::PixelFormatType::RGB_INT8);
+    this->StampHeader(msg.mutable_header(), _now, "colorized");
+
+    std::string *data = msg.mutable_data();
+    data->resize(static_cast<std::size_t>(width) * height * 3u);
+    const std::vector<unsigned char> &colors = this->dataPtr->paletteColors;
+    this->dataPtr->normalizer.ConvertTemperature(thermalData, width, height,
+        reinterpret_cast<unsigned char *>(&(*data)[0]),
+        colors.empty() ? nullptr : colors.data());
+    this->RecordPhase(UpdatePhase::MESSAGE, messageStart);
+
+    publishStart = std::chrono::steady_clock::now();
+    this->Publish(this->dataPtr->colorizedPub, msg);
+    this->RecordPhase(UpdatePhase::PUBLISH, publishStart);
+    this->RecordPublishedBytes(msg.ByteSizeLong());
   }
 
   // Save image
-  if (this->dataPtr->saveImage)
+  if (this->SavesFrames() && width > 0u && height > 0u)
   {
-    this->dataPtr->SaveImage(this->dataPtr->thermalBuffer, width, height,
-        commonFormat);
+    this->dataPtr->imgThermalBuffer.resize(width * height * 3u);
+    this->dataPtr->normalizer.ConvertTemperature(thermalData, width, height,
+        this->dataPtr->imgThermalBuffer.data());
+    this->SaveFrame(this->dataPtr->imgThermalBuffer.data(), width, height,
+        width * 3u, msgs::PixelFormatType::RGB_INT8);
   }
 
   return true;
@@ -520,77 +645,54 @@ void ThermalCameraSensor::SetLinearResolution(float _resolution)
 }
 
 //////////////////////////////////////////////////
-bool ThermalCameraSensorPrivate::ConvertTemperatureToImage(
-    const uint16_t *_data,
-    unsigned char *_imageBuffer,
-    unsigned int _width, unsigned int _height)
+void ThermalCameraSensor::SetPalette(const ThermalPalette _palette)
 {
-  // get min and max of temperature values
-  const auto [min, max] = // NOLINT
-      std::minmax_element(&_data[0], &_data[_height * _width]);
-
-  // convert temperature to grayscale image
-  double range = static_cast<double>(max - min);
-  if (math::equal(range, 0.0))
-    range = 1.0;
-  for (unsigned int i = 0; i < _height; ++i)
-  {
-    for (unsigned int j = 0; j < _width; ++j)
-    {
-      uint16_t temp = _data[i*_width + j];
-      double t = static_cast<double>(temp-*min) / range;
-      int r = static_cast<int>(255*t);
-      int g = r;
-      int b = r;
-      int index = i*_width*3 + j*3;
-      _imageBuffer[index] = r;
-      _imageBuffer[index+1] = g;
-      _imageBuffer[index+2] = b;
-    }
-  }
-
-  return true;
+  this->dataPtr->palette = _palette;
+  PaletteColors(_palette, this->dataPtr->paletteColors);
 }
 
 //////////////////////////////////////////////////
-bool ThermalCameraSensorPrivate::SaveImage(const uint16_t *_data,
-    unsigned int _width, unsigned int _height,
-    ignition::common::Image::PixelFormatType /*_format*/)
+ThermalPalette ThermalCameraSensor::Palette() const
 {
-  // Attempt to create the directory if it doesn't exist
-  if (!ignition::common::isDirectory(this->saveImagePath))
-  {
-    if (!ignition::common::createDirectories(this->saveImagePath))
-      return false;
-  }
-
-  if (_width == 0 || _height == 0)
-    return false;
-
-  ignition::common::Image localImage;
-
-  if (static_cast<int>(_width) != this->imgThermalBufferSize.X() ||
-      static_cast<int>(_height) != this->imgThermalBufferSize.Y())
-  {
-    delete [] this->imgThermalBuffer;
-    unsigned int bufferSize = _width * _height * 3;
-    this->imgThermalBuffer = new unsigned char[bufferSize];
-    this->imgThermalBufferSize = math::Vector2i(_width, _height);
-  }
+  return this->dataPtr->palette;
+}
 
-  this->ConvertTemperatureToImage(_data, this->imgThermalBuffer,
-      _width, _height);
+//////////////////////////////////////////////////
+bool ThermalCameraSensor::HasConnections() const
+{
+  return (this->PublishRawImages() &&
+      this->HasConsumers(this->dataPtr->thermalPub)) ||
+      this->HasConsumers(this->dataPtr->colorizedPub) ||
+      this->HasCompressedConnections() ||
+      this->dataPtr->imageEvent.ConnectionCount() > 0u ||
+      this->HasImageViewCallbacks() ||
+      this->SavesFrames();
+}
 
-  std::string filename = this->saveImagePrefix +
-                         std::to_string(this->saveImageCounter) + ".png";
-  ++this->saveImageCounter;
+//////////////////////////////////////////////////
+SensorMemory ThermalCameraSensor::MemoryUsage() const
+{
+  SensorMemory memory = CameraSensor::MemoryUsage();
+  memory.renderTargetBytes +=
+      RenderTargetBytes(this->dataPtr->thermalCamera);
+  memory.readbackBytes += this->dataPtr->image.MemorySize() +
+      this->dataPtr->thermalFrames.MemoryBytes() +
+      this->dataPtr->imgThermalBuffer.capacity();
+  memory.messageBytes += this->dataPtr->thermalMsg.SpaceUsedLong() +
+      this->dataPtr->colorizedMsg.SpaceUsedLong();
+  return memory;
+}
 
-  localImage.SetFromData(this->imgThermalBuffer, _width, _height,
-      common::Image::RGB_INT8);
-  localImage.SavePNG(
-      ignition::common::joinPaths(this->saveImagePath, filename));
+//////////////////////////////////////////////////
+bool ThermalCameraSensor::SupportsStagedUpdates() const
+{
+  return false;
+}
 
-  return true;
+//////////////////////////////////////////////////
+bool ThermalCameraSensor::SupportsImageStreams() const
+{
+  return false;
 }
 
 IGN_SENSORS_REGISTER_SENSOR(ThermalCameraSensor)
@@ -0,0 +1,396 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "WorkerPool.hh"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+
+using namespace ignition;
+using namespace sensors;
+
+/// \brief True while the current thread is running a pool job.
+static thread_local bool tlInsideJob = false;
+
+/// \brief Private data for WorkerPool
+class ignition::sensors::WorkerPoolPrivate
+{
+  /// \brief Main loop of the background threads
+  /// \param[in] _thread Index of the thread, from 1
+  public: void Run(const std::size_t _thread);
+
+  /// \brief Take and run jobs until none are left, or run the range of
+  /// jobs of a thread with fixed partitioning.
+  /// \param[in] _thread Index of the thread, 0 for the calling thread
+  public: void Work(const std::size_t _thread);
+
+  /// \brief Take and run the jobs queued by Pipeline() until none are
+  /// left.
+  public: void WorkQueued();
+
+  /// \brief Start a batch of jobs on the background threads.
+  /// \param[in] _count Number of jobs
+  /// \param[in] _func Function to call with the index of each job
+  /// \param[in] _assigned Thread of each job, or null
+  /// \param[in] _pipelined True if the jobs are queued one by one
+  public: void Start(const std::size_t _count,
+              const std::function<void(std::size_t)> &_func,
+              const std::vector<unsigned int> *_assigned,
+              const bool _pipelined);
+
+  /// \brief Wait until the background threads finished the batch.
+  public: void Finish();
+
+  /// \brief Run a batch of jobs on all threads and wait for them.
+  /// \param[in] _count Number of jobs
+  /// \param[in] _func Function to call with the index of each job
+  /// \param[in] _assigned Thread of each job, or null
+  public: void Dispatch(const std::size_t _count,
+              const std::function<void(std::size_t)> &_func,
+              const std::vector<unsigned int> *_assigned);
+
+  /// \brief Background threads
+  public: std::vector<std::thread> threads;
+
+  /// \brief Protects the members below
+  public: std::mutex mutex;
+
+  /// \brief Serializes concurrent calls to ParallelFor
+  public: std::mutex runMutex;
+
+  /// \brief Signals threads that a new batch of jobs is ready
+  public: std::condition_variable startCv;
+
+  /// \brief Signals the caller that all threads finished the batch
+  public: std::condition_variable doneCv;
+
+  /// \brief Function run for each job of the current batch
+  public: const std::function<void(std::size_t)> *func = nullptr;
+
+  /// \brief Number of jobs in the current batch
+  public: std::size_t count = 0u;
+
+  /// \brief Thread of each job of the current batch, null unless the
+  /// jobs are assigned
+  public: const std::vector<unsigned int> *assigned = nullptr;
+
+  /// \brief Index of the next job to run
+  public: std::atomic<std::size_t> next{0u};
+
+  /// \brief True while the jobs of the current batch are queued one by
+  /// one by Pipeline()
+  public: bool pipelined = false;
+
+  /// \brief Number of jobs queued so far by Pipeline(), protected by
+  /// mutex
+  public: std::size_t ready = 0u;
+
+  /// \brief Signals threads that a job was queued by Pipeline()
+  public: std::condition_variable readyCv;
+
+  /// \brief Number of background threads still working on the batch
+  public: std::size_t pending = 0u;
+
+  /// \brief Incremented every time a new batch starts
+  public: uint64_t generation = 0u;
+
+  /// \brief Tells background threads to exit
+  public: bool stop = false;
+
+  /// \brief Whether each thread runs a fixed range of the jobs
+  public: bool fixedPartitioning = false;
+};
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Run(const std::size_t _thread)
+{
+  uint64_t seen = 0u;
+  std::unique_lock<std::mutex> lock(this->mutex);
+  while (true)
+  {
+    this->startCv.wait(lock, [&]
+        {
+          return this->stop || this->generation != seen;
+        });
+    if (this->stop)
+      return;
+
+    seen = this->generation;
+    lock.unlock();
+    this->Work(_thread);
+    lock.lock();
+
+    if (--this->pending == 0u)
+      this->doneCv.notify_all();
+  }
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Work(const std::size_t _thread)
+{
+  tlInsideJob = true;
+  if (this->pipelined)
+  {
+    this->WorkQueued();
+  }
+  else if (this->assigned)
+  {
+    const std::size_t threadCount = this->threads.size() + 1u;
+    for (std::size_t i = 0u; i < this->count; ++i)
+    {
+      if ((*this->assigned)[i] % threadCount == _thread)
+        (*this->func)(i);
+    }
+  }
+  else if (this->fixedPartitioning)
+  {
+    const std::size_t threadCount = this->threads.size() + 1u;
+    const std::size_t end = this->count * (_thread + 1u) / threadCount;
+    for (std::size_t i = this->count * _thread / threadCount; i < end; ++i)
+      (*this->func)(i);
+  }
+  else
+  {
+    for (std::size_t i = this->next++; i < this->count; i = this->next++)
+      (*this->func)(i);
+  }
+  tlInsideJob = false;
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::WorkQueued()
+{
+  while (true)
+  {
+    std::size_t index = 0u;
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->readyCv.wait(lock, [&]
+          {
+            return this->next < this->ready || this->next >= this->count;
+          });
+      if (this->next >= this->count)
+        return;
+      index = this->next++;
+      if (this->next == this->count)
+        this->readyCv.notify_all();
+    }
+    (*this->func)(index);
+  }
+}
+
+//////////////////////////////////////////////////
+WorkerPool::WorkerPool(const unsigned int _threadCount)
+  : dataPtr(new WorkerPoolPrivate)
+{
+  for (unsigned int i = 1u; i < _threadCount; ++i)
+  {
+    this->dataPtr->threads.emplace_back(
+        &WorkerPoolPrivate::Run, this->dataPtr.get(), std::size_t(i));
+  }
+}
+
+//////////////////////////////////////////////////
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->dataPtr->mutex);
+    this->dataPtr->stop = true;
+  }
+  this->dataPtr->startCv.notify_all();
+
+  for (auto &thread : this->dataPtr->threads)
+    thread.join();
+}
+
+//////////////////////////////////////////////////
+unsigned int WorkerPool::ThreadCount() const
+{
+  return static_cast<unsigned int>(this->dataPtr->threads.size()) + 1u;
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::ParallelFor(const std::size_t _count,
+    const std::function<void(std::size_t)> &_func)
+{
+  if (_count == 0u)
+    return;
+
+  // Run serially if there is nothing to share, or if we're already inside
+  // a job, in which case waiting on the pool would deadlock.
+  if (this->dataPtr->threads.empty() || _count == 1u || tlInsideJob)
+  {
+    for (std::size_t i = 0u; i < _count; ++i)
+      _func(i);
+    return;
+  }
+
+  this->dataPtr->Dispatch(_count, _func, nullptr);
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::ParallelFor(const std::vector<unsigned int> &_threads,
+    const std::function<void(std::size_t)> &_func)
+{
+  if (_threads.empty())
+    return;
+
+  if (this->dataPtr->threads.empty() || _threads.size() == 1u ||
+      tlInsideJob)
+  {
+    for (std::size_t i = 0u; i < _threads.size(); ++i)
+      _func(i);
+    return;
+  }
+
+  this->dataPtr->Dispatch(_threads.size(), _func, &_threads);
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::Pipeline(const std::size_t _count,
+    const std::function<void(std::size_t)> &_first,
+    const std::function<void(std::size_t)> &_second)
+{
+  if (_count == 0u)
+    return;
+
+  if (this->dataPtr->threads.empty() || tlInsideJob)
+  {
+    for (std::size_t i = 0u; i < _count; ++i)
+      _first(i);
+    for (std::size_t i = 0u; i < _count; ++i)
+      _second(i);
+    return;
+  }
+
+  auto &data = *this->dataPtr;
+  std::lock_guard<std::mutex> runLock(data.runMutex);
+  data.Start(_count, _second, nullptr, true);
+
+  // First stages may call the pool too, which runs them serially
+  tlInsideJob = true;
+  for (std::size_t i = 0u; i < _count; ++i)
+  {
+    _first(i);
+    {
+      std::lock_guard<std::mutex> lock(data.mutex);
+      data.ready = i + 1u;
+    }
+    data.readyCv.notify_one();
+  }
+  data.WorkQueued();
+  tlInsideJob = false;
+
+  data.Finish();
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Dispatch(const std::size_t _count,
+    const std::function<void(std::size_t)> &_func,
+    const std::vector<unsigned int> *_assigned)
+{
+  std::lock_guard<std::mutex> runLock(this->runMutex);
+  this->Start(_count, _func, _assigned, false);
+  this->Work(0u);
+  this->Finish();
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Start(const std::size_t _count,
+    const std::function<void(std::size_t)> &_func,
+    const std::vector<unsigned int> *_assigned, const bool _pipelined)
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->func = &_func;
+    this->count = _count;
+    this->assigned = _assigned;
+    this->pipelined = _pipelined;
+    this->ready = 0u;
+    this->next = 0u;
+    this->pending = this->threads.size();
+    ++this->generation;
+  }
+  this->startCv.notify_all();
+}
+
+//////////////////////////////////////////////////
+void WorkerPoolPrivate::Finish()
+{
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->doneCv.wait(lock, [&]
+      {
+        return this->pending == 0u;
+      });
+  this->func = nullptr;
+  this->count = 0u;
+  this->assigned = nullptr;
+  this->pipelined = false;
+}
+
+//////////////////////////////////////////////////
+bool WorkerPool::SetThreadAffinity(const std::vector<int> &_cores)
+{
+  bool result = true;
+  const std::size_t count =
+      std::min(_cores.size(), this->dataPtr->threads.size());
+  for (std::size_t i = 0u; i < count; ++i)
+  {
+    if (_cores[i] < 0)
+      continue;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(_cores[i], &set);
+    if (pthread_setaffinity_np(this->dataPtr->threads[i].native_handle(),
+          sizeof(set), &set) != 0)
+    {
+      ignwarn << "Unable to pin worker thread [" << i + 1u << "] to core ["
+              << _cores[i] << "].\n";
+      result = false;
+    }
+#else
+    ignwarn << "Worker thread affinity is only supported on Linux.\n";
+    return false;
+#endif
+  }
+  return result;
+}
+
+//////////////////////////////////////////////////
+void WorkerPool::SetFixedPartitioning(const bool _fixed)
+{
+  std::lock_guard<std::mutex> lock(this->dataPtr->runMutex);
+  this->dataPtr->fixedPartitioning = _fixed;
+}
+
+//////////////////////////////////////////////////
+bool WorkerPool::FixedPartitioning() const
+{
+  return this->dataPtr->fixedPartitioning;
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_WORKERPOOL_HH_
+#define IGNITION_SENSORS_WORKERPOOL_HH_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <ignition/common/SuppressWarning.hh>
+
+#include "ignition/sensors/config.hh"
+#include "ignition/sensors/Export.hh"
+
+namespace ignition
+{
+  namespace sensors
+  {
+    // Inline bracket to help doxygen filtering.
+    inline namespace IGNITION_SENSORS_VERSION_NAMESPACE {
+    //
+    /// \brief Forward declarations
+    class WorkerPoolPrivate;
+
+    /// \brief A fixed size pool of threads that runs independent, indexed
+    /// jobs in parallel. The Manager uses this to update sensors that
+    /// don't depend on a rendering context concurrently.
+    class IGNITION_SENSORS_VISIBLE WorkerPool
+    {
+      /// \brief Constructor
+      /// \param[in] _threadCount Total number of threads used by
+      /// ParallelFor, including the calling thread. Values lower than 2
+      /// create no background threads and all work runs serially.
+      public: explicit WorkerPool(const unsigned int _threadCount);
+
+      /// \brief Destructor. Joins all background threads.
+      public: ~WorkerPool();
+
+      /// \brief Get the total number of threads used by ParallelFor,
+      /// including the calling thread.
+      /// \return Number of threads.
+      public: unsigned int ThreadCount() const;
+
+      /// \brief Call _func once for every index in the range [0, _count)
+      /// and block until all calls have returned. The calling thread takes
+      /// part in the work. Calls made from inside a job run serially on
+      /// the thread that made them.
+      /// \param[in] _count Number of jobs.
+      /// \param[in] _func Function to call with the index of each job.
+      public: void ParallelFor(const std::size_t _count,
+                  const std::function<void(std::size_t)> &_func);
+
+      /// \brief Call _func once for every job, each on the thread it is
+      /// assigned to, and block until all calls have returned. Threads run
+      /// their jobs in index order. Runs serially in the same cases as the
+      /// other overload.
+      /// \param[in] _threads Thread of each job, taken modulo
+      /// ThreadCount(). Thread 0 is the calling thread.
+      /// \param[in] _func Function to call with the index of each job.
+      public: void ParallelFor(const std::vector<unsigned int> &_threads,
+                  const std::function<void(std::size_t)> &_func);
+
+      /// \brief Run two dependent stages of independent jobs, overlapping
+      /// the first stage of later jobs with the second stage of earlier
+      /// ones. The calling thread runs _first for every job in index
+      /// order, such as stages that need the rendering context. The second
+      /// stage of a job is queued as soon as its first stage returned, and
+      /// is taken by whichever background thread is free. The calling
+      /// thread helps with the second stages once done with the first
+      /// ones. Blocks until all calls have returned. Without background
+      /// threads, or from inside a job, all first stages run before the
+      /// second ones on the calling thread.
+      /// \param[in] _count Number of jobs.
+      /// \param[in] _first First stage, called with the index of each job.
+      /// \param[in] _second Second stage, called with the index of each
+      /// job.
+      public: void Pipeline(const std::size_t _count,
+                  const std::function<void(std::size_t)> &_first,
+                  const std::function<void(std::size_t)> &_second);
+
+      /// \brief Pin the background threads to CPU cores. Only supported on
+      /// Linux. The calling thread keeps its affinity.
+      /// \param[in] _cores Core of each background thread, the first one
+      /// for thread 1. Threads without a core, or with a negative one,
+      /// can run on any core.
+      /// \return False if a thread couldn't be pinned.
+      public: bool SetThreadAffinity(const std::vector<int> &_cores);
+
+      /// \brief Set whether jobs are split into fixed ranges. With fixed
+      /// partitioning, the jobs of ParallelFor are split into one
+      /// contiguous range per thread, so the same jobs always run on the
+      /// same thread, the first range on the calling thread. Otherwise,
+      /// threads take the next job as soon as they are free, which
+      /// balances uneven jobs better. Don't call it during ParallelFor.
+      /// \param[in] _fixed True to split jobs into fixed ranges.
+      public: void SetFixedPartitioning(const bool _fixed);
+
+      /// \brief Get whether jobs are split into fixed ranges.
+      /// \return True with fixed partitioning.
+      /// \sa SetFixedPartitioning()
+      public: bool FixedPartitioning() const;
+
+      IGN_COMMON_WARN_IGNORE__DLL_INTERFACE_MISSING
+      /// \brief Private data pointer
+      private: std::unique_ptr<WorkerPoolPrivate> dataPtr;
+      IGN_COMMON_WARN_RESUME__DLL_INTERFACE_MISSING
+    };
+    }
+  }
+}
+
+#endif
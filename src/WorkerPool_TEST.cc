@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "WorkerPool.hh"
+
+using namespace ignition;
+using namespace sensors;
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Serial)
+{
+  WorkerPool pool(1u);
+  EXPECT_EQ(1u, pool.ThreadCount());
+
+  std::vector<int> values(10, 0);
+  pool.ParallelFor(values.size(), [&](std::size_t _i)
+      {
+        values[_i] = static_cast<int>(_i);
+      });
+  for (std::size_t i = 0; i < values.size(); ++i)
+    EXPECT_EQ(static_cast<int>(i), values[i]);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Parallel)
+{
+  WorkerPool pool(4u);
+  EXPECT_EQ(4u, pool.ThreadCount());
+
+  // Run several batches to make sure the threads are reused correctly
+  for (int batch = 0; batch < 100; ++batch)
+  {
+    std::vector<int> values(1000, 0);
+    std::atomic<int> calls{0};
+    pool.ParallelFor(values.size(), [&](std::size_t _i)
+        {
+          values[_i] += static_cast<int>(_i) + batch;
+          ++calls;
+        });
+    EXPECT_EQ(1000, calls);
+    for (std::size_t i = 0; i < values.size(); ++i)
+      EXPECT_EQ(static_cast<int>(i) + batch, values[i]);
+  }
+
+  // An empty batch returns immediately
+  pool.ParallelFor(0u, [](std::size_t)
+      {
+        FAIL();
+      });
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Nested)
+{
+  WorkerPool pool(3u);
+
+  std::atomic<int> calls{0};
+  pool.ParallelFor(8u, [&](std::size_t)
+      {
+        pool.ParallelFor(8u, [&](std::size_t)
+            {
+              ++calls;
+            });
+      });
+  EXPECT_EQ(64, calls);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, FixedPartitioning)
+{
+  WorkerPool pool(3u);
+  EXPECT_FALSE(pool.FixedPartitioning());
+  pool.SetFixedPartitioning(true);
+  EXPECT_TRUE(pool.FixedPartitioning());
+
+  // Each job runs on the same thread in every batch, and the first range
+  // runs on the calling thread
+  std::vector<std::thread::id> first(10);
+  pool.ParallelFor(first.size(), [&](std::size_t _i)
+      {
+        first[_i] = std::this_thread::get_id();
+      });
+  for (std::size_t i = 0; i < 3u; ++i)
+    EXPECT_EQ(std::this_thread::get_id(), first[i]);
+
+  for (int batch = 0; batch < 20; ++batch)
+  {
+    std::vector<std::thread::id> ids(first.size());
+    pool.ParallelFor(ids.size(), [&](std::size_t _i)
+        {
+          ids[_i] = std::this_thread::get_id();
+        });
+    EXPECT_EQ(first, ids);
+  }
+
+  // Fewer jobs than threads still run once each
+  std::atomic<int> calls{0};
+  pool.ParallelFor(2u, [&](std::size_t)
+      {
+        ++calls;
+      });
+  EXPECT_EQ(2, calls);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, AssignedThreads)
+{
+  WorkerPool pool(3u);
+
+  // Jobs run on their thread, modulo the number of threads
+  const std::vector<unsigned int> threads{2u, 0u, 1u, 2u, 5u};
+  std::vector<std::thread::id> ids(threads.size());
+  pool.ParallelFor(threads, [&](std::size_t _i)
+      {
+        ids[_i] = std::this_thread::get_id();
+      });
+  EXPECT_EQ(std::this_thread::get_id(), ids[1]);
+  EXPECT_EQ(ids[0], ids[3]);
+  EXPECT_EQ(ids[0], ids[4]);
+  EXPECT_NE(ids[0], ids[1]);
+  EXPECT_NE(ids[0], ids[2]);
+  EXPECT_NE(ids[1], ids[2]);
+
+  // Negative cores leave threads unpinned
+  EXPECT_TRUE(pool.SetThreadAffinity({-1, -1}));
+  std::atomic<int> calls{0};
+  pool.ParallelFor(threads, [&](std::size_t)
+      {
+        ++calls;
+      });
+  EXPECT_EQ(5, calls);
+}
+
+//////////////////////////////////////////////////
+TEST(WorkerPool, Pipeline)
+{
+  WorkerPool pool(4u);
+  for (int batch = 0; batch < 20; ++batch)
+  {
+    // Second stages only run after their first stage, which runs on the
+    // calling thread
+    std::vector<std::atomic<bool>> first(9);
+    std::vector<std::thread::id> ids(first.size());
+    std::atomic<int> seconds{0};
+    pool.Pipeline(first.size(),
+        [&](std::size_t _i)
+        {
+          ids[_i] = std::this_thread::get_id();
+          first[_i] = true;
+        },
+        [&](std::size_t _i)
+        {
+          EXPECT_TRUE(first[_i]);
+          ++seconds;
+        });
+    EXPECT_EQ(9, seconds);
+    for (const auto &id : ids)
+      EXPECT_EQ(std::this_thread::get_id(), id);
+  }
+
+  // The second stages of early jobs overlap the first stages of late ones
+  std::atomic<bool> producing{true};
+  std::atomic<int> overlapped{0};
+  pool.Pipeline(4u,
+      [&](std::size_t _i)
+      {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (_i == 3u)
+          producing = false;
+      },
+      [&](std::size_t)
+      {
+        if (producing)
+          ++overlapped;
+      });
+  EXPECT_GT(overlapped, 0);
+
+  // Serially, all first stages run first
+  WorkerPool serial(1u);
+  std::vector<int> order;
+  serial.Pipeline(2u,
+      [&](std::size_t _i) { order.push_back(static_cast<int>(_i)); },
+      [&](std::size_t _i) { order.push_back(10 + static_cast<int>(_i)); });
+  EXPECT_EQ((std::vector<int>{0, 1, 10, 11}), order);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -17,6 +17,10 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <sdf/sdf.hh>
 
 #include <ignition/math/Helpers.hh>
@@ -227,6 +231,55 @@ TEST_F(AirPressureSensorTest, SensorReadings)
   EXPECT_DOUBLE_EQ(sqrt(0.2), msgNoise.variance());
 }
 
+/////////////////////////////////////////////////
+TEST_F(AirPressureSensorTest, CachedPressure)
+{
+  const std::string name = "TestAirPressureCache";
+  const std::string topic = "/ignition/sensors/test/air_pressure_cache";
+  sdf::ElementPtr airPressureSdf = AirPressureToSdf(name,
+      ignition::math::Pose3d::Zero, 30, topic, true, false);
+
+  ignition::sensors::SensorFactory sf;
+  std::unique_ptr<ignition::sensors::AirPressureSensor> sensor =
+      sf.CreateSensor<ignition::sensors::AirPressureSensor>(airPressureSdf);
+  ASSERT_NE(nullptr, sensor);
+
+  std::vector<double> pressures;
+  auto connection = sensor->ConnectDataCallback(
+      [&](const ignition::msgs::FluidPressure &_msg)
+      {
+        pressures.push_back(_msg.pressure());
+      });
+
+  sensor->SetReferenceAltitude(1.0);
+  sensor->SetPose(ignition::math::Pose3d(0.25, 0, 2, 0, 0, 0));
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(1)));
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(2)));
+
+  // Moving horizontally doesn't change the pressure
+  sensor->SetPose(ignition::math::Pose3d(5, -3, 2, 0, 0, 1));
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(3)));
+
+  // Moving up or raising the reference lowers the pressure
+  sensor->SetPose(ignition::math::Pose3d(5, -3, 12, 0, 0, 1));
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(4)));
+  sensor->SetReferenceAltitude(100.0);
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(5)));
+
+  // Back to the first height
+  sensor->SetReferenceAltitude(1.0);
+  sensor->SetPose(ignition::math::Pose3d(0, 0, 2, 0, 0, 0));
+  EXPECT_TRUE(sensor->Update(std::chrono::seconds(6)));
+
+  ASSERT_EQ(6u, pressures.size());
+  EXPECT_DOUBLE_EQ(101288.9657925308, pressures[0]);
+  EXPECT_DOUBLE_EQ(pressures[0], pressures[1]);
+  EXPECT_DOUBLE_EQ(pressures[0], pressures[2]);
+  EXPECT_LT(pressures[3], pressures[2]);
+  EXPECT_LT(pressures[4], pressures[3]);
+  EXPECT_DOUBLE_EQ(pressures[0], pressures[5]);
+}
+
 /////////////////////////////////////////////////
 TEST_F(AirPressureSensorTest, Topic)
 {
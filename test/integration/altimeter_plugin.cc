@@ -17,10 +17,15 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
+#include <ignition/msgs/altimeter.pb.h>
+#include <ignition/msgs/param_v.pb.h>
 #include <sdf/sdf.hh>
 
 #include <ignition/math/Helpers.hh>
 #include <ignition/sensors/AltimeterSensor.hh>
+#include <ignition/sensors/Manager.hh>
 #include <ignition/sensors/SensorFactory.hh>
 
 #include "test_config.h"  // NOLINT(build/include)
@@ -153,6 +158,13 @@ TEST_F(AltimeterSensorTest, CreateAltimeter)
   EXPECT_EQ(name, sensorNoise->Name());
   EXPECT_EQ(topicNoise, sensorNoise->Topic());
   EXPECT_DOUBLE_EQ(updateRate, sensorNoise->UpdateRate());
+
+  // The SDF element is copied when it's requested
+  sdf::ElementPtr sensorSdf = sensor->SDF();
+  ASSERT_NE(nullptr, sensorSdf);
+  EXPECT_NE(altimeterSdf, sensorSdf);
+  EXPECT_EQ(name, sensorSdf->Get<std::string>("name"));
+  EXPECT_EQ(sensorSdf, sensor->SDF());
 }
 
 /////////////////////////////////////////////////
@@ -310,6 +322,454 @@ TEST_F(AltimeterSensorTest, Topic)
   }
 }
 
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, ManagerSchedule)
+{
+  using namespace std::chrono_literals;
+  const std::string name = "TestAltimeter";
+  const bool alwaysOn = 1;
+  const bool visualize = 1;
+  auto sensorPose = ignition::math::Pose3d();
+
+  for (unsigned int threads : {1u, 4u})
+  {
+    ignition::sensors::Manager mgr;
+    mgr.SetWorkerThreadCount(threads);
+
+    auto fastSdf = AltimeterToSdf(name + "_fast", sensorPose, 10,
+        "/altimeter_fast", alwaysOn, visualize);
+    auto slowSdf = AltimeterToSdf(name + "_slow", sensorPose, 1,
+        "/altimeter_slow", alwaysOn, visualize);
+
+    auto fastId = mgr.CreateSensor(fastSdf);
+    auto slowId = mgr.CreateSensor(slowSdf);
+    ASSERT_NE(ignition::sensors::NO_SENSOR, fastId);
+    ASSERT_NE(ignition::sensors::NO_SENSOR, slowId);
+    auto fast = mgr.Sensor(fastId);
+    auto slow = mgr.Sensor(slowId);
+    ASSERT_NE(nullptr, fast);
+    ASSERT_NE(nullptr, slow);
+
+    // Both sensors are due at the start
+    mgr.RunOnce(0ms);
+    EXPECT_EQ(100ms, fast->NextDataUpdateTime());
+    EXPECT_EQ(1000ms, slow->NextDataUpdateTime());
+
+    // Nothing is due yet
+    mgr.RunOnce(50ms);
+    EXPECT_EQ(100ms, fast->NextDataUpdateTime());
+    EXPECT_EQ(1000ms, slow->NextDataUpdateTime());
+
+    // Only the fast sensor is due
+    mgr.RunOnce(100ms);
+    EXPECT_EQ(200ms, fast->NextDataUpdateTime());
+    EXPECT_EQ(1000ms, slow->NextDataUpdateTime());
+
+    // Changing the rate requeues the sensor
+    slow->SetUpdateRate(20);
+    mgr.RunOnce(1000ms);
+    EXPECT_EQ(1050ms, slow->NextDataUpdateTime());
+
+    // Removed sensors are no longer updated
+    EXPECT_TRUE(mgr.Remove(fastId));
+    mgr.RunOnce(1050ms);
+    EXPECT_EQ(1100ms, slow->NextDataUpdateTime());
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, RunUntil)
+{
+  using namespace std::chrono_literals;
+  auto sensorPose = ignition::math::Pose3d();
+
+  ignition::sensors::Manager mgr;
+  EXPECT_EQ(std::chrono::steady_clock::duration::max(), mgr.NextDueTime());
+  EXPECT_EQ(0u, mgr.RunUntil(1s));
+
+  auto fastId = mgr.CreateSensor(AltimeterToSdf("TestAltimeterFast",
+      sensorPose, 10, "/altimeter_until_fast", true, true));
+  auto slowId = mgr.CreateSensor(AltimeterToSdf("TestAltimeterSlow",
+      sensorPose, 1, "/altimeter_until_slow", true, true));
+  ASSERT_NE(ignition::sensors::NO_SENSOR, fastId);
+  ASSERT_NE(ignition::sensors::NO_SENSOR, slowId);
+  auto fast = mgr.Sensor(fastId);
+  auto slow = mgr.Sensor(slowId);
+  EXPECT_EQ(0ms, mgr.NextDueTime());
+
+  EXPECT_EQ(1u, mgr.RunUntil(0ms));
+  EXPECT_EQ(100ms, mgr.NextDueTime());
+
+  // Nothing is due yet
+  EXPECT_EQ(0u, mgr.RunUntil(50ms));
+  EXPECT_EQ(1u, fast->Stats().updateCount);
+
+  // Missed updates run at their own time
+  EXPECT_EQ(3u, mgr.RunUntil(350ms));
+  EXPECT_EQ(4u, fast->Stats().updateCount);
+  EXPECT_EQ(400ms, mgr.NextDueTime());
+
+  EXPECT_EQ(7u, mgr.RunUntil(1000ms));
+  EXPECT_EQ(11u, fast->Stats().updateCount);
+  EXPECT_EQ(2u, slow->Stats().updateCount);
+  EXPECT_EQ(1100ms, mgr.NextDueTime());
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, RunUntilTriggered)
+{
+  using namespace std::chrono_literals;
+  auto sensorPose = ignition::math::Pose3d();
+
+  ignition::sensors::Manager mgr;
+  auto fastId = mgr.CreateSensor(AltimeterToSdf("TestAltimeterTimed",
+      sensorPose, 10, "/altimeter_until_timed", true, true));
+  auto triggeredId = mgr.CreateSensor(AltimeterToSdf(
+      "TestAltimeterTriggered", sensorPose, 10,
+      "/altimeter_until_triggered", true, true));
+  ASSERT_NE(ignition::sensors::NO_SENSOR, fastId);
+  ASSERT_NE(ignition::sensors::NO_SENSOR, triggeredId);
+  auto fast = mgr.Sensor(fastId);
+  auto triggered = mgr.Sensor(triggeredId);
+  triggered->SetTriggered(true);
+
+  EXPECT_EQ(1u, mgr.RunUntil(0ms));
+  EXPECT_EQ(0u, triggered->Stats().updateCount);
+  EXPECT_EQ(100ms, mgr.NextDueTime());
+
+  // A pending trigger is due right away
+  WaitForMessageTestHelper<ignition::msgs::Altimeter> helper(
+      "/altimeter_until_triggered");
+  triggered->Trigger();
+  EXPECT_EQ(0ms, mgr.NextDueTime());
+
+  // The triggered sensor updates at the requested time, not at the time
+  // it was queued, after the steps of the timed sensor
+  EXPECT_EQ(3u, mgr.RunUntil(250ms));
+  EXPECT_EQ(3u, fast->Stats().updateCount);
+  EXPECT_EQ(1u, triggered->Stats().updateCount);
+  ASSERT_TRUE(helper.WaitForMessage()) << helper;
+  EXPECT_EQ(0, helper.Message().header().stamp().sec());
+  EXPECT_EQ(250000000, helper.Message().header().stamp().nsec());
+  EXPECT_EQ(300ms, mgr.NextDueTime());
+
+  // Steps don't go back before the previous run
+  EXPECT_EQ(0u, mgr.RunUntil(260ms));
+  EXPECT_EQ(1u, mgr.RunUntil(300ms));
+  EXPECT_EQ(4u, fast->Stats().updateCount);
+  EXPECT_EQ(1u, triggered->Stats().updateCount);
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, CreateSensors)
+{
+  auto sensorPose = ignition::math::Pose3d();
+
+  for (unsigned int threads : {1u, 4u})
+  {
+    ignition::sensors::Manager mgr;
+    mgr.SetWorkerThreadCount(threads);
+
+    std::vector<sdf::Sensor> sdfs(16);
+    for (std::size_t i = 0u; i < sdfs.size(); ++i)
+    {
+      std::string name = "TestAltimeter" + std::to_string(i);
+      auto elem = AltimeterToSdf(name, sensorPose, 10, "/" + name, true,
+          true);
+      sdfs[i].Load(elem);
+    }
+
+    // A sensor without a type can't be created
+    sdfs.push_back(sdf::Sensor());
+
+    auto ids = mgr.CreateSensors(sdfs);
+    ASSERT_EQ(sdfs.size(), ids.size());
+    for (std::size_t i = 0u; i + 1u < ids.size(); ++i)
+    {
+      ASSERT_NE(ignition::sensors::NO_SENSOR, ids[i]);
+      auto sensor = mgr.Sensor(ids[i]);
+      ASSERT_NE(nullptr, sensor);
+      EXPECT_EQ(sdfs[i].Name(), sensor->Name());
+      EXPECT_EQ("/" + sdfs[i].Name(), sensor->Topic());
+    }
+    EXPECT_EQ(ignition::sensors::NO_SENSOR, ids.back());
+
+    // The created sensors are scheduled like the ones from CreateSensor
+    mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+    EXPECT_EQ(std::chrono::milliseconds(100),
+        mgr.Sensor(ids.front())->NextDataUpdateTime());
+  }
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, CloneSensor)
+{
+  auto sensorPose = ignition::math::Pose3d(1, 2, 3, 0, 0, 0);
+  auto altimeterSdf = AltimeterToSdf("TestAltimeter", sensorPose, 10,
+      "/altimeter", true, true);
+
+  ignition::sensors::Manager mgr;
+  auto id = mgr.CreateSensor(altimeterSdf);
+  ASSERT_NE(ignition::sensors::NO_SENSOR, id);
+  auto prototype = mgr.Sensor(id);
+  ASSERT_NE(nullptr, prototype);
+  prototype->SetUpdateRate(20);
+
+  auto cloneId = mgr.CloneSensor(id, "TestAltimeterClone",
+      "/altimeter_clone", "robot2");
+  ASSERT_NE(ignition::sensors::NO_SENSOR, cloneId);
+  EXPECT_NE(id, cloneId);
+  auto clone = mgr.Sensor(cloneId);
+  ASSERT_NE(nullptr, clone);
+  EXPECT_NE(nullptr,
+      dynamic_cast<ignition::sensors::AltimeterSensor *>(clone));
+  EXPECT_EQ("TestAltimeterClone", clone->Name());
+  EXPECT_EQ("/altimeter_clone", clone->Topic());
+  EXPECT_EQ("robot2", clone->Parent());
+  EXPECT_EQ(sensorPose, clone->Pose());
+  EXPECT_DOUBLE_EQ(20.0, clone->UpdateRate());
+
+  // The prototype is unchanged
+  EXPECT_EQ("TestAltimeter", prototype->Name());
+  EXPECT_EQ("/altimeter", prototype->Topic());
+
+  EXPECT_EQ(ignition::sensors::NO_SENSOR,
+      mgr.CloneSensor(ignition::sensors::NO_SENSOR, "a", "/a", "b"));
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, PreloadPlugins)
+{
+  ignition::sensors::SensorFactory factory;
+  EXPECT_FALSE(factory.SensorPluginLoaded("altimeter"));
+
+  EXPECT_TRUE(factory.PreloadSensorPlugins({"altimeter"}));
+  EXPECT_TRUE(factory.SensorPluginLoaded("altimeter"));
+
+  EXPECT_FALSE(factory.PreloadSensorPlugins({"altimeter", "no_such_type"}));
+  EXPECT_FALSE(factory.SensorPluginLoaded("no_such_type"));
+
+  auto loaded = factory.PreloadAllSensorPlugins();
+  EXPECT_NE(loaded.end(),
+      std::find(loaded.begin(), loaded.end(), "altimeter"));
+
+  // Sensors of preloaded types are created from the registry
+  auto altimeterSdf = AltimeterToSdf("TestAltimeter",
+      ignition::math::Pose3d(), 10, "/altimeter", true, true);
+  EXPECT_NE(nullptr, factory.CreateSensor(altimeterSdf));
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, BudgetedRunOnce)
+{
+  using namespace std::chrono_literals;
+  auto sensorPose = ignition::math::Pose3d();
+
+  ignition::sensors::Manager mgr;
+  std::vector<ignition::sensors::Sensor *> sensors;
+  for (int i = 0; i < 3; ++i)
+  {
+    std::string name = "TestAltimeter" + std::to_string(i);
+    auto id = mgr.CreateSensor(AltimeterToSdf(name, sensorPose, 0,
+        "/" + name, true, true));
+    ASSERT_NE(ignition::sensors::NO_SENSOR, id);
+    sensors.push_back(mgr.Sensor(id));
+  }
+  sensors[0]->SetPriority(2);
+  EXPECT_EQ(2, sensors[0]->Priority());
+
+  // A large budget updates every sensor
+  std::vector<ignition::sensors::SensorId> deferred;
+  mgr.RunOnce(0ms, 1h, &deferred);
+  EXPECT_TRUE(deferred.empty());
+  for (auto &s : sensors)
+    EXPECT_EQ(1u, s->Stats().updateCount);
+
+  // Without a budget, only the highest priority sensor is updated
+  mgr.RunOnce(1ms, 0ms, &deferred);
+  EXPECT_EQ(2u, sensors[0]->Stats().updateCount);
+  ASSERT_EQ(2u, deferred.size());
+  EXPECT_EQ(sensors[1]->Id(), deferred[0]);
+  EXPECT_EQ(sensors[2]->Id(), deferred[1]);
+
+  // Deferred sensors aren't starved
+  for (int i = 2; i < 12; ++i)
+    mgr.RunOnce(std::chrono::milliseconds(i), 0ms, &deferred);
+  EXPECT_GT(sensors[1]->Stats().updateCount, 1u);
+  EXPECT_GT(sensors[2]->Stats().updateCount, 1u);
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, LazyUpdates)
+{
+  using namespace std::chrono_literals;
+  auto altimeterSdf = AltimeterToSdf("TestAltimeter",
+      ignition::math::Pose3d(), 0, "/altimeter_lazy", true, true);
+
+  ignition::sensors::Manager mgr;
+  mgr.SetLazyUpdates(true);
+  EXPECT_TRUE(mgr.LazyUpdates());
+  auto id = mgr.CreateSensor(altimeterSdf);
+  ASSERT_NE(ignition::sensors::NO_SENSOR, id);
+  auto sensor = mgr.Sensor(id);
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_TRUE(sensor->LazyUpdates());
+
+  // Nobody is subscribed
+  EXPECT_FALSE(sensor->HasConnections());
+  mgr.RunOnce(0ms);
+  EXPECT_EQ(0u, sensor->Stats().updateCount);
+  EXPECT_EQ(1u, sensor->Stats().skippedUpdateCount);
+
+  WaitForMessageTestHelper<ignition::msgs::Altimeter> helper(
+      "/altimeter_lazy");
+  EXPECT_TRUE(sensor->HasConnections());
+  mgr.RunOnce(1ms);
+  EXPECT_EQ(1u, sensor->Stats().updateCount);
+  EXPECT_TRUE(helper.WaitForMessage()) << helper;
+
+  mgr.SetLazyUpdates(false);
+  EXPECT_FALSE(sensor->LazyUpdates());
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, StaggerUpdates)
+{
+  using namespace std::chrono_literals;
+  auto sensorPose = ignition::math::Pose3d();
+
+  ignition::sensors::Manager mgr;
+  EXPECT_FALSE(mgr.StaggerUpdates());
+  mgr.SetStaggerUpdates(true);
+  EXPECT_TRUE(mgr.StaggerUpdates());
+
+  std::vector<ignition::sensors::Sensor *> sensors;
+  for (int i = 0; i < 4; ++i)
+  {
+    std::string name = "TestAltimeter" + std::to_string(i);
+    auto id = mgr.CreateSensor(AltimeterToSdf(name, sensorPose, 10,
+        "/" + name, true, true));
+    ASSERT_NE(ignition::sensors::NO_SENSOR, id);
+    sensors.push_back(mgr.Sensor(id));
+  }
+
+  // A sensor with another rate starts its own sequence
+  auto otherId = mgr.CreateSensor(AltimeterToSdf("TestAltimeterOther",
+      sensorPose, 1, "/TestAltimeterOther", true, true));
+  ASSERT_NE(ignition::sensors::NO_SENSOR, otherId);
+  EXPECT_EQ(0ms, mgr.Sensor(otherId)->NextDataUpdateTime());
+
+  // First updates are spread over the period
+  EXPECT_EQ(0ms, sensors[0]->NextDataUpdateTime());
+  EXPECT_EQ(50ms, sensors[1]->NextDataUpdateTime());
+  EXPECT_EQ(25ms, sensors[2]->NextDataUpdateTime());
+  EXPECT_EQ(75ms, sensors[3]->NextDataUpdateTime());
+
+  mgr.RunOnce(0ms);
+  EXPECT_EQ(1u, sensors[0]->Stats().updateCount);
+  EXPECT_EQ(0u, sensors[1]->Stats().updateCount);
+  mgr.RunOnce(50ms);
+  EXPECT_EQ(1u, sensors[1]->Stats().updateCount);
+  EXPECT_EQ(150ms, sensors[1]->NextDataUpdateTime());
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, SetPoses)
+{
+  using namespace std::chrono_literals;
+
+  ignition::sensors::Manager mgr;
+  std::vector<ignition::sensors::SensorId> ids;
+  for (int i = 0; i < 3; ++i)
+  {
+    std::string name = "TestAltimeterPose" + std::to_string(i);
+    auto id = mgr.CreateSensor(AltimeterToSdf(name,
+        ignition::math::Pose3d(), 10, "/" + name, true, true));
+    ASSERT_NE(ignition::sensors::NO_SENSOR, id);
+    ids.push_back(id);
+  }
+
+  std::vector<ignition::math::Pose3d> poses = {
+    ignition::math::Pose3d(1, 0, 0, 0, 0, 0),
+    ignition::math::Pose3d(0, 2, 0, 0, 0, 0),
+    ignition::math::Pose3d(0, 0, 3, 0, 0, 0)};
+  EXPECT_TRUE(mgr.SetPoses(ids, poses));
+  for (std::size_t i = 0; i < ids.size(); ++i)
+    EXPECT_EQ(poses[i], mgr.Sensor(ids[i])->Pose());
+
+  // Mismatched arrays are rejected
+  poses.pop_back();
+  EXPECT_FALSE(mgr.SetPoses(ids, poses));
+  EXPECT_EQ(ignition::math::Pose3d(0, 0, 3, 0, 0, 0),
+      mgr.Sensor(ids[2])->Pose());
+
+  // Unknown ids are reported, but the known sensors still move
+  std::vector<ignition::sensors::SensorId> someIds = {
+      ignition::sensors::NO_SENSOR, ids[0]};
+  EXPECT_FALSE(mgr.SetPoses(someIds, poses));
+  EXPECT_EQ(poses[1], mgr.Sensor(ids[0])->Pose());
+
+  // Setting poses and updating in one call
+  std::vector<ignition::sensors::SensorId> oneId = {ids[1]};
+  std::vector<ignition::math::Pose3d> onePose = {
+      ignition::math::Pose3d(5, 5, 5, 0, 0, 0)};
+  EXPECT_TRUE(mgr.RunOnce(0ms, oneId, onePose));
+  EXPECT_EQ(onePose[0], mgr.Sensor(ids[1])->Pose());
+  for (auto id : ids)
+    EXPECT_EQ(1u, mgr.Sensor(id)->Stats().updateCount);
+}
+
+/////////////////////////////////////////////////
+TEST_F(AltimeterSensorTest, Diagnostics)
+{
+  using namespace std::chrono_literals;
+  auto sensorPose = ignition::math::Pose3d();
+  auto altimeterSdf = AltimeterToSdf("DiagnosticsAltimeter", sensorPose, 10,
+      "/test/integration/diagnostics_altimeter", true, true);
+
+  ignition::sensors::Manager mgr;
+  ASSERT_NE(ignition::sensors::NO_SENSOR, mgr.CreateSensor(altimeterSdf));
+
+  const std::string topic = "/test/integration/sensor_diagnostics";
+  WaitForMessageTestHelper<ignition::msgs::Param_V> helper(topic);
+  EXPECT_TRUE(mgr.SetDiagnosticsTopic(topic, 1s));
+  EXPECT_EQ(topic, mgr.DiagnosticsTopic());
+
+  // The first message has no achieved rate yet
+  mgr.RunOnce(0ms);
+  EXPECT_TRUE(helper.WaitForMessage()) << helper;
+  ASSERT_EQ(1, helper.Message().param_size());
+  auto params = helper.Message().param(0).params();
+  EXPECT_DOUBLE_EQ(10.0, params["update_rate"].double_value());
+  EXPECT_DOUBLE_EQ(0.0, params["achieved_rate"].double_value());
+
+  // Ten updates over the next second
+  for (auto time = 100ms; time <= 1000ms; time += 100ms)
+    mgr.RunOnce(time);
+  EXPECT_TRUE(helper.WaitForMessage()) << helper;
+  ASSERT_EQ(1, helper.Message().param_size());
+  params = helper.Message().param(0).params();
+  EXPECT_EQ("DiagnosticsAltimeter", params["name"].string_value());
+  EXPECT_DOUBLE_EQ(11.0, params["update_count"].double_value());
+  EXPECT_NEAR(10.0, params["achieved_rate"].double_value(), 1e-9);
+  EXPECT_EQ(1u, params.count("has_subscribers"));
+  EXPECT_LE(params["update_p50_ms"].double_value(),
+      params["update_p99_ms"].double_value());
+  EXPECT_LE(params["update_p99_ms"].double_value(),
+      params["update_max_ms"].double_value());
+  EXPECT_EQ(1u, params.count("publish_delay_p99_ms"));
+
+  // The sensor falls below its rate
+  for (auto time = 1500ms; time <= 2000ms; time += 500ms)
+    mgr.RunOnce(time);
+  EXPECT_TRUE(helper.WaitForMessage()) << helper;
+  params = helper.Message().param(0).params();
+  EXPECT_NEAR(2.0, params["achieved_rate"].double_value(), 1e-9);
+
+  EXPECT_TRUE(mgr.SetDiagnosticsTopic(""));
+  EXPECT_TRUE(mgr.DiagnosticsTopic().empty());
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
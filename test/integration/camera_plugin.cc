@@ -17,6 +17,12 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <ignition/common/Filesystem.hh>
 #include <ignition/sensors/Manager.hh>
 #include <ignition/sensors/CameraSensor.hh>
@@ -27,6 +33,7 @@
 #pragma warning(push)
 #pragma warning(disable: 4251)
 #endif
+#include <ignition/rendering/DistortionPass.hh>
 #include <ignition/rendering/RenderEngine.hh>
 #include <ignition/rendering/RenderingIface.hh>
 #include <ignition/rendering/Scene.hh>
@@ -53,6 +60,34 @@ class CameraSensorTest: public testing::Test,
 {
   // Create a Camera sensor from a SDF and gets a image message
   public: void ImagesWithBuiltinSDF(const std::string &_renderEngine);
+
+  // Create a Camera sensor with pipelined readback and check the delivered
+  // frames and their timestamps
+  public: void PipelinedReadback(const std::string &_renderEngine);
+
+  // Create a camera sensor with secondary image streams
+  public: void ImageStreams(const std::string &_renderEngine);
+
+  // Create camera sensors publishing gray and Bayer images
+  public: void PixelFormats(const std::string &_renderEngine);
+
+  // Check that camera info is only published when needed
+  public: void InfoOnChange(const std::string &_renderEngine);
+
+  // Create a camera sensor with the fast render quality profile
+  public: void RenderQuality(const std::string &_renderEngine);
+
+  // Create a camera sensor whose resolution adapts to the render time
+  public: void AdaptiveResolution(const std::string &_renderEngine);
+
+  // Check the memory reported by a camera sensor
+  public: void MemoryUsage(const std::string &_renderEngine);
+
+  // Create a camera sensor with lens distortion
+  public: void LensDistortion(const std::string &_renderEngine);
+
+  // Check the image views delivered by a camera sensor
+  public: void ImageViews(const std::string &_renderEngine);
 };
 
 void CameraSensorTest::ImagesWithBuiltinSDF(const std::string &_renderEngine)
@@ -108,12 +143,724 @@ void CameraSensorTest::ImagesWithBuiltinSDF(const std::string &_renderEngine)
   ignition::rendering::unloadEngine(engine->Name());
 }
 
+//////////////////////////////////////////////////
+void CameraSensorTest::PipelinedReadback(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+
+  EXPECT_EQ(1u, sensor->ReadbackDepth());
+  sensor->SetReadbackDepth(3u);
+  EXPECT_EQ(3u, sensor->ReadbackDepth());
+  sensor->SetReadbackDepth(100u);
+  EXPECT_EQ(4u, sensor->ReadbackDepth());
+  sensor->SetReadbackDepth(0u);
+  EXPECT_EQ(1u, sensor->ReadbackDepth());
+  sensor->SetReadbackDepth(2u);
+
+  std::vector<std::chrono::steady_clock::duration> stamps;
+  auto connection = sensor->ConnectImageCallback(
+      [&stamps](const ignition::msgs::Image &_msg)
+      {
+        EXPECT_EQ(256u, _msg.width());
+        EXPECT_EQ(257u, _msg.height());
+        stamps.push_back(ignition::msgs::Convert(_msg.header().stamp()));
+      });
+
+  // The first update only fills the ring
+  sensor->Update(std::chrono::seconds(1));
+  EXPECT_TRUE(stamps.empty());
+
+  // Each following update delivers the frame rendered one update earlier
+  sensor->Update(std::chrono::seconds(2));
+  ASSERT_EQ(1u, stamps.size());
+  EXPECT_EQ(std::chrono::seconds(1), stamps[0]);
+
+  sensor->Update(std::chrono::seconds(3));
+  ASSERT_EQ(2u, stamps.size());
+  EXPECT_EQ(std::chrono::seconds(2), stamps[1]);
+
+  // Going back to synchronous readback drops the frame in flight
+  sensor->SetReadbackDepth(1u);
+  sensor->Update(std::chrono::seconds(4));
+  ASSERT_EQ(3u, stamps.size());
+  EXPECT_EQ(std::chrono::seconds(4), stamps[2]);
+
+  // Clean up
+  connection.reset();
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::ImageStreams(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+
+  // The frames are 256x257
+  EXPECT_TRUE(sensor->AddImageStream("preview", 64u, 64u));
+  EXPECT_TRUE(sensor->AddImageStream("roi", 32u, 16u,
+      ignition::math::Vector2i(200, 100), ignition::math::Vector2i(32, 16)));
+  EXPECT_FALSE(sensor->AddImageStream("preview", 32u, 32u));
+  EXPECT_FALSE(sensor->AddImageStream("outside", 32u, 32u,
+      ignition::math::Vector2i(240, 0), ignition::math::Vector2i(32, 32)));
+  EXPECT_FALSE(sensor->AddImageStream("empty", 0u, 32u));
+  EXPECT_TRUE(sensor->ImageStreamTopic("outside").empty());
+
+  std::string topic = "/test/integration/CameraPlugin_imagesWithBuiltinSDF";
+  EXPECT_EQ(topic + "/preview", sensor->ImageStreamTopic("preview"));
+  EXPECT_EQ(topic + "/roi", sensor->ImageStreamTopic("roi"));
+
+  // Subscribers of a stream alone are enough to render
+  WaitForMessageTestHelper<ignition::msgs::Image> helper(topic + "/preview");
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+  EXPECT_TRUE(helper.WaitForMessage()) << helper;
+  ignition::msgs::Image msg = helper.Message();
+  EXPECT_EQ(64u, msg.width());
+  EXPECT_EQ(64u, msg.height());
+  EXPECT_EQ(64u * 3u, msg.step());
+  EXPECT_EQ(64u * 64u * 3u, msg.data().size());
+
+  EXPECT_TRUE(sensor->RemoveImageStream("roi"));
+  EXPECT_FALSE(sensor->RemoveImageStream("roi"));
+  EXPECT_TRUE(sensor->ImageStreamTopic("roi").empty());
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::PixelFormats(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  struct Format
+  {
+    std::string sdf;
+    ignition::msgs::PixelFormatType msgs;
+    unsigned int bytes;
+  };
+  const std::vector<Format> formats = {
+    {"L8", ignition::msgs::PixelFormatType::L_INT8, 1u},
+    {"L16", ignition::msgs::PixelFormatType::L_INT16, 2u},
+    {"BAYER_RGGB8", ignition::msgs::PixelFormatType::BAYER_RGGB8, 1u},
+    {"BAYER_BGGR8", ignition::msgs::PixelFormatType::BAYER_BGGR8, 1u},
+    {"BAYER_GBRG8", ignition::msgs::PixelFormatType::BAYER_GBRG8, 1u},
+    {"BAYER_GRBG8", ignition::msgs::PixelFormatType::BAYER_GRBG8, 1u},
+  };
+
+  for (const Format &format : formats)
+  {
+    sdf::SDFPtr doc(new sdf::SDF());
+    sdf::init(doc);
+    ASSERT_TRUE(sdf::readFile(path, doc));
+    ASSERT_NE(nullptr, doc->Root());
+    auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+        ->GetElement("sensor");
+    ASSERT_NE(nullptr, sensorPtr);
+    sensorPtr->GetAttribute("name")->Set("camera_" + format.sdf);
+    sensorPtr->GetElement("camera")->GetElement("image")
+        ->GetElement("format")->Set(format.sdf);
+
+    ignition::sensors::Manager mgr;
+    ignition::sensors::CameraSensor *sensor =
+        mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+    ASSERT_NE(sensor, nullptr) << format.sdf;
+    sensor->SetScene(scene);
+
+    unsigned int count = 0u;
+    auto connection = sensor->ConnectImageCallback(
+        [&](const ignition::msgs::Image &_msg)
+        {
+          EXPECT_EQ(format.msgs, _msg.pixel_format_type()) << format.sdf;
+          EXPECT_EQ(256u * format.bytes, _msg.step()) << format.sdf;
+          EXPECT_EQ(256u * 257u * format.bytes, _msg.data().size())
+              << format.sdf;
+          ++count;
+        });
+
+    sensor->Update(std::chrono::steady_clock::duration::zero());
+    EXPECT_EQ(1u, count) << format.sdf;
+    connection.reset();
+  }
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::InfoOnChange(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+  EXPECT_EQ(std::chrono::seconds(1), sensor->InfoPublishPeriod());
+  EXPECT_EQ(sensor->InfoTopic() + "/request", sensor->InfoService());
+
+  std::mutex mutex;
+  std::vector<ignition::msgs::CameraInfo> infos;
+  std::function<void(const ignition::msgs::CameraInfo &)> onInfo =
+      [&](const ignition::msgs::CameraInfo &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        infos.push_back(_msg);
+      };
+  ignition::transport::Node node;
+  ASSERT_TRUE(node.Subscribe(sensor->InfoTopic(), onInfo));
+
+  auto waitForInfos = [&](const std::size_t _count)
+      {
+        for (int sleep = 0; sleep < 100; ++sleep)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (infos.size() >= _count)
+              break;
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        return infos.size();
+      };
+
+  // Unchanged camera info is only published once per period
+  auto connection = sensor->ConnectImageCallback(
+      [](const ignition::msgs::Image &) {});
+  sensor->Update(std::chrono::milliseconds(0));
+  sensor->Update(std::chrono::milliseconds(100));
+  sensor->Update(std::chrono::milliseconds(200));
+  EXPECT_EQ(1u, waitForInfos(1u));
+
+  // Changes are published with the next frame
+  sensor->SetBaseline(0.5);
+  sensor->Update(std::chrono::milliseconds(300));
+  ASSERT_EQ(2u, waitForInfos(2u));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_DOUBLE_EQ(-0.5 * infos[1].projection().p(0),
+        infos[1].projection().p(3));
+  }
+
+  sensor->Update(std::chrono::milliseconds(1300));
+  EXPECT_EQ(3u, waitForInfos(3u));
+
+  // Late subscribers can request the camera info
+  ignition::msgs::Empty req;
+  ignition::msgs::CameraInfo rep;
+  bool result = false;
+  EXPECT_TRUE(node.Request(sensor->InfoService(), req, 1000u, rep, result));
+  EXPECT_TRUE(result);
+  EXPECT_EQ(256u, rep.width());
+  EXPECT_EQ(257u, rep.height());
+  EXPECT_DOUBLE_EQ(-0.5 * rep.projection().p(0), rep.projection().p(3));
+
+  // Clean up
+  connection.reset();
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::RenderQuality(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  mgr.SetRenderQuality(ignition::sensors::RenderQualityProfile::FAST);
+
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  EXPECT_EQ(ignition::sensors::RenderQualityProfile::FAST,
+      sensor->RenderQuality());
+  sensor->SetScene(scene);
+
+  // The camera renders at half resolution without anti-aliasing
+  ignition::rendering::CameraPtr camera = sensor->RenderingCamera();
+  ASSERT_NE(nullptr, camera);
+  EXPECT_EQ(128u, camera->ImageWidth());
+  EXPECT_EQ(129u, camera->ImageHeight());
+  EXPECT_EQ(0u, camera->AntiAliasing());
+
+  // Images are published at the requested size
+  EXPECT_EQ(256u, sensor->ImageWidth());
+  EXPECT_EQ(257u, sensor->ImageHeight());
+
+  unsigned int count = 0u;
+  auto connection = sensor->ConnectImageCallback(
+      [&](const ignition::msgs::Image &_msg)
+      {
+        EXPECT_EQ(256u, _msg.width());
+        EXPECT_EQ(257u, _msg.height());
+        EXPECT_EQ(256u * 3u, _msg.step());
+        EXPECT_EQ(256u * 257u * 3u, _msg.data().size());
+        ++count;
+      });
+
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_EQ(1u, count);
+  connection.reset();
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::AdaptiveResolution(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+  EXPECT_EQ(std::chrono::steady_clock::duration::zero(),
+      sensor->AdaptiveResolutionBudget());
+  EXPECT_DOUBLE_EQ(1.0, sensor->ResolutionScale());
+
+  // No frame fits in the budget, so the scale drops to the minimum
+  sensor->SetAdaptiveResolution(std::chrono::nanoseconds(1), 0.5);
+  EXPECT_EQ(std::chrono::nanoseconds(1), sensor->AdaptiveResolutionBudget());
+
+  unsigned int width = 0u;
+  unsigned int height = 0u;
+  auto connection = sensor->ConnectImageCallback(
+      [&](const ignition::msgs::Image &_msg)
+      {
+        width = _msg.width();
+        height = _msg.height();
+      });
+
+  for (int i = 0; i < 20; ++i)
+    sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_DOUBLE_EQ(0.5, sensor->ResolutionScale());
+  EXPECT_EQ(128u, sensor->RenderingCamera()->ImageWidth());
+  EXPECT_EQ(129u, sensor->RenderingCamera()->ImageHeight());
+
+  // Images are scaled back to the requested size
+  EXPECT_EQ(256u, width);
+  EXPECT_EQ(257u, height);
+
+  // Unless the consumer asks for scaled images
+  sensor->SetAdaptiveResolution(std::chrono::nanoseconds(1), 0.5, true);
+  for (int i = 0; i < 20; ++i)
+    sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_EQ(128u, width);
+  EXPECT_EQ(129u, height);
+
+  // Disabling goes back to full resolution
+  sensor->SetAdaptiveResolution(std::chrono::steady_clock::duration::zero());
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_DOUBLE_EQ(1.0, sensor->ResolutionScale());
+  EXPECT_EQ(256u, sensor->RenderingCamera()->ImageWidth());
+  EXPECT_EQ(256u, width);
+  EXPECT_EQ(257u, height);
+  connection.reset();
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::MemoryUsage(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+
+  // An RGB render target of 256x257 pixels and its readback image
+  const uint64_t frameBytes = 256u * 257u * 3u;
+  ignition::sensors::SensorMemory memory;
+  ASSERT_TRUE(mgr.MemoryUsage(sensor->Id(), memory));
+  EXPECT_EQ(frameBytes, memory.renderTargetBytes);
+  EXPECT_EQ(frameBytes, memory.readbackBytes);
+
+  // The message keeps the last image
+  auto connection = sensor->ConnectImageCallback(
+      [](const ignition::msgs::Image &) {});
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  memory = mgr.TotalMemoryUsage();
+  EXPECT_GE(memory.messageBytes, frameBytes);
+  connection.reset();
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::LensDistortion(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  sdf::Sensor sdfSensor;
+  sdfSensor.Load(sensorPtr);
+  sdf::Camera cameraSdf = *sdfSensor.CameraSensor();
+  cameraSdf.SetDistortionK1(-0.25);
+  cameraSdf.SetDistortionK2(0.12);
+  cameraSdf.SetDistortionP1(-0.00028);
+  sdfSensor.SetCameraSensor(cameraSdf);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sdfSensor);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+
+  // Engines without distortion passes only have the noise pass
+  ignition::rendering::CameraPtr camera = sensor->RenderingCamera();
+  ASSERT_NE(nullptr, camera);
+  ASSERT_GT(camera->RenderPassCount(), 0u);
+  auto distortion = std::dynamic_pointer_cast<
+      ignition::rendering::DistortionPass>(camera->RenderPassByIndex(0u));
+  if (distortion)
+  {
+    EXPECT_DOUBLE_EQ(-0.25, distortion->K1());
+    EXPECT_DOUBLE_EQ(0.12, distortion->K2());
+    EXPECT_DOUBLE_EQ(-0.00028, distortion->P1());
+  }
+  else
+  {
+    EXPECT_EQ(1u, camera->RenderPassCount());
+  }
+
+  unsigned int count = 0u;
+  auto connection = sensor->ConnectImageCallback(
+      [&](const ignition::msgs::Image &_msg)
+      {
+        EXPECT_EQ(256u, _msg.width());
+        EXPECT_EQ(257u, _msg.height());
+        ++count;
+      });
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_EQ(1u, count);
+  connection.reset();
+
+  // New coefficients are applied to the pass in place
+  cameraSdf.SetDistortionK1(-0.1);
+  sdfSensor.SetCameraSensor(cameraSdf);
+  EXPECT_TRUE(sensor->Reconfigure(sdfSensor));
+  EXPECT_EQ(camera, sensor->RenderingCamera());
+  if (distortion)
+    EXPECT_DOUBLE_EQ(-0.1, distortion->K1());
+
+  // Removing the distortion needs a new camera
+  cameraSdf.SetDistortionK1(0.0);
+  cameraSdf.SetDistortionK2(0.0);
+  cameraSdf.SetDistortionP1(0.0);
+  sdfSensor.SetCameraSensor(cameraSdf);
+  EXPECT_FALSE(sensor->Reconfigure(sdfSensor));
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+void CameraSensorTest::ImageViews(const std::string &_renderEngine)
+{
+  std::string path = ignition::common::joinPaths(PROJECT_SOURCE_PATH, "test",
+      "integration", "camera_sensor_builtin.sdf");
+  sdf::SDFPtr doc(new sdf::SDF());
+  sdf::init(doc);
+  ASSERT_TRUE(sdf::readFile(path, doc));
+  ASSERT_NE(nullptr, doc->Root());
+  auto sensorPtr = doc->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor");
+  ASSERT_NE(nullptr, sensorPtr);
+
+  // Setup ign-rendering with an empty scene
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  ignition::sensors::Manager mgr;
+  ignition::sensors::CameraSensor *sensor =
+      mgr.CreateSensor<ignition::sensors::CameraSensor>(sensorPtr);
+  ASSERT_NE(sensor, nullptr);
+  sensor->SetScene(scene);
+
+  // A view callback alone gets the pixels without a message
+  unsigned int count = 0u;
+  std::string pixels;
+  auto viewConnection = sensor->ConnectImageViewCallback(
+      [&](const ignition::sensors::ImageView &_view)
+      {
+        EXPECT_EQ(256u, _view.width);
+        EXPECT_EQ(257u, _view.height);
+        EXPECT_EQ(256u * 3u, _view.step);
+        EXPECT_EQ(ignition::msgs::PixelFormatType::RGB_INT8, _view.format);
+        EXPECT_EQ(std::chrono::seconds(2), _view.stamp);
+        ASSERT_NE(nullptr, _view.data);
+        pixels.assign(reinterpret_cast<const char *>(_view.data),
+            _view.step * _view.height);
+        ++count;
+      });
+  EXPECT_TRUE(sensor->HasConnections());
+
+  // Warming up renders without delivering images
+  EXPECT_EQ(1u, mgr.WarmUp());
+  EXPECT_EQ(0u, count);
+
+  sensor->Update(std::chrono::seconds(2));
+  EXPECT_EQ(1u, count);
+  ignition::sensors::SensorMemory memory;
+  ASSERT_TRUE(mgr.MemoryUsage(sensor->Id(), memory));
+  EXPECT_LT(memory.messageBytes, 256u * 257u * 3u);
+
+  // Views and messages carry the same pixels
+  std::string msgPixels;
+  auto connection = sensor->ConnectImageCallback(
+      [&](const ignition::msgs::Image &_msg)
+      {
+        msgPixels = _msg.data();
+      });
+  sensor->Update(std::chrono::seconds(2));
+  EXPECT_EQ(2u, count);
+  EXPECT_EQ(msgPixels, pixels);
+  connection.reset();
+  viewConnection.reset();
+
+  // Clean up
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
 //////////////////////////////////////////////////
 TEST_P(CameraSensorTest, ImagesWithBuiltinSDF)
 {
   ImagesWithBuiltinSDF(GetParam());
 }
 
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, PipelinedReadback)
+{
+  PipelinedReadback(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, ImageStreams)
+{
+  ImageStreams(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, PixelFormats)
+{
+  PixelFormats(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, InfoOnChange)
+{
+  InfoOnChange(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, RenderQuality)
+{
+  RenderQuality(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, AdaptiveResolution)
+{
+  AdaptiveResolution(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, MemoryUsage)
+{
+  MemoryUsage(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, LensDistortion)
+{
+  LensDistortion(GetParam());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraSensorTest, ImageViews)
+{
+  ImageViews(GetParam());
+}
+
 INSTANTIATE_TEST_CASE_P(CameraSensor, CameraSensorTest,
     RENDER_ENGINE_VALUES, ignition::rendering::PrintToStringParam());
 
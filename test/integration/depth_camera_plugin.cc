@@ -230,6 +230,11 @@ void DepthCameraSensorTest::ImagesWithBuiltinSDF(
   ignition::sensors::DepthCameraSensor *depthSensor =
       mgr.CreateSensor<ignition::sensors::DepthCameraSensor>(sensorPtr);
   ASSERT_NE(depthSensor, nullptr);
+
+  // Publish camera info with every frame, so that it can be counted along
+  // with the images
+  depthSensor->SetInfoPublishPeriod(
+      std::chrono::steady_clock::duration::zero());
   depthSensor->SetScene(scene);
 
   EXPECT_EQ(depthSensor->ImageWidth(), static_cast<unsigned int>(imgWidth));
@@ -495,6 +500,27 @@ void DepthCameraSensorTest::ImagesWithBuiltinSDF(
   g_mutex.unlock();
   g_pcMutex.unlock();
 
+  // Publish the same depths as 16 bit millimeters. OnImage expects floats.
+  node.Unsubscribe(topic);
+  depthSensor->SetDepthUnit(0.001);
+  EXPECT_DOUBLE_EQ(0.001, depthSensor->DepthUnit());
+  ignition::msgs::Image unitsMsg;
+  auto unitsConnection = depthSensor->ConnectImageCallback(
+      [&unitsMsg](const ignition::msgs::Image &_msg)
+      {
+        unitsMsg.CopyFrom(_msg);
+      });
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero(), true);
+
+  EXPECT_EQ(ignition::msgs::PixelFormatType::L_INT16,
+      unitsMsg.pixel_format_type());
+  EXPECT_EQ(depthSensor->ImageWidth() * 2u, unitsMsg.step());
+  ASSERT_EQ(depthSensor->ImageWidth() * depthSensor->ImageHeight() * 2u,
+      unitsMsg.data().size());
+  const uint16_t *units =
+      reinterpret_cast<const uint16_t *>(unitsMsg.data().data());
+  EXPECT_NEAR(expectedDepth * 1000.0, units[mid], 1.0);
+
   // Clean up
   engine->DestroyScene(scene);
   ignition::rendering::unloadEngine(engine->Name());
@@ -17,6 +17,13 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <ignition/common/Console.hh>
 #include <ignition/common/Filesystem.hh>
 #include <ignition/common/Event.hh>
@@ -71,7 +78,7 @@ sdf::ElementPtr GpuLidarToSdf(const std::string &name,
     const double vertResolution, const double vertMinAngle,
     const double vertMaxAngle, const double rangeResolution,
     const double rangeMin, const double rangeMax, const bool alwaysOn,
-    const bool visualize)
+    const bool visualize, const std::string &extra = "")
 {
   std::ostringstream stream;
   stream
@@ -106,6 +113,7 @@ sdf::ElementPtr GpuLidarToSdf(const std::string &name,
     << "      </ray>"
     << "      <alwaysOn>"<< alwaysOn <<"</alwaysOn>"
     << "      <visualize>" << visualize << "</visualize>"
+    << extra
     << "    </sensor>"
     << "  </link>"
     << " </model>"
@@ -163,6 +171,15 @@ class GpuLidarSensorTest: public testing::Test,
 
   // Test topics
   public: void Topic(const std::string &_renderEngine);
+
+  // Test sweeps scanned in sectors
+  public: void SweepSectors(const std::string &_renderEngine);
+
+  // Test lidars that can't scan sectors
+  public: void SweepSectorsFallback(const std::string &_renderEngine);
+
+  // Test point clouds published in chunks
+  public: void PointCloudChunks(const std::string &_renderEngine);
 };
 
 /////////////////////////////////////////////////
@@ -892,6 +909,263 @@ void GpuLidarSensorTest::Topic(const std::string &_renderEngine)
   }
 }
 
+/////////////////////////////////////////////////
+/// \brief Test sweeps scanned in sectors
+void GpuLidarSensorTest::SweepSectors(const std::string &_renderEngine)
+{
+  const std::string topic = "/ignition/sensors/test/lidar_sectors";
+  const double updateRate = 10;
+  const unsigned int horzSamples = 320;
+  const double horzMinAngle = -IGN_PI/2.0;
+  const double horzMaxAngle = IGN_PI/2.0;
+  const ignition::math::Pose3d testPose(
+      ignition::math::Vector3d(0.0, 0.0, 0.1),
+      ignition::math::Quaterniond::Identity);
+
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+  ignition::rendering::VisualPtr root = scene->RootVisual();
+  scene->SetAmbientLight(0.3, 0.3, 0.3);
+
+  // A box on the right, so each sector sees something else
+  ignition::rendering::VisualPtr visualBox = scene->CreateVisual("TestBox");
+  visualBox->AddGeometry(scene->CreateBox());
+  visualBox->SetLocalPosition(1, -0.5, 0.5);
+  root->AddChild(visualBox);
+
+  ignition::sensors::Manager mgr;
+  auto *sensor = mgr.CreateSensor<ignition::sensors::GpuLidarSensor>(
+      GpuLidarToSdf("TestGpuLidarSectors", testPose, updateRate, topic,
+      horzSamples, 1, horzMinAngle, horzMaxAngle, 1, 1, 0, 0, 0.01, 0.08,
+      10.0, true, false,
+      "<ignition:sweep_sectors>4</ignition:sweep_sectors>"));
+  ASSERT_NE(nullptr, sensor);
+  sensor->SetScene(scene);
+
+  // A lidar scanning whole sweeps at the same place
+  auto *reference = mgr.CreateSensor<ignition::sensors::GpuLidarSensor>(
+      GpuLidarToSdf("TestGpuLidarReference", testPose, updateRate,
+      topic + "_reference", horzSamples, 1, horzMinAngle, horzMaxAngle, 1,
+      1, 0, 0, 0.01, 0.08, 10.0, true, false));
+  ASSERT_NE(nullptr, reference);
+  reference->SetScene(scene);
+
+  // Whole sweeps keep their rate
+  EXPECT_EQ(4u, sensor->SweepSectors());
+  EXPECT_DOUBLE_EQ(40.0, sensor->UpdateRate());
+
+  WaitForMessageTestHelper<ignition::msgs::LaserScan> sectorHelper(topic);
+  WaitForMessageTestHelper<ignition::msgs::LaserScan> fullHelper(
+      topic + "/full");
+  for (int k = 0; k < 4; ++k)
+    mgr.RunOnce(std::chrono::milliseconds(25 * k));
+  EXPECT_EQ(std::chrono::milliseconds(100), sensor->NextDataUpdateTime());
+
+  // The last sector has the last quarter of the columns
+  ASSERT_TRUE(sectorHelper.WaitForMessage()) << sectorHelper;
+  ignition::msgs::LaserScan sector = sectorHelper.Message();
+  EXPECT_EQ(horzSamples / 4u, sector.count());
+  EXPECT_NEAR(horzMinAngle + 3u * horzSamples / 4u *
+      sensor->AngleResolution(), sector.angle_min(), DOUBLE_TOL);
+
+  // The full sweep puts the sectors back together
+  ASSERT_TRUE(fullHelper.WaitForMessage()) << fullHelper;
+  ignition::msgs::LaserScan full = fullHelper.Message();
+  ASSERT_EQ(static_cast<int>(horzSamples), full.ranges_size());
+  for (unsigned int i = 0; i < horzSamples; ++i)
+  {
+    if (std::isinf(reference->Range(i)))
+      EXPECT_TRUE(std::isinf(full.ranges(i))) << i;
+    else
+      EXPECT_NEAR(reference->Range(i), full.ranges(i), LASER_TOL) << i;
+  }
+
+  // Changing the sectors once loaded creates them again
+  sensor->SetSweepSectors(2u);
+  EXPECT_EQ(2u, sensor->SweepSectors());
+  EXPECT_DOUBLE_EQ(20.0, sensor->UpdateRate());
+  mgr.RunOnce(std::chrono::seconds(1));
+  mgr.RunOnce(std::chrono::milliseconds(1050));
+  ASSERT_TRUE(fullHelper.WaitForMessage()) << fullHelper;
+  full = fullHelper.Message();
+  ASSERT_EQ(static_cast<int>(horzSamples), full.ranges_size());
+  for (unsigned int i = 0; i < horzSamples; ++i)
+  {
+    if (std::isinf(reference->Range(i)))
+      EXPECT_TRUE(std::isinf(full.ranges(i))) << i;
+    else
+      EXPECT_NEAR(reference->Range(i), full.ranges(i), LASER_TOL) << i;
+  }
+  ASSERT_TRUE(sectorHelper.WaitForMessage()) << sectorHelper;
+  EXPECT_EQ(horzSamples / 2u, sectorHelper.Message().count());
+
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+/////////////////////////////////////////////////
+/// \brief Test lidars that can't scan sectors
+void GpuLidarSensorTest::SweepSectorsFallback(
+    const std::string &_renderEngine)
+{
+  const std::string topic = "/ignition/sensors/test/lidar_sectors_shared";
+  const unsigned int horzSamples = 320;
+  const ignition::math::Pose3d testPose(
+      ignition::math::Vector3d(0.0, 0.0, 0.1),
+      ignition::math::Quaterniond::Identity);
+
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+
+  // Lidars that share their rays render whole sweeps
+  ignition::sensors::Manager mgr;
+  auto *sensor = mgr.CreateSensor<ignition::sensors::GpuLidarSensor>(
+      GpuLidarToSdf("TestGpuLidarShared", testPose, 10, topic,
+      horzSamples, 1, -IGN_PI/2.0, IGN_PI/2.0, 1, 1, 0, 0, 0.01, 0.08,
+      10.0, true, false,
+      "<ignition:sweep_sectors>4</ignition:sweep_sectors>"
+      "<ignition:shared_rays>sectors_group</ignition:shared_rays>"));
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_DOUBLE_EQ(40.0, sensor->UpdateRate());
+  sensor->SetScene(scene);
+
+  // The rate is back to the rate of whole sweeps
+  EXPECT_EQ(1u, sensor->SweepSectors());
+  EXPECT_DOUBLE_EQ(10.0, sensor->UpdateRate());
+
+  WaitForMessageTestHelper<ignition::msgs::LaserScan> helper(topic);
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero());
+  ASSERT_TRUE(helper.WaitForMessage()) << helper;
+  EXPECT_EQ(static_cast<int>(horzSamples), helper.Message().ranges_size());
+  EXPECT_EQ(std::chrono::milliseconds(100), sensor->NextDataUpdateTime());
+
+  // Setting sectors once loaded falls back too
+  sensor->SetSweepSectors(2u);
+  EXPECT_EQ(1u, sensor->SweepSectors());
+  EXPECT_DOUBLE_EQ(10.0, sensor->UpdateRate());
+
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
+/////////////////////////////////////////////////
+/// \brief Get the first value of a header entry
+/// \param[in] _header Header
+/// \param[in] _key Key of the entry
+/// \return The value, or an empty string if there is none
+std::string HeaderValue(const ignition::msgs::Header &_header,
+    const std::string &_key)
+{
+  for (const auto &entry : _header.data())
+  {
+    if (entry.key() == _key && entry.value_size() > 0)
+      return entry.value(0);
+  }
+  return "";
+}
+
+/////////////////////////////////////////////////
+/// \brief Test point clouds published in chunks
+void GpuLidarSensorTest::PointCloudChunks(const std::string &_renderEngine)
+{
+  const std::string topic = "/ignition/sensors/test/lidar_chunks";
+  const unsigned int horzSamples = 32;
+  const unsigned int vertSamples = 10;
+  const unsigned int chunkRows = 4;
+  const ignition::math::Pose3d testPose(
+      ignition::math::Vector3d(0.0, 0.0, 0.1),
+      ignition::math::Quaterniond::Identity);
+
+  auto *engine = ignition::rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  ignition::rendering::ScenePtr scene = engine->CreateScene("scene");
+  ignition::rendering::VisualPtr root = scene->RootVisual();
+
+  // A box in front, so the rows aren't all empty
+  ignition::rendering::VisualPtr visualBox = scene->CreateVisual("TestBox");
+  visualBox->AddGeometry(scene->CreateBox());
+  visualBox->SetLocalPosition(1, 0, 0.5);
+  root->AddChild(visualBox);
+
+  ignition::sensors::Manager mgr;
+  std::ostringstream extra;
+  extra << "<ignition:point_cloud_chunk_rows>" << chunkRows
+        << "</ignition:point_cloud_chunk_rows>";
+  auto *sensor = mgr.CreateSensor<ignition::sensors::GpuLidarSensor>(
+      GpuLidarToSdf("TestGpuLidarChunks", testPose, 10, topic,
+      horzSamples, 1, -IGN_PI/4.0, IGN_PI/4.0, vertSamples, 1, -IGN_PI/8.0,
+      IGN_PI/8.0, 0.01, 0.08, 10.0, true, false, extra.str()));
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_EQ(chunkRows, sensor->PointCloudChunkRows());
+  sensor->SetScene(scene);
+
+  pointMsgs.clear();
+  ignition::transport::Node node;
+  node.Subscribe(topic + "/points", &::pointCb);
+
+  auto waitTime = std::chrono::milliseconds(10);
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero(), true);
+  for (int i = 0; pointMsgs.size() < 3u && i < 300; ++i)
+    std::this_thread::sleep_for(waitTime);
+
+  // 10 rows are published in chunks of 4, 4 and 2 rows
+  ASSERT_EQ(3u, pointMsgs.size());
+  const std::vector<ignition::msgs::PointCloudPacked> chunks = pointMsgs;
+  std::string assembled;
+  for (unsigned int c = 0; c < chunks.size(); ++c)
+  {
+    const ignition::msgs::PointCloudPacked &chunk = chunks[c];
+    EXPECT_EQ(horzSamples, chunk.width()) << c;
+    EXPECT_EQ(c < 2u ? chunkRows : 2u, chunk.height()) << c;
+    EXPECT_EQ(chunk.row_step() * chunk.height(), chunk.data().size()) << c;
+    EXPECT_EQ("0", HeaderValue(chunk.header(), "scan_id")) << c;
+    EXPECT_EQ("3", HeaderValue(chunk.header(), "chunk_count")) << c;
+    EXPECT_EQ(std::to_string(c), HeaderValue(chunk.header(), "chunk"));
+    EXPECT_EQ(std::to_string(c * chunkRows),
+        HeaderValue(chunk.header(), "first_row"));
+    EXPECT_EQ(chunks[0].header().stamp().sec(), chunk.header().stamp().sec());
+    EXPECT_EQ(HeaderValue(chunks[0].header(), "seq"),
+        HeaderValue(chunk.header(), "seq"));
+    assembled += chunk.data();
+  }
+
+  // The chunks put back together are the whole point cloud
+  sensor->SetPointCloudChunkRows(0u);
+  pointMsgs.clear();
+  mgr.RunOnce(std::chrono::milliseconds(100), true);
+  for (int i = 0; pointMsgs.empty() && i < 300; ++i)
+    std::this_thread::sleep_for(waitTime);
+  ASSERT_EQ(1u, pointMsgs.size());
+  const ignition::msgs::PointCloudPacked &whole = pointMsgs[0];
+  EXPECT_EQ(vertSamples, whole.height());
+  EXPECT_EQ(chunks[0].row_step(), whole.row_step());
+  EXPECT_EQ(whole.data(), assembled);
+  EXPECT_EQ("", HeaderValue(whole.header(), "chunk_count"));
+
+  engine->DestroyScene(scene);
+  ignition::rendering::unloadEngine(engine->Name());
+}
+
 /////////////////////////////////////////////////
 TEST_P(GpuLidarSensorTest, CreateGpuLidar)
 {
@@ -928,6 +1202,24 @@ TEST_P(GpuLidarSensorTest, Topic)
   Topic(GetParam());
 }
 
+/////////////////////////////////////////////////
+TEST_P(GpuLidarSensorTest, SweepSectors)
+{
+  SweepSectors(GetParam());
+}
+
+/////////////////////////////////////////////////
+TEST_P(GpuLidarSensorTest, SweepSectorsFallback)
+{
+  SweepSectorsFallback(GetParam());
+}
+
+/////////////////////////////////////////////////
+TEST_P(GpuLidarSensorTest, PointCloudChunks)
+{
+  PointCloudChunks(GetParam());
+}
+
 INSTANTIATE_TEST_CASE_P(GpuLidarSensor, GpuLidarSensorTest,
     RENDER_ENGINE_VALUES, ignition::rendering::PrintToStringParam());
 
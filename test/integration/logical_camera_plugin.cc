@@ -17,6 +17,12 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <sdf/sdf.hh>
 
 #include <ignition/common/Console.hh>
@@ -168,6 +174,7 @@ TEST_F(LogicalCameraSensorTest, DetectBox)
   // verify initial image
   auto img = sensor->Image();
   EXPECT_EQ(0, img.model().size());
+  EXPECT_EQ(nullptr, sensor->ImageSnapshot());
 
   // Create testing boxes
   // 1. box in the center
@@ -190,6 +197,11 @@ TEST_F(LogicalCameraSensorTest, DetectBox)
   ignition::math::Pose3d boxPoseCameraFrame = boxPose - sensorPose;
   EXPECT_EQ(boxPoseCameraFrame, ignition::msgs::Convert(img.model(0).pose()));
 
+  // snapshots hold the same image
+  auto snapshot = sensor->ImageSnapshot();
+  ASSERT_NE(nullptr, snapshot);
+  EXPECT_EQ(1, snapshot->model().size());
+
   // 2. test box outside of frustum
   std::map<std::string, ignition::math::Pose3d> modelPoses2;
   ignition::math::Pose3d boxPose2(ignition::math::Vector3d(8, 0, 0.5),
@@ -205,6 +217,10 @@ TEST_F(LogicalCameraSensorTest, DetectBox)
   EXPECT_EQ(sensorPose, ignition::msgs::Convert(img.pose()));
   EXPECT_EQ(0, img.model().size());
 
+  // snapshots taken earlier don't change
+  EXPECT_EQ(1, snapshot->model().size());
+  EXPECT_EQ(0, sensor->ImageSnapshot()->model().size());
+
   // 3. test with different sensor pose
   // camera now on y, orientated to face box
   std::map<std::string, ignition::math::Pose3d> modelPoses3;
@@ -242,6 +258,68 @@ TEST_F(LogicalCameraSensorTest, DetectBox)
   EXPECT_EQ(0, img.model().size());
 }
 
+/////////////////////////////////////////////////
+TEST_F(LogicalCameraSensorTest, DetectBoxInSnapshot)
+{
+  const std::string name = "TestLogicalCamera";
+  const std::string topic = "/ignition/sensors/test/logical_camera_snapshot";
+  ignition::math::Pose3d sensorPose(ignition::math::Vector3d(0.25, 0.0, 0.5),
+      ignition::math::Quaterniond::Identity);
+  sdf::ElementPtr logicalCameraSdf = LogicalCameraToSdf(name, sensorPose,
+        30, topic, 0.55, 5, 1.04719755, 1.778, true, true);
+
+  ignition::sensors::SensorFactory sf;
+  std::unique_ptr<ignition::sensors::Sensor> s =
+      sf.CreateSensor(logicalCameraSdf);
+  std::unique_ptr<ignition::sensors::LogicalCameraSensor> sensor(
+      dynamic_cast<ignition::sensors::LogicalCameraSensor *>(s.release()));
+  ASSERT_NE(nullptr, sensor);
+
+  // Two boxes in the frustum, one behind the camera and one far away
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"z_box", "behind", "a_box", "far"});
+  std::vector<ignition::math::Pose3d> poses{
+      ignition::math::Pose3d(2, 0.2, 0.5, 0, 0, 0),
+      ignition::math::Pose3d(-2, 0, 0.5, 0, 0, 0),
+      ignition::math::Pose3d(3, -0.2, 0.5, 0, 0, 0),
+      ignition::math::Pose3d(500, 0, 0.5, 0, 0, 0)};
+  sensor->SetModelPoseSnapshot(
+      std::make_shared<const ignition::sensors::ModelPoseSnapshot>(
+      names, poses));
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+
+  // Models are listed by name
+  auto img = sensor->Image();
+  ASSERT_EQ(2, img.model().size());
+  EXPECT_EQ("a_box", img.model(0).name());
+  EXPECT_EQ(poses[2] - sensorPose,
+      ignition::msgs::Convert(img.model(0).pose()));
+  EXPECT_EQ("z_box", img.model(1).name());
+
+  // A later snapshot reuses the name table
+  poses[0].Pos().X(-1);
+  sensor->SetModelPoseSnapshot(
+      std::make_shared<const ignition::sensors::ModelPoseSnapshot>(
+      names, poses));
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  img = sensor->Image();
+  ASSERT_EQ(1, img.model().size());
+  EXPECT_EQ("a_box", img.model(0).name());
+
+  // Model maps replace the snapshot
+  std::map<std::string, ignition::math::Pose3d> modelPoses;
+  modelPoses["map_box"] = ignition::math::Pose3d(2, 0, 0.5, 0, 0, 0);
+  sensor->SetModelPoses(std::move(modelPoses));
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  img = sensor->Image();
+  ASSERT_EQ(1, img.model().size());
+  EXPECT_EQ("map_box", img.model(0).name());
+
+  sensor->SetModelPoseSnapshot(nullptr);
+  sensor->Update(std::chrono::steady_clock::duration::zero());
+  EXPECT_EQ(0, sensor->Image().model().size());
+}
+
 /////////////////////////////////////////////////
 TEST_F(LogicalCameraSensorTest, Topic)
 {
@@ -306,6 +384,126 @@ TEST_F(LogicalCameraSensorTest, Topic)
   }
 }
 
+/////////////////////////////////////////////////
+/// \brief Get whether a logical camera message is a delta message
+bool IsDelta(const ignition::msgs::LogicalCameraImage &_msg)
+{
+  for (const auto &data : _msg.header().data())
+  {
+    if (data.key() == "delta")
+      return true;
+  }
+  return false;
+}
+
+/////////////////////////////////////////////////
+TEST_F(LogicalCameraSensorTest, DeltaPublishing)
+{
+  const std::string name = "TestLogicalCamera";
+  const std::string topic = "/ignition/sensors/test/logical_camera_delta";
+  ignition::math::Pose3d sensorPose;
+  sdf::ElementPtr logicalCameraSdf = LogicalCameraToSdf(name, sensorPose,
+        30, topic, 0.55, 5, 1.04719755, 1.778, true, true);
+
+  ignition::sensors::SensorFactory sf;
+  std::unique_ptr<ignition::sensors::Sensor> s =
+      sf.CreateSensor(logicalCameraSdf);
+  std::unique_ptr<ignition::sensors::LogicalCameraSensor> sensor(
+      dynamic_cast<ignition::sensors::LogicalCameraSensor *>(s.release()));
+  ASSERT_NE(nullptr, sensor);
+  EXPECT_FALSE(sensor->DeltaPublishing());
+  sensor->SetDeltaPublishing(true, 0.1, 0.1, 3u);
+  EXPECT_TRUE(sensor->DeltaPublishing());
+
+  std::mutex mutex;
+  std::vector<ignition::msgs::LogicalCameraImage> received;
+  ignition::transport::Node node;
+  std::function<void(const ignition::msgs::LogicalCameraImage &)> cb =
+      [&](const ignition::msgs::LogicalCameraImage &_msg)
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        received.push_back(_msg);
+      };
+  ASSERT_TRUE(node.Subscribe(topic, cb));
+
+  auto names = std::make_shared<const std::vector<std::string>>(
+      std::vector<std::string>{"a_box", "b_box", "c_box"});
+  auto update = [&](const std::vector<ignition::math::Pose3d> &_poses)
+  {
+    sensor->SetModelPoseSnapshot(
+        std::make_shared<const ignition::sensors::ModelPoseSnapshot>(
+        names, _poses));
+    sensor->Update(std::chrono::steady_clock::duration::zero());
+  };
+  auto waitFor = [&](const std::size_t _count)
+  {
+    for (int sleep = 0; sleep < 100; ++sleep)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (received.size() >= _count)
+          break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return received;
+  };
+
+  // The first message is a keyframe
+  std::vector<ignition::math::Pose3d> poses{
+      ignition::math::Pose3d(2, 0.2, 0, 0, 0, 0),
+      ignition::math::Pose3d(3, -0.2, 0, 0, 0, 0),
+      ignition::math::Pose3d(-3, 0, 0, 0, 0, 0)};
+  for (int i = 0; i < 100 && !sensor->HasConnections(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  update(poses);
+  auto msgs = waitFor(1u);
+  ASSERT_EQ(1u, msgs.size());
+  EXPECT_FALSE(IsDelta(msgs[0]));
+  EXPECT_EQ(2, msgs[0].model_size());
+
+  // Small moves aren't published, models entering the frustum are
+  poses[0].Pos().Y(0.25);
+  poses[2].Pos().X(4);
+  update(poses);
+  msgs = waitFor(2u);
+  ASSERT_EQ(2u, msgs.size());
+  EXPECT_TRUE(IsDelta(msgs[1]));
+  ASSERT_EQ(1, msgs[1].model_size());
+  EXPECT_EQ("c_box", msgs[1].model(0).name());
+
+  // Large moves are published, and models leaving the frustum are removed
+  poses[0].Pos().Y(0.5);
+  poses[1].Pos().X(-3);
+  update(poses);
+  msgs = waitFor(3u);
+  ASSERT_EQ(3u, msgs.size());
+  EXPECT_TRUE(IsDelta(msgs[2]));
+  ASSERT_EQ(1, msgs[2].model_size());
+  EXPECT_EQ("a_box", msgs[2].model(0).name());
+
+  // The messages rebuild the image
+  ignition::msgs::LogicalCameraImage image;
+  for (const auto &msg : msgs)
+    ignition::sensors::LogicalCameraSensor::ApplyDelta(msg, image);
+  EXPECT_FALSE(IsDelta(image));
+  const auto full = sensor->Image();
+  ASSERT_EQ(full.model_size(), image.model_size());
+  for (int i = 0; i < full.model_size(); ++i)
+    EXPECT_EQ(full.model(i).name(), image.model(i).name());
+  EXPECT_EQ(2, image.model_size());
+  EXPECT_EQ("c_box", image.model(1).name());
+  EXPECT_NEAR(0.5, image.model(0).pose().position().y(), 1e-6);
+
+  // Keyframes come back at the interval
+  update(poses);
+  msgs = waitFor(4u);
+  ASSERT_EQ(4u, msgs.size());
+  EXPECT_FALSE(IsDelta(msgs[3]));
+  EXPECT_EQ(2, msgs[3].model_size());
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
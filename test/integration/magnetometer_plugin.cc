@@ -17,8 +17,13 @@
 
 #include <gtest/gtest.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <sdf/sdf.hh>
 
+#include <ignition/sensors/MagnetometerBatch.hh>
 #include <ignition/sensors/MagnetometerSensor.hh>
 #include <ignition/sensors/SensorFactory.hh>
 
@@ -346,6 +351,124 @@ TEST_F(MagnetometerSensorTest, Topic)
   }
 }
 
+/////////////////////////////////////////////////
+TEST_F(MagnetometerSensorTest, Batch)
+{
+  const double updateRate = 10;
+  ignition::sensors::SensorFactory sf;
+
+  // Sensors updated by a batch, and the same sensors updated one by one
+  std::vector<std::unique_ptr<ignition::sensors::MagnetometerSensor>>
+      batched;
+  std::vector<std::unique_ptr<ignition::sensors::MagnetometerSensor>>
+      single;
+  for (int i = 0; i < 5; ++i)
+  {
+    const std::string name = "TestMagnetometerBatch" + std::to_string(i);
+    sdf::ElementPtr magnetometerSdf = MagnetometerToSdf(name,
+        ignition::math::Pose3d::Zero, updateRate,
+        "/ignition/sensors/test/" + name, true, false);
+    batched.push_back(
+        sf.CreateSensor<ignition::sensors::MagnetometerSensor>(
+        magnetometerSdf));
+    single.push_back(
+        sf.CreateSensor<ignition::sensors::MagnetometerSensor>(
+        magnetometerSdf));
+    ASSERT_NE(nullptr, batched.back());
+    ASSERT_NE(nullptr, single.back());
+  }
+
+  ignition::sensors::MagnetometerBatch batch;
+  for (std::size_t i = 0; i < batched.size(); ++i)
+    EXPECT_EQ(i, batch.AddSensor(batched[i].get()));
+  EXPECT_EQ(batched.size(), batch.AddSensor(batched[0].get()));
+  EXPECT_EQ(batched.size(), batch.AddSensor(nullptr));
+  EXPECT_EQ(batched.size(), batch.SensorCount());
+  EXPECT_EQ(batched[3].get(), batch.SensorByIndex(3));
+  EXPECT_EQ(nullptr, batch.SensorByIndex(batched.size()));
+
+  // Fields much smaller than the tolerance of the vector comparisons
+  const ignition::math::Vector3d worldField(2e-5, -1e-5, 4e-5);
+  batch.SetWorldMagneticField(worldField);
+
+  int count = 0;
+  ignition::msgs::Magnetometer received;
+  auto connection = batched[2]->ConnectDataCallback(
+      [&](const ignition::msgs::Magnetometer &_msg)
+      {
+        received = _msg;
+        ++count;
+      });
+
+  auto check = [&](const std::chrono::steady_clock::duration &_now)
+  {
+    for (std::size_t i = 0; i < single.size(); ++i)
+    {
+      EXPECT_TRUE(single[i]->Update(_now));
+      EXPECT_EQ(single[i]->WorldPose(), batched[i]->WorldPose());
+      EXPECT_EQ(worldField, batched[i]->WorldMagneticField());
+      const auto expected = single[i]->MagneticField();
+      const auto actual = batched[i]->MagneticField();
+      EXPECT_NEAR(expected.X(), actual.X(), 1e-15);
+      EXPECT_NEAR(expected.Y(), actual.Y(), 1e-15);
+      EXPECT_NEAR(expected.Z(), actual.Z(), 1e-15);
+    }
+  };
+
+  std::vector<double> poses;
+  for (std::size_t i = 0; i < batched.size(); ++i)
+  {
+    const double a = 0.4 * static_cast<double>(i);
+    const ignition::math::Pose3d pose(1, 2.0 * i, 0, a, 1 - a, 2 * a);
+    for (double value : {pose.Pos().X(), pose.Pos().Y(), pose.Pos().Z(),
+        pose.Rot().W(), pose.Rot().X(), pose.Rot().Y(), pose.Rot().Z()})
+    {
+      poses.push_back(value);
+    }
+    single[i]->SetWorldPose(pose);
+    single[i]->SetWorldMagneticField(worldField);
+  }
+  batch.SetWorldPoses(poses.data());
+
+  const auto first = std::chrono::steady_clock::duration::zero();
+  EXPECT_EQ(batched.size(), batch.Update(first));
+  check(first);
+  EXPECT_EQ(1, count);
+  EXPECT_NEAR(batched[2]->MagneticField().Z(), received.field_tesla().z(),
+      1e-15);
+
+  // Sensors that aren't due aren't updated
+  EXPECT_EQ(0u, batch.Update(std::chrono::milliseconds(50)));
+  EXPECT_EQ(1, count);
+
+  // Rotating one of the sensors
+  const ignition::math::Pose3d rotated(0, 0, 0, 0.1, 0.2, 0.3);
+  batch.SetWorldPose(1, rotated);
+  single[1]->SetWorldPose(rotated);
+  const auto second = std::chrono::milliseconds(100);
+  EXPECT_EQ(batched.size(), batch.Update(second));
+  check(second);
+  EXPECT_EQ(2, count);
+
+  // Without the batch, the field of a sensor that didn't move is reused,
+  // and it's recomputed when the sensor moves
+  const auto field = batched[1]->MagneticField();
+  EXPECT_TRUE(batched[1]->Update(std::chrono::milliseconds(200)));
+  EXPECT_EQ(field, batched[1]->MagneticField());
+  batched[1]->SetWorldPose(ignition::math::Pose3d::Zero);
+  EXPECT_TRUE(batched[1]->Update(std::chrono::milliseconds(300)));
+  EXPECT_NEAR(worldField.X(), batched[1]->MagneticField().X(), 1e-15);
+  EXPECT_NEAR(worldField.Z(), batched[1]->MagneticField().Z(), 1e-15);
+
+  // The last sensor takes the index of a removed one
+  EXPECT_TRUE(batch.RemoveSensor(batched[2].get()));
+  EXPECT_FALSE(batch.RemoveSensor(batched[2].get()));
+  EXPECT_EQ(batched.back().get(), batch.SensorByIndex(2));
+  EXPECT_EQ(batched.size() - 1u,
+      batch.Update(std::chrono::milliseconds(400)));
+  EXPECT_EQ(2, count);
+}
+
 int main(int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
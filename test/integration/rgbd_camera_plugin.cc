@@ -250,6 +250,11 @@ void RgbdCameraSensorTest::ImagesWithBuiltinSDF(
   ignition::sensors::RgbdCameraSensor *rgbdSensor =
       mgr.CreateSensor<ignition::sensors::RgbdCameraSensor>(sensorPtr);
   ASSERT_NE(rgbdSensor, nullptr);
+
+  // Publish camera info with every frame, so that it can be counted along
+  // with the images
+  rgbdSensor->SetInfoPublishPeriod(
+      std::chrono::steady_clock::duration::zero());
   rgbdSensor->SetScene(scene);
 
   EXPECT_EQ(rgbdSensor->ImageWidth(), static_cast<unsigned int>(imgWidth));
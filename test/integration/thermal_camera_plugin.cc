@@ -162,6 +162,11 @@ void ThermalCameraSensorTest::ImagesWithBuiltinSDF(
       mgr.CreateSensor<ignition::sensors::ThermalCameraSensor>(sensorPtr);
   ASSERT_NE(thermalSensor, nullptr);
 
+  // Publish camera info with every frame, so that it can be counted along
+  // with the images
+  thermalSensor->SetInfoPublishPeriod(
+      std::chrono::steady_clock::duration::zero());
+
   float ambientTemp = 296.0f;
   float ambientTempRange = 4.0f;
   float linearResolution = 0.01f;
@@ -330,6 +335,15 @@ void ThermalCameraSensorTest::ImagesWithBuiltinSDF(
   g_infoMutex.unlock();
   g_mutex.unlock();
 
+  // False color images are published on their own topic
+  EXPECT_EQ(ignition::sensors::ThermalPalette::IRON, thermalSensor->Palette());
+  thermalSensor->SetPalette(ignition::sensors::ThermalPalette::RAINBOW);
+  EXPECT_EQ(ignition::sensors::ThermalPalette::RAINBOW,
+      thermalSensor->Palette());
+  WaitForMessageTestHelper<ignition::msgs::Image> colorizedHelper(
+      topic + "/colorized");
+  mgr.RunOnce(std::chrono::steady_clock::duration::zero(), true);
+  EXPECT_TRUE(colorizedHelper.WaitForMessage()) << colorizedHelper;
 
   // Clean up
   engine->DestroyScene(scene);
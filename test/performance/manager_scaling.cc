@@ -0,0 +1,264 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <sdf/sdf.hh>
+
+#include "ignition/sensors/Manager.hh"
+
+using namespace ignition;
+
+/// \brief Number of heap allocations made by this process so far.
+static std::atomic<std::size_t> g_allocations{0u};
+
+/// \brief Number of simulated ticks measured per world.
+static const unsigned int g_ticks = 1000u;
+
+/// \brief Simulated time between two ticks.
+static const std::chrono::milliseconds g_step(1);
+
+/// \brief Types of the sensors of the worlds, which don't need rendering.
+static const std::vector<std::string> g_types = {
+  "imu", "magnetometer", "altimeter", "air_pressure", "logical_camera"};
+
+/// \brief Update rates of the sensors, in Hz, used in turn.
+static const std::vector<double> g_rates = {1.0, 10.0, 50.0, 100.0, 250.0};
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  ++g_allocations;
+  sensors::SensorStats::RecordAllocation();
+  if (void *ptr = std::malloc(_size > 0u ? _size : 1u))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+/// \brief Measurements of one world.
+struct ScalingResult
+{
+  /// \brief Name of the run, such as "serial".
+  std::string mode;
+
+  /// \brief Number of sensors in the world.
+  std::size_t sensors = 0u;
+
+  /// \brief Wall time spent creating the sensors, in milliseconds.
+  double createMs = 0.0;
+
+  /// \brief Wall time of the first RunOnce(), which updates every sensor,
+  /// in milliseconds.
+  double startupMs = 0.0;
+
+  /// \brief Mean wall time of a RunOnce(), in microseconds.
+  double meanTickUs = 0.0;
+
+  /// \brief Longest RunOnce(), in microseconds.
+  double maxTickUs = 0.0;
+
+  /// \brief Average number of heap allocations per RunOnce().
+  double allocationsPerTick = 0.0;
+};
+
+//////////////////////////////////////////////////
+/// \brief Build the SDF of a sensor.
+/// \param[in] _type Type of the sensor.
+/// \param[in] _index Index of the sensor, which names it and picks its
+/// update rate.
+/// \return The SDF of the sensor.
+sdf::Sensor SensorSdf(const std::string &_type, std::size_t _index)
+{
+  const std::string name = _type + "_" + std::to_string(_index);
+  std::ostringstream stream;
+  stream
+    << "<?xml version='1.0'?>"
+    << "<sdf version='1.6'>"
+    << " <model name='m1'>"
+    << "  <link name='link1'>"
+    << "    <sensor name='" << name << "' type='" << _type << "'>"
+    << "      <pose>0 0 " << _index % 100u << " 0 0 0</pose>"
+    << "      <topic>/scaling/" << name << "</topic>"
+    << "      <update_rate>" << g_rates[_index % g_rates.size()]
+    << "</update_rate>";
+  if (_type == "logical_camera")
+  {
+    stream
+      << "      <logical_camera>"
+      << "        <near>0.1</near>"
+      << "        <far>10</far>"
+      << "        <horizontal_fov>1.05</horizontal_fov>"
+      << "        <aspect_ratio>1.778</aspect_ratio>"
+      << "      </logical_camera>";
+  }
+  stream
+    << "    </sensor>"
+    << "  </link>"
+    << " </model>"
+    << "</sdf>";
+
+  sdf::SDFPtr sdfParsed(new sdf::SDF());
+  sdf::init(sdfParsed);
+  sdf::Sensor sensor;
+  if (!sdf::readString(stream.str(), sdfParsed))
+    return sensor;
+
+  sensor.Load(sdfParsed->Root()->GetElement("model")->GetElement("link")
+      ->GetElement("sensor"));
+  return sensor;
+}
+
+//////////////////////////////////////////////////
+/// \brief Print a result, and append it as a JSON line to the file named
+/// by the IGN_SENSORS_BENCHMARK_OUTPUT environment variable, if set.
+/// \param[in] _result Result to report.
+void Report(const ScalingResult &_result)
+{
+  std::cout << "[ BENCHMARK ] Manager::RunOnce " << std::left
+            << std::setw(8) << _result.mode << std::right << std::setw(6)
+            << _result.sensors << " sensors  create " << std::setw(9)
+            << std::setprecision(4) << _result.createMs << " ms  startup "
+            << std::setw(9) << _result.startupMs << " ms  tick "
+            << std::setw(9) << _result.meanTickUs << " us (max "
+            << std::setw(9) << _result.maxTickUs << " us)  "
+            << std::setw(8) << _result.allocationsPerTick
+            << " allocations/tick" << std::endl;
+
+  const char *path = std::getenv("IGN_SENSORS_BENCHMARK_OUTPUT");
+  if (!path || !*path)
+    return;
+
+  std::ofstream out(path, std::ios::app);
+  out << "{\"benchmark\":\"Manager::RunOnce\""
+      << ",\"mode\":\"" << _result.mode << "\""
+      << ",\"sensors\":" << _result.sensors
+      << ",\"create_ms\":" << _result.createMs
+      << ",\"startup_ms\":" << _result.startupMs
+      << ",\"mean_tick_us\":" << _result.meanTickUs
+      << ",\"max_tick_us\":" << _result.maxTickUs
+      << ",\"allocations_per_tick\":" << _result.allocationsPerTick
+      << "}" << std::endl;
+}
+
+//////////////////////////////////////////////////
+/// \brief Create a world of sensors and measure its updates.
+/// \param[in] _mode Name of the run.
+/// \param[in] _sdfs Sensors of the world.
+/// \param[in] _threads Number of threads updating the sensors.
+/// \return The measurements.
+ScalingResult Measure(const std::string &_mode,
+    const std::vector<sdf::Sensor> &_sdfs, unsigned int _threads)
+{
+  using Clock = std::chrono::steady_clock;
+
+  ScalingResult result;
+  result.mode = _mode;
+  result.sensors = _sdfs.size();
+
+  sensors::Manager mgr;
+  mgr.SetWorkerThreadCount(_threads);
+
+  auto start = Clock::now();
+  const auto ids = mgr.CreateSensors(_sdfs);
+  result.createMs = std::chrono::duration<double, std::milli>(
+      Clock::now() - start).count();
+  EXPECT_EQ(_sdfs.size(), static_cast<std::size_t>(std::count_if(
+      ids.begin(), ids.end(),
+      [](sensors::SensorId _id) { return _id != sensors::NO_SENSOR; })));
+
+  // Every sensor is due on the first update, which also warms up the
+  // lazily allocated buffers.
+  Clock::duration now = Clock::duration::zero();
+  start = Clock::now();
+  mgr.RunOnce(now);
+  result.startupMs = std::chrono::duration<double, std::milli>(
+      Clock::now() - start).count();
+
+  Clock::duration total = Clock::duration::zero();
+  Clock::duration longest = Clock::duration::zero();
+  const std::size_t allocationsStart = g_allocations;
+  for (unsigned int i = 0u; i < g_ticks; ++i)
+  {
+    now += g_step;
+    start = Clock::now();
+    mgr.RunOnce(now);
+    const Clock::duration elapsed = Clock::now() - start;
+    total += elapsed;
+    longest = std::max(longest, elapsed);
+  }
+  const std::size_t allocations = g_allocations - allocationsStart;
+
+  result.meanTickUs = std::chrono::duration<double, std::micro>(
+      total).count() / g_ticks;
+  result.maxTickUs = std::chrono::duration<double, std::micro>(
+      longest).count();
+  result.allocationsPerTick = static_cast<double>(allocations) / g_ticks;
+  return result;
+}
+
+//////////////////////////////////////////////////
+TEST(ManagerScaling, RunOnce)
+{
+  const unsigned int cores =
+      std::max(1u, std::thread::hardware_concurrency());
+
+  for (std::size_t count : {10u, 100u, 1000u, 10000u})
+  {
+    std::vector<sdf::Sensor> sdfs;
+    sdfs.reserve(count);
+    for (std::size_t i = 0u; i < count; ++i)
+      sdfs.push_back(SensorSdf(g_types[i % g_types.size()], i));
+
+    Report(Measure("serial", sdfs, 1u));
+    if (cores > 1u)
+      Report(Measure("parallel", sdfs, cores));
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
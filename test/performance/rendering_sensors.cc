@@ -0,0 +1,414 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/sensors/Manager.hh>
+#include <ignition/sensors/RenderingSensor.hh>
+#include <ignition/transport/Node.hh>
+#include <sdf/sdf.hh>
+
+// TODO(louise) Remove these pragmas once ign-rendering is disabling the
+// warnings
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/rendering/DirectionalLight.hh>
+#include <ignition/rendering/Material.hh>
+#include <ignition/rendering/RenderEngine.hh>
+#include <ignition/rendering/RenderingIface.hh>
+#include <ignition/rendering/Scene.hh>
+#include <ignition/rendering/Visual.hh>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs.hh>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include "test_config.h"  // NOLINT(build/include)
+
+using namespace ignition;
+
+/// \brief Update rate of the sensors, and rate of the simulated ticks.
+static const double g_rate = 30.0;
+
+/// \brief Number of ticks run before measuring.
+static const unsigned int g_warmupTicks = 5u;
+
+/// \brief Number of ticks measured per configuration.
+static const unsigned int g_ticks = 60u;
+
+/// \brief Resolution of a sensor: image size for the cameras, horizontal
+/// and vertical samples for the lidar.
+struct Resolution
+{
+  /// \brief Width, or horizontal samples.
+  unsigned int width;
+
+  /// \brief Height, or vertical samples.
+  unsigned int height;
+};
+
+/// \brief Resolutions of the cameras.
+static const std::vector<Resolution> g_cameraResolutions = {
+  {320u, 240u}, {640u, 480u}, {1280u, 720u}};
+
+/// \brief Resolutions of the lidars.
+static const std::vector<Resolution> g_lidarResolutions = {
+  {512u, 16u}, {1024u, 32u}, {2048u, 64u}};
+
+/// \brief Numbers of sensors of the same type rendered together.
+static const std::vector<unsigned int> g_sensorCounts = {1u, 4u};
+
+/// \brief Phases reported in the latency breakdown.
+static const std::array<sensors::UpdatePhase, 4> g_phases = {
+  sensors::UpdatePhase::RENDER, sensors::UpdatePhase::COPY,
+  sensors::UpdatePhase::MESSAGE, sensors::UpdatePhase::PUBLISH};
+
+/// \brief Names of the phases of g_phases.
+static const std::array<const char *, 4> g_phaseNames = {
+  "render", "readback", "message", "publish"};
+
+//////////////////////////////////////////////////
+/// \brief Build the SDF of a rendering sensor.
+/// \param[in] _type Sensor type, such as "camera" or "gpu_lidar".
+/// \param[in] _name Name of the sensor, also used for its topic.
+/// \param[in] _res Resolution of the sensor.
+/// \return The sensor element.
+sdf::ElementPtr SensorSdf(const std::string &_type, const std::string &_name,
+    const Resolution &_res)
+{
+  std::ostringstream stream;
+  stream
+    << "<?xml version='1.0'?>"
+    << "<sdf version='1.6'>"
+    << " <model name='m1'>"
+    << "  <link name='link1'>"
+    << "    <sensor name='" << _name << "' type='" << _type << "'>"
+    << "      <pose>-3 0 1 0 0.1 0</pose>"
+    << "      <topic>/benchmark/" << _name << "</topic>"
+    << "      <update_rate>" << g_rate << "</update_rate>";
+  if (_type == "gpu_lidar")
+  {
+    stream
+      << "      <ray>"
+      << "        <scan>"
+      << "          <horizontal>"
+      << "            <samples>" << _res.width << "</samples>"
+      << "            <resolution>1</resolution>"
+      << "            <min_angle>-3.14159</min_angle>"
+      << "            <max_angle>3.14159</max_angle>"
+      << "          </horizontal>"
+      << "          <vertical>"
+      << "            <samples>" << _res.height << "</samples>"
+      << "            <resolution>1</resolution>"
+      << "            <min_angle>-0.3</min_angle>"
+      << "            <max_angle>0.3</max_angle>"
+      << "          </vertical>"
+      << "        </scan>"
+      << "        <range>"
+      << "          <min>0.1</min>"
+      << "          <max>50</max>"
+      << "          <resolution>0.01</resolution>"
+      << "        </range>"
+      << "      </ray>";
+  }
+  else
+  {
+    stream
+      << "      <camera>"
+      << "        <horizontal_fov>1.05</horizontal_fov>"
+      << "        <image>"
+      << "          <width>" << _res.width << "</width>"
+      << "          <height>" << _res.height << "</height>"
+      << (_type == "depth_camera" ? "<format>R_FLOAT32</format>" : "")
+      << "        </image>"
+      << "        <clip>"
+      << "          <near>0.1</near>"
+      << "          <far>50</far>"
+      << "        </clip>"
+      << "      </camera>";
+  }
+  stream
+    << "    </sensor>"
+    << "  </link>"
+    << " </model>"
+    << "</sdf>";
+
+  sdf::SDFPtr sdfParsed(new sdf::SDF());
+  sdf::init(sdfParsed);
+  if (!sdf::readString(stream.str(), sdfParsed))
+    return sdf::ElementPtr();
+
+  return sdfParsed->Root()->GetElement("model")->GetElement("link")
+    ->GetElement("sensor");
+}
+
+//////////////////////////////////////////////////
+/// \brief Fill a scene with the standard benchmark content: a ground
+/// plane, a row of boxes, spheres and cylinders at different temperatures
+/// and a directional light.
+/// \param[in] _scene Scene to fill.
+void BuildScene(rendering::ScenePtr _scene)
+{
+  _scene->SetAmbientLight(0.3, 0.3, 0.3);
+  rendering::VisualPtr root = _scene->RootVisual();
+
+  rendering::DirectionalLightPtr light = _scene->CreateDirectionalLight();
+  light->SetDirection(-0.5, 0.5, -1);
+  light->SetDiffuseColor(0.8, 0.8, 0.8);
+  root->AddChild(light);
+
+  rendering::MaterialPtr material = _scene->CreateMaterial();
+  material->SetDiffuse(0.6, 0.6, 0.6);
+
+  rendering::VisualPtr ground = _scene->CreateVisual();
+  ground->AddGeometry(_scene->CreatePlane());
+  ground->SetLocalScale(100, 100, 1);
+  ground->SetMaterial(material);
+  ground->SetUserData("temperature", 290.0f);
+  root->AddChild(ground);
+
+  for (int i = 0; i < 24; ++i)
+  {
+    rendering::VisualPtr visual = _scene->CreateVisual();
+    switch (i % 3)
+    {
+      case 0:
+        visual->AddGeometry(_scene->CreateBox());
+        break;
+      case 1:
+        visual->AddGeometry(_scene->CreateSphere());
+        break;
+      default:
+        visual->AddGeometry(_scene->CreateCylinder());
+        break;
+    }
+    visual->SetLocalPosition(2.0 + (i / 6) * 2.0, -5.0 + (i % 6) * 2.0, 0.5);
+    visual->SetMaterial(material);
+    visual->SetUserData("temperature", 300.0f + static_cast<float>(i));
+    root->AddChild(visual);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Subscribe to the outputs of a sensor, since sensors that nobody
+/// consumes don't build or publish their messages.
+/// \param[in] _node Node to subscribe with.
+/// \param[in] _type Sensor type.
+/// \param[in] _topic Topic of the sensor.
+void Subscribe(transport::Node &_node, const std::string &_type,
+    const std::string &_topic)
+{
+  auto onImage = [](const msgs::Image &) {};
+  auto onCloud = [](const msgs::PointCloudPacked &) {};
+  auto onScan = [](const msgs::LaserScan &) {};
+
+  if (_type == "rgbd_camera")
+  {
+    _node.Subscribe<msgs::Image>(_topic + "/image", onImage);
+    _node.Subscribe<msgs::Image>(_topic + "/depth_image", onImage);
+    _node.Subscribe<msgs::PointCloudPacked>(_topic + "/points", onCloud);
+  }
+  else if (_type == "gpu_lidar")
+  {
+    _node.Subscribe<msgs::LaserScan>(_topic, onScan);
+    _node.Subscribe<msgs::PointCloudPacked>(_topic + "/points", onCloud);
+  }
+  else
+  {
+    _node.Subscribe<msgs::Image>(_topic, onImage);
+  }
+}
+
+//////////////////////////////////////////////////
+/// \brief Render sensors of one type, and print their throughput and the
+/// time spent in each phase of their updates. The phases are the ones
+/// timed by the IGN_PROFILE scopes of the sensors, see
+/// sensors::SensorStats.
+/// \param[in] _scene Scene to render.
+/// \param[in] _type Sensor type.
+/// \param[in] _res Resolution of the sensors.
+/// \param[in] _count Number of sensors.
+void Measure(rendering::ScenePtr _scene, const std::string &_type,
+    const Resolution &_res, unsigned int _count)
+{
+  using Clock = std::chrono::steady_clock;
+
+  sensors::Manager mgr;
+  transport::Node node;
+  std::vector<sensors::Sensor *> created;
+  for (unsigned int i = 0u; i < _count; ++i)
+  {
+    const std::string name = _type + "_" + std::to_string(_res.width) +
+        "x" + std::to_string(_res.height) + "_" + std::to_string(i);
+    sdf::ElementPtr sdf = SensorSdf(_type, name, _res);
+    ASSERT_NE(nullptr, sdf);
+
+    auto *sensor = mgr.CreateSensor<sensors::RenderingSensor>(sdf);
+    ASSERT_NE(nullptr, sensor) << _type;
+    sensor->SetScene(_scene);
+    Subscribe(node, _type, sensor->Topic());
+    created.push_back(sensor);
+  }
+
+  const auto step = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(1.0 / g_rate));
+  Clock::duration now = Clock::duration::zero();
+
+  // Render targets and readback buffers are created on the first frames
+  for (unsigned int i = 0u; i < g_warmupTicks; ++i, now += step)
+    mgr.RunOnce(now);
+  mgr.WaitForRendering();
+  for (auto *sensor : created)
+    sensor->ResetStats();
+
+  const auto start = Clock::now();
+  for (unsigned int i = 0u; i < g_ticks; ++i, now += step)
+    mgr.RunOnce(now);
+  mgr.WaitForRendering();
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  uint64_t frames = 0u;
+  std::array<double, 4> phaseMs{};
+  for (auto *sensor : created)
+  {
+    const sensors::SensorStats stats = sensor->Stats();
+    frames += stats.updateCount;
+    for (std::size_t p = 0u; p < g_phases.size(); ++p)
+    {
+      phaseMs[p] += std::chrono::duration<double, std::milli>(
+          stats.phases[static_cast<std::size_t>(g_phases[p])].total).count();
+    }
+  }
+  EXPECT_GT(frames, 0u);
+  if (frames == 0u)
+    return;
+
+  const double fps = static_cast<double>(frames) / seconds;
+  for (double &ms : phaseMs)
+    ms /= static_cast<double>(frames);
+
+  std::ostringstream config;
+  config << _type << " " << _res.width << "x" << _res.height << " x"
+         << _count;
+  std::cout << "[ BENCHMARK ] " << std::left << std::setw(32)
+            << config.str() << std::right << std::setw(9)
+            << std::setprecision(4) << fps << " frames/s ";
+  for (std::size_t p = 0u; p < g_phases.size(); ++p)
+  {
+    std::cout << " " << g_phaseNames[p] << " " << std::setw(7)
+              << phaseMs[p] << " ms";
+  }
+  std::cout << std::endl;
+
+  const char *path = std::getenv("IGN_SENSORS_BENCHMARK_OUTPUT");
+  if (!path || !*path)
+    return;
+
+  std::ofstream out(path, std::ios::app);
+  out << "{\"benchmark\":\"RenderingSensor\""
+      << ",\"type\":\"" << _type << "\""
+      << ",\"width\":" << _res.width
+      << ",\"height\":" << _res.height
+      << ",\"sensors\":" << _count
+      << ",\"frames_per_sec\":" << fps;
+  for (std::size_t p = 0u; p < g_phases.size(); ++p)
+    out << ",\"" << g_phaseNames[p] << "_ms\":" << phaseMs[p];
+  out << "}" << std::endl;
+}
+
+//////////////////////////////////////////////////
+class RenderingSensorsBenchmark: public testing::Test,
+  public testing::WithParamInterface<const char *>
+{
+  // Render every type of rendering sensor at several resolutions and
+  // sensor counts
+  public: void Throughput(const std::string &_renderEngine);
+};
+
+//////////////////////////////////////////////////
+void RenderingSensorsBenchmark::Throughput(const std::string &_renderEngine)
+{
+  auto *engine = rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  rendering::ScenePtr scene = engine->CreateScene("scene");
+  BuildScene(scene);
+
+  for (const std::string type :
+      {"camera", "depth_camera", "rgbd_camera", "thermal_camera"})
+  {
+    for (const Resolution &res : g_cameraResolutions)
+    {
+      for (unsigned int count : g_sensorCounts)
+        Measure(scene, type, res, count);
+    }
+  }
+
+  for (const Resolution &res : g_lidarResolutions)
+  {
+    for (unsigned int count : g_sensorCounts)
+      Measure(scene, "gpu_lidar", res, count);
+  }
+
+  engine->DestroyScene(scene);
+  rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+TEST_P(RenderingSensorsBenchmark, Throughput)
+{
+  Throughput(GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(RenderingSensors, RenderingSensorsBenchmark,
+    RENDER_ENGINE_VALUES, rendering::PrintToStringParam());
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
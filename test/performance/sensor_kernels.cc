@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/math/Helpers.hh>
+#include <ignition/msgs/Utility.hh>
+#include <sdf/sdf.hh>
+
+#include "ignition/sensors/GaussianNoiseModel.hh"
+#include "ignition/sensors/Lidar.hh"
+#include "ignition/sensors/Noise.hh"
+
+#include "PointCloudUtil.hh"
+#include "RayCaster.hh"
+
+using namespace ignition;
+
+/// \brief Number of heap allocations made by this process so far.
+static std::atomic<std::size_t> g_allocations{0u};
+
+/// \brief Minimum wall time spent measuring each benchmark.
+static const std::chrono::milliseconds g_minBenchmarkTime(200);
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  ++g_allocations;
+  if (void *ptr = std::malloc(_size > 0u ? _size : 1u))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+/// \brief Result of a benchmark.
+struct BenchmarkResult
+{
+  /// \brief Samples processed per second.
+  double samplesPerSec = 0.0;
+
+  /// \brief Average number of heap allocations per call.
+  double allocationsPerCall = 0.0;
+};
+
+//////////////////////////////////////////////////
+/// \brief Call _func repeatedly for at least g_minBenchmarkTime and print
+/// its throughput.
+/// \param[in] _name Name of the benchmark.
+/// \param[in] _samples Number of samples processed by one call of _func.
+/// \param[in] _func Kernel to measure.
+/// \return The measured throughput and allocations.
+template<typename Func>
+BenchmarkResult Benchmark(const std::string &_name, std::size_t _samples,
+    Func _func)
+{
+  // Warm up, so that lazily allocated buffers don't count.
+  _func();
+
+  std::size_t calls = 0u;
+  const std::size_t allocationsStart = g_allocations;
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+  while (elapsed < g_minBenchmarkTime || calls < 3u)
+  {
+    _func();
+    ++calls;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  const std::size_t allocations = g_allocations - allocationsStart;
+
+  BenchmarkResult result;
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  result.samplesPerSec = static_cast<double>(_samples * calls) / seconds;
+  result.allocationsPerCall =
+      static_cast<double>(allocations) / static_cast<double>(calls);
+
+  std::cout << "[ BENCHMARK ] " << std::left << std::setw(40) << _name
+            << std::right << std::setw(12) << std::setprecision(4)
+            << result.samplesPerSec / 1e6 << " Msamples/s  "
+            << std::setw(8) << result.allocationsPerCall
+            << " allocations/call" << std::endl;
+  return result;
+}
+
+//////////////////////////////////////////////////
+/// \brief Create a noise element.
+/// \param[in] _type Noise type.
+/// \param[in] _stddev Standard deviation.
+/// \param[in] _precision Quantization precision.
+/// \return The noise element.
+sdf::ElementPtr NoiseSdf(const std::string &_type, double _stddev,
+    double _precision = 0.0)
+{
+  std::ostringstream stream;
+  stream << "<sdf version='1.6'>"
+         << "  <noise type='" << _type << "'>"
+         << "    <mean>0.01</mean>"
+         << "    <stddev>" << _stddev << "</stddev>"
+         << "    <precision>" << _precision << "</precision>"
+         << "  </noise>"
+         << "</sdf>";
+
+  sdf::ElementPtr sdf(new sdf::Element);
+  sdf::initFile("noise.sdf", sdf);
+  sdf::readString(stream.str(), sdf);
+  return sdf;
+}
+
+//////////////////////////////////////////////////
+/// \brief Create a lidar sensor element.
+/// \param[in] _columns Number of horizontal samples.
+/// \param[in] _rows Number of vertical samples (beams).
+/// \return The sensor element.
+sdf::ElementPtr LidarSdf(unsigned int _columns, unsigned int _rows)
+{
+  std::ostringstream stream;
+  stream
+    << "<?xml version='1.0'?>"
+    << "<sdf version='1.6'>"
+    << " <model name='m1'>"
+    << "  <link name='link1'>"
+    << "    <sensor name='bench_lidar' type='lidar'>"
+    << "      <topic>/test/performance/lidar</topic>"
+    << "      <update_rate>10</update_rate>"
+    << "      <ray>"
+    << "        <scan>"
+    << "          <horizontal>"
+    << "            <samples>" << _columns << "</samples>"
+    << "            <resolution>1</resolution>"
+    << "            <min_angle>-3.14159</min_angle>"
+    << "            <max_angle>3.14159</max_angle>"
+    << "          </horizontal>"
+    << "          <vertical>"
+    << "            <samples>" << _rows << "</samples>"
+    << "            <resolution>1</resolution>"
+    << "            <min_angle>-0.3</min_angle>"
+    << "            <max_angle>0.3</max_angle>"
+    << "          </vertical>"
+    << "        </scan>"
+    << "        <range>"
+    << "          <min>0.1</min>"
+    << "          <max>100.0</max>"
+    << "          <resolution>0.01</resolution>"
+    << "        </range>"
+    << "        <noise>"
+    << "          <type>gaussian</type>"
+    << "          <mean>0.0</mean>"
+    << "          <stddev>0.01</stddev>"
+    << "        </noise>"
+    << "      </ray>"
+    << "      <always_on>1</always_on>"
+    << "    </sensor>"
+    << "  </link>"
+    << " </model>"
+    << "</sdf>";
+
+  sdf::SDFPtr sdfParsed(new sdf::SDF());
+  sdf::init(sdfParsed);
+  if (!sdf::readString(stream.str(), sdfParsed))
+    return sdf::ElementPtr();
+
+  return sdfParsed->Root()->GetElement("model")->GetElement("link")
+    ->GetElement("sensor");
+}
+
+//////////////////////////////////////////////////
+TEST(SensorKernels, GaussianNoise)
+{
+  const std::size_t count = 1u << 20;
+  std::vector<double> doubles(count, 1.0);
+  std::vector<float> floats(count, 1.0f);
+
+  sensors::NoisePtr noise =
+      sensors::NoiseFactory::NewNoiseModel(NoiseSdf("gaussian", 0.1));
+  ASSERT_NE(nullptr, noise);
+
+  Benchmark("Noise::Apply", count, [&]()
+  {
+    for (double &value : doubles)
+      value = noise->Apply(value);
+  });
+
+  BenchmarkResult batch = Benchmark("Noise::ApplyBatch double", count, [&]()
+  {
+    noise->ApplyBatch(doubles.data(), doubles.size());
+  });
+  EXPECT_DOUBLE_EQ(0.0, batch.allocationsPerCall);
+
+  batch = Benchmark("Noise::ApplyBatch float", count, [&]()
+  {
+    noise->ApplyBatch(floats.data(), floats.size());
+  });
+  EXPECT_DOUBLE_EQ(0.0, batch.allocationsPerCall);
+
+  Benchmark("Noise::ApplyBatch float stride 3", count / 3u, [&]()
+  {
+    noise->ApplyBatch(floats.data(), floats.size() / 3u, 0.0, 3u);
+  });
+
+  sensors::NoisePtr quantized = sensors::NoiseFactory::NewNoiseModel(
+      NoiseSdf("gaussian_quantized", 0.1, 0.01));
+  ASSERT_NE(nullptr, quantized);
+  Benchmark("Noise::ApplyBatch quantized", count, [&]()
+  {
+    quantized->ApplyBatch(doubles.data(), doubles.size());
+  });
+
+  std::dynamic_pointer_cast<sensors::GaussianNoiseModel>(noise)->
+      SetTableSize(1u << 16);
+  Benchmark("Noise::ApplyBatch table", count, [&]()
+  {
+    noise->ApplyBatch(floats.data(), floats.size());
+  });
+}
+
+//////////////////////////////////////////////////
+TEST(SensorKernels, LidarApplyNoise)
+{
+  const std::vector<unsigned int> beams = {16u, 32u, 64u, 128u};
+  const unsigned int columns = 2048u;
+  for (unsigned int rows : beams)
+  {
+    sdf::ElementPtr lidarSdf = LidarSdf(columns, rows);
+    ASSERT_NE(nullptr, lidarSdf);
+
+    sensors::Lidar lidar;
+    ASSERT_TRUE(lidar.Load(lidarSdf));
+    ASSERT_EQ(columns, lidar.RayCount());
+    ASSERT_EQ(rows, lidar.VerticalRayCount());
+
+    const std::size_t rays = static_cast<std::size_t>(columns) * rows;
+    lidar.laserBuffer = new float[rays * 3u];
+    for (std::size_t i = 0; i < rays * 3u; ++i)
+      lidar.laserBuffer[i] = 10.0f;
+
+    Benchmark("Lidar::ApplyNoise " + std::to_string(rows) + "x" +
+        std::to_string(columns), rays, [&]()
+    {
+      lidar.ApplyNoise();
+    });
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(SensorKernels, RayCasterCast)
+{
+  // Rays cast from the center of a tessellated sphere of 10 m radius
+  const unsigned int stacks = 64u;
+  const unsigned int slices = 128u;
+  std::vector<math::Vector3d> vertices;
+  std::vector<unsigned int> indices;
+  for (unsigned int j = 0u; j <= stacks; ++j)
+  {
+    const double inclination = -IGN_PI / 2 + IGN_PI * j / stacks;
+    for (unsigned int i = 0u; i <= slices; ++i)
+    {
+      const double azimuth = 2.0 * IGN_PI * i / slices;
+      vertices.push_back(math::Vector3d(
+          10.0 * std::cos(inclination) * std::cos(azimuth),
+          10.0 * std::cos(inclination) * std::sin(azimuth),
+          10.0 * std::sin(inclination)));
+    }
+  }
+  for (unsigned int j = 0u; j < stacks; ++j)
+  {
+    for (unsigned int i = 0u; i < slices; ++i)
+    {
+      const unsigned int corner = j * (slices + 1u) + i;
+      const unsigned int above = corner + slices + 1u;
+      indices.insert(indices.end(),
+          {corner, corner + 1u, above, corner + 1u, above + 1u, above});
+    }
+  }
+
+  sensors::RayCaster caster;
+  ASSERT_TRUE(caster.SetMesh("sphere", vertices, indices));
+  caster.Build();
+
+  const std::vector<unsigned int> beams = {16u, 64u};
+  const unsigned int columns = 2048u;
+  for (unsigned int rows : beams)
+  {
+    const std::size_t rays = static_cast<std::size_t>(columns) * rows;
+    std::vector<float> directions;
+    directions.reserve(rays * 3u);
+    for (unsigned int j = 0u; j < rows; ++j)
+    {
+      const double inclination = -0.4 + 0.8 * j / (rows - 1u);
+      for (unsigned int i = 0u; i < columns; ++i)
+      {
+        const double azimuth = -IGN_PI + 2.0 * IGN_PI * i / columns;
+        directions.push_back(static_cast<float>(
+            std::cos(inclination) * std::cos(azimuth)));
+        directions.push_back(static_cast<float>(
+            std::cos(inclination) * std::sin(azimuth)));
+        directions.push_back(static_cast<float>(std::sin(inclination)));
+      }
+    }
+    std::vector<float> scan(rays * 3u);
+
+    Benchmark("RayCaster::Cast " + std::to_string(rows) + "x" +
+        std::to_string(columns), rays, [&]()
+    {
+      caster.Cast(math::Pose3d::Zero, directions.data(), rays, 0.1, 100.0,
+          scan.data());
+    });
+    EXPECT_NEAR(10.0f, scan[0], 0.1f);
+  }
+}
+
+//////////////////////////////////////////////////
+TEST(SensorKernels, PointCloudUtilFillMsg)
+{
+  struct Resolution
+  {
+    std::string name;
+    unsigned int width;
+    unsigned int height;
+  };
+  const std::vector<Resolution> resolutions = {
+    {"VGA", 640u, 480u},
+    {"HD", 1280u, 720u},
+    {"4K", 3840u, 2160u},
+  };
+
+  sensors::PointCloudUtil util;
+  for (const auto &res : resolutions)
+  {
+    const std::size_t pixels = static_cast<std::size_t>(res.width) *
+        res.height;
+    std::vector<unsigned char> image(pixels * 3u, 128u);
+    std::vector<float> depth(pixels, 2.0f);
+    std::vector<float> xyz(pixels * 3u, 1.0f);
+    std::vector<float> cloud(pixels * 4u, 1.0f);
+
+    msgs::PointCloudPacked msg;
+    msgs::InitPointCloudPacked(msg, "bench", true,
+        {{"xyz", msgs::PointCloudPacked::Field::FLOAT32},
+         {"rgb", msgs::PointCloudPacked::Field::FLOAT32}});
+    msg.set_width(res.width);
+    msg.set_height(res.height);
+    msg.set_row_step(msg.point_step() * res.width);
+
+    Benchmark("PointCloudUtil::FillMsg depth " + res.name, pixels, [&]()
+    {
+      util.FillMsg(msg, math::Angle(1.047), image.data(), depth.data());
+    });
+
+    Benchmark("PointCloudUtil::FillMsg xyz " + res.name, pixels, [&]()
+    {
+      util.FillMsg(msg, xyz.data(), image.data());
+    });
+
+    Benchmark("PointCloudUtil::FillMsg cloud " + res.name, pixels, [&]()
+    {
+      util.FillMsg(msg, cloud.data(), true, image.data());
+    });
+
+    Benchmark("PointCloudUtil::FillMsgFromPointCloud " + res.name, pixels,
+        [&]()
+    {
+      util.FillMsgFromPointCloud(msg, cloud.data(), image.data());
+    });
+  }
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef IGNITION_SENSORS_TEST_REGRESSION_PERFBUDGETS_HH_
+#define IGNITION_SENSORS_TEST_REGRESSION_PERFBUDGETS_HH_
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "test_config.h"  // NOLINT(build/include)
+
+/// \brief Performance budgets of the regression tests, read from
+/// perf_budgets.txt, or from the file named by IGN_SENSORS_PERF_BUDGETS.
+class PerfBudgets
+{
+  /// \brief Constructor, loads the budgets and the tolerance.
+  public: PerfBudgets()
+  {
+    const char *path = std::getenv("IGN_SENSORS_PERF_BUDGETS");
+    const std::string file = path && *path ? std::string(path) :
+        std::string(PROJECT_SOURCE_PATH) + "/test/regression/perf_budgets.txt";
+    std::ifstream in(file);
+    if (!in)
+      std::cerr << "Unable to read performance budgets [" << file << "]\n";
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+      std::istringstream stream(line);
+      std::string name;
+      double value;
+      if (stream >> name && name[0] != '#' && stream >> value)
+        this->budgets[name] = value;
+    }
+
+    const char *tolerance = std::getenv("IGN_SENSORS_PERF_TOLERANCE");
+    if (tolerance && *tolerance)
+      this->tolerance = std::atof(tolerance);
+  }
+
+  /// \brief Check that a measurement doesn't exceed its budget by more
+  /// than the tolerance.
+  /// \param[in] _name Name of the budget
+  /// \param[in] _value Measured value, lower is better
+  public: void ExpectAtMost(const std::string &_name, double _value) const
+  {
+    double budget;
+    if (!this->Budget(_name, budget))
+      return;
+
+    Report(_name, _value, budget);
+    EXPECT_LE(_value, budget * (1.0 + this->tolerance))
+        << "[" << _name << "] is over its budget";
+    if (_value < budget * 0.5)
+      Improved(_name);
+  }
+
+  /// \brief Check that a measurement doesn't fall below its budget by more
+  /// than the tolerance.
+  /// \param[in] _name Name of the budget
+  /// \param[in] _value Measured value, higher is better
+  public: void ExpectAtLeast(const std::string &_name, double _value) const
+  {
+    double budget;
+    if (!this->Budget(_name, budget))
+      return;
+
+    Report(_name, _value, budget);
+    EXPECT_GE(_value, budget / (1.0 + this->tolerance))
+        << "[" << _name << "] is under its budget";
+    if (_value > budget * 2.0)
+      Improved(_name);
+  }
+
+  /// \brief Get a budget.
+  /// \param[in] _name Name of the budget
+  /// \param[out] _budget The budget
+  /// \return False, with a test failure, if there is no such budget.
+  private: bool Budget(const std::string &_name, double &_budget) const
+  {
+    auto it = this->budgets.find(_name);
+    EXPECT_NE(this->budgets.end(), it) << "No budget for [" << _name << "]";
+    if (it == this->budgets.end())
+      return false;
+    _budget = it->second;
+    return true;
+  }
+
+  /// \brief Print a measurement next to its budget.
+  /// \param[in] _name Name of the budget
+  /// \param[in] _value Measured value
+  /// \param[in] _budget The budget
+  private: static void Report(const std::string &_name, double _value,
+               double _budget)
+  {
+    std::cout << "[ BUDGET    ] " << _name << " " << _value << " (budget "
+              << _budget << ")" << std::endl;
+  }
+
+  /// \brief Suggest tightening a budget that was easily met.
+  /// \param[in] _name Name of the budget
+  private: static void Improved(const std::string &_name)
+  {
+    std::cout << "[ BUDGET    ] " << _name << " beats its budget by more "
+              << "than a factor of 2, consider tightening it" << std::endl;
+  }
+
+  /// \brief Budgets by name
+  private: std::map<std::string, double> budgets;
+
+  /// \brief Fraction by which a measurement may be worse than its budget
+  private: double tolerance = 0.25;
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+
+#include <ignition/common/Console.hh>
+#include <ignition/sensors/CameraSensor.hh>
+#include <ignition/sensors/Manager.hh>
+#include <ignition/transport/Node.hh>
+#include <sdf/sdf.hh>
+
+// TODO(louise) Remove these pragmas once ign-rendering is disabling the
+// warnings
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/rendering/RenderEngine.hh>
+#include <ignition/rendering/RenderingIface.hh>
+#include <ignition/rendering/Scene.hh>
+#include <ignition/rendering/Visual.hh>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#ifdef _WIN32
+#pragma warning(push)
+#pragma warning(disable: 4005)
+#pragma warning(disable: 4251)
+#endif
+#include <ignition/msgs.hh>
+#ifdef _WIN32
+#pragma warning(pop)
+#endif
+
+#include "PerfBudgets.hh"
+
+using namespace ignition;
+
+/// \brief Number of heap allocations made by this process so far.
+static std::atomic<std::size_t> g_allocations{0u};
+
+//////////////////////////////////////////////////
+void *operator new(std::size_t _size)
+{
+  ++g_allocations;
+  if (void *ptr = std::malloc(_size > 0u ? _size : 1u))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+void operator delete(void *_ptr, std::size_t) noexcept
+{
+  std::free(_ptr);
+}
+
+//////////////////////////////////////////////////
+/// \brief Create the SDF of a 320x240 camera.
+/// \return The sensor element.
+sdf::ElementPtr CameraSdf()
+{
+  std::ostringstream stream;
+  stream
+    << "<?xml version='1.0'?>"
+    << "<sdf version='1.6'>"
+    << " <model name='m1'>"
+    << "  <link name='link1'>"
+    << "    <sensor name='budget_camera' type='camera'>"
+    << "      <topic>/test/regression/camera</topic>"
+    << "      <update_rate>30</update_rate>"
+    << "      <camera>"
+    << "        <horizontal_fov>1.05</horizontal_fov>"
+    << "        <image>"
+    << "          <width>320</width>"
+    << "          <height>240</height>"
+    << "        </image>"
+    << "        <clip>"
+    << "          <near>0.1</near>"
+    << "          <far>50</far>"
+    << "        </clip>"
+    << "      </camera>"
+    << "    </sensor>"
+    << "  </link>"
+    << " </model>"
+    << "</sdf>";
+
+  sdf::SDFPtr sdfParsed(new sdf::SDF());
+  sdf::init(sdfParsed);
+  if (!sdf::readString(stream.str(), sdfParsed))
+    return sdf::ElementPtr();
+
+  return sdfParsed->Root()->GetElement("model")->GetElement("link")
+    ->GetElement("sensor");
+}
+
+//////////////////////////////////////////////////
+class CameraBudgets: public testing::Test,
+  public testing::WithParamInterface<const char *>
+{
+  // Count the allocations of camera frames
+  public: void FrameAllocations(const std::string &_renderEngine);
+};
+
+//////////////////////////////////////////////////
+void CameraBudgets::FrameAllocations(const std::string &_renderEngine)
+{
+  PerfBudgets budgets;
+
+  auto *engine = rendering::engine(_renderEngine);
+  if (!engine)
+  {
+    igndbg << "Engine '" << _renderEngine
+              << "' is not supported" << std::endl;
+    return;
+  }
+
+  rendering::ScenePtr scene = engine->CreateScene("scene");
+  rendering::VisualPtr box = scene->CreateVisual();
+  box->AddGeometry(scene->CreateBox());
+  box->SetLocalPosition(3, 0, 0);
+  scene->RootVisual()->AddChild(box);
+
+  {
+    sensors::Manager mgr;
+    auto *sensor = mgr.CreateSensor<sensors::CameraSensor>(CameraSdf());
+    ASSERT_NE(nullptr, sensor);
+    sensor->SetScene(scene);
+
+    // A subscriber, so that the frames are read back and published
+    transport::Node node;
+    node.Subscribe<msgs::Image>(sensor->Topic(), [](const msgs::Image &) {});
+
+    const auto step = std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / 30.0));
+    std::chrono::steady_clock::duration now =
+        std::chrono::steady_clock::duration::zero();
+
+    // Render targets and buffers are allocated by the first frames
+    for (int i = 0; i < 10; ++i, now += step)
+      mgr.RunOnce(now);
+    mgr.WaitForRendering();
+    const uint64_t framesStart = sensor->Stats().updateCount;
+
+    const std::size_t allocationsStart = g_allocations;
+    for (int i = 0; i < 30; ++i, now += step)
+      mgr.RunOnce(now);
+    mgr.WaitForRendering();
+    const std::size_t allocations = g_allocations - allocationsStart;
+
+    const uint64_t frames = sensor->Stats().updateCount - framesStart;
+    ASSERT_GT(frames, 0u);
+    budgets.ExpectAtMost("camera_frame_allocations",
+        static_cast<double>(allocations) / static_cast<double>(frames));
+  }
+
+  engine->DestroyScene(scene);
+  rendering::unloadEngine(engine->Name());
+}
+
+//////////////////////////////////////////////////
+TEST_P(CameraBudgets, FrameAllocations)
+{
+  FrameAllocations(GetParam());
+}
+
+INSTANTIATE_TEST_CASE_P(CameraSensor, CameraBudgets,
+    RENDER_ENGINE_VALUES, rendering::PrintToStringParam());
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
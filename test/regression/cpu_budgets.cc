@@ -0,0 +1,172 @@
+/*
+ * Copyright (C) 2020 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ignition/common/Console.hh>
+#include <ignition/math/Angle.hh>
+#include <ignition/msgs/Utility.hh>
+#include <ignition/msgs/imu.pb.h>
+#include <ignition/transport/Node.hh>
+#include <sdf/sdf.hh>
+
+#include "ignition/sensors/ImuSensor.hh"
+
+#include "PerfBudgets.hh"
+#include "PointCloudUtil.hh"
+
+using namespace ignition;
+
+/// \brief Minimum wall time spent measuring each budget.
+static const std::chrono::milliseconds g_minMeasureTime(200);
+
+//////////////////////////////////////////////////
+/// \brief Call _func repeatedly for at least g_minMeasureTime.
+/// \param[in] _func Code to measure.
+/// \return Mean wall time of a call, in seconds.
+template<typename Func>
+double MeanSeconds(Func _func)
+{
+  // Warm up, so that lazily allocated buffers don't count.
+  _func();
+
+  std::size_t calls = 0u;
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed = std::chrono::steady_clock::duration::zero();
+  while (elapsed < g_minMeasureTime || calls < 3u)
+  {
+    _func();
+    ++calls;
+    elapsed = std::chrono::steady_clock::now() - start;
+  }
+  return std::chrono::duration<double>(elapsed).count() /
+      static_cast<double>(calls);
+}
+
+//////////////////////////////////////////////////
+/// \brief Create the SDF of an IMU with noise on every axis.
+/// \return The sensor element.
+sdf::ElementPtr ImuSdf()
+{
+  std::ostringstream noise;
+  noise << "<noise type='gaussian'>"
+        << "  <mean>0.01</mean>"
+        << "  <stddev>0.1</stddev>"
+        << "  <bias_mean>0.001</bias_mean>"
+        << "  <bias_stddev>0.0001</bias_stddev>"
+        << "</noise>";
+  std::ostringstream axes;
+  axes << "<x>" << noise.str() << "</x>"
+       << "<y>" << noise.str() << "</y>"
+       << "<z>" << noise.str() << "</z>";
+
+  std::ostringstream stream;
+  stream
+    << "<?xml version='1.0'?>"
+    << "<sdf version='1.6'>"
+    << " <model name='m1'>"
+    << "  <link name='link1'>"
+    << "    <sensor name='budget_imu' type='imu'>"
+    << "      <topic>/test/regression/imu</topic>"
+    << "      <update_rate>1000</update_rate>"
+    << "      <imu>"
+    << "        <angular_velocity>" << axes.str() << "</angular_velocity>"
+    << "        <linear_acceleration>" << axes.str()
+    << "        </linear_acceleration>"
+    << "      </imu>"
+    << "    </sensor>"
+    << "  </link>"
+    << " </model>"
+    << "</sdf>";
+
+  sdf::SDFPtr sdfParsed(new sdf::SDF());
+  sdf::init(sdfParsed);
+  if (!sdf::readString(stream.str(), sdfParsed))
+    return sdf::ElementPtr();
+
+  return sdfParsed->Root()->GetElement("model")->GetElement("link")
+    ->GetElement("sensor");
+}
+
+//////////////////////////////////////////////////
+TEST(CpuBudgets, ImuUpdate)
+{
+  PerfBudgets budgets;
+
+  sensors::ImuSensor imu;
+  ASSERT_TRUE(imu.Load(ImuSdf()));
+
+  // A subscriber, so that the message is built and published
+  transport::Node node;
+  node.Subscribe<msgs::IMU>(imu.Topic(), [](const msgs::IMU &) {});
+
+  // Through Sensor::Update() to keep the schedule and the statistics
+  sensors::Sensor &sensor = imu;
+  std::chrono::steady_clock::duration now =
+      std::chrono::steady_clock::duration::zero();
+  const double seconds = MeanSeconds([&]()
+  {
+    now += std::chrono::milliseconds(1);
+    imu.SetAngularVelocity(math::Vector3d(0.1, 0.2, 0.3));
+    imu.SetLinearAcceleration(math::Vector3d(0.0, 0.0, 9.8));
+    sensor.Update(now, false);
+  });
+
+  budgets.ExpectAtMost("imu_update_us", seconds * 1e6);
+}
+
+//////////////////////////////////////////////////
+TEST(CpuBudgets, PointCloudUtilFillMsg)
+{
+  PerfBudgets budgets;
+
+  const unsigned int width = 640u;
+  const unsigned int height = 480u;
+  const std::size_t pixels = static_cast<std::size_t>(width) * height;
+  std::vector<unsigned char> image(pixels * 3u, 128u);
+  std::vector<float> depth(pixels, 2.0f);
+
+  msgs::PointCloudPacked msg;
+  msgs::InitPointCloudPacked(msg, "budget", true,
+      {{"xyz", msgs::PointCloudPacked::Field::FLOAT32},
+       {"rgb", msgs::PointCloudPacked::Field::FLOAT32}});
+  msg.set_width(width);
+  msg.set_height(height);
+  msg.set_row_step(msg.point_step() * width);
+
+  sensors::PointCloudUtil util;
+  const double seconds = MeanSeconds([&]()
+  {
+    util.FillMsg(msg, math::Angle(1.047), image.data(), depth.data());
+  });
+
+  budgets.ExpectAtLeast("point_cloud_util_points_per_sec",
+      static_cast<double>(pixels) / seconds);
+}
+
+//////////////////////////////////////////////////
+int main(int argc, char **argv)
+{
+  ignition::common::Console::SetVerbosity(1);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}